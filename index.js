@@ -79,8 +79,6 @@ async function main() {
 
     const wasmStateOffset = wasmInstance.exports.wasmInit();
     console.log(wasmStateOffset);
-    const quadsOffset = wasm.instance.exports.getQuadsOffset();
-    console.log(quadsOffset);
 
     // NOTE: WEBGL setup
     const canvas = document.querySelector("#gl-canvas");
@@ -312,18 +310,27 @@ async function main() {
 
     // init buffer
     const vertexBuffer = gl.createBuffer();
-    const vertexBufferSize = 90*1024;
-    const positions = [
+    const positions = new Float32Array([
 	 1.0,  1.0, 1.0, 1.0,
 	-1.0,  1.0, 0.0, 1.0,
 	 1.0, -1.0, 1.0, 0.0,
 	-1.0, -1.0, 0.0, 0.0,
-    ];
+    ]);
+    const quadSize = wasm.instance.exports.getQuadSize();
+    let vertexBufferSize = 0;
+
+    // NOTE: the plugin grows its quads when a frame needs more, so the buffer grows to match
+    function reserveVertexBuffer(quadCount) {
+	const requiredSize = 64 + quadSize*quadCount;
+	if(requiredSize > vertexBufferSize) {
+	    vertexBufferSize = Math.max(requiredSize, 2*vertexBufferSize);
+	    gl.bufferData(gl.ARRAY_BUFFER, vertexBufferSize, gl.STREAM_DRAW);
+	    gl.bufferSubData(gl.ARRAY_BUFFER, 0, positions);
+	}
+    }
     gl.bindBuffer(gl.ARRAY_BUFFER, vertexBuffer);
-    gl.bufferData(gl.ARRAY_BUFFER, vertexBufferSize, gl.STATIC_DRAW); // TODO: stream draw?
-    gl.bufferSubData(gl.ARRAY_BUFFER, 0, new Float32Array(positions));
+    reserveVertexBuffer(wasm.instance.exports.getQuadCapacity());
 
-    const quadSize = wasm.instance.exports.getQuadSize();
     const quadSizeInFloats = quadSize / 4;
 
     const targetAspectRatio = 16.0 / 9.0;
@@ -333,16 +340,13 @@ async function main() {
     // render loop
     function render(now) {
 
-	// NOTE: resize canvas
-	canvas.width = canvas.clientWidth;
-	canvas.height = canvas.clientHeight;
-
-	gl.viewport(0, 0, canvas.width, canvas.height);
-	gl.scissor(0, 0, canvas.width, canvas.height);
-
-	gl.clearColor(0.2, 0.2, 0.2, 1.0);
-	gl.clearDepth(1.0);
-	gl.clear(gl.COLOR_BUFFER_BIT | gl.DEPTH_BUFFER_BIT);
+	// NOTE: resize canvas. setting its size clears it, so only do that when the size changed
+	const canvasWasResized = (canvas.width !== canvas.clientWidth ||
+				  canvas.height !== canvas.clientHeight);
+	if(canvasWasResized) {
+	    canvas.width = canvas.clientWidth;
+	    canvas.height = canvas.clientHeight;
+	}
 
 	// NOTE: compute draw region
 	const windowAspectRatio = canvas.width / canvas.height;
@@ -360,18 +364,35 @@ async function main() {
 
 	const viewportDimXInt = Math.floor(viewportDimX);
 	const viewportDimYInt = Math.floor(viewportDimY);
+
+	//console.log(now);
+
+	const quadCount = wasm.instance.exports.drawQuads(viewportDimXInt, viewportDimYInt, now);
+	//console.log(`quadCount: ${quadCount}`);
+
+	// NOTE: an unchanged frame is left undrawn, and the canvas keeps showing it
+	if(!canvasWasResized && !wasm.instance.exports.frameNeedsSubmission()) {
+	    requestAnimationFrame(render);
+	    return;
+	}
+
+	gl.viewport(0, 0, canvas.width, canvas.height);
+	gl.scissor(0, 0, canvas.width, canvas.height);
+
+	gl.clearColor(0.2, 0.2, 0.2, 1.0);
+	gl.clearDepth(1.0);
+	gl.clear(gl.COLOR_BUFFER_BIT | gl.DEPTH_BUFFER_BIT);
+
 	gl.viewport(Math.floor(viewportMinX), Math.floor(viewportMinY),
 		    viewportDimXInt, viewportDimYInt);
 	gl.scissor(Math.floor(viewportMinX), Math.floor(viewportMinY),
 		   viewportDimXInt, viewportDimYInt);
 
-	//console.log(now);
-
 	// NOTE: write quad data to vertex buffer
-	const quadCount = wasm.instance.exports.drawQuads(viewportDimXInt, viewportDimYInt, now);
-	//console.log(`quadCount: ${quadCount}`);
+	const quadsOffset = wasm.instance.exports.getQuadsOffset();
 	const quadData = new Float32Array(sharedMemory.buffer, quadsOffset, quadSizeInFloats*quadCount);
 	//console.log(quadData);
+	reserveVertexBuffer(quadCount);
 	gl.bufferSubData(gl.ARRAY_BUFFER, 64, quadData);
 
 	// NOTE: enable vertex attributes
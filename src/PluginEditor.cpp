@@ -340,26 +340,8 @@ newOpenGLContextCreated(void)
 void AudioPluginAudioProcessorEditor::
 renderOpenGL(void)
 {  
-  glViewport(0, 0, editorWidth, editorHeight);
-  glScissor(0, 0, editorWidth, editorHeight);
-
-  glEnable(GL_DEPTH_TEST);
-  glDepthFunc(GL_LEQUAL);
-
-  glClearColor(0.2f, 0.2f, 0.2f, 0.f);
-  glClearDepth(1);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
   renderBeginCommands(commands, displayDim.x, displayDim.y);
 
-  glViewport(displayMin.x, displayMin.y, displayDim.x, displayDim.y);
-  glScissor(displayMin.x, displayMin.y, displayDim.x, displayDim.y);
-
-  // NOTE: juce needs this blending stuff to be in the render function, aparently.
-  //       no idea why, or if it's just a linux thing
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
   // NOTE: we have to put locks around input usage and input callback code,
   //       because juce doesn't give us a way of polling input at a particular
   //       time. We could avoid locks by having input callbacks write to a
@@ -396,7 +378,30 @@ renderOpenGL(void)
 	  } break;
 	}
       
-      renderCommands(commands);
+      // NOTE: juce swaps buffers after every render call, so an unchanged frame is only left
+      //       undrawn once both buffers hold it
+      if(renderFrameNeedsSubmission(commands))
+	{
+	  glViewport(0, 0, editorWidth, editorHeight);
+	  glScissor(0, 0, editorWidth, editorHeight);
+
+	  glEnable(GL_DEPTH_TEST);
+	  glDepthFunc(GL_LEQUAL);
+
+	  glClearColor(0.2f, 0.2f, 0.2f, 0.f);
+	  glClearDepth(1);
+	  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	  glViewport(displayMin.x, displayMin.y, displayDim.x, displayDim.y);
+	  glScissor(displayMin.x, displayMin.y, displayDim.x, displayDim.y);
+
+	  // NOTE: juce needs this blending stuff to be in the render function, aparently.
+	  //       no idea why, or if it's just a linux thing
+	  glEnable(GL_BLEND);
+	  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	  renderCommands(commands);
+	}
       renderEndCommands(commands);
       
 #if BUILD_LOGGING
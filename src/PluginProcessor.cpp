@@ -88,6 +88,34 @@ juceWriteEntireFile(char *filename, Buffer file)
     }
 }
 
+static Buffer
+juceMapFile(char *filename)
+{
+  juce::String filepath = globalVstBaseDirectory + "/" + juce::String(filename);
+  juce::Logger::writeToLog(filepath);
+
+  Buffer result = platformMapFile((char *)filepath.toRawUTF8());
+  return(result);
+}
+
+static GS_File
+juceOpenFileForWriting(char *filename, b32 truncate)
+{
+  juce::String filepath = globalVstBaseDirectory + "/" + juce::String(filename);
+
+  GS_File result = platformOpenFileForWriting((char *)filepath.toRawUTF8(), truncate);
+  return(result);
+}
+
+static b32
+juceRemoveFile(char *filename)
+{
+  juce::String filepath = globalVstBaseDirectory + "/" + juce::String(filename);
+
+  b32 result = platformRemoveFile((char *)filepath.toRawUTF8());
+  return(result);
+}
+
 static void
 juceFreeFileMemory(Buffer file, Arena *allocator)
 {
@@ -293,6 +321,12 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
 
 AudioPluginAudioProcessor::~AudioPluginAudioProcessor()
 {
+  // NOTE: before `libPlugin` closes, since the plugin's threads run its code
+  if(pluginCode.pluginAPI.gsShutdownPlugin)
+    {
+      pluginCode.pluginAPI.gsShutdownPlugin();
+    }
+
   gsArenaDiscard(processorArena);
   processorArena = 0;
 }
@@ -381,7 +415,7 @@ prepareToPlay(double sampleRate, int samplesPerBlock)
   // juce::Logger::writeToLog(modelPath);
 
   //onnxState = {};
-  //onnxState = onnxInitializeState(modelPath);
+  //onnxState = onnxInitializeState(modelPath, onnxDefaultSettings());
 
   pluginMemory.host			     = PluginHost_daw;
   // pluginMemory.platformAPI.gsReadEntireFile  = platformReadEntireFile;
@@ -390,9 +424,17 @@ prepareToPlay(double sampleRate, int samplesPerBlock)
   pluginMemory.platformAPI.gsReadEntireFile  = juceReadEntireFile;
   pluginMemory.platformAPI.gsWriteEntireFile = juceWriteEntireFile;
   pluginMemory.platformAPI.gsFreeFileMemory  = juceFreeFileMemory;
+  pluginMemory.platformAPI.gsMapFile         = juceMapFile;
+  pluginMemory.platformAPI.gsUnmapFile       = platformUnmapFile;
+  pluginMemory.platformAPI.gsOpenFileForWriting = juceOpenFileForWriting;
+  pluginMemory.platformAPI.gsWriteFileAt        = platformWriteFileAt;
+  pluginMemory.platformAPI.gsCloseFile          = platformCloseFile;
+  pluginMemory.platformAPI.gsRemoveFile         = juceRemoveFile;
   pluginMemory.platformAPI.gsGetPathToModule = platformGetPathToModule;
+  pluginMemory.platformAPI.gsStartThread     = platformStartThread;
+  pluginMemory.platformAPI.gsSleep           = platformSleep;
   
-  //pluginMemory.platformAPI.runModel = platformRunModel;
+  //pluginMemory.platformAPI.gsRunModel = platformRunModel;
 
   pluginMemory.platformAPI.gsRand = gsRand;
   pluginMemory.platformAPI.gsAbs  = fabsf;
@@ -446,7 +488,11 @@ prepareToPlay(double sampleRate, int samplesPerBlock)
       if(!pluginCode.pluginAPI.gsInitializePluginState)
 	{
 	  juce::Logger::writeToLog("failed to load function: gsInitializePluginState");
-	}     
+	}
+
+      // NOTE: optional; plugins without it have no background threads to stop
+      pluginCode.pluginAPI.gsShutdownPlugin =
+	(GS_ShutdownPlugin*)libPlugin.getFunction("gsShutdownPlugin");
     }
   else
     {
@@ -459,6 +505,7 @@ prepareToPlay(double sampleRate, int samplesPerBlock)
       pluginCode.pluginAPI.gsRenderNewFrame	   = nullptr;
       pluginCode.pluginAPI.gsAudioProcess	   = nullptr;
       pluginCode.pluginAPI.gsInitializePluginState = nullptr;
+      pluginCode.pluginAPI.gsShutdownPlugin	   = nullptr;
     }  
 
   pluginMemory.pluginHandle = libPlugin.getNativeHandle();
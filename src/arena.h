@@ -73,7 +73,7 @@ arenaFlagsNoZeroAlign(u32 alignment)
 }
 
 #define arenaPushSize(arena, size, ...) arenaPushSize_(arena, size, ##__VA_ARGS__)
-#define arenaPushArray(arena, count, type, ...) (type *)arenaPushSize_(arena, count*sizeof(type), ##__VA_ARGS__)
+#define arenaPushArray(arena, count, type, ...) (type *)arenaPushSize_(arena, (count)*sizeof(type), ##__VA_ARGS__)
 #define arenaPushStruct(arena, type, ...) (type *)arenaPushSize_(arena, sizeof(type), ##__VA_ARGS__)
 
 static inline u8 *
@@ -86,7 +86,8 @@ arenaPushSize_(Arena *arena, usz size, ArenaPushFlags flags = defaultArenaPushFl
   usz newPos = alignedPos + size;
   if(newPos > current->capacity)
   {
-    usz allocSize = MAX(size + ARENA_HEADER_SIZE, current->capacity);
+    // NOTE: the new block's first push is aligned too, which can skip past more than the header
+    usz allocSize = MAX(size + ARENA_HEADER_SIZE + flags.alignment, current->capacity);
     Arena *newBlock = gsArenaAcquire(allocSize);
     newBlock->base = current->base + current->pos;
     newBlock->prev = current;
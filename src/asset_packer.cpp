@@ -132,12 +132,89 @@ writeEntireFile(String8 path, Buffer file)
     }
 }
 
+static b32
+fileExists(String8 path)
+{
+  DWORD attributes = GetFileAttributesA((char*)path.str);
+  return(attributes != INVALID_FILE_ATTRIBUTES);
+}
+
+static u64
+readTimerMicroseconds(void)
+{
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+
+  u64 seconds = counter.QuadPart / frequency.QuadPart;
+  u64 remainder = counter.QuadPart % frequency.QuadPart;
+  u64 result = 1000000*seconds + 1000000*remainder/frequency.QuadPart;
+  return(result);
+}
+
+static u32
+getProcessorCount(void)
+{
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return(systemInfo.dwNumberOfProcessors);
+}
+
+// NOTE: returns the value from before the increment
+static u32
+atomicIncrement(volatile u32 *value)
+{
+  return((u32)InterlockedIncrement((volatile LONG*)value) - 1);
+}
+
+typedef void PackerThreadProc(void *data);
+
+struct PackerThread
+{
+  HANDLE handle;
+  PackerThreadProc *proc;
+  void *data;
+};
+
+static DWORD WINAPI
+win32PackerThreadEntry(void *data)
+{
+  PackerThread *thread = (PackerThread*)data;
+  thread->proc(thread->data);
+  return(0);
+}
+
+// NOTE: a thread that can't be started runs its proc right away instead
+static void
+startThread(PackerThread *thread, PackerThreadProc *proc, void *data)
+{
+  thread->proc = proc;
+  thread->data = data;
+  thread->handle = CreateThread(0, 0, win32PackerThreadEntry, thread, 0, 0);
+  if(!thread->handle)
+    {
+      proc(data);
+    }
+}
+
+static void
+joinThread(PackerThread *thread)
+{
+  if(thread->handle)
+    {
+      WaitForSingleObject(thread->handle, INFINITE);
+      CloseHandle(thread->handle);
+    }
+}
+
 #elif OS_LINUX || OS_MAC
 
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <pthread.h>
+#include <time.h>
 
 static void*
 allocateMemory(usz size)
@@ -176,7 +253,7 @@ readEntireFile(Arena *arena, String8 path)
 	  while(totalBytesToRead)
 	    {
 	      ssz bytesRead = read(fileHandle, dest, bytesToRead);
-	      if(bytesRead == bytesToRead)
+	      if(bytesRead >= 0 && (usz)bytesRead == bytesToRead)
 		{
 		  dest += bytesRead;
 		  totalBytesToRead -= bytesRead;
@@ -229,6 +306,76 @@ writeEntireFile(String8 path, Buffer file)
     }
 }
 
+static b32
+fileExists(String8 path)
+{
+  return(access((char*)path.str, F_OK) == 0);
+}
+
+static u64
+readTimerMicroseconds(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  u64 result = 1000000*(u64)time.tv_sec + (u64)time.tv_nsec/1000;
+  return(result);
+}
+
+static u32
+getProcessorCount(void)
+{
+  long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+  return(processorCount > 0 ? (u32)processorCount : 1);
+}
+
+// NOTE: returns the value from before the increment
+static u32
+atomicIncrement(volatile u32 *value)
+{
+  return(__atomic_fetch_add(value, 1, __ATOMIC_ACQ_REL));
+}
+
+typedef void PackerThreadProc(void *data);
+
+struct PackerThread
+{
+  pthread_t handle;
+  b32 started;
+  PackerThreadProc *proc;
+  void *data;
+};
+
+static void*
+posixPackerThreadEntry(void *data)
+{
+  PackerThread *thread = (PackerThread*)data;
+  thread->proc(thread->data);
+  return(0);
+}
+
+// NOTE: a thread that can't be started runs its proc right away instead
+static void
+startThread(PackerThread *thread, PackerThreadProc *proc, void *data)
+{
+  thread->proc = proc;
+  thread->data = data;
+  thread->started = (pthread_create(&thread->handle, 0, posixPackerThreadEntry, thread) == 0);
+  if(!thread->started)
+    {
+      proc(data);
+    }
+}
+
+static void
+joinThread(PackerThread *thread)
+{
+  if(thread->started)
+    {
+      pthread_join(thread->handle, 0);
+    }
+}
+
 #else
 #  error unsupported OS
 #endif
@@ -404,21 +551,24 @@ loadBitmap(Arena *arena, String8 path, v2 alignment)
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_ONLY_PNG
 #include "stb_image.h"
+// NOTE: decodes a png that was read into memory, bottom row first. Returns 0 if the file isn't one
 static LoadedBitmap*
-loadPNG(Arena *arena, String8 path, v2 alignment)
+loadPNG(Arena *arena, Buffer file, v2 alignment)
 {
-  stbi_set_flip_vertically_on_load(1);
+  LoadedBitmap *result = 0;
 
   int width, height, nChannels;
-  u8 *data = stbi_load((char*)path.str, &width, &height, &nChannels, 4);
-  ASSERT(nChannels == 4);
+  u8 *data = stbi_load_from_memory(file.contents, (int)file.size, &width, &height, &nChannels, 4);
+  if(data)
+    {
+      result = arenaPushStruct(arena, LoadedBitmap);
+      result->width = width;
+      result->height = height;
+      result->stride = result->width * sizeof(u32);
+      result->pixels = (u32*)data;
+      result->alignPercentage = alignment;
+    }
 
-  LoadedBitmap *result = arenaPushStruct(arena, LoadedBitmap);
-  result->width = width;
-  result->height = height;
-  result->stride = result->width * sizeof(u32);
-  result->pixels = (u32*)data;
-  result->alignPercentage = alignment;
   return(result);
 }
 
@@ -433,7 +583,10 @@ writePNG(LoadedBitmap *image, String8 destPath)
   int height = image->height;
   int stride = image->stride;
   const void *data = (const void*)image->pixels;
-  int result = stbi_write_png((char*)destPath.str, width, height, 4, data, stride);
+  if(!stbi_write_png((char*)destPath.str, width, height, 4, data, stride))
+    {
+      fprintf(stderr, "ERROR: asset packer couldn't write %s\n", (char*)destPath.str);
+    }
 }
 
 static LoadedBitmap*
@@ -459,6 +612,21 @@ makeWhiteBitmap(Arena *arena, u32 width, u32 height)
   return(result);
 }
 
+// NOTE: stands in for an optional bitmap whose source is missing: one transparent pixel
+static LoadedBitmap*
+makeEmptyBitmap(Arena *arena, v2 alignment)
+{
+  LoadedBitmap *result = arenaPushStruct(arena, LoadedBitmap);
+  result->width = 1;
+  result->height = 1;
+  result->stride = sizeof(u32);
+  result->pixels = arenaPushArray(arena, 1, u32);
+  result->pixels[0] = 0;
+  result->alignPercentage = alignment;
+
+  return(result);
+}
+
 // ASSETS HELPERS
 struct LooseBitmap
 {
@@ -529,249 +697,510 @@ looseAssetPushBitmap(LooseAssets *looseAssets, LoadedBitmap *bitmap, char *fmt,
   return(result);
 }
 
-static LooseBitmap*
-looseAssetPushBitmap(LooseAssets *looseAssets, String8 path, String8 name, v2 alignment = V2(0, 0))
-{  
-  //LoadedBitmap *bitmap = loadBitmap(looseAssets->arena, path, alignment);
-  LoadedBitmap *bitmap = loadPNG(looseAssets->arena, path, alignment);
-  LooseBitmap *result = looseAssetPushBitmap(looseAssets, bitmap, name);
-  return(result);
-}
-
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 
-static void
-looseAssetPushFont(LooseAssets *looseAssets, String8 path, String8 name, RangeU32 cpRange, r32 ptSize)
+static LoadedBitmap*
+rasterizeGlyph(Arena *arena, stbtt_fontinfo *fontInfo, r32 fontScale, u32 codepoint, r32 *advance)
 {
-  TemporaryMemory scratch = arenaGetScratch(&looseAssets->arena, 1);
+  int width, height, xOffset, yOffset;
+  u8 *glyphSrc = stbtt_GetCodepointBitmap(fontInfo, 0, fontScale, codepoint,
+					  &width, &height, &xOffset, &yOffset);
+
+  int advanceWidth, leftSideBearing;
+  stbtt_GetCodepointHMetrics(fontInfo, codepoint, &advanceWidth, &leftSideBearing);
+  *advance = fontScale * (r32)advanceWidth;
+
+  LoadedBitmap *bitmap = arenaPushStruct(arena, LoadedBitmap);
+  bitmap->width = width;
+  bitmap->height = height;
+  bitmap->stride = bitmap->width * sizeof(u32);
+  bitmap->alignPercentage.x = 0.f;
+  bitmap->alignPercentage.y = height ? (r32)(height + yOffset)/(r32)height : 0.f;
+  bitmap->pixels = arenaPushArray(arena, bitmap->width * bitmap->height, u32);
+  {
+    u8 *srcRow = glyphSrc + width * (height - 1);
+    u8 *destRow = (u8*)bitmap->pixels;
+    for(int y = 0; y < height; ++y)
+      {
+	u8 *src = srcRow;
+	u32 *dest = (u32*)destRow;
+	for(int x = 0; x < width; ++x)
+	  {
+	    u8 alpha = *src++;
+	    *dest++ = ((alpha << 24) |
+		       (alpha << 16) |
+		       (alpha <<  8) |
+		       (alpha <<  0));
+	  }
+
+	srcRow -= width;
+	destRow += width * sizeof(u32);
+      }
+  }
+
+  stbtt_FreeBitmap(glyphSrc, 0);
+
+  return(bitmap);
+}
 
-  Buffer fontFile = readEntireFile(scratch.arena, path);
-  if(fontFile.contents)
+// ASSET SOURCES
+struct AssetSource
+{
+  String8 name;
+  String8 path;
+  v2 alignment;
+  b32 isOptional; // NOTE: packed as an empty bitmap, with a warning, if its file is missing
+
+  // NOTE: fonts
+  b32 isFont;
+  RangeU32 codepointRange;
+  r32 pixelHeight;
+
+  // NOTE: read
+  Buffer file;
+  u64 hash;
+
+  // NOTE: fonts, set up once they're read
+  stbtt_fontinfo fontInfo;
+  r32 fontScale;
+  r32 verticalAdvance;
+};
+
+#define ASSET_HASH_SEED 0xCBF29CE484222325ULL
+#define ASSET_HASH_PRIME 0x100000001B3ULL
+
+static u64
+assetHash(u64 hash, void *data, usz size)
+{
+  u8 *at = (u8*)data;
+  for(usz i = 0; i < size; ++i)
     {
-      stbtt_fontinfo stbFontInfo;
-      if(stbtt_InitFont(&stbFontInfo, fontFile.contents, stbtt_GetFontOffsetForIndex(fontFile.contents, 0)))
-	{
-	  int ascent, descent, lineGap;
-	  stbtt_GetFontVMetrics(&stbFontInfo, &ascent, &descent, &lineGap);
-
-	  r32 fontScale = stbtt_ScaleForPixelHeight(&stbFontInfo, ptSize);
-
-	  for(u32 charIdx = cpRange.min; charIdx < cpRange.max; ++charIdx)
-	    {	      
-	      int width, height, xOffset, yOffset;
-	      u8 *glyphSrc = stbtt_GetCodepointBitmap(&stbFontInfo, 0, fontScale, charIdx,
-						      &width, &height, &xOffset, &yOffset);
-
-	      int advanceWidth, leftSideBearing;
-	      stbtt_GetCodepointHMetrics(&stbFontInfo, charIdx, &advanceWidth, &leftSideBearing);
-
-	      LoadedBitmap *bitmap = arenaPushStruct(looseAssets->arena, LoadedBitmap);	      
-	      bitmap->width = width;
-	      bitmap->height = height;
-	      bitmap->stride = bitmap->width * sizeof(u32);
-	      bitmap->alignPercentage.x = 0.f;
-	      bitmap->alignPercentage.y = height ? (r32)(height + yOffset)/(r32)height : 0.f;
-	      bitmap->pixels = arenaPushArray(looseAssets->arena, bitmap->width * bitmap->height, u32);
-	      {
-		u8 *srcRow = glyphSrc + width * (height - 1);
-		u8 *destRow = (u8*)bitmap->pixels;
-		for(int y = 0; y < height; ++y)
-		  {
-		    u8 *src = srcRow;
-		    u32 *dest = (u32*)destRow;
-		    for(int x = 0; x < width; ++x)
-		      {
-			u8 alpha = *src++;
-			*dest++ = ((alpha << 24) |
-				   (alpha << 16) |
-				   (alpha <<  8) |
-				   (alpha <<  0));
-		      }
-		    
-		    srcRow -= width;
-		    destRow += width * sizeof(u32);
-		  }
-	      }
+      hash = (hash ^ *at++)*ASSET_HASH_PRIME;
+    }
 
-	      LooseBitmap *looseBitmap =
-		looseAssetPushBitmap(looseAssets, bitmap, "%.*s_%u",
-				     (int)name.size, name.str, charIdx);
-	      looseBitmap->advance = fontScale * (r32)advanceWidth;
+  return(hash);
+}
 
-	      stbtt_FreeBitmap(glyphSrc, 0);
-	    }
+// NOTE: a source's hash covers its file and everything the packer is told about it, so a source
+//       whose alignment or font size changed counts as changed too
+static u64
+assetSourceHash(AssetSource *source)
+{
+  u64 hash = ASSET_HASH_SEED;
+  hash = assetHash(hash, source->name.str, source->name.size);
+  hash = assetHash(hash, source->file.contents, source->file.size);
+  hash = assetHash(hash, &source->alignment, sizeof(source->alignment));
+  hash = assetHash(hash, &source->isFont, sizeof(source->isFont));
+  hash = assetHash(hash, &source->codepointRange, sizeof(source->codepointRange));
+  hash = assetHash(hash, &source->pixelHeight, sizeof(source->pixelHeight));
+
+  return(hash);
+}
 
-	  LooseFont *looseFont = arenaPushStruct(looseAssets->arena, LooseFont);
-	  looseFont->verticalAdvance = fontScale * (r32)(ascent - descent + lineGap);
-	  looseFont->name = arenaPushString(looseAssets->arena, name);
-	  looseFont->range = cpRange;
-	  QUEUE_PUSH(looseAssets->firstFont, looseAssets->lastFont, looseFont);
-	  ++looseAssets->fontCount;
-	}
+// ASSET JOBS
+// NOTE: sources are read, and bitmaps decoded and glyphs rasterized, by the main thread and up to
+//       ASSET_PACKER_MAX_THREAD_COUNT - 1 workers, taking jobs in order. Each thread allocates from
+//       its own arena, and the results are gathered in job order, so the output doesn't depend on
+//       which thread ran what
+#define ASSET_PACKER_MAX_THREAD_COUNT 16
+
+enum AssetJobKind
+{
+  AssetJob_readSource,
+  AssetJob_decodeBitmap,
+  AssetJob_rasterizeGlyph,
+};
+
+struct AssetJob
+{
+  AssetJobKind kind;
+  AssetSource *source;
+  u32 codepoint;
+
+  // NOTE: results
+  LoadedBitmap *bitmap;
+  r32 advance;
+};
+
+struct AssetJobQueue
+{
+  AssetJob *jobs;
+  u32 jobCount;
+  volatile u32 nextJobIndex;
+};
+
+struct AssetJobWorker
+{
+  AssetJobQueue *queue;
+  Arena *arena;
+  PackerThread thread;
+};
+
+static void
+runAssetJob(AssetJob *job, Arena *arena)
+{
+  AssetSource *source = job->source;
+  switch(job->kind)
+    {
+    case AssetJob_readSource:
+      {
+	source->file = readEntireFile(arena, source->path);
+	source->hash = assetSourceHash(source);
+      } break;
+
+    case AssetJob_decodeBitmap:
+      {
+	if(source->file.contents)
+	  {
+	    job->bitmap = loadPNG(arena, source->file, source->alignment);
+	  }
+	else
+	  {
+	    job->bitmap = makeEmptyBitmap(arena, source->alignment);
+	  }
+      } break;
+
+    case AssetJob_rasterizeGlyph:
+      {
+	job->bitmap = rasterizeGlyph(arena, &source->fontInfo, source->fontScale, job->codepoint,
+				     &job->advance);
+      } break;
     }
+}
 
-  arenaReleaseScratch(scratch);
+static void
+assetJobWorkerProc(void *data)
+{
+  AssetJobWorker *worker = (AssetJobWorker*)data;
+  AssetJobQueue *queue = worker->queue;
+  for(u32 jobIndex = atomicIncrement(&queue->nextJobIndex);
+      jobIndex < queue->jobCount;
+      jobIndex = atomicIncrement(&queue->nextJobIndex))
+    {
+      runAssetJob(queue->jobs + jobIndex, worker->arena);
+    }
 }
 
-struct AtlasRegionNode
+static void
+runAssetJobs(AssetJob *jobs, u32 jobCount, Arena **threadArenas, u32 threadCount)
 {
-  AtlasRegionNode *parent;
-  AtlasRegionNode *children[Corner_Count];  
-  v2s32 maxFreeDim[Corner_Count];
-  // AtlasRegionNode *children[Axis2D_Count];
-  // v2s32 maxFreeDim[Axis2D_Count];
+  AssetJobQueue queue = {};
+  queue.jobs = jobs;
+  queue.jobCount = jobCount;
+
+  AssetJobWorker workers[ASSET_PACKER_MAX_THREAD_COUNT] = {};
+  u32 workerCount = MIN(threadCount, MAX(jobCount, 1));
+  for(u32 workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+    {
+      workers[workerIndex].queue = &queue;
+      workers[workerIndex].arena = threadArenas[workerIndex];
+    }
+  for(u32 workerIndex = 1; workerIndex < workerCount; ++workerIndex)
+    {
+      startThread(&workers[workerIndex].thread, assetJobWorkerProc, workers + workerIndex);
+    }
+
+  assetJobWorkerProc(workers);
 
-  Axis2D splitAxis;
-  b32 taken;
-  u32 allocatedDescendantCount;
+  for(u32 workerIndex = 1; workerIndex < workerCount; ++workerIndex)
+    {
+      joinThread(&workers[workerIndex].thread);
+    }
+}
+
+// ASSET MANIFEST
+// NOTE: the hashes of the sources the last run packed. When none changed, the packer's version is
+//       the same, and both outputs are still there, there's nothing to do. The manifest is written
+//       after the outputs, so a run that stopped partway is done again
+#define ASSET_MANIFEST_MAGIC FOURCC("GSAM")
+#define ASSET_MANIFEST_VERSION 1 // NOTE: bump when the output changes for the same sources, eg the packer
+#define ASSET_MANIFEST_MAX_SOURCE_COUNT 64
+
+struct AssetManifest
+{
+  u32 magic;
+  u32 version;
+  u32 sourceCount;
+  u32 reserved;
+  u64 sourceHashes[ASSET_MANIFEST_MAX_SOURCE_COUNT];
 };
 
-struct Atlas
+// ATLAS PACKING
+// NOTE: a MaxRects packer. The free space is kept as all of its maximal rectangles, which overlap.
+//       A bitmap goes where its top edge ends up lowest, then leftmost. Every free rectangle it
+//       covers is split into the up to four pieces around it, and pieces inside other free
+//       rectangles are dropped
+struct MaxRectsPacker
 {
-  AtlasRegionNode *root;
-  v2s32 rootDim;
+  Arena *arena;
+  s32 usedHeight;
+
+  Rect2S32 *freeRects;
+  u32 freeRectCount;
+  u32 freeRectCapacity;
+
+  Rect2S32 *pieces;
+  u32 pieceCount;
+  u32 pieceCapacity;
 };
 
-#if 0
-static Rect2S32
-atlasRegionAlloc(Arena *arena, Atlas *atlas, v2s32 neededDim)
+static inline b32
+rectContains(Rect2S32 outer, Rect2S32 inner)
 {
-  v2s32 regionMin = V2S32(0, 0);
-  v2s32 regionDim = V2S32(0, 0);
-  
-  // NOTE: find node to insert into
-  AtlasRegionNode *node = 0;
-  for(AtlasReginoNode *n = atlas->root, *next = 0; n; n = next, next = 0)
+  b32 result = (outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+		outer.max.x >= inner.max.x && outer.max.y >= inner.max.y);
+  return(result);
+}
+
+static inline b32
+rectsOverlap(Rect2S32 a, Rect2S32 b)
+{
+  b32 result = (a.min.x < b.max.x && b.min.x < a.max.x &&
+		a.min.y < b.max.y && b.min.y < a.max.y);
+  return(result);
+}
+
+static inline void
+packerPushRect(Arena *arena, Rect2S32 **rects, u32 *count, u32 *capacity, Rect2S32 rect)
+{
+  if(*count == *capacity)
     {
-      v2s32 availableDim = n->dim;
-      for(Corner corner = (Corner)0; corner < Corner_Count; corner = (Corner)(corner + 1))
+      u32 newCapacity = MAX(2*(*capacity), 64);
+      Rect2S32 *newRects = arenaPushArray(arena, newCapacity, Rect2S32);
+      COPY_ARRAY(newRects, *rects, *count, Rect2S32);
+      *rects = newRects;
+      *capacity = newCapacity;
+    }
+  (*rects)[(*count)++] = rect;
+}
+
+static void
+maxRectsBegin(MaxRectsPacker *packer, Arena *arena, v2s32 dim)
+{
+  ZERO_STRUCT(packer);
+  packer->arena = arena;
+
+  Rect2S32 atlasRect = {V2S32(0, 0), dim};
+  packerPushRect(arena, &packer->freeRects, &packer->freeRectCount, &packer->freeRectCapacity,
+		 atlasRect);
+}
+
+static b32
+maxRectsInsert(MaxRectsPacker *packer, v2s32 dim, v2s32 *position)
+{
+  s32 bestTop = S32_MAX;
+  s32 bestLeft = S32_MAX;
+  for(u32 rectIndex = 0; rectIndex < packer->freeRectCount; ++rectIndex)
+    {
+      Rect2S32 freeRect = packer->freeRects[rectIndex];
+      v2s32 freeDim = getDim(freeRect);
+      if(freeDim.x >= dim.x && freeDim.y >= dim.y)
 	{
-	  if(!n->children[corner])
+	  s32 top = freeRect.min.y + dim.y;
+	  if(top < bestTop || (top == bestTop && freeRect.min.x < bestLeft))
 	    {
-	      n->children[corner] = arenaPushStruct(arena, AtlasRegionNode);
-	      n->children[corner]->dim = neededDim;
-	      n->children[corner]->parent = n;
+	      bestTop = top;
+	      bestLeft = freeRect.min.x;
 	    }
 	}
     }
-  
-  Rect2S32 result = {};
-  result.min = regionMin;
-  result.max = regionMin + regionDim;
-  return(result);
-}
-#else
-static Rect2S32
-atlasRegionAlloc(Arena *arena, Atlas *atlas, v2s32 neededDim)
-{
-  v2s32 regionMin = V2S32(0, 0);
-  v2s32 regionDim = V2S32(0, 0);
-  v2s32 supportedDim = atlas->rootDim;
-  Corner nodeCorner = Corner_invalid;
-  AtlasRegionNode *node = 0;
-  for(AtlasRegionNode *n = atlas->root, *next = 0; n; n = next, next = 0)
-    {
-      if(n->taken) break;
-
-      b32 canBeAllocated = (n->allocatedDescendantCount == 0);
-      if(canBeAllocated) regionDim = supportedDim;
 
-      v2s32 childDim = supportedDim / 2;
-      AtlasRegionNode *bestChild = 0;
-      if(childDim.x >= neededDim.x && childDim.y >= neededDim.y)
+  b32 result = (bestTop != S32_MAX);
+  if(result)
+    {
+      Rect2S32 placed = {V2S32(bestLeft, bestTop - dim.y), V2S32(bestLeft + dim.x, bestTop)};
+      *position = placed.min;
+      packer->usedHeight = MAX(packer->usedHeight, placed.max.y);
+
+      // NOTE: split what the bitmap covers
+      u32 keptCount = 0;
+      packer->pieceCount = 0;
+      for(u32 rectIndex = 0; rectIndex < packer->freeRectCount; ++rectIndex)
 	{
-	  for(Corner corner = (Corner)0; corner < Corner_Count; corner = (Corner)(corner + 1))
+	  Rect2S32 freeRect = packer->freeRects[rectIndex];
+	  if(rectsOverlap(freeRect, placed))
 	    {
-	      if(n->children[corner] == 0)
+	      Rect2S32 piece[4] = {freeRect, freeRect, freeRect, freeRect};
+	      piece[0].max.x = placed.min.x;
+	      piece[1].min.x = placed.max.x;
+	      piece[2].max.y = placed.min.y;
+	      piece[3].min.y = placed.max.y;
+	      for(u32 pieceIndex = 0; pieceIndex < ARRAY_COUNT(piece); ++pieceIndex)
 		{
-		  n->children[corner] = arenaPushStruct(arena, AtlasRegionNode);
-		  n->children[corner]->parent = n;
-		  n->children[corner]->maxFreeDim[0] =
-		    n->children[corner]->maxFreeDim[1] =
-		    n->children[corner]->maxFreeDim[2] =
-		    n->children[corner]->maxFreeDim[3] = childDim / 2;
-		}
-	      if(n->maxFreeDim[corner].x >= neededDim.x && n->maxFreeDim[corner].y >= neededDim.y)
-		{
-		  bestChild = n->children[corner];
-		  nodeCorner = corner;
-		  regionMin += hadamard(vertexFromCorner(corner), childDim);
-		  break;
+		  v2s32 pieceDim = getDim(piece[pieceIndex]);
+		  if(pieceDim.x > 0 && pieceDim.y > 0)
+		    {
+		      packerPushRect(packer->arena, &packer->pieces, &packer->pieceCount,
+				     &packer->pieceCapacity, piece[pieceIndex]);
+		    }
 		}
 	    }
+	  else
+	    {
+	      packer->freeRects[keptCount++] = freeRect;
+	    }
 	}
+      packer->freeRectCount = keptCount;
 
-      if(canBeAllocated && !bestChild)
+      // NOTE: a piece is part of a maximal rectangle from before, so no rectangle that was kept can
+      //       be inside it. Of pieces that are the same, the first one stays
+      for(u32 pieceIndex = 0; pieceIndex < packer->pieceCount; ++pieceIndex)
 	{
-	  node = n;
-	}
-      else
-	{
-	  next = bestChild;
-	  supportedDim = childDim;
+	  Rect2S32 piece = packer->pieces[pieceIndex];
+	  b32 isContained = false;
+	  for(u32 rectIndex = 0; !isContained && rectIndex < keptCount; ++rectIndex)
+	    {
+	      isContained = rectContains(packer->freeRects[rectIndex], piece);
+	    }
+	  for(u32 otherIndex = 0; !isContained && otherIndex < packer->pieceCount; ++otherIndex)
+	    {
+	      Rect2S32 other = packer->pieces[otherIndex];
+	      if(otherIndex != pieceIndex && rectContains(other, piece))
+		{
+		  isContained = (otherIndex < pieceIndex || !rectContains(piece, other));
+		}
+	    }
+
+	  if(!isContained)
+	    {
+	      packerPushRect(packer->arena, &packer->freeRects, &packer->freeRectCount,
+			     &packer->freeRectCapacity, piece);
+	    }
 	}
     }
 
-  if(node != 0 && nodeCorner != Corner_invalid)
+  return(result);
+}
+
+enum PackOrder
+{
+  PackOrder_height,
+  PackOrder_area,
+  PackOrder_maxSide,
+  PackOrder_Count,
+};
+
+static s64
+packOrderKey(PackOrder order, v2s32 dim)
+{
+  s64 result = 0;
+  switch(order)
+    {
+    case PackOrder_height:  result = ((s64)dim.y << 32) | dim.x; break;
+    case PackOrder_area:    result = (s64)dim.x*(s64)dim.y; break;
+    case PackOrder_maxSide: result = ((s64)MAX(dim.x, dim.y) << 32) | MIN(dim.x, dim.y); break;
+    default: break;
+    }
+
+  return(result);
+}
+
+struct AtlasLayout
+{
+  v2s32 dim;
+  v2s32 *positions;
+};
+
+// NOTE: packs bitmaps of the given dims (gutters included) into as small an atlas as it finds. The
+//       atlas is at least as wide as the widest bitmap, and as tall as the bitmaps packed into its
+//       width reach. Widths up to twice the square root of the bitmaps' total area are tried, with
+//       the bitmaps sorted a few ways, and the smallest atlas is kept
+#define ATLAS_WIDTH_CANDIDATE_COUNT 48
+
+static AtlasLayout
+packAtlas(Arena *arena, v2s32 *dims, u32 count)
+{
+  AtlasLayout result = {};
+  result.positions = arenaPushArray(arena, count, v2s32);
+
+  s64 totalArea = 0;
+  s32 maxWidth = 1;
+  s32 totalHeight = 0;
+  for(u32 index = 0; index < count; ++index)
+    {
+      totalArea += (s64)dims[index].x*(s64)dims[index].y;
+      maxWidth = MAX(maxWidth, dims[index].x);
+      totalHeight += dims[index].y;
+    }
+  s32 widestCandidate = MAX(maxWidth, (s32)(2.f*gsSqrt((r32)totalArea)));
+
+  TemporaryMemory scratch = arenaGetScratch(&arena, 1);
+  u32 *order = arenaPushArray(scratch.arena, count, u32);
+  v2s32 *positions = arenaPushArray(scratch.arena, count, v2s32);
+  s64 bestArea = S64_MAX;
+  for(PackOrder packOrder = (PackOrder)0; packOrder < PackOrder_Count;
+      packOrder = (PackOrder)(packOrder + 1))
     {
-      node->taken = 1;
-      if(node->parent)
+      // NOTE: largest first, and in source order among equals
+      for(u32 index = 0; index < count; ++index)
 	{
-	  node->parent->maxFreeDim[nodeCorner] = V2S32(0, 0);
+	  u32 insertIndex = index;
+	  s64 key = packOrderKey(packOrder, dims[index]);
+	  for(; insertIndex > 0 && packOrderKey(packOrder, dims[order[insertIndex - 1]]) < key;
+	      --insertIndex)
+	    {
+	      order[insertIndex] = order[insertIndex - 1];
+	    }
+	  order[insertIndex] = index;
 	}
-      for(AtlasRegionNode *p = node->parent; p; p = p->parent)
+
+      for(u32 candidateIndex = 0; candidateIndex < ATLAS_WIDTH_CANDIDATE_COUNT; ++candidateIndex)
 	{
-	  ++p->allocatedDescendantCount;
-	  
-	  AtlasRegionNode *parent = p->parent;
-	  if(parent)
+	  s32 width = maxWidth + (s32)((s64)(widestCandidate - maxWidth)*candidateIndex/
+				       (ATLAS_WIDTH_CANDIDATE_COUNT - 1));
+
+	  TemporaryMemory packMemory = arenaBeginTemporaryMemory(scratch.arena);
+	  MaxRectsPacker packer;
+	  maxRectsBegin(&packer, scratch.arena, V2S32(width, totalHeight));
+	  b32 packed = true;
+	  for(u32 orderIndex = 0; packed && orderIndex < count; ++orderIndex)
+	    {
+	      u32 index = order[orderIndex];
+	      packed = maxRectsInsert(&packer, dims[index], positions + index);
+	    }
+	  arenaEndTemporaryMemory(packMemory);
+
+	  s64 area = (s64)width*(s64)packer.usedHeight;
+	  if(packed && area < bestArea)
 	    {
-	      Corner pCorner = (p == parent->children[Corner_00] ? Corner_00 :
-				p == parent->children[Corner_01] ? Corner_01 :
-				p == parent->children[Corner_10] ? Corner_10 :
-				p == parent->children[Corner_11] ? Corner_11 :
-				Corner_invalid);
-	      ASSERT(pCorner != Corner_invalid);
-
-	      parent->maxFreeDim[pCorner].x = MAX(MAX(p->maxFreeDim[Corner_00].x,
-						      p->maxFreeDim[Corner_01].x),
-						  MAX(p->maxFreeDim[Corner_10].x,
-						      p->maxFreeDim[Corner_11].x));
-	      parent->maxFreeDim[pCorner].y = MAX(MAX(p->maxFreeDim[Corner_00].y,
-						      p->maxFreeDim[Corner_01].y),
-						  MAX(p->maxFreeDim[Corner_10].y,
-						      p->maxFreeDim[Corner_11].y));
+	      bestArea = area;
+	      result.dim = V2S32(width, packer.usedHeight);
+	      COPY_ARRAY(result.positions, positions, count, v2s32);
 	    }
 	}
     }
+  arenaReleaseScratch(scratch);
 
-  Rect2S32 result = {};
-  result.min = regionMin;
-  result.max = regionMin + regionDim;
   return(result);
 }
-#endif
 
+// NOTE: the editor skin isn't kept in the repository. Checkouts without it still build, with a
+//       blank skin
 #define BITMAP_XLIST\
-  X(editorSkin, "PNG/TREE.png", V2(0, 0))\
-  X(grainViewBackground, "PNG/GREENFRAME_RECTANGLE.png", V2(0, 0))\
-  X(grainViewOutline, "PNG/GREENFRAME.png", V2(0, 0))\
-  X(levelBar, "PNG/LEVELBAR.png", V2(0, 0))\
-  X(levelFader, "PNG/LEVELBAR_SLIDINGLEVER.png", V2(0, -0.416f))\
-  X(pomegranateKnob, "PNG/POMEGRANATE_BUTTON.png", V2(0, -0.03f))\
-  X(pomegranateKnobLabel, "PNG/POMEGRANATE_BUTTON_WHITEMARKERS.png", V2(0, 0))\
-  X(halfPomegranateKnob, "PNG/HALFPOMEGRANATE_BUTTON.png", V2(-0.005f, -0.035f))\
-  X(halfPomegranateKnobLabel, "PNG/HALFPOMEGRANATE_BUTTON_WHITEMARKERS.png", V2(0, 0))\
-  X(densityKnob, "PNG/DENSITYPOMEGRANATE_BUTTON.png", V2(0.01f, -0.022f))\
-  X(densityKnobShadow, "PNG/DENSITYPOMEGRANATE_BUTTON_SHADOW.png", V2(0, 0))\
-  X(densityKnobLabel, "PNG/DENSITYPOMEGRANATE_BUTTON_WHITEMARKERS.png", V2(0, 0))
+  X(editorSkin, "PNG/TREE.png", V2(0, 0), true)\
+  X(grainViewBackground, "PNG/GREENFRAME_RECTANGLE.png", V2(0, 0), false)\
+  X(grainViewOutline, "PNG/GREENFRAME.png", V2(0, 0), false)\
+  X(levelBar, "PNG/LEVELBAR.png", V2(0, 0), false)\
+  X(levelFader, "PNG/LEVELBAR_SLIDINGLEVER.png", V2(0, -0.416f), false)\
+  X(pomegranateKnob, "PNG/POMEGRANATE_BUTTON.png", V2(0, -0.03f), false)\
+  X(pomegranateKnobLabel, "PNG/POMEGRANATE_BUTTON_WHITEMARKERS.png", V2(0, 0), false)\
+  X(halfPomegranateKnob, "PNG/HALFPOMEGRANATE_BUTTON.png", V2(-0.005f, -0.035f), false)\
+  X(halfPomegranateKnobLabel, "PNG/HALFPOMEGRANATE_BUTTON_WHITEMARKERS.png", V2(0, 0), false)\
+  X(densityKnob, "PNG/DENSITYPOMEGRANATE_BUTTON.png", V2(0.01f, -0.022f), false)\
+  X(densityKnobShadow, "PNG/DENSITYPOMEGRANATE_BUTTON_SHADOW.png", V2(0, 0), false)\
+  X(densityKnobLabel, "PNG/DENSITYPOMEGRANATE_BUTTON_WHITEMARKERS.png", V2(0, 0), false)
   
 int
 main(int argc, char **argv)
 {
+  UNUSED(argc);
+  UNUSED(argv);
+
   TemporaryMemory scratch = arenaGetScratch(0, 0);
 
+  u64 startTime = readTimerMicroseconds();
+
   Arena *arena = gsArenaAcquire(MEGABYTES(256));
   LooseAssets *looseAssets = arenaPushStruct(arena, LooseAssets);
   looseAssets->arena = arena;
@@ -779,205 +1208,199 @@ main(int argc, char **argv)
 #define DATA_PATH "../data/"
 #define SRC_PATH "../src/"
 
-  String8List pluginAssetXList = {0};
-  stringListPush(looseAssets->arena, &pluginAssetXList,
-		 STR8_LIT("#define PLUGIN_ASSET_XLIST\\\n"));
+  String8 generatedCodePath = STR8_LIT(SRC_PATH"plugin_assets.generated.h");
+  String8 atlasPath = STR8_LIT(DATA_PATH"test_atlas.png");
+  String8 manifestPath = STR8_LIT(DATA_PATH"test_atlas.manifest");
 
-  LoadedBitmap *whiteBitmap = makeWhiteBitmap(looseAssets->arena, 16, 16);  
-  stringListPush(looseAssets->arena, &pluginAssetXList, STR8_LIT("  X(null)\\\n"));
-
-#define X(name, path, alignment)							\
-  looseAssetPushBitmap(looseAssets, STR8_LIT(DATA_PATH path), STR8_LIT(#name), alignment); \
-  stringListPushFormat(looseAssets->arena, &pluginAssetXList, "  X(%s)\\\n", #name);
-  BITMAP_XLIST;
+#define X(name, path, alignment, isOptional) + 1
+  AssetSource sources[0 BITMAP_XLIST] = {};
 #undef X
-
-  looseAssetPushBitmap(looseAssets, whiteBitmap, STR8_LIT("null"));
-
-  RangeU32 cpRange = {32, 127};
-  r32 ptSize = 32.f;
-  looseAssetPushFont(looseAssets, STR8_LIT(DATA_PATH"FONT/AGENCYB.ttf"),
-		     STR8_LIT("AgencyBold"), cpRange, ptSize);
-
-  // NOTE: compute positions in the atlas
-  // s32 atlasWidth = 8656;//7696;//8704;//7688;
-  // s32 atlasHeight = 4328;
-  s32 atlasWidth = 3842;
-  s32 atlasHeight = 4362;
-#if 0
-  Atlas *atlas = arenaPushStruct(arena, Atlas);
-  atlas->rootDim = V2S32(atlasWidth, atlasHeight);
-  atlas->root = arenaPushStruct(arena, AtlasRegionNode);
-  atlas->root->maxFreeDim[Corner_00] =
-    atlas->root->maxFreeDim[Corner_01] =
-    atlas->root->maxFreeDim[Corner_10] =
-    atlas->root->maxFreeDim[Corner_11] = atlas->rootDim / 2;
-  for(LooseBitmap *bitmap = looseAssets->firstBitmap; bitmap; bitmap = bitmap->next)
+  {
+    AssetSource *source = sources;
+#define X(name_, path_, alignment_, isOptional_)	\
+    source->name = STR8_LIT(#name_);			\
+    source->path = STR8_LIT(DATA_PATH path_);		\
+    source->alignment = alignment_;			\
+    source->isOptional = isOptional_;			\
+    ++source;
+    BITMAP_XLIST
+#undef X
+  }
+  AssetSource fontSource = {};
+  fontSource.name = STR8_LIT("AgencyBold");
+  fontSource.path = STR8_LIT(DATA_PATH"FONT/AGENCYB.ttf");
+  fontSource.isFont = true;
+  fontSource.codepointRange = {32, 127};
+  fontSource.pixelHeight = 32.f;
+
+  AssetSource *allSources[ARRAY_COUNT(sources) + 1];
+  u32 sourceCount = 0;
+  for(u32 sourceIndex = 0; sourceIndex < ARRAY_COUNT(sources); ++sourceIndex)
     {
-      v2s32 bitmapDim = V2S32(bitmap->bitmap->width, bitmap->bitmap->height);
-      Rect2S32 region = atlasRegionAlloc(arena, atlas, bitmapDim + V2S32(1, 1));
-      bitmap->atlasOffsetX = region.min.x;
-      bitmap->atlasOffsetY = region.min.y;
+      allSources[sourceCount++] = sources + sourceIndex;
     }
+  allSources[sourceCount++] = &fontSource;
+  ASSERT(sourceCount <= ASSET_MANIFEST_MAX_SOURCE_COUNT);
 
-#else
-#  if 1
-
-  struct RegionNode
-  {
-    RegionNode *next;
-    Rect2S32 rect;
-  };
-
-  struct PackAtlas
-  {
-    Arena *arena;
-    RegionNode *first;
-    RegionNode *last;
-
-    RegionNode *firstFree;
-    RegionNode *lastFree;
-    
-    v2s32 dim;
-  };
-
-  Arena *packArena = gsArenaAcquire(MEGABYTES(1));
-  PackAtlas *packAtlas = arenaPushStruct(packArena, PackAtlas);
-  packAtlas->arena = packArena;
-  packAtlas->dim = V2S32(atlasWidth, atlasHeight);
-  
-  RegionNode *atlasRegionNode = arenaPushStruct(packArena, RegionNode);
-  atlasRegionNode->rect.min = V2S32(0, 0);
-  atlasRegionNode->rect.max = packAtlas->dim;
-  QUEUE_PUSH(packAtlas->firstFree, packAtlas->lastFree, atlasRegionNode);
-
-  s32 minDimX = 16;
-  s32 minDimY = 16;
+  u32 threadCount = MIN(MAX(getProcessorCount(), 1), ASSET_PACKER_MAX_THREAD_COUNT);
+  Arena *threadArenas[ASSET_PACKER_MAX_THREAD_COUNT] = {};
+  for(u32 threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+      threadArenas[threadIndex] = gsArenaAcquire(MEGABYTES(1));
+    }
 
-  for(LooseBitmap *bitmap = looseAssets->firstBitmap; bitmap; bitmap = bitmap->next)
+  // NOTE: read and hash every source, and stop if none changed since the last run
+  AssetJob *readJobs = arenaPushArray(arena, sourceCount, AssetJob);
+  for(u32 sourceIndex = 0; sourceIndex < sourceCount; ++sourceIndex)
     {
-      v2s32 insertDim = V2S32(bitmap->bitmap->width + 1, bitmap->bitmap->height + 1);
+      readJobs[sourceIndex].kind = AssetJob_readSource;
+      readJobs[sourceIndex].source = allSources[sourceIndex];
+    }
+  runAssetJobs(readJobs, sourceCount, threadArenas, threadCount);
 
-      v2s32 insertPos = V2S32(-1, -1);
-      b32 inserted = 0;
-      while(!inserted)
+  b32 sourcesAreRead = true;
+  for(u32 sourceIndex = 0; sourceIndex < sourceCount; ++sourceIndex)
+    {
+      AssetSource *source = allSources[sourceIndex];
+      if(!source->file.contents)
 	{
-	  RegionNode *freeRegion = packAtlas->firstFree;	  
-	  ASSERT(freeRegion);
-	  QUEUE_POP(packAtlas->firstFree, packAtlas->lastFree);
-	  v2s32 freeRegionDim = getDim(freeRegion->rect);
-
-	  if(freeRegionDim.x >= insertDim.x && freeRegionDim.y >= insertDim.y)
+	  if(source->isOptional)
 	    {
-	      RegionNode *newRegion = freeRegion;
-	      newRegion->rect.max = newRegion->rect.min + insertDim;
-	      insertPos = newRegion->rect.min;
-	      QUEUE_PUSH(packAtlas->first, packAtlas->last, newRegion);
-
-	      v2s32 bottomRightDim = V2S32(freeRegionDim.x - insertDim.x, insertDim.y);
-	      if(bottomRightDim.x >= minDimX && bottomRightDim.y >= minDimY)
-		{
-		  RegionNode *bottomRightFree = arenaPushStruct(packAtlas->arena, RegionNode);
-		  bottomRightFree->rect.min = freeRegion->rect.min + V2S32(insertDim.x, 0);
-		  bottomRightFree->rect.max = bottomRightFree->rect.min + bottomRightDim;
-		  QUEUE_PUSH(packAtlas->firstFree, packAtlas->lastFree, bottomRightFree);
-		}
-
-	      v2s32 topLeftDim = V2S32(insertDim.x, freeRegionDim.y - insertDim.y);
-	      if(topLeftDim.x >= insertDim.x && topLeftDim.y >= insertDim.y)
-		{
-		  RegionNode *topLeftFree = arenaPushStruct(packAtlas->arena, RegionNode);
-		  topLeftFree->rect.min = freeRegion->rect.min + V2S32(0, insertDim.y);
-		  topLeftFree->rect.max = topLeftFree->rect.min + topLeftDim;
-		  QUEUE_PUSH(packAtlas->firstFree, packAtlas->lastFree, topLeftFree);
-		}
-
-	      v2s32 topRightDim = freeRegionDim - insertDim;
-	      if(topRightDim.x >= minDimX && topRightDim.y >= minDimY)
-		{
-		  RegionNode *topRightFree = arenaPushStruct(packAtlas->arena, RegionNode);
-		  topRightFree->rect.min = freeRegion->rect.min + insertDim;
-		  topRightFree->rect.max = topRightFree->rect.min + topRightDim;	      	      
-		  QUEUE_PUSH(packAtlas->firstFree, packAtlas->lastFree, topRightFree);
-		}
-	      
-	      inserted = 1;
+	      fprintf(stderr, "WARNING: asset packer couldn't read %s, packing it empty\n",
+		      (char*)source->path.str);
 	    }
 	  else
 	    {
-	      QUEUE_PUSH(packAtlas->firstFree, packAtlas->lastFree, freeRegion);
+	      fprintf(stderr, "ERROR: asset packer couldn't read %s\n", (char*)source->path.str);
+	      sourcesAreRead = false;
 	    }
 	}
-
-      bitmap->atlasOffsetX = insertPos.x;
-      bitmap->atlasOffsetY = insertPos.y;
     }
-    
-#  else
-  s32 layoutX = 0;
-  s32 layoutY = 0;
-  s32 rowMaxHeight = 0;
-  s32 spaceX = 0;
-  u32 growCount = 0;
-  u32 maxGrowCount = 10;
-  for(LooseBitmap *bitmap = looseAssets->firstBitmap; bitmap; bitmap = bitmap->next)
+  if(!sourcesAreRead)
     {
-      b32 inserted = 0;
-      while(!inserted)
+      return(1);
+    }
+
+  u32 changedSourceCount = sourceCount;
+  Buffer manifestFile = readEntireFile(scratch.arena, manifestPath);
+  AssetManifest *lastManifest = (AssetManifest*)manifestFile.contents;
+  if(manifestFile.size == sizeof(AssetManifest) &&
+     lastManifest->magic == ASSET_MANIFEST_MAGIC &&
+     lastManifest->version == ASSET_MANIFEST_VERSION &&
+     lastManifest->sourceCount == sourceCount)
+    {
+      changedSourceCount = 0;
+      for(u32 sourceIndex = 0; sourceIndex < sourceCount; ++sourceIndex)
 	{
-	  ASSERT(growCount <= maxGrowCount);
+	  changedSourceCount += (lastManifest->sourceHashes[sourceIndex] != allSources[sourceIndex]->hash);
+	}
+    }
+  if(changedSourceCount == 0 && fileExists(atlasPath) && fileExists(generatedCodePath))
+    {
+      printf("asset packer: %u sources unchanged, nothing to do (%.1f ms)\n", sourceCount,
+	     (r32)(readTimerMicroseconds() - startTime)/1000.f);
+      return(0);
+    }
 
-	  s32 maxX = layoutX + bitmap->bitmap->width + 1;
-	  s32 maxY = layoutY + bitmap->bitmap->height + 1;
-	  b32 fits = (maxX <= atlasWidth && maxY <= atlasHeight);
-	  if(fits)
-	    {
-	      bitmap->atlasOffsetX = layoutX;
-	      bitmap->atlasOffsetY = layoutY;
+  // NOTE: decode bitmaps and rasterize glyphs
+  stbi_set_flip_vertically_on_load(1);
 
-	      layoutX += bitmap->bitmap->width + 1;
-	      rowMaxHeight = MAX(rowMaxHeight, (s32)(bitmap->bitmap->height + 1));
+  stbtt_fontinfo *fontInfo = &fontSource.fontInfo;
+  if(!stbtt_InitFont(fontInfo, fontSource.file.contents,
+		     stbtt_GetFontOffsetForIndex(fontSource.file.contents, 0)))
+    {
+      fprintf(stderr, "ERROR: asset packer couldn't load font %s\n", (char*)fontSource.path.str);
+      return(1);
+    }
+  int ascent, descent, lineGap;
+  stbtt_GetFontVMetrics(fontInfo, &ascent, &descent, &lineGap);
+  fontSource.fontScale = stbtt_ScaleForPixelHeight(fontInfo, fontSource.pixelHeight);
+  fontSource.verticalAdvance = fontSource.fontScale * (r32)(ascent - descent + lineGap);
+
+  RangeU32 cpRange = fontSource.codepointRange;
+  u32 loadJobCount = ARRAY_COUNT(sources) + (cpRange.max - cpRange.min);
+  AssetJob *loadJobs = arenaPushArray(arena, loadJobCount, AssetJob);
+  for(u32 sourceIndex = 0; sourceIndex < ARRAY_COUNT(sources); ++sourceIndex)
+    {
+      loadJobs[sourceIndex].kind = AssetJob_decodeBitmap;
+      loadJobs[sourceIndex].source = sources + sourceIndex;
+    }
+  for(u32 codepoint = cpRange.min; codepoint < cpRange.max; ++codepoint)
+    {
+      AssetJob *job = loadJobs + ARRAY_COUNT(sources) + (codepoint - cpRange.min);
+      job->kind = AssetJob_rasterizeGlyph;
+      job->source = &fontSource;
+      job->codepoint = codepoint;
+    }
+  runAssetJobs(loadJobs, loadJobCount, threadArenas, threadCount);
+  u64 loadTime = readTimerMicroseconds();
 
-	      inserted = 1;
-	    }
-	  else
-	    {
-	      if(maxY > atlasHeight)
-		{
-		  // NOTE: overflowing y. grow atlas
-		  ++growCount;
-		  if(growCount & 1)
-		    {
-		      // NOTE: grow x
-		      spaceX = atlasWidth;
-		      layoutX = atlasWidth;
-		      layoutY = 0;
-		      rowMaxHeight = 0;
-		      atlasWidth *= 2;
-		    }
-		  else
-		    {
-		      // NOTE: grow y
-		      spaceX = 0;
-		      layoutX = 0;
-		      layoutY = atlasHeight;
-		      rowMaxHeight = 0;
-		      atlasHeight *= 2;
-		    }
-		}
-	      else
-		{
-		  // NOTE: overflowing x. go to next row
-		  layoutY += rowMaxHeight;
-		  layoutX = spaceX;
-		  rowMaxHeight = 0;
-		}
-	    }
+  String8List pluginAssetXList = {};
+  stringListPush(looseAssets->arena, &pluginAssetXList,
+		 STR8_LIT("#define PLUGIN_ASSET_XLIST\\\n"));
+
+  LoadedBitmap *whiteBitmap = makeWhiteBitmap(looseAssets->arena, 16, 16);  
+  stringListPush(looseAssets->arena, &pluginAssetXList, STR8_LIT("  X(null)\\\n"));
+
+  for(u32 sourceIndex = 0; sourceIndex < ARRAY_COUNT(sources); ++sourceIndex)
+    {
+      AssetSource *source = sources + sourceIndex;
+      LoadedBitmap *bitmap = loadJobs[sourceIndex].bitmap;
+      if(!bitmap)
+	{
+	  fprintf(stderr, "ERROR: asset packer couldn't decode %s\n", (char*)source->path.str);
+	  return(1);
 	}
+
+      looseAssetPushBitmap(looseAssets, bitmap, source->name);
+      stringListPushFormat(looseAssets->arena, &pluginAssetXList, "  X(%.*s)\\\n",
+			   (int)source->name.size, source->name.str);
     }
-  //atlasHeight = layoutY + rowMaxHeight + 1;
-#  endif
-#endif
+
+  looseAssetPushBitmap(looseAssets, whiteBitmap, STR8_LIT("null"));
+
+  for(u32 codepoint = cpRange.min; codepoint < cpRange.max; ++codepoint)
+    {
+      AssetJob *job = loadJobs + ARRAY_COUNT(sources) + (codepoint - cpRange.min);
+      LooseBitmap *looseBitmap =
+	looseAssetPushBitmap(looseAssets, job->bitmap, "%.*s_%u",
+			     (int)fontSource.name.size, fontSource.name.str, codepoint);
+      looseBitmap->advance = job->advance;
+    }
+
+  LooseFont *looseFont = arenaPushStruct(looseAssets->arena, LooseFont);
+  looseFont->verticalAdvance = fontSource.verticalAdvance;
+  looseFont->name = arenaPushString(looseAssets->arena, fontSource.name);
+  looseFont->range = cpRange;
+  QUEUE_PUSH(looseAssets->firstFont, looseAssets->lastFont, looseFont);
+  ++looseAssets->fontCount;
+
+  // NOTE: compute positions in the atlas. Bitmaps are a texel apart, so sampling one doesn't
+  //       filter in its neighbors
+  u32 bitmapCount = (u32)looseAssets->bitmapCount;
+  v2s32 *packDims = arenaPushArray(arena, bitmapCount, v2s32);
+  s64 bitmapArea = 0;
+  {
+    u32 bitmapIndex = 0;
+    for(LooseBitmap *bitmap = looseAssets->firstBitmap; bitmap; bitmap = bitmap->next, ++bitmapIndex)
+      {
+	packDims[bitmapIndex] = V2S32(bitmap->bitmap->width + 1, bitmap->bitmap->height + 1);
+	bitmapArea += (s64)bitmap->bitmap->width*(s64)bitmap->bitmap->height;
+      }
+  }
+
+  AtlasLayout atlasLayout = packAtlas(arena, packDims, bitmapCount);
+  s32 atlasWidth = atlasLayout.dim.x;
+  s32 atlasHeight = atlasLayout.dim.y;
+  {
+    u32 bitmapIndex = 0;
+    for(LooseBitmap *bitmap = looseAssets->firstBitmap; bitmap; bitmap = bitmap->next, ++bitmapIndex)
+      {
+	bitmap->atlasOffsetX = atlasLayout.positions[bitmapIndex].x;
+	bitmap->atlasOffsetY = atlasLayout.positions[bitmapIndex].y;
+      }
+  }
+  u64 packTime = readTimerMicroseconds();
 
   // NOTE: copy into the atlas
   u32 *atlasPixels = arenaPushArray(arena, atlasWidth * atlasHeight, u32);
@@ -1047,22 +1470,26 @@ main(int argc, char **argv)
       stringListPush(writeArena, &assetFontList, STR8_LIT("};\n"));      
     }
 
-  String8 pluginAssetXListString = stringListJoin(writeArena, &pluginAssetXList);
-  String8 assetEnumString = stringListJoin(writeArena, &assetEnumList);
-  String8 assetRectString = stringListJoin(writeArena, &assetRectList);
-  String8 assetFontString = stringListJoin(writeArena, &assetFontList);
+  String8 pluginAssetXListString = stringListJoin(writeArena, &pluginAssetXList, STR8_LIT(""));
+  String8 assetEnumString = stringListJoin(writeArena, &assetEnumList, STR8_LIT(""));
+  String8 assetRectString = stringListJoin(writeArena, &assetRectList, STR8_LIT(""));
+  String8 assetFontString = stringListJoin(writeArena, &assetFontList, STR8_LIT(""));
   String8 generatedCodeString =
     concatenateStrings(writeArena, pluginAssetXListString,
 		       concatenateStrings(writeArena, assetEnumString,
 					  concatenateStrings(writeArena, assetRectString, assetFontString)));
-  
-  Buffer generatedCode = {};
-  generatedCode.contents = generatedCodeString.str;
-  generatedCode.size = generatedCodeString.size;
 
-  writeEntireFile(STR8_LIT(SRC_PATH"plugin_assets.generated.h"), generatedCode);
+  // NOTE: leave the header alone when it comes out the same, so what includes it isn't rebuilt
+  Buffer lastGeneratedCode = readEntireFile(writeArena, generatedCodePath);
+  if(!stringsAreEqual(makeString8(lastGeneratedCode.contents, lastGeneratedCode.size),
+		      generatedCodeString))
+    {
+      Buffer generatedCode = {};
+      generatedCode.contents = generatedCodeString.str;
+      generatedCode.size = generatedCodeString.size;
 
-  arenaEnd(writeArena);
+      writeEntireFile(generatedCodePath, generatedCode);
+    }
 
   // DEBUG: write atlas to file
 #if 1
@@ -1072,7 +1499,7 @@ main(int argc, char **argv)
   atlasImage->stride = atlasImage->width * sizeof(u32);
   atlasImage->pixels = atlasPixels;
 
-  writePNG(atlasImage, STR8_LIT(DATA_PATH"test_atlas.png"));
+  writePNG(atlasImage, atlasPath);
 #else
   // TODO: this header masks business is janky as hell
   BitmapHeaderV5 *header = arenaPushStruct(writeArena, BitmapHeaderV5);
@@ -1105,6 +1532,28 @@ main(int argc, char **argv)
   writeEntireFile(STR8_LIT(DATA_PATH"test_atlas.bmp"), file);
 #endif
 
+  AssetManifest *manifest = arenaPushStruct(writeArena, AssetManifest);
+  manifest->magic = ASSET_MANIFEST_MAGIC;
+  manifest->version = ASSET_MANIFEST_VERSION;
+  manifest->sourceCount = sourceCount;
+  for(u32 sourceIndex = 0; sourceIndex < sourceCount; ++sourceIndex)
+    {
+      manifest->sourceHashes[sourceIndex] = allSources[sourceIndex]->hash;
+    }
+  Buffer manifestBuffer = {};
+  manifestBuffer.contents = (u8*)manifest;
+  manifestBuffer.size = sizeof(AssetManifest);
+  writeEntireFile(manifestPath, manifestBuffer);
+
+  u64 endTime = readTimerMicroseconds();
+  printf("asset packer: %u of %u sources changed, %u bitmaps loaded in %.1f ms on %u threads\n",
+	 changedSourceCount, sourceCount, bitmapCount, (r32)(loadTime - startTime)/1000.f, threadCount);
+  printf("asset packer: %dx%d atlas, %.1f%% filled, packed in %.1f ms, written in %.1f ms\n",
+	 atlasWidth, atlasHeight, 100.f*(r32)bitmapArea/((r32)atlasWidth*(r32)atlasHeight),
+	 (r32)(packTime - loadTime)/1000.f, (r32)(endTime - packTime)/1000.f);
+
+  arenaEnd(writeArena);
+
   arenaReleaseScratch(scratch);
   return(0);
 }
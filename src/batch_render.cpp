@@ -0,0 +1,1035 @@
+// a command-line host that renders wav files through the plugin offline, as fast as the cpu
+// allows. every input file is an independent job with its own PluginState, and jobs are pulled
+// off a shared queue by one worker thread per core.
+
+/* usage:
+     granade_batch [options] <input.wav> [<input.wav> ...]
+     granade_batch [options] -u <output.png>
+
+   options:
+     -j <count>    number of worker threads (default: number of processors)
+     -p <file>     parameter preset, applied before rendering starts
+     -a <file>     parameter automation, applied while rendering
+     -t <seconds>  time rendered past the end of the input, for grain tails (default: 2)
+     -o <dir>      output directory (default: next to each input file)
+     -s <seed>     random seed. job i is seeded with seed + i, so renders are reproducible
+     -c <dir>      keep decoded inputs in a cache in <dir>, so later runs skip decoding
+     -m <MB>       cache size limit (default: 2048)
+     -u <file>     draw the plugin's ui on the cpu and write it to a png file. no inputs are needed
+     -r <W>x<H>    ui resolution (default: 1280x720)
+     -f <count>    number of ui frames drawn, and timed (default: 1)
+
+   preset files contain one `<parameter> <value>` pair per line. automation files contain one
+   `<seconds> <parameter> <value> [<ramp milliseconds>]` event per line. parameter names are the
+   ones in PLUGIN_PARAMETER_XLIST, and values are in the parameter's own units (e.g. dB for
+   volume), clamped to its range. empty lines and lines starting with '#' are ignored.
+
+   inputs are wav files of any sample rate, as 8, 16, 24 or 32-bit pcm or 32 or 64-bit float, and
+   are resampled to 48kHz. mono inputs play on both channels, and only the first two channels of
+   wider ones are used. outputs are written as stereo 32-bit float wav files named
+   <input>_granade.wav, which become rf64 files past 4GB
+
+   ui screenshots need ../data/test_atlas.png, which the asset packer writes. presets apply to them
+   too, so they show the parameters' values
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HOST_LAYER
+#include "common.h"
+#include "platform.h"
+
+//
+// platform functions
+//
+
+// NOTE: jobs must be reproducible no matter which thread runs them, so every thread gets its
+//       own generator, which is reseeded at the start of each job
+static thread_var u32 batchRandomState = 1;
+
+static r32
+gsRand(RangeR32 range)
+{
+  // NOTE: xorshift32
+  u32 x = batchRandomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  batchRandomState = x;
+
+  r32 rand01 = (r32)(x >> 8)/(r32)(1 << 24);
+  r32 result = mapToRange(rand01, range);
+  return(result);
+}
+
+static r32
+gsAbs(r32 num)
+{
+  return(fabsf(num));
+}
+
+static r32
+gsSqrt(r32 num)
+{
+  return(sqrtf(num));
+}
+
+static r32
+gsSin(r32 num)
+{
+  return(sinf(num));
+}
+
+static r32
+gsCos(r32 num)
+{
+  return(cosf(num));
+}
+
+static r32
+gsPow(r32 base, r32 exp)
+{
+  return(powf(base, exp));
+}
+
+static void
+gsCopyMemory(void *dest, void *src, usz size)
+{
+  memcpy(dest, src, size);
+}
+
+static void
+gsSetMemory(void *dest, int value, usz size)
+{
+  memset(dest, value, size);
+}
+
+#define ARENA_MIN_ALLOCATION_SIZE KILOBYTES(64)
+
+static Arena*
+gsArenaAcquire(usz size)
+{
+  usz allocSize = MAX(size, ARENA_MIN_ALLOCATION_SIZE);
+
+  void *base = platformAllocateMemory(allocSize);
+  Arena *result = (Arena*)base;
+  result->current = result;
+  result->prev = 0;
+  result->base = 0;
+  result->capacity = allocSize;
+  result->pos = ARENA_HEADER_SIZE;
+
+  return(result);
+}
+
+static void
+gsArenaDiscard(Arena *arena)
+{
+  platformFreeMemory(arena, arena->capacity);
+}
+
+static Buffer
+gsReadEntireFile(char *filename, Arena *allocator)
+{
+  return(platformReadEntireFile(filename, allocator));
+}
+
+static void
+gsFreeFileMemory(Buffer file, Arena *allocator)
+{
+  platformFreeFileMemory(file, allocator);
+}
+
+static void
+gsWriteEntireFile(char *filename, Buffer file)
+{
+  platformWriteEntireFile(filename, file);
+}
+
+static Buffer
+gsMapFile(char *filename)
+{
+  return(platformMapFile(filename));
+}
+
+static void
+gsUnmapFile(Buffer file)
+{
+  platformUnmapFile(file);
+}
+
+static GS_File
+gsOpenFileForWriting(char *filename, b32 truncate)
+{
+  return(platformOpenFileForWriting(filename, truncate));
+}
+
+static b32
+gsWriteFileAt(GS_File file, u64 offset, Buffer data)
+{
+  return(platformWriteFileAt(file, offset, data));
+}
+
+static void
+gsCloseFile(GS_File file)
+{
+  platformCloseFile(file);
+}
+
+static b32
+gsRemoveFile(char *filename)
+{
+  return(platformRemoveFile(filename));
+}
+
+static String8
+gsGetPathToModule(void *handleToModule, void *functionInModule, Arena *allocator)
+{
+  return(platformGetPathToModule(handleToModule, functionInModule, allocator));
+}
+
+// NOTE: the batch renderer runs without a tagging model
+static b32
+gsRunModel(r32 *inputData, r32 *outputData, u32 batchCount, s64 inputLength)
+{
+  UNUSED(inputData);
+  UNUSED(outputData);
+  UNUSED(batchCount);
+  UNUSED(inputLength);
+  return(false);
+}
+
+static u64
+gsGetCurrentTimestamp(void)
+{
+  return(platformGetCurrentTimestamp());
+}
+
+static b32
+gsStartThread(GS_ThreadProc *proc, void *data)
+{
+  return(platformStartThread(proc, data));
+}
+
+static void
+gsSleep(u32 msecsToWait)
+{
+  platformSleep(msecsToWait);
+}
+
+static u32
+gsAtomicLoad(volatile u32 *src)
+{
+  return(atomicLoad(src));
+}
+
+static u32
+gsAtomicStore(volatile u32 *dest, u32 value)
+{
+  return(atomicStore(dest, value));
+}
+
+static u32
+gsAtomicAdd(volatile u32 *addend, u32 value)
+{
+  return(atomicAdd(addend, value));
+}
+
+static u32
+gsAtomicCompareAndSwap(volatile u32 *value, u32 oldVal, u32 newVal)
+{
+  return(atomicCompareAndSwap(value, oldVal, newVal));
+}
+
+static void*
+gsAtomicCompareAndSwapPointers(volatile void **value, void *oldVal, void *newVal)
+{
+  return(atomicCompareAndSwapPointers(value, oldVal, newVal));
+}
+
+#include "plugin.cpp"
+
+//
+// presets/automation
+//
+
+#define BATCH_BLOCK_FRAMES 512
+#define BATCH_DEFAULT_RAMP_MS 10.f
+
+struct BatchParameterValue
+{
+  u32 index;
+  r32 value;
+};
+
+struct BatchAutomationEvent
+{
+  u64 frame;
+  u32 index;
+  r32 value;
+  r32 rampMS;
+};
+
+struct BatchSettings
+{
+  BatchParameterValue *presetValues;
+  u32 presetValueCount;
+
+  BatchAutomationEvent *events;
+  u32 eventCount;
+
+  r32 tailSeconds;
+
+  SampleCache *sampleCache; // NOTE: null unless a cache directory was given
+};
+
+static u32
+batchFindParameter(char *name)
+{
+  u32 result = PluginParameter_none;
+  for(u32 parameterIndex = PluginParameter_none + 1;
+      parameterIndex < PluginParameter_count;
+      ++parameterIndex)
+    {
+      if(strcmp(name, pluginParameterInitData[parameterIndex].name) == 0)
+        {
+          result = parameterIndex;
+          break;
+        }
+    }
+
+  return(result);
+}
+
+// NOTE: splits a file in place into null-terminated lines, skipping blank lines and comments.
+//       returns 0 when there are no more lines
+static char*
+batchNextLine(char **at)
+{
+  char *result = 0;
+  while(**at && !result)
+    {
+      char *line = *at;
+      while(**at && **at != '\n') ++*at;
+      if(**at) *(*at)++ = 0;
+
+      while(*line == ' ' || *line == '\t' || *line == '\r') ++line;
+      if(*line && *line != '#')
+        {
+          result = line;
+        }
+    }
+
+  return(result);
+}
+
+static bool
+batchLoadPreset(Arena *arena, char *filename, BatchSettings *settings)
+{
+  bool result = true;
+
+  Buffer file = platformReadEntireFile(filename, arena);
+  if(file.contents)
+    {
+      u32 valueCapacity = PluginParameter_count;
+      settings->presetValues = arenaPushArray(arena, valueCapacity, BatchParameterValue);
+      settings->presetValueCount = 0;
+
+      char *at = (char*)file.contents;
+      u32 lineNumber = 0;
+      for(char *line = batchNextLine(&at); line; line = batchNextLine(&at))
+        {
+          ++lineNumber;
+
+          char name[64];
+          r32 value = 0.f;
+          if(sscanf(line, "%63s %f", name, &value) == 2)
+            {
+              u32 parameterIndex = batchFindParameter(name);
+              if(parameterIndex != PluginParameter_none)
+                {
+                  // NOTE: later lines override earlier ones
+                  BatchParameterValue *entry = 0;
+                  for(u32 entryIndex = 0; entryIndex < settings->presetValueCount; ++entryIndex)
+                    {
+                      if(settings->presetValues[entryIndex].index == parameterIndex)
+                        {
+                          entry = settings->presetValues + entryIndex;
+                        }
+                    }
+                  if(!entry)
+                    {
+                      ASSERT(settings->presetValueCount < valueCapacity);
+                      entry = settings->presetValues + settings->presetValueCount++;
+                    }
+
+                  entry->index = parameterIndex;
+                  entry->value = value;
+                }
+              else
+                {
+                  fprintf(stderr, "ERROR: %s:%u: unknown parameter '%s'\n", filename, lineNumber, name);
+                  result = false;
+                }
+            }
+          else
+            {
+              fprintf(stderr, "ERROR: %s:%u: expected '<parameter> <value>'\n", filename, lineNumber);
+              result = false;
+            }
+        }
+    }
+  else
+    {
+      result = false;
+    }
+
+  return(result);
+}
+
+static bool
+batchLoadAutomation(Arena *arena, char *filename, BatchSettings *settings)
+{
+  bool result = true;
+
+  Buffer file = platformReadEntireFile(filename, arena);
+  if(file.contents)
+    {
+      // NOTE: every event takes up at least one line
+      u32 eventCapacity = 1;
+      for(usz byteIndex = 0; byteIndex < file.size; ++byteIndex)
+        {
+          if(file.contents[byteIndex] == '\n') ++eventCapacity;
+        }
+
+      settings->events = arenaPushArray(arena, eventCapacity, BatchAutomationEvent);
+      settings->eventCount = 0;
+
+      char *at = (char*)file.contents;
+      u32 lineNumber = 0;
+      for(char *line = batchNextLine(&at); line; line = batchNextLine(&at))
+        {
+          ++lineNumber;
+
+          r32 seconds = 0.f;
+          char name[64];
+          r32 value = 0.f;
+          r32 rampMS = BATCH_DEFAULT_RAMP_MS;
+          int fieldCount = sscanf(line, "%f %63s %f %f", &seconds, name, &value, &rampMS);
+          if(fieldCount >= 3 && seconds >= 0.f && rampMS >= 0.f)
+            {
+              u32 parameterIndex = batchFindParameter(name);
+              if(parameterIndex != PluginParameter_none)
+                {
+                  BatchAutomationEvent event = {};
+                  event.frame = (u64)(seconds*(r32)INTERNAL_SAMPLE_RATE);
+                  event.index = parameterIndex;
+                  event.value = value;
+                  event.rampMS = MAX(rampMS, 1000.f/(r32)INTERNAL_SAMPLE_RATE);
+
+                  // NOTE: keep events sorted by time, preserving file order for equal times
+                  ASSERT(settings->eventCount < eventCapacity);
+                  u32 insertIndex = settings->eventCount++;
+                  for(; insertIndex > 0 && settings->events[insertIndex - 1].frame > event.frame; --insertIndex)
+                    {
+                      settings->events[insertIndex] = settings->events[insertIndex - 1];
+                    }
+                  settings->events[insertIndex] = event;
+                }
+              else
+                {
+                  fprintf(stderr, "ERROR: %s:%u: unknown parameter '%s'\n", filename, lineNumber, name);
+                  result = false;
+                }
+            }
+          else
+            {
+              fprintf(stderr, "ERROR: %s:%u: expected '<seconds> <parameter> <value> [<ramp ms>]'\n",
+                      filename, lineNumber);
+              result = false;
+            }
+        }
+    }
+  else
+    {
+      result = false;
+    }
+
+  return(result);
+}
+
+//
+// jobs
+//
+
+struct BatchJob
+{
+  String8 inputPath;
+  String8 outputPath;
+  u32 seed;
+
+  bool succeeded;
+  u64 framesRendered;
+  u64 elapsedTime;
+};
+
+struct BatchQueue
+{
+  BatchSettings *settings;
+
+  BatchJob *jobs;
+  u32 jobCount;
+  volatile u32 nextJobIndex;
+};
+
+struct BatchWorker
+{
+  OSThread thread;
+  BatchQueue *queue;
+};
+
+STATIC_ASSERT(DISK_RECORDER_CHANNELS == 2, batchWavChannelCheck);
+
+// NOTE: uses the disk recorder's header, which turns into rf64 once the data passes 4GB
+static Buffer
+batchMakeWav(Arena *arena, r32 *samplesL, r32 *samplesR, u64 frameCount)
+{
+  usz dataSize = frameCount*DISK_RECORDER_CHANNELS*sizeof(r32);
+  usz fileSize = DISK_RECORDER_HEADER_SIZE + dataSize;
+
+  Buffer result = {};
+  result.size = fileSize;
+  result.contents = arenaPushArray(arena, fileSize, u8, arenaFlagsNoZeroAlign(sizeof(r32)));
+
+  Buffer at = result;
+  u8 *header = bufferReadArray(&at, DISK_RECORDER_HEADER_SIZE, u8);
+  diskRecorderBuildHeader_(header, INTERNAL_SAMPLE_RATE, frameCount);
+
+  r32 *dest = bufferReadArray(&at, frameCount*DISK_RECORDER_CHANNELS, r32);
+  for(u64 frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+    {
+      *dest++ = samplesL[frameIndex];
+      *dest++ = samplesR[frameIndex];
+    }
+  ASSERT(at.size == 0);
+
+  return(result);
+}
+
+// NOTE: presets are applied immediately, without a parameter ramp
+static void
+batchApplyPreset(BatchSettings *settings, PluginState *pluginState)
+{
+  for(u32 valueIndex = 0; valueIndex < settings->presetValueCount; ++valueIndex)
+    {
+      BatchParameterValue *presetValue = settings->presetValues + valueIndex;
+      PluginFloatParameter *parameter = pluginState->parameters + presetValue->index;
+      ParameterValue value = {};
+      value.asFloat = clampToRange(presetValue->value, parameter->range);
+      parameter->currentValue.asInt = value.asInt;
+      parameter->targetValue.asInt = value.asInt;
+    }
+}
+
+static void
+batchRenderJob(BatchSettings *settings, BatchJob *job)
+{
+  u64 startTime = readOSTimer();
+
+  Arena *jobArena = gsArenaAcquire(MEGABYTES(1));
+
+  CachedSound cachedInput = {};
+  if(settings->sampleCache)
+    {
+      cachedInput = sampleCacheLoadWav(settings->sampleCache, jobArena, job->inputPath);
+    }
+  else
+    {
+      cachedInput.sound = loadWav(jobArena, job->inputPath);
+    }
+  LoadedSound input = cachedInput.sound;
+  if(input.sampleCount)
+    {
+      batchRandomState = job->seed ? job->seed : 1;
+
+      PluginMemory pluginMemory = {};
+      pluginMemory.osTimerFreq = getOSTimerFreq();
+      pluginMemory.host = PluginHost_batch;
+
+      PluginState *pluginState = initializePluginState(&pluginMemory);
+      batchApplyPreset(settings, pluginState);
+
+      u64 inputFrameCount = input.sampleCount;
+      u64 tailFrameCount = (u64)(settings->tailSeconds*(r32)INTERNAL_SAMPLE_RATE);
+      u64 outputFrameCount = inputFrameCount + tailFrameCount;
+
+      r32 *outputL = arenaPushArray(jobArena, outputFrameCount, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+      r32 *outputR = arenaPushArray(jobArena, outputFrameCount, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+      r32 *silence = arenaPushArray(jobArena, BATCH_BLOCK_FRAMES, r32, arenaFlagsZeroAlign(4*sizeof(r32)));
+
+      PluginAudioBuffer *audioBuffer = arenaPushStruct(jobArena, PluginAudioBuffer, arenaFlagsZeroNoAlign());
+      audioBuffer->outputFormat = AudioFormat_r32;
+      audioBuffer->outputBufferCapacity = BATCH_BLOCK_FRAMES;
+      audioBuffer->outputSampleRate = INTERNAL_SAMPLE_RATE;
+      audioBuffer->outputChannels = 2;
+      audioBuffer->outputStride = sizeof(r32);
+      audioBuffer->inputFormat = AudioFormat_r32;
+      audioBuffer->inputBufferCapacity = BATCH_BLOCK_FRAMES;
+      audioBuffer->inputSampleRate = INTERNAL_SAMPLE_RATE;
+      audioBuffer->inputChannels = 2;
+      audioBuffer->inputStride = sizeof(r32);
+      audioBuffer->midiMessageCount = 0;
+      audioBuffer->midiBuffer = 0;
+
+      u32 eventIndex = 0;
+      for(u64 frameIndex = 0; frameIndex < outputFrameCount;)
+        {
+          // NOTE: apply automation events that are due
+          for(; eventIndex < settings->eventCount && settings->events[eventIndex].frame <= frameIndex; ++eventIndex)
+            {
+              BatchAutomationEvent *event = settings->events + eventIndex;
+              pluginSetFloatParameter(pluginState->parameters + event->index, event->value, event->rampMS);
+            }
+
+          // NOTE: blocks end early at the next automation event and at the end of the input, so
+          //       that events land on the right frame and no block straddles input and silence
+          u64 blockEnd = MIN(frameIndex + BATCH_BLOCK_FRAMES, outputFrameCount);
+          if(eventIndex < settings->eventCount)
+            {
+              blockEnd = MIN(blockEnd, settings->events[eventIndex].frame);
+            }
+          if(frameIndex < inputFrameCount)
+            {
+              blockEnd = MIN(blockEnd, inputFrameCount);
+            }
+          u32 framesToWrite = (u32)(blockEnd - frameIndex);
+
+          if(frameIndex < inputFrameCount)
+            {
+              audioBuffer->inputBuffer[0] = input.samples[0] + frameIndex;
+              audioBuffer->inputBuffer[1] = input.samples[1] + frameIndex;
+            }
+          else
+            {
+              audioBuffer->inputBuffer[0] = silence;
+              audioBuffer->inputBuffer[1] = silence;
+            }
+          audioBuffer->outputBuffer[0] = outputL + frameIndex;
+          audioBuffer->outputBuffer[1] = outputR + frameIndex;
+          audioBuffer->framesToWrite = framesToWrite;
+
+          pluginProcessAudio(pluginState, audioBuffer);
+
+          frameIndex += framesToWrite;
+        }
+
+      // NOTE: a partly written output is removed, so that a failed job never looks rendered
+      Buffer wav = batchMakeWav(jobArena, outputL, outputR, outputFrameCount);
+      char *outputPath = (char*)job->outputPath.str;
+      GS_File outputFile = gsOpenFileForWriting(outputPath, true);
+      b32 written = (outputFile && gsWriteFileAt(outputFile, 0, wav));
+      gsCloseFile(outputFile);
+
+      releasePluginState(pluginState);
+
+      if(written)
+        {
+          job->succeeded = true;
+          job->framesRendered = outputFrameCount;
+        }
+      else
+        {
+          fprintf(stderr, "ERROR: could not write %s\n", outputPath);
+          if(outputFile) gsRemoveFile(outputPath);
+        }
+    }
+  else
+    {
+      fprintf(stderr, "ERROR: could not load %.*s\n", (int)job->inputPath.size, job->inputPath.str);
+    }
+
+  sampleCacheRelease(&cachedInput);
+  arenaEnd(jobArena);
+  gsArenaDiscard(jobArena);
+
+  job->elapsedTime = readOSTimer() - startTime;
+}
+
+static BASE_THREAD_PROC(batchWorkerProc)
+{
+  BatchWorker *worker = (BatchWorker*)data;
+  BatchQueue *queue = worker->queue;
+
+  for(;;)
+    {
+      u32 jobIndex = atomicAdd(&queue->nextJobIndex, 1);
+      if(jobIndex >= queue->jobCount) break;
+
+      batchRenderJob(queue->settings, queue->jobs + jobIndex);
+    }
+
+  // NOTE: let threadDestroy know we're done
+  while(atomicCompareAndSwap(&worker->thread.lock, 0, 1) != 0)
+    {
+      msecWait(1);
+    }
+  worker->thread.finished = 1;
+  atomicStore(&worker->thread.lock, 0);
+}
+
+//
+// ui screenshots
+//
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_STATIC
+#define STBI_ONLY_PNG
+#include "stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_STATIC
+#include "stb_image_write.h"
+
+#define BATCH_UI_DEFAULT_WIDTH 1280
+#define BATCH_UI_DEFAULT_HEIGHT 720
+
+// NOTE: images are flipped, so that the bottom row comes first, like the renderers expect
+static bool
+batchLoadPNG(char *filename, LoadedBitmap *bitmap)
+{
+  stbi_set_flip_vertically_on_load(1);
+
+  int width, height, channelCount;
+  u8 *data = stbi_load(filename, &width, &height, &channelCount, 4);
+  if(data)
+    {
+      bitmap->width = width;
+      bitmap->height = height;
+      bitmap->stride = width*sizeof(u32);
+      bitmap->pixels = (u32*)data;
+    }
+  else
+    {
+      fprintf(stderr, "ERROR: could not load %s: %s\n", filename, stbi_failure_reason());
+    }
+
+  return(data != 0);
+}
+
+static bool
+batchWritePNG(char *filename, SoftwareFramebuffer *framebuffer)
+{
+  stbi_flip_vertically_on_write(1);
+
+  int success = stbi_write_png(filename, framebuffer->width, framebuffer->height, 4,
+                               framebuffer->pixels, framebuffer->stride*sizeof(u32));
+  if(!success)
+    {
+      fprintf(stderr, "ERROR: could not write %s\n", filename);
+    }
+
+  return(success != 0);
+}
+
+// NOTE: builds and draws the plugin's ui on the cpu, like the standalone host would on the gpu,
+//       and writes out the last frame. Frames after the first are timed, for benchmarks
+static bool
+batchRenderUI(BatchSettings *settings, char *outputPath, u32 width, u32 height,
+              u32 frameCount, u32 threadCount)
+{
+  bool result = false;
+
+  Arena *uiArena = gsArenaAcquire(MEGABYTES(1));
+
+  LoadedBitmap atlas = {};
+  if(batchLoadPNG((char*)DATA_PATH"test_atlas.png", &atlas))
+    {
+      PluginMemory pluginMemory = {};
+      pluginMemory.osTimerFreq = getOSTimerFreq();
+      pluginMemory.host = PluginHost_batch;
+
+      PluginState *pluginState = initializePluginState(&pluginMemory);
+      batchApplyPreset(settings, pluginState);
+
+      RenderCommands *commands = arenaPushStruct(uiArena, RenderCommands, arenaFlagsZeroNoAlign());
+      commands->allocator = uiArena;
+      commands->quadCapacity = RENDER_INITIAL_QUAD_CAPACITY;
+      commands->quads = arenaPushArray(uiArena, commands->quadCapacity, R_Quad);
+      commands->atlas = &atlas;
+
+      // NOTE: the calling thread draws tiles too
+      SoftwareRenderer *renderer = softwareRendererCreate(uiArena, threadCount - 1);
+      SoftwareFramebuffer framebuffer = softwareFramebufferAllocate(uiArena, width, height);
+      PluginInput *input = arenaPushStruct(uiArena, PluginInput, arenaFlagsZeroNoAlign());
+
+      usz quadCount = 0;
+      u64 buildTime = 0;
+      u64 drawTime = 0;
+      for(u32 frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+        {
+          u64 frameStartTime = readOSTimer();
+          renderBeginCommands(commands, width, height);
+          pluginRenderNewFrame(pluginState, input, commands);
+          u64 buildEndTime = readOSTimer();
+
+          softwareFramebufferClear(&framebuffer, V4(0.2f, 0.2f, 0.2f, 0.f));
+          softwareRenderCommands(renderer, commands, &framebuffer);
+          u64 drawEndTime = readOSTimer();
+
+          if(frameIndex > 0 || frameCount == 1)
+            {
+              buildTime += buildEndTime - frameStartTime;
+              drawTime += drawEndTime - buildEndTime;
+            }
+          quadCount = commands->quadCount;
+          renderEndCommands(commands);
+        }
+
+      u32 timedFrameCount = MAX(frameCount - 1, 1);
+      r64 msecPerTick = 1000.0/(r64)getOSTimerFreq();
+      fprintf(stderr, "done: %ux%u, %u quads, %.2fms to build and %.2fms to draw a frame on %u thread(s)\n",
+              width, height, (u32)quadCount, msecPerTick*(r64)buildTime/(r64)timedFrameCount,
+              msecPerTick*(r64)drawTime/(r64)timedFrameCount, renderer->workerCount + 1);
+
+      result = batchWritePNG(outputPath, &framebuffer);
+
+      softwareRendererDestroy(renderer);
+      releasePluginState(pluginState);
+      stbi_image_free(atlas.pixels);
+    }
+
+  arenaEnd(uiArena);
+  gsArenaDiscard(uiArena);
+
+  return(result);
+}
+
+//
+// main
+//
+
+static String8
+batchMakeOutputPath(Arena *arena, String8 inputPath, char *outputDirectory)
+{
+  String8 fileName = inputPath;
+  for(usz charIndex = 0; charIndex < inputPath.size; ++charIndex)
+    {
+      u8 c = inputPath.str[charIndex];
+      if(c == '/' || c == '\\')
+        {
+          fileName = makeString8(inputPath.str + charIndex + 1, inputPath.size - charIndex - 1);
+        }
+    }
+
+  String8 stem = fileName;
+  if(stem.size >= 4 && (strncmp((char*)stem.str + stem.size - 4, ".wav", 4) == 0 ||
+                        strncmp((char*)stem.str + stem.size - 4, ".WAV", 4) == 0))
+    {
+      stem.size -= 4;
+    }
+
+  String8 result = {};
+  if(outputDirectory)
+    {
+      result = arenaPushStringFormat(arena, "%s/%.*s_granade.wav",
+                                     outputDirectory, (int)stem.size, stem.str);
+    }
+  else
+    {
+      usz directorySize = fileName.str - inputPath.str;
+      result = arenaPushStringFormat(arena, "%.*s%.*s_granade.wav",
+                                     (int)directorySize, inputPath.str, (int)stem.size, stem.str);
+    }
+
+  return(result);
+}
+
+static void
+batchPrintUsage(char *programName)
+{
+  fprintf(stderr,
+          "usage: %s [options] <input.wav> [<input.wav> ...]\n"
+          "       %s [options] -u <output.png>\n"
+          "\n"
+          "options:\n"
+          "  -j <count>    number of worker threads (default: number of processors)\n"
+          "  -p <file>     parameter preset: '<parameter> <value>' per line\n"
+          "  -a <file>     parameter automation: '<seconds> <parameter> <value> [<ramp ms>]' per line\n"
+          "  -t <seconds>  time rendered past the end of the input (default: 2)\n"
+          "  -o <dir>      output directory (default: next to each input file)\n"
+          "  -s <seed>     random seed (default: 1)\n"
+          "  -c <dir>      keep decoded inputs in a cache in <dir>, so later runs skip decoding\n"
+          "  -m <MB>       cache size limit (default: 2048)\n"
+          "  -u <file>     draw the ui on the cpu and write it to a png file\n"
+          "  -r <W>x<H>    ui resolution (default: 1280x720)\n"
+          "  -f <count>    number of ui frames drawn, and timed (default: 1)\n",
+          programName, programName);
+}
+
+int
+main(int argc, char **argv)
+{
+  int result = 0;
+
+  Arena *arena = gsArenaAcquire(MEGABYTES(1));
+
+#if BUILD_LOGGING
+  // NOTE: the plugin states share one logger, which is guarded by its mutex
+  PluginLogger logger = {};
+  logger.logArena = gsArenaAcquire(0);
+  logger.maxCapacity = logger.logArena->capacity/2;
+  globalLogger = &logger;
+#endif
+
+  BatchSettings settings = {};
+  settings.tailSeconds = 2.f;
+
+  u32 threadCount = getProcessorCount();
+  u32 seed = 1;
+  char *outputDirectory = 0;
+  char *cacheDirectory = 0;
+  u64 cacheMaxSize = SAMPLE_CACHE_DEFAULT_MAX_SIZE;
+  char *uiOutputPath = 0;
+  u32 uiWidth = BATCH_UI_DEFAULT_WIDTH;
+  u32 uiHeight = BATCH_UI_DEFAULT_HEIGHT;
+  u32 uiFrameCount = 1;
+
+  char **inputPaths = arenaPushArray(arena, argc, char*);
+  u32 inputCount = 0;
+
+  bool argumentsAreValid = true;
+  for(int argIndex = 1; argIndex < argc && argumentsAreValid; ++argIndex)
+    {
+      char *arg = argv[argIndex];
+      if(arg[0] == '-' && arg[1] && !arg[2])
+        {
+          char *value = (argIndex + 1 < argc) ? argv[++argIndex] : 0;
+          if(!value)
+            {
+              fprintf(stderr, "ERROR: option %s expects a value\n", arg);
+              argumentsAreValid = false;
+              break;
+            }
+
+          switch(arg[1])
+            {
+            case 'j': { threadCount = (u32)MAX(atoi(value), 1); } break;
+            case 'p': { argumentsAreValid = batchLoadPreset(arena, value, &settings); } break;
+            case 'a': { argumentsAreValid = batchLoadAutomation(arena, value, &settings); } break;
+            case 't': { settings.tailSeconds = MAX((r32)atof(value), 0.f); } break;
+            case 'o': { outputDirectory = value; } break;
+            case 's': { seed = (u32)strtoul(value, 0, 10); } break;
+            case 'c': { cacheDirectory = value; } break;
+            case 'm': { cacheMaxSize = MEGABYTES(strtoull(value, 0, 10)); } break;
+            case 'u': { uiOutputPath = value; } break;
+            case 'r':
+              {
+                if(sscanf(value, "%ux%u", &uiWidth, &uiHeight) != 2 || !uiWidth || !uiHeight)
+                  {
+                    fprintf(stderr, "ERROR: expected a resolution like 1280x720, not %s\n", value);
+                    argumentsAreValid = false;
+                  }
+              } break;
+            case 'f': { uiFrameCount = (u32)MAX(atoi(value), 1); } break;
+            default:
+              {
+                fprintf(stderr, "ERROR: unknown option %s\n", arg);
+                argumentsAreValid = false;
+              } break;
+            }
+        }
+      else
+        {
+          inputPaths[inputCount++] = arg;
+        }
+    }
+
+  if(argumentsAreValid && inputCount && cacheDirectory)
+    {
+      usz directoryLength = strlen(cacheDirectory);
+      b32 hasSeparator = (directoryLength && (cacheDirectory[directoryLength - 1] == '/' ||
+                                              cacheDirectory[directoryLength - 1] == '\\'));
+      String8 directory = arenaPushStringFormat(arena, "%s%s", cacheDirectory, hasSeparator ? "" : "/");
+      settings.sampleCache = sampleCacheCreate(arena, directory, cacheMaxSize);
+    }
+
+  if(argumentsAreValid && inputCount)
+    {
+      BatchQueue queue = {};
+      queue.settings = &settings;
+      queue.jobCount = inputCount;
+      queue.jobs = arenaPushArray(arena, inputCount, BatchJob, arenaFlagsZeroNoAlign());
+      for(u32 jobIndex = 0; jobIndex < inputCount; ++jobIndex)
+        {
+          BatchJob *job = queue.jobs + jobIndex;
+          job->inputPath = STR8_CSTR(inputPaths[jobIndex]);
+          job->outputPath = batchMakeOutputPath(arena, job->inputPath, outputDirectory);
+          job->seed = seed + jobIndex;
+        }
+
+      u32 jobThreadCount = MIN(threadCount, inputCount);
+      fprintf(stderr, "rendering %u file(s) on %u thread(s)...\n", inputCount, jobThreadCount);
+
+      u64 startTime = readOSTimer();
+
+      BatchWorker *workers = arenaPushArray(arena, jobThreadCount, BatchWorker, arenaFlagsZeroNoAlign());
+      for(u32 workerIndex = 0; workerIndex < jobThreadCount; ++workerIndex)
+        {
+          BatchWorker *worker = workers + workerIndex;
+          worker->queue = &queue;
+          threadCreate(&worker->thread, batchWorkerProc, worker);
+        }
+      for(u32 workerIndex = 0; workerIndex < jobThreadCount; ++workerIndex)
+        {
+          threadDestroy(&workers[workerIndex].thread);
+        }
+
+      u64 elapsedTime = readOSTimer() - startTime;
+      r64 timerFreq = (r64)getOSTimerFreq();
+
+      u64 totalFramesRendered = 0;
+      for(u32 jobIndex = 0; jobIndex < inputCount; ++jobIndex)
+        {
+          BatchJob *job = queue.jobs + jobIndex;
+          if(job->succeeded)
+            {
+              r64 jobSeconds = (r64)job->elapsedTime/timerFreq;
+              r64 audioSeconds = (r64)job->framesRendered/(r64)INTERNAL_SAMPLE_RATE;
+              fprintf(stderr, "  %.*s: %.2fs of audio in %.2fs (%.1fx real time)\n",
+                      (int)job->outputPath.size, job->outputPath.str,
+                      audioSeconds, jobSeconds, (jobSeconds > 0.0) ? audioSeconds/jobSeconds : 0.0);
+              totalFramesRendered += job->framesRendered;
+            }
+          else
+            {
+              result = 1;
+            }
+        }
+
+      r64 totalSeconds = (r64)elapsedTime/timerFreq;
+      r64 totalAudioSeconds = (r64)totalFramesRendered/(r64)INTERNAL_SAMPLE_RATE;
+      fprintf(stderr, "done: %.2fs of audio in %.2fs (%.1fx real time)\n",
+              totalAudioSeconds, totalSeconds,
+              (totalSeconds > 0.0) ? totalAudioSeconds/totalSeconds : 0.0);
+    }
+
+  if(argumentsAreValid && uiOutputPath)
+    {
+      fprintf(stderr, "drawing the ui to %s...\n", uiOutputPath);
+      if(!batchRenderUI(&settings, uiOutputPath, uiWidth, uiHeight, uiFrameCount, threadCount))
+        {
+          result = 1;
+        }
+    }
+
+  if(!argumentsAreValid || (!inputCount && !uiOutputPath))
+    {
+      batchPrintUsage(argv[0]);
+      result = 1;
+    }
+
+  return(result);
+}
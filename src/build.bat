@@ -13,6 +13,7 @@ set "config_testing=0"
 set "target_plugin=0"
 set "target_exe=0"
 set "target_vst=0"
+set "target_batch=0"
 set "target_all=1"
 
 :: -----------------------------------------------------------------------------
@@ -21,7 +22,7 @@ set "target_all=1"
 for %%a in (%*) do (
     for /f "tokens=1* delims=:" %%k in ("%%a") do (
     	set "key=%%k"
-	if "!key!"=="target" set "target_plugin=0" && set "target_exe=0" && set "target_vst=0" && set "target_all=0"
+	if "!key!"=="target" set "target_plugin=0" && set "target_exe=0" && set "target_vst=0" && set "target_batch=0" && set "target_all=0"
 
 	if "!key!"=="config" set "config_debug=0" && set "config_logging=0" && set "config_testing=0"
 
@@ -41,6 +42,7 @@ for %%a in (%*) do (
 	    echo "       plugin:   compiles the plugin to a dynamic library  "
 	    echo "       exe:      compiles the host executable              "
 	    echo "       vst:      compiles the webassembly target           "
+	    echo "       batch:    compiles the command-line batch renderer  "
 	    echo "       all:      compiles all targets                      "
 	    echo "                                                           "
 	    echo "   help:         displays this output and exits            "
@@ -58,13 +60,14 @@ for %%a in (%*) do (
     )   
 )
 
-if "!target_all!"=="1" set "target_plugin=1" && set "target_exe=1" && set "target_vst=1"
+if "!target_all!"=="1" set "target_plugin=1" && set "target_exe=1" && set "target_vst=1" && set "target_batch=1"
 if "!target_exe!"=="1" set "target_plugin=1"
 if "!target_vst!"=="1" set "target_plugin=1"
 
 if "!target_plugin!"=="1" echo [BUILD_PLUGIN]
 if "!target_exe!"=="1" echo [BUILD_EXE]
 if "!target_vst!"=="1" echo [BUILD_VST]
+if "!target_batch!"=="1" echo [BUILD_BATCH]
 
 if "!config_debug!"=="1" echo [BUILD_DEBUG]
 if "!config_logging!"=="1" echo [BUILD_LOGGING]
@@ -122,11 +125,18 @@ rem ..\build\preprocessor.exe plugin.h > generated.cpp
 rem pushd ..\build
 
 :: asset packer
-IF NOT EXIST %DATA_DIR%\test_atlas.png (
+:: NOTE: the packer runs every build, and skips assets that haven't changed since the last run
+IF NOT EXIST asset_packer.exe (
     echo compiling asset packer...
     cl %CFLAGS% ..\src\asset_packer.cpp /link %LFLAGS% -out:asset_packer.exe
-    echo running asset packer...
-    asset_packer.exe
+)
+echo running asset packer...
+asset_packer.exe
+set ASSET_STATUS=%ERRORLEVEL%
+if not %ASSET_STATUS%==0 (
+    echo ERROR: asset packing failed. stopping the build
+    popd
+    exit /b %ASSET_STATUS%
 )
 
 :: TODO: try compiling common layer implementations to separate lib/obj and link
@@ -166,6 +176,12 @@ if "!target_vst!"=="1" (
 )
 set VST_STATUS=%ERRORLEVEL%
 
+if "!target_batch!"=="1" (
+    echo compiling batch renderer...
+    cl %CFLAGS% -D"DATA_PATH=\"../data/\"" ..\src\batch_render.cpp -Fmgranade_batch.map /link %LFLAGS% /out:granade_batch.exe
+)
+set BATCH_STATUS=%ERRORLEVEL%
+
 popd
 goto end_script
 
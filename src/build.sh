@@ -14,6 +14,7 @@ target_plugin=0     # compiles the plugin to a dynamic library
 target_exe=0        # compiles the host executable
 target_vst=0        # compiles the vst target
 target_wasm=0       # compiles the webassembly target
+target_batch=0      # compiles the command-line batch renderer
 target_all=1        # compiles all targets
 
 ## -----------------------------------------------------------------------------
@@ -28,6 +29,7 @@ for arg in "$@"; do
         target_exe=0
         target_vst=0
         target_wasm=0
+        target_batch=0
         target_all=0
     fi
 
@@ -56,6 +58,7 @@ for arg in "$@"; do
         echo "      exe:     compiles the host executable"
         echo "      vst:     compiles the vst target"
         echo "      wasm:    compiles the webassembly target"
+        echo "      batch:   compiles the command-line batch renderer"
         echo "      all:     compiles all targets"
         echo ""
         echo "  help: displays this output and exits"
@@ -89,6 +92,7 @@ if [[ $target_all == 1 ]]; then
     target_exe=1
     target_vst=1
     target_wasm=1
+    target_batch=1
 fi
 
 if [[ $target_plugin == 1 ]]; then
@@ -103,6 +107,9 @@ fi
 if [[ $target_wasm == 1 ]]; then
     echo "[ WASM ]"
 fi
+if [[ $target_batch == 1 ]]; then
+    echo "[ BATCH ]"
+fi
 if [[ $config_debug == 1 ]]; then
     echo "[ DEBUG ]"
 fi
@@ -178,11 +185,21 @@ fi
 #pushd ../build > /dev/null
 
 # asset packer
-if [ ! -f $DATA_DIR/test_atlas.png ]; then
+# NOTE: the packer runs every build, and skips assets that haven't changed since the last run
+if [ ! -f asset_packer ] || [ $SRC_DIR/asset_packer.cpp -nt asset_packer ]; then
     echo "compiling asset packer..."
-    clang $CFLAGS $SRC_DIR/asset_packer.cpp $LFLAGS -lm -o asset_packer
+    clang $CFLAGS $SRC_DIR/asset_packer.cpp $LFLAGS -lm -lpthread -o asset_packer
+fi
+ASSET_STATUS=$?
+if [[ $ASSET_STATUS == 0 ]]; then
     echo "running asset packer..."
     ./asset_packer
+    ASSET_STATUS=$?
+fi
+if [[ $ASSET_STATUS != 0 ]]; then
+    echo "ERROR: asset packing failed. stopping the build"
+    popd > /dev/null
+    exit $ASSET_STATUS
 fi
 
 # TODO: try compiling common layer implementations to separate lib/obj and link
@@ -247,6 +264,14 @@ fi
 WASM_STATUS=$?
 STATUS=$(( WASM_STATUS || STATUS ))
 
+# batch renderer (links the plugin statically)
+if [[ $target_batch == 1 ]]; then
+    echo "compiling batch renderer..."
+    clang $CFLAGS -march=native -D"DATA_PATH=\"../data/\"" ../src/batch_render.cpp -o granade_batch -lpthread -lm
+fi
+BATCH_STATUS=$?
+STATUS=$(( BATCH_STATUS || STATUS ))
+
 ## -----------------------------------------------------------------------------
 ## assemble release bundles
 
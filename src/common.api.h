@@ -1,12 +1,25 @@
 // NOTE: functions the plugin calls and the host implements
 
+typedef void GS_ThreadProc(void *data);
+
+// NOTE: a file opened for writing in place, eg to append to it. Null if it couldn't be opened
+typedef void *GS_File;
+
 #define PLATFORM_API_XLIST\
   X(ReadEntireFile, Buffer, (char *filename, Arena *allocator))\
   X(FreeFileMemory, void, (Buffer file, Arena *allocator))\
   X(WriteEntireFile, void, (char *filename, Buffer file))\
+  X(MapFile, Buffer, (char *filename))\
+  X(UnmapFile, void, (Buffer file))\
+  X(OpenFileForWriting, GS_File, (char *filename, b32 truncate))\
+  X(WriteFileAt, b32, (GS_File file, u64 offset, Buffer data))\
+  X(CloseFile, void, (GS_File file))\
+  X(RemoveFile, b32, (char *filename))\
   X(GetPathToModule, String8, (void *handleToModule, void *functionInModule, Arena *allocator))\
   X(GetCurrentTimestamp, u64, (void))\
-  X(RunModel, void*, (r32 *inputData, s64 inputLength))\
+  X(StartThread, b32, (GS_ThreadProc *proc, void *data))\
+  X(Sleep, void, (u32 msecsToWait))\
+  X(RunModel, b32, (r32 *inputData, r32 *outputData, u32 batchCount, s64 inputLength))\
   X(Rand, r32, (RangeR32 range))\
   X(Abs, r32, (r32 num))\
   X(Sqrt, r32, (r32 num))\
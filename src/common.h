@@ -38,6 +38,7 @@ enum PluginHost
   PluginHost_executable,
   PluginHost_daw,
   PluginHost_web,
+  PluginHost_batch,
 };
 
 struct PluginMemory
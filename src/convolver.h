@@ -0,0 +1,411 @@
+// NOTE: partitioned overlap-save convolution, for impulse responses too long to convolve in one
+//       shot. The impulse is split into partitions whose spectra are computed once, up front.
+//       Every block, the spectrum of the newest input is pushed onto a frequency-domain delay line
+//       (fdl), and the output spectrum is the sum of each fdl entry times the matching partition.
+//       So the per-block cost is one fft, one ifft and a complex multiply-accumulate over the
+//       whole impulse, whatever the impulse length.
+//
+//       Uniform convolvers use one partition size for the whole impulse, and cost the same every
+//       block. Non-uniform convolvers start with small partitions, for low latency, and grow them
+//       by CONVOLVER_SEGMENT_GROWTH up to a maximum, for fewer partitions. The larger segments do
+//       all of their work on the block that completes one of their partitions, so their cost is
+//       bursty, and the largest block size should be kept within what one callback can afford.
+
+#define CONVOLVER_SEGMENT_GROWTH 4
+#define CONVOLVER_MAX_SEGMENTS 8
+
+// NOTE: a run of equal-sized partitions. Segment 0 starts at the head of the impulse, and its
+//       output lands in the block that completed it. Segment s > 0 starts `blockSize` samples in,
+//       so its output isn't needed until the block after it completes: it's written to
+//       `pendingOutput`, and read back one convolver block at a time
+struct ConvolverSegment
+{
+  u32 blockSize;
+  u32 binCount;       // NOTE: blockSize + 1 non-redundant bins of the real 2*blockSize transform
+  u32 paddedBinCount; // NOTE: binCount rounded up to the widest simd width, padded with zeros
+  u32 partitionCount;
+
+  FFT_Plan *forwardPlan;
+  FFT_Plan *inversePlan;
+
+  // NOTE: partition spectra, partitionCount*paddedBinCount each
+  r32 *impulseRe;
+  r32 *impulseIm;
+
+  // NOTE: ring of input spectra. Entry `fdlHead` is the newest
+  r32 *fdlRe;
+  r32 *fdlIm;
+  u32 fdlHead;
+
+  // NOTE: the last 2*blockSize input samples, oldest first. `inputFill` counts the samples of the
+  //       newest half that have arrived
+  r32 *inputWindow;
+  u32 inputFill;
+
+  r32 *accumulatorRe;
+  r32 *accumulatorIm;
+  r32 *spectrumRe;
+  r32 *spectrumIm;
+  r32 *timeDomain;
+
+  r32 *pendingOutput;
+};
+
+struct Convolver
+{
+  u32 blockSize;
+  u32 impulseCount;
+
+  u32 segmentCount;
+  ConvolverSegment segments[CONVOLVER_MAX_SEGMENTS];
+
+  // NOTE: callers can process any number of samples. They are gathered into blocks, so output
+  //       lags input by blockSize samples
+  r32 *inputBlock;
+  r32 *outputBlock;
+  u32 blockFill;
+
+  SimdLevel simdLevel;
+};
+
+//
+// complex multiply-accumulate
+//
+
+// NOTE: accRe + i*accIm += (aRe + i*aIm)*(bRe + i*bIm), over `count` bins. count must be a multiple
+//       of the kernel's width
+#define CONVOLVER_MAC(name) void (name)(r32 *accRe, r32 *accIm, r32 *aRe, r32 *aIm, r32 *bRe, r32 *bIm, u32 count)
+
+static CONVOLVER_MAC(convolverMACScalar_)
+{
+  for(u32 i = 0; i < count; ++i)
+    {
+      accRe[i] += aRe[i]*bRe[i] - aIm[i]*bIm[i];
+      accIm[i] += aRe[i]*bIm[i] + aIm[i]*bRe[i];
+    }
+}
+
+static CONVOLVER_MAC(convolverMACWide_)
+{
+  for(u32 i = 0; i < count; i += WIDE_WIDTH)
+    {
+      WideFloat xRe = wideLoadFloats(aRe + i);
+      WideFloat xIm = wideLoadFloats(aIm + i);
+      WideFloat hRe = wideLoadFloats(bRe + i);
+      WideFloat hIm = wideLoadFloats(bIm + i);
+      WideFloat yRe = wideLoadFloats(accRe + i);
+      WideFloat yIm = wideLoadFloats(accIm + i);
+
+      yRe = wideMulAddFloats(xRe, hRe, yRe) - xIm*hIm;
+      yIm = wideMulAddFloats(xIm, hRe, wideMulAddFloats(xRe, hIm, yIm));
+
+      wideStoreFloats(accRe + i, yRe);
+      wideStoreFloats(accIm + i, yIm);
+    }
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 CONVOLVER_MAC(convolverMACWide8_)
+{
+  for(u32 i = 0; i < count; i += 8)
+    {
+      WideFloat8 xRe = wideLoadFloats8(aRe + i);
+      WideFloat8 xIm = wideLoadFloats8(aIm + i);
+      WideFloat8 hRe = wideLoadFloats8(bRe + i);
+      WideFloat8 hIm = wideLoadFloats8(bIm + i);
+      WideFloat8 yRe = wideLoadFloats8(accRe + i);
+      WideFloat8 yIm = wideLoadFloats8(accIm + i);
+
+      yRe = wideSubFloats8(wideMulAddFloats8(xRe, hRe, yRe), wideMulFloats8(xIm, hIm));
+      yIm = wideMulAddFloats8(xIm, hRe, wideMulAddFloats8(xRe, hIm, yIm));
+
+      wideStoreFloats8(accRe + i, yRe);
+      wideStoreFloats8(accIm + i, yIm);
+    }
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 CONVOLVER_MAC(convolverMACWide16_)
+{
+  for(u32 i = 0; i < count; i += 16)
+    {
+      WideFloat16 xRe = wideLoadFloats16(aRe + i);
+      WideFloat16 xIm = wideLoadFloats16(aIm + i);
+      WideFloat16 hRe = wideLoadFloats16(bRe + i);
+      WideFloat16 hIm = wideLoadFloats16(bIm + i);
+      WideFloat16 yRe = wideLoadFloats16(accRe + i);
+      WideFloat16 yIm = wideLoadFloats16(accIm + i);
+
+      yRe = wideSubFloats16(wideMulAddFloats16(xRe, hRe, yRe), wideMulFloats16(xIm, hIm));
+      yIm = wideMulAddFloats16(xIm, hRe, wideMulAddFloats16(xRe, hIm, yIm));
+
+      wideStoreFloats16(accRe + i, yRe);
+      wideStoreFloats16(accIm + i, yIm);
+    }
+}
+#endif
+
+static void
+convolverMAC_(SimdLevel level, r32 *accRe, r32 *accIm, r32 *aRe, r32 *aIm, r32 *bRe, r32 *bIm, u32 count)
+{
+  switch(level)
+    {
+#if SIMD_HAS_WIDE16
+    case SimdLevel_wide16: { convolverMACWide16_(accRe, accIm, aRe, aIm, bRe, bIm, count); } break;
+#endif
+#if SIMD_HAS_WIDE8
+    case SimdLevel_wide8: { convolverMACWide8_(accRe, accIm, aRe, aIm, bRe, bIm, count); } break;
+#endif
+    case SimdLevel_wide4: { convolverMACWide_(accRe, accIm, aRe, aIm, bRe, bIm, count); } break;
+    default: { convolverMACScalar_(accRe, accIm, aRe, aIm, bRe, bIm, count); } break;
+    }
+}
+
+//
+// convolver
+//
+
+static void
+convolverInitializeSegment_(Arena *arena, ConvolverSegment *segment, u32 blockSize,
+			    r32 *impulse, u32 impulseCount)
+{
+  ArenaPushFlags zeroFlags = arenaFlagsZeroAlign(WIDE_MAX_WIDTH * sizeof(r32));
+  ArenaPushFlags noZeroFlags = arenaFlagsNoZeroAlign(WIDE_MAX_WIDTH * sizeof(r32));
+
+  u32 fftCount = 2*blockSize;
+  ASSERT(fftPlanSupportsCount(fftCount));
+
+  segment->blockSize = blockSize;
+  segment->binCount = blockSize + 1;
+  segment->paddedBinCount = ROUND_UP_TO_MULTIPLE(segment->binCount, WIDE_MAX_WIDTH);
+  segment->partitionCount = (impulseCount + blockSize - 1)/blockSize;
+
+  segment->forwardPlan = fftPlanCreate(arena, fftCount, FFT_Direction_forward);
+  segment->inversePlan = fftPlanCreate(arena, fftCount, FFT_Direction_inverse);
+
+  usz spectraCount = segment->partitionCount*segment->paddedBinCount;
+  segment->impulseRe = arenaPushArray(arena, spectraCount, r32, zeroFlags);
+  segment->impulseIm = arenaPushArray(arena, spectraCount, r32, zeroFlags);
+  segment->fdlRe = arenaPushArray(arena, spectraCount, r32, zeroFlags);
+  segment->fdlIm = arenaPushArray(arena, spectraCount, r32, zeroFlags);
+  segment->fdlHead = 0;
+
+  segment->inputWindow = arenaPushArray(arena, fftCount, r32, zeroFlags);
+  segment->inputFill = 0;
+
+  segment->accumulatorRe = arenaPushArray(arena, segment->paddedBinCount, r32, zeroFlags);
+  segment->accumulatorIm = arenaPushArray(arena, segment->paddedBinCount, r32, zeroFlags);
+  segment->spectrumRe = arenaPushArray(arena, fftCount, r32, noZeroFlags);
+  segment->spectrumIm = arenaPushArray(arena, fftCount, r32, noZeroFlags);
+  segment->timeDomain = arenaPushArray(arena, fftCount, r32, zeroFlags);
+  segment->pendingOutput = arenaPushArray(arena, blockSize, r32, zeroFlags);
+
+  // NOTE: partition spectra. each partition is zero-padded to the transform length, so the
+  //       second half of every inverse transform holds linear (not circular) convolution
+  r32 *partition = segment->timeDomain;
+  for(u32 partitionIdx = 0; partitionIdx < segment->partitionCount; ++partitionIdx)
+    {
+      u32 partitionStart = partitionIdx*blockSize;
+      u32 partitionCount = MIN(blockSize, impulseCount - partitionStart);
+      for(u32 i = 0; i < fftCount; ++i)
+	{
+	  partition[i] = (i < partitionCount) ? impulse[partitionStart + i] : 0.f;
+	}
+
+      fftPlanExecuteReal(segment->forwardPlan, segment->spectrumRe, segment->spectrumIm, partition);
+
+      r32 *destRe = segment->impulseRe + partitionIdx*segment->paddedBinCount;
+      r32 *destIm = segment->impulseIm + partitionIdx*segment->paddedBinCount;
+      COPY_ARRAY(destRe, segment->spectrumRe, segment->binCount, r32);
+      COPY_ARRAY(destIm, segment->spectrumIm, segment->binCount, r32);
+    }
+  ZERO_ARRAY(segment->timeDomain, fftCount, r32);
+}
+
+// NOTE: `blockSize` sets the latency. Pass maxBlockSize == blockSize for a uniform convolver, or a
+//       larger power-of-2 multiple of it for a non-uniform one. The impulse is copied, so the
+//       caller's buffer can be released afterwards
+static Convolver*
+convolverCreate(Arena *arena, r32 *impulse, u32 impulseCount, u32 blockSize, u32 maxBlockSize)
+{
+  ASSERT(impulseCount > 0);
+  ASSERT(maxBlockSize >= blockSize && (maxBlockSize % blockSize) == 0);
+
+  Convolver *result = arenaPushStruct(arena, Convolver, arenaFlagsZeroNoAlign());
+  result->blockSize = blockSize;
+  result->impulseCount = impulseCount;
+  result->simdLevel = simdGetLevel();
+
+  ArenaPushFlags flags = arenaFlagsZeroAlign(WIDE_MAX_WIDTH * sizeof(r32));
+  result->inputBlock = arenaPushArray(arena, blockSize, r32, flags);
+  result->outputBlock = arenaPushArray(arena, blockSize, r32, flags);
+  result->blockFill = 0;
+
+  // NOTE: segment s > 0 covers [blockSize_s, blockSize_(s+1)), so it always holds
+  //       CONVOLVER_SEGMENT_GROWTH - 1 partitions, except the last, which takes the rest of the
+  //       impulse. Segment 0 covers [0, blockSize_1)
+  u32 segmentStart = 0;
+  u32 segmentBlockSize = blockSize;
+  while(segmentStart < impulseCount)
+    {
+      ASSERT(result->segmentCount < CONVOLVER_MAX_SEGMENTS);
+
+      u32 nextBlockSize = segmentBlockSize*CONVOLVER_SEGMENT_GROWTH;
+      b32 isLast = ((nextBlockSize > maxBlockSize) ||
+		    (result->segmentCount + 1 == CONVOLVER_MAX_SEGMENTS));
+      u32 segmentEnd = isLast ? impulseCount : MIN(nextBlockSize, impulseCount);
+
+      ConvolverSegment *segment = result->segments + result->segmentCount++;
+      convolverInitializeSegment_(arena, segment, segmentBlockSize,
+				  impulse + segmentStart, segmentEnd - segmentStart);
+
+      segmentStart = segmentEnd;
+      segmentBlockSize = nextBlockSize;
+    }
+
+  return(result);
+}
+
+// NOTE: clears all history, as if the convolver had only ever been fed silence
+static void
+convolverReset(Convolver *convolver)
+{
+  ZERO_ARRAY(convolver->inputBlock, convolver->blockSize, r32);
+  ZERO_ARRAY(convolver->outputBlock, convolver->blockSize, r32);
+  convolver->blockFill = 0;
+
+  for(u32 segmentIdx = 0; segmentIdx < convolver->segmentCount; ++segmentIdx)
+    {
+      ConvolverSegment *segment = convolver->segments + segmentIdx;
+      usz spectraCount = segment->partitionCount*segment->paddedBinCount;
+      ZERO_ARRAY(segment->fdlRe, spectraCount, r32);
+      ZERO_ARRAY(segment->fdlIm, spectraCount, r32);
+      ZERO_ARRAY(segment->inputWindow, 2*segment->blockSize, r32);
+      ZERO_ARRAY(segment->pendingOutput, segment->blockSize, r32);
+      segment->fdlHead = 0;
+      segment->inputFill = 0;
+    }
+}
+
+// NOTE: one full segment block: transform the input window, push it onto the fdl, and
+//       accumulate the output spectrum. Writes blockSize output samples to `dest`
+static void
+convolverProcessSegment_(ConvolverSegment *segment, SimdLevel simdLevel, r32 *dest)
+{
+  u32 blockSize = segment->blockSize;
+  u32 binCount = segment->binCount;
+  u32 paddedBinCount = segment->paddedBinCount;
+  u32 fftCount = 2*blockSize;
+
+  fftPlanExecuteReal(segment->forwardPlan, segment->spectrumRe, segment->spectrumIm,
+		     segment->inputWindow);
+
+  segment->fdlHead = (segment->fdlHead == 0) ? segment->partitionCount - 1 : segment->fdlHead - 1;
+  r32 *headRe = segment->fdlRe + segment->fdlHead*paddedBinCount;
+  r32 *headIm = segment->fdlIm + segment->fdlHead*paddedBinCount;
+  COPY_ARRAY(headRe, segment->spectrumRe, binCount, r32);
+  COPY_ARRAY(headIm, segment->spectrumIm, binCount, r32);
+
+  // NOTE: entry k of the fdl, counting from the head, meets partition k
+  r32 *accRe = segment->accumulatorRe;
+  r32 *accIm = segment->accumulatorIm;
+  ZERO_ARRAY(accRe, paddedBinCount, r32);
+  ZERO_ARRAY(accIm, paddedBinCount, r32);
+  u32 fdlIndex = segment->fdlHead;
+  for(u32 partitionIdx = 0; partitionIdx < segment->partitionCount; ++partitionIdx)
+    {
+      convolverMAC_(simdLevel, accRe, accIm,
+		    segment->fdlRe + fdlIndex*paddedBinCount,
+		    segment->fdlIm + fdlIndex*paddedBinCount,
+		    segment->impulseRe + partitionIdx*paddedBinCount,
+		    segment->impulseIm + partitionIdx*paddedBinCount,
+		    paddedBinCount);
+
+      ++fdlIndex;
+      if(fdlIndex == segment->partitionCount) fdlIndex = 0;
+    }
+
+  // NOTE: restore the redundant half of the spectrum, for the real inverse transform
+  r32 *spectrumRe = segment->spectrumRe;
+  r32 *spectrumIm = segment->spectrumIm;
+  COPY_ARRAY(spectrumRe, accRe, binCount, r32);
+  COPY_ARRAY(spectrumIm, accIm, binCount, r32);
+  for(u32 bin = 1; bin < blockSize; ++bin)
+    {
+      spectrumRe[fftCount - bin] = accRe[bin];
+      spectrumIm[fftCount - bin] = -accIm[bin];
+    }
+
+  ifftPlanExecuteReal(segment->inversePlan, segment->timeDomain, spectrumRe, spectrumIm);
+  COPY_ARRAY(dest, segment->timeDomain + blockSize, blockSize, r32);
+
+  // NOTE: slide the input window
+  COPY_ARRAY(segment->inputWindow, segment->inputWindow + blockSize, blockSize, r32);
+  segment->inputFill = 0;
+}
+
+// NOTE: one convolver block, from inputBlock to outputBlock
+static void
+convolverProcessBlock_(Convolver *convolver)
+{
+  u32 blockSize = convolver->blockSize;
+  r32 *input = convolver->inputBlock;
+  r32 *output = convolver->outputBlock;
+
+  ZERO_ARRAY(output, blockSize, r32);
+  for(u32 segmentIdx = 0; segmentIdx < convolver->segmentCount; ++segmentIdx)
+    {
+      ConvolverSegment *segment = convolver->segments + segmentIdx;
+      u32 readIndex = segment->inputFill;
+
+      COPY_ARRAY(segment->inputWindow + segment->blockSize + segment->inputFill, input, blockSize, r32);
+      segment->inputFill += blockSize;
+
+      if(segmentIdx == 0)
+	{
+	  convolverProcessSegment_(segment, convolver->simdLevel, segment->pendingOutput);
+	  for(u32 i = 0; i < blockSize; ++i) output[i] += segment->pendingOutput[i];
+	}
+      else
+	{
+	  // NOTE: this block's slice of what the segment computed last time, before it's replaced
+	  for(u32 i = 0; i < blockSize; ++i) output[i] += segment->pendingOutput[readIndex + i];
+
+	  if(segment->inputFill == segment->blockSize)
+	    {
+	      convolverProcessSegment_(segment, convolver->simdLevel, segment->pendingOutput);
+	    }
+	}
+    }
+}
+
+// NOTE: convolves `count` samples of `input` into `output`, which may alias. Output is delayed by
+//       the convolver's block size
+static void
+convolverProcess(Convolver *convolver, r32 *output, r32 *input, u32 count)
+{
+  PROFILE_FUNCTION();
+
+  u32 blockSize = convolver->blockSize;
+  u32 processed = 0;
+  while(processed < count)
+    {
+      u32 fill = convolver->blockFill;
+      u32 chunkCount = MIN(blockSize - fill, count - processed);
+      for(u32 i = 0; i < chunkCount; ++i)
+	{
+	  r32 inputSample = input[processed + i];
+	  output[processed + i] = convolver->outputBlock[fill + i];
+	  convolver->inputBlock[fill + i] = inputSample;
+	}
+
+      processed += chunkCount;
+      convolver->blockFill += chunkCount;
+      if(convolver->blockFill == blockSize)
+	{
+	  convolverProcessBlock_(convolver);
+	  convolver->blockFill = 0;
+	}
+    }
+}
@@ -0,0 +1,403 @@
+//
+// disk recorder
+//
+
+// NOTE: builds the DISK_RECORDER_HEADER_SIZE bytes in front of the sample data, for `frameCount`
+//       frames. The chunk after WAVE is JUNK in riff files, and becomes ds64 in rf64 ones, so the
+//       header never changes size
+static void
+diskRecorderBuildHeader_(u8 *header, u32 sampleRate, u64 frameCount)
+{
+  ZERO_SIZE(header, DISK_RECORDER_HEADER_SIZE);
+
+  u32 bytesPerFrame = DISK_RECORDER_CHANNELS*sizeof(r32);
+  u64 dataSize = frameCount*bytesPerFrame;
+  u64 riffSize = DISK_RECORDER_HEADER_SIZE + dataSize - sizeof(RiffHeader);
+  b32 isRF64 = (riffSize > u32_MAX);
+
+  u8 *at = header;
+  RiffHeader *riffHeader = (RiffHeader *)at; at += sizeof(RiffHeader);
+  riffHeader->chunkID.id = isRF64 ? RIFF("RF64") : RIFF("RIFF");
+  riffHeader->chunkSize = isRF64 ? u32_MAX : (u32)riffSize;
+
+  WaveHeader *waveHeader = (WaveHeader *)at; at += sizeof(WaveHeader);
+  waveHeader->waveID.id = RIFF("WAVE");
+
+  WaveDs64Chunk *ds64 = (WaveDs64Chunk *)at; at += sizeof(WaveDs64Chunk);
+  ds64->header.chunkID.id = isRF64 ? RIFF("ds64") : RIFF("JUNK");
+  ds64->header.chunkSize = sizeof(WaveDs64Chunk) - sizeof(RiffHeader);
+  if(isRF64)
+    {
+      ds64->riffSize = riffSize;
+      ds64->dataSize = dataSize;
+      ds64->sampleCount = frameCount;
+    }
+
+  WaveFormatChunk *fmt = (WaveFormatChunk *)at; at += sizeof(WaveFormatChunk);
+  fmt->header.chunkID.id = RIFF("fmt ");
+  fmt->header.chunkSize = sizeof(WaveFormatChunk) - sizeof(RiffHeader);
+  fmt->formatTag = WAV_FORMAT_IEEE_FLOAT;
+  fmt->channelCount = DISK_RECORDER_CHANNELS;
+  fmt->sampleRate = sampleRate;
+  fmt->avgBytesPerSec = sampleRate*bytesPerFrame;
+  fmt->dataBlockSize = (u16)bytesPerFrame;
+  fmt->bitsPerSample = 8*sizeof(r32);
+
+  // NOTE: non-pcm files should have a fact chunk
+  RiffHeader *fact = (RiffHeader *)at; at += sizeof(RiffHeader);
+  fact->chunkID.id = RIFF("fact");
+  fact->chunkSize = sizeof(u32);
+  *(u32 *)at = isRF64 ? u32_MAX : (u32)frameCount; at += sizeof(u32);
+
+  u8 *dataHeaderAt = header + DISK_RECORDER_HEADER_SIZE - sizeof(WaveDataChunk);
+  RiffHeader *junk = (RiffHeader *)at;
+  junk->chunkID.id = RIFF("JUNK");
+  junk->chunkSize = (u32)(dataHeaderAt - (at + sizeof(RiffHeader)));
+
+  WaveDataChunk *data = (WaveDataChunk *)dataHeaderAt;
+  data->chunkID.id = RIFF("data");
+  data->chunkSize = isRF64 ? u32_MAX : (u32)dataSize;
+}
+
+static b32
+diskRecorderWriteHeaders_(DiskRecorder *recorder)
+{
+  u8 header[DISK_RECORDER_HEADER_SIZE];
+  u32 sampleRate = gsAtomicLoad(&recorder->sampleRate);
+  diskRecorderBuildHeader_(header, sampleRate ? sampleRate : INTERNAL_SAMPLE_RATE,
+			   recorder->flushedFrameCount);
+
+  b32 result = true;
+  for(u32 trackIndex = 0; trackIndex < recorder->trackCount; ++trackIndex)
+    {
+      result = result && gsWriteFileAt(recorder->files[trackIndex], 0, bufferMake(header, sizeof(header)));
+    }
+  ++recorder->headerUpdateCount;
+
+  return(result);
+}
+
+// NOTE: writes the chunks' frames to every track, then updates the headers to match. After a
+//       failed write the writer keeps draining the ring, so the audio thread isn't held up, but
+//       writes nothing else
+static void
+diskRecorderFlushChunks_(DiskRecorder *recorder)
+{
+  if(recorder->chunkFill && !recorder->stats.writeFailed)
+    {
+      usz chunkSize = (usz)recorder->chunkFill*DISK_RECORDER_CHANNELS*sizeof(r32);
+      u64 offset = DISK_RECORDER_HEADER_SIZE + recorder->flushedFrameCount*DISK_RECORDER_CHANNELS*sizeof(r32);
+      b32 written = true;
+      for(u32 trackIndex = 0; trackIndex < recorder->trackCount; ++trackIndex)
+	{
+	  Buffer chunk = bufferMake((u8 *)recorder->chunks[trackIndex], chunkSize);
+	  written = written && gsWriteFileAt(recorder->files[trackIndex], offset, chunk);
+	}
+
+      if(written)
+	{
+	  recorder->flushedFrameCount += recorder->chunkFill;
+	  written = diskRecorderWriteHeaders_(recorder);
+	}
+      if(!written)
+	{
+	  logString("ERROR: disk recorder write failed, recording stopped\n");
+	  recorder->stats.writeFailed = true;
+	}
+    }
+
+  recorder->chunkFill = 0;
+}
+
+// NOTE: appends frames to every track's chunk, flushing the chunks as they fill. Null samples
+//       append silence
+static void
+diskRecorderAppendFrames_(DiskRecorder *recorder, r32 *samples, u64 frameCount)
+{
+  u32 frameStride = recorder->trackCount*DISK_RECORDER_CHANNELS;
+  while(frameCount)
+    {
+      u32 framesToCopy = (u32)MIN(frameCount, (u64)(DISK_RECORDER_CHUNK_FRAMES - recorder->chunkFill));
+      for(u32 trackIndex = 0; trackIndex < recorder->trackCount; ++trackIndex)
+	{
+	  r32 *dest = recorder->chunks[trackIndex] + recorder->chunkFill*DISK_RECORDER_CHANNELS;
+	  if(samples)
+	    {
+	      r32 *src = samples + trackIndex*DISK_RECORDER_CHANNELS;
+	      for(u32 frameIndex = 0; frameIndex < framesToCopy; ++frameIndex)
+		{
+		  dest[DISK_RECORDER_CHANNELS*frameIndex + 0] = src[frameStride*frameIndex + 0];
+		  dest[DISK_RECORDER_CHANNELS*frameIndex + 1] = src[frameStride*frameIndex + 1];
+		}
+	    }
+	  else
+	    {
+	      ZERO_ARRAY(dest, framesToCopy*DISK_RECORDER_CHANNELS, r32);
+	    }
+	}
+
+      if(samples) samples += framesToCopy*frameStride;
+      frameCount -= framesToCopy;
+      recorder->chunkFill += framesToCopy;
+      recorder->stats.writtenFrameCount += framesToCopy;
+      if(recorder->chunkFill == DISK_RECORDER_CHUNK_FRAMES)
+	{
+	  diskRecorderFlushChunks_(recorder);
+	}
+    }
+}
+
+static void
+diskRecorderThreadProc(void *data)
+{
+  DiskRecorder *recorder = (DiskRecorder *)data;
+
+  for(;;)
+    {
+      // NOTE: the state is loaded first: once it's stopping, the last block is already queued
+      u32 state = gsAtomicLoad(&recorder->state);
+      u32 readIndex = recorder->blockReadIndex;
+      u32 writeIndex = gsAtomicLoad(&recorder->blockWriteIndex);
+      if(readIndex == writeIndex)
+	{
+	  if(state == DiskRecorderState_stopping) break;
+
+	  gsSleep(DISK_RECORDER_POLL_MSEC);
+	  continue;
+	}
+
+      for(; readIndex != writeIndex; ++readIndex)
+	{
+	  DiskRecorderBlock *block = recorder->blocks + (readIndex & recorder->blockMask);
+	  u64 gapFrameCount = block->streamFrame - recorder->stats.writtenFrameCount;
+	  if(gapFrameCount)
+	    {
+	      logFormatString("WARNING: disk recorder dropped %llu frames at frame %llu\n",
+			      gapFrameCount, recorder->stats.writtenFrameCount);
+	      ++recorder->stats.dropoutCount;
+	      recorder->stats.droppedFrameCount += gapFrameCount;
+	      diskRecorderAppendFrames_(recorder, 0, gapFrameCount);
+	    }
+	  diskRecorderAppendFrames_(recorder, block->samples, block->frameCount);
+	}
+      gsAtomicStore(&recorder->blockReadIndex, readIndex);
+    }
+
+  // NOTE: frames dropped after the last block was queued are still a dropout
+  u64 gapFrameCount = recorder->streamFrame - recorder->stats.writtenFrameCount;
+  if(gapFrameCount)
+    {
+      ++recorder->stats.dropoutCount;
+      recorder->stats.droppedFrameCount += gapFrameCount;
+      diskRecorderAppendFrames_(recorder, 0, gapFrameCount);
+    }
+  diskRecorderFlushChunks_(recorder);
+  if(recorder->stats.dropoutCount)
+    {
+      logFormatString("WARNING: disk recorder had %u dropouts, %llu frames in all\n",
+		      recorder->stats.dropoutCount, recorder->stats.droppedFrameCount);
+    }
+
+  for(u32 trackIndex = 0; trackIndex < recorder->trackCount; ++trackIndex)
+    {
+      gsCloseFile(recorder->files[trackIndex]);
+      recorder->files[trackIndex] = 0;
+    }
+
+  gsAtomicStore(&recorder->state, DiskRecorderState_idle);
+}
+
+// NOTE: the recorder's memory is allocated once, and reused by every recording, so the audio thread
+//       can hold on to it safely. `allocator` must outlive the recorder
+static DiskRecorder *
+diskRecorderCreate(Arena *allocator)
+{
+  DiskRecorder *result = arenaPushStruct(allocator, DiskRecorder, arenaFlagsZeroNoAlign());
+
+  STATIC_ASSERT(IS_POWER_OF_2(DISK_RECORDER_BLOCK_COUNT), diskRecorderBlockCountCheck);
+  STATIC_ASSERT((DISK_RECORDER_CHUNK_FRAMES*DISK_RECORDER_CHANNELS*sizeof(r32)) % DISK_RECORDER_HEADER_SIZE == 0,
+		diskRecorderChunkAlignmentCheck);
+
+  ArenaPushFlags flags = arenaFlagsNoZeroAlign(DISK_RECORDER_HEADER_SIZE);
+  usz blockSampleCount = DISK_RECORDER_BLOCK_FRAMES*DiskRecorderTrack_count*DISK_RECORDER_CHANNELS;
+  result->blockMask = DISK_RECORDER_BLOCK_COUNT - 1;
+  result->blocks = arenaPushArray(allocator, DISK_RECORDER_BLOCK_COUNT, DiskRecorderBlock, arenaFlagsZeroNoAlign());
+  r32 *blockSamples = arenaPushArray(allocator, DISK_RECORDER_BLOCK_COUNT*blockSampleCount, r32, flags);
+  for(u32 blockIndex = 0; blockIndex < DISK_RECORDER_BLOCK_COUNT; ++blockIndex)
+    {
+      result->blocks[blockIndex].samples = blockSamples + blockIndex*blockSampleCount;
+    }
+  for(u32 trackIndex = 0; trackIndex < DiskRecorderTrack_count; ++trackIndex)
+    {
+      result->chunks[trackIndex] = arenaPushArray(allocator, DISK_RECORDER_CHUNK_FRAMES*DISK_RECORDER_CHANNELS,
+						  r32, flags);
+    }
+
+  return(result);
+}
+
+// NOTE: starts recording the output to `outputPath`, and the input to `inputPath` if it isn't null.
+//       Returns false if the recorder is still busy, a file can't be opened, or the host can't
+//       start the writer thread
+static b32
+diskRecorderStart(DiskRecorder *recorder, char *outputPath, char *inputPath)
+{
+  if(gsAtomicLoad(&recorder->state) != DiskRecorderState_idle) return(false);
+
+  char *paths[DiskRecorderTrack_count] = {outputPath, inputPath};
+  recorder->trackCount = inputPath ? 2 : 1;
+
+  b32 result = true;
+  for(u32 trackIndex = 0; trackIndex < recorder->trackCount; ++trackIndex)
+    {
+      recorder->files[trackIndex] = result ? gsOpenFileForWriting(paths[trackIndex], true) : 0;
+      result = result && (recorder->files[trackIndex] != 0);
+    }
+
+  if(result)
+    {
+      recorder->sampleRate = 0;
+      recorder->streamFrame = 0;
+      recorder->hasBlock = false;
+      recorder->audioDroppedFrameCount = 0;
+      recorder->blockWriteIndex = 0;
+      recorder->blockReadIndex = 0;
+      recorder->chunkFill = 0;
+      recorder->flushedFrameCount = 0;
+      recorder->headerUpdateCount = 0;
+      ZERO_STRUCT(&recorder->stats);
+
+      // NOTE: an empty recording is still a valid file
+      result = diskRecorderWriteHeaders_(recorder);
+    }
+
+  if(result)
+    {
+      gsAtomicStore(&recorder->state, DiskRecorderState_recording);
+      if(!gsStartThread(diskRecorderThreadProc, recorder))
+	{
+	  logString("ERROR: could not start the disk recorder thread\n");
+	  gsAtomicStore(&recorder->state, DiskRecorderState_idle);
+	  result = false;
+	}
+    }
+
+  if(!result)
+    {
+      for(u32 trackIndex = 0; trackIndex < recorder->trackCount; ++trackIndex)
+	{
+	  if(recorder->files[trackIndex]) gsCloseFile(recorder->files[trackIndex]);
+	  recorder->files[trackIndex] = 0;
+	}
+    }
+
+  return(result);
+}
+
+static inline b32
+diskRecorderIsRecording(DiskRecorder *recorder)
+{
+  b32 result = (gsAtomicLoad(&recorder->state) == DiskRecorderState_recording);
+  return(result);
+}
+
+// NOTE: audio thread. `input` is ignored unless the input is being recorded. Never blocks: frames
+//       that don't fit in the ring are dropped, and so are whole pushes that race with stopping
+static void
+diskRecorderPushSamples(DiskRecorder *recorder, SamplePair *output, SamplePair *input, u32 frameCount,
+			u32 sampleRate)
+{
+  if(gsAtomicCompareAndSwap(&recorder->fillLock, 0, 1) != 0) return;
+
+  if(gsAtomicLoad(&recorder->state) == DiskRecorderState_recording)
+    {
+      if(!recorder->sampleRate) gsAtomicStore(&recorder->sampleRate, sampleRate);
+
+      u32 frameStride = recorder->trackCount*DISK_RECORDER_CHANNELS;
+      u32 frameIndex = 0;
+      while(frameIndex < frameCount)
+	{
+	  u32 writeIndex = recorder->blockWriteIndex;
+	  DiskRecorderBlock *block = recorder->blocks + (writeIndex & recorder->blockMask);
+	  if(!recorder->hasBlock)
+	    {
+	      u32 readIndex = gsAtomicLoad(&recorder->blockReadIndex);
+	      if(writeIndex - readIndex > recorder->blockMask)
+		{
+		  // NOTE: the ring is full. The stream position still moves on, which is how the
+		  //       writer finds the gap
+		  u32 droppedCount = frameCount - frameIndex;
+		  recorder->audioDroppedFrameCount += droppedCount;
+		  recorder->streamFrame += droppedCount;
+		  break;
+		}
+
+	      block->streamFrame = recorder->streamFrame;
+	      block->frameCount = 0;
+	      recorder->hasBlock = true;
+	    }
+
+	  u32 framesToCopy = MIN(frameCount - frameIndex, DISK_RECORDER_BLOCK_FRAMES - block->frameCount);
+	  r32 *dest = block->samples + block->frameCount*frameStride;
+	  for(u32 i = 0; i < framesToCopy; ++i, dest += frameStride)
+	    {
+	      dest[0] = output[frameIndex + i].left;
+	      dest[1] = output[frameIndex + i].right;
+	    }
+	  if(recorder->trackCount > 1)
+	    {
+	      dest = block->samples + block->frameCount*frameStride + DISK_RECORDER_CHANNELS;
+	      for(u32 i = 0; i < framesToCopy; ++i, dest += frameStride)
+		{
+		  dest[0] = input[frameIndex + i].left;
+		  dest[1] = input[frameIndex + i].right;
+		}
+	    }
+
+	  frameIndex += framesToCopy;
+	  block->frameCount += framesToCopy;
+	  recorder->streamFrame += framesToCopy;
+	  if(block->frameCount == DISK_RECORDER_BLOCK_FRAMES)
+	    {
+	      gsAtomicStore(&recorder->blockWriteIndex, writeIndex + 1);
+	      recorder->hasBlock = false;
+	    }
+	}
+    }
+
+  gsAtomicStore(&recorder->fillLock, 0);
+}
+
+// NOTE: queues the last partial block, and lets the writer finish in the background. Any thread
+//       but the audio thread; it may wait for one audio push to finish
+static void
+diskRecorderStop(DiskRecorder *recorder)
+{
+  while(gsAtomicCompareAndSwap(&recorder->fillLock, 0, 1) != 0)
+    {
+      gsSleep(0);
+    }
+
+  if(gsAtomicLoad(&recorder->state) == DiskRecorderState_recording)
+    {
+      if(recorder->hasBlock)
+	{
+	  gsAtomicStore(&recorder->blockWriteIndex, recorder->blockWriteIndex + 1);
+	  recorder->hasBlock = false;
+	}
+      gsAtomicStore(&recorder->state, DiskRecorderState_stopping);
+    }
+
+  gsAtomicStore(&recorder->fillLock, 0);
+}
+
+// NOTE: stops recording, and waits for the writer to close the files
+static void
+diskRecorderStopAndWait(DiskRecorder *recorder)
+{
+  diskRecorderStop(recorder);
+  while(gsAtomicLoad(&recorder->state) != DiskRecorderState_idle)
+    {
+      gsSleep(1);
+    }
+}
@@ -0,0 +1,75 @@
+// NOTE: records the plugin's output, and optionally its input, to 32-bit float wave files. The audio
+//       thread copies frames into fixed-size blocks of a single-producer ring, and never touches
+//       the filesystem; a writer thread drains the ring, and writes each track in
+//       DISK_RECORDER_CHUNK_FRAMES chunks. Sample data starts DISK_RECORDER_HEADER_SIZE bytes in,
+//       behind a JUNK pad, so every full chunk lands on an aligned offset. The header is rewritten
+//       after every chunk, so a recording cut short is still a valid file up to its last chunk, and
+//       it becomes rf64 once the data passes 4GB.
+//       When the writer falls behind and the ring fills, the audio thread drops frames, but keeps
+//       counting them: each block carries the stream position of its first frame, so the writer
+//       sees the gap, reports it, and fills it with silence to keep the tracks in time
+#define DISK_RECORDER_BLOCK_FRAMES 1024
+#define DISK_RECORDER_BLOCK_COUNT 256 // NOTE: about 5 seconds at 48kHz
+#define DISK_RECORDER_CHUNK_FRAMES 32768
+#define DISK_RECORDER_CHANNELS 2
+#define DISK_RECORDER_HEADER_SIZE 4096
+#define DISK_RECORDER_POLL_MSEC 5
+
+enum DiskRecorderTrack
+{
+  DiskRecorderTrack_output,
+  DiskRecorderTrack_input,
+  DiskRecorderTrack_count,
+};
+
+enum DiskRecorderState
+{
+  DiskRecorderState_idle,      // NOTE: no writer, files closed
+  DiskRecorderState_recording,
+  DiskRecorderState_stopping,  // NOTE: the last block is queued, and the writer is draining the ring
+};
+
+struct DiskRecorderBlock
+{
+  u64 streamFrame; // NOTE: stream position of the block's first frame
+  u32 frameCount;
+  r32 *samples;    // NOTE: [DISK_RECORDER_BLOCK_FRAMES][trackCount][DISK_RECORDER_CHANNELS]
+};
+
+// NOTE: written by the writer thread as it goes, so they can be read any time, but are only final
+//       once the recorder is idle again
+struct DiskRecorderStats
+{
+  u64 writtenFrameCount;  // NOTE: per track, including silence that filled dropouts
+  u64 droppedFrameCount;
+  u32 dropoutCount;
+  b32 writeFailed;
+};
+
+struct DiskRecorder
+{
+  u32 trackCount;
+  GS_File files[DiskRecorderTrack_count];
+  volatile u32 sampleRate; // NOTE: taken from the first frames the audio thread pushes
+  volatile u32 state;
+
+  // NOTE: held by whoever is filling the current block. The audio thread only ever tries to take
+  //       it, and skips its push if it can't; stopping takes it to queue the last partial block
+  volatile u32 fillLock;
+  u64 streamFrame;
+  b32 hasBlock;
+  u64 audioDroppedFrameCount;
+
+  u32 blockMask;
+  DiskRecorderBlock *blocks;
+  volatile u32 blockWriteIndex;
+  volatile u32 blockReadIndex;
+
+  // NOTE: writer thread only
+  r32 *chunks[DiskRecorderTrack_count]; // NOTE: [DISK_RECORDER_CHUNK_FRAMES][DISK_RECORDER_CHANNELS]
+  u32 chunkFill;
+  u64 flushedFrameCount;
+  u64 headerUpdateCount;
+
+  DiskRecorderStats stats;
+};
@@ -94,7 +94,7 @@ static FFT_FUNCTION(fft_dit_radix2_simd)
 {
   PROFILE_FUNCTION();
 
-  u32 simdWidth = 4; // TODO: make this a constant set in `simd_intrinsics.h`
+  u32 simdWidth = WIDE_WIDTH;
 
   usz count = ROUND_UP_POW_2(input.count);
   r32 *reVals = arenaPushArray(arena, count, r32, arenaFlagsNoZeroAlign(simdWidth * sizeof(r32)));
@@ -275,7 +275,7 @@ static IFFT_FUNCTION(ifft_dit_radix2_simd)
 {
   PROFILE_FUNCTION();
 
-  u32 simdWidth = 4; // TODO: make this a constant set in `simd_intrinsics.h`
+  u32 simdWidth = WIDE_WIDTH;
 
   usz count = ROUND_UP_POW_2(input.count);
   r32 *reVals = arenaPushArray(arena, count, r32, arenaFlagsNoZeroAlign(simdWidth * sizeof(r32)));
@@ -385,6 +385,1684 @@ static IFFT_Function *ifftFunctions[] = {
   ifft_dit_radix2_simd,
 };
 
+//
+// plans
+//
+
+// NOTE: a plan holds the tables a transform of one size and direction needs, so that executing
+//       it does no trig and no allocation. Create plans up front (e.g. in
+//       `initializePluginState`), then execute them wherever, including the audio thread.
+//       Plans are read-only during execution, except for their scratch buffers, so a plan should
+//       only be executed on one thread at a time.
+
+enum FFT_Direction
+{
+  FFT_Direction_forward,
+  FFT_Direction_inverse,
+};
+
+// NOTE: one pass over the data, combining `radix` sub-transforms whose matching elements sit
+//       `stride` apart. Twiddle row q-1 (for q = 1..radix-1) holds W^(j*q) for j < stride, where W
+//       is the root of unity of order radix*stride
+struct FFT_PlanStage
+{
+  u32 radix;
+  u32 stride;
+  r32 *twiddlesRe;
+  r32 *twiddlesIm;
+};
+
+#define FFT_PLAN_MAX_STAGES 32
+
+struct FFT_Plan
+{
+  u32 count;
+  FFT_Direction direction;
+
+  // NOTE: the input index that lands at each position before the first stage, ie the index with
+  //       its digits reversed. For power-of-2 counts this is the bit reversal, which is its own
+  //       inverse, so complex transforms can permute in place
+  u32 *permutation;
+  b32 isPowerOf2;
+
+  u32 stageCount;
+  FFT_PlanStage stages[FFT_PLAN_MAX_STAGES];
+
+  // NOTE: holds the input of complex transforms that can't permute in place, and the imaginary
+  //       part of real-output inverse transforms
+  r32 *scratchRe;
+  r32 *scratchIm;
+
+  // NOTE: the widest kernel stages may use. Set from `simdGetLevel()` at creation, and only
+  //       lowered afterwards (e.g. by the tests, to check every width against the same target)
+  SimdLevel simdLevel;
+};
+
+// NOTE: plans support counts whose only prime factors are 2, 3 and 5
+static b32
+fftPlanSupportsCount(usz count)
+{
+  usz remaining = count;
+  if(remaining) while(remaining % 2 == 0) remaining /= 2;
+  if(remaining) while(remaining % 3 == 0) remaining /= 3;
+  if(remaining) while(remaining % 5 == 0) remaining /= 5;
+
+  b32 result = (count >= 2) && (remaining == 1);
+  return(result);
+}
+
+// NOTE: rough cost of one pass per point, for each stage radix, from the plan benchmark in the
+//       tests. The odd-radix kernels only go up to 4 lanes, so radix-5 passes cost about twice
+//       what radix-4 ones do, and counts with several factors of 5 run slower than the power of 2
+//       above them (1000 vs 1024, 16000 vs 16384)
+#define FFT_PLAN_COST_RADIX2 2.8f
+#define FFT_PLAN_COST_RADIX3 1.5f
+#define FFT_PLAN_COST_RADIX4 1.3f
+#define FFT_PLAN_COST_RADIX5 2.2f
+
+// NOTE: estimates the time a plan for `count` takes, from the stages fftPlanCreate would build
+static r32
+fftPlanEstimateCost(usz count)
+{
+  usz remaining = count;
+  u32 twoCount = 0;
+  r32 costPerPoint = 0.f;
+  while(remaining % 2 == 0) { ++twoCount; remaining /= 2; }
+  if(twoCount & 1) { costPerPoint += FFT_PLAN_COST_RADIX2; }
+  costPerPoint += (r32)(twoCount/2)*FFT_PLAN_COST_RADIX4;
+  while(remaining % 3 == 0) { costPerPoint += FFT_PLAN_COST_RADIX3; remaining /= 3; }
+  while(remaining % 5 == 0) { costPerPoint += FFT_PLAN_COST_RADIX5; remaining /= 5; }
+  ASSERT(remaining == 1);
+
+  r32 result = (r32)count*costPerPoint;
+  return(result);
+}
+
+// NOTE: the count to zero-pad transforms of `minCount` samples to. That's the smallest supported
+//       count that holds them, unless the power of 2 above it is estimated to run faster
+static usz
+fftPlanGoodCount(usz minCount)
+{
+  usz result = MAX(minCount, 2);
+  while(!fftPlanSupportsCount(result))
+    {
+      ++result;
+    }
+
+  usz powerOf2Count = ROUND_UP_POW_2(result);
+  if(fftPlanEstimateCost(powerOf2Count) < fftPlanEstimateCost(result))
+    {
+      result = powerOf2Count;
+    }
+
+  return(result);
+}
+
+static FFT_Plan*
+fftPlanCreate(Arena *arena, usz count, FFT_Direction direction)
+{
+  ArenaPushFlags flags = arenaFlagsNoZeroAlign(WIDE_MAX_WIDTH * sizeof(r32));
+
+  ASSERT(fftPlanSupportsCount(count));
+
+  FFT_Plan *result = arenaPushStruct(arena, FFT_Plan);
+  result->count = (u32)count;
+  result->direction = direction;
+  result->isPowerOf2 = IS_POWER_OF_2(count);
+
+  // NOTE: power-of-2 radices go first, so the odd-radix stages that follow have strides that are
+  //       multiples of the simd width. A leftover radix-2 stage goes at stride 1, where its
+  //       twiddles are trivial
+  u32 remaining = (u32)count;
+  u32 stageCount = 0;
+  u32 twoCount = 0;
+  while(remaining % 2 == 0) { ++twoCount; remaining /= 2; }
+  if(twoCount & 1) { result->stages[stageCount++].radix = 2; }
+  for(u32 i = 0; i < twoCount/2; ++i) { result->stages[stageCount++].radix = 4; }
+  while(remaining % 3 == 0) { result->stages[stageCount++].radix = 3; remaining /= 3; }
+  while(remaining % 5 == 0) { result->stages[stageCount++].radix = 5; remaining /= 5; }
+  ASSERT(remaining == 1 && stageCount <= FFT_PLAN_MAX_STAGES);
+  result->stageCount = stageCount;
+
+  // NOTE: the radix-4 kernels fuse two radix-2 stages, so they expect bit-reversed order within
+  //       each group of 4. Their digits are reversed as two binary digits
+  u32 digits[2*FFT_PLAN_MAX_STAGES] = {};
+  u32 digitCount = 0;
+  for(u32 stageIdx = 0; stageIdx < stageCount; ++stageIdx)
+    {
+      u32 radix = result->stages[stageIdx].radix;
+      if(radix == 4)
+	{
+	  digits[digitCount++] = 2;
+	  digits[digitCount++] = 2;
+	}
+      else
+	{
+	  digits[digitCount++] = radix;
+	}
+    }
+
+  result->permutation = arenaPushArray(arena, count, u32, flags);
+  for(u32 position = 0; position < count; ++position)
+    {
+      u32 index = 0;
+      u32 scale = 1;
+      u32 span = (u32)count;
+      u32 rest = position;
+      for(s32 digitIdx = digitCount - 1; digitIdx >= 0; --digitIdx)
+	{
+	  u32 radix = digits[digitIdx];
+	  span /= radix;
+	  index += scale*(rest / span);
+	  rest %= span;
+	  scale *= radix;
+	}
+      result->permutation[position] = index;
+    }
+
+  // NOTE: every twiddle is computed from its own angle, rather than by repeated rotation, so
+  //       error doesn't accumulate along a stage
+  r32 sign = (direction == FFT_Direction_forward) ? -1.f : 1.f;
+  u32 stride = 1;
+  for(u32 stageIdx = 0; stageIdx < stageCount; ++stageIdx)
+    {
+      FFT_PlanStage *stage = result->stages + stageIdx;
+      u32 span = stage->radix*stride;
+      u32 twiddleCount = (stage->radix - 1)*stride;
+
+      stage->stride = stride;
+      stage->twiddlesRe = arenaPushArray(arena, twiddleCount, r32, flags);
+      stage->twiddlesIm = arenaPushArray(arena, twiddleCount, r32, flags);
+      for(u32 q = 1; q < stage->radix; ++q)
+	{
+	  for(u32 j = 0; j < stride; ++j)
+	    {
+	      r32 theta = sign * 2.f * GS_PI * (r32)((j*q) % span) / (r32)span;
+	      stage->twiddlesRe[(q - 1)*stride + j] = gsCos(theta);
+	      stage->twiddlesIm[(q - 1)*stride + j] = gsSin(theta);
+	    }
+	}
+
+      stride = span;
+    }
+
+  result->scratchRe = arenaPushArray(arena, count, r32, flags);
+  result->scratchIm = arenaPushArray(arena, count, r32, flags);
+  result->simdLevel = simdGetLevel();
+
+  return(result);
+}
+
+// NOTE: each stage kernel runs every butterfly of one stage, in place. The wide kernels need the
+//       stage's stride to be a multiple of their width. `sign` is -1 for forward transforms and
+//       +1 for inverse ones
+#define FFT_PLAN_STAGE(name) void (name)(r32 *reVals, r32 *imVals, FFT_PlanStage *stage, u32 count, r32 sign)
+
+static FFT_PLAN_STAGE(fftPlanRadix2Scalar_)
+{
+  UNUSED(sign);
+  u32 half = stage->stride;
+  r32 *stageRe = stage->twiddlesRe;
+  r32 *stageIm = stage->twiddlesIm;
+  for(u32 k = 0; k < count; k += 2*half)
+    {
+      r32 *at0Re = reVals + k;
+      r32 *at0Im = imVals + k;
+      r32 *at1Re = reVals + k + half;
+      r32 *at1Im = imVals + k + half;
+      for(u32 j = 0; j < half; ++j)
+	{
+	  r32 wRe = stageRe[j];
+	  r32 wIm = stageIm[j];
+	  r32 in0Re = at0Re[j];
+	  r32 in0Im = at0Im[j];
+	  r32 in1Re = at1Re[j];
+	  r32 in1Im = at1Im[j];
+
+	  r32 tRe = wRe*in1Re - wIm*in1Im;
+	  r32 tIm = wRe*in1Im + wIm*in1Re;
+
+	  at0Re[j] = in0Re + tRe;
+	  at0Im[j] = in0Im + tIm;
+	  at1Re[j] = in0Re - tRe;
+	  at1Im[j] = in0Im - tIm;
+	}
+    }
+}
+
+static FFT_PLAN_STAGE(fftPlanRadix2Wide_)
+{
+  UNUSED(sign);
+  u32 half = stage->stride;
+  r32 *stageRe = stage->twiddlesRe;
+  r32 *stageIm = stage->twiddlesIm;
+  for(u32 k = 0; k < count; k += 2*half)
+    {
+      r32 *at0Re = reVals + k;
+      r32 *at0Im = imVals + k;
+      r32 *at1Re = reVals + k + half;
+      r32 *at1Im = imVals + k + half;
+      for(u32 j = 0; j < half; j += WIDE_WIDTH)
+	{
+	  WideFloat wRe = wideLoadFloats(stageRe + j);
+	  WideFloat wIm = wideLoadFloats(stageIm + j);
+	  WideFloat in0Re = wideLoadFloats(at0Re + j);
+	  WideFloat in0Im = wideLoadFloats(at0Im + j);
+	  WideFloat in1Re = wideLoadFloats(at1Re + j);
+	  WideFloat in1Im = wideLoadFloats(at1Im + j);
+
+	  WideFloat tRe = wRe*in1Re - wIm*in1Im;
+	  WideFloat tIm = wideMulAddFloats(wRe, in1Im, wIm*in1Re);
+
+	  wideStoreFloats(at0Re + j, in0Re + tRe);
+	  wideStoreFloats(at0Im + j, in0Im + tIm);
+	  wideStoreFloats(at1Re + j, in0Re - tRe);
+	  wideStoreFloats(at1Im + j, in0Im - tIm);
+	}
+    }
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 FFT_PLAN_STAGE(fftPlanRadix2Wide8_)
+{
+  UNUSED(sign);
+  u32 half = stage->stride;
+  r32 *stageRe = stage->twiddlesRe;
+  r32 *stageIm = stage->twiddlesIm;
+  for(u32 k = 0; k < count; k += 2*half)
+    {
+      r32 *at0Re = reVals + k;
+      r32 *at0Im = imVals + k;
+      r32 *at1Re = reVals + k + half;
+      r32 *at1Im = imVals + k + half;
+      for(u32 j = 0; j < half; j += 8)
+	{
+	  WideFloat8 wRe = wideLoadFloats8(stageRe + j);
+	  WideFloat8 wIm = wideLoadFloats8(stageIm + j);
+	  WideFloat8 in0Re = wideLoadFloats8(at0Re + j);
+	  WideFloat8 in0Im = wideLoadFloats8(at0Im + j);
+	  WideFloat8 in1Re = wideLoadFloats8(at1Re + j);
+	  WideFloat8 in1Im = wideLoadFloats8(at1Im + j);
+
+	  WideFloat8 tRe = wideSubFloats8(wideMulFloats8(wRe, in1Re), wideMulFloats8(wIm, in1Im));
+	  WideFloat8 tIm = wideMulAddFloats8(wRe, in1Im, wideMulFloats8(wIm, in1Re));
+
+	  wideStoreFloats8(at0Re + j, wideAddFloats8(in0Re, tRe));
+	  wideStoreFloats8(at0Im + j, wideAddFloats8(in0Im, tIm));
+	  wideStoreFloats8(at1Re + j, wideSubFloats8(in0Re, tRe));
+	  wideStoreFloats8(at1Im + j, wideSubFloats8(in0Im, tIm));
+	}
+    }
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 FFT_PLAN_STAGE(fftPlanRadix2Wide16_)
+{
+  UNUSED(sign);
+  u32 half = stage->stride;
+  r32 *stageRe = stage->twiddlesRe;
+  r32 *stageIm = stage->twiddlesIm;
+  for(u32 k = 0; k < count; k += 2*half)
+    {
+      r32 *at0Re = reVals + k;
+      r32 *at0Im = imVals + k;
+      r32 *at1Re = reVals + k + half;
+      r32 *at1Im = imVals + k + half;
+      for(u32 j = 0; j < half; j += 16)
+	{
+	  WideFloat16 wRe = wideLoadFloats16(stageRe + j);
+	  WideFloat16 wIm = wideLoadFloats16(stageIm + j);
+	  WideFloat16 in0Re = wideLoadFloats16(at0Re + j);
+	  WideFloat16 in0Im = wideLoadFloats16(at0Im + j);
+	  WideFloat16 in1Re = wideLoadFloats16(at1Re + j);
+	  WideFloat16 in1Im = wideLoadFloats16(at1Im + j);
+
+	  WideFloat16 tRe = wideSubFloats16(wideMulFloats16(wRe, in1Re), wideMulFloats16(wIm, in1Im));
+	  WideFloat16 tIm = wideMulAddFloats16(wRe, in1Im, wideMulFloats16(wIm, in1Re));
+
+	  wideStoreFloats16(at0Re + j, wideAddFloats16(in0Re, tRe));
+	  wideStoreFloats16(at0Im + j, wideAddFloats16(in0Im, tIm));
+	  wideStoreFloats16(at1Re + j, wideSubFloats16(in0Re, tRe));
+	  wideStoreFloats16(at1Im + j, wideSubFloats16(in0Im, tIm));
+	}
+    }
+}
+#endif
+
+// NOTE: radix-4 butterflies are two fused radix-2 stages, over bit-reversed input. So input b
+//       (at stride 1) takes twiddle W^2j and input c (at stride 2) takes W^j. Fusing the stages
+//       halves the passes over the data, and saves one complex multiply in four
+static FFT_PLAN_STAGE(fftPlanRadix4Scalar_)
+{
+  u32 stride = stage->stride;
+  r32 *tw1Re = stage->twiddlesRe;
+  r32 *tw1Im = stage->twiddlesIm;
+  r32 *tw2Re = tw1Re + stride;
+  r32 *tw2Im = tw1Im + stride;
+  r32 *tw3Re = tw1Re + 2*stride;
+  r32 *tw3Im = tw1Im + 2*stride;
+  for(u32 k = 0; k < count; k += 4*stride)
+    {
+      r32 *aRe = reVals + k;
+      r32 *aIm = imVals + k;
+      r32 *bRe = aRe + stride;
+      r32 *bIm = aIm + stride;
+      r32 *cRe = aRe + 2*stride;
+      r32 *cIm = aIm + 2*stride;
+      r32 *dRe = aRe + 3*stride;
+      r32 *dIm = aIm + 3*stride;
+      for(u32 j = 0; j < stride; ++j)
+	{
+	  r32 inARe = aRe[j];
+	  r32 inAIm = aIm[j];
+	  r32 inBRe = tw2Re[j]*bRe[j] - tw2Im[j]*bIm[j];
+	  r32 inBIm = tw2Re[j]*bIm[j] + tw2Im[j]*bRe[j];
+	  r32 inCRe = tw1Re[j]*cRe[j] - tw1Im[j]*cIm[j];
+	  r32 inCIm = tw1Re[j]*cIm[j] + tw1Im[j]*cRe[j];
+	  r32 inDRe = tw3Re[j]*dRe[j] - tw3Im[j]*dIm[j];
+	  r32 inDIm = tw3Re[j]*dIm[j] + tw3Im[j]*dRe[j];
+
+	  r32 sumABRe = inARe + inBRe;
+	  r32 sumABIm = inAIm + inBIm;
+	  r32 difABRe = inARe - inBRe;
+	  r32 difABIm = inAIm - inBIm;
+	  r32 sumCDRe = inCRe + inDRe;
+	  r32 sumCDIm = inCIm + inDIm;
+
+	  // NOTE: (c - d) rotated by W_4 = sign*i
+	  r32 rotCDRe = -sign*(inCIm - inDIm);
+	  r32 rotCDIm = sign*(inCRe - inDRe);
+
+	  aRe[j] = sumABRe + sumCDRe;
+	  aIm[j] = sumABIm + sumCDIm;
+	  bRe[j] = difABRe + rotCDRe;
+	  bIm[j] = difABIm + rotCDIm;
+	  cRe[j] = sumABRe - sumCDRe;
+	  cIm[j] = sumABIm - sumCDIm;
+	  dRe[j] = difABRe - rotCDRe;
+	  dIm[j] = difABIm - rotCDIm;
+	}
+    }
+}
+
+static FFT_PLAN_STAGE(fftPlanRadix4Wide_)
+{
+  u32 stride = stage->stride;
+  r32 *tw1Re = stage->twiddlesRe;
+  r32 *tw1Im = stage->twiddlesIm;
+  r32 *tw2Re = tw1Re + stride;
+  r32 *tw2Im = tw1Im + stride;
+  r32 *tw3Re = tw1Re + 2*stride;
+  r32 *tw3Im = tw1Im + 2*stride;
+  WideFloat posSign = wideSetConstantFloats(sign);
+  WideFloat negSign = wideSetConstantFloats(-sign);
+  for(u32 k = 0; k < count; k += 4*stride)
+    {
+      r32 *aRe = reVals + k;
+      r32 *aIm = imVals + k;
+      r32 *bRe = aRe + stride;
+      r32 *bIm = aIm + stride;
+      r32 *cRe = aRe + 2*stride;
+      r32 *cIm = aIm + 2*stride;
+      r32 *dRe = aRe + 3*stride;
+      r32 *dIm = aIm + 3*stride;
+      for(u32 j = 0; j < stride; j += WIDE_WIDTH)
+	{
+	  WideFloat w1Re = wideLoadFloats(tw1Re + j);
+	  WideFloat w1Im = wideLoadFloats(tw1Im + j);
+	  WideFloat w2Re = wideLoadFloats(tw2Re + j);
+	  WideFloat w2Im = wideLoadFloats(tw2Im + j);
+	  WideFloat w3Re = wideLoadFloats(tw3Re + j);
+	  WideFloat w3Im = wideLoadFloats(tw3Im + j);
+	  WideFloat bInRe = wideLoadFloats(bRe + j);
+	  WideFloat bInIm = wideLoadFloats(bIm + j);
+	  WideFloat cInRe = wideLoadFloats(cRe + j);
+	  WideFloat cInIm = wideLoadFloats(cIm + j);
+	  WideFloat dInRe = wideLoadFloats(dRe + j);
+	  WideFloat dInIm = wideLoadFloats(dIm + j);
+
+	  WideFloat inARe = wideLoadFloats(aRe + j);
+	  WideFloat inAIm = wideLoadFloats(aIm + j);
+	  WideFloat inBRe = w2Re*bInRe - w2Im*bInIm;
+	  WideFloat inBIm = wideMulAddFloats(w2Re, bInIm, w2Im*bInRe);
+	  WideFloat inCRe = w1Re*cInRe - w1Im*cInIm;
+	  WideFloat inCIm = wideMulAddFloats(w1Re, cInIm, w1Im*cInRe);
+	  WideFloat inDRe = w3Re*dInRe - w3Im*dInIm;
+	  WideFloat inDIm = wideMulAddFloats(w3Re, dInIm, w3Im*dInRe);
+
+	  WideFloat sumABRe = inARe + inBRe;
+	  WideFloat sumABIm = inAIm + inBIm;
+	  WideFloat difABRe = inARe - inBRe;
+	  WideFloat difABIm = inAIm - inBIm;
+	  WideFloat sumCDRe = inCRe + inDRe;
+	  WideFloat sumCDIm = inCIm + inDIm;
+	  WideFloat rotCDRe = negSign*(inCIm - inDIm);
+	  WideFloat rotCDIm = posSign*(inCRe - inDRe);
+
+	  wideStoreFloats(aRe + j, sumABRe + sumCDRe);
+	  wideStoreFloats(aIm + j, sumABIm + sumCDIm);
+	  wideStoreFloats(bRe + j, difABRe + rotCDRe);
+	  wideStoreFloats(bIm + j, difABIm + rotCDIm);
+	  wideStoreFloats(cRe + j, sumABRe - sumCDRe);
+	  wideStoreFloats(cIm + j, sumABIm - sumCDIm);
+	  wideStoreFloats(dRe + j, difABRe - rotCDRe);
+	  wideStoreFloats(dIm + j, difABIm - rotCDIm);
+	}
+    }
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 FFT_PLAN_STAGE(fftPlanRadix4Wide8_)
+{
+  u32 stride = stage->stride;
+  r32 *tw1Re = stage->twiddlesRe;
+  r32 *tw1Im = stage->twiddlesIm;
+  r32 *tw2Re = tw1Re + stride;
+  r32 *tw2Im = tw1Im + stride;
+  r32 *tw3Re = tw1Re + 2*stride;
+  r32 *tw3Im = tw1Im + 2*stride;
+  WideFloat8 posSign = wideSetConstantFloats8(sign);
+  WideFloat8 negSign = wideSetConstantFloats8(-sign);
+  for(u32 k = 0; k < count; k += 4*stride)
+    {
+      r32 *aRe = reVals + k;
+      r32 *aIm = imVals + k;
+      r32 *bRe = aRe + stride;
+      r32 *bIm = aIm + stride;
+      r32 *cRe = aRe + 2*stride;
+      r32 *cIm = aIm + 2*stride;
+      r32 *dRe = aRe + 3*stride;
+      r32 *dIm = aIm + 3*stride;
+      for(u32 j = 0; j < stride; j += 8)
+	{
+	  WideFloat8 w1Re = wideLoadFloats8(tw1Re + j);
+	  WideFloat8 w1Im = wideLoadFloats8(tw1Im + j);
+	  WideFloat8 w2Re = wideLoadFloats8(tw2Re + j);
+	  WideFloat8 w2Im = wideLoadFloats8(tw2Im + j);
+	  WideFloat8 w3Re = wideLoadFloats8(tw3Re + j);
+	  WideFloat8 w3Im = wideLoadFloats8(tw3Im + j);
+	  WideFloat8 bInRe = wideLoadFloats8(bRe + j);
+	  WideFloat8 bInIm = wideLoadFloats8(bIm + j);
+	  WideFloat8 cInRe = wideLoadFloats8(cRe + j);
+	  WideFloat8 cInIm = wideLoadFloats8(cIm + j);
+	  WideFloat8 dInRe = wideLoadFloats8(dRe + j);
+	  WideFloat8 dInIm = wideLoadFloats8(dIm + j);
+
+	  WideFloat8 inARe = wideLoadFloats8(aRe + j);
+	  WideFloat8 inAIm = wideLoadFloats8(aIm + j);
+	  WideFloat8 inBRe = wideSubFloats8(wideMulFloats8(w2Re, bInRe), wideMulFloats8(w2Im, bInIm));
+	  WideFloat8 inBIm = wideMulAddFloats8(w2Re, bInIm, wideMulFloats8(w2Im, bInRe));
+	  WideFloat8 inCRe = wideSubFloats8(wideMulFloats8(w1Re, cInRe), wideMulFloats8(w1Im, cInIm));
+	  WideFloat8 inCIm = wideMulAddFloats8(w1Re, cInIm, wideMulFloats8(w1Im, cInRe));
+	  WideFloat8 inDRe = wideSubFloats8(wideMulFloats8(w3Re, dInRe), wideMulFloats8(w3Im, dInIm));
+	  WideFloat8 inDIm = wideMulAddFloats8(w3Re, dInIm, wideMulFloats8(w3Im, dInRe));
+
+	  WideFloat8 sumABRe = wideAddFloats8(inARe, inBRe);
+	  WideFloat8 sumABIm = wideAddFloats8(inAIm, inBIm);
+	  WideFloat8 difABRe = wideSubFloats8(inARe, inBRe);
+	  WideFloat8 difABIm = wideSubFloats8(inAIm, inBIm);
+	  WideFloat8 sumCDRe = wideAddFloats8(inCRe, inDRe);
+	  WideFloat8 sumCDIm = wideAddFloats8(inCIm, inDIm);
+	  WideFloat8 rotCDRe = wideMulFloats8(negSign, wideSubFloats8(inCIm, inDIm));
+	  WideFloat8 rotCDIm = wideMulFloats8(posSign, wideSubFloats8(inCRe, inDRe));
+
+	  wideStoreFloats8(aRe + j, wideAddFloats8(sumABRe, sumCDRe));
+	  wideStoreFloats8(aIm + j, wideAddFloats8(sumABIm, sumCDIm));
+	  wideStoreFloats8(bRe + j, wideAddFloats8(difABRe, rotCDRe));
+	  wideStoreFloats8(bIm + j, wideAddFloats8(difABIm, rotCDIm));
+	  wideStoreFloats8(cRe + j, wideSubFloats8(sumABRe, sumCDRe));
+	  wideStoreFloats8(cIm + j, wideSubFloats8(sumABIm, sumCDIm));
+	  wideStoreFloats8(dRe + j, wideSubFloats8(difABRe, rotCDRe));
+	  wideStoreFloats8(dIm + j, wideSubFloats8(difABIm, rotCDIm));
+	}
+    }
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 FFT_PLAN_STAGE(fftPlanRadix4Wide16_)
+{
+  u32 stride = stage->stride;
+  r32 *tw1Re = stage->twiddlesRe;
+  r32 *tw1Im = stage->twiddlesIm;
+  r32 *tw2Re = tw1Re + stride;
+  r32 *tw2Im = tw1Im + stride;
+  r32 *tw3Re = tw1Re + 2*stride;
+  r32 *tw3Im = tw1Im + 2*stride;
+  WideFloat16 posSign = wideSetConstantFloats16(sign);
+  WideFloat16 negSign = wideSetConstantFloats16(-sign);
+  for(u32 k = 0; k < count; k += 4*stride)
+    {
+      r32 *aRe = reVals + k;
+      r32 *aIm = imVals + k;
+      r32 *bRe = aRe + stride;
+      r32 *bIm = aIm + stride;
+      r32 *cRe = aRe + 2*stride;
+      r32 *cIm = aIm + 2*stride;
+      r32 *dRe = aRe + 3*stride;
+      r32 *dIm = aIm + 3*stride;
+      for(u32 j = 0; j < stride; j += 16)
+	{
+	  WideFloat16 w1Re = wideLoadFloats16(tw1Re + j);
+	  WideFloat16 w1Im = wideLoadFloats16(tw1Im + j);
+	  WideFloat16 w2Re = wideLoadFloats16(tw2Re + j);
+	  WideFloat16 w2Im = wideLoadFloats16(tw2Im + j);
+	  WideFloat16 w3Re = wideLoadFloats16(tw3Re + j);
+	  WideFloat16 w3Im = wideLoadFloats16(tw3Im + j);
+	  WideFloat16 bInRe = wideLoadFloats16(bRe + j);
+	  WideFloat16 bInIm = wideLoadFloats16(bIm + j);
+	  WideFloat16 cInRe = wideLoadFloats16(cRe + j);
+	  WideFloat16 cInIm = wideLoadFloats16(cIm + j);
+	  WideFloat16 dInRe = wideLoadFloats16(dRe + j);
+	  WideFloat16 dInIm = wideLoadFloats16(dIm + j);
+
+	  WideFloat16 inARe = wideLoadFloats16(aRe + j);
+	  WideFloat16 inAIm = wideLoadFloats16(aIm + j);
+	  WideFloat16 inBRe = wideSubFloats16(wideMulFloats16(w2Re, bInRe), wideMulFloats16(w2Im, bInIm));
+	  WideFloat16 inBIm = wideMulAddFloats16(w2Re, bInIm, wideMulFloats16(w2Im, bInRe));
+	  WideFloat16 inCRe = wideSubFloats16(wideMulFloats16(w1Re, cInRe), wideMulFloats16(w1Im, cInIm));
+	  WideFloat16 inCIm = wideMulAddFloats16(w1Re, cInIm, wideMulFloats16(w1Im, cInRe));
+	  WideFloat16 inDRe = wideSubFloats16(wideMulFloats16(w3Re, dInRe), wideMulFloats16(w3Im, dInIm));
+	  WideFloat16 inDIm = wideMulAddFloats16(w3Re, dInIm, wideMulFloats16(w3Im, dInRe));
+
+	  WideFloat16 sumABRe = wideAddFloats16(inARe, inBRe);
+	  WideFloat16 sumABIm = wideAddFloats16(inAIm, inBIm);
+	  WideFloat16 difABRe = wideSubFloats16(inARe, inBRe);
+	  WideFloat16 difABIm = wideSubFloats16(inAIm, inBIm);
+	  WideFloat16 sumCDRe = wideAddFloats16(inCRe, inDRe);
+	  WideFloat16 sumCDIm = wideAddFloats16(inCIm, inDIm);
+	  WideFloat16 rotCDRe = wideMulFloats16(negSign, wideSubFloats16(inCIm, inDIm));
+	  WideFloat16 rotCDIm = wideMulFloats16(posSign, wideSubFloats16(inCRe, inDRe));
+
+	  wideStoreFloats16(aRe + j, wideAddFloats16(sumABRe, sumCDRe));
+	  wideStoreFloats16(aIm + j, wideAddFloats16(sumABIm, sumCDIm));
+	  wideStoreFloats16(bRe + j, wideAddFloats16(difABRe, rotCDRe));
+	  wideStoreFloats16(bIm + j, wideAddFloats16(difABIm, rotCDIm));
+	  wideStoreFloats16(cRe + j, wideSubFloats16(sumABRe, sumCDRe));
+	  wideStoreFloats16(cIm + j, wideSubFloats16(sumABIm, sumCDIm));
+	  wideStoreFloats16(dRe + j, wideSubFloats16(difABRe, rotCDRe));
+	  wideStoreFloats16(dIm + j, wideSubFloats16(difABIm, rotCDIm));
+	}
+    }
+}
+#endif
+
+// NOTE: with W_3 = -1/2 + sign*i*sqrt(3)/2:
+//         X0 = x0 + (y1 + y2)
+//         X1 = x0 - (y1 + y2)/2 + sign*i*sqrt(3)/2*(y1 - y2)
+//         X2 = x0 - (y1 + y2)/2 - sign*i*sqrt(3)/2*(y1 - y2)
+static FFT_PLAN_STAGE(fftPlanRadix3Scalar_)
+{
+  u32 stride = stage->stride;
+  r32 *tw1Re = stage->twiddlesRe;
+  r32 *tw1Im = stage->twiddlesIm;
+  r32 *tw2Re = tw1Re + stride;
+  r32 *tw2Im = tw1Im + stride;
+  r32 rotScale = sign*0.866025403784f;
+  for(u32 k = 0; k < count; k += 3*stride)
+    {
+      r32 *x0Re = reVals + k;
+      r32 *x0Im = imVals + k;
+      r32 *x1Re = x0Re + stride;
+      r32 *x1Im = x0Im + stride;
+      r32 *x2Re = x0Re + 2*stride;
+      r32 *x2Im = x0Im + 2*stride;
+      for(u32 j = 0; j < stride; ++j)
+	{
+	  r32 y1Re = tw1Re[j]*x1Re[j] - tw1Im[j]*x1Im[j];
+	  r32 y1Im = tw1Re[j]*x1Im[j] + tw1Im[j]*x1Re[j];
+	  r32 y2Re = tw2Re[j]*x2Re[j] - tw2Im[j]*x2Im[j];
+	  r32 y2Im = tw2Re[j]*x2Im[j] + tw2Im[j]*x2Re[j];
+
+	  r32 sumRe = y1Re + y2Re;
+	  r32 sumIm = y1Im + y2Im;
+	  r32 midRe = x0Re[j] - 0.5f*sumRe;
+	  r32 midIm = x0Im[j] - 0.5f*sumIm;
+	  r32 rotRe = -rotScale*(y1Im - y2Im);
+	  r32 rotIm = rotScale*(y1Re - y2Re);
+
+	  x0Re[j] += sumRe;
+	  x0Im[j] += sumIm;
+	  x1Re[j] = midRe + rotRe;
+	  x1Im[j] = midIm + rotIm;
+	  x2Re[j] = midRe - rotRe;
+	  x2Im[j] = midIm - rotIm;
+	}
+    }
+}
+
+static FFT_PLAN_STAGE(fftPlanRadix3Wide_)
+{
+  u32 stride = stage->stride;
+  r32 *tw1Re = stage->twiddlesRe;
+  r32 *tw1Im = stage->twiddlesIm;
+  r32 *tw2Re = tw1Re + stride;
+  r32 *tw2Im = tw1Im + stride;
+  WideFloat half = wideSetConstantFloats(0.5f);
+  WideFloat posRotScale = wideSetConstantFloats(sign*0.866025403784f);
+  WideFloat negRotScale = wideSetConstantFloats(-sign*0.866025403784f);
+  for(u32 k = 0; k < count; k += 3*stride)
+    {
+      r32 *x0Re = reVals + k;
+      r32 *x0Im = imVals + k;
+      r32 *x1Re = x0Re + stride;
+      r32 *x1Im = x0Im + stride;
+      r32 *x2Re = x0Re + 2*stride;
+      r32 *x2Im = x0Im + 2*stride;
+      for(u32 j = 0; j < stride; j += WIDE_WIDTH)
+	{
+	  WideFloat w1Re = wideLoadFloats(tw1Re + j);
+	  WideFloat w1Im = wideLoadFloats(tw1Im + j);
+	  WideFloat w2Re = wideLoadFloats(tw2Re + j);
+	  WideFloat w2Im = wideLoadFloats(tw2Im + j);
+	  WideFloat in0Re = wideLoadFloats(x0Re + j);
+	  WideFloat in0Im = wideLoadFloats(x0Im + j);
+	  WideFloat in1Re = wideLoadFloats(x1Re + j);
+	  WideFloat in1Im = wideLoadFloats(x1Im + j);
+	  WideFloat in2Re = wideLoadFloats(x2Re + j);
+	  WideFloat in2Im = wideLoadFloats(x2Im + j);
+
+	  WideFloat y1Re = w1Re*in1Re - w1Im*in1Im;
+	  WideFloat y1Im = wideMulAddFloats(w1Re, in1Im, w1Im*in1Re);
+	  WideFloat y2Re = w2Re*in2Re - w2Im*in2Im;
+	  WideFloat y2Im = wideMulAddFloats(w2Re, in2Im, w2Im*in2Re);
+
+	  WideFloat sumRe = y1Re + y2Re;
+	  WideFloat sumIm = y1Im + y2Im;
+	  WideFloat midRe = in0Re - half*sumRe;
+	  WideFloat midIm = in0Im - half*sumIm;
+	  WideFloat rotRe = negRotScale*(y1Im - y2Im);
+	  WideFloat rotIm = posRotScale*(y1Re - y2Re);
+
+	  wideStoreFloats(x0Re + j, in0Re + sumRe);
+	  wideStoreFloats(x0Im + j, in0Im + sumIm);
+	  wideStoreFloats(x1Re + j, midRe + rotRe);
+	  wideStoreFloats(x1Im + j, midIm + rotIm);
+	  wideStoreFloats(x2Re + j, midRe - rotRe);
+	  wideStoreFloats(x2Im + j, midIm - rotIm);
+	}
+    }
+}
+
+// NOTE: with c1 = cos(2pi/5), c2 = cos(4pi/5), s1 = sign*sin(2pi/5), s2 = sign*sin(4pi/5), and
+//       t1 = y1 + y4, t2 = y2 + y3, t3 = y1 - y4, t4 = y2 - y3:
+//         X0    = y0 + t1 + t2
+//         X1/X4 = y0 + c1*t1 + c2*t2 +/- i*(s1*t3 + s2*t4)
+//         X2/X3 = y0 + c2*t1 + c1*t2 +/- i*(s2*t3 - s1*t4)
+#define FFT_RADIX5_C1 (0.309016994375f)
+#define FFT_RADIX5_C2 (-0.809016994375f)
+#define FFT_RADIX5_S1 (0.951056516295f)
+#define FFT_RADIX5_S2 (0.587785252292f)
+
+static FFT_PLAN_STAGE(fftPlanRadix5Scalar_)
+{
+  u32 stride = stage->stride;
+  r32 *twRe = stage->twiddlesRe;
+  r32 *twIm = stage->twiddlesIm;
+  r32 c1 = FFT_RADIX5_C1;
+  r32 c2 = FFT_RADIX5_C2;
+  r32 s1 = sign*FFT_RADIX5_S1;
+  r32 s2 = sign*FFT_RADIX5_S2;
+  for(u32 k = 0; k < count; k += 5*stride)
+    {
+      r32 *atRe = reVals + k;
+      r32 *atIm = imVals + k;
+      for(u32 j = 0; j < stride; ++j)
+	{
+	  r32 yRe[5];
+	  r32 yIm[5];
+	  yRe[0] = atRe[j];
+	  yIm[0] = atIm[j];
+	  for(u32 q = 1; q < 5; ++q)
+	    {
+	      r32 wRe = twRe[(q - 1)*stride + j];
+	      r32 wIm = twIm[(q - 1)*stride + j];
+	      r32 xRe = atRe[q*stride + j];
+	      r32 xIm = atIm[q*stride + j];
+	      yRe[q] = wRe*xRe - wIm*xIm;
+	      yIm[q] = wRe*xIm + wIm*xRe;
+	    }
+
+	  r32 t1Re = yRe[1] + yRe[4];
+	  r32 t1Im = yIm[1] + yIm[4];
+	  r32 t2Re = yRe[2] + yRe[3];
+	  r32 t2Im = yIm[2] + yIm[3];
+	  r32 t3Re = yRe[1] - yRe[4];
+	  r32 t3Im = yIm[1] - yIm[4];
+	  r32 t4Re = yRe[2] - yRe[3];
+	  r32 t4Im = yIm[2] - yIm[3];
+
+	  r32 a1Re = yRe[0] + c1*t1Re + c2*t2Re;
+	  r32 a1Im = yIm[0] + c1*t1Im + c2*t2Im;
+	  r32 a2Re = yRe[0] + c2*t1Re + c1*t2Re;
+	  r32 a2Im = yIm[0] + c2*t1Im + c1*t2Im;
+	  r32 b1Re = s1*t3Re + s2*t4Re;
+	  r32 b1Im = s1*t3Im + s2*t4Im;
+	  r32 b2Re = s2*t3Re - s1*t4Re;
+	  r32 b2Im = s2*t3Im - s1*t4Im;
+
+	  // NOTE: i*b = -b.im + i*b.re
+	  atRe[j] = yRe[0] + t1Re + t2Re;
+	  atIm[j] = yIm[0] + t1Im + t2Im;
+	  atRe[stride + j] = a1Re - b1Im;
+	  atIm[stride + j] = a1Im + b1Re;
+	  atRe[2*stride + j] = a2Re - b2Im;
+	  atIm[2*stride + j] = a2Im + b2Re;
+	  atRe[3*stride + j] = a2Re + b2Im;
+	  atIm[3*stride + j] = a2Im - b2Re;
+	  atRe[4*stride + j] = a1Re + b1Im;
+	  atIm[4*stride + j] = a1Im - b1Re;
+	}
+    }
+}
+
+static FFT_PLAN_STAGE(fftPlanRadix5Wide_)
+{
+  u32 stride = stage->stride;
+  r32 *twRe = stage->twiddlesRe;
+  r32 *twIm = stage->twiddlesIm;
+  WideFloat c1 = wideSetConstantFloats(FFT_RADIX5_C1);
+  WideFloat c2 = wideSetConstantFloats(FFT_RADIX5_C2);
+  WideFloat s1 = wideSetConstantFloats(sign*FFT_RADIX5_S1);
+  WideFloat s2 = wideSetConstantFloats(sign*FFT_RADIX5_S2);
+  for(u32 k = 0; k < count; k += 5*stride)
+    {
+      r32 *atRe = reVals + k;
+      r32 *atIm = imVals + k;
+      for(u32 j = 0; j < stride; j += WIDE_WIDTH)
+	{
+	  WideFloat yRe[5];
+	  WideFloat yIm[5];
+	  yRe[0] = wideLoadFloats(atRe + j);
+	  yIm[0] = wideLoadFloats(atIm + j);
+	  for(u32 q = 1; q < 5; ++q)
+	    {
+	      WideFloat wRe = wideLoadFloats(twRe + (q - 1)*stride + j);
+	      WideFloat wIm = wideLoadFloats(twIm + (q - 1)*stride + j);
+	      WideFloat xRe = wideLoadFloats(atRe + q*stride + j);
+	      WideFloat xIm = wideLoadFloats(atIm + q*stride + j);
+	      yRe[q] = wRe*xRe - wIm*xIm;
+	      yIm[q] = wideMulAddFloats(wRe, xIm, wIm*xRe);
+	    }
+
+	  WideFloat t1Re = yRe[1] + yRe[4];
+	  WideFloat t1Im = yIm[1] + yIm[4];
+	  WideFloat t2Re = yRe[2] + yRe[3];
+	  WideFloat t2Im = yIm[2] + yIm[3];
+	  WideFloat t3Re = yRe[1] - yRe[4];
+	  WideFloat t3Im = yIm[1] - yIm[4];
+	  WideFloat t4Re = yRe[2] - yRe[3];
+	  WideFloat t4Im = yIm[2] - yIm[3];
+
+	  WideFloat a1Re = yRe[0] + c1*t1Re + c2*t2Re;
+	  WideFloat a1Im = yIm[0] + c1*t1Im + c2*t2Im;
+	  WideFloat a2Re = yRe[0] + c2*t1Re + c1*t2Re;
+	  WideFloat a2Im = yIm[0] + c2*t1Im + c1*t2Im;
+	  WideFloat b1Re = s1*t3Re + s2*t4Re;
+	  WideFloat b1Im = s1*t3Im + s2*t4Im;
+	  WideFloat b2Re = s2*t3Re - s1*t4Re;
+	  WideFloat b2Im = s2*t3Im - s1*t4Im;
+
+	  wideStoreFloats(atRe + j, yRe[0] + t1Re + t2Re);
+	  wideStoreFloats(atIm + j, yIm[0] + t1Im + t2Im);
+	  wideStoreFloats(atRe + stride + j, a1Re - b1Im);
+	  wideStoreFloats(atIm + stride + j, a1Im + b1Re);
+	  wideStoreFloats(atRe + 2*stride + j, a2Re - b2Im);
+	  wideStoreFloats(atIm + 2*stride + j, a2Im + b2Re);
+	  wideStoreFloats(atRe + 3*stride + j, a2Re + b2Im);
+	  wideStoreFloats(atIm + 3*stride + j, a2Im - b2Re);
+	  wideStoreFloats(atRe + 4*stride + j, a1Re + b1Im);
+	  wideStoreFloats(atIm + 4*stride + j, a1Im - b1Re);
+	}
+    }
+}
+
+// NOTE: runs every stage over digit-reversed data, in place. Each stage uses the widest kernel
+//       that both the plan's simd level and the stage's stride allow
+static void
+fftPlanRunStages_(FFT_Plan *plan, r32 *reVals, r32 *imVals)
+{
+  u32 count = plan->count;
+  r32 sign = (plan->direction == FFT_Direction_forward) ? -1.f : 1.f;
+
+  for(u32 stageIdx = 0; stageIdx < plan->stageCount; ++stageIdx)
+    {
+      FFT_PlanStage *stage = plan->stages + stageIdx;
+
+      SimdLevel level = plan->simdLevel;
+      while(level > SimdLevel_scalar && (stage->stride % simdLevelWidth(level)) != 0)
+	{
+	  level = (SimdLevel)(level - 1);
+	}
+
+      switch(stage->radix)
+	{
+	case 2:
+	  {
+	    switch(level)
+	      {
+#if SIMD_HAS_WIDE16
+	      case SimdLevel_wide16: { fftPlanRadix2Wide16_(reVals, imVals, stage, count, sign); } break;
+#endif
+#if SIMD_HAS_WIDE8
+	      case SimdLevel_wide8: { fftPlanRadix2Wide8_(reVals, imVals, stage, count, sign); } break;
+#endif
+	      case SimdLevel_wide4: { fftPlanRadix2Wide_(reVals, imVals, stage, count, sign); } break;
+	      default: { fftPlanRadix2Scalar_(reVals, imVals, stage, count, sign); } break;
+	      }
+	  } break;
+
+	case 4:
+	  {
+	    switch(level)
+	      {
+#if SIMD_HAS_WIDE16
+	      case SimdLevel_wide16: { fftPlanRadix4Wide16_(reVals, imVals, stage, count, sign); } break;
+#endif
+#if SIMD_HAS_WIDE8
+	      case SimdLevel_wide8: { fftPlanRadix4Wide8_(reVals, imVals, stage, count, sign); } break;
+#endif
+	      case SimdLevel_wide4: { fftPlanRadix4Wide_(reVals, imVals, stage, count, sign); } break;
+	      default: { fftPlanRadix4Scalar_(reVals, imVals, stage, count, sign); } break;
+	      }
+	  } break;
+
+	case 3:
+	  {
+	    if(level >= SimdLevel_wide4) fftPlanRadix3Wide_(reVals, imVals, stage, count, sign);
+	    else			 fftPlanRadix3Scalar_(reVals, imVals, stage, count, sign);
+	  } break;
+
+	case 5:
+	  {
+	    if(level >= SimdLevel_wide4) fftPlanRadix5Wide_(reVals, imVals, stage, count, sign);
+	    else			 fftPlanRadix5Scalar_(reVals, imVals, stage, count, sign);
+	  } break;
+
+	default: { ASSERT(!"unsupported fft radix"); } break;
+	}
+    }
+}
+
+// NOTE: complex to complex, in place. inverse plans scale by 1/count
+static void
+fftPlanExecute(FFT_Plan *plan, r32 *reVals, r32 *imVals)
+{
+  PROFILE_FUNCTION();
+
+  u32 count = plan->count;
+  u32 *permutation = plan->permutation;
+  if(plan->isPowerOf2)
+    {
+      for(u32 i = 0; i < count; ++i)
+	{
+	  u32 iRev = permutation[i];
+	  if(i < iRev)
+	    {
+	      r32 tempRe = reVals[i];
+	      r32 tempIm = imVals[i];
+	      reVals[i] = reVals[iRev];
+	      imVals[i] = imVals[iRev];
+	      reVals[iRev] = tempRe;
+	      imVals[iRev] = tempIm;
+	    }
+	}
+    }
+  else
+    {
+      r32 *scratchRe = plan->scratchRe;
+      r32 *scratchIm = plan->scratchIm;
+      COPY_ARRAY(scratchRe, reVals, count, r32);
+      COPY_ARRAY(scratchIm, imVals, count, r32);
+      for(u32 i = 0; i < count; ++i)
+	{
+	  reVals[i] = scratchRe[permutation[i]];
+	  imVals[i] = scratchIm[permutation[i]];
+	}
+    }
+
+  fftPlanRunStages_(plan, reVals, imVals);
+
+  if(plan->direction == FFT_Direction_inverse)
+    {
+      r32 invCount = 1.f / (r32)count;
+      for(u32 i = 0; i < count; ++i)
+	{
+	  reVals[i] *= invCount;
+	  imVals[i] *= invCount;
+	}
+    }
+}
+
+// NOTE: real to complex. `input` holds plan->count samples, and may not alias the outputs
+static void
+fftPlanExecuteReal(FFT_Plan *plan, r32 *outputRe, r32 *outputIm, r32 *input)
+{
+  PROFILE_FUNCTION();
+
+  ASSERT(plan->direction == FFT_Direction_forward);
+
+  u32 count = plan->count;
+  u32 *permutation = plan->permutation;
+  for(u32 i = 0; i < count; ++i)
+    {
+      outputRe[i] = input[permutation[i]];
+      outputIm[i] = 0.f;
+    }
+
+  fftPlanRunStages_(plan, outputRe, outputIm);
+}
+
+// NOTE: complex to real, discarding the imaginary part. the inputs are left untouched, and
+//       may not alias the output
+static void
+ifftPlanExecuteReal(FFT_Plan *plan, r32 *output, r32 *inputRe, r32 *inputIm)
+{
+  PROFILE_FUNCTION();
+
+  ASSERT(plan->direction == FFT_Direction_inverse);
+
+  u32 count = plan->count;
+  u32 *permutation = plan->permutation;
+  r32 *scratchIm = plan->scratchIm;
+  r32 invCount = 1.f / (r32)count;
+  for(u32 i = 0; i < count; ++i)
+    {
+      output[i] = invCount * inputRe[permutation[i]];
+      scratchIm[i] = invCount * inputIm[permutation[i]];
+    }
+
+  fftPlanRunStages_(plan, output, scratchIm);
+}
+
+//
+// batched plans
+//
+
+// NOTE: a batch plan runs `laneCount` transforms of one plan in lockstep, one per simd lane, with
+//       the plan's twiddles broadcast across the lanes. Single transforms only vectorize stages
+//       whose stride is at least the simd width, so small transforms leave lanes idle. Batches
+//       keep every lane busy at every stage, whatever the size.
+//       Batched data is lane-interleaved: element i of lane b sits at [i*laneCount + b]
+struct FFT_BatchPlan
+{
+  FFT_Plan *plan;
+  u32 laneCount;
+  SimdLevel simdLevel;
+  b32 loopsPlan; // NOTE: see FFT_BATCH_LOOP_MIN_COUNT
+
+  // NOTE: one group of lanes, plan->count*laneCount each
+  r32 *lanesRe;
+  r32 *lanesIm;
+};
+
+// NOTE: from this size up, 4-lane batches measure no faster than looping the plan, whose own
+//       stages are vectorized by then, so their real-input transforms loop the plan instead
+#define FFT_BATCH_LOOP_MIN_COUNT 256
+
+// NOTE: batches are 8 lanes wide where the plan's simd level has 8-lane kernels, and WIDE_WIDTH
+//       lanes otherwise. The batch plan shares `plan`'s tables, so it should be executed on the
+//       same thread as the plan itself
+static FFT_BatchPlan*
+fftBatchPlanCreate(Arena *arena, FFT_Plan *plan)
+{
+  FFT_BatchPlan *result = arenaPushStruct(arena, FFT_BatchPlan);
+  result->plan = plan;
+  result->simdLevel = plan->simdLevel;
+  result->laneCount = WIDE_WIDTH;
+#if SIMD_HAS_WIDE8
+  if(plan->simdLevel >= SimdLevel_wide8) result->laneCount = 8;
+#endif
+  result->loopsPlan = (result->laneCount == 4 && plan->count >= FFT_BATCH_LOOP_MIN_COUNT);
+
+  ArenaPushFlags flags = arenaFlagsNoZeroAlign(WIDE_MAX_WIDTH * sizeof(r32));
+  result->lanesRe = arenaPushArray(arena, plan->count*result->laneCount, r32, flags);
+  result->lanesIm = arenaPushArray(arena, plan->count*result->laneCount, r32, flags);
+
+  return(result);
+}
+
+// NOTE: batch stage kernels run every butterfly of one stage, for every lane. `laneCount` must be
+//       a multiple of the kernel's width
+#define FFT_BATCH_STAGE(name) void (name)(r32 *reVals, r32 *imVals, FFT_PlanStage *stage, u32 count, u32 laneCount, r32 sign)
+
+static FFT_BATCH_STAGE(fftBatchRadix2Wide_)
+{
+  UNUSED(sign);
+  u32 half = stage->stride;
+  for(u32 k = 0; k < count; k += 2*half)
+    {
+      for(u32 j = 0; j < half; ++j)
+	{
+	  WideFloat wRe = wideSetConstantFloats(stage->twiddlesRe[j]);
+	  WideFloat wIm = wideSetConstantFloats(stage->twiddlesIm[j]);
+	  r32 *at0Re = reVals + (k + j)*laneCount;
+	  r32 *at0Im = imVals + (k + j)*laneCount;
+	  r32 *at1Re = at0Re + half*laneCount;
+	  r32 *at1Im = at0Im + half*laneCount;
+	  for(u32 lane = 0; lane < laneCount; lane += WIDE_WIDTH)
+	    {
+	      WideFloat in0Re = wideLoadFloats(at0Re + lane);
+	      WideFloat in0Im = wideLoadFloats(at0Im + lane);
+	      WideFloat in1Re = wideLoadFloats(at1Re + lane);
+	      WideFloat in1Im = wideLoadFloats(at1Im + lane);
+
+	      WideFloat tRe = wRe*in1Re - wIm*in1Im;
+	      WideFloat tIm = wideMulAddFloats(wRe, in1Im, wIm*in1Re);
+
+	      wideStoreFloats(at0Re + lane, in0Re + tRe);
+	      wideStoreFloats(at0Im + lane, in0Im + tIm);
+	      wideStoreFloats(at1Re + lane, in0Re - tRe);
+	      wideStoreFloats(at1Im + lane, in0Im - tIm);
+	    }
+	}
+    }
+}
+
+static FFT_BATCH_STAGE(fftBatchRadix4Wide_)
+{
+  u32 stride = stage->stride;
+  WideFloat posSign = wideSetConstantFloats(sign);
+  WideFloat negSign = wideSetConstantFloats(-sign);
+  for(u32 k = 0; k < count; k += 4*stride)
+    {
+      for(u32 j = 0; j < stride; ++j)
+	{
+	  WideFloat w1Re = wideSetConstantFloats(stage->twiddlesRe[j]);
+	  WideFloat w1Im = wideSetConstantFloats(stage->twiddlesIm[j]);
+	  WideFloat w2Re = wideSetConstantFloats(stage->twiddlesRe[stride + j]);
+	  WideFloat w2Im = wideSetConstantFloats(stage->twiddlesIm[stride + j]);
+	  WideFloat w3Re = wideSetConstantFloats(stage->twiddlesRe[2*stride + j]);
+	  WideFloat w3Im = wideSetConstantFloats(stage->twiddlesIm[2*stride + j]);
+	  r32 *aRe = reVals + (k + j)*laneCount;
+	  r32 *aIm = imVals + (k + j)*laneCount;
+	  r32 *bRe = aRe + stride*laneCount;
+	  r32 *bIm = aIm + stride*laneCount;
+	  r32 *cRe = aRe + 2*stride*laneCount;
+	  r32 *cIm = aIm + 2*stride*laneCount;
+	  r32 *dRe = aRe + 3*stride*laneCount;
+	  r32 *dIm = aIm + 3*stride*laneCount;
+	  for(u32 lane = 0; lane < laneCount; lane += WIDE_WIDTH)
+	    {
+	      WideFloat inARe = wideLoadFloats(aRe + lane);
+	      WideFloat inAIm = wideLoadFloats(aIm + lane);
+	      WideFloat xBRe = wideLoadFloats(bRe + lane);
+	      WideFloat xBIm = wideLoadFloats(bIm + lane);
+	      WideFloat xCRe = wideLoadFloats(cRe + lane);
+	      WideFloat xCIm = wideLoadFloats(cIm + lane);
+	      WideFloat xDRe = wideLoadFloats(dRe + lane);
+	      WideFloat xDIm = wideLoadFloats(dIm + lane);
+
+	      WideFloat inBRe = w2Re*xBRe - w2Im*xBIm;
+	      WideFloat inBIm = wideMulAddFloats(w2Re, xBIm, w2Im*xBRe);
+	      WideFloat inCRe = w1Re*xCRe - w1Im*xCIm;
+	      WideFloat inCIm = wideMulAddFloats(w1Re, xCIm, w1Im*xCRe);
+	      WideFloat inDRe = w3Re*xDRe - w3Im*xDIm;
+	      WideFloat inDIm = wideMulAddFloats(w3Re, xDIm, w3Im*xDRe);
+
+	      WideFloat sumABRe = inARe + inBRe;
+	      WideFloat sumABIm = inAIm + inBIm;
+	      WideFloat difABRe = inARe - inBRe;
+	      WideFloat difABIm = inAIm - inBIm;
+	      WideFloat sumCDRe = inCRe + inDRe;
+	      WideFloat sumCDIm = inCIm + inDIm;
+	      WideFloat rotCDRe = negSign*(inCIm - inDIm);
+	      WideFloat rotCDIm = posSign*(inCRe - inDRe);
+
+	      wideStoreFloats(aRe + lane, sumABRe + sumCDRe);
+	      wideStoreFloats(aIm + lane, sumABIm + sumCDIm);
+	      wideStoreFloats(bRe + lane, difABRe + rotCDRe);
+	      wideStoreFloats(bIm + lane, difABIm + rotCDIm);
+	      wideStoreFloats(cRe + lane, sumABRe - sumCDRe);
+	      wideStoreFloats(cIm + lane, sumABIm - sumCDIm);
+	      wideStoreFloats(dRe + lane, difABRe - rotCDRe);
+	      wideStoreFloats(dIm + lane, difABIm - rotCDIm);
+	    }
+	}
+    }
+}
+
+static FFT_BATCH_STAGE(fftBatchRadix3Wide_)
+{
+  u32 stride = stage->stride;
+  WideFloat half = wideSetConstantFloats(0.5f);
+  WideFloat posRotScale = wideSetConstantFloats(sign*0.866025403784f);
+  WideFloat negRotScale = wideSetConstantFloats(-sign*0.866025403784f);
+  for(u32 k = 0; k < count; k += 3*stride)
+    {
+      for(u32 j = 0; j < stride; ++j)
+	{
+	  WideFloat w1Re = wideSetConstantFloats(stage->twiddlesRe[j]);
+	  WideFloat w1Im = wideSetConstantFloats(stage->twiddlesIm[j]);
+	  WideFloat w2Re = wideSetConstantFloats(stage->twiddlesRe[stride + j]);
+	  WideFloat w2Im = wideSetConstantFloats(stage->twiddlesIm[stride + j]);
+	  r32 *x0Re = reVals + (k + j)*laneCount;
+	  r32 *x0Im = imVals + (k + j)*laneCount;
+	  r32 *x1Re = x0Re + stride*laneCount;
+	  r32 *x1Im = x0Im + stride*laneCount;
+	  r32 *x2Re = x0Re + 2*stride*laneCount;
+	  r32 *x2Im = x0Im + 2*stride*laneCount;
+	  for(u32 lane = 0; lane < laneCount; lane += WIDE_WIDTH)
+	    {
+	      WideFloat in0Re = wideLoadFloats(x0Re + lane);
+	      WideFloat in0Im = wideLoadFloats(x0Im + lane);
+	      WideFloat in1Re = wideLoadFloats(x1Re + lane);
+	      WideFloat in1Im = wideLoadFloats(x1Im + lane);
+	      WideFloat in2Re = wideLoadFloats(x2Re + lane);
+	      WideFloat in2Im = wideLoadFloats(x2Im + lane);
+
+	      WideFloat y1Re = w1Re*in1Re - w1Im*in1Im;
+	      WideFloat y1Im = wideMulAddFloats(w1Re, in1Im, w1Im*in1Re);
+	      WideFloat y2Re = w2Re*in2Re - w2Im*in2Im;
+	      WideFloat y2Im = wideMulAddFloats(w2Re, in2Im, w2Im*in2Re);
+
+	      WideFloat sumRe = y1Re + y2Re;
+	      WideFloat sumIm = y1Im + y2Im;
+	      WideFloat midRe = in0Re - half*sumRe;
+	      WideFloat midIm = in0Im - half*sumIm;
+	      WideFloat rotRe = negRotScale*(y1Im - y2Im);
+	      WideFloat rotIm = posRotScale*(y1Re - y2Re);
+
+	      wideStoreFloats(x0Re + lane, in0Re + sumRe);
+	      wideStoreFloats(x0Im + lane, in0Im + sumIm);
+	      wideStoreFloats(x1Re + lane, midRe + rotRe);
+	      wideStoreFloats(x1Im + lane, midIm + rotIm);
+	      wideStoreFloats(x2Re + lane, midRe - rotRe);
+	      wideStoreFloats(x2Im + lane, midIm - rotIm);
+	    }
+	}
+    }
+}
+
+static FFT_BATCH_STAGE(fftBatchRadix5Wide_)
+{
+  u32 stride = stage->stride;
+  WideFloat c1 = wideSetConstantFloats(FFT_RADIX5_C1);
+  WideFloat c2 = wideSetConstantFloats(FFT_RADIX5_C2);
+  WideFloat s1 = wideSetConstantFloats(sign*FFT_RADIX5_S1);
+  WideFloat s2 = wideSetConstantFloats(sign*FFT_RADIX5_S2);
+  for(u32 k = 0; k < count; k += 5*stride)
+    {
+      for(u32 j = 0; j < stride; ++j)
+	{
+	  WideFloat wRe[5];
+	  WideFloat wIm[5];
+	  for(u32 q = 1; q < 5; ++q)
+	    {
+	      wRe[q] = wideSetConstantFloats(stage->twiddlesRe[(q - 1)*stride + j]);
+	      wIm[q] = wideSetConstantFloats(stage->twiddlesIm[(q - 1)*stride + j]);
+	    }
+
+	  r32 *atRe = reVals + (k + j)*laneCount;
+	  r32 *atIm = imVals + (k + j)*laneCount;
+	  u32 step = stride*laneCount;
+	  for(u32 lane = 0; lane < laneCount; lane += WIDE_WIDTH)
+	    {
+	      WideFloat yRe[5];
+	      WideFloat yIm[5];
+	      yRe[0] = wideLoadFloats(atRe + lane);
+	      yIm[0] = wideLoadFloats(atIm + lane);
+	      for(u32 q = 1; q < 5; ++q)
+		{
+		  WideFloat xRe = wideLoadFloats(atRe + q*step + lane);
+		  WideFloat xIm = wideLoadFloats(atIm + q*step + lane);
+		  yRe[q] = wRe[q]*xRe - wIm[q]*xIm;
+		  yIm[q] = wideMulAddFloats(wRe[q], xIm, wIm[q]*xRe);
+		}
+
+	      WideFloat t1Re = yRe[1] + yRe[4];
+	      WideFloat t1Im = yIm[1] + yIm[4];
+	      WideFloat t2Re = yRe[2] + yRe[3];
+	      WideFloat t2Im = yIm[2] + yIm[3];
+	      WideFloat t3Re = yRe[1] - yRe[4];
+	      WideFloat t3Im = yIm[1] - yIm[4];
+	      WideFloat t4Re = yRe[2] - yRe[3];
+	      WideFloat t4Im = yIm[2] - yIm[3];
+
+	      WideFloat a1Re = yRe[0] + c1*t1Re + c2*t2Re;
+	      WideFloat a1Im = yIm[0] + c1*t1Im + c2*t2Im;
+	      WideFloat a2Re = yRe[0] + c2*t1Re + c1*t2Re;
+	      WideFloat a2Im = yIm[0] + c2*t1Im + c1*t2Im;
+	      WideFloat b1Re = s1*t3Re + s2*t4Re;
+	      WideFloat b1Im = s1*t3Im + s2*t4Im;
+	      WideFloat b2Re = s2*t3Re - s1*t4Re;
+	      WideFloat b2Im = s2*t3Im - s1*t4Im;
+
+	      wideStoreFloats(atRe + lane, yRe[0] + t1Re + t2Re);
+	      wideStoreFloats(atIm + lane, yIm[0] + t1Im + t2Im);
+	      wideStoreFloats(atRe + step + lane, a1Re - b1Im);
+	      wideStoreFloats(atIm + step + lane, a1Im + b1Re);
+	      wideStoreFloats(atRe + 2*step + lane, a2Re - b2Im);
+	      wideStoreFloats(atIm + 2*step + lane, a2Im + b2Re);
+	      wideStoreFloats(atRe + 3*step + lane, a2Re + b2Im);
+	      wideStoreFloats(atIm + 3*step + lane, a2Im - b2Re);
+	      wideStoreFloats(atRe + 4*step + lane, a1Re + b1Im);
+	      wideStoreFloats(atIm + 4*step + lane, a1Im - b1Re);
+	    }
+	}
+    }
+}
+
+#if SIMD_HAS_WIDE8
+// NOTE: 8-lane versions of the power-of-2 kernels. Odd radices run the 4-lane kernels twice per
+//       element, which costs little, since 2 and 4 do most of the work at the sizes that matter
+static SIMD_TARGET_AVX2 FFT_BATCH_STAGE(fftBatchRadix2Wide8_)
+{
+  UNUSED(sign);
+  u32 half = stage->stride;
+  for(u32 k = 0; k < count; k += 2*half)
+    {
+      for(u32 j = 0; j < half; ++j)
+	{
+	  WideFloat8 wRe = wideSetConstantFloats8(stage->twiddlesRe[j]);
+	  WideFloat8 wIm = wideSetConstantFloats8(stage->twiddlesIm[j]);
+	  r32 *at0Re = reVals + (k + j)*laneCount;
+	  r32 *at0Im = imVals + (k + j)*laneCount;
+	  r32 *at1Re = at0Re + half*laneCount;
+	  r32 *at1Im = at0Im + half*laneCount;
+	  for(u32 lane = 0; lane < laneCount; lane += 8)
+	    {
+	      WideFloat8 in0Re = wideLoadFloats8(at0Re + lane);
+	      WideFloat8 in0Im = wideLoadFloats8(at0Im + lane);
+	      WideFloat8 in1Re = wideLoadFloats8(at1Re + lane);
+	      WideFloat8 in1Im = wideLoadFloats8(at1Im + lane);
+
+	      WideFloat8 tRe = wideSubFloats8(wideMulFloats8(wRe, in1Re), wideMulFloats8(wIm, in1Im));
+	      WideFloat8 tIm = wideMulAddFloats8(wRe, in1Im, wideMulFloats8(wIm, in1Re));
+
+	      wideStoreFloats8(at0Re + lane, wideAddFloats8(in0Re, tRe));
+	      wideStoreFloats8(at0Im + lane, wideAddFloats8(in0Im, tIm));
+	      wideStoreFloats8(at1Re + lane, wideSubFloats8(in0Re, tRe));
+	      wideStoreFloats8(at1Im + lane, wideSubFloats8(in0Im, tIm));
+	    }
+	}
+    }
+}
+
+static SIMD_TARGET_AVX2 FFT_BATCH_STAGE(fftBatchRadix4Wide8_)
+{
+  u32 stride = stage->stride;
+  WideFloat8 posSign = wideSetConstantFloats8(sign);
+  WideFloat8 negSign = wideSetConstantFloats8(-sign);
+  for(u32 k = 0; k < count; k += 4*stride)
+    {
+      for(u32 j = 0; j < stride; ++j)
+	{
+	  WideFloat8 w1Re = wideSetConstantFloats8(stage->twiddlesRe[j]);
+	  WideFloat8 w1Im = wideSetConstantFloats8(stage->twiddlesIm[j]);
+	  WideFloat8 w2Re = wideSetConstantFloats8(stage->twiddlesRe[stride + j]);
+	  WideFloat8 w2Im = wideSetConstantFloats8(stage->twiddlesIm[stride + j]);
+	  WideFloat8 w3Re = wideSetConstantFloats8(stage->twiddlesRe[2*stride + j]);
+	  WideFloat8 w3Im = wideSetConstantFloats8(stage->twiddlesIm[2*stride + j]);
+	  r32 *aRe = reVals + (k + j)*laneCount;
+	  r32 *aIm = imVals + (k + j)*laneCount;
+	  r32 *bRe = aRe + stride*laneCount;
+	  r32 *bIm = aIm + stride*laneCount;
+	  r32 *cRe = aRe + 2*stride*laneCount;
+	  r32 *cIm = aIm + 2*stride*laneCount;
+	  r32 *dRe = aRe + 3*stride*laneCount;
+	  r32 *dIm = aIm + 3*stride*laneCount;
+	  for(u32 lane = 0; lane < laneCount; lane += 8)
+	    {
+	      WideFloat8 inARe = wideLoadFloats8(aRe + lane);
+	      WideFloat8 inAIm = wideLoadFloats8(aIm + lane);
+	      WideFloat8 xBRe = wideLoadFloats8(bRe + lane);
+	      WideFloat8 xBIm = wideLoadFloats8(bIm + lane);
+	      WideFloat8 xCRe = wideLoadFloats8(cRe + lane);
+	      WideFloat8 xCIm = wideLoadFloats8(cIm + lane);
+	      WideFloat8 xDRe = wideLoadFloats8(dRe + lane);
+	      WideFloat8 xDIm = wideLoadFloats8(dIm + lane);
+
+	      WideFloat8 inBRe = wideSubFloats8(wideMulFloats8(w2Re, xBRe), wideMulFloats8(w2Im, xBIm));
+	      WideFloat8 inBIm = wideMulAddFloats8(w2Re, xBIm, wideMulFloats8(w2Im, xBRe));
+	      WideFloat8 inCRe = wideSubFloats8(wideMulFloats8(w1Re, xCRe), wideMulFloats8(w1Im, xCIm));
+	      WideFloat8 inCIm = wideMulAddFloats8(w1Re, xCIm, wideMulFloats8(w1Im, xCRe));
+	      WideFloat8 inDRe = wideSubFloats8(wideMulFloats8(w3Re, xDRe), wideMulFloats8(w3Im, xDIm));
+	      WideFloat8 inDIm = wideMulAddFloats8(w3Re, xDIm, wideMulFloats8(w3Im, xDRe));
+
+	      WideFloat8 sumABRe = wideAddFloats8(inARe, inBRe);
+	      WideFloat8 sumABIm = wideAddFloats8(inAIm, inBIm);
+	      WideFloat8 difABRe = wideSubFloats8(inARe, inBRe);
+	      WideFloat8 difABIm = wideSubFloats8(inAIm, inBIm);
+	      WideFloat8 sumCDRe = wideAddFloats8(inCRe, inDRe);
+	      WideFloat8 sumCDIm = wideAddFloats8(inCIm, inDIm);
+	      WideFloat8 rotCDRe = wideMulFloats8(negSign, wideSubFloats8(inCIm, inDIm));
+	      WideFloat8 rotCDIm = wideMulFloats8(posSign, wideSubFloats8(inCRe, inDRe));
+
+	      wideStoreFloats8(aRe + lane, wideAddFloats8(sumABRe, sumCDRe));
+	      wideStoreFloats8(aIm + lane, wideAddFloats8(sumABIm, sumCDIm));
+	      wideStoreFloats8(bRe + lane, wideAddFloats8(difABRe, rotCDRe));
+	      wideStoreFloats8(bIm + lane, wideAddFloats8(difABIm, rotCDIm));
+	      wideStoreFloats8(cRe + lane, wideSubFloats8(sumABRe, sumCDRe));
+	      wideStoreFloats8(cIm + lane, wideSubFloats8(sumABIm, sumCDIm));
+	      wideStoreFloats8(dRe + lane, wideSubFloats8(difABRe, rotCDRe));
+	      wideStoreFloats8(dIm + lane, wideSubFloats8(difABIm, rotCDIm));
+	    }
+	}
+    }
+}
+#endif
+
+// NOTE: moving a full group between the back-to-back layout and lanes. Every lane of element i
+//       reads the same index of its own transform, so interleaving is one gather per element,
+//       with the permutation (and any scaling) folded in. Deinterleaving gathers each transform's
+//       run of elements back out of the lanes
+static void
+fftBatchInterleave_(FFT_BatchPlan *batch, r32 *dest, r32 *src, r32 scale)
+{
+  FFT_Plan *plan = batch->plan;
+  u32 count = plan->count;
+  u32 laneCount = batch->laneCount;
+  u32 *permutation = plan->permutation;
+
+  u32 laneOffsets[WIDE_WIDTH];
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane) laneOffsets[lane] = lane*count;
+  WideInt offsets = wideLoadInts(laneOffsets);
+  WideFloat wideScale = wideSetConstantFloats(scale);
+  for(u32 i = 0; i < count; ++i)
+    {
+      for(u32 lane = 0; lane < laneCount; lane += WIDE_WIDTH)
+	{
+	  WideFloat vals = wideGatherFloats(src + lane*count + permutation[i], offsets);
+	  wideStoreFloats(dest + i*laneCount + lane, wideScale*vals);
+	}
+    }
+}
+
+static void
+fftBatchDeinterleave_(FFT_BatchPlan *batch, r32 *dest, r32 *src)
+{
+  u32 count = batch->plan->count;
+  u32 laneCount = batch->laneCount;
+
+  u32 elementOffsets[WIDE_WIDTH];
+  for(u32 i = 0; i < WIDE_WIDTH; ++i) elementOffsets[i] = i*laneCount;
+  WideInt offsets = wideLoadInts(elementOffsets);
+  u32 wideCount = count - (count % WIDE_WIDTH);
+  for(u32 lane = 0; lane < laneCount; ++lane)
+    {
+      r32 *laneDest = dest + lane*count;
+      for(u32 i = 0; i < wideCount; i += WIDE_WIDTH)
+	{
+	  wideStoreFloats(laneDest + i, wideGatherFloats(src + i*laneCount + lane, offsets));
+	}
+      for(u32 i = wideCount; i < count; ++i)
+	{
+	  laneDest[i] = src[i*laneCount + lane];
+	}
+    }
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 void
+fftBatchInterleaveWide8_(FFT_BatchPlan *batch, r32 *dest, r32 *src, r32 scale)
+{
+  FFT_Plan *plan = batch->plan;
+  u32 count = plan->count;
+  u32 *permutation = plan->permutation;
+
+  u32 laneOffsets[8];
+  for(u32 lane = 0; lane < 8; ++lane) laneOffsets[lane] = lane*count;
+  WideInt8 offsets = wideLoadInts8(laneOffsets);
+  WideFloat8 wideScale = wideSetConstantFloats8(scale);
+  for(u32 i = 0; i < count; ++i)
+    {
+      WideFloat8 vals = wideGatherFloats8(src + permutation[i], offsets);
+      wideStoreFloats8(dest + 8*i, wideMulFloats8(wideScale, vals));
+    }
+}
+
+static SIMD_TARGET_AVX2 void
+fftBatchDeinterleaveWide8_(FFT_BatchPlan *batch, r32 *dest, r32 *src)
+{
+  u32 count = batch->plan->count;
+
+  u32 elementOffsets[8];
+  for(u32 i = 0; i < 8; ++i) elementOffsets[i] = 8*i;
+  WideInt8 offsets = wideLoadInts8(elementOffsets);
+  u32 wideCount = count - (count % 8);
+  for(u32 lane = 0; lane < 8; ++lane)
+    {
+      r32 *laneDest = dest + lane*count;
+      for(u32 i = 0; i < wideCount; i += 8)
+	{
+	  wideStoreFloats8(laneDest + i, wideGatherFloats8(src + 8*i + lane, offsets));
+	}
+      for(u32 i = wideCount; i < count; ++i)
+	{
+	  laneDest[i] = src[8*i + lane];
+	}
+    }
+}
+#endif
+
+// NOTE: a partial last group, with its unused lanes zeroed
+static void
+fftBatchInterleavePartial_(FFT_BatchPlan *batch, r32 *dest, r32 *src, r32 scale, u32 activeLanes)
+{
+  FFT_Plan *plan = batch->plan;
+  u32 count = plan->count;
+  u32 laneCount = batch->laneCount;
+  u32 *permutation = plan->permutation;
+
+  ZERO_ARRAY(dest, count*laneCount, r32);
+  for(u32 lane = 0; lane < activeLanes; ++lane)
+    {
+      r32 *laneSrc = src + lane*count;
+      for(u32 i = 0; i < count; ++i)
+	{
+	  dest[i*laneCount + lane] = scale*laneSrc[permutation[i]];
+	}
+    }
+}
+
+static void
+fftBatchDeinterleavePartial_(FFT_BatchPlan *batch, r32 *dest, r32 *src, u32 activeLanes)
+{
+  u32 count = batch->plan->count;
+  u32 laneCount = batch->laneCount;
+  for(u32 lane = 0; lane < activeLanes; ++lane)
+    {
+      r32 *laneDest = dest + lane*count;
+      for(u32 i = 0; i < count; ++i)
+	{
+	  laneDest[i] = src[i*laneCount + lane];
+	}
+    }
+}
+
+static void
+fftBatchToLanes_(FFT_BatchPlan *batch, r32 *dest, r32 *src, r32 scale, u32 activeLanes)
+{
+  if(activeLanes < batch->laneCount)
+    {
+      fftBatchInterleavePartial_(batch, dest, src, scale, activeLanes);
+    }
+#if SIMD_HAS_WIDE8
+  else if(batch->laneCount == 8 && batch->simdLevel >= SimdLevel_wide8)
+    {
+      fftBatchInterleaveWide8_(batch, dest, src, scale);
+    }
+#endif
+  else
+    {
+      fftBatchInterleave_(batch, dest, src, scale);
+    }
+}
+
+static void
+fftBatchFromLanes_(FFT_BatchPlan *batch, r32 *dest, r32 *src, u32 activeLanes)
+{
+  if(activeLanes < batch->laneCount)
+    {
+      fftBatchDeinterleavePartial_(batch, dest, src, activeLanes);
+    }
+#if SIMD_HAS_WIDE8
+  else if(batch->laneCount == 8 && batch->simdLevel >= SimdLevel_wide8)
+    {
+      fftBatchDeinterleaveWide8_(batch, dest, src);
+    }
+#endif
+  else
+    {
+      fftBatchDeinterleave_(batch, dest, src);
+    }
+}
+
+static void
+fftBatchRunStages_(FFT_BatchPlan *batch, r32 *reVals, r32 *imVals)
+{
+  FFT_Plan *plan = batch->plan;
+  u32 count = plan->count;
+  u32 laneCount = batch->laneCount;
+  r32 sign = (plan->direction == FFT_Direction_forward) ? -1.f : 1.f;
+
+  b32 useWide8 = false;
+#if SIMD_HAS_WIDE8
+  useWide8 = (batch->simdLevel >= SimdLevel_wide8) && ((laneCount % 8) == 0);
+#endif
+
+  for(u32 stageIdx = 0; stageIdx < plan->stageCount; ++stageIdx)
+    {
+      FFT_PlanStage *stage = plan->stages + stageIdx;
+      switch(stage->radix)
+	{
+	case 2:
+	  {
+#if SIMD_HAS_WIDE8
+	    if(useWide8) { fftBatchRadix2Wide8_(reVals, imVals, stage, count, laneCount, sign); break; }
+#endif
+	    fftBatchRadix2Wide_(reVals, imVals, stage, count, laneCount, sign);
+	  } break;
+
+	case 4:
+	  {
+#if SIMD_HAS_WIDE8
+	    if(useWide8) { fftBatchRadix4Wide8_(reVals, imVals, stage, count, laneCount, sign); break; }
+#endif
+	    fftBatchRadix4Wide_(reVals, imVals, stage, count, laneCount, sign);
+	  } break;
+
+	case 3: { fftBatchRadix3Wide_(reVals, imVals, stage, count, laneCount, sign); } break;
+	case 5: { fftBatchRadix5Wide_(reVals, imVals, stage, count, laneCount, sign); } break;
+
+	default: { ASSERT(!"unsupported fft radix"); } break;
+	}
+    }
+  UNUSED(useWide8);
+}
+
+// NOTE: complex to complex, in place, over one group of lanes in the lane-interleaved layout
+//       (plan->count*laneCount values each). inverse plans scale by 1/count
+static void
+fftBatchExecuteLanes(FFT_BatchPlan *batch, r32 *reLanes, r32 *imLanes)
+{
+  PROFILE_FUNCTION();
+
+  FFT_Plan *plan = batch->plan;
+  u32 count = plan->count;
+  u32 laneCount = batch->laneCount;
+  u32 *permutation = plan->permutation;
+  r32 *lanesRe = batch->lanesRe;
+  r32 *lanesIm = batch->lanesIm;
+
+  COPY_ARRAY(lanesRe, reLanes, count*laneCount, r32);
+  COPY_ARRAY(lanesIm, imLanes, count*laneCount, r32);
+  for(u32 i = 0; i < count; ++i)
+    {
+      COPY_ARRAY(reLanes + i*laneCount, lanesRe + permutation[i]*laneCount, laneCount, r32);
+      COPY_ARRAY(imLanes + i*laneCount, lanesIm + permutation[i]*laneCount, laneCount, r32);
+    }
+
+  fftBatchRunStages_(batch, reLanes, imLanes);
+
+  if(plan->direction == FFT_Direction_inverse)
+    {
+      r32 invCount = 1.f / (r32)count;
+      for(u32 i = 0; i < count*laneCount; ++i)
+	{
+	  reLanes[i] *= invCount;
+	  imLanes[i] *= invCount;
+	}
+    }
+}
+
+// NOTE: real to complex, over `transformCount` transforms stored back to back (transform t's
+//       samples start at input + t*plan->count, and likewise for the outputs). The transforms
+//       are moved into lanes a group at a time; a partial last group runs with its unused lanes
+//       zeroed. Batches that loop the plan run it once per transform
+static void
+fftBatchExecuteReal(FFT_BatchPlan *batch, r32 *outputRe, r32 *outputIm, r32 *input, u32 transformCount)
+{
+  PROFILE_FUNCTION();
+
+  FFT_Plan *plan = batch->plan;
+  ASSERT(plan->direction == FFT_Direction_forward);
+
+  u32 count = plan->count;
+  u32 laneCount = batch->laneCount;
+  if(batch->loopsPlan)
+    {
+      for(u32 transformIdx = 0; transformIdx < transformCount; ++transformIdx)
+	{
+	  usz offset = (usz)transformIdx*count;
+	  fftPlanExecuteReal(plan, outputRe + offset, outputIm + offset, input + offset);
+	}
+    }
+  else
+    {
+      for(u32 first = 0; first < transformCount; first += laneCount)
+	{
+	  u32 activeLanes = MIN(laneCount, transformCount - first);
+	  usz offset = (usz)first*count;
+	  fftBatchToLanes_(batch, batch->lanesRe, input + offset, 1.f, activeLanes);
+	  ZERO_ARRAY(batch->lanesIm, count*laneCount, r32);
+
+	  fftBatchRunStages_(batch, batch->lanesRe, batch->lanesIm);
+
+	  fftBatchFromLanes_(batch, outputRe + offset, batch->lanesRe, activeLanes);
+	  fftBatchFromLanes_(batch, outputIm + offset, batch->lanesIm, activeLanes);
+	}
+    }
+}
+
+// NOTE: complex to real, discarding the imaginary part, over transforms stored back to back
+static void
+ifftBatchExecuteReal(FFT_BatchPlan *batch, r32 *output, r32 *inputRe, r32 *inputIm, u32 transformCount)
+{
+  PROFILE_FUNCTION();
+
+  FFT_Plan *plan = batch->plan;
+  ASSERT(plan->direction == FFT_Direction_inverse);
+
+  u32 count = plan->count;
+  u32 laneCount = batch->laneCount;
+  r32 invCount = 1.f / (r32)count;
+  if(batch->loopsPlan)
+    {
+      for(u32 transformIdx = 0; transformIdx < transformCount; ++transformIdx)
+	{
+	  usz offset = (usz)transformIdx*count;
+	  ifftPlanExecuteReal(plan, output + offset, inputRe + offset, inputIm + offset);
+	}
+    }
+  else
+    {
+      for(u32 first = 0; first < transformCount; first += laneCount)
+	{
+	  u32 activeLanes = MIN(laneCount, transformCount - first);
+	  usz offset = (usz)first*count;
+	  fftBatchToLanes_(batch, batch->lanesRe, inputRe + offset, invCount, activeLanes);
+	  fftBatchToLanes_(batch, batch->lanesIm, inputIm + offset, invCount, activeLanes);
+
+	  fftBatchRunStages_(batch, batch->lanesRe, batch->lanesIm);
+
+	  fftBatchFromLanes_(batch, output + offset, batch->lanesRe, activeLanes);
+	}
+    }
+}
+
 #if 0
 #define REAL_FFT_FUNCTION(name) void (name)(r32 *destRe, r32 *destIm, r32 *src, u32 length)
 #define REAL_IFFT_FUNCTION(name) void (name)(r32 *dest, r32 *destImTemp, r32 *srcRe, r32 *srcIm, u32 length)
@@ -8,10 +8,8 @@ struct FFT_TestResult
 };
 
 static FFT_TestResult
-testFFTFunction(Arena *arena, FFT_Function *fft, FloatBuffer input, ComplexBuffer target)
+testFFTResult(Arena *arena, ComplexBuffer fftResult, ComplexBuffer target)
 {
-  ComplexBuffer fftResult = fft(arena, input);
-
   String8List log = {};
   
   b32 success = target.count == fftResult.count;
@@ -52,16 +50,13 @@ testFFTFunction(Arena *arena, FFT_Function *fft, FloatBuffer input, ComplexBuffe
 
   FFT_TestResult result = {};
   result.success = success;
-  result.cycleCount = 0; // TODO: profile
   result.log = log;
   return(result);
 }
 
 static FFT_TestResult
-testIFFTFunction(Arena *arena, IFFT_Function *ifft, ComplexBuffer input, FloatBuffer target)
+testIFFTResult(Arena *arena, FloatBuffer ifftResult, FloatBuffer target)
 {
-  FloatBuffer ifftResult = ifft(arena, input);
-
   String8List log = {};
 
   b32 success = target.count == ifftResult.count;
@@ -97,11 +92,360 @@ testIFFTFunction(Arena *arena, IFFT_Function *ifft, ComplexBuffer input, FloatBu
 
   FFT_TestResult result = {};
   result.success = success;
-  result.cycleCount = 0; // TODO: profile
   result.log = log;
   return(result);
 }
 
+static FFT_TestResult
+testFFTFunction(Arena *arena, FFT_Function *fft, FloatBuffer input, ComplexBuffer target)
+{
+  u64 start = getCpuCounter();
+  ComplexBuffer fftResult = fft(arena, input);
+  u64 cycleCount = getCpuCounter() - start;
+
+  FFT_TestResult result = testFFTResult(arena, fftResult, target);
+  result.cycleCount = cycleCount;
+  return(result);
+}
+
+static FFT_TestResult
+testIFFTFunction(Arena *arena, IFFT_Function *ifft, ComplexBuffer input, FloatBuffer target)
+{
+  u64 start = getCpuCounter();
+  FloatBuffer ifftResult = ifft(arena, input);
+  u64 cycleCount = getCpuCounter() - start;
+
+  FFT_TestResult result = testIFFTResult(arena, ifftResult, target);
+  result.cycleCount = cycleCount;
+  return(result);
+}
+
+static FFT_TestResult
+testFFTPlan(Arena *arena, FFT_Plan *plan, FloatBuffer input, ComplexBuffer target)
+{
+  ComplexBuffer fftResult = {};
+  fftResult.count = plan->count;
+  fftResult.reVals = arenaPushArray(arena, plan->count, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+  fftResult.imVals = arenaPushArray(arena, plan->count, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+
+  u64 start = getCpuCounter();
+  fftPlanExecuteReal(plan, fftResult.reVals, fftResult.imVals, input.vals);
+  u64 cycleCount = getCpuCounter() - start;
+
+  FFT_TestResult result = testFFTResult(arena, fftResult, target);
+  result.cycleCount = cycleCount;
+  return(result);
+}
+
+static FFT_TestResult
+testIFFTPlan(Arena *arena, FFT_Plan *plan, ComplexBuffer input, FloatBuffer target)
+{
+  FloatBuffer ifftResult = {};
+  ifftResult.count = plan->count;
+  ifftResult.vals = arenaPushArray(arena, plan->count, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+
+  u64 start = getCpuCounter();
+  ifftPlanExecuteReal(plan, ifftResult.vals, input.reVals, input.imVals);
+  u64 cycleCount = getCpuCounter() - start;
+
+  FFT_TestResult result = testIFFTResult(arena, ifftResult, target);
+  result.cycleCount = cycleCount;
+  return(result);
+}
+
+// NOTE: O(count^2) reference transform, for sizes the stored test signals don't cover. Angles are
+//       reduced to a table index before lookup, and sums are accumulated in double precision
+static ComplexBuffer
+testDirectDFT(Arena *arena, FloatBuffer input)
+{
+  u32 count = (u32)input.count;
+  ComplexBuffer result = {};
+  result.count = count;
+  result.reVals = arenaPushArray(arena, count, r32);
+  result.imVals = arenaPushArray(arena, count, r32);
+
+  TemporaryMemory temp = arenaBeginTemporaryMemory(arena);
+  r32 *cosTable = arenaPushArray(temp.arena, count, r32);
+  r32 *sinTable = arenaPushArray(temp.arena, count, r32);
+  for(u32 i = 0; i < count; ++i)
+    {
+      r32 theta = -2.f * GS_PI * (r32)i / (r32)count;
+      cosTable[i] = gsCos(theta);
+      sinTable[i] = gsSin(theta);
+    }
+
+  for(u32 k = 0; k < count; ++k)
+    {
+      r64 sumRe = 0;
+      r64 sumIm = 0;
+      u32 index = 0;
+      for(u32 n = 0; n < count; ++n)
+	{
+	  sumRe += (r64)input.vals[n]*(r64)cosTable[index];
+	  sumIm += (r64)input.vals[n]*(r64)sinTable[index];
+	  index += k;
+	  if(index >= count) index -= count;
+	}
+      result.reVals[k] = (r32)sumRe;
+      result.imVals[k] = (r32)sumIm;
+    }
+
+  arenaEndTemporaryMemory(temp);
+  return(result);
+}
+
+// NOTE: checks the real, complex and inverse paths of a plan pair against a reference transform.
+//       Error is measured relative to the largest bin, since mixed-radix sizes put the test
+//       signal's energy in few bins, and relative error is meaningless in the others
+static FFT_TestResult
+testFFTPlanDirect(Arena *arena, FFT_Plan *plan, FFT_Plan *inversePlan,
+		  FloatBuffer input, ComplexBuffer target)
+{
+  String8List log = {};
+  u32 count = plan->count;
+  ArenaPushFlags flags = arenaFlagsNoZeroAlign(4*sizeof(r32));
+  r32 *realRe = arenaPushArray(arena, count, r32, flags);
+  r32 *realIm = arenaPushArray(arena, count, r32, flags);
+  r32 *complexRe = arenaPushArray(arena, count, r32, flags);
+  r32 *complexIm = arenaPushArray(arena, count, r32, flags);
+  r32 *roundTrip = arenaPushArray(arena, count, r32, flags);
+
+  u64 start = getCpuCounter();
+  fftPlanExecuteReal(plan, realRe, realIm, input.vals);
+  u64 cycleCount = getCpuCounter() - start;
+
+  for(u32 i = 0; i < count; ++i)
+    {
+      complexRe[i] = input.vals[i];
+      complexIm[i] = 0.f;
+    }
+  fftPlanExecute(plan, complexRe, complexIm);
+  ifftPlanExecuteReal(inversePlan, roundTrip, realRe, realIm);
+
+  r32 peak = 0.f;
+  for(u32 i = 0; i < count; ++i)
+    {
+      peak = MAX(peak, gsSqrt(target.reVals[i]*target.reVals[i] + target.imVals[i]*target.imVals[i]));
+    }
+
+  r32 tol = 1e-4f;
+  r32 maxRealError = 0.f;
+  r32 maxComplexError = 0.f;
+  r32 maxRoundTripError = 0.f;
+  for(u32 i = 0; i < count; ++i)
+    {
+      maxRealError = MAX(maxRealError, gsAbs(realRe[i] - target.reVals[i]));
+      maxRealError = MAX(maxRealError, gsAbs(realIm[i] - target.imVals[i]));
+      maxComplexError = MAX(maxComplexError, gsAbs(complexRe[i] - target.reVals[i]));
+      maxComplexError = MAX(maxComplexError, gsAbs(complexIm[i] - target.imVals[i]));
+      maxRoundTripError = MAX(maxRoundTripError, gsAbs(roundTrip[i] - input.vals[i]));
+    }
+
+  b32 success = ((maxRealError < tol*peak) &&
+		 (maxComplexError < tol*peak) &&
+		 (maxRoundTripError < tol));
+  if(!success)
+    {
+      stringListPushFormat(arena, &log,
+			   "fft plan (%u samples) discrepancy:\n"
+			   "  real max error = %.7f\n"
+			   "  complex max error = %.7f\n"
+			   "  round trip max error = %.7f\n"
+			   "  peak = %.4f\n",
+			   count, maxRealError, maxComplexError, maxRoundTripError, peak);
+    }
+
+  FFT_TestResult result = {};
+  result.success = success;
+  result.cycleCount = cycleCount;
+  result.log = log;
+  return(result);
+}
+
+// NOTE: checks a batch against the plan it shares, run one transform at a time, and the inverse
+//       batch's round trip against the input
+static FFT_TestResult
+testFFTBatch(Arena *arena, FFT_BatchPlan *batch, FFT_BatchPlan *inverseBatch,
+	     FloatBuffer inputs, u32 transformCount)
+{
+  String8List log = {};
+  FFT_Plan *plan = batch->plan;
+  u32 count = plan->count;
+  usz totalCount = (usz)count*transformCount;
+  ArenaPushFlags flags = arenaFlagsNoZeroAlign(4*sizeof(r32));
+  r32 *batchRe = arenaPushArray(arena, totalCount, r32, flags);
+  r32 *batchIm = arenaPushArray(arena, totalCount, r32, flags);
+  r32 *roundTrip = arenaPushArray(arena, totalCount, r32, flags);
+  r32 *targetRe = arenaPushArray(arena, count, r32, flags);
+  r32 *targetIm = arenaPushArray(arena, count, r32, flags);
+
+  u64 start = getCpuCounter();
+  fftBatchExecuteReal(batch, batchRe, batchIm, inputs.vals, transformCount);
+  u64 cycleCount = getCpuCounter() - start;
+  ifftBatchExecuteReal(inverseBatch, roundTrip, batchRe, batchIm, transformCount);
+
+  r32 tol = 1e-4f;
+  r32 maxError = 0.f;
+  r32 maxRoundTripError = 0.f;
+  r32 peak = 0.f;
+  for(u32 transformIdx = 0; transformIdx < transformCount; ++transformIdx)
+    {
+      usz offset = (usz)transformIdx*count;
+      fftPlanExecuteReal(plan, targetRe, targetIm, inputs.vals + offset);
+      for(u32 i = 0; i < count; ++i)
+	{
+	  peak = MAX(peak, gsAbs(targetRe[i]) + gsAbs(targetIm[i]));
+	  maxError = MAX(maxError, gsAbs(batchRe[offset + i] - targetRe[i]));
+	  maxError = MAX(maxError, gsAbs(batchIm[offset + i] - targetIm[i]));
+	  maxRoundTripError = MAX(maxRoundTripError, gsAbs(roundTrip[offset + i] - inputs.vals[offset + i]));
+	}
+    }
+
+  // NOTE: the lane-interleaved path, over the first group of transforms
+  u32 laneCount = batch->laneCount;
+  r32 maxLanesError = 0.f;
+  if(transformCount >= laneCount)
+    {
+      r32 *lanesRe = arenaPushArray(arena, count*laneCount, r32, flags);
+      r32 *lanesIm = arenaPushArray(arena, count*laneCount, r32, flags);
+      for(u32 i = 0; i < count; ++i)
+	{
+	  for(u32 lane = 0; lane < laneCount; ++lane)
+	    {
+	      lanesRe[i*laneCount + lane] = inputs.vals[lane*count + i];
+	      lanesIm[i*laneCount + lane] = 0.f;
+	    }
+	}
+
+      fftBatchExecuteLanes(batch, lanesRe, lanesIm);
+      for(u32 i = 0; i < count; ++i)
+	{
+	  for(u32 lane = 0; lane < laneCount; ++lane)
+	    {
+	      maxLanesError = MAX(maxLanesError, gsAbs(lanesRe[i*laneCount + lane] - batchRe[lane*count + i]));
+	      maxLanesError = MAX(maxLanesError, gsAbs(lanesIm[i*laneCount + lane] - batchIm[lane*count + i]));
+	    }
+	}
+    }
+
+  b32 success = ((maxError < tol*peak) &&
+		 (maxLanesError < tol*peak) &&
+		 (maxRoundTripError < tol));
+  if(!success)
+    {
+      stringListPushFormat(arena, &log,
+			   "fft batch (%u x %u samples, %u lanes) discrepancy:\n"
+			   "  max error = %.7f\n"
+			   "  lanes max error = %.7f\n"
+			   "  round trip max error = %.7f\n"
+			   "  peak = %.4f\n",
+			   transformCount, count, laneCount, maxError, maxLanesError,
+			   maxRoundTripError, peak);
+    }
+
+  FFT_TestResult result = {};
+  result.success = success;
+  result.cycleCount = cycleCount;
+  result.log = log;
+  return(result);
+}
+
+// NOTE: checks a convolver against direct convolution. The input is fed in uneven chunks, to
+//       exercise the block fifo, and the convolver's output is expected to lag by its block size
+static FFT_TestResult
+testConvolverDirect(Arena *arena, Convolver *convolver, FloatBuffer impulse, FloatBuffer input)
+{
+  String8List log = {};
+  u32 count = (u32)input.count;
+  u32 latency = convolver->blockSize;
+  r32 *output = arenaPushArray(arena, count, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+
+  convolverReset(convolver);
+  u32 chunkSizes[] = {1, 37, 256, 5, 1000, 64};
+  u32 processed = 0;
+  u64 cycleCount = 0;
+  for(u32 chunkIdx = 0; processed < count; ++chunkIdx)
+    {
+      u32 chunkCount = MIN(chunkSizes[chunkIdx % ARRAY_COUNT(chunkSizes)], count - processed);
+      u64 start = getCpuCounter();
+      convolverProcess(convolver, output + processed, input.vals + processed, chunkCount);
+      cycleCount += getCpuCounter() - start;
+      processed += chunkCount;
+    }
+
+  r32 peak = 0.f;
+  r32 maxError = 0.f;
+  for(u32 n = 0; n < count; ++n)
+    {
+      r64 target = 0;
+      if(n >= latency)
+	{
+	  u32 m = n - latency;
+	  u32 kEnd = MIN(m + 1, (u32)impulse.count);
+	  for(u32 k = 0; k < kEnd; ++k)
+	    {
+	      target += (r64)impulse.vals[k]*(r64)input.vals[m - k];
+	    }
+	}
+
+      peak = MAX(peak, gsAbs((r32)target));
+      maxError = MAX(maxError, gsAbs(output[n] - (r32)target));
+    }
+
+  r32 tol = 1e-4f;
+  b32 success = (maxError < tol*peak);
+  if(!success)
+    {
+      stringListPushFormat(arena, &log,
+			   "convolver (%u impulse samples, %u segments) discrepancy:\n"
+			   "  max error = %.7f\n"
+			   "  peak = %.4f\n",
+			   (u32)impulse.count, convolver->segmentCount, maxError, peak);
+    }
+
+  FFT_TestResult result = {};
+  result.success = success;
+  result.cycleCount = cycleCount;
+  result.log = log;
+  return(result);
+}
+
+// NOTE: benchmarks report the fastest of `iterations` calls, in cpu counter ticks
+static u64
+benchmarkFFTFunction(Arena *arena, FFT_Function *fft, FloatBuffer input, u32 iterations)
+{
+  u64 result = (u64)-1;
+  for(u32 i = 0; i < iterations; ++i)
+    {
+      TemporaryMemory temp = arenaBeginTemporaryMemory(arena);
+      u64 start = getCpuCounter();
+      fft(temp.arena, input);
+      result = MIN(result, getCpuCounter() - start);
+      arenaEndTemporaryMemory(temp);
+    }
+
+  return(result);
+}
+
+static u64
+benchmarkFFTPlan(Arena *arena, FFT_Plan *plan, FloatBuffer input, u32 iterations)
+{
+  TemporaryMemory temp = arenaBeginTemporaryMemory(arena);
+  r32 *outputRe = arenaPushArray(temp.arena, plan->count, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+  r32 *outputIm = arenaPushArray(temp.arena, plan->count, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+
+  u64 result = (u64)-1;
+  for(u32 i = 0; i < iterations; ++i)
+    {
+      u64 start = getCpuCounter();
+      fftPlanExecuteReal(plan, outputRe, outputIm, input.vals);
+      result = MIN(result, getCpuCounter() - start);
+    }
+
+  arenaEndTemporaryMemory(temp);
+  return(result);
+}
+
 #if 0
 static bool
 fftTest(Arena *allocator)
@@ -142,3 +486,50 @@ fftTest(Arena *allocator)
   return(result);
 }
 #endif
+
+// NOTE: `transformCount` transforms, batched vs. executed one at a time
+static u64
+benchmarkFFTBatch(Arena *arena, FFT_BatchPlan *batch, FloatBuffer inputs, u32 transformCount,
+		  u32 iterations)
+{
+  u32 count = batch->plan->count;
+  TemporaryMemory temp = arenaBeginTemporaryMemory(arena);
+  r32 *outputRe = arenaPushArray(temp.arena, (usz)count*transformCount, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+  r32 *outputIm = arenaPushArray(temp.arena, (usz)count*transformCount, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+
+  u64 result = (u64)-1;
+  for(u32 i = 0; i < iterations; ++i)
+    {
+      u64 start = getCpuCounter();
+      fftBatchExecuteReal(batch, outputRe, outputIm, inputs.vals, transformCount);
+      result = MIN(result, getCpuCounter() - start);
+    }
+
+  arenaEndTemporaryMemory(temp);
+  return(result);
+}
+
+static u64
+benchmarkFFTPlanLoop(Arena *arena, FFT_Plan *plan, FloatBuffer inputs, u32 transformCount,
+		     u32 iterations)
+{
+  u32 count = plan->count;
+  TemporaryMemory temp = arenaBeginTemporaryMemory(arena);
+  r32 *outputRe = arenaPushArray(temp.arena, (usz)count*transformCount, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+  r32 *outputIm = arenaPushArray(temp.arena, (usz)count*transformCount, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+
+  u64 result = (u64)-1;
+  for(u32 i = 0; i < iterations; ++i)
+    {
+      u64 start = getCpuCounter();
+      for(u32 transformIdx = 0; transformIdx < transformCount; ++transformIdx)
+	{
+	  usz offset = (usz)transformIdx*count;
+	  fftPlanExecuteReal(plan, outputRe + offset, outputIm + offset, inputs.vals + offset);
+	}
+      result = MIN(result, getCpuCounter() - start);
+    }
+
+  arenaEndTemporaryMemory(temp);
+  return(result);
+}
@@ -2,43 +2,9 @@
 //       in the codebase, and not depend on other things already being defined
 
 #define RIFF_CODE(a, b, c, d) (((u32)(a) << 0) | ((u32)(b) << 8) | ((u32)(c) << 16) | ((u32)(d) << 24))
-enum
-{
-  WAVE_CHUNK_ID_fmt = RIFF_CODE('f', 'm', 't', ' '),
-  WAVE_CHUNK_ID_data = RIFF_CODE('d', 'a', 't', 'a'),
-  WAVE_CHUNK_ID_RIFF = RIFF_CODE('R', 'I', 'F', 'F'),
-  WAVE_CHUNK_ID_WAVE = RIFF_CODE('W', 'A', 'V', 'E'),
-};
 
 #pragma pack(push, 1)
 
-struct WavHeader
-{
-  u32 RIFFID;
-  u32 size;
-  u32 WAVEID;
-};
-
-struct WavChunk
-{
-  u32 ID;
-  u32 size;
-};
-
-struct WavFormat
-{
-  u16 wFormatTag;
-  u16 nChannels;
-  u32 nSamplesPerSec;
-  u32 nAverageBytesPerSec;
-  u16 nBlockAlign;
-  u16 wBitsPerSample;
-  u16 cbSize;
-  u16 wValidBitsPerSample;
-  u32 dwChannelMask;
-  u8 subFormat[16];
-};
-
 struct BitmapHeader
 {
   u16 signature;
@@ -66,333 +32,6 @@ struct BitmapHeader
 #pragma pack(pop)
 
 #if 0
-struct RiffIterator
-{
-  u8 *at;
-  u8 *end;
-};
-
-static inline bool
-isValid(RiffIterator it)
-{
-  bool result = it.at < it.end;
-
-  return(result);
-}
-
-static inline RiffIterator
-nextChunk(RiffIterator it)
-{
-  WavChunk *chunk = (WavChunk *)it.at;
-  u32 size = ROUND_UP_TO_MULTIPLE_OF_2(chunk->size);
-  it.at += sizeof(WavChunk) + size;
-
-  return(it);
-}
-
-static inline LoadedSound
-loadWav(Arena *permanentAllocator, String8 filename)
-{
-  LoadedSound result = {};
-
-  TemporaryMemory scratch = arenaGetScratch(&permanentAllocator, 1);
-
-  Buffer readResult = gsReadEntireFile((char*)filename.str, scratch.arena);
-  if(readResult.contents)
-    {
-      WavHeader *header = (WavHeader *)readResult.contents;
-      ASSERT(header->RIFFID == WAVE_CHUNK_ID_RIFF);
-      ASSERT(header->WAVEID == WAVE_CHUNK_ID_WAVE);
-
-      u32 channelCount = 0;
-      u32 sampleDataSize = 0;
-      u32 bytesPerSample = 0;
-      u32 sampleRate = 0;
-      void *sampleData = 0;
-
-      RiffIterator it = {};
-      it.at = (u8 *)(header + 1);
-      it.end = it.at + header->size - 4;
-      for(; isValid(it); it = nextChunk(it))
-	{
-	  WavChunk *chunk = (WavChunk *)it.at;
-	  u32 chunkID = chunk->ID;
-	  u32 chunkSize = chunk->size;
-	  
-	  switch(chunkID)
-	    {
-	    case WAVE_CHUNK_ID_fmt:
-	      {		
-		WavFormat *fmt = (WavFormat *)(it.at + sizeof(WavChunk));
-		ASSERT(fmt->wFormatTag == 1); // NOTE: only support pcm
-		//ASSERT(fmt->nSamplesPerSec == 48000); // TODO: up/down-sample to the internal rate
-		sampleRate = fmt->nSamplesPerSec;
-		bytesPerSample = fmt->wBitsPerSample/8;
-		ASSERT(fmt->nBlockAlign == (bytesPerSample*fmt->nChannels));
-		
-	        channelCount = fmt->nChannels;
-	      } break;
-
-	    case WAVE_CHUNK_ID_data:
-	      {		
-		sampleData = it.at + sizeof(WavChunk);
-		sampleDataSize = chunkSize;
-	      } break;
-	    }
-	}
-      ASSERT(sampleData && channelCount);      
-
-      r32 sampleRateConversionFactor = ((r32)INTERNAL_SAMPLE_RATE/(r32)sampleRate);
-      
-      u32 sourceSampleCount = sampleDataSize/(channelCount*bytesPerSample);      
-      u32 destSampleCount = ROUND_UP_TO_MULTIPLE_OF_2((u32)(sampleRateConversionFactor*sourceSampleCount));
-      u32 paddedDestSampleCount = ROUND_UP_TO_MULTIPLE(destSampleCount, FILE_GRAIN_LENGTH);
-      u32 maxSampleCount = MAX(sourceSampleCount, paddedDestSampleCount);
-
-      // NOTE: we allocate more space than we actually need for storing samples, since we use these buffers
-      //       as both inputs to the fft and destinations of the ifft when doing sample-rate conversion
-      result.sampleCount = destSampleCount + 0;
-      result.channelCount = channelCount;
-      result.samples[0] = arenaPushArray(permanentAllocator, 2*maxSampleCount, r32);
-      result.samples[1] = result.samples[0] + maxSampleCount;//arenaPushArray(permanentAllocator, maxSampleCount, r32);
-       
-      // NOTE: convert sample format         
-#define CONVERT_SAMPLE(srcData, srcSample, type, channels) do {	\
-	type sample = *(type *)srcData;				\
-	srcSample = (r32)sample/(r32)type##_MAX;		\
-	srcData = (type *)srcData + channels;			\
-      } while(0)
-      
-      r32 *destSamplesL = result.samples[0];
-      r32 *destSamplesR = result.samples[1];
-      void *srcDataL = sampleData;
-      // TODO: it might be worthwhile doing some kind of dynamic dispatch here
-      if(channelCount == 1)
-	{
-	  if(bytesPerSample == 1)
-	    {
-	      for(u32 sampleIndex = 0; sampleIndex < sourceSampleCount; ++sampleIndex)
-		{
-		  r32 srcSample = 0;
-		  CONVERT_SAMPLE(srcDataL, srcSample, u8, channelCount);
-	      
-		  *destSamplesL++ = srcSample;
-		  *destSamplesR++ = srcSample;
-		}
-	    }
-	  else if(bytesPerSample == 2)
-	    {
-	      for(u32 sampleIndex = 0; sampleIndex < sourceSampleCount; ++sampleIndex)
-		{
-		  r32 srcSample = 0;
-		  CONVERT_SAMPLE(srcDataL, srcSample, s16, channelCount);
-	      
-		  *destSamplesL++ = srcSample;
-		  *destSamplesR++ = srcSample;
-		}
-	    }
-	  else if(bytesPerSample == 4)
-	    {
-	      for(u32 sampleIndex = 0; sampleIndex < sourceSampleCount; ++sampleIndex)
-		{
-		  r32 srcSample = 0;
-		  CONVERT_SAMPLE(srcDataL, srcSample, r32, channelCount);
-	      
-		  *destSamplesL++ = srcSample;
-		  *destSamplesR++ = srcSample;
-		}
-	    }
-	  else
-	    {
-	      ASSERT(!"ERROR: unsupported sample size");
-	    }
-	}
-      else if(channelCount == 2)
-	{
-	  void *srcDataR = (u8 *)sampleData + bytesPerSample;
-	  if(bytesPerSample == 1)
-	    {
-	      for(u32 sampleIndex = 0; sampleIndex < sourceSampleCount; ++sampleIndex)
-		{
-		  r32 srcSampleL = 0, srcSampleR = 0;
-		  CONVERT_SAMPLE(srcDataL, srcSampleL, u8, channelCount);
-		  CONVERT_SAMPLE(srcDataR, srcSampleR, u8, channelCount);
-	      
-		  *destSamplesL++ = srcSampleL;
-		  *destSamplesR++ = srcSampleR;
-		}
-	    }
-	  else if(bytesPerSample == 2)
-	    {
-	      for(u32 sampleIndex = 0; sampleIndex < sourceSampleCount; ++sampleIndex)
-		{
-		  r32 srcSampleL = 0, srcSampleR = 0;
-		  CONVERT_SAMPLE(srcDataL, srcSampleL, s16, channelCount);
-		  CONVERT_SAMPLE(srcDataR, srcSampleR, s16, channelCount);
-	      
-		  *destSamplesL++ = srcSampleL;
-		  *destSamplesR++ = srcSampleR;
-		}
-	    }
-	  else if(bytesPerSample == 4)
-	    {
-	      for(u32 sampleIndex = 0; sampleIndex < sourceSampleCount; ++sampleIndex)
-		{
-		  r32 srcSampleL = 0, srcSampleR = 0;
-		  CONVERT_SAMPLE(srcDataL, srcSampleL, r32, channelCount);
-		  CONVERT_SAMPLE(srcDataR, srcSampleR, r32, channelCount);
-	      
-		  *destSamplesL++ = srcSampleL;
-		  *destSamplesR++ = srcSampleR;
-		}
-	    }
-	  else
-	    {
-	      ASSERT(!"ERROR: unsupported sample size");
-	    }
-	}
-      else
-	{
-	  ASSERT(!"ERROR: unsupported channel count");
-	}
-#undef CONVERT_SAMPLE
-  
-      // NOTE: convert sample rate
-      if(sampleRate != INTERNAL_SAMPLE_RATE)
-	{
-#if 1
-	  // NOTE: stupid linear interpolation until the fft method (or another better one) works
-	  //Arena tempAllocator = arenaSubArena(loadAllocator, 2*sourceSampleCount*sizeof(r32) + 1);
-	  r32 *tempL = arenaPushArray(scratch.arena, sourceSampleCount, r32);
-	  r32 *tempR = arenaPushArray(scratch.arena, sourceSampleCount, r32);
-	  for(u32 index = 0; index < sourceSampleCount; ++index)
-	    {
-	      tempL[index] = result.samples[0][index];
-	      tempR[index] = result.samples[1][index];
-	    }
-
-	  result.samples[1] = result.samples[0] + paddedDestSampleCount;
-	  r32 sampleRateRatio = 1.f/sampleRateConversionFactor;
-	  for(u32 destIndex = 0; destIndex < result.sampleCount; ++destIndex)
-	    {
-
-	      r32 sourceOffset = destIndex*sampleRateRatio;
-	      u32 sourceIndex = (u32)sourceOffset;
-	      r32 sourceFrac = sourceOffset - sourceIndex;
-
-	      ASSERT(sourceIndex < sourceSampleCount);
-	      r32 sourceSample0 =
-		lerp(tempL[sourceIndex], tempL[sourceIndex + 1], sourceFrac);
-	      r32 sourceSample1 =
-		lerp(tempR[sourceIndex], tempR[sourceIndex + 1], sourceFrac);
-	      
-	      result.samples[0][destIndex] = sourceSample0;
-	      result.samples[1][destIndex] = sourceSample1;
-	    }
-	  for(u32 padIndex = result.sampleCount; padIndex < paddedDestSampleCount; ++padIndex)
-	    {
-	      result.samples[0][padIndex] = 0.f;
-	      result.samples[1][padIndex] = 0.f;
-	    }
-
-	  //arenaEndArena(loadAllocator, tempAllocator);
-#else
-	  // TODO: make this work (problem is speed, numerical accuracy)
-	  usz tempBufferSize = 4*maxSampleCount*sizeof(c64);
-	  TemporaryMemory tempBufferAllocator = arenaBeginTemporaryMemory(loadAllocator, tempBufferSize);
-	  c64 *tempFFTBufferL = arenaPushArray((Arena *)&tempBufferAllocator, maxSampleCount, c64,
-					       arenaFlagsZeroNoAlign());
-	  c64 *tempFFTBufferR = arenaPushArray((Arena *)&tempBufferAllocator, maxSampleCount, c64,
-					       arenaFlagsZeroNoAlign());
-
-	  usz cztScratchSize = 16*maxSampleCount*sizeof(c64);
-	  TemporaryMemory cztScratch = arenaBeginTemporaryMemory(loadAllocator, cztScratchSize);
-	  
-	  czt(tempFFTBufferL, result.samples[0], sourceSampleCount, (Arena *)&cztScratch);
-	  arenaEnd((Arena *)&cztScratch);
-	  
-	  czt(tempFFTBufferR, result.samples[1], sourceSampleCount, (Arena *)&cztScratch);
-	  arenaEnd((Arena *)&cztScratch);
-      
-	  if(sampleRate < INTERNAL_SAMPLE_RATE)
-	    {
-	      // NOTE: upsample
-
-	      // NOTE: zero out unused frequencies
-	      for(u32 index = sourceSampleCount/2 + 1; index < destSampleCount; ++index)
-		{
-		  tempFFTBufferL[index] = C64(0, 0);
-		  tempFFTBufferR[index] = C64(0, 0);
-		}
-
-	      // NOTE: copy frequencies, preserving hermitian symmetry
-	      c64 *midpointL = tempFFTBufferL + sourceSampleCount/2;
-	      c64 *midpointR = tempFFTBufferR + sourceSampleCount/2;
-	      c64 *destL = tempFFTBufferL + destSampleCount - sourceSampleCount/2;
-	      c64 *destR = tempFFTBufferR + destSampleCount - sourceSampleCount/2;
-	      for(u32 index = 0; index < sourceSampleCount/2; ++index)
-		{
-		  c64 coeffL = *midpointL;
-		  c64 coeffR = *midpointR;
-		  if(index == 0)
-		    {		      
-		      coeffL *= 0.5f;
-		      coeffR *= 0.5f;		      
-		    }
-		  //coeffL *= sampleRateConversionFactor;
-		  //coeffR *= sampleRateConversionFactor;
-
-		  *destL++ = conjugateC64(coeffL);
-		  *destR++ = conjugateC64(coeffR);
-
-		  *midpointL-- = coeffL;
-		  *midpointR-- = coeffR;		  
-		}	      
-	    }
-	  else if(sampleRate > INTERNAL_SAMPLE_RATE)
-	    {
-	      // NOTE: downsample
-	      c64 *writeL = tempFFTBufferL + result.sampleCount/2;
-	      c64 *writeR = tempFFTBufferR + result.sampleCount/2;
-	      c64 *readL = tempFFTBufferL + sourceSampleCount - result.sampleCount/2;
-	      c64 *readR = tempFFTBufferR + sourceSampleCount - result.sampleCount/2;
-	      for(u32 index = 0; index < result.sampleCount/2; ++index)
-		{
-		  c64 coeffL = *readL++;
-		  c64 coeffR = *readR++;
-		  if(index == 0)
-		    {
-		      coeffL = {0, 0};
-		      coeffR = {0, 0};
-		    }
-
-		  *writeL++ = coeffL;
-		  *writeR++ = coeffR;
-		}
-	    }
-
-	  r32 *IFFTtempImL = arenaPushArray((Arena *)&tempBufferAllocator, maxSampleCount, r32,
-					    arenaFlagsZeroNoAlign());
-	  r32 *IFFTtempImR = arenaPushArray((Arena *)&tempBufferAllocator, maxSampleCount, r32,
-					    arenaFlagsZeroNoAlign());
-	  iczt(result.samples[0], IFFTtempImL, tempFFTBufferL, destSampleCount, (Arena *)&cztScratch);
-	  arenaEnd((Arena *)&cztScratch);
-	  iczt(result.samples[1], IFFTtempImR, tempFFTBufferR, destSampleCount, (Arena *)&cztScratch);
-	  arenaEnd((Arena *)&cztScratch);
-	  
-	  //arenaEndArena(loadAllocator, tempAllocator);
-	  arenaEndTemporaryMemory(&cztScratch);
-	  arenaEndTemporaryMemory(&tempBufferAllocator);
-#endif
-	} 
-      
-      //globalPlatform.freeFileMemory(readResult, loadAllocator);
-    }
-
-  arenaReleaseScratch(scratch);
-  return(result);
-}
-
 static inline LoadedBitmap
 loadBitmap(char *filename, Arena *allocator, v2 alignment = V2(0, 0))
 {
@@ -3,226 +3,1681 @@ beginGrainPackfile(Arena *allocator)
 {
   GrainPackfile result = {};
   result.allocator = allocator;
-  result.storage = arenaPushSize(allocator, 0);  
+  result.tagBatchCount = GRAIN_PACKFILE_TAG_BATCH_COUNT;
 
   return(result);
 }
 
+static GrainTagger
+resolveGrainTagger(GrainTagger tagger)
+{
+  GrainTagger result = tagger;
+  if(result == GrainTagger_auto)
+    {
+      GS_RunModel *runModel = gsRunModel;
+      result = runModel ? GrainTagger_model : GrainTagger_features;
+    }
+
+  return(result);
+}
+
+// NOTE: tags a [batch, channel, sample] batch with a resolved tagger. `features` must be set for
+//       the feature tagger. Returns false, leaving the tags undefined, if the model is missing or fails
+static b32
+runGrainTagger(GrainTagger tagger, GrainFeatureExtractor *features, r32 *batchSamples, r32 *batchTags, u32 count)
+{
+  b32 result = false;
+  if(tagger == GrainTagger_features)
+    {
+      result = grainFeaturesRunBatch(features, batchSamples, batchTags, count, FILE_GRAIN_LENGTH);
+    }
+  else
+    {
+      GS_RunModel *runModel = gsRunModel;
+      result = runModel && runModel(batchSamples, batchTags, count, FILE_GRAIN_LENGTH);
+    }
+
+  return(result);
+}
+
+// NOTE: gathers the chunk's grains into [batch, channel, sample] batches for the tagger, and
+//       scatters the tags back. Tags stay zeroed if the model is picked but missing
+static void
+tagGrainPackfileChunk(GrainPackfile *packfile, GrainPackfileChunk *chunk)
+{
+  GS_RunModel *runModel = gsRunModel;
+  GrainTagger tagger = resolveGrainTagger(packfile->tagger);
+  if(tagger == GrainTagger_model && !runModel) return;
+  if(tagger == GrainTagger_features && !packfile->features)
+    {
+      packfile->features = grainFeatureExtractorCreate(packfile->allocator);
+    }
+
+  u32 batchCount = MAX(packfile->tagBatchCount, 1);
+  TemporaryMemory scratch = arenaGetScratch(&packfile->allocator, 1);
+  r32 *batchSamples = arenaPushArray(scratch.arena, batchCount*FILE_GRAIN_CHANNEL_LENGTH, r32,
+				     arenaFlagsNoZeroAlign(GRAIN_PACKFILE_ALIGNMENT));
+  r32 *batchTags = arenaPushArray(scratch.arena, batchCount*FILE_TAG_LENGTH, r32,
+				  arenaFlagsNoZeroAlign(GRAIN_PACKFILE_ALIGNMENT));
+
+  for(usz batchStart = 0; batchStart < chunk->entryCount; batchStart += batchCount)
+    {
+      u32 count = (u32)MIN(batchCount, chunk->entryCount - batchStart);
+      GrainPackfileEntry *entries = chunk->entries + batchStart;
+      for(u32 i = 0; i < count; ++i)
+	{
+	  COPY_ARRAY(batchSamples + i*FILE_GRAIN_CHANNEL_LENGTH, entries[i].grainSamples,
+		     FILE_GRAIN_CHANNEL_LENGTH, r32);
+	}
+
+      if(!runGrainTagger(tagger, packfile->features, batchSamples, batchTags, count)) break;
+
+      for(u32 i = 0; i < count; ++i)
+	{
+	  COPY_ARRAY(entries[i].grainTagVector, batchTags + i*FILE_TAG_LENGTH, FILE_TAG_LENGTH, r32);
+	}
+    }
+
+  arenaReleaseScratch(scratch);
+}
+
 static void
 addSoundToGrainPackfile(GrainPackfile *packfile, LoadedSound *sound)
 {
   u32 soundGrainCount = sound->sampleCount/FILE_GRAIN_LENGTH;
   if(sound->sampleCount % FILE_GRAIN_LENGTH) ++soundGrainCount;
+  if(!soundGrainCount) return;
+
+  GrainPackfileChunk *chunk = arenaPushStruct(packfile->allocator, GrainPackfileChunk,
+					      arenaFlagsZeroNoAlign());
+  chunk->entryCount = soundGrainCount;
+  chunk->entries = arenaPushArray(packfile->allocator, soundGrainCount, GrainPackfileEntry,
+				  arenaFlagsZeroNoAlign());
+  if(packfile->lastChunk) packfile->lastChunk->next = chunk;
+  else			  packfile->firstChunk = chunk;
+  packfile->lastChunk = chunk;
 
-  // NOTE: assuming we can read an integer multiple of GRAIN_LENGTH samples from these;
+  // NOTE: the last grain is zero-padded if the sound isn't a whole number of grains long
   r32 *srcSamplesL = sound->samples[0];
-  r32 *srcSamplesR = sound->samples[1];
+  r32 *srcSamplesR = sound->samples[1] ? sound->samples[1] : sound->samples[0];
+  u32 samplesRemaining = sound->sampleCount;
   for(u32 grainIndex = 0; grainIndex < soundGrainCount; ++grainIndex)
     {
-      GrainPackfileEntry *entry = arenaPushStruct(packfile->allocator, GrainPackfileEntry);
-      COPY_ARRAY(entry->grainSamples[0], srcSamplesL, FILE_GRAIN_LENGTH, r32);
-      COPY_ARRAY(entry->grainSamples[1], srcSamplesR, FILE_GRAIN_LENGTH, r32);
+      GrainPackfileEntry *entry = chunk->entries + grainIndex;
+      u32 samplesToCopy = MIN(samplesRemaining, FILE_GRAIN_LENGTH);
+      COPY_ARRAY(entry->grainSamples[0], srcSamplesL, samplesToCopy, r32);
+      COPY_ARRAY(entry->grainSamples[1], srcSamplesR, samplesToCopy, r32);
 
-      // TODO: investigate batching inputs to the model
-      void *tagVector = globalPlatform.runModel(entry->grainSamples[0], FILE_GRAIN_LENGTH);
-      COPY_ARRAY(entry->grainTagVector, tagVector, FILE_TAG_LENGTH, r32);      
-      
-      srcSamplesL += FILE_GRAIN_LENGTH;
-      srcSamplesR += FILE_GRAIN_LENGTH;
+      srcSamplesL += samplesToCopy;
+      srcSamplesR += samplesToCopy;
+      samplesRemaining -= samplesToCopy;
       ++packfile->grainCount;
     }
+
+  tagGrainPackfileChunk(packfile, chunk);
+}
+
+// NOTE: FNV-1a, folded over 8-byte words rather than bytes, so that checking a large packfile is
+//       bound by memory bandwidth rather than by the multiply chain. Chains from `hash`, so pieces
+//       can be hashed as they're written, as long as every piece but the last is a whole number
+//       of words
+static u64
+grainPackfileChecksum(u64 hash, u8 *data, usz size)
+{
+  u64 result = hash;
+  u64 prime = 0x100000001B3ULL;
+
+  u64 *words = (u64 *)data;
+  usz wordCount = size/sizeof(u64);
+  for(usz i = 0; i < wordCount; ++i)
+    {
+      result = (result ^ words[i])*prime;
+    }
+  for(usz i = wordCount*sizeof(u64); i < size; ++i)
+    {
+      result = (result ^ data[i])*prime;
+    }
+
+  return(result);
+}
+
+static b32
+grainPackfileHostIsLittleEndian(void)
+{
+  u32 endianTag = GRAIN_PACKFILE_ENDIAN_TAG;
+  b32 result = (*(u8 *)&endianTag == 0x04);
+  return(result);
+}
+
+// NOTE: version 4 layout for `grainCount` grains: samples, then tags, then the append state.
+//       The samples always start at the same offset, so appending never moves them
+static GrainPackfileLayout
+grainPackfileLayout(GrainTagFormat tagFormat, GrainSampleFormat sampleFormat, u64 grainCount)
+{
+  GrainPackfileLayout result = {};
+  result.tagsType = GrainPackfileSection_tags;
+  result.tagSize = sizeof(GrainPackfileTag);
+  if(tagFormat == GrainTagFormat_s8)
+    {
+      result.tagsType = GrainPackfileSection_tagsS8;
+      result.tagSize = sizeof(GrainPackfileTagS8);
+    }
+  else if(tagFormat == GrainTagFormat_f16)
+    {
+      result.tagsType = GrainPackfileSection_tagsF16;
+      result.tagSize = sizeof(GrainPackfileTagF16);
+    }
+  b32 samplesAreS16 = (sampleFormat == GrainSampleFormat_s16);
+  result.samplesType = samplesAreS16 ? GrainPackfileSection_samplesS16 : GrainPackfileSection_samples;
+  result.grainSize = FILE_GRAIN_CHANNEL_LENGTH*(samplesAreS16 ? sizeof(s16) : sizeof(r32));
+
+  result.samplesOffset = ALIGN_POW_2(sizeof(GrainPackfileHeader) + 3*sizeof(GrainPackfileSection),
+				     GRAIN_PACKFILE_ALIGNMENT);
+  result.tagsOffset = ALIGN_POW_2(result.samplesOffset + grainCount*result.grainSize, GRAIN_PACKFILE_ALIGNMENT);
+  result.stateOffset = ALIGN_POW_2(result.tagsOffset + grainCount*result.tagSize, GRAIN_PACKFILE_ALIGNMENT);
+  result.fileSize = result.stateOffset + sizeof(GrainPackfileAppendState);
+
+  return(result);
+}
+
+// NOTE: fills in the header and the section table, which `dest` must have room for
+static void
+grainPackfileWriteHeader(u8 *dest, GrainPackfileLayout *layout, u64 grainCount, u64 checksum)
+{
+  ZERO_SIZE(dest, layout->samplesOffset);
+
+  GrainPackfileHeader *header = (GrainPackfileHeader *)dest;
+  header->magic = GRAIN_PACKFILE_MAGIC;
+  header->version = GRAIN_PACKFILE_VERSION;
+  header->endianTag = GRAIN_PACKFILE_ENDIAN_TAG;
+  header->headerSize = sizeof(GrainPackfileHeader);
+  header->fileSize = layout->fileSize;
+  header->checksum = checksum;
+  header->grainCount = grainCount;
+  header->grainLength = FILE_GRAIN_LENGTH;
+  header->channelCount = FILE_GRAIN_CHANNELS;
+  header->tagLength = FILE_TAG_LENGTH;
+  header->sampleRate = INTERNAL_SAMPLE_RATE;
+  header->sectionCount = 3;
+
+  GrainPackfileSection *sections = (GrainPackfileSection *)(header + 1);
+  sections[0].type = layout->samplesType;
+  sections[0].offset = layout->samplesOffset;
+  sections[0].size = grainCount*layout->grainSize;
+  sections[1].type = layout->tagsType;
+  sections[1].offset = layout->tagsOffset;
+  sections[1].size = grainCount*layout->tagSize;
+  sections[2].type = GrainPackfileSection_appendState;
+  sections[2].offset = layout->stateOffset;
+  sections[2].size = sizeof(GrainPackfileAppendState);
+}
+
+static void
+grainPackfileEncodeTag(GrainTagFormat tagFormat, u8 *dest, u64 grainIndex, r32 *vector)
+{
+  switch(tagFormat)
+    {
+    case GrainTagFormat_s8:
+      {
+	GrainPackfileTagS8 *tag = (GrainPackfileTagS8 *)dest;
+	tag->startSampleIndex = grainIndex;
+	tag->scale = grainTagQuantizeS8(vector, tag->vector, FILE_TAG_LENGTH);
+	tag->reserved = 0;
+      } break;
+    case GrainTagFormat_f16:
+      {
+	GrainPackfileTagF16 *tag = (GrainPackfileTagF16 *)dest;
+	tag->startSampleIndex = grainIndex;
+	grainTagQuantizeF16(vector, tag->vector, FILE_TAG_LENGTH);
+      } break;
+    default:
+      {
+	GrainPackfileTag *tag = (GrainPackfileTag *)dest;
+	tag->startSampleIndex = grainIndex;
+	COPY_ARRAY(tag->vector, vector, FILE_TAG_LENGTH, r32);
+      } break;
+    }
+}
+
+static void
+grainPackfileEncodeSamples(GrainSampleFormat sampleFormat, u8 *dest, r32 *src, usz count)
+{
+  if(sampleFormat == GrainSampleFormat_s16)
+    {
+      s16 *destSamples = (s16 *)dest;
+      for(usz i = 0; i < count; ++i)
+	{
+	  destSamples[i] = grainSampleEncodeS16(src[i]);
+	}
+    }
+  else
+    {
+      COPY_ARRAY(dest, src, count, r32);
+    }
 }
 
 static void
 writePackfileToDisk(GrainPackfile *packfile, char *filename)
-{ 
-  usz arenaStartUsed = packfile->allocator->used;
-  GrainPackfileHeader *header = arenaPushStruct(packfile->allocator, GrainPackfileHeader);
-  GrainPackfileTag *tags = arenaPushArray(packfile->allocator, packfile->grainCount, GrainPackfileTag);
-  GrainPackfileGrain *grains = arenaPushArray(packfile->allocator, packfile->grainCount, GrainPackfileGrain);
-  usz packfileSize = packfile->allocator->used - arenaStartUsed;
-  
-  header->fileSize = packfileSize;
-  header->grainCount = packfile->grainCount;
-  header->grainLength = FILE_GRAIN_LENGTH; 
-  header->tagOffset = (u8 *)tags - (u8 *)header;
-  header->grainOffset = (u8 *)grains - (u8 *)header;
-
-  GrainPackfileEntry *entries = (GrainPackfileEntry *)packfile->storage;
-  for(usz grainIndex = 0; grainIndex < header->grainCount; ++grainIndex)
-    {
-      GrainPackfileEntry *entry = entries + grainIndex;
-      GrainPackfileTag *tag = tags + grainIndex;
-      GrainPackfileGrain *grain = grains + grainIndex;
-      
-      tag->startSampleIndex = grainIndex;//grain - grains;
-      COPY_ARRAY(tag->vector, entry->grainTagVector, FILE_TAG_LENGTH, r32);
-      COPY_ARRAY(grain->samples, entry->grainSamples, FILE_GRAIN_CHANNEL_LENGTH, r32);
-    }
-   
-  globalPlatform.writeEntireFile(filename, header, packfileSize);
+{
+  if(!grainPackfileHostIsLittleEndian())
+    {
+      logString("ERROR: grain packfiles can only be written on little-endian machines\n");
+      return;
+    }
+
+  u64 grainCount = packfile->grainCount;
+  GrainPackfileLayout layout = grainPackfileLayout(packfile->tagFormat, packfile->sampleFormat, grainCount);
+
+  TemporaryMemory scratch = arenaGetScratch(&packfile->allocator, 1);
+  u8 *fileMemory = arenaPushArray(scratch.arena, layout.fileSize, u8,
+				  arenaFlagsZeroAlign(GRAIN_PACKFILE_ALIGNMENT));
+
+  u8 *samples = fileMemory + layout.samplesOffset;
+  u8 *tags = fileMemory + layout.tagsOffset;
+  usz grainIndex = 0;
+  for(GrainPackfileChunk *chunk = packfile->firstChunk; chunk; chunk = chunk->next)
+    {
+      for(usz entryIndex = 0; entryIndex < chunk->entryCount; ++entryIndex, ++grainIndex)
+	{
+	  GrainPackfileEntry *entry = chunk->entries + entryIndex;
+	  grainPackfileEncodeTag(packfile->tagFormat, tags + grainIndex*layout.tagSize, grainIndex,
+				 entry->grainTagVector);
+	  grainPackfileEncodeSamples(packfile->sampleFormat, samples + grainIndex*layout.grainSize,
+				     &entry->grainSamples[0][0], FILE_GRAIN_CHANNEL_LENGTH);
+	}
+    }
+  ASSERT(grainIndex == grainCount);
+
+  GrainPackfileAppendState *state = (GrainPackfileAppendState *)(fileMemory + layout.stateOffset);
+  state->samplesChecksum = grainPackfileChecksum(GRAIN_PACKFILE_CHECKSUM_SEED, samples,
+						 grainCount*layout.grainSize);
+  u64 checksum = grainPackfileChecksum(state->samplesChecksum, tags, grainCount*layout.tagSize);
+  checksum = grainPackfileChecksum(checksum, (u8 *)state, sizeof(GrainPackfileAppendState));
+  grainPackfileWriteHeader(fileMemory, &layout, grainCount, checksum);
+
+  gsWriteEntireFile(filename, bufferMake(fileMemory, layout.fileSize));
+  arenaReleaseScratch(scratch);
+}
+
+// NOTE: checks everything loading a packfile relies on, without touching the section data. On
+//       success, fills in `result`'s layout fields
+static b32
+validateGrainPackfile(Buffer file, LoadedGrainPackfile *result)
+{
+  b32 valid = false;
+  char *error = 0;
+
+  GrainPackfileHeader *header = (GrainPackfileHeader *)file.contents;
+  if(file.size < sizeof(GrainPackfileHeader))		     error = "file too small for a header";
+  else if(header->magic != GRAIN_PACKFILE_MAGIC)	     error = "not a grain packfile";
+  else if(header->endianTag != GRAIN_PACKFILE_ENDIAN_TAG)    error = "wrong endianness";
+  else if(header->version < GRAIN_PACKFILE_MIN_VERSION ||
+	  header->version > GRAIN_PACKFILE_VERSION)	     error = "unsupported version";
+  else if(header->headerSize != sizeof(GrainPackfileHeader)) error = "bad header size";
+  else if(header->fileSize != file.size)		     error = "file size mismatch (truncated?)";
+  else if(header->channelCount != FILE_GRAIN_CHANNELS ||
+	  header->tagLength != FILE_TAG_LENGTH)		     error = "unsupported grain or tag format";
+  else if(header->grainLength == 0 ||
+	  header->grainLength > FILE_GRAIN_LENGTH ||
+	  header->sampleRate != INTERNAL_SAMPLE_RATE)	     error = "unsupported grain length or sample rate";
+  else if(header->sectionCount > GRAIN_PACKFILE_MAX_SECTIONS ||
+	  (sizeof(GrainPackfileHeader) +
+	   header->sectionCount*sizeof(GrainPackfileSection)) > file.size) error = "bad section table";
+  else
+    {
+      u64 grainSampleCount = header->grainLength*header->channelCount;
+      if(header->grainCount > file.size/sizeof(GrainPackfileTagS8) ||
+	 header->grainLength > file.size)
+	{
+	  error = "bad grain count";
+	}
+
+      GrainPackfileSection *sections = (GrainPackfileSection *)(header + 1);
+      GrainPackfileSection *tagsSection = 0;
+      GrainPackfileSection *samplesSection = 0;
+      for(u32 sectionIndex = 0; !error && sectionIndex < header->sectionCount; ++sectionIndex)
+	{
+	  GrainPackfileSection *section = sections + sectionIndex;
+	  if((section->offset % GRAIN_PACKFILE_ALIGNMENT) != 0)	error = "misaligned section";
+	  else if(section->offset > file.size ||
+		  section->size > file.size - section->offset)	error = "section out of bounds";
+	  else if(section->type == GrainPackfileSection_tags ||
+		  section->type == GrainPackfileSection_tagsS8 ||
+		  section->type == GrainPackfileSection_tagsF16)
+	    {
+	      if(tagsSection) error = "more than one tags section";
+	      tagsSection = section;
+	    }
+	  else if(section->type == GrainPackfileSection_samples ||
+		  section->type == GrainPackfileSection_samplesS16)
+	    {
+	      if(samplesSection) error = "more than one samples section";
+	      samplesSection = section;
+	    }
+	}
+
+      if(!error)
+	{
+	  if(!tagsSection || !samplesSection) error = "missing section";
+	}
+      if(!error)
+	{
+	  u64 tagSize = sizeof(GrainPackfileTag);
+	  if(tagsSection->type == GrainPackfileSection_tagsS8)	     tagSize = sizeof(GrainPackfileTagS8);
+	  else if(tagsSection->type == GrainPackfileSection_tagsF16) tagSize = sizeof(GrainPackfileTagF16);
+	  u64 sampleSize = (samplesSection->type == GrainPackfileSection_samplesS16) ? sizeof(s16) : sizeof(r32);
+
+	  if(tagsSection->size != header->grainCount*tagSize ||
+	     samplesSection->size != header->grainCount*grainSampleCount*sampleSize)
+	    {
+	      error = "section size mismatch";
+	    }
+	  else
+	    {
+	      u8 *tags = file.contents + tagsSection->offset;
+	      u8 *samples = file.contents + samplesSection->offset;
+	      result->grainCount = header->grainCount;
+	      result->grainLength = header->grainLength;
+	      switch(tagsSection->type)
+		{
+		case GrainPackfileSection_tagsS8:
+		  {
+		    result->tagFormat = GrainTagFormat_s8;
+		    result->tagsS8 = (GrainPackfileTagS8 *)tags;
+		  } break;
+		case GrainPackfileSection_tagsF16:
+		  {
+		    result->tagFormat = GrainTagFormat_f16;
+		    result->tagsF16 = (GrainPackfileTagF16 *)tags;
+		  } break;
+		default:
+		  {
+		    result->tagFormat = GrainTagFormat_r32;
+		    result->tags = (GrainPackfileTag *)tags;
+		  } break;
+		}
+	      if(samplesSection->type == GrainPackfileSection_samplesS16)
+		{
+		  result->sampleFormat = GrainSampleFormat_s16;
+		  result->samplesS16 = (s16 *)samples;
+		}
+	      else
+		{
+		  result->sampleFormat = GrainSampleFormat_r32;
+		  result->samples = (r32 *)samples;
+		}
+	      valid = true;
+	    }
+	}
+    }
+
+  if(!valid)
+    {
+      logFormatString("ERROR: invalid grain packfile: %s\n", error);
+    }
+
+  return(valid);
 }
 
+// NOTE: maps the packfile, so loading costs the same whatever its size, and grains are paged in
+//       as they're played. Hosts that can't map files read the whole packfile into `allocator`
+//       instead. Returns a packfile with no grains if the file is missing or invalid
 static LoadedGrainPackfile
 loadGrainPackfile(char *filename, Arena *allocator)
 {
-  LoadedGrainPackfile result = {};  
-  
-  ReadFileResult readResult = globalPlatform.readEntireFile(filename, allocator);
-  if(readResult.contents)
+  LoadedGrainPackfile result = {};
+
+  Buffer file = gsMapFile(filename);
+  b32 isMapped = (file.contents != 0);
+  if(!isMapped)
+    {
+      file = gsReadEntireFile(filename, allocator);
+    }
+
+  if(file.contents)
+    {
+      if(validateGrainPackfile(file, &result))
+	{
+	  result.file = file;
+	  result.isMapped = isMapped;
+	}
+      else
+	{
+	  if(isMapped) gsUnmapFile(file);
+	  else	       gsFreeFileMemory(file, allocator);
+	  ZERO_STRUCT(&result);
+	}
+    }
+
+  return(result);
+}
+
+// NOTE: arena-read packfiles are freed with their arena
+static void
+unloadGrainPackfile(LoadedGrainPackfile *packfile)
+{
+  if(packfile->isMapped)
+    {
+      gsUnmapFile(packfile->file);
+    }
+
+  ZERO_STRUCT(packfile);
+}
+
+// NOTE: checks a loaded packfile's checksum. This reads the whole file, so it's meant for tools
+//       and tests, not for the load path
+static b32
+verifyGrainPackfile(LoadedGrainPackfile *packfile)
+{
+  b32 result = false;
+  if(packfile->file.contents)
     {
-      GrainPackfileHeader *header = (GrainPackfileHeader *)readResult.contents;      
-      result.packfileMemory = readResult.contents;
-      result.grainCount = header->grainCount;
-      result.grainLength = header->grainLength;
-      result.tags = (GrainPackfileTag *)((u8 *)result.packfileMemory + header->tagOffset);
-      result.samples = (r32 *)((u8 *)result.packfileMemory + header->grainOffset);
+      GrainPackfileHeader *header = (GrainPackfileHeader *)packfile->file.contents;
+      u64 checksum = GRAIN_PACKFILE_CHECKSUM_SEED;
+      if(header->version >= 4)
+	{
+	  GrainPackfileSection *sections = (GrainPackfileSection *)(header + 1);
+	  for(u32 sectionIndex = 0; sectionIndex < header->sectionCount; ++sectionIndex)
+	    {
+	      GrainPackfileSection *section = sections + sectionIndex;
+	      checksum = grainPackfileChecksum(checksum, packfile->file.contents + section->offset, section->size);
+	    }
+	}
+      else
+	{
+	  checksum = grainPackfileChecksum(checksum, packfile->file.contents + sizeof(GrainPackfileHeader),
+					   packfile->file.size - sizeof(GrainPackfileHeader));
+	}
+      result = (checksum == header->checksum);
     }
 
   return(result);
 }
 
-static FileGrainState
-initializeFileGrainState(Arena *allocator)
+//
+// packfile appending
+//
+
+// NOTE: writes the tag index and append state after the samples, then the header. Everything the
+//       header points at is on disk before the header is
+static b32
+grainPackfileAppenderCommit_(GrainPackfileAppender *appender)
 {
-  FileGrainState result = {};
-  result.allocator = allocator;
-  result.playlistSentinel = arenaPushStruct(result.allocator, PlayingGrain);
-  result.playlistSentinel->nextPlaying = result.playlistSentinel;
-  result.playlistSentinel->prevPlaying = result.playlistSentinel;
+  GrainPackfileLayout layout = grainPackfileLayout(appender->tagFormat, appender->sampleFormat,
+						   appender->grainCount);
+  usz tagsSize = appender->grainCount*layout.tagSize;
+
+  GrainPackfileAppendState state = {};
+  state.samplesChecksum = appender->samplesChecksum;
+  u64 checksum = grainPackfileChecksum(state.samplesChecksum, appender->tags, tagsSize);
+  checksum = grainPackfileChecksum(checksum, (u8 *)&state, sizeof(state));
+
+  u8 headerMemory[ALIGN_POW_2(sizeof(GrainPackfileHeader) + 3*sizeof(GrainPackfileSection),
+			      GRAIN_PACKFILE_ALIGNMENT)];
+  STATIC_ASSERT(sizeof(headerMemory) == 192, grainPackfileAppendHeaderSizeCheck);
+  grainPackfileWriteHeader(headerMemory, &layout, appender->grainCount, checksum);
+
+  b32 result = (gsWriteFileAt(appender->file, layout.tagsOffset, bufferMake(appender->tags, tagsSize)) &&
+		gsWriteFileAt(appender->file, layout.stateOffset, bufferMake((u8 *)&state, sizeof(state))) &&
+		gsWriteFileAt(appender->file, 0, bufferMake(headerMemory, layout.samplesOffset)));
+  if(result)
+    {
+      gsAtomicStore(&appender->committedGrainCount, (u32)appender->grainCount);
+    }
 
   return(result);
 }
 
 static void
-queueAllGrainsFromFile(FileGrainState *grainState, LoadedGrainPackfile *source)
+grainPackfileAppenderReserveTags_(GrainPackfileAppender *appender, usz tagCount, usz tagSize)
 {
-  // TODO: Right now, we queue all the grains from the supplied packfile to be played in sequential order,
-  //       ie a grain is popped off the queue and put on the playlist as soon as the last grain on the playlist
-  //       finishes, so that one and only one grain is playing at a time. The tags are not used at all.
-  //       We should add the ability to queue grains according to tags, and control when grains should start playing
-  ASSERT(grainState->queuedGrainCount == 0); 
-  grainState->samplesElapsedSinceLastQueue = 0;
-  u64 grainLength = source->grainLength; 
-  //r64 internalSamplePeriod = 1.0/(r64)INTERNAL_SAMPLE_RATE;
-  //r64 grainLengthInSeconds = internalSamplePeriod*(r64)grainLength;
-  
-  GrainPackfileTag *srcTags = source->tags;  
-  r32 *srcSamples = source->samples;  
-  for(u64 grainIndex = 0; grainIndex < source->grainCount; ++grainIndex)
-    {
-      PlayingGrain *newGrain = 0;
-      if(grainState->freeList)
-	{
-	  newGrain = grainState->freeList;
-	  grainState->freeList = newGrain->nextFree;
-	  newGrain->nextFree = 0;
-	  newGrain->onFreeList = false;
+  if(tagCount <= appender->tagCapacity) return;
+
+  usz newCapacity = MAX(2*appender->tagCapacity, tagCount);
+  Arena *newArena = gsArenaAcquire(newCapacity*tagSize + ARENA_HEADER_SIZE + GRAIN_PACKFILE_ALIGNMENT);
+  u8 *newTags = arenaPushArray(newArena, newCapacity*tagSize, u8, arenaFlagsNoZeroAlign(GRAIN_PACKFILE_ALIGNMENT));
+  if(appender->tagArena)
+    {
+      COPY_SIZE(newTags, appender->tags, appender->grainCount*tagSize);
+      gsArenaDiscard(appender->tagArena);
+    }
+  appender->tagArena = newArena;
+  appender->tags = newTags;
+  appender->tagCapacity = newCapacity;
+}
+
+// NOTE: grain by grain, a batch at a time: cut, tag, encode, write. Tags are zeroed if the model
+//       fails
+static b32
+grainPackfileAppenderWriteSound_(GrainPackfileAppender *appender, LoadedSound *sound)
+{
+  b32 result = true;
+  GrainPackfileLayout layout = grainPackfileLayout(appender->tagFormat, appender->sampleFormat, 0);
+
+  u32 soundGrainCount = sound->sampleCount/FILE_GRAIN_LENGTH;
+  if(sound->sampleCount % FILE_GRAIN_LENGTH) ++soundGrainCount;
+
+  // NOTE: the last grain is zero-padded if the sound isn't a whole number of grains long
+  r32 *srcSamplesL = sound->samples[0];
+  r32 *srcSamplesR = sound->samples[1] ? sound->samples[1] : sound->samples[0];
+  u32 samplesRemaining = sound->sampleCount;
+  for(u32 batchStart = 0; result && batchStart < soundGrainCount; batchStart += appender->tagBatchCount)
+    {
+      u32 count = MIN(appender->tagBatchCount, soundGrainCount - batchStart);
+      ZERO_ARRAY(appender->batchSamples, count*FILE_GRAIN_CHANNEL_LENGTH, r32);
+      for(u32 i = 0; i < count; ++i)
+	{
+	  r32 *grainSamples = appender->batchSamples + i*FILE_GRAIN_CHANNEL_LENGTH;
+	  u32 samplesToCopy = MIN(samplesRemaining, FILE_GRAIN_LENGTH);
+	  COPY_ARRAY(grainSamples, srcSamplesL, samplesToCopy, r32);
+	  COPY_ARRAY(grainSamples + FILE_GRAIN_LENGTH, srcSamplesR, samplesToCopy, r32);
+
+	  srcSamplesL += samplesToCopy;
+	  srcSamplesR += samplesToCopy;
+	  samplesRemaining -= samplesToCopy;
 	}
-      else
+
+      if(!runGrainTagger(appender->tagger, appender->features, appender->batchSamples, appender->batchTags, count))
 	{
-	  newGrain = arenaPushStruct(grainState->allocator, PlayingGrain);
+	  ZERO_ARRAY(appender->batchTags, count*FILE_TAG_LENGTH, r32);
 	}
 
-      newGrain->startSampleIndex = grainLength*grainIndex;//(r64)(grainLength*grainIndex)*internalSamplePeriod + callerTimestamp;            
-      newGrain->samplesRemaining = grainLength;
-      newGrain->samples[0] = srcSamples;
-      newGrain->samples[1] = srcSamples + grainLength;
+      u64 grainCount = appender->grainCount + count;
+      grainPackfileAppenderReserveTags_(appender, grainCount, layout.tagSize);
 
-      // NOTE: put new grain at the head of the queue
-      newGrain->nextQueued = grainState->grainQueue;
-      grainState->grainQueue = newGrain;
-      ++grainState->queuedGrainCount;
+      for(u32 i = 0; i < count; ++i)
+	{
+	  u64 grainIndex = appender->grainCount + i;
+	  grainPackfileEncodeTag(appender->tagFormat, appender->tags + grainIndex*layout.tagSize, grainIndex,
+				 appender->batchTags + i*FILE_TAG_LENGTH);
+	  grainPackfileEncodeSamples(appender->sampleFormat, appender->batchEncoded + i*layout.grainSize,
+				     appender->batchSamples + i*FILE_GRAIN_CHANNEL_LENGTH, FILE_GRAIN_CHANNEL_LENGTH);
+	}
 
-      ++srcTags; // TODO: how should we use the tags?
-      srcSamples += 2*grainLength;
+      Buffer encoded = bufferMake(appender->batchEncoded, count*layout.grainSize);
+      result = gsWriteFileAt(appender->file, layout.samplesOffset + appender->grainCount*layout.grainSize, encoded);
+      appender->samplesChecksum = grainPackfileChecksum(appender->samplesChecksum, encoded.contents, encoded.size);
+      appender->grainCount = grainCount;
     }
-  (void)srcTags;
 
-  // NOTE: we reverse the queue, so that the grain with the earliest startSampleIndex is at the head of the queue,
-  //       rather than at the end
-  grainState->grainQueue = reverseGrainQueueOrder(grainState->grainQueue);
-  debugPrintQueuedGrainTimestamps(grainState->grainQueue);
+  return(result);
 }
 
+// NOTE: the writer thread. Commits after every sound, so the packfile on disk is only ever behind
+//       by the sound being written
 static void
-mixPlayingGrains(r32 *destBufferLInit, r32 *destBufferRInit,
-		 r32 volumeInit, u32 samplesToWrite,		
-		 FileGrainState *grainState)
+grainPackfileAppenderThreadProc(void *data)
 {
-  r32 volume = volumeInit;
+  GrainPackfileAppender *appender = (GrainPackfileAppender *)data;
+
+  for(;;)
+    {
+      u32 readIndex = appender->soundReadIndex;
+      u32 writeIndex = gsAtomicLoad(&appender->soundWriteIndex);
+      if(readIndex == writeIndex)
+	{
+	  if(gsAtomicLoad(&appender->cancel)) break;
+	  gsSleep(1);
+	  continue;
+	}
 
-  r32 *destBufferL = destBufferLInit;
-  r32 *destBufferR = destBufferRInit;
-  PlayingGrain *nextGrainInQueue = grainState->grainQueue; 
-  for(u32 sampleIndex = 0; sampleIndex < samplesToWrite; ++sampleIndex, ++grainState->samplesElapsedSinceLastQueue)
-    {      
-      if(nextGrainInQueue)
+      LoadedSound *sound = appender->sounds[readIndex & appender->soundMask];
+      if(!gsAtomicLoad(&appender->failed))
 	{
-	  //r64 currentTimestamp = sampleIndex*internalSamplePeriod + callerTimestamp;
-	  //if(nextGrainInQueue->startTimestamp <= currentTimestamp)
-	  if(grainState->samplesElapsedSinceLastQueue >= nextGrainInQueue->startSampleIndex)
+	  if(!grainPackfileAppenderWriteSound_(appender, sound) || !grainPackfileAppenderCommit_(appender))
 	    {
-	      // NOTE: dequeue the next grain and put it on the playlist	      
-	      PlayingGrain *playlistSentinel = grainState->playlistSentinel;
-	      nextGrainInQueue->nextPlaying = playlistSentinel;
-	      nextGrainInQueue->prevPlaying = playlistSentinel->prevPlaying;
-	      nextGrainInQueue->nextPlaying->prevPlaying = nextGrainInQueue;
-	      nextGrainInQueue->prevPlaying->nextPlaying = nextGrainInQueue;
-	      
-	      nextGrainInQueue = nextGrainInQueue->nextQueued;
-	      grainState->grainQueue = nextGrainInQueue;
-
-	      --grainState->queuedGrainCount;
-	      ++grainState->playingGrainCount;
+	      gsAtomicStore(&appender->failed, 1);
 	    }
 	}
-      
-      // NOTE: loop over playing grains and mix their samples
-      //for(PlayingGrain *grain = grainState->playlistSentinel;
-      //	  grain && grain->nextPlaying != grainState->playlistSentinel;
-      //	  grain = grain->nextPlaying)
-      for(PlayingGrain *grain = grainState->playlistSentinel->nextPlaying;
-	  grain != grainState->playlistSentinel;
-	  grain = grain->nextPlaying)
-	{
-	  ASSERT(!grain->onFreeList);
- 	  if(grain->samplesRemaining)	 
-	    {
-	      r32 sampleToWriteL = *grain->samples[0]++;
-	      r32 sampleToWriteR = *grain->samples[1]++;	     
+      gsAtomicStore(&appender->soundReadIndex, readIndex + 1);
+    }
 
-	      --grain->samplesRemaining;
-	      *destBufferL += volume*sampleToWriteL;
-	      *destBufferR += volume*sampleToWriteR;
-	    }
-	  else
+  gsAtomicStore(&appender->finished, 1);
+}
+
+// NOTE: opens a version 4 packfile for appending, or creates an empty one if there's no file yet.
+//       The formats only apply to new packfiles; an existing packfile keeps its own. Older
+//       versions have the tags before the samples, so they can't be appended to; rewrite them
+//       with `writePackfileToDisk` first. Returns null if the packfile can't be opened, or the
+//       host can't start the writer thread. `allocator` must outlive the appender. The tagger
+//       should be the one the packfile was built with
+static GrainPackfileAppender *
+openGrainPackfileAppender(char *filename, Arena *allocator,
+			  GrainTagFormat tagFormat, GrainSampleFormat sampleFormat, GrainTagger tagger)
+{
+  if(!grainPackfileHostIsLittleEndian())
+    {
+      logString("ERROR: grain packfiles can only be written on little-endian machines\n");
+      return(0);
+    }
+
+  GrainPackfileAppender *result = 0;
+  u64 grainCount = 0;
+  u64 samplesChecksum = GRAIN_PACKFILE_CHECKSUM_SEED;
+  u8 *existingTags = 0;
+  usz existingTagsSize = 0;
+
+  // NOTE: the existing index is read into memory, since the first append writes samples over it
+  b32 canAppend = true;
+  Buffer existing = gsMapFile(filename);
+  if(existing.contents)
+    {
+      LoadedGrainPackfile packfile = {};
+      canAppend = validateGrainPackfile(existing, &packfile);
+      if(canAppend)
+	{
+	  GrainPackfileHeader *header = (GrainPackfileHeader *)existing.contents;
+	  GrainPackfileSection *sections = (GrainPackfileSection *)(header + 1);
+	  GrainPackfileLayout layout = grainPackfileLayout(packfile.tagFormat, packfile.sampleFormat,
+							   packfile.grainCount);
+	  canAppend = (header->version >= GRAIN_PACKFILE_APPEND_VERSION &&
+		       header->grainLength == FILE_GRAIN_LENGTH &&
+		       header->sectionCount == 3 &&
+		       sections[0].offset == layout.samplesOffset &&
+		       sections[1].offset == layout.tagsOffset &&
+		       sections[2].type == GrainPackfileSection_appendState &&
+		       sections[2].offset == layout.stateOffset);
+	  if(canAppend)
 	    {
-	      // NOTE: remove from playing chain
-	      grain->prevPlaying->nextPlaying = grain->nextPlaying;
-	      grain->nextPlaying->prevPlaying = grain->prevPlaying;
-	      //grain->nextPlaying = 0;
-	      //grain->prevPlaying = 0;
-	      
-	      // NOTE: append to free list
-	      grain->onFreeList = true;
-	      grain->nextFree = grainState->freeList;
-	      grainState->freeList = grain;
+	      GrainPackfileAppendState *state = (GrainPackfileAppendState *)(existing.contents + layout.stateOffset);
+	      tagFormat = packfile.tagFormat;
+	      sampleFormat = packfile.sampleFormat;
+	      grainCount = packfile.grainCount;
+	      samplesChecksum = state->samplesChecksum;
+	      existingTagsSize = sections[1].size;
+	      existingTags = existing.contents + sections[1].offset;
+	    }
+	}
+      if(!canAppend)
+	{
+	  logFormatString("ERROR: can't append to grain packfile %s: not a version %u packfile\n",
+			  filename, GRAIN_PACKFILE_APPEND_VERSION);
+	}
+    }
+
+  GS_File file = canAppend ? gsOpenFileForWriting(filename, false) : 0;
+  if(file)
+    {
+      GrainPackfileLayout layout = grainPackfileLayout(tagFormat, sampleFormat, 0);
+
+      result = arenaPushStruct(allocator, GrainPackfileAppender, arenaFlagsZeroNoAlign());
+      result->file = file;
+      result->tagFormat = tagFormat;
+      result->sampleFormat = sampleFormat;
+      result->tagBatchCount = GRAIN_PACKFILE_TAG_BATCH_COUNT;
+      result->tagger = resolveGrainTagger(tagger);
+      if(result->tagger == GrainTagger_features)
+	{
+	  result->features = grainFeatureExtractorCreate(allocator);
+	}
+      result->grainCount = grainCount;
+      result->samplesChecksum = samplesChecksum;
+      result->committedGrainCount = (u32)grainCount;
+
+      result->soundMask = GRAIN_PACKFILE_APPEND_QUEUE_COUNT - 1;
+      result->sounds = arenaPushArray(allocator, GRAIN_PACKFILE_APPEND_QUEUE_COUNT, LoadedSound *,
+				      arenaFlagsZeroNoAlign());
+
+      ArenaPushFlags flags = arenaFlagsNoZeroAlign(GRAIN_PACKFILE_ALIGNMENT);
+      result->batchSamples = arenaPushArray(allocator, result->tagBatchCount*FILE_GRAIN_CHANNEL_LENGTH, r32, flags);
+      result->batchTags = arenaPushArray(allocator, result->tagBatchCount*FILE_TAG_LENGTH, r32, flags);
+      result->batchEncoded = arenaPushArray(allocator, result->tagBatchCount*layout.grainSize, u8, flags);
+
+      if(grainCount)
+	{
+	  grainPackfileAppenderReserveTags_(result, grainCount, layout.tagSize);
+	  COPY_SIZE(result->tags, existingTags, existingTagsSize);
+	}
+      else
+	{
+	  // NOTE: a new packfile is committed straight away, so it's valid (and empty) on disk
+	  result->failed = !grainPackfileAppenderCommit_(result);
+	}
+
+      if(!gsStartThread(grainPackfileAppenderThreadProc, result))
+	{
+	  logFormatString("ERROR: could not start the grain packfile writer thread\n");
+	  if(result->tagArena) gsArenaDiscard(result->tagArena);
+	  gsCloseFile(file);
+	  result = 0;
+	}
+    }
 
-	      --grainState->playingGrainCount;
-	    }	  
+  if(existing.contents)
+    {
+      gsUnmapFile(existing);
+    }
+
+  return(result);
+}
+
+// NOTE: queues a sound to be appended. Returns false if the queue is full. The sound's samples
+//       must stay valid until `grainPackfileAppenderIsIdle`, or until `soundReadIndex` passes it
+static b32
+appendSoundToGrainPackfile(GrainPackfileAppender *appender, LoadedSound *sound)
+{
+  u32 writeIndex = appender->soundWriteIndex;
+  b32 result = ((writeIndex - gsAtomicLoad(&appender->soundReadIndex)) < GRAIN_PACKFILE_APPEND_QUEUE_COUNT);
+  if(result && sound->sampleCount)
+    {
+      appender->sounds[writeIndex & appender->soundMask] = sound;
+      gsAtomicStore(&appender->soundWriteIndex, writeIndex + 1);
+    }
+
+  return(result);
+}
+
+static b32
+grainPackfileAppenderIsIdle(GrainPackfileAppender *appender)
+{
+  b32 result = (gsAtomicLoad(&appender->soundReadIndex) == appender->soundWriteIndex);
+  return(result);
+}
+
+// NOTE: finishes every queued sound, then stops the writer thread and closes the file. Returns
+//       false if any write failed
+static b32
+closeGrainPackfileAppender(GrainPackfileAppender *appender)
+{
+  gsAtomicStore(&appender->cancel, 1);
+  while(!gsAtomicLoad(&appender->finished))
+    {
+      gsSleep(1);
+    }
+
+  if(appender->tagArena) gsArenaDiscard(appender->tagArena);
+  gsCloseFile(appender->file);
+
+  b32 result = !appender->failed;
+  return(result);
+}
+
+//
+// live input tagging
+//
+
+static void
+liveTaggerThreadProc(void *data)
+{
+  LiveTagger *tagger = (LiveTagger *)data;
+
+  while(!gsAtomicLoad(&tagger->cancel))
+    {
+      u32 readIndex = tagger->segmentReadIndex;
+      u32 writeIndex = gsAtomicLoad(&tagger->segmentWriteIndex);
+      u32 segmentCount = writeIndex - readIndex;
+      if(!segmentCount)
+	{
+	  gsSleep(1);
+	  continue;
 	}
 
-      if(grainState->queuedGrainCount && !grainState->playingGrainCount)
+      // NOTE: stale segments aren't worth tagging, so a worker that's behind only takes the newest
+      if(segmentCount > LIVE_TAG_BATCH_COUNT)
 	{
-	  printf("FUCK! need grains!: %u\n", grainState->queuedGrainCount);
+	  tagger->skippedCount += segmentCount - LIVE_TAG_BATCH_COUNT;
+	  readIndex = writeIndex - LIVE_TAG_BATCH_COUNT;
+	  segmentCount = LIVE_TAG_BATCH_COUNT;
 	}
-      else if(grainState->playingGrainCount > 1)
+
+      u64 completedTicks[LIVE_TAG_BATCH_COUNT];
+      u64 streamSampleIndex = 0;
+      for(u32 i = 0; i < segmentCount; ++i)
 	{
-	  printf("FUCK! too many grains!: %u\n", grainState->playingGrainCount);
+	  LiveTagSegment *segment = tagger->segments + ((readIndex + i) & tagger->segmentMask);
+	  COPY_ARRAY(tagger->batchSamples + i*FILE_GRAIN_CHANNEL_LENGTH, segment->samples,
+		     FILE_GRAIN_CHANNEL_LENGTH, r32);
+	  completedTicks[i] = segment->completedTicks;
+	  streamSampleIndex = segment->streamSampleIndex;
 	}
+      gsAtomicStore(&tagger->segmentReadIndex, readIndex + segmentCount);
+
+      if(!runGrainTagger(tagger->tagger, tagger->features, tagger->batchSamples, tagger->batchTags, segmentCount))
+	{
+	  tagger->skippedCount += segmentCount;
+	  continue;
+	}
+
+      u64 publishTicks = getCpuCounter();
+      u64 latencyTicks = 0;
+      for(u32 i = 0; i < segmentCount; ++i)
+	{
+	  latencyTicks = publishTicks - completedTicks[i];
+	  tagger->maxLatencyTicks = MAX(tagger->maxLatencyTicks, latencyTicks);
+	  tagger->totalLatencyTicks += latencyTicks;
+	}
+      tagger->taggedCount += segmentCount;
+
+      // NOTE: only the newest tag is published; the others only count towards the totals
+      LiveTagResult *result = tagger->results + tagger->writeResultIndex;
+      COPY_ARRAY(result->vector, tagger->batchTags + (segmentCount - 1)*FILE_TAG_LENGTH, FILE_TAG_LENGTH, r32);
+      result->streamSampleIndex = streamSampleIndex;
+      result->latencyTicks = latencyTicks;
+      result->taggedCount = tagger->taggedCount;
+      result->skippedCount = tagger->skippedCount;
+      result->maxLatencyTicks = tagger->maxLatencyTicks;
+      result->totalLatencyTicks = tagger->totalLatencyTicks;
+
+      u32 newState = tagger->writeResultIndex | LIVE_TAG_RESULT_FRESH;
+      u32 state = gsAtomicLoad(&tagger->resultState);
+      while(gsAtomicCompareAndSwap(&tagger->resultState, state, newState) != state)
+	{
+	  state = gsAtomicLoad(&tagger->resultState);
+	}
+      tagger->writeResultIndex = state & LIVE_TAG_RESULT_INDEX_MASK;
+    }
+
+  gsAtomicStore(&tagger->finished, 1);
+}
+
+// NOTE: starts a worker that tags live input with `tagger`. Returns null if the model is picked but
+//       missing, or the host can't start threads. `allocator` must outlive the tagger
+static LiveTagger *
+openLiveTagger(Arena *allocator, GrainTagger tagger)
+{
+  LiveTagger *result = 0;
+  GS_RunModel *runModel = gsRunModel;
+  GrainTagger resolvedTagger = resolveGrainTagger(tagger);
+  if(resolvedTagger == GrainTagger_model && !runModel) return(result);
+
+  result = arenaPushStruct(allocator, LiveTagger, arenaFlagsZeroNoAlign());
+  result->tagger = resolvedTagger;
+  if(resolvedTagger == GrainTagger_features)
+    {
+      result->features = grainFeatureExtractorCreate(allocator);
+    }
+
+  ArenaPushFlags flags = arenaFlagsNoZeroAlign(GRAIN_PACKFILE_ALIGNMENT);
+  STATIC_ASSERT(IS_POWER_OF_2(LIVE_TAG_QUEUE_COUNT), liveTagQueueCountCheck);
+  result->segmentMask = LIVE_TAG_QUEUE_COUNT - 1;
+  result->segments = arenaPushArray(allocator, LIVE_TAG_QUEUE_COUNT, LiveTagSegment, flags);
+  result->batchSamples = arenaPushArray(allocator, LIVE_TAG_BATCH_COUNT*FILE_GRAIN_CHANNEL_LENGTH, r32, flags);
+  result->batchTags = arenaPushArray(allocator, LIVE_TAG_BATCH_COUNT*FILE_TAG_LENGTH, r32, flags);
+
+  // NOTE: the worker writes results[0], results[1] is spare, and the reader holds results[2]
+  result->writeResultIndex = 0;
+  result->resultState = 1;
+  result->readResultIndex = 2;
+
+  if(!gsStartThread(liveTaggerThreadProc, result))
+    {
+      logFormatString("ERROR: could not start the live tagging thread\n");
+      result = 0;
+    }
+
+  return(result);
+}
+
+// NOTE: audio thread. Cuts the input into segments, and queues each as it completes. Never blocks:
+//       a segment that starts while the ring is full is dropped
+static void
+liveTaggerPushSamples(LiveTagger *tagger, SamplePair *samples, u32 sampleCount)
+{
+  while(sampleCount)
+    {
+      u32 writeIndex = tagger->segmentWriteIndex;
+      LiveTagSegment *segment = tagger->segments + (writeIndex & tagger->segmentMask);
+      if(tagger->segmentFill == 0)
+	{
+	  u32 readIndex = gsAtomicLoad(&tagger->segmentReadIndex);
+	  tagger->segmentDropped = (writeIndex - readIndex > tagger->segmentMask);
+	  if(!tagger->segmentDropped) segment->streamSampleIndex = tagger->streamSampleCount;
+	}
+
+      u32 samplesToCopy = MIN(sampleCount, FILE_GRAIN_LENGTH - tagger->segmentFill);
+      if(!tagger->segmentDropped)
+	{
+	  r32 *destL = segment->samples + tagger->segmentFill;
+	  r32 *destR = destL + FILE_GRAIN_LENGTH;
+	  for(u32 i = 0; i < samplesToCopy; ++i)
+	    {
+	      destL[i] = samples[i].left;
+	      destR[i] = samples[i].right;
+	    }
+	}
+
+      samples += samplesToCopy;
+      sampleCount -= samplesToCopy;
+      tagger->segmentFill += samplesToCopy;
+      tagger->streamSampleCount += samplesToCopy;
+
+      if(tagger->segmentFill == FILE_GRAIN_LENGTH)
+	{
+	  if(tagger->segmentDropped)
+	    {
+	      ++tagger->droppedCount;
+	    }
+	  else
+	    {
+	      segment->completedTicks = getCpuCounter();
+	      gsAtomicStore(&tagger->segmentWriteIndex, writeIndex + 1);
+	    }
+	  tagger->segmentFill = 0;
+	}
+    }
+}
+
+// NOTE: the newest published tag, or null before the first. For a single reader thread; the result
+//       stays valid until the reader's next call
+static LiveTagResult *
+liveTaggerLatest(LiveTagger *tagger)
+{
+  u32 state = gsAtomicLoad(&tagger->resultState);
+  if(state & LIVE_TAG_RESULT_FRESH)
+    {
+      while(gsAtomicCompareAndSwap(&tagger->resultState, state, tagger->readResultIndex) != state)
+	{
+	  state = gsAtomicLoad(&tagger->resultState);
+	}
+      tagger->readResultIndex = state & LIVE_TAG_RESULT_INDEX_MASK;
+    }
+
+  LiveTagResult *result = tagger->results + tagger->readResultIndex;
+  if(!result->taggedCount) result = 0;
+
+  return(result);
+}
+
+// NOTE: stops the worker. Segments still queued are discarded. The tagger's memory stays valid,
+//       so the audio thread can keep pushing into it (every segment is then dropped)
+static void
+closeLiveTagger(LiveTagger *tagger)
+{
+  gsAtomicStore(&tagger->cancel, 1);
+  while(!gsAtomicLoad(&tagger->finished))
+    {
+      gsSleep(1);
+    }
+}
+
+//
+// s16 sample decoding
+//
+
+// NOTE: dest[i] = src[i]/GRAIN_SAMPLE_S16_SCALE. The wide kernels handle whole multiples of their
+//       width, and leave the rest to the scalar one
+#define DECODE_GRAIN_SAMPLES_S16(name) usz (name)(r32 *dest, s16 *src, usz count)
+
+static DECODE_GRAIN_SAMPLES_S16(decodeGrainSamplesS16Scalar_)
+{
+  r32 scale = 1.f/GRAIN_SAMPLE_S16_SCALE;
+  for(usz i = 0; i < count; ++i)
+    {
+      dest[i] = scale*(r32)src[i];
+    }
+
+  return(count);
+}
+
+static DECODE_GRAIN_SAMPLES_S16(decodeGrainSamplesS16Wide_)
+{
+  WideFloat scale = wideSetConstantFloats(1.f/GRAIN_SAMPLE_S16_SCALE);
+  usz wideCount = count - (count % WIDE_WIDTH);
+  for(usz i = 0; i < wideCount; i += WIDE_WIDTH)
+    {
+      wideStoreFloats(dest + i, wideMulFloats(scale, wideLoadS16Floats(src + i)));
+    }
+
+  return(wideCount);
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 DECODE_GRAIN_SAMPLES_S16(decodeGrainSamplesS16Wide8_)
+{
+  WideFloat8 scale = wideSetConstantFloats8(1.f/GRAIN_SAMPLE_S16_SCALE);
+  usz wideCount = count - (count % 8);
+  for(usz i = 0; i < wideCount; i += 8)
+    {
+      wideStoreFloats8(dest + i, wideMulFloats8(scale, wideLoadS16Floats8(src + i)));
+    }
+
+  return(wideCount);
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 DECODE_GRAIN_SAMPLES_S16(decodeGrainSamplesS16Wide16_)
+{
+  WideFloat16 scale = wideSetConstantFloats16(1.f/GRAIN_SAMPLE_S16_SCALE);
+  usz wideCount = count - (count % 16);
+  for(usz i = 0; i < wideCount; i += 16)
+    {
+      wideStoreFloats16(dest + i, wideMulFloats16(scale, wideLoadS16Floats16(src + i)));
+    }
+
+  return(wideCount);
+}
+#endif
+
+static void
+decodeGrainSamplesS16(SimdLevel level, r32 *dest, s16 *src, usz count)
+{
+  usz decoded = 0;
+  switch(level)
+    {
+#if SIMD_HAS_WIDE16
+    case SimdLevel_wide16: { decoded = decodeGrainSamplesS16Wide16_(dest, src, count); } break;
+#endif
+#if SIMD_HAS_WIDE8
+    case SimdLevel_wide8: { decoded = decodeGrainSamplesS16Wide8_(dest, src, count); } break;
+#endif
+    case SimdLevel_wide4: { decoded = decodeGrainSamplesS16Wide_(dest, src, count); } break;
+    default: break;
+    }
+  decodeGrainSamplesS16Scalar_(dest + decoded, src + decoded, count - decoded);
+}
+
+// NOTE: the I/O thread. Copying a grain out of the mapping is where its pages get faulted in.
+//       s16 grains are decoded on the way into the cache, so the audio thread only ever sees r32
+static void
+streamingGrainPackfileThreadProc(void *data)
+{
+  StreamingGrainPackfile *stream = (StreamingGrainPackfile *)data;
+  usz grainSampleCount = FILE_GRAIN_CHANNELS*stream->packfile.grainLength;
+
+  while(!gsAtomicLoad(&stream->cancel))
+    {
+      u32 readIndex = stream->requestReadIndex;
+      u32 writeIndex = gsAtomicLoad(&stream->requestWriteIndex);
+      if(readIndex == writeIndex)
+	{
+	  gsSleep(1);
+	  continue;
+	}
+
+      for(; readIndex != writeIndex; ++readIndex)
+	{
+	  GrainCacheSlot *slot = stream->slots + stream->requests[readIndex & stream->requestMask];
+	  if(stream->packfile.sampleFormat == GrainSampleFormat_s16)
+	    {
+	      s16 *srcSamples = stream->packfile.samplesS16 + slot->grainIndex*grainSampleCount;
+	      decodeGrainSamplesS16(stream->simdLevel, slot->samples, srcSamples, grainSampleCount);
+	    }
+	  else
+	    {
+	      r32 *srcSamples = stream->packfile.samples + slot->grainIndex*grainSampleCount;
+	      COPY_ARRAY(slot->samples, srcSamples, grainSampleCount, r32);
+	    }
+
+	  gsAtomicStore(&slot->state, GrainCacheSlot_ready);
+	}
+      gsAtomicStore(&stream->requestReadIndex, readIndex);
+    }
+
+  gsAtomicStore(&stream->finished, 1);
+}
+
+// NOTE: returns null if the packfile can't be mapped, or the host can't start the I/O thread.
+//       `allocator` must outlive the stream
+static StreamingGrainPackfile *
+openStreamingGrainPackfile(char *filename, Arena *allocator,
+			   u32 cacheGrainCount, u32 prefetchMsecs)
+{
+  StreamingGrainPackfile *result = 0;
+
+  Buffer file = gsMapFile(filename);
+  if(file.contents)
+    {
+      LoadedGrainPackfile packfile = {};
+      if(validateGrainPackfile(file, &packfile))
+	{
+	  packfile.file = file;
+	  packfile.isMapped = true;
+
+	  u32 requestCount = 1;
+	  while(requestCount < cacheGrainCount) requestCount <<= 1;
+
+	  result = arenaPushStruct(allocator, StreamingGrainPackfile, arenaFlagsZeroNoAlign());
+	  result->packfile = packfile;
+	  result->simdLevel = simdGetLevel();
+	  result->slotCount = cacheGrainCount;
+	  result->slots = arenaPushArray(allocator, cacheGrainCount, GrainCacheSlot, arenaFlagsZeroNoAlign());
+	  result->prefetchSampleCount = (u64)prefetchMsecs*INTERNAL_SAMPLE_RATE/1000;
+	  result->requestMask = requestCount - 1;
+	  result->requests = arenaPushArray(allocator, requestCount, u32);
+
+	  usz grainSampleCount = FILE_GRAIN_CHANNELS*packfile.grainLength;
+	  for(u32 slotIndex = 0; slotIndex < cacheGrainCount; ++slotIndex)
+	    {
+	      result->slots[slotIndex].samples =
+		arenaPushArray(allocator, grainSampleCount, r32, arenaFlagsNoZeroAlign(GRAIN_PACKFILE_ALIGNMENT));
+	    }
+
+	  if(!gsStartThread(streamingGrainPackfileThreadProc, result))
+	    {
+	      logFormatString("ERROR: could not start the grain streaming thread\n");
+	      result = 0;
+	    }
+	}
+
+      if(!result)
+	{
+	  gsUnmapFile(file);
+	}
+    }
+
+  return(result);
+}
+
+// NOTE: stops the I/O thread, and waits for it. Nothing may be playing from the stream any more
+static void
+closeStreamingGrainPackfile(StreamingGrainPackfile *stream)
+{
+  gsAtomicStore(&stream->cancel, 1);
+  while(!gsAtomicLoad(&stream->finished))
+    {
+      gsSleep(1);
+    }
+
+  gsUnmapFile(stream->packfile.file);
+}
+
+static b32
+streamingGrainPackfileIsIdle(StreamingGrainPackfile *stream)
+{
+  b32 result = (gsAtomicLoad(&stream->requestReadIndex) == stream->requestWriteIndex);
+  return(result);
+}
+
+// NOTE: audio thread only. Returns the slot that holds (or will hold) the grain, evicting the least
+//       recently used slot that isn't pinned or loading if needed, and pins it for the caller.
+//       Returns GRAIN_CACHE_SLOT_NONE if every slot is busy
+static u32
+requestStreamingGrain(StreamingGrainPackfile *stream, u64 grainIndex)
+{
+  u32 result = GRAIN_CACHE_SLOT_NONE;
+
+  u32 victimIndex = GRAIN_CACHE_SLOT_NONE;
+  u64 victimLastUsed = U64_MAX;
+  for(u32 slotIndex = 0; slotIndex < stream->slotCount; ++slotIndex)
+    {
+      // NOTE: the I/O thread only ever moves a slot from loading to ready, so a stale state here
+      //       just means a slot that has finished loading is passed over as a victim
+      GrainCacheSlot *slot = stream->slots + slotIndex;
+      u32 state = gsAtomicLoad(&slot->state);
+      if(state != GrainCacheSlot_empty && slot->grainIndex == grainIndex)
+	{
+	  result = slotIndex;
+	  break;
+	}
+
+      if(state != GrainCacheSlot_loading && !slot->pinCount && slot->lastUsed < victimLastUsed)
+	{
+	  victimIndex = slotIndex;
+	  victimLastUsed = slot->lastUsed;
+	}
+    }
+
+  if(result == GRAIN_CACHE_SLOT_NONE && victimIndex != GRAIN_CACHE_SLOT_NONE)
+    {
+      GrainCacheSlot *slot = stream->slots + victimIndex;
+      slot->grainIndex = grainIndex;
+      gsAtomicStore(&slot->state, GrainCacheSlot_loading);
+
+      u32 writeIndex = stream->requestWriteIndex;
+      stream->requests[writeIndex & stream->requestMask] = victimIndex;
+      gsAtomicStore(&stream->requestWriteIndex, writeIndex + 1);
+
+      result = victimIndex;
+    }
+
+  if(result != GRAIN_CACHE_SLOT_NONE)
+    {
+      ++stream->slots[result].pinCount;
+      stream->slots[result].lastUsed = ++stream->useCounter;
+    }
+
+  return(result);
+}
+
+static void
+unpinStreamingGrain(StreamingGrainPackfile *stream, u32 slotIndex)
+{
+  if(slotIndex != GRAIN_CACHE_SLOT_NONE)
+    {
+      ASSERT(stream->slots[slotIndex].pinCount);
+      --stream->slots[slotIndex].pinCount;
+    }
+}
+
+// NOTE: requests every queued grain that starts before the end of the prefetch window. A grain
+//       keeps its slot pinned from then on, so grains further out can't evict it before it plays,
+//       and grains that couldn't get a slot are retried on the next call
+static void
+prefetchQueuedGrains(FileGrainState *grainState, u32 samplesToWrite)
+{
+  StreamingGrainPackfile *stream = grainState->stream;
+  u64 prefetchEnd = grainState->samplesElapsedSinceLastQueue + samplesToWrite + stream->prefetchSampleCount;
+  for(u32 queueIndex = grainState->queueReadIndex; queueIndex != grainState->queueWriteIndex; ++queueIndex)
+    {
+      QueuedGrain *grain = grainState->queue + (queueIndex & (FILE_GRAIN_QUEUE_COUNT - 1));
+      if(grain->startSampleIndex >= prefetchEnd) break;
+
+      if(grain->cacheSlotIndex == GRAIN_CACHE_SLOT_NONE)
+	{
+	  grain->cacheSlotIndex = requestStreamingGrain(stream, grain->packfileGrainIndex);
+	}
+    }
+}
+
+// NOTE: builds the window for the current shape and grain length, and the hop and gain for the
+//       current overlap. The gain makes the windows of a steady stream of grains sum to one on
+//       average, which is exact for the shapes that overlap-add to a constant (rectangle at
+//       overlap 1, hann and triangle at overlap 2, and so on)
+static void
+updateFileGrainWindow(FileGrainState *grainState, u32 grainLength)
+{
+  ASSERT(grainLength > 0 && grainLength <= FILE_GRAIN_LENGTH);
+
+  r32 lengthF = (r32)grainLength;
+  r32 lengthInv = 1.f/lengthF;
+  r32 *window = grainState->window;
+  r32 windowSum = 0.f;
+  for(u32 i = 0; i < grainLength; ++i)
+    {
+      r32 sample = (r32)i;
+      r32 value = 1.f;
+      switch(grainState->windowShape)
+	{
+	case WindowShape_hann:	   { value = 0.5f*(1.f - gsCos(GS_TAU*sample*lengthInv)); } break;
+	case WindowShape_sine:	   { value = gsSin(GS_PI*sample*lengthInv); } break;
+	case WindowShape_triangle:
+	  {
+	    r32 halfLength = (grainLength > 1) ? 0.5f*(lengthF - 1.f) : 1.f;
+	    value = 1.f - gsAbs((sample - halfLength)/halfLength);
+	  } break;
+	default: break;
+	}
+      window[i] = value;
+      windowSum += value;
+    }
+
+  r32 overlap = clampToRange(grainState->overlap, 1.f, FILE_GRAIN_MAX_OVERLAP);
+  grainState->hopLength = MAX((u32)(lengthF/overlap + 0.5f), 1);
+  grainState->windowLength = grainLength;
+  grainState->windowGain = (windowSum > 0.f) ? (r32)grainState->hopLength/windowSum : 0.f;
+}
+
+// NOTE: the window and gain apply to grains already playing too. The hop only applies to grains
+//       queued afterwards
+static void
+setFileGrainWindow(FileGrainState *grainState, WindowType windowShape, r32 overlap)
+{
+  grainState->windowShape = windowShape;
+  grainState->overlap = overlap;
+  updateFileGrainWindow(grainState, grainState->windowLength);
+}
+
+static FileGrainState
+initializeFileGrainState(Arena *allocator)
+{
+  FileGrainState result = {};
+  result.allocator = allocator;
+  result.simdLevel = simdGetLevel();
+
+  ArenaPushFlags flags = arenaFlagsZeroAlign(GRAIN_PACKFILE_ALIGNMENT);
+  result.window = arenaPushArray(allocator, FILE_GRAIN_LENGTH, r32, flags);
+  result.queue = arenaPushArray(allocator, FILE_GRAIN_QUEUE_COUNT, QueuedGrain, flags);
+  result.voices = arenaPushArray(allocator, FILE_GRAIN_VOICE_COUNT, PlayingGrain, flags);
+  result.playing = arenaPushArray(allocator, FILE_GRAIN_VOICE_COUNT, PlayingGrain *, flags);
+  result.freeVoices = arenaPushArray(allocator, FILE_GRAIN_VOICE_COUNT, PlayingGrain *, flags);
+  for(u32 voiceIndex = 0; voiceIndex < FILE_GRAIN_VOICE_COUNT; ++voiceIndex)
+    {
+      PlayingGrain *voice = result.voices + voiceIndex;
+      voice->decodedSamples = arenaPushArray(allocator, FILE_GRAIN_CHANNEL_LENGTH, r32,
+					     arenaFlagsNoZeroAlign(GRAIN_PACKFILE_ALIGNMENT));
+      result.freeVoices[result.freeVoiceCount++] = voice;
+    }
+
+  // NOTE: back to back, unwindowed, which plays a packfile's grains exactly as they were cut
+  result.windowShape = WindowShape_rectangle;
+  result.overlap = 1.f;
+  updateFileGrainWindow(&result, FILE_GRAIN_LENGTH);
+
+  return(result);
+}
+
+static u32
+fileGrainQueueCount(FileGrainState *grainState)
+{
+  u32 result = grainState->queueWriteIndex - grainState->queueReadIndex;
+  return(result);
+}
+
+// NOTE: returns false if the queue is full
+static b32
+queueFileGrain(FileGrainState *grainState, u64 startSampleIndex, u64 packfileGrainIndex)
+{
+  b32 result = (fileGrainQueueCount(grainState) < FILE_GRAIN_QUEUE_COUNT);
+  if(result)
+    {
+      QueuedGrain *grain = grainState->queue + (grainState->queueWriteIndex & (FILE_GRAIN_QUEUE_COUNT - 1));
+      grain->startSampleIndex = startSampleIndex;
+      grain->packfileGrainIndex = packfileGrainIndex;
+      grain->cacheSlotIndex = GRAIN_CACHE_SLOT_NONE;
+      ++grainState->queueWriteIndex;
+    }
+
+  return(result);
+}
+
+// NOTE: tops the queue up from the sequential playback cursor
+static void
+refillFileGrainSequence(FileGrainState *grainState)
+{
+  while(grainState->sequenceNextGrainIndex < grainState->sequenceEndGrainIndex &&
+	queueFileGrain(grainState, grainState->sequenceNextStartSampleIndex, grainState->sequenceNextGrainIndex))
+    {
+      ++grainState->sequenceNextGrainIndex;
+      grainState->sequenceNextStartSampleIndex += grainState->hopLength;
+    }
+}
+
+// NOTE: drops anything queued, and starts the schedule over from sample 0. Grains already playing
+//       play out
+static void
+resetFileGrainQueue(FileGrainState *grainState, u32 grainLength)
+{
+  if(grainState->stream)
+    {
+      for(u32 queueIndex = grainState->queueReadIndex; queueIndex != grainState->queueWriteIndex; ++queueIndex)
+	{
+	  QueuedGrain *grain = grainState->queue + (queueIndex & (FILE_GRAIN_QUEUE_COUNT - 1));
+	  unpinStreamingGrain(grainState->stream, grain->cacheSlotIndex);
+	}
+    }
+
+  grainState->samplesElapsedSinceLastQueue = 0;
+  grainState->queueReadIndex = grainState->queueWriteIndex;
+  grainState->sequenceNextGrainIndex = 0;
+  grainState->sequenceEndGrainIndex = 0;
+  grainState->sequenceNextStartSampleIndex = 0;
+  if(grainLength && grainLength != grainState->windowLength)
+    {
+      updateFileGrainWindow(grainState, grainLength);
+    }
+}
+
+static u32
+fileGrainPendingCount(FileGrainState *grainState)
+{
+  u64 sequenceRemaining = grainState->sequenceEndGrainIndex - grainState->sequenceNextGrainIndex;
+  u32 result = fileGrainQueueCount(grainState) + (u32)MIN(sequenceRemaining, (u64)U32_MAX);
+  return(result);
+}
+
+// NOTE: plays every grain of the packfile in order, a hop apart
+static void
+queueAllGrainsFromFile(FileGrainState *grainState, LoadedGrainPackfile *source)
+{
+  // TODO: the tags are not used at all here. See `queueGrainsNearestToTag`
+  resetFileGrainQueue(grainState, (u32)source->grainLength);
+  grainState->source = source;
+  grainState->stream = 0;
+  grainState->sequenceEndGrainIndex = source->grainCount;
+  refillFileGrainSequence(grainState);
+}
+
+// NOTE: same sequential playback as `queueAllGrainsFromFile`, but grain samples come from the
+//       stream's cache, which `mixPlayingGrains` keeps filled
+static void
+queueAllGrainsFromStream(FileGrainState *grainState, StreamingGrainPackfile *stream)
+{
+  resetFileGrainQueue(grainState, (u32)stream->packfile.grainLength);
+  grainState->source = 0;
+  grainState->stream = stream;
+  grainState->sequenceEndGrainIndex = stream->packfile.grainCount;
+  refillFileGrainSequence(grainState);
+}
+
+// NOTE: queues the grains whose tags are nearest to `target` (a FILE_TAG_LENGTH vector, eg from the
+//       live input or a trajectory), nearest first, a hop apart. Plays from the grain state's stream
+//       if it has one, otherwise from `source`. Doesn't touch the tags themselves, so it's fine on
+//       the audio thread
+static u32
+queueGrainsNearestToTag(FileGrainState *grainState, LoadedGrainPackfile *source,
+			GrainTagIndex *index, r32 *target, u32 grainCount)
+{
+  StreamingGrainPackfile *stream = grainState->stream;
+  resetFileGrainQueue(grainState, (u32)(stream ? stream->packfile.grainLength : source->grainLength));
+  if(!stream) grainState->source = source;
+
+  GrainTagMatch matches[GRAIN_INDEX_MAX_MATCHES];
+  u32 matchCount = grainTagIndexQuery(index, target, matches, grainCount);
+  u32 result = 0;
+  for(; result < matchCount; ++result)
+    {
+      u64 startSampleIndex = (u64)grainState->hopLength*result;
+      if(!queueFileGrain(grainState, startSampleIndex, matches[result].index)) break;
+    }
+
+  return(result);
+}
+
+// NOTE: takes over the pin the grain's cache slot got when it was requested, when it starts
+//       playing. The slot stays pinned until the grain finishes, so that it can't be evicted from
+//       under it. A grain whose slot hasn't finished loading plays as silence, and lets it go
+static void
+acquireStreamingGrainSamples(StreamingGrainPackfile *stream, PlayingGrain *grain)
+{
+  u32 slotIndex = grain->cacheSlotIndex;
+  if(slotIndex != GRAIN_CACHE_SLOT_NONE)
+    {
+      GrainCacheSlot *slot = stream->slots + slotIndex;
+      ASSERT(slot->grainIndex == grain->packfileGrainIndex);
+      if(gsAtomicLoad(&slot->state) == GrainCacheSlot_ready)
+	{
+	  slot->lastUsed = ++stream->useCounter;
+	  grain->samples[0] = slot->samples;
+	  grain->samples[1] = slot->samples + stream->packfile.grainLength;
+	}
+      else
+	{
+	  unpinStreamingGrain(stream, slotIndex);
+	  slotIndex = GRAIN_CACHE_SLOT_NONE;
+	}
+    }
+
+  grain->cacheSlotIndex = slotIndex;
+  if(slotIndex == GRAIN_CACHE_SLOT_NONE)
+    {
+      grain->samples[0] = 0;
+      grain->samples[1] = 0;
+      gsAtomicAdd(&stream->missCount, 1);
+    }
+}
+
+// NOTE: points a voice at its grain's samples. Grains from s16 packfiles are decoded into the
+//       voice's own buffer
+static void
+startPlayingGrain(FileGrainState *grainState, PlayingGrain *voice, QueuedGrain *queued)
+{
+  voice->packfileGrainIndex = queued->packfileGrainIndex;
+  voice->cacheSlotIndex = queued->cacheSlotIndex;
+  voice->length = grainState->windowLength;
+  voice->position = 0;
+
+  StreamingGrainPackfile *stream = grainState->stream;
+  LoadedGrainPackfile *source = grainState->source;
+  u64 grainSampleCount = FILE_GRAIN_CHANNELS*(u64)voice->length;
+  if(stream)
+    {
+      acquireStreamingGrainSamples(stream, voice);
+    }
+  else if(source->sampleFormat == GrainSampleFormat_s16)
+    {
+      decodeGrainSamplesS16(grainState->simdLevel, voice->decodedSamples,
+			    source->samplesS16 + voice->packfileGrainIndex*grainSampleCount, grainSampleCount);
+      voice->samples[0] = voice->decodedSamples;
+      voice->samples[1] = voice->decodedSamples + voice->length;
+    }
+  else
+    {
+      voice->samples[0] = source->samples + voice->packfileGrainIndex*grainSampleCount;
+      voice->samples[1] = voice->samples[0] + voice->length;
+    }
+}
+
+//
+// grain segment mixing
+//
+
+// NOTE: dest += gain*window*src, on both channels. The wide kernels handle whole multiples of their
+//       width, and return how many samples they mixed
+#define MIX_FILE_GRAIN_SEGMENT(name) u32 (name)(r32 *destL, r32 *destR, r32 *srcL, r32 *srcR, \
+						 r32 *window, r32 gain, u32 count)
+
+static MIX_FILE_GRAIN_SEGMENT(mixFileGrainSegmentScalar_)
+{
+  for(u32 i = 0; i < count; ++i)
+    {
+      r32 scale = gain*window[i];
+      destL[i] += scale*srcL[i];
+      destR[i] += scale*srcR[i];
+    }
+
+  return(count);
+}
+
+static MIX_FILE_GRAIN_SEGMENT(mixFileGrainSegmentWide_)
+{
+  WideFloat wideGain = wideSetConstantFloats(gain);
+  u32 wideCount = count - (count % WIDE_WIDTH);
+  for(u32 i = 0; i < wideCount; i += WIDE_WIDTH)
+    {
+      WideFloat scale = wideMulFloats(wideGain, wideLoadFloats(window + i));
+      wideStoreFloats(destL + i, wideMulAddFloats(scale, wideLoadFloats(srcL + i), wideLoadFloats(destL + i)));
+      wideStoreFloats(destR + i, wideMulAddFloats(scale, wideLoadFloats(srcR + i), wideLoadFloats(destR + i)));
+    }
+
+  return(wideCount);
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 MIX_FILE_GRAIN_SEGMENT(mixFileGrainSegmentWide8_)
+{
+  WideFloat8 wideGain = wideSetConstantFloats8(gain);
+  u32 wideCount = count - (count % 8);
+  for(u32 i = 0; i < wideCount; i += 8)
+    {
+      WideFloat8 scale = wideMulFloats8(wideGain, wideLoadFloats8(window + i));
+      wideStoreFloats8(destL + i, wideMulAddFloats8(scale, wideLoadFloats8(srcL + i), wideLoadFloats8(destL + i)));
+      wideStoreFloats8(destR + i, wideMulAddFloats8(scale, wideLoadFloats8(srcR + i), wideLoadFloats8(destR + i)));
+    }
+
+  return(wideCount);
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 MIX_FILE_GRAIN_SEGMENT(mixFileGrainSegmentWide16_)
+{
+  WideFloat16 wideGain = wideSetConstantFloats16(gain);
+  u32 wideCount = count - (count % 16);
+  for(u32 i = 0; i < wideCount; i += 16)
+    {
+      WideFloat16 scale = wideMulFloats16(wideGain, wideLoadFloats16(window + i));
+      wideStoreFloats16(destL + i, wideMulAddFloats16(scale, wideLoadFloats16(srcL + i), wideLoadFloats16(destL + i)));
+      wideStoreFloats16(destR + i, wideMulAddFloats16(scale, wideLoadFloats16(srcR + i), wideLoadFloats16(destR + i)));
+    }
+
+  return(wideCount);
+}
+#endif
+
+static void
+mixFileGrainSegment(SimdLevel level, r32 *destL, r32 *destR, r32 *srcL, r32 *srcR,
+		    r32 *window, r32 gain, u32 count)
+{
+  u32 mixed = 0;
+  switch(level)
+    {
+#if SIMD_HAS_WIDE16
+    case SimdLevel_wide16: { mixed = mixFileGrainSegmentWide16_(destL, destR, srcL, srcR, window, gain, count); } break;
+#endif
+#if SIMD_HAS_WIDE8
+    case SimdLevel_wide8: { mixed = mixFileGrainSegmentWide8_(destL, destR, srcL, srcR, window, gain, count); } break;
+#endif
+    case SimdLevel_wide4: { mixed = mixFileGrainSegmentWide_(destL, destR, srcL, srcR, window, gain, count); } break;
+    default: break;
+    }
+  mixFileGrainSegmentScalar_(destL + mixed, destR + mixed, srcL + mixed, srcR + mixed,
+			     window + mixed, gain, count - mixed);
+}
+
+// NOTE: adds the block's worth of every playing grain into the destination buffers. Grains that
+//       come due in the block start on a free voice at their exact sample, and each grain is mixed
+//       as one segment per block
+static void
+mixPlayingGrains(r32 *destBufferL, r32 *destBufferR,
+		 r32 volume, u32 samplesToWrite,
+		 FileGrainState *grainState)
+{
+  StreamingGrainPackfile *stream = grainState->stream;
+  u64 blockStart = grainState->samplesElapsedSinceLastQueue;
+  u64 blockEnd = blockStart + samplesToWrite;
+
+  refillFileGrainSequence(grainState);
+  if(stream)
+    {
+      prefetchQueuedGrains(grainState, samplesToWrite);
+    }
+
+  // NOTE: start the grains that come due in this block
+  while(fileGrainQueueCount(grainState))
+    {
+      QueuedGrain *queued = grainState->queue + (grainState->queueReadIndex & (FILE_GRAIN_QUEUE_COUNT - 1));
+      if(queued->startSampleIndex >= blockEnd) break;
+
+      if(grainState->freeVoiceCount)
+	{
+	  PlayingGrain *voice = grainState->freeVoices[--grainState->freeVoiceCount];
+	  startPlayingGrain(grainState, voice, queued);
+	  voice->blockOffset = (u32)((queued->startSampleIndex > blockStart) ? (queued->startSampleIndex - blockStart) : 0);
+	  grainState->playing[grainState->playingGrainCount++] = voice;
+	}
+      else
+	{
+	  if(stream) unpinStreamingGrain(stream, queued->cacheSlotIndex);
+	  ++grainState->droppedGrainCount;
+	}
+      ++grainState->queueReadIndex;
+    }
+
+  if(!grainState->playingGrainCount && fileGrainPendingCount(grainState))
+    {
+      ++grainState->underrunBlockCount;
+    }
+
+  r32 gain = volume*grainState->windowGain;
+  for(u32 playingIndex = 0; playingIndex < grainState->playingGrainCount;)
+    {
+      PlayingGrain *voice = grainState->playing[playingIndex];
+      u32 offset = voice->blockOffset;
+      u32 count = MIN(voice->length - voice->position, samplesToWrite - offset);
+      if(voice->samples[0])
+	{
+	  mixFileGrainSegment(grainState->simdLevel, destBufferL + offset, destBufferR + offset,
+			      voice->samples[0] + voice->position, voice->samples[1] + voice->position,
+			      grainState->window + voice->position, gain, count);
+	}
+      voice->position += count;
+      voice->blockOffset = 0;
+
+      if(voice->position == voice->length)
+	{
+	  if(stream)
+	    {
+	      unpinStreamingGrain(stream, voice->cacheSlotIndex);
+	    }
+	  grainState->freeVoices[grainState->freeVoiceCount++] = voice;
+	  grainState->playing[playingIndex] = grainState->playing[--grainState->playingGrainCount];
+	}
+      else
+	{
+	  ++playingIndex;
+	}
+    }
 
-      ++destBufferL;
-      ++destBufferR;
-    }  
+  grainState->samplesElapsedSinceLastQueue = blockEnd;
 }
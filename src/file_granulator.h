@@ -1,19 +1,83 @@
 // for writing to/loading from disk
 
+// NOTE: entries are collected in chunks, one per sound, since an arena only keeps a single push
+//       contiguous
+struct GrainPackfileChunk
+{
+  GrainPackfileChunk *next;
+
+  usz entryCount;
+  struct GrainPackfileEntry *entries;
+};
+
+// NOTE: grains per model call when tagging. The host may split larger batches
+#define GRAIN_PACKFILE_TAG_BATCH_COUNT 32
+
+// NOTE: what computes grain tags: the host's onnx model, or the native feature extractor in
+//       grain_features.h. Tags from the two aren't comparable, so a packfile should be built with
+//       one tagger throughout. `auto` uses the model when the host has one
+enum GrainTagger
+{
+  GrainTagger_auto,
+  GrainTagger_model,
+  GrainTagger_features,
+};
+
+// NOTE: how tags and samples are stored on disk. Full precision tags are 800 bytes a grain and
+//       full precision samples 19200 (at 50ms stereo), so the corpus is memory bound; the smaller
+//       encodings trade a little accuracy for bandwidth:
+//         - s8 tags are scaled per vector to use the full range, 200 bytes plus a scale
+//         - f16 tags keep about 3 significant digits, 400 bytes
+//         - s16 samples are 16-bit pcm, half the size, and decode with a multiply
+enum GrainTagFormat
+{
+  GrainTagFormat_r32,
+  GrainTagFormat_s8,
+  GrainTagFormat_f16,
+};
+
+enum GrainSampleFormat
+{
+  GrainSampleFormat_r32,
+  GrainSampleFormat_s16,
+};
+
+#define GRAIN_SAMPLE_S16_SCALE 32767.f
+
 struct GrainPackfile
 {
   Arena *allocator;
-  void *storage;
+  u32 tagBatchCount;
+  GrainTagger tagger;
+  struct GrainFeatureExtractor *features; // NOTE: made on first use
+
+  // NOTE: set these before writing, to pick the on-disk encodings
+  GrainTagFormat tagFormat;
+  GrainSampleFormat sampleFormat;
 
-  usz grainCount;  
-  //GrainPackfileTag *tags;
-  //r32 *samples;
+  usz grainCount;
+  GrainPackfileChunk *firstChunk;
+  GrainPackfileChunk *lastChunk;
 };
 
 struct GrainPackfileTag
 {
-  usz startSampleIndex; // NOTE: refers to packfile->samples + startSampleIndex*GRAIN_CHANNEL_LENGTH
-  r32 vector[FILE_TAG_LENGTH];  
+  u64 startSampleIndex; // NOTE: refers to packfile->samples + startSampleIndex*GRAIN_CHANNEL_LENGTH
+  r32 vector[FILE_TAG_LENGTH];
+};
+
+struct GrainPackfileTagS8
+{
+  u64 startSampleIndex;
+  r32 scale; // NOTE: vector[i] = scale*quantized[i]
+  u32 reserved;
+  s8 vector[FILE_TAG_LENGTH];
+};
+
+struct GrainPackfileTagF16
+{
+  u64 startSampleIndex;
+  u16 vector[FILE_TAG_LENGTH];
 };
 
 struct GrainPackfileGrain
@@ -28,92 +92,392 @@ struct GrainPackfileEntry
   r32 grainSamples[FILE_GRAIN_CHANNELS][FILE_GRAIN_LENGTH];
 };
 
+// NOTE: packfile layout (version 4), little-endian throughout:
+//         GrainPackfileHeader
+//         GrainPackfileSection[sectionCount]
+//         section data, each section starting on a GRAIN_PACKFILE_ALIGNMENT boundary
+//       Loading only validates the header and section table, so that mapping a packfile stays O(1)
+//       however large it is; `verifyGrainPackfile` checks the checksum, which touches every page.
+//       A packfile has exactly one tags section and one samples section, in any of their
+//       encodings. Version 3 added the encodings; version 2 files are still read.
+//       Version 4 files are laid out for appending: the samples come first, and the tags and the
+//       append state trail them, as an index. The checksum chains over the sections' data in
+//       table order (before version 4, it covered every byte after the header), and the append
+//       state keeps the checksum as of the end of the samples, so an append only hashes what it
+//       writes
+#define GRAIN_PACKFILE_MAGIC FOURCC("GRPK")
+#define GRAIN_PACKFILE_VERSION 4
+#define GRAIN_PACKFILE_MIN_VERSION 2
+#define GRAIN_PACKFILE_APPEND_VERSION 4
+#define GRAIN_PACKFILE_CHECKSUM_SEED 0xCBF29CE484222325ULL
+#define GRAIN_PACKFILE_ENDIAN_TAG 0x01020304
+#define GRAIN_PACKFILE_ALIGNMENT 64
+#define GRAIN_PACKFILE_MAX_SECTIONS 16
+
+enum GrainPackfileSectionType
+{
+  GrainPackfileSection_none = 0,
+  GrainPackfileSection_tags = 1,       // NOTE: GrainPackfileTag[grainCount]
+  GrainPackfileSection_samples = 2,    // NOTE: r32[grainCount][channelCount][grainLength]
+  GrainPackfileSection_tagsS8 = 3,     // NOTE: GrainPackfileTagS8[grainCount]
+  GrainPackfileSection_tagsF16 = 4,    // NOTE: GrainPackfileTagF16[grainCount]
+  GrainPackfileSection_samplesS16 = 5, // NOTE: s16[grainCount][channelCount][grainLength]
+  GrainPackfileSection_appendState = 6, // NOTE: GrainPackfileAppendState
+};
+
 #pragma pack(push, 1)
 struct GrainPackfileHeader
 {
-  usz fileSize;
+  u32 magic;
+  u32 version;
+  u32 endianTag; // NOTE: reads back byte-swapped if the file was written on a big-endian machine
+  u32 headerSize;
 
-  usz grainCount;
-  usz grainLength;
-  
-  usz tagOffset; // NOTE: offset from the start of the header
-  usz grainOffset; // NOTE: offset from the start of the header
+  u64 fileSize;
+  u64 checksum;
+
+  u64 grainCount;
+  u32 grainLength;
+  u32 channelCount;
+  u32 tagLength;
+  u32 sampleRate;
+
+  u32 sectionCount;
+  u32 reserved;
+};
+
+struct GrainPackfileSection
+{
+  u32 type;
+  u32 reserved;
+  u64 offset; // NOTE: from the start of the file
+  u64 size;
+};
+
+struct GrainPackfileAppendState
+{
+  u64 samplesChecksum; // NOTE: the checksum chained over the samples section alone
+  u64 reserved[7];
 };
 #pragma pack(pop)
 
+STATIC_ASSERT(sizeof(GrainPackfileHeader) == 64, grainPackfileHeaderSizeCheck);
+STATIC_ASSERT(sizeof(GrainPackfileAppendState) == GRAIN_PACKFILE_ALIGNMENT, grainPackfileAppendStateSizeCheck);
+STATIC_ASSERT((sizeof(GrainPackfileGrain) % GRAIN_PACKFILE_ALIGNMENT) == 0, grainPackfileGrainSizeCheck);
+
 struct LoadedGrainPackfile
 {
-  u8 *packfileMemory;
+  Buffer file;
+  bool isMapped; // NOTE: otherwise, `file` was read into an arena
 
   u64 grainCount;
   u64 grainLength;
-  
+
+  // NOTE: only the pointers matching the formats are set
+  GrainTagFormat tagFormat;
+  GrainSampleFormat sampleFormat;
   GrainPackfileTag *tags;
+  GrainPackfileTagS8 *tagsS8;
+  GrainPackfileTagF16 *tagsF16;
   r32 *samples;
+  s16 *samplesS16;
+};
+
+// NOTE: appends sounds to a version 4 packfile on disk, without rewriting what's already there.
+//       Sounds are handed to a writer thread, which cuts them into grains and tags them a batch at
+//       a time, writing each batch's samples as soon as it's tagged. So memory use is one batch of
+//       grains, plus the tags, which are about 4% of a grain at full precision and 1% as s8.
+//       After each sound, the writer commits: it writes the whole tag index after the new samples,
+//       then the header, which is what makes the new grains visible. The new samples overwrite the
+//       old index, so nothing may read the packfile's tags while a sound is being appended;
+//       reload the packfile once `committedGrainCount` moves
+#define GRAIN_PACKFILE_APPEND_QUEUE_COUNT 16 // NOTE: a power of 2
+
+struct GrainPackfileLayout
+{
+  u32 tagsType;
+  u32 samplesType;
+  usz tagSize;
+  usz grainSize; // NOTE: bytes per grain in the samples section
+
+  u64 samplesOffset;
+  u64 tagsOffset;
+  u64 stateOffset;
+  u64 fileSize;
+};
+
+struct GrainPackfileAppender
+{
+  GS_File file;
+  GrainTagFormat tagFormat;
+  GrainSampleFormat sampleFormat;
+  u32 tagBatchCount;
+  GrainTagger tagger; // NOTE: resolved at open, never auto
+
+  // NOTE: writer thread only
+  struct GrainFeatureExtractor *features;
+  u64 grainCount;
+  u64 samplesChecksum;
+  usz tagCapacity;
+  Arena *tagArena; // NOTE: holds just the tags, and is replaced by one twice the size when they outgrow it
+  u8 *tags;        // NOTE: encoded as tagFormat
+  r32 *batchSamples;
+  r32 *batchTags;
+  u8 *batchEncoded;
+
+  // NOTE: sounds from the caller to the writer thread. A sound's samples must stay valid until
+  //       the writer has moved past it, ie until `soundReadIndex` passes it
+  u32 soundMask;
+  LoadedSound **sounds;
+  volatile u32 soundWriteIndex;
+  volatile u32 soundReadIndex;
+
+  volatile u32 committedGrainCount;
+  volatile u32 failed; // NOTE: a write failed, and the packfile may need rebuilding
+  volatile u32 cancel;
+  volatile u32 finished;
+};
+
+// NOTE: live input tagging. The audio thread cuts its input into FILE_GRAIN_LENGTH segments as it
+//       fills the grain buffer, and hands them to a worker through a single-producer ring. The
+//       worker tags them, and publishes the newest tag through a triple buffer, so neither side
+//       ever waits on the other. Under load, segments are dropped rather than left to queue up:
+//         - the audio thread drops a segment if the ring is full when it starts cutting it
+//         - the worker skips to the newest LIVE_TAG_BATCH_COUNT segments when it falls behind
+//       which keeps the latency to about one batch of tagging. Latency runs from when a segment
+//       is complete on the audio thread to when its tag is published
+#define LIVE_TAG_QUEUE_COUNT 16
+#define LIVE_TAG_BATCH_COUNT 4
+#define LIVE_TAG_RESULT_FRESH 0x4
+#define LIVE_TAG_RESULT_INDEX_MASK 0x3
+
+struct LiveTagSegment
+{
+  r32 samples[FILE_GRAIN_CHANNEL_LENGTH]; // NOTE: [channel][sample]
+  u64 streamSampleIndex; // NOTE: of the first sample, counted from when tagging started
+  u64 completedTicks;
+};
+
+struct LiveTagResult
+{
+  r32 vector[FILE_TAG_LENGTH];
+  u64 streamSampleIndex;
+  u64 latencyTicks;
+
+  // NOTE: running totals, as of this result
+  u64 taggedCount;
+  u64 skippedCount; // NOTE: segments the worker skipped to catch up
+  u64 maxLatencyTicks;
+  u64 totalLatencyTicks;
+};
+
+struct LiveTagger
+{
+  GrainTagger tagger; // NOTE: resolved at open, never auto
+
+  // NOTE: audio thread only
+  u64 streamSampleCount;
+  u32 segmentFill;
+  b32 segmentDropped;
+  u32 droppedCount; // NOTE: segments dropped because the ring was full
+
+  // NOTE: audio thread to worker
+  u32 segmentMask;
+  LiveTagSegment *segments;
+  volatile u32 segmentWriteIndex;
+  volatile u32 segmentReadIndex;
+
+  // NOTE: worker only
+  struct GrainFeatureExtractor *features;
+  r32 *batchSamples;
+  r32 *batchTags;
+  u32 writeResultIndex;
+  u64 taggedCount;
+  u64 skippedCount;
+  u64 maxLatencyTicks;
+  u64 totalLatencyTicks;
+
+  // NOTE: worker to reader. The state holds the index of the spare result, and
+  //       LIVE_TAG_RESULT_FRESH if the worker has published to it since the reader last looked
+  LiveTagResult results[3];
+  volatile u32 resultState;
+  u32 readResultIndex; // NOTE: reader only
+
+  volatile u32 cancel;
+  volatile u32 finished;
+};
+
+// NOTE: streaming packfiles are for grain libraries too large to keep resident. The packfile is
+//       mapped, but only the I/O thread touches its sample pages: the audio thread requests the
+//       grains it will start within the prefetch window, and plays them from a fixed-size LRU cache
+//       once they arrive. Neither side takes a lock, because ownership is split:
+//         - the audio thread owns the cache bookkeeping (which grain is in which slot, pins, ages)
+//         - the I/O thread only fills slots the audio thread hands it, then marks them ready
+//       A grain that isn't ready when it starts plays as silence, and counts as a miss
+#define GRAIN_CACHE_SLOT_NONE (U32_MAX)
+
+enum GrainCacheSlotState
+{
+  GrainCacheSlot_empty,
+  GrainCacheSlot_loading,
+  GrainCacheSlot_ready,
+};
+
+struct GrainCacheSlot
+{
+  u64 grainIndex;
+  u64 lastUsed;
+  u32 pinCount; // NOTE: grains queued to play, or playing, from this slot
+  volatile u32 state;
+
+  r32 *samples; // NOTE: r32[FILE_GRAIN_CHANNELS][grainLength]
+};
+
+struct StreamingGrainPackfile
+{
+  LoadedGrainPackfile packfile;
+  SimdLevel simdLevel; // NOTE: for decoding s16 samples into the cache
+
+  u32 slotCount;
+  GrainCacheSlot *slots;
+  u64 useCounter;
+  u64 prefetchSampleCount;
+
+  // NOTE: slot indices, from the audio thread to the I/O thread. Only slots that aren't already
+  //       loading are requested, so there's never more than one entry per slot in flight
+  u32 requestMask;
+  u32 *requests;
+  volatile u32 requestWriteIndex;
+  volatile u32 requestReadIndex;
+
+  volatile u32 missCount;
+  volatile u32 cancel;
+  volatile u32 finished;
 };
 
 // for runtime use
 
-struct PlayingGrain
+// NOTE: grains are scheduled into a ring of QueuedGrains, and started on one of a fixed pool of
+//       voices when their start sample comes around. Everything is allocated up front, so nothing
+//       on the audio thread allocates, locks, or logs. Grains overlap by `overlap`: a new grain
+//       starts every grainLength/overlap samples, and each is shaped by the window. The window is
+//       scaled so that overlapping windows sum to (about) one
+#define FILE_GRAIN_VOICE_COUNT 32
+#define FILE_GRAIN_QUEUE_COUNT 256 // NOTE: a power of 2
+#define FILE_GRAIN_MAX_OVERLAP 16.f
+
+struct QueuedGrain
 {
-  // NOTE: a grain is either queued, playing, or freed.
-  PlayingGrain *nextPlaying; 
-  PlayingGrain *prevPlaying;
-  
-  union
-  {
-    PlayingGrain *nextQueued;
-    PlayingGrain *nextFree;
-  };
-  bool onFreeList;
-
-  //r64 startTimestamp;
   u64 startSampleIndex;
+  u64 packfileGrainIndex;
+  u32 cacheSlotIndex; // NOTE: only used when playing from a StreamingGrainPackfile
+};
+
+struct PlayingGrain
+{
+  u64 packfileGrainIndex;
+  u32 cacheSlotIndex;
+
+  u32 length;
+  u32 position;    // NOTE: samples played so far
+  u32 blockOffset; // NOTE: where in the current block the grain starts, for grains that start mid-block
 
-  u32 samplesRemaining;
+  // NOTE: null for a streamed grain that missed the cache, which plays as silence
   r32 *samples[2];
+
+  // NOTE: FILE_GRAIN_CHANNEL_LENGTH samples, for grains from s16 packfiles
+  r32 *decodedSamples;
 };
 
 struct FileGrainState
 {
   Arena *allocator;
-    
-  u32 queuedGrainCount;
-  u32 playingGrainCount;
+  SimdLevel simdLevel;
+
+  // NOTE: at most one of these is set, by the queueing functions
+  LoadedGrainPackfile *source;
+  StreamingGrainPackfile *stream;
 
-  //u64 queuedSampleIndex;
   u64 samplesElapsedSinceLastQueue;
-  
-  PlayingGrain *grainQueue;
-  PlayingGrain *playlistSentinel;
-  
-  PlayingGrain *freeList;
+
+  WindowType windowShape;
+  r32 overlap;
+  u32 hopLength;
+  u32 windowLength; // NOTE: the grain length the window was built for
+  r32 windowGain;
+  r32 *window;      // NOTE: FILE_GRAIN_LENGTH entries
+
+  u32 queueReadIndex;
+  u32 queueWriteIndex;
+  QueuedGrain *queue;
+
+  // NOTE: sequential playback queues lazily, a ring's worth at a time, so that it works for
+  //       packfiles of any size
+  u64 sequenceNextGrainIndex;
+  u64 sequenceEndGrainIndex;
+  u64 sequenceNextStartSampleIndex;
+
+  u32 playingGrainCount;
+  u32 freeVoiceCount;
+  PlayingGrain *voices;
+  PlayingGrain **playing;
+  PlayingGrain **freeVoices;
+
+  u32 droppedGrainCount;  // NOTE: grains that came due with every voice busy
+  u32 underrunBlockCount; // NOTE: blocks with grains still to come, but nothing playing
 };
 
-inline PlayingGrain *
-reverseGrainQueueOrder(PlayingGrain *head)
+// NOTE: symmetric, with one scale per vector. Returns the scale
+inline r32
+grainTagQuantizeS8(r32 *src, s8 *dest, u32 count)
 {
-  if(head->nextQueued)
-    {
-      PlayingGrain *rest = reverseGrainQueueOrder(head->nextQueued);
-      head->nextQueued->nextQueued = head;
-      head->nextQueued = 0;
-      
-      return(rest);
-    }
-  else
+  r32 maxMagnitude = 0.f;
+  for(u32 i = 0; i < count; ++i) maxMagnitude = MAX(maxMagnitude, gsAbs(src[i]));
+
+  r32 result = (maxMagnitude > 0.f) ? maxMagnitude/127.f : 1.f;
+  r32 invScale = 1.f/result;
+  for(u32 i = 0; i < count; ++i)
     {
-      return(head);
+      r32 scaled = src[i]*invScale;
+      dest[i] = (s8)(scaled < 0.f ? scaled - 0.5f : scaled + 0.5f);
     }
+
+  return(result);
+}
+
+inline void
+grainTagQuantizeF16(r32 *src, u16 *dest, u32 count)
+{
+  for(u32 i = 0; i < count; ++i) dest[i] = halfFromR32(src[i]);
+}
+
+inline s16
+grainSampleEncodeS16(r32 sample)
+{
+  r32 scaled = clampToRange(sample, -1.f, 1.f)*GRAIN_SAMPLE_S16_SCALE;
+  s16 result = (s16)(scaled < 0.f ? scaled - 0.5f : scaled + 0.5f);
+  return(result);
 }
 
+// NOTE: the full precision tag vector of a grain, whatever the packfile's tag format
 inline void
-debugPrintQueuedGrainTimestamps(PlayingGrain *queue)
+grainPackfileGetTagVector(LoadedGrainPackfile *packfile, u64 grainIndex, r32 *dest)
 {
-  u32 index = 0;
-  for(PlayingGrain *grain = queue; grain; grain = grain->nextQueued, ++index)
+  switch(packfile->tagFormat)
     {
-      //printf("%u: %" PRIu64 "\n", index, grain->startSampleIndex);
-      logFormatString("%u: %llu\n", index, grain->startSampleIndex);
+    case GrainTagFormat_s8:
+      {
+	GrainPackfileTagS8 *tag = packfile->tagsS8 + grainIndex;
+	for(u32 i = 0; i < FILE_TAG_LENGTH; ++i) dest[i] = tag->scale*(r32)tag->vector[i];
+      } break;
+    case GrainTagFormat_f16:
+      {
+	GrainPackfileTagF16 *tag = packfile->tagsF16 + grainIndex;
+	for(u32 i = 0; i < FILE_TAG_LENGTH; ++i) dest[i] = r32FromHalf(tag->vector[i]);
+      } break;
+    default:
+      {
+	COPY_ARRAY(dest, packfile->tags[grainIndex].vector, FILE_TAG_LENGTH, r32);
+      } break;
     }
 }
@@ -231,7 +231,7 @@ static MemberDefinition membersOf_UILayout[] =
   {STR8_LIT("u32"), STR8_LIT("elementCount"), 0, 0, 0},
   {STR8_LIT("UIElement"), STR8_LIT("root"), 1, 0, 0},
   {STR8_LIT("UIElement"), STR8_LIT("currentParent"), 1, 0, 0},
-  {STR8_LIT("UIElement"), STR8_LIT("elementCache"), 1, 0, 512},
+  {STR8_LIT("UIElement"), STR8_LIT("elementCache"), 1, 0, 256},
   {STR8_LIT("UIElement"), STR8_LIT("elementFreeList"), 1, 0, 0},
   {STR8_LIT("Rect2"), STR8_LIT("regionRemaining"), 0, 0, 0},
   {STR8_LIT("UISizeType"), STR8_LIT("currentOffsetSizeType"), 0, 0, 0},
@@ -279,7 +279,6 @@ static MemberDefinition membersOf_UIElement[] =
   {STR8_LIT("UIElement"), STR8_LIT("parent"), 1, 0, 0},
   {STR8_LIT("UIHashKey"), STR8_LIT("hashKey"), 0, 0, 0},
   {STR8_LIT("u32"), STR8_LIT("lastFrameTouched"), 0, 0, 0},
-  {STR8_LIT("UIElement"), STR8_LIT("nextInHash"), 1, 0, 0},
   {STR8_LIT("UILayout"), STR8_LIT("layout"), 1, 0, 0},
   {STR8_LIT("u32"), STR8_LIT("flags"), 0, 0, 0},
   {STR8_LIT("String8"), STR8_LIT("name"), 0, 0, 0},
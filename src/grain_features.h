@@ -0,0 +1,461 @@
+// NOTE: native grain tagging, for hosts without the onnx model (the batch renderer, the web build),
+//       or when a model isn't wanted. A grain's channels are mixed to mono and cut into
+//       GRAIN_FEATURE_FRAME_COUNT hann-windowed frames, which run through one batched fft. Each
+//       frame then gives GrainFeature_count features:
+//         - MFCCs: the DCT of log mel band energies, scaled by GRAIN_FEATURE_MFCC_SCALE
+//         - spectral centroid and rolloff, as fractions of nyquist
+//         - spectral flatness, the geometric over the arithmetic mean of the power spectrum
+//         - rms, normalized by the window's energy so that a steady signal gives its own rms
+//         - zero crossings per sample
+//       Every feature is scaled to roughly [0, 1] or [-1, 1], so that none dominates the euclidean
+//       distances the grain index uses. The tag vector is the frames' features in order, then
+//       their means, then their standard deviations, then zeros.
+//       Extracting doesn't allocate, so it's fine on the audio thread; an extractor should only be
+//       used by one thread at a time
+#define GRAIN_FEATURE_FRAME_LENGTH 480 // NOTE: 10ms at 48kHz, a multiple of WIDE_MAX_WIDTH
+#define GRAIN_FEATURE_HOP_LENGTH 240
+#define GRAIN_FEATURE_FRAME_COUNT ((FILE_GRAIN_LENGTH - GRAIN_FEATURE_FRAME_LENGTH)/GRAIN_FEATURE_HOP_LENGTH + 1)
+#define GRAIN_FEATURE_BIN_COUNT (GRAIN_FEATURE_FRAME_LENGTH/2 + 1)
+#define GRAIN_FEATURE_BIN_STRIDE ROUND_UP_TO_MULTIPLE(GRAIN_FEATURE_BIN_COUNT, WIDE_MAX_WIDTH)
+#define GRAIN_FEATURE_MEL_COUNT 26
+#define GRAIN_FEATURE_MEL_STRIDE ROUND_UP_TO_MULTIPLE(GRAIN_FEATURE_MEL_COUNT, WIDE_MAX_WIDTH)
+#define GRAIN_FEATURE_MFCC_COUNT 13
+#define GRAIN_FEATURE_MFCC_SCALE 0.1f
+#define GRAIN_FEATURE_ROLLOFF 0.85f // NOTE: rolloff is where the power below reaches this fraction
+#define GRAIN_FEATURE_POWER_FLOOR 1e-10f
+
+enum GrainFeature
+{
+  GrainFeature_mfcc = 0,
+  GrainFeature_centroid = GRAIN_FEATURE_MFCC_COUNT,
+  GrainFeature_flatness,
+  GrainFeature_rolloff,
+  GrainFeature_rms,
+  GrainFeature_zeroCrossings,
+  GrainFeature_count,
+};
+
+#define GRAIN_FEATURE_MEANS_OFFSET (GRAIN_FEATURE_FRAME_COUNT*GrainFeature_count)
+#define GRAIN_FEATURE_DEVIATIONS_OFFSET (GRAIN_FEATURE_MEANS_OFFSET + GrainFeature_count)
+
+STATIC_ASSERT((GRAIN_FEATURE_FRAME_LENGTH % WIDE_MAX_WIDTH) == 0, grainFeatureFrameLengthCheck);
+STATIC_ASSERT(GRAIN_FEATURE_DEVIATIONS_OFFSET + GrainFeature_count <= FILE_TAG_LENGTH, grainFeatureTagLengthCheck);
+
+struct GrainFeatureExtractor
+{
+  FFT_Plan *plan;
+  FFT_BatchPlan *batch;
+  SimdLevel simdLevel;
+
+  r32 *window;          // NOTE: hann, with the 1/2 of the mono mix folded in
+  r32 windowEnergy;     // NOTE: sum of the squared window, without the 1/2
+  r32 *binFrequencies;  // NOTE: GRAIN_FEATURE_BIN_STRIDE, as fractions of nyquist, zero past the last bin
+  r32 *melWeights;      // NOTE: [GRAIN_FEATURE_MEL_COUNT][GRAIN_FEATURE_BIN_STRIDE] triangular filters
+  r32 *dct;             // NOTE: [GRAIN_FEATURE_MFCC_COUNT][GRAIN_FEATURE_MEL_STRIDE], orthonormal dct-ii
+
+  // NOTE: scratch
+  r32 *frames;          // NOTE: [GRAIN_FEATURE_FRAME_COUNT][GRAIN_FEATURE_FRAME_LENGTH]
+  r32 *spectraRe;
+  r32 *spectraIm;
+  r32 *power;           // NOTE: GRAIN_FEATURE_BIN_STRIDE
+  r32 *logMel;          // NOTE: GRAIN_FEATURE_MEL_STRIDE
+  r32 *features;        // NOTE: [GRAIN_FEATURE_FRAME_COUNT][GrainFeature_count]
+};
+
+//
+// kernels
+//
+
+// NOTE: dest[i] = window[i]*(srcL[i] + srcR[i]). count must be a multiple of WIDE_MAX_WIDTH
+#define GRAIN_FEATURE_WINDOW(name) void (name)(r32 *dest, r32 *srcL, r32 *srcR, r32 *window, u32 count)
+// NOTE: dest[i] = re[i]^2 + im[i]^2
+#define GRAIN_FEATURE_POWER(name) void (name)(r32 *dest, r32 *re, r32 *im, u32 count)
+// NOTE: returns a.b
+#define GRAIN_FEATURE_DOT(name) r32 (name)(r32 *a, r32 *b, u32 count)
+
+static GRAIN_FEATURE_WINDOW(grainFeatureWindowScalar_)
+{
+  for(u32 i = 0; i < count; ++i) dest[i] = window[i]*(srcL[i] + srcR[i]);
+}
+
+static GRAIN_FEATURE_POWER(grainFeaturePowerScalar_)
+{
+  for(u32 i = 0; i < count; ++i) dest[i] = re[i]*re[i] + im[i]*im[i];
+}
+
+static GRAIN_FEATURE_DOT(grainFeatureDotScalar_)
+{
+  r32 result = 0.f;
+  for(u32 i = 0; i < count; ++i) result += a[i]*b[i];
+  return(result);
+}
+
+static GRAIN_FEATURE_WINDOW(grainFeatureWindowWide_)
+{
+  for(u32 i = 0; i < count; i += WIDE_WIDTH)
+    {
+      WideFloat sum = wideAddFloats(wideLoadFloats(srcL + i), wideLoadFloats(srcR + i));
+      wideStoreFloats(dest + i, wideMulFloats(wideLoadFloats(window + i), sum));
+    }
+}
+
+static GRAIN_FEATURE_POWER(grainFeaturePowerWide_)
+{
+  for(u32 i = 0; i < count; i += WIDE_WIDTH)
+    {
+      WideFloat reVals = wideLoadFloats(re + i);
+      WideFloat imVals = wideLoadFloats(im + i);
+      wideStoreFloats(dest + i, wideMulAddFloats(reVals, reVals, wideMulFloats(imVals, imVals)));
+    }
+}
+
+static GRAIN_FEATURE_DOT(grainFeatureDotWide_)
+{
+  WideFloat acc = wideSetConstantFloats(0.f);
+  for(u32 i = 0; i < count; i += WIDE_WIDTH)
+    {
+      acc = wideMulAddFloats(wideLoadFloats(a + i), wideLoadFloats(b + i), acc);
+    }
+
+  r32 lanes[WIDE_WIDTH];
+  wideStoreFloats(lanes, acc);
+  r32 result = 0.f;
+  for(u32 i = 0; i < WIDE_WIDTH; ++i) result += lanes[i];
+  return(result);
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 GRAIN_FEATURE_WINDOW(grainFeatureWindowWide8_)
+{
+  for(u32 i = 0; i < count; i += 8)
+    {
+      WideFloat8 sum = wideAddFloats8(wideLoadFloats8(srcL + i), wideLoadFloats8(srcR + i));
+      wideStoreFloats8(dest + i, wideMulFloats8(wideLoadFloats8(window + i), sum));
+    }
+}
+
+static SIMD_TARGET_AVX2 GRAIN_FEATURE_POWER(grainFeaturePowerWide8_)
+{
+  for(u32 i = 0; i < count; i += 8)
+    {
+      WideFloat8 reVals = wideLoadFloats8(re + i);
+      WideFloat8 imVals = wideLoadFloats8(im + i);
+      wideStoreFloats8(dest + i, wideMulAddFloats8(reVals, reVals, wideMulFloats8(imVals, imVals)));
+    }
+}
+
+static SIMD_TARGET_AVX2 GRAIN_FEATURE_DOT(grainFeatureDotWide8_)
+{
+  WideFloat8 acc = wideSetConstantFloats8(0.f);
+  for(u32 i = 0; i < count; i += 8)
+    {
+      acc = wideMulAddFloats8(wideLoadFloats8(a + i), wideLoadFloats8(b + i), acc);
+    }
+
+  r32 lanes[8];
+  wideStoreFloats8(lanes, acc);
+  r32 result = 0.f;
+  for(u32 i = 0; i < 8; ++i) result += lanes[i];
+  return(result);
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 GRAIN_FEATURE_WINDOW(grainFeatureWindowWide16_)
+{
+  for(u32 i = 0; i < count; i += 16)
+    {
+      WideFloat16 sum = wideAddFloats16(wideLoadFloats16(srcL + i), wideLoadFloats16(srcR + i));
+      wideStoreFloats16(dest + i, wideMulFloats16(wideLoadFloats16(window + i), sum));
+    }
+}
+
+static SIMD_TARGET_AVX512 GRAIN_FEATURE_POWER(grainFeaturePowerWide16_)
+{
+  for(u32 i = 0; i < count; i += 16)
+    {
+      WideFloat16 reVals = wideLoadFloats16(re + i);
+      WideFloat16 imVals = wideLoadFloats16(im + i);
+      wideStoreFloats16(dest + i, wideMulAddFloats16(reVals, reVals, wideMulFloats16(imVals, imVals)));
+    }
+}
+
+static SIMD_TARGET_AVX512 GRAIN_FEATURE_DOT(grainFeatureDotWide16_)
+{
+  WideFloat16 acc = wideSetConstantFloats16(0.f);
+  for(u32 i = 0; i < count; i += 16)
+    {
+      acc = wideMulAddFloats16(wideLoadFloats16(a + i), wideLoadFloats16(b + i), acc);
+    }
+
+  r32 lanes[16];
+  wideStoreFloats16(lanes, acc);
+  r32 result = 0.f;
+  for(u32 i = 0; i < 16; ++i) result += lanes[i];
+  return(result);
+}
+#endif
+
+static void
+grainFeatureWindow_(SimdLevel level, r32 *dest, r32 *srcL, r32 *srcR, r32 *window, u32 count)
+{
+  switch(level)
+    {
+#if SIMD_HAS_WIDE16
+    case SimdLevel_wide16: { grainFeatureWindowWide16_(dest, srcL, srcR, window, count); } break;
+#endif
+#if SIMD_HAS_WIDE8
+    case SimdLevel_wide8: { grainFeatureWindowWide8_(dest, srcL, srcR, window, count); } break;
+#endif
+    case SimdLevel_wide4: { grainFeatureWindowWide_(dest, srcL, srcR, window, count); } break;
+    default: { grainFeatureWindowScalar_(dest, srcL, srcR, window, count); } break;
+    }
+}
+
+static void
+grainFeaturePower_(SimdLevel level, r32 *dest, r32 *re, r32 *im, u32 count)
+{
+  switch(level)
+    {
+#if SIMD_HAS_WIDE16
+    case SimdLevel_wide16: { grainFeaturePowerWide16_(dest, re, im, count); } break;
+#endif
+#if SIMD_HAS_WIDE8
+    case SimdLevel_wide8: { grainFeaturePowerWide8_(dest, re, im, count); } break;
+#endif
+    case SimdLevel_wide4: { grainFeaturePowerWide_(dest, re, im, count); } break;
+    default: { grainFeaturePowerScalar_(dest, re, im, count); } break;
+    }
+}
+
+static r32
+grainFeatureDot_(SimdLevel level, r32 *a, r32 *b, u32 count)
+{
+  r32 result = 0.f;
+  switch(level)
+    {
+#if SIMD_HAS_WIDE16
+    case SimdLevel_wide16: { result = grainFeatureDotWide16_(a, b, count); } break;
+#endif
+#if SIMD_HAS_WIDE8
+    case SimdLevel_wide8: { result = grainFeatureDotWide8_(a, b, count); } break;
+#endif
+    case SimdLevel_wide4: { result = grainFeatureDotWide_(a, b, count); } break;
+    default: { result = grainFeatureDotScalar_(a, b, count); } break;
+    }
+
+  return(result);
+}
+
+//
+// extraction
+//
+
+static r32
+grainFeatureMelFromHz_(r32 hz)
+{
+  // NOTE: 2595*log10(x) == 781.17*log2(x)
+  r32 result = 781.1702f*log2Approx(1.f + hz/700.f);
+  return(result);
+}
+
+static r32
+grainFeatureHzFromMel_(r32 mel)
+{
+  r32 result = 700.f*(gsPow(10.f, mel/2595.f) - 1.f);
+  return(result);
+}
+
+static GrainFeatureExtractor *
+grainFeatureExtractorCreate(Arena *arena)
+{
+  GrainFeatureExtractor *result = arenaPushStruct(arena, GrainFeatureExtractor, arenaFlagsZeroNoAlign());
+  result->plan = fftPlanCreate(arena, GRAIN_FEATURE_FRAME_LENGTH, FFT_Direction_forward);
+  result->batch = fftBatchPlanCreate(arena, result->plan);
+  result->simdLevel = simdGetLevel();
+
+  ArenaPushFlags flags = arenaFlagsZeroAlign(WIDE_MAX_WIDTH*sizeof(r32));
+  usz frameSampleCount = GRAIN_FEATURE_FRAME_COUNT*GRAIN_FEATURE_FRAME_LENGTH;
+  result->window = arenaPushArray(arena, GRAIN_FEATURE_FRAME_LENGTH, r32, flags);
+  result->binFrequencies = arenaPushArray(arena, GRAIN_FEATURE_BIN_STRIDE, r32, flags);
+  result->melWeights = arenaPushArray(arena, GRAIN_FEATURE_MEL_COUNT*GRAIN_FEATURE_BIN_STRIDE, r32, flags);
+  result->dct = arenaPushArray(arena, GRAIN_FEATURE_MFCC_COUNT*GRAIN_FEATURE_MEL_STRIDE, r32, flags);
+  result->frames = arenaPushArray(arena, frameSampleCount, r32, flags);
+  result->spectraRe = arenaPushArray(arena, frameSampleCount, r32, flags);
+  result->spectraIm = arenaPushArray(arena, frameSampleCount, r32, flags);
+  result->power = arenaPushArray(arena, GRAIN_FEATURE_BIN_STRIDE, r32, flags);
+  result->logMel = arenaPushArray(arena, GRAIN_FEATURE_MEL_STRIDE, r32, flags);
+  result->features = arenaPushArray(arena, GRAIN_FEATURE_FRAME_COUNT*GrainFeature_count, r32, flags);
+
+  // NOTE: periodic hann
+  for(u32 i = 0; i < GRAIN_FEATURE_FRAME_LENGTH; ++i)
+    {
+      r32 value = 0.5f*(1.f - gsCos(GS_TAU*(r32)i/(r32)GRAIN_FEATURE_FRAME_LENGTH));
+      result->window[i] = 0.5f*value;
+      result->windowEnergy += value*value;
+    }
+
+  for(u32 bin = 0; bin < GRAIN_FEATURE_BIN_COUNT; ++bin)
+    {
+      result->binFrequencies[bin] = (r32)bin/(r32)(GRAIN_FEATURE_BIN_COUNT - 1);
+    }
+
+  // NOTE: triangular filters, evenly spaced in mels from 0 to nyquist, each peaking at 1
+  r32 nyquist = 0.5f*(r32)INTERNAL_SAMPLE_RATE;
+  r32 melMax = grainFeatureMelFromHz_(nyquist);
+  r32 edges[GRAIN_FEATURE_MEL_COUNT + 2];
+  for(u32 i = 0; i < ARRAY_COUNT(edges); ++i)
+    {
+      edges[i] = grainFeatureHzFromMel_(melMax*(r32)i/(r32)(ARRAY_COUNT(edges) - 1));
+    }
+  for(u32 band = 0; band < GRAIN_FEATURE_MEL_COUNT; ++band)
+    {
+      r32 *weights = result->melWeights + band*GRAIN_FEATURE_BIN_STRIDE;
+      r32 low = edges[band], center = edges[band + 1], high = edges[band + 2];
+      for(u32 bin = 0; bin < GRAIN_FEATURE_BIN_COUNT; ++bin)
+	{
+	  r32 hz = result->binFrequencies[bin]*nyquist;
+	  r32 weight = 0.f;
+	  if(hz > low && hz <= center)	     weight = (hz - low)/(center - low);
+	  else if(hz > center && hz < high)  weight = (high - hz)/(high - center);
+	  weights[bin] = weight;
+	}
+    }
+
+  for(u32 k = 0; k < GRAIN_FEATURE_MFCC_COUNT; ++k)
+    {
+      r32 scale = gsSqrt(((k == 0) ? 1.f : 2.f)/(r32)GRAIN_FEATURE_MEL_COUNT);
+      for(u32 band = 0; band < GRAIN_FEATURE_MEL_COUNT; ++band)
+	{
+	  r32 angle = (r32)GS_PI*(r32)k*((r32)band + 0.5f)/(r32)GRAIN_FEATURE_MEL_COUNT;
+	  result->dct[k*GRAIN_FEATURE_MEL_STRIDE + band] = GRAIN_FEATURE_MFCC_SCALE*scale*gsCos(angle);
+	}
+    }
+
+  return(result);
+}
+
+// NOTE: features of one frame, from its windowed samples and its spectrum
+static void
+grainFeaturesOfFrame_(GrainFeatureExtractor *extractor, r32 *frame, r32 *re, r32 *im, r32 *features)
+{
+  SimdLevel level = extractor->simdLevel;
+  r32 *power = extractor->power;
+  grainFeaturePower_(level, power, re, im, GRAIN_FEATURE_BIN_STRIDE);
+  ZERO_ARRAY(power + GRAIN_FEATURE_BIN_COUNT, GRAIN_FEATURE_BIN_STRIDE - GRAIN_FEATURE_BIN_COUNT, r32);
+
+  r32 totalPower = 0.f;
+  r32 logPowerSum = 0.f;
+  for(u32 bin = 0; bin < GRAIN_FEATURE_BIN_COUNT; ++bin)
+    {
+      totalPower += power[bin];
+      logPowerSum += log2Approx(power[bin] + GRAIN_FEATURE_POWER_FLOOR);
+    }
+  r32 meanPower = totalPower/(r32)GRAIN_FEATURE_BIN_COUNT + GRAIN_FEATURE_POWER_FLOOR;
+  r32 geometricMeanPower = gsPow(2.f, logPowerSum/(r32)GRAIN_FEATURE_BIN_COUNT);
+
+  r32 rolloffPower = GRAIN_FEATURE_ROLLOFF*totalPower;
+  r32 cumulativePower = 0.f;
+  u32 rolloffBin = 0;
+  for(; rolloffBin < GRAIN_FEATURE_BIN_COUNT - 1; ++rolloffBin)
+    {
+      cumulativePower += power[rolloffBin];
+      if(cumulativePower >= rolloffPower) break;
+    }
+
+  r32 *logMel = extractor->logMel;
+  for(u32 band = 0; band < GRAIN_FEATURE_MEL_COUNT; ++band)
+    {
+      r32 energy = grainFeatureDot_(level, extractor->melWeights + band*GRAIN_FEATURE_BIN_STRIDE, power,
+				    GRAIN_FEATURE_BIN_STRIDE);
+      logMel[band] = GS_LN2*log2Approx(energy + GRAIN_FEATURE_POWER_FLOOR);
+    }
+  for(u32 k = 0; k < GRAIN_FEATURE_MFCC_COUNT; ++k)
+    {
+      features[GrainFeature_mfcc + k] = grainFeatureDot_(level, extractor->dct + k*GRAIN_FEATURE_MEL_STRIDE, logMel,
+							 GRAIN_FEATURE_MEL_STRIDE);
+    }
+
+  b32 silent = (totalPower <= GRAIN_FEATURE_POWER_FLOOR);
+  r32 centroidSum = grainFeatureDot_(level, extractor->binFrequencies, power, GRAIN_FEATURE_BIN_STRIDE);
+  features[GrainFeature_centroid] = silent ? 0.f : centroidSum/totalPower;
+  features[GrainFeature_flatness] = silent ? 0.f : MIN(geometricMeanPower/meanPower, 1.f);
+  features[GrainFeature_rolloff] = silent ? 0.f : extractor->binFrequencies[rolloffBin];
+
+  // NOTE: the frame holds the window times twice the mono signal
+  r32 energy = grainFeatureDot_(level, frame, frame, GRAIN_FEATURE_FRAME_LENGTH);
+  features[GrainFeature_rms] = gsSqrt(energy/extractor->windowEnergy);
+
+  u32 crossingCount = 0;
+  for(u32 i = 1; i < GRAIN_FEATURE_FRAME_LENGTH; ++i)
+    {
+      crossingCount += ((frame[i - 1] < 0.f) != (frame[i] < 0.f)) && (frame[i - 1] != 0.f) && (frame[i] != 0.f);
+    }
+  features[GrainFeature_zeroCrossings] = (r32)crossingCount/(r32)(GRAIN_FEATURE_FRAME_LENGTH - 1);
+}
+
+// NOTE: tags one grain, r32[FILE_GRAIN_CHANNELS][FILE_GRAIN_LENGTH], into r32[FILE_TAG_LENGTH]
+static void
+grainFeaturesExtract(GrainFeatureExtractor *extractor, r32 *samples, r32 *tag)
+{
+  PROFILE_FUNCTION();
+
+  r32 *samplesL = samples;
+  r32 *samplesR = samples + FILE_GRAIN_LENGTH;
+  for(u32 frameIndex = 0; frameIndex < GRAIN_FEATURE_FRAME_COUNT; ++frameIndex)
+    {
+      u32 start = frameIndex*GRAIN_FEATURE_HOP_LENGTH;
+      grainFeatureWindow_(extractor->simdLevel, extractor->frames + frameIndex*GRAIN_FEATURE_FRAME_LENGTH,
+			  samplesL + start, samplesR + start, extractor->window, GRAIN_FEATURE_FRAME_LENGTH);
+    }
+
+  fftBatchExecuteReal(extractor->batch, extractor->spectraRe, extractor->spectraIm, extractor->frames,
+		      GRAIN_FEATURE_FRAME_COUNT);
+
+  for(u32 frameIndex = 0; frameIndex < GRAIN_FEATURE_FRAME_COUNT; ++frameIndex)
+    {
+      usz offset = frameIndex*GRAIN_FEATURE_FRAME_LENGTH;
+      grainFeaturesOfFrame_(extractor, extractor->frames + offset, extractor->spectraRe + offset,
+			    extractor->spectraIm + offset, extractor->features + frameIndex*GrainFeature_count);
+    }
+
+  ZERO_ARRAY(tag, FILE_TAG_LENGTH, r32);
+  COPY_ARRAY(tag, extractor->features, GRAIN_FEATURE_MEANS_OFFSET, r32);
+  r32 *means = tag + GRAIN_FEATURE_MEANS_OFFSET;
+  r32 *deviations = tag + GRAIN_FEATURE_DEVIATIONS_OFFSET;
+  r32 frameCountInv = 1.f/(r32)GRAIN_FEATURE_FRAME_COUNT;
+  for(u32 feature = 0; feature < GrainFeature_count; ++feature)
+    {
+      r32 sum = 0.f;
+      for(u32 frameIndex = 0; frameIndex < GRAIN_FEATURE_FRAME_COUNT; ++frameIndex)
+	{
+	  sum += extractor->features[frameIndex*GrainFeature_count + feature];
+	}
+      r32 mean = sum*frameCountInv;
+
+      r32 variance = 0.f;
+      for(u32 frameIndex = 0; frameIndex < GRAIN_FEATURE_FRAME_COUNT; ++frameIndex)
+	{
+	  r32 delta = extractor->features[frameIndex*GrainFeature_count + feature] - mean;
+	  variance += delta*delta;
+	}
+      means[feature] = mean;
+      deviations[feature] = gsSqrt(variance*frameCountInv);
+    }
+}
+
+// NOTE: the same contract as `gsRunModel`: inputData is r32[batchCount][FILE_GRAIN_CHANNELS][inputLength],
+//       outputData is r32[batchCount][FILE_TAG_LENGTH]. Only whole grains can be tagged
+static b32
+grainFeaturesRunBatch(GrainFeatureExtractor *extractor, r32 *inputData, r32 *outputData, u32 batchCount,
+		      s64 inputLength)
+{
+  b32 result = (inputLength == FILE_GRAIN_LENGTH);
+  for(u32 grainIndex = 0; result && grainIndex < batchCount; ++grainIndex)
+    {
+      grainFeaturesExtract(extractor, inputData + (usz)grainIndex*FILE_GRAIN_CHANNEL_LENGTH,
+			   outputData + (usz)grainIndex*FILE_TAG_LENGTH);
+    }
+
+  return(result);
+}
@@ -0,0 +1,826 @@
+// NOTE: approximate nearest-neighbor search over packfile tag vectors, for picking the grains whose
+//       tags are closest to a target (concatenative synthesis). This is an inverted file (ivf)
+//       index: the tags are clustered with k-means, every tag is stored in the list of its nearest
+//       centroid, and a query only scans the lists of the `probeCount` centroids nearest to it.
+//       Recall and query cost both go up with probeCount. Probing every list is an exact search.
+//
+//       Distances are squared euclidean, computed as |x|^2 - 2*q.x + |q|^2, so that scanning a
+//       list is one dot product per tag. The tags are copied into list order, padded out to the
+//       widest simd width, so a scan reads memory front to back and never touches the packfile.
+//
+//       The copies can be kept as s8 (with a per-vector scale) or f16, which cuts the bytes a scan
+//       reads to a quarter or a half. The kernels widen the quantized values in registers, so
+//       nothing is dequantized to memory; the query stays r32. Norms are taken from the quantized
+//       vectors, so distances are exact for what's stored, and only the quantization moves them.
+
+#define GRAIN_INDEX_KMEANS_ITERATIONS 8
+#define GRAIN_INDEX_TRAINING_PER_LIST 64 // NOTE: k-means trains on at most this many tags per list
+#define GRAIN_INDEX_DEFAULT_PROBE_COUNT 8
+#define GRAIN_INDEX_MAX_MATCHES 64
+#define GRAIN_INDEX_DOT_BATCH 4
+#define GRAIN_INDEX_RETRAIN_GROWTH 2 // NOTE: extending retrains once the tags outgrow the training by this
+
+struct GrainTagMatch
+{
+  u32 index;     // NOTE: a grain index for query results, a list index for probes
+  r32 distance;  // NOTE: squared
+};
+
+struct GrainTagIndex
+{
+  u32 dimension;
+  u32 stride; // NOTE: dimension padded to WIDE_MAX_WIDTH
+  u32 vectorCount;
+  u32 trainedVectorCount; // NOTE: tags there were when the centroids were trained
+  u32 listCount;
+  u32 probeCount;
+
+  // NOTE: centroids and vectors are followed by GRAIN_INDEX_DOT_BATCH - 1 zeroed vectors, so
+  //       that dot product batches can run off the end of a list
+  r32 *centroids;
+  r32 *centroidNorms;
+
+  u32 *listStarts; // NOTE: listCount + 1 entries, indexing the vectors
+
+  // NOTE: only the array matching vectorFormat is set. vectorScales is only set for s8
+  GrainTagFormat vectorFormat;
+  r32 *vectors;
+  s8 *vectorsS8;
+  u16 *vectorsF16;
+  r32 *vectorScales;
+  r32 *vectorNorms;
+  u32 *grainIndices;
+
+  // NOTE: query scratch, so that queries don't allocate. Only one thread may query an index
+  r32 *query;
+  r32 *centroidDistances;
+  GrainTagMatch *probes;
+
+  SimdLevel simdLevel;
+};
+
+//
+// dot products
+//
+
+// NOTE: results[j] = query.vectors[j], for the GRAIN_INDEX_DOT_BATCH vectors starting at `vectors`.
+//       Running several vectors at once keeps independent accumulator chains in flight, and loads
+//       each query element once per batch. stride must be a multiple of the kernel's width
+#define GRAIN_INDEX_DOT4(name) void (name)(r32 *query, r32 *vectors, u32 stride, r32 *results)
+
+static GRAIN_INDEX_DOT4(grainIndexDot4Scalar_)
+{
+  r32 *v0 = vectors;
+  r32 *v1 = v0 + stride;
+  r32 *v2 = v1 + stride;
+  r32 *v3 = v2 + stride;
+  r32 sum0 = 0.f, sum1 = 0.f, sum2 = 0.f, sum3 = 0.f;
+  for(u32 i = 0; i < stride; ++i)
+    {
+      r32 q = query[i];
+      sum0 += q*v0[i];
+      sum1 += q*v1[i];
+      sum2 += q*v2[i];
+      sum3 += q*v3[i];
+    }
+
+  results[0] = sum0;
+  results[1] = sum1;
+  results[2] = sum2;
+  results[3] = sum3;
+}
+
+static r32
+grainIndexSumLanes_(r32 *lanes, u32 laneCount)
+{
+  r32 result = 0.f;
+  for(u32 i = 0; i < laneCount; ++i) result += lanes[i];
+  return(result);
+}
+
+static GRAIN_INDEX_DOT4(grainIndexDot4Wide_)
+{
+  r32 *v0 = vectors;
+  r32 *v1 = v0 + stride;
+  r32 *v2 = v1 + stride;
+  r32 *v3 = v2 + stride;
+  WideFloat acc0 = wideSetConstantFloats(0.f);
+  WideFloat acc1 = acc0, acc2 = acc0, acc3 = acc0;
+  for(u32 i = 0; i < stride; i += WIDE_WIDTH)
+    {
+      WideFloat q = wideLoadFloats(query + i);
+      acc0 = wideMulAddFloats(q, wideLoadFloats(v0 + i), acc0);
+      acc1 = wideMulAddFloats(q, wideLoadFloats(v1 + i), acc1);
+      acc2 = wideMulAddFloats(q, wideLoadFloats(v2 + i), acc2);
+      acc3 = wideMulAddFloats(q, wideLoadFloats(v3 + i), acc3);
+    }
+
+  r32 lanes[GRAIN_INDEX_DOT_BATCH][WIDE_WIDTH];
+  wideStoreFloats(lanes[0], acc0);
+  wideStoreFloats(lanes[1], acc1);
+  wideStoreFloats(lanes[2], acc2);
+  wideStoreFloats(lanes[3], acc3);
+  for(u32 j = 0; j < GRAIN_INDEX_DOT_BATCH; ++j)
+    {
+      results[j] = grainIndexSumLanes_(lanes[j], WIDE_WIDTH);
+    }
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 GRAIN_INDEX_DOT4(grainIndexDot4Wide8_)
+{
+  r32 *v0 = vectors;
+  r32 *v1 = v0 + stride;
+  r32 *v2 = v1 + stride;
+  r32 *v3 = v2 + stride;
+  WideFloat8 acc0 = wideSetConstantFloats8(0.f);
+  WideFloat8 acc1 = acc0, acc2 = acc0, acc3 = acc0;
+  for(u32 i = 0; i < stride; i += 8)
+    {
+      WideFloat8 q = wideLoadFloats8(query + i);
+      acc0 = wideMulAddFloats8(q, wideLoadFloats8(v0 + i), acc0);
+      acc1 = wideMulAddFloats8(q, wideLoadFloats8(v1 + i), acc1);
+      acc2 = wideMulAddFloats8(q, wideLoadFloats8(v2 + i), acc2);
+      acc3 = wideMulAddFloats8(q, wideLoadFloats8(v3 + i), acc3);
+    }
+
+  r32 lanes[GRAIN_INDEX_DOT_BATCH][8];
+  wideStoreFloats8(lanes[0], acc0);
+  wideStoreFloats8(lanes[1], acc1);
+  wideStoreFloats8(lanes[2], acc2);
+  wideStoreFloats8(lanes[3], acc3);
+  for(u32 j = 0; j < GRAIN_INDEX_DOT_BATCH; ++j)
+    {
+      results[j] = grainIndexSumLanes_(lanes[j], 8);
+    }
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 GRAIN_INDEX_DOT4(grainIndexDot4Wide16_)
+{
+  r32 *v0 = vectors;
+  r32 *v1 = v0 + stride;
+  r32 *v2 = v1 + stride;
+  r32 *v3 = v2 + stride;
+  WideFloat16 acc0 = wideSetConstantFloats16(0.f);
+  WideFloat16 acc1 = acc0, acc2 = acc0, acc3 = acc0;
+  for(u32 i = 0; i < stride; i += 16)
+    {
+      WideFloat16 q = wideLoadFloats16(query + i);
+      acc0 = wideMulAddFloats16(q, wideLoadFloats16(v0 + i), acc0);
+      acc1 = wideMulAddFloats16(q, wideLoadFloats16(v1 + i), acc1);
+      acc2 = wideMulAddFloats16(q, wideLoadFloats16(v2 + i), acc2);
+      acc3 = wideMulAddFloats16(q, wideLoadFloats16(v3 + i), acc3);
+    }
+
+  r32 lanes[GRAIN_INDEX_DOT_BATCH][16];
+  wideStoreFloats16(lanes[0], acc0);
+  wideStoreFloats16(lanes[1], acc1);
+  wideStoreFloats16(lanes[2], acc2);
+  wideStoreFloats16(lanes[3], acc3);
+  for(u32 j = 0; j < GRAIN_INDEX_DOT_BATCH; ++j)
+    {
+      results[j] = grainIndexSumLanes_(lanes[j], 16);
+    }
+}
+#endif
+
+static void
+grainIndexDot4_(SimdLevel level, r32 *query, r32 *vectors, u32 stride, r32 *results)
+{
+  switch(level)
+    {
+#if SIMD_HAS_WIDE16
+    case SimdLevel_wide16: { grainIndexDot4Wide16_(query, vectors, stride, results); } break;
+#endif
+#if SIMD_HAS_WIDE8
+    case SimdLevel_wide8: { grainIndexDot4Wide8_(query, vectors, stride, results); } break;
+#endif
+    case SimdLevel_wide4: { grainIndexDot4Wide_(query, vectors, stride, results); } break;
+    default: { grainIndexDot4Scalar_(query, vectors, stride, results); } break;
+    }
+}
+
+// NOTE: the same, over s8 vectors. Results are unscaled: the caller multiplies in each vector's scale
+#define GRAIN_INDEX_DOT4_S8(name) void (name)(r32 *query, s8 *vectors, u32 stride, r32 *results)
+
+static GRAIN_INDEX_DOT4_S8(grainIndexDot4S8Scalar_)
+{
+  s8 *v0 = vectors;
+  s8 *v1 = v0 + stride;
+  s8 *v2 = v1 + stride;
+  s8 *v3 = v2 + stride;
+  r32 sum0 = 0.f, sum1 = 0.f, sum2 = 0.f, sum3 = 0.f;
+  for(u32 i = 0; i < stride; ++i)
+    {
+      r32 q = query[i];
+      sum0 += q*(r32)v0[i];
+      sum1 += q*(r32)v1[i];
+      sum2 += q*(r32)v2[i];
+      sum3 += q*(r32)v3[i];
+    }
+
+  results[0] = sum0;
+  results[1] = sum1;
+  results[2] = sum2;
+  results[3] = sum3;
+}
+
+static GRAIN_INDEX_DOT4_S8(grainIndexDot4S8Wide_)
+{
+  s8 *v0 = vectors;
+  s8 *v1 = v0 + stride;
+  s8 *v2 = v1 + stride;
+  s8 *v3 = v2 + stride;
+  WideFloat acc0 = wideSetConstantFloats(0.f);
+  WideFloat acc1 = acc0, acc2 = acc0, acc3 = acc0;
+  for(u32 i = 0; i < stride; i += WIDE_WIDTH)
+    {
+      WideFloat q = wideLoadFloats(query + i);
+      acc0 = wideMulAddFloats(q, wideLoadS8Floats(v0 + i), acc0);
+      acc1 = wideMulAddFloats(q, wideLoadS8Floats(v1 + i), acc1);
+      acc2 = wideMulAddFloats(q, wideLoadS8Floats(v2 + i), acc2);
+      acc3 = wideMulAddFloats(q, wideLoadS8Floats(v3 + i), acc3);
+    }
+
+  r32 lanes[GRAIN_INDEX_DOT_BATCH][WIDE_WIDTH];
+  wideStoreFloats(lanes[0], acc0);
+  wideStoreFloats(lanes[1], acc1);
+  wideStoreFloats(lanes[2], acc2);
+  wideStoreFloats(lanes[3], acc3);
+  for(u32 j = 0; j < GRAIN_INDEX_DOT_BATCH; ++j)
+    {
+      results[j] = grainIndexSumLanes_(lanes[j], WIDE_WIDTH);
+    }
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 GRAIN_INDEX_DOT4_S8(grainIndexDot4S8Wide8_)
+{
+  s8 *v0 = vectors;
+  s8 *v1 = v0 + stride;
+  s8 *v2 = v1 + stride;
+  s8 *v3 = v2 + stride;
+  WideFloat8 acc0 = wideSetConstantFloats8(0.f);
+  WideFloat8 acc1 = acc0, acc2 = acc0, acc3 = acc0;
+  for(u32 i = 0; i < stride; i += 8)
+    {
+      WideFloat8 q = wideLoadFloats8(query + i);
+      acc0 = wideMulAddFloats8(q, wideLoadS8Floats8(v0 + i), acc0);
+      acc1 = wideMulAddFloats8(q, wideLoadS8Floats8(v1 + i), acc1);
+      acc2 = wideMulAddFloats8(q, wideLoadS8Floats8(v2 + i), acc2);
+      acc3 = wideMulAddFloats8(q, wideLoadS8Floats8(v3 + i), acc3);
+    }
+
+  r32 lanes[GRAIN_INDEX_DOT_BATCH][8];
+  wideStoreFloats8(lanes[0], acc0);
+  wideStoreFloats8(lanes[1], acc1);
+  wideStoreFloats8(lanes[2], acc2);
+  wideStoreFloats8(lanes[3], acc3);
+  for(u32 j = 0; j < GRAIN_INDEX_DOT_BATCH; ++j)
+    {
+      results[j] = grainIndexSumLanes_(lanes[j], 8);
+    }
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 GRAIN_INDEX_DOT4_S8(grainIndexDot4S8Wide16_)
+{
+  s8 *v0 = vectors;
+  s8 *v1 = v0 + stride;
+  s8 *v2 = v1 + stride;
+  s8 *v3 = v2 + stride;
+  WideFloat16 acc0 = wideSetConstantFloats16(0.f);
+  WideFloat16 acc1 = acc0, acc2 = acc0, acc3 = acc0;
+  for(u32 i = 0; i < stride; i += 16)
+    {
+      WideFloat16 q = wideLoadFloats16(query + i);
+      acc0 = wideMulAddFloats16(q, wideLoadS8Floats16(v0 + i), acc0);
+      acc1 = wideMulAddFloats16(q, wideLoadS8Floats16(v1 + i), acc1);
+      acc2 = wideMulAddFloats16(q, wideLoadS8Floats16(v2 + i), acc2);
+      acc3 = wideMulAddFloats16(q, wideLoadS8Floats16(v3 + i), acc3);
+    }
+
+  r32 lanes[GRAIN_INDEX_DOT_BATCH][16];
+  wideStoreFloats16(lanes[0], acc0);
+  wideStoreFloats16(lanes[1], acc1);
+  wideStoreFloats16(lanes[2], acc2);
+  wideStoreFloats16(lanes[3], acc3);
+  for(u32 j = 0; j < GRAIN_INDEX_DOT_BATCH; ++j)
+    {
+      results[j] = grainIndexSumLanes_(lanes[j], 16);
+    }
+}
+#endif
+
+// NOTE: the same, over f16 vectors. There's no 4-wide half conversion on the baseline targets, so
+//       the 4-wide level uses the scalar kernel
+#define GRAIN_INDEX_DOT4_F16(name) void (name)(r32 *query, u16 *vectors, u32 stride, r32 *results)
+
+static GRAIN_INDEX_DOT4_F16(grainIndexDot4F16Scalar_)
+{
+  u16 *v0 = vectors;
+  u16 *v1 = v0 + stride;
+  u16 *v2 = v1 + stride;
+  u16 *v3 = v2 + stride;
+  r32 sum0 = 0.f, sum1 = 0.f, sum2 = 0.f, sum3 = 0.f;
+  for(u32 i = 0; i < stride; ++i)
+    {
+      r32 q = query[i];
+      sum0 += q*r32FromHalf(v0[i]);
+      sum1 += q*r32FromHalf(v1[i]);
+      sum2 += q*r32FromHalf(v2[i]);
+      sum3 += q*r32FromHalf(v3[i]);
+    }
+
+  results[0] = sum0;
+  results[1] = sum1;
+  results[2] = sum2;
+  results[3] = sum3;
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 GRAIN_INDEX_DOT4_F16(grainIndexDot4F16Wide8_)
+{
+  u16 *v0 = vectors;
+  u16 *v1 = v0 + stride;
+  u16 *v2 = v1 + stride;
+  u16 *v3 = v2 + stride;
+  WideFloat8 acc0 = wideSetConstantFloats8(0.f);
+  WideFloat8 acc1 = acc0, acc2 = acc0, acc3 = acc0;
+  for(u32 i = 0; i < stride; i += 8)
+    {
+      WideFloat8 q = wideLoadFloats8(query + i);
+      acc0 = wideMulAddFloats8(q, wideLoadHalfFloats8(v0 + i), acc0);
+      acc1 = wideMulAddFloats8(q, wideLoadHalfFloats8(v1 + i), acc1);
+      acc2 = wideMulAddFloats8(q, wideLoadHalfFloats8(v2 + i), acc2);
+      acc3 = wideMulAddFloats8(q, wideLoadHalfFloats8(v3 + i), acc3);
+    }
+
+  r32 lanes[GRAIN_INDEX_DOT_BATCH][8];
+  wideStoreFloats8(lanes[0], acc0);
+  wideStoreFloats8(lanes[1], acc1);
+  wideStoreFloats8(lanes[2], acc2);
+  wideStoreFloats8(lanes[3], acc3);
+  for(u32 j = 0; j < GRAIN_INDEX_DOT_BATCH; ++j)
+    {
+      results[j] = grainIndexSumLanes_(lanes[j], 8);
+    }
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 GRAIN_INDEX_DOT4_F16(grainIndexDot4F16Wide16_)
+{
+  u16 *v0 = vectors;
+  u16 *v1 = v0 + stride;
+  u16 *v2 = v1 + stride;
+  u16 *v3 = v2 + stride;
+  WideFloat16 acc0 = wideSetConstantFloats16(0.f);
+  WideFloat16 acc1 = acc0, acc2 = acc0, acc3 = acc0;
+  for(u32 i = 0; i < stride; i += 16)
+    {
+      WideFloat16 q = wideLoadFloats16(query + i);
+      acc0 = wideMulAddFloats16(q, wideLoadHalfFloats16(v0 + i), acc0);
+      acc1 = wideMulAddFloats16(q, wideLoadHalfFloats16(v1 + i), acc1);
+      acc2 = wideMulAddFloats16(q, wideLoadHalfFloats16(v2 + i), acc2);
+      acc3 = wideMulAddFloats16(q, wideLoadHalfFloats16(v3 + i), acc3);
+    }
+
+  r32 lanes[GRAIN_INDEX_DOT_BATCH][16];
+  wideStoreFloats16(lanes[0], acc0);
+  wideStoreFloats16(lanes[1], acc1);
+  wideStoreFloats16(lanes[2], acc2);
+  wideStoreFloats16(lanes[3], acc3);
+  for(u32 j = 0; j < GRAIN_INDEX_DOT_BATCH; ++j)
+    {
+      results[j] = grainIndexSumLanes_(lanes[j], 16);
+    }
+}
+#endif
+
+// NOTE: dots of the query with the GRAIN_INDEX_DOT_BATCH stored vectors starting at `at`, in
+//       whichever format the index keeps them
+static void
+grainTagIndexVectorDot4_(GrainTagIndex *index, r32 *query, u32 at, r32 *results)
+{
+  SimdLevel level = index->simdLevel;
+  u32 stride = index->stride;
+  usz offset = (usz)at*stride;
+  switch(index->vectorFormat)
+    {
+    case GrainTagFormat_s8:
+      {
+	s8 *vectors = index->vectorsS8 + offset;
+	switch(level)
+	  {
+#if SIMD_HAS_WIDE16
+	  case SimdLevel_wide16: { grainIndexDot4S8Wide16_(query, vectors, stride, results); } break;
+#endif
+#if SIMD_HAS_WIDE8
+	  case SimdLevel_wide8: { grainIndexDot4S8Wide8_(query, vectors, stride, results); } break;
+#endif
+	  case SimdLevel_wide4: { grainIndexDot4S8Wide_(query, vectors, stride, results); } break;
+	  default: { grainIndexDot4S8Scalar_(query, vectors, stride, results); } break;
+	  }
+	for(u32 j = 0; j < GRAIN_INDEX_DOT_BATCH; ++j) results[j] *= index->vectorScales[at + j];
+      } break;
+    case GrainTagFormat_f16:
+      {
+	u16 *vectors = index->vectorsF16 + offset;
+	switch(level)
+	  {
+#if SIMD_HAS_WIDE16
+	  case SimdLevel_wide16: { grainIndexDot4F16Wide16_(query, vectors, stride, results); } break;
+#endif
+#if SIMD_HAS_WIDE8
+	  case SimdLevel_wide8: { grainIndexDot4F16Wide8_(query, vectors, stride, results); } break;
+#endif
+	  default: { grainIndexDot4F16Scalar_(query, vectors, stride, results); } break;
+	  }
+      } break;
+    default:
+      {
+	grainIndexDot4_(level, query, index->vectors + offset, stride, results);
+      } break;
+    }
+}
+
+//
+// index
+//
+
+// NOTE: keeps `matches` sorted by distance, holding the `matchCount` nearest seen so far
+static void
+grainTagMatchInsert_(GrainTagMatch *matches, u32 *foundCount, u32 matchCount, u32 index, r32 distance)
+{
+  if(*foundCount == matchCount && distance >= matches[matchCount - 1].distance) return;
+
+  u32 at = (*foundCount < matchCount) ? (*foundCount)++ : (matchCount - 1);
+  while(at > 0 && matches[at - 1].distance > distance)
+    {
+      matches[at] = matches[at - 1];
+      --at;
+    }
+  matches[at].index = index;
+  matches[at].distance = distance;
+}
+
+static r32
+grainIndexNorm_(r32 *vector, u32 stride)
+{
+  r32 result = 0.f;
+  for(u32 i = 0; i < stride; ++i) result += vector[i]*vector[i];
+  return(result);
+}
+
+// NOTE: distances[c] = |centroid c|^2 - 2*query.centroid c, ie squared distance minus |query|^2
+static void
+grainTagIndexCentroidDistances_(GrainTagIndex *index, r32 *query, r32 *distances)
+{
+  r32 dots[GRAIN_INDEX_DOT_BATCH];
+  for(u32 listIndex = 0; listIndex < index->listCount; listIndex += GRAIN_INDEX_DOT_BATCH)
+    {
+      grainIndexDot4_(index->simdLevel, query, index->centroids + (usz)listIndex*index->stride,
+		      index->stride, dots);
+      u32 batchCount = MIN(GRAIN_INDEX_DOT_BATCH, index->listCount - listIndex);
+      for(u32 j = 0; j < batchCount; ++j)
+	{
+	  distances[listIndex + j] = index->centroidNorms[listIndex + j] - 2.f*dots[j];
+	}
+    }
+}
+
+static u32
+grainTagIndexNearestList_(GrainTagIndex *index, r32 *query, r32 *distances)
+{
+  grainTagIndexCentroidDistances_(index, query, distances);
+
+  u32 result = 0;
+  for(u32 listIndex = 1; listIndex < index->listCount; ++listIndex)
+    {
+      if(distances[listIndex] < distances[result]) result = listIndex;
+    }
+
+  return(result);
+}
+
+// NOTE: stores `vector` (stride long, zero padded) at list position `at`, in the index's format. The
+//       norm is of the stored vector, read back after quantizing, so `vector` is overwritten
+static void
+grainTagIndexStoreVector_(GrainTagIndex *index, u32 at, u32 grainIndex, r32 *vector)
+{
+  usz offset = (usz)at*index->stride;
+  switch(index->vectorFormat)
+    {
+    case GrainTagFormat_s8:
+      {
+	s8 *quantized = index->vectorsS8 + offset;
+	r32 scale = grainTagQuantizeS8(vector, quantized, FILE_TAG_LENGTH);
+	index->vectorScales[at] = scale;
+	for(u32 d = 0; d < FILE_TAG_LENGTH; ++d) vector[d] = scale*(r32)quantized[d];
+      } break;
+    case GrainTagFormat_f16:
+      {
+	u16 *quantized = index->vectorsF16 + offset;
+	grainTagQuantizeF16(vector, quantized, FILE_TAG_LENGTH);
+	for(u32 d = 0; d < FILE_TAG_LENGTH; ++d) vector[d] = r32FromHalf(quantized[d]);
+      } break;
+    default:
+      {
+	COPY_ARRAY(index->vectors + offset, vector, FILE_TAG_LENGTH, r32);
+      } break;
+    }
+  index->vectorNorms[at] = grainIndexNorm_(vector, index->stride);
+  index->grainIndices[at] = grainIndex;
+}
+
+// NOTE: copies the stored vector at `from` in `source` to `to` in `dest`, which has the same format
+static void
+grainTagIndexCopyVector_(GrainTagIndex *dest, u32 to, GrainTagIndex *source, u32 from)
+{
+  usz toOffset = (usz)to*dest->stride;
+  usz fromOffset = (usz)from*source->stride;
+  switch(dest->vectorFormat)
+    {
+    case GrainTagFormat_s8:
+      {
+	COPY_ARRAY(dest->vectorsS8 + toOffset, source->vectorsS8 + fromOffset, dest->stride, s8);
+	dest->vectorScales[to] = source->vectorScales[from];
+      } break;
+    case GrainTagFormat_f16:
+      {
+	COPY_ARRAY(dest->vectorsF16 + toOffset, source->vectorsF16 + fromOffset, dest->stride, u16);
+      } break;
+    default:
+      {
+	COPY_ARRAY(dest->vectors + toOffset, source->vectors + fromOffset, dest->stride, r32);
+      } break;
+    }
+  dest->vectorNorms[to] = source->vectorNorms[from];
+  dest->grainIndices[to] = source->grainIndices[from];
+}
+
+// NOTE: allocates an index's arrays, for `tagCount` tags in `listCount` lists
+static GrainTagIndex *
+grainTagIndexAllocate_(Arena *arena, u32 tagCount, u32 listCount, GrainTagFormat vectorFormat)
+{
+  GrainTagIndex *result = arenaPushStruct(arena, GrainTagIndex, arenaFlagsZeroNoAlign());
+  result->dimension = FILE_TAG_LENGTH;
+  result->stride = ROUND_UP_TO_MULTIPLE(FILE_TAG_LENGTH, WIDE_MAX_WIDTH);
+  result->vectorCount = tagCount;
+  result->trainedVectorCount = tagCount;
+  result->listCount = listCount;
+  result->probeCount = MIN(GRAIN_INDEX_DEFAULT_PROBE_COUNT, listCount);
+  result->simdLevel = simdGetLevel();
+
+  u32 stride = result->stride;
+  ArenaPushFlags flags = arenaFlagsZeroAlign(WIDE_MAX_WIDTH*sizeof(r32));
+  usz paddedListCount = listCount + GRAIN_INDEX_DOT_BATCH - 1;
+  usz paddedVectorCount = (usz)tagCount + GRAIN_INDEX_DOT_BATCH - 1;
+  result->centroids = arenaPushArray(arena, paddedListCount*stride, r32, flags);
+  result->centroidNorms = arenaPushArray(arena, listCount, r32, flags);
+  result->listStarts = arenaPushArray(arena, listCount + 1, u32, flags);
+  result->vectorFormat = vectorFormat;
+  switch(vectorFormat)
+    {
+    case GrainTagFormat_s8:
+      {
+	result->vectorsS8 = arenaPushArray(arena, paddedVectorCount*stride, s8, flags);
+	result->vectorScales = arenaPushArray(arena, paddedVectorCount, r32, flags);
+      } break;
+    case GrainTagFormat_f16:
+      {
+	result->vectorsF16 = arenaPushArray(arena, paddedVectorCount*stride, u16, flags);
+      } break;
+    default:
+      {
+	result->vectors = arenaPushArray(arena, paddedVectorCount*stride, r32, flags);
+      } break;
+    }
+  result->vectorNorms = arenaPushArray(arena, tagCount, r32, flags);
+  result->grainIndices = arenaPushArray(arena, tagCount, u32, flags);
+  result->query = arenaPushArray(arena, stride, r32, flags);
+  result->centroidDistances = arenaPushArray(arena, listCount, r32, flags);
+  result->probes = arenaPushArray(arena, listCount, GrainTagMatch, flags);
+
+  return(result);
+}
+
+// NOTE: builds the index over the packfile's tags, storing them as `vectorFormat`, which needn't
+//       match the packfile's. Pass listCount = 0 for sqrt(tagCount) lists. k-means runs on an
+//       evenly spaced sample of the tags, so that building stays linear in the tag count for large
+//       packfiles; every tag is then assigned to its nearest trained centroid
+static GrainTagIndex *
+grainTagIndexCreate(Arena *arena, LoadedGrainPackfile *source, u32 listCount, GrainTagFormat vectorFormat)
+{
+  u32 tagCount = (u32)source->grainCount;
+  ASSERT(tagCount > 0);
+
+  if(!listCount) listCount = MAX((u32)gsSqrt((r32)tagCount), 1);
+  listCount = MIN(listCount, tagCount);
+
+  GrainTagIndex *result = grainTagIndexAllocate_(arena, tagCount, listCount, vectorFormat);
+  u32 stride = result->stride;
+  ArenaPushFlags flags = arenaFlagsZeroAlign(WIDE_MAX_WIDTH*sizeof(r32));
+
+  TemporaryMemory scratch = arenaGetScratch(&arena, 1);
+
+  // NOTE: training sample, padded to the index stride
+  u32 trainingCount = (u32)MIN((u64)tagCount, (u64)listCount*GRAIN_INDEX_TRAINING_PER_LIST);
+  r32 *training = arenaPushArray(scratch.arena, (usz)trainingCount*stride, r32, flags);
+  for(u32 i = 0; i < trainingCount; ++i)
+    {
+      u32 tagIndex = (u32)((u64)i*tagCount/trainingCount);
+      grainPackfileGetTagVector(source, tagIndex, training + (usz)i*stride);
+    }
+
+  // NOTE: lloyd iterations, seeded with evenly spaced training tags
+  for(u32 listIndex = 0; listIndex < listCount; ++listIndex)
+    {
+      u32 seedIndex = (u32)((u64)listIndex*trainingCount/listCount);
+      COPY_ARRAY(result->centroids + (usz)listIndex*stride, training + (usz)seedIndex*stride, stride, r32);
+    }
+
+  r32 *sums = arenaPushArray(scratch.arena, (usz)listCount*stride, r32, flags);
+  u32 *counts = arenaPushArray(scratch.arena, listCount, u32, flags);
+  for(u32 iteration = 0; iteration < GRAIN_INDEX_KMEANS_ITERATIONS; ++iteration)
+    {
+      for(u32 listIndex = 0; listIndex < listCount; ++listIndex)
+	{
+	  result->centroidNorms[listIndex] = grainIndexNorm_(result->centroids + (usz)listIndex*stride, stride);
+	}
+
+      ZERO_ARRAY(sums, (usz)listCount*stride, r32);
+      ZERO_ARRAY(counts, listCount, u32);
+      for(u32 i = 0; i < trainingCount; ++i)
+	{
+	  r32 *vector = training + (usz)i*stride;
+	  u32 listIndex = grainTagIndexNearestList_(result, vector, result->centroidDistances);
+	  r32 *sum = sums + (usz)listIndex*stride;
+	  for(u32 d = 0; d < stride; ++d) sum[d] += vector[d];
+	  ++counts[listIndex];
+	}
+
+      for(u32 listIndex = 0; listIndex < listCount; ++listIndex)
+	{
+	  r32 *centroid = result->centroids + (usz)listIndex*stride;
+	  if(counts[listIndex])
+	    {
+	      r32 scale = 1.f/(r32)counts[listIndex];
+	      r32 *sum = sums + (usz)listIndex*stride;
+	      for(u32 d = 0; d < stride; ++d) centroid[d] = scale*sum[d];
+	    }
+	  else
+	    {
+	      // NOTE: reseed empty lists with a training tag, so no list stays empty by accident
+	      u32 seedIndex = (u32)(((u64)iteration*7919 + listIndex*104729) % trainingCount);
+	      COPY_ARRAY(centroid, training + (usz)seedIndex*stride, stride, r32);
+	    }
+	}
+    }
+  for(u32 listIndex = 0; listIndex < listCount; ++listIndex)
+    {
+      result->centroidNorms[listIndex] = grainIndexNorm_(result->centroids + (usz)listIndex*stride, stride);
+    }
+
+  // NOTE: assign every tag, then lay the tags out in list order
+  u32 *assignments = arenaPushArray(scratch.arena, tagCount, u32, flags);
+  u32 *listFill = arenaPushArray(scratch.arena, listCount, u32, flags);
+  for(u32 tagIndex = 0; tagIndex < tagCount; ++tagIndex)
+    {
+      grainPackfileGetTagVector(source, tagIndex, result->query);
+      u32 listIndex = grainTagIndexNearestList_(result, result->query, result->centroidDistances);
+      assignments[tagIndex] = listIndex;
+      ++result->listStarts[listIndex + 1];
+    }
+  for(u32 listIndex = 0; listIndex < listCount; ++listIndex)
+    {
+      result->listStarts[listIndex + 1] += result->listStarts[listIndex];
+    }
+  for(u32 tagIndex = 0; tagIndex < tagCount; ++tagIndex)
+    {
+      u32 listIndex = assignments[tagIndex];
+      u32 at = result->listStarts[listIndex] + listFill[listIndex]++;
+      grainPackfileGetTagVector(source, tagIndex, result->query);
+      grainTagIndexStoreVector_(result, at, tagIndex, result->query);
+    }
+  ZERO_ARRAY(result->query, stride, r32);
+
+  arenaReleaseScratch(scratch);
+
+  return(result);
+}
+
+// NOTE: builds an index over a packfile that has grown since `index` was built over it, eg by
+//       appending sounds. The new tags are assigned to the existing centroids, and the old lists
+//       are copied over as they are, so only the new tags are read and quantized. Once the tags
+//       outgrow the training by GRAIN_INDEX_RETRAIN_GROWTH, the centroids would be stale, so the
+//       index is rebuilt from scratch instead. `index` is left as it was, so it can keep serving
+//       queries until the caller swaps in the result
+static GrainTagIndex *
+grainTagIndexExtend(Arena *arena, GrainTagIndex *index, LoadedGrainPackfile *source)
+{
+  u32 tagCount = (u32)source->grainCount;
+  ASSERT(tagCount >= index->vectorCount);
+  if(tagCount > (u64)index->trainedVectorCount*GRAIN_INDEX_RETRAIN_GROWTH)
+    {
+      GrainTagIndex *result = grainTagIndexCreate(arena, source, 0, index->vectorFormat);
+      return(result);
+    }
+
+  u32 listCount = index->listCount;
+  u32 stride = index->stride;
+  GrainTagIndex *result = grainTagIndexAllocate_(arena, tagCount, listCount, index->vectorFormat);
+  result->trainedVectorCount = index->trainedVectorCount;
+  result->probeCount = index->probeCount;
+  result->simdLevel = index->simdLevel;
+  COPY_ARRAY(result->centroids, index->centroids, (usz)listCount*stride, r32);
+  COPY_ARRAY(result->centroidNorms, index->centroidNorms, listCount, r32);
+
+  TemporaryMemory scratch = arenaGetScratch(&arena, 1);
+  u32 newCount = tagCount - index->vectorCount;
+  u32 *assignments = arenaPushArray(scratch.arena, newCount, u32);
+  u32 *listFill = arenaPushArray(scratch.arena, listCount, u32, arenaFlagsZeroNoAlign());
+  for(u32 i = 0; i < newCount; ++i)
+    {
+      grainPackfileGetTagVector(source, index->vectorCount + i, result->query);
+      u32 listIndex = grainTagIndexNearestList_(result, result->query, result->centroidDistances);
+      assignments[i] = listIndex;
+      ++result->listStarts[listIndex + 1];
+    }
+  for(u32 listIndex = 0; listIndex < listCount; ++listIndex)
+    {
+      u32 oldListCount = index->listStarts[listIndex + 1] - index->listStarts[listIndex];
+      result->listStarts[listIndex + 1] += result->listStarts[listIndex] + oldListCount;
+    }
+
+  // NOTE: each list is its old entries, then the new ones
+  for(u32 listIndex = 0; listIndex < listCount; ++listIndex)
+    {
+      u32 to = result->listStarts[listIndex];
+      for(u32 from = index->listStarts[listIndex]; from < index->listStarts[listIndex + 1]; ++from, ++to)
+	{
+	  grainTagIndexCopyVector_(result, to, index, from);
+	}
+      listFill[listIndex] = to - result->listStarts[listIndex];
+    }
+  for(u32 i = 0; i < newCount; ++i)
+    {
+      u32 listIndex = assignments[i];
+      u32 at = result->listStarts[listIndex] + listFill[listIndex]++;
+      grainPackfileGetTagVector(source, index->vectorCount + i, result->query);
+      grainTagIndexStoreVector_(result, at, index->vectorCount + i, result->query);
+    }
+  ZERO_ARRAY(result->query, stride, r32);
+
+  arenaReleaseScratch(scratch);
+
+  return(result);
+}
+
+// NOTE: finds up to `matchCount` grains (at most GRAIN_INDEX_MAX_MATCHES) nearest to `target`, a
+//       FILE_TAG_LENGTH vector, nearest first. Doesn't allocate, so it's safe on the audio thread.
+//       Returns the number of matches found
+static u32
+grainTagIndexQuery(GrainTagIndex *index, r32 *target, GrainTagMatch *matches, u32 matchCount)
+{
+  matchCount = MIN(matchCount, GRAIN_INDEX_MAX_MATCHES);
+  if(!matchCount) return(0);
+
+  r32 *query = index->query;
+  COPY_ARRAY(query, target, index->dimension, r32);
+  r32 queryNorm = grainIndexNorm_(query, index->stride);
+
+  // NOTE: pick the lists to probe
+  grainTagIndexCentroidDistances_(index, query, index->centroidDistances);
+  u32 probeCount = 0;
+  for(u32 listIndex = 0; listIndex < index->listCount; ++listIndex)
+    {
+      grainTagMatchInsert_(index->probes, &probeCount, index->probeCount,
+			   listIndex, index->centroidDistances[listIndex]);
+    }
+
+  u32 result = 0;
+  r32 dots[GRAIN_INDEX_DOT_BATCH];
+  for(u32 probeIndex = 0; probeIndex < probeCount; ++probeIndex)
+    {
+      u32 listIndex = index->probes[probeIndex].index;
+      u32 listStart = index->listStarts[listIndex];
+      u32 listEnd = index->listStarts[listIndex + 1];
+      for(u32 at = listStart; at < listEnd; at += GRAIN_INDEX_DOT_BATCH)
+	{
+	  grainTagIndexVectorDot4_(index, query, at, dots);
+	  u32 batchCount = MIN(GRAIN_INDEX_DOT_BATCH, listEnd - at);
+	  for(u32 j = 0; j < batchCount; ++j)
+	    {
+	      r32 distance = MAX(index->vectorNorms[at + j] - 2.f*dots[j] + queryNorm, 0.f);
+	      grainTagMatchInsert_(matches, &result, matchCount, index->grainIndices[at + j], distance);
+	    }
+	}
+    }
+
+  return(result);
+}
@@ -68,6 +68,19 @@ static GLFWcursor *vResizeCursor;
 static GLFWcursor *handCursor;
 static GLFWcursor *textCursor;
 
+// NOTE: frame pacing. While frames keep changing, the window draws at the display's refresh rate,
+//       or at HOST_BACKGROUND_FRAME_RATE when it doesn't have focus (glfw can't tell whether it's
+//       covered). Once frames stop changing, it waits for input instead: a frame's time at first,
+//       then HOST_IDLE_WAIT_SECONDS at a time, so audio-driven changes still show. A minimized
+//       window isn't drawn, and wakes every HOST_HIDDEN_WAIT_SECONDS
+#define HOST_DEFAULT_REFRESH_RATE 60
+#define HOST_BACKGROUND_FRAME_RATE 20
+#define HOST_IDLE_FRAMES_BEFORE_THROTTLE 30
+#define HOST_IDLE_WAIT_SECONDS 0.1
+#define HOST_HIDDEN_WAIT_SECONDS 0.5
+
+static bool windowNeedsRedraw;
+
 static inline void
 glfwSetCursorState(GLFWwindow *window, RenderCursorState cursorState)
 {
@@ -105,6 +118,13 @@ glfwProcessButtonPress(ButtonState *newState, bool pressed)
 
 // TODO: handle holding down keys!
 
+static void
+glfwWindowRefreshCallback(GLFWwindow *window)
+{
+  UNUSED(window);
+  windowNeedsRedraw = true;
+}
+
 static void
 glfwKeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
@@ -160,6 +180,12 @@ glfwKeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
       glfwProcessButtonPress(&newInput->keyboardState.keys[KeyboardButton_enter],
                              action == GLFW_PRESS || action == GLFW_REPEAT);
     }
+  else if(key == GLFW_KEY_R && action != GLFW_REPEAT)
+    {
+      // NOTE: a toggle, so held keys don't repeat
+      glfwProcessButtonPress(&newInput->keyboardState.keys[KeyboardButton_r],
+                             action == GLFW_PRESS);
+    }
 }
 
 static void
@@ -504,12 +530,17 @@ main(int argc, char **argv)
 
       glfwSetKeyCallback(window, glfwKeyCallback);
       glfwSetMouseButtonCallback(window, glfwMouseButtonCallback);
+      glfwSetWindowRefreshCallback(window, glfwWindowRefreshCallback);
       glfwMakeContextCurrent(window);
 
       gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
 
       glfwSwapInterval(1);
 
+      const GLFWvidmode *videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+      int refreshRate =
+        (videoMode && videoMode->refreshRate > 0) ? videoMode->refreshRate : HOST_DEFAULT_REFRESH_RATE;
+
       // memory/grahics setup
 
       PluginMemory pluginMemory = {};
@@ -519,11 +550,19 @@ main(int argc, char **argv)
       pluginMemory.platformAPI.gsReadEntireFile  = platformReadEntireFile;
       pluginMemory.platformAPI.gsFreeFileMemory  = platformFreeFileMemory;
       pluginMemory.platformAPI.gsWriteEntireFile = platformWriteEntireFile;
+      pluginMemory.platformAPI.gsMapFile         = platformMapFile;
+      pluginMemory.platformAPI.gsUnmapFile       = platformUnmapFile;
+      pluginMemory.platformAPI.gsOpenFileForWriting = platformOpenFileForWriting;
+      pluginMemory.platformAPI.gsWriteFileAt        = platformWriteFileAt;
+      pluginMemory.platformAPI.gsCloseFile          = platformCloseFile;
+      pluginMemory.platformAPI.gsRemoveFile         = platformRemoveFile;
       pluginMemory.platformAPI.gsGetPathToModule = platformGetPathToModule;
 
-      //pluginMemory.platformAPI.runModel = platformRunModel;
+      //pluginMemory.platformAPI.gsRunModel = platformRunModel;
 
       pluginMemory.platformAPI.gsGetCurrentTimestamp = platformGetCurrentTimestamp;
+      pluginMemory.platformAPI.gsStartThread         = platformStartThread;
+      pluginMemory.platformAPI.gsSleep               = platformSleep;
 
       pluginMemory.platformAPI.gsRand = gsRand;
       pluginMemory.platformAPI.gsAbs  = gsAbs;
@@ -572,6 +611,9 @@ main(int argc, char **argv)
 #if defined(PLUGIN_DYNAMIC)
       PluginCode plugin = loadPluginCode((char *)pluginPath.str);
       pluginMemory.pluginHandle = plugin.pluginCode;
+#if BUILD_DEBUG
+      FileWatcher pluginWatcher = beginWatchingFile((char *)pluginPath.str);
+#endif
 #define X(name, ret, args) gs##name = plugin.pluginAPI.gs##name;
       PLUGIN_API_XLIST
 #undef X
@@ -580,7 +622,8 @@ main(int argc, char **argv)
       // model setup
 
       // const ORTCHAR_T *modelPath = ORT_TSTR("../data/test_model.onnx");
-      // onnxState = onnxInitializeState(modelPath);
+      // onnxState = onnxInitializeState(modelPath, onnxDefaultSettings());
+      // onnxBenchmarkBatchSizes(256);
 
       // if(onnxState.session && onnxState.env)
       {
@@ -712,6 +755,7 @@ main(int argc, char **argv)
               // main loop
 
               u64 frameElapsedTime = 0;
+              u32 idleFrameCount = 0;
               //u64 lastAudioProcessCallTime = 0;
               while(!glfwWindowShouldClose(window))
               {
@@ -719,8 +763,7 @@ main(int argc, char **argv)
 
                 // reload plugin
 #if BUILD_DEBUG
-                u64 newWriteTime = getLastWriteTimeU64((char *)pluginPath.str);
-                if(newWriteTime != plugin.lastWriteTime)
+                if(fileWasWritten(&pluginWatcher))
                 {
                   unloadPluginCode(&plugin);
                   for(u32 tryIndex = 0; !plugin.isValid && (tryIndex < 50); ++tryIndex)
@@ -755,22 +798,22 @@ main(int argc, char **argv)
                     oldInput->keyboardState.modifiers[modifierIndex].endedDown;
                 }
 
-                newInput->frameMillisecondsElapsed = frameElapsedTime;
-
-                // render new frame
-
-                GL_CATCH_ERROR();
-
-                glViewport(0, 0, framebufferWidth, framebufferHeight);
-                glScissor(0, 0, framebufferWidth, framebufferHeight);
+                bool windowIsHidden = (glfwGetWindowAttrib(window, GLFW_ICONIFIED) ||
+                                       !framebufferWidth || !framebufferHeight);
+                if(windowIsHidden)
+                {
+                  windowNeedsRedraw = true;
+                  glfwWaitEventsTimeout(HOST_HIDDEN_WAIT_SECONDS);
 
-                GL_CATCH_ERROR();
+                  PluginInput *temp = newInput;
+                  newInput = oldInput;
+                  oldInput = temp;
+                  continue;
+                }
 
-                glClearColor(0.2f, 0.2f, 0.2f, 0.f);
-                glClearDepth(1);
-                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                newInput->frameMillisecondsElapsed = frameElapsedTime;
 
-                GL_CATCH_ERROR();
+                // render new frame
 
                 r32 targetAspectRatio = 16.f/9.f;
                 r32 windowAspectRatio = (r32)framebufferWidth/(r32)framebufferHeight;
@@ -792,25 +835,50 @@ main(int argc, char **argv)
 
                 renderBeginCommands(commands, (u32)viewportDim.x, (u32)viewportDim.y);
 
-                glViewport((GLint)viewportMin.x, (GLint)viewportMin.y,
-                           (GLsizei)viewportDim.x, (GLsizei)viewportDim.y);
-                glScissor((GLint)viewportMin.x, (GLint)viewportMin.y,
-                          (GLsizei)viewportDim.x, (GLsizei)viewportDim.y);
-
-                GL_CATCH_ERROR();
-                GL_PRINT_ERROR("GL ERROR: %u at frame start\n");
-
                 double mouseX, mouseY;
                 glfwGetCursorPos(window, &mouseX, &mouseY);
                 newInput->mouseState.position =
                   V2(mouseX, (r64)framebufferHeight - mouseY) - viewportMin;
 
+                bool frameWasSubmitted = false;
                 if(gsRenderNewFrame)
                 {
                   gsRenderNewFrame(&pluginMemory, oldInput, commands);
                   glfwSetCursorState(window, commands->cursorState);
-                  renderCommands(commands);
-                  GL_CATCH_ERROR();
+                  if(windowNeedsRedraw)
+                  {
+                    renderDiscardSubmittedFrames(commands);
+                    windowNeedsRedraw = false;
+                  }
+
+                  // NOTE: once the front and back buffers both hold an unchanged frame, leave them be
+                  if(renderFrameNeedsSubmission(commands))
+                  {
+                    GL_CATCH_ERROR();
+
+                    glViewport(0, 0, framebufferWidth, framebufferHeight);
+                    glScissor(0, 0, framebufferWidth, framebufferHeight);
+
+                    GL_CATCH_ERROR();
+
+                    glClearColor(0.2f, 0.2f, 0.2f, 0.f);
+                    glClearDepth(1);
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                    GL_CATCH_ERROR();
+
+                    glViewport((GLint)viewportMin.x, (GLint)viewportMin.y,
+                               (GLsizei)viewportDim.x, (GLsizei)viewportDim.y);
+                    glScissor((GLint)viewportMin.x, (GLint)viewportMin.y,
+                              (GLsizei)viewportDim.x, (GLsizei)viewportDim.y);
+
+                    GL_CATCH_ERROR();
+                    GL_PRINT_ERROR("GL ERROR: %u at frame start\n");
+
+                    renderCommands(commands);
+                    GL_CATCH_ERROR();
+                    frameWasSubmitted = true;
+                  }
                   renderEndCommands(commands);
 #if BUILD_LOGGING
                   while(atomicCompareAndSwap(&pluginMemory.logger->mutex, 0, 1) != 0) {}
@@ -856,8 +924,30 @@ main(int argc, char **argv)
                   }
                 }
 
-                glfwSwapBuffers(window);
-                glfwPollEvents();
+                bool windowIsFocused = glfwGetWindowAttrib(window, GLFW_FOCUSED);
+                r64 framePeriod = 1.0/(windowIsFocused ? refreshRate : HOST_BACKGROUND_FRAME_RATE);
+                if(frameWasSubmitted)
+                {
+                  idleFrameCount = 0;
+                  glfwSwapBuffers(window);
+
+                  // NOTE: when the swap didn't wait on vsync (it's off, or the window is in the
+                  //       background), sleep out the rest of the frame
+                  r64 frameSeconds =
+                    (r64)(readOSTimer() - frameStartTime)/(r64)pluginMemory.osTimerFreq;
+                  if(frameSeconds < framePeriod - 0.001)
+                  {
+                    msecWait((u32)(1000.0*(framePeriod - frameSeconds)));
+                  }
+                  glfwPollEvents();
+                }
+                else
+                {
+                  // NOTE: without a swap to wait on, sleep until input comes in
+                  ++idleFrameCount;
+                  glfwWaitEventsTimeout(idleFrameCount < HOST_IDLE_FRAMES_BEFORE_THROTTLE ?
+                                        framePeriod : HOST_IDLE_WAIT_SECONDS);
+                }
 
                 PluginInput *temp = newInput;
                 newInput = oldInput;
@@ -875,10 +965,12 @@ main(int argc, char **argv)
           ma_context_uninit(&maContext);
         }
 
-        // onnxState.api->ReleaseSession(onnxState.session);
-        // onnxState.api->ReleaseEnv(onnxState.env);
+        // onnxReleaseState(&onnxState);
       }
 
+#if BUILD_DEBUG
+      endWatchingFile(&pluginWatcher);
+#endif
       glfwDestroyCursor(standardCursor);
       glfwDestroyCursor(hResizeCursor);
       glfwDestroyCursor(vResizeCursor);
@@ -12,6 +12,7 @@ static r32 gsPow(r32 base, r32 exp);
 
 #define GS_PI 3.141592653589793
 #define GS_TAU (2.0*GS_PI)
+#define GS_LN2 0.6931471805599453
 
 //
 // scalar
@@ -43,7 +44,7 @@ cubicInterp(r32 val0, r32 val1, r32 val2, r32 val3, r32 t0)
   r32 t2 = t0 - 2;
   r32 t3 = t0 - 3;
   
-  r32 result = (-1.f/6.f)*t1*t2*t3*val0 + 0.5f*t0*t2*t3*val1 - 0.5f*t0*t1*t3*val2 + 0.5f*t0*t1*t2*val3;
+  r32 result = (-1.f/6.f)*t1*t2*t3*val0 + 0.5f*t0*t2*t3*val1 - 0.5f*t0*t1*t3*val2 + (1.f/6.f)*t0*t1*t2*val3;
 
   return(result);
 }
@@ -96,6 +97,87 @@ isPowerOf2(u32 num)
   return(num == ROUND_UP_TO_POWER_OF_2(num));
 }
 
+// NOTE: ieee half floats, for storage only. Rounds to nearest even; out of range values become
+//       infinities, and nans stay nans
+inline u16
+halfFromR32(r32 num)
+{
+  union { r32 f; u32 u; } bits = {num};
+  u32 sign = bits.u & 0x80000000;
+  bits.u ^= sign;
+
+  u16 result = 0;
+  if(bits.u >= 0x47800000)
+    {
+      result = (bits.u > 0x7F800000) ? 0x7E00 : 0x7C00;
+    }
+  else if(bits.u < 0x38800000)
+    {
+      // NOTE: denormal or zero. Adding 0.5 lines the half's mantissa up with the float's low bits,
+      //       and the fpu does the rounding
+      union { u32 u; r32 f; } magic = {0x3F000000};
+      bits.f += magic.f;
+      result = (u16)(bits.u - magic.u);
+    }
+  else
+    {
+      u32 mantissaOdd = (bits.u >> 13) & 1;
+      bits.u += ((u32)(15 - 127) << 23) + 0xFFF + mantissaOdd;
+      result = (u16)(bits.u >> 13);
+    }
+  result |= (u16)(sign >> 16);
+
+  return(result);
+}
+
+inline r32
+r32FromHalf(u16 half)
+{
+  u32 sign = (u32)(half & 0x8000) << 16;
+  u32 exponent = (half >> 10) & 0x1F;
+  u32 mantissa = half & 0x3FF;
+
+  union { u32 u; r32 f; } bits = {0};
+  if(exponent == 0)
+    {
+      bits.f = (r32)mantissa*(1.f/16777216.f);
+    }
+  else if(exponent == 31)
+    {
+      bits.u = 0x7F800000 | (mantissa << 13);
+    }
+  else
+    {
+      bits.u = ((exponent + 112) << 23) | (mantissa << 13);
+    }
+  bits.u |= sign;
+
+  return(bits.f);
+}
+
+// NOTE: log2 to about 1e-5 over positive normal inputs, for analysis code that needs many logs
+//       per block. The mantissa is brought into [sqrt(1/2), sqrt(2)) and the series
+//       ln(m) = 2*atanh((m - 1)/(m + 1)) is taken to its fourth term
+inline r32
+log2Approx(r32 x)
+{
+  union { r32 f; u32 u; } bits = {x};
+  s32 exponent = (s32)((bits.u >> 23) & 0xFF) - 127;
+  bits.u = (bits.u & 0x007FFFFF) | 0x3F800000;
+  if(bits.f > 1.41421356f)
+    {
+      bits.f *= 0.5f;
+      ++exponent;
+    }
+
+  r32 s = (bits.f - 1.f)/(bits.f + 1.f);
+  r32 s2 = s*s;
+  r32 series = s*(2.f + s2*(2.f/3.f + s2*(2.f/5.f + s2*(2.f/7.f))));
+  r32 result = (r32)exponent + series*(r32)(1.0/GS_LN2);
+
+  return(result);
+}
+
 //
 // complex
 //
@@ -253,7 +335,7 @@ cubicInterp(c64 val0, c64 val1, c64 val2, c64 val3, r32 t0)
   r32 t2 = t0 - 2;
   r32 t3 = t0 - 3;
   
-  c64 result = (-1.f/6.f)*t1*t2*t3*val0 + 0.5f*t0*t2*t3*val1 - 0.5f*t0*t1*t3*val2 + 0.5f*t0*t1*t2*val3;
+  c64 result = (-1.f/6.f)*t1*t2*t3*val0 + 0.5f*t0*t2*t3*val1 - 0.5f*t0*t1*t3*val2 + (1.f/6.f)*t0*t1*t2*val3;
 
   return(result);
 }
@@ -2,75 +2,219 @@
 
 OnnxState onnxState = {};
 
+static OnnxSettings
+onnxDefaultSettings(void)
+{
+  OnnxSettings result = {};
+  result.maxBatchCount = ONNX_DEFAULT_BATCH_COUNT;
+  result.grainLength = FILE_GRAIN_LENGTH;
+  result.intraOpThreadCount = getProcessorCount();
+  result.interOpThreadCount = 1;
+
+  return(result);
+}
+
+static OrtValue *
+onnxCreateTensor(OnnxState *state, r32 *data, s64 *shape, usz shapeCount)
+{
+  OrtValue *result = 0;
+
+  s64 elementCount = 1;
+  for(usz i = 0; i < shapeCount; ++i) elementCount *= shape[i];
+
+  OrtStatus *status = state->api->CreateTensorWithDataAsOrtValue(state->memoryInfo, data,
+								 elementCount*sizeof(r32),
+								 shape, shapeCount,
+								 ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT,
+								 &result);
+  ortPrintError(state->api, status);
+
+  return(result);
+}
+
 static OnnxState
-onnxInitializeState(const ORTCHAR_T *modelPath)
+onnxInitializeState(const ORTCHAR_T *modelPath, OnnxSettings settings)
 {
   OnnxState result = {};
   result.apiBase = OrtGetApiBase();
   ASSERT(result.apiBase);
   result.api = result.apiBase->GetApi(ORT_API_VERSION);
   ASSERT(result.api);
-  OrtStatus *ortStatus = 0;
+  const OrtApi *api = result.api;
+
+  ortPrintError(api, api->GetAllocatorWithDefaultOptions(&result.sessionAllocator));
+  ortPrintError(api, api->CreateEnv(ORT_LOGGING_LEVEL_WARNING, "GranularSynthTestLog", &result.env));
+
+  OrtSessionOptions *sessionOptions = 0;
+  ortPrintError(api, api->CreateSessionOptions(&sessionOptions));
+  ortPrintError(api, api->SetIntraOpNumThreads(sessionOptions, (int)settings.intraOpThreadCount));
+  ortPrintError(api, api->SetInterOpNumThreads(sessionOptions, (int)settings.interOpThreadCount));
+  ortPrintError(api, api->SetSessionExecutionMode(sessionOptions,
+						  (settings.interOpThreadCount > 1) ? ORT_PARALLEL : ORT_SEQUENTIAL));
+  ortPrintError(api, api->SetSessionGraphOptimizationLevel(sessionOptions, ORT_ENABLE_ALL));
+
+  b32 failed = ortPrintError(api, api->CreateSession(result.env, modelPath, sessionOptions, &result.session));
+  api->ReleaseSessionOptions(sessionOptions);
+
+  if(!failed)
+    {
+      // NOTE: metadata and buffers that used to be rebuilt on every call
+      ortPrintError(api, api->SessionGetInputName(result.session, 0, result.sessionAllocator, &result.inputName));
+      ortPrintError(api, api->SessionGetOutputName(result.session, 0, result.sessionAllocator, &result.outputName));
+      ortPrintError(api, api->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &result.memoryInfo));
 
-  ortStatus = result.api->GetAllocatorWithDefaultOptions(&result.sessionAllocator);
-  ortPrintError(ortStatus);
+      result.maxBatchCount = settings.maxBatchCount;
+      result.grainLength = settings.grainLength;
 
-  ortStatus = result.api->CreateEnv(ORT_LOGGING_LEVEL_VERBOSE, "GranularSynthTestLog", &result.env);
-  ortPrintError(ortStatus);
+      usz inputCount = (usz)result.maxBatchCount*FILE_GRAIN_CHANNELS*result.grainLength;
+      usz outputCount = (usz)result.maxBatchCount*FILE_TAG_LENGTH;
+      result.inputBuffer = (r32 *)platformAllocateMemory(inputCount*sizeof(r32));
+      result.outputBuffer = (r32 *)platformAllocateMemory(outputCount*sizeof(r32));
 
-  OrtSessionOptions *ortSessionOptions = 0;
-  ortStatus = result.api->CreateSessionOptions(&ortSessionOptions);
-  ortPrintError(ortStatus);
-  
-  ortStatus = result.api->CreateSession(result.env, modelPath, ortSessionOptions, &result.session);
-  ortPrintError(ortStatus);
-  result.api->ReleaseSessionOptions(ortSessionOptions);
+      s64 inputShape[] = {result.maxBatchCount, FILE_GRAIN_CHANNELS, result.grainLength};
+      s64 outputShape[] = {result.maxBatchCount, FILE_TAG_LENGTH};
+      result.inputTensor = onnxCreateTensor(&result, result.inputBuffer, inputShape, ARRAY_COUNT(inputShape));
+      result.outputTensor = onnxCreateTensor(&result, result.outputBuffer, outputShape, ARRAY_COUNT(outputShape));
+
+      ortPrintError(api, api->CreateIoBinding(result.session, &result.ioBinding));
+      ortPrintError(api, api->BindInput(result.ioBinding, result.inputName, result.inputTensor));
+      ortPrintError(api, api->BindOutput(result.ioBinding, result.outputName, result.outputTensor));
+    }
+  else
+    {
+      api->ReleaseEnv(result.env);
+      result.env = 0;
+      result.session = 0;
+    }
 
   return(result);
 }
 
-PLATFORM_RUN_MODEL(platformRunModel)
+static void
+onnxReleaseState(OnnxState *state)
 {
-  OrtStatus *status = 0;
-  char *inputName, *outputName;
-  status = onnxState.api->SessionGetInputName(onnxState.session, 0, onnxState.sessionAllocator, &inputName);
-  ortPrintError(status);
-  status = onnxState.api->SessionGetOutputName(onnxState.session, 0, onnxState.sessionAllocator, &outputName);
-  ortPrintError(status);
-
-  const char *inputNames[] = {inputName};
-  const char *outputNames[] = {outputName};
-    
-  OrtMemoryInfo *inputMemInfo = 0;
-  status = onnxState.api->CreateCpuMemoryInfo(OrtArenaAllocator, (OrtMemType)0, &inputMemInfo);
-  ortPrintError(status);
-
-  OrtValue *inputTensor = 0;
-  usz inputLengthInBytes = 2*inputLength*sizeof(r32);
-  const s64 inputShape[] = {1, 2, inputLength};
-  usz inputShapeLen = ARRAY_COUNT(inputShape);
-  ONNXTensorElementDataType inputDataType = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;  
-  status = onnxState.api->CreateTensorWithDataAsOrtValue(inputMemInfo, inputData, inputLengthInBytes,
-						  inputShape, inputShapeLen, inputDataType, &inputTensor);
-  ortPrintError(status);
-
-  const OrtValue *inputTensors[] = {inputTensor};
-  OrtValue *outputTensor = 0;
-  status = onnxState.api->Run(onnxState.session, 0, inputNames, inputTensors, 1, outputNames, 1, &outputTensor);
-  ortPrintError(status);
-
-  void *outputData = 0; // TODO: do we need to free this thing?
-  status = onnxState.api->GetTensorMutableData(outputTensor, &outputData);
-  ortPrintError(status);
-
-  onnxState.api->ReleaseMemoryInfo(inputMemInfo);
-  onnxState.api->ReleaseValue(inputTensor);
-  onnxState.api->ReleaseValue(outputTensor);
-  status = onnxState.api->AllocatorFree(onnxState.sessionAllocator, inputName);
-  ortPrintError(status);
-  status = onnxState.api->AllocatorFree(onnxState.sessionAllocator, outputName);
-  ortPrintError(status);
-
-  return(outputData);
+  const OrtApi *api = state->api;
+  if(state->session)
+    {
+      api->ReleaseIoBinding(state->ioBinding);
+      api->ReleaseValue(state->inputTensor);
+      api->ReleaseValue(state->outputTensor);
+      api->ReleaseMemoryInfo(state->memoryInfo);
+      ortPrintError(api, api->AllocatorFree(state->sessionAllocator, state->inputName));
+      ortPrintError(api, api->AllocatorFree(state->sessionAllocator, state->outputName));
+
+      platformFreeMemory(state->inputBuffer,
+			 (usz)state->maxBatchCount*FILE_GRAIN_CHANNELS*state->grainLength*sizeof(r32));
+      platformFreeMemory(state->outputBuffer, (usz)state->maxBatchCount*FILE_TAG_LENGTH*sizeof(r32));
+
+      api->ReleaseSession(state->session);
+    }
+  if(state->env)
+    {
+      api->ReleaseEnv(state->env);
+    }
+
+  ZERO_STRUCT(state);
 }
 
+// NOTE: runs one batch that's already in `state->inputBuffer`, leaving its tags in
+//       `state->outputBuffer`
+static b32
+onnxRunBatch(OnnxState *state, u32 batchCount)
+{
+  b32 result = false;
+  const OrtApi *api = state->api;
+  if(batchCount == state->maxBatchCount)
+    {
+      result = !ortPrintError(api, api->RunWithBinding(state->session, 0, state->ioBinding));
+    }
+  else
+    {
+      s64 inputShape[] = {batchCount, FILE_GRAIN_CHANNELS, state->grainLength};
+      s64 outputShape[] = {batchCount, FILE_TAG_LENGTH};
+      OrtValue *inputTensor = onnxCreateTensor(state, state->inputBuffer, inputShape, ARRAY_COUNT(inputShape));
+      OrtValue *outputTensor = onnxCreateTensor(state, state->outputBuffer, outputShape, ARRAY_COUNT(outputShape));
+
+      const char *inputNames[] = {state->inputName};
+      const char *outputNames[] = {state->outputName};
+      const OrtValue *inputTensors[] = {inputTensor};
+      OrtValue *outputTensors[] = {outputTensor};
+      result = !ortPrintError(api, api->Run(state->session, 0, inputNames, inputTensors, 1,
+					    outputNames, 1, outputTensors));
+
+      api->ReleaseValue(inputTensor);
+      api->ReleaseValue(outputTensor);
+    }
+
+  return(result);
+}
+
+// NOTE: inputData is r32[batchCount][FILE_GRAIN_CHANNELS][inputLength], outputData is
+//       r32[batchCount][FILE_TAG_LENGTH]. Batches larger than the session's are split
+static b32
+platformRunModel(r32 *inputData, r32 *outputData, u32 batchCount, s64 inputLength)
+{
+  OnnxState *state = &onnxState;
+  b32 result = (state->session != 0) && (inputLength == state->grainLength);
+
+  if(result)
+    {
+      while(atomicCompareAndSwap(&state->runLock, 0, 1) != 0)
+	{
+	  msecWait(0);
+	}
+
+      usz grainSampleCount = FILE_GRAIN_CHANNELS*state->grainLength;
+      for(u32 batchStart = 0; result && batchStart < batchCount; batchStart += state->maxBatchCount)
+	{
+	  u32 count = MIN(state->maxBatchCount, batchCount - batchStart);
+	  COPY_ARRAY(state->inputBuffer, inputData + batchStart*grainSampleCount, count*grainSampleCount, r32);
+	  result = onnxRunBatch(state, count);
+	  if(result)
+	    {
+	      COPY_ARRAY(outputData + batchStart*FILE_TAG_LENGTH, state->outputBuffer, count*FILE_TAG_LENGTH, r32);
+	    }
+	}
+
+      atomicStore(&state->runLock, 0);
+    }
+
+  return(result);
+}
+
+// NOTE: grains tagged per second through `platformRunModel`, at each batch size up to the session's
+static void
+onnxBenchmarkBatchSizes(u32 grainCount)
+{
+  OnnxState *state = &onnxState;
+  if(!state->session) return;
+
+  usz grainSampleCount = FILE_GRAIN_CHANNELS*state->grainLength;
+  usz inputSize = grainCount*grainSampleCount*sizeof(r32);
+  usz outputSize = grainCount*FILE_TAG_LENGTH*sizeof(r32);
+  r32 *input = (r32 *)platformAllocateMemory(inputSize);
+  r32 *output = (r32 *)platformAllocateMemory(outputSize);
+  for(usz i = 0; i < grainCount*grainSampleCount; ++i)
+    {
+      input[i] = gsSin(0.01f*(r32)i);
+    }
+
+  u64 timerFreq = getOSTimerFreq();
+  for(u32 batchCount = 1; batchCount <= state->maxBatchCount; batchCount *= 2)
+    {
+      u64 startTime = readOSTimer();
+      for(u32 grainIndex = 0; grainIndex < grainCount; grainIndex += batchCount)
+	{
+	  u32 count = MIN(batchCount, grainCount - grainIndex);
+	  platformRunModel(input + grainIndex*grainSampleCount, output + grainIndex*FILE_TAG_LENGTH,
+			   count, state->grainLength);
+	}
+      u64 elapsed = readOSTimer() - startTime;
+
+      r64 seconds = (r64)elapsed/(r64)timerFreq;
+      fprintf(stderr, "onnx batch %3u: %.1f grains/s\n", batchCount, (r64)grainCount/seconds);
+    }
+
+  platformFreeMemory(input, inputSize);
+  platformFreeMemory(output, outputSize);
+}
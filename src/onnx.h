@@ -1,25 +1,62 @@
 #include "onnxruntime_c_api.h"
 
+// NOTE: the model takes grains as [batch, FILE_GRAIN_CHANNELS, grainLength] and produces tags as
+//       [batch, FILE_TAG_LENGTH]. Everything that doesn't change between calls (names, memory info,
+//       the full-batch tensors and their binding) is created once, in `onnxInitializeState`
+#define ONNX_DEFAULT_BATCH_COUNT 32
+
+struct OnnxSettings
+{
+  u32 maxBatchCount;
+  u32 grainLength;
+
+  u32 intraOpThreadCount; // NOTE: threads a single operator can use. 0 lets the runtime decide
+  u32 interOpThreadCount; // NOTE: operators run at once. Above 1, the graph runs in parallel mode
+};
+
 struct OnnxState
 {
-  const OrtApiBase *apiBase;	 
+  const OrtApiBase *apiBase;
   const OrtApi *api;
   OrtEnv *env;
-  OrtSession *session;		 
+  OrtSession *session;
   OrtAllocator *sessionAllocator;
+
+  char *inputName;
+  char *outputName;
+  OrtMemoryInfo *memoryInfo;
+
+  u32 maxBatchCount;
+  u32 grainLength;
+
+  // NOTE: full batches run through the binding. Partial batches wrap the same buffers in
+  //       temporary tensors
+  r32 *inputBuffer;
+  r32 *outputBuffer;
+  OrtValue *inputTensor;
+  OrtValue *outputTensor;
+  OrtIoBinding *ioBinding;
+
+  // NOTE: the buffers and binding are shared, so callers on different threads (the packfile writer,
+  //       live tagging) take turns
+  volatile u32 runLock;
 };
 
 extern OnnxState onnxState;
 
-inline void
-ortPrintError(OrtStatus *status)
+// NOTE: returns true if there was an error
+inline b32
+ortPrintError(const OrtApi *api, OrtStatus *status)
 {
+  b32 result = (status != 0);
   if(status)
     {
-      OrtErrorCode errorCode = onnxState.api->GetErrorCode(status);
-      const char *errorMessage = onnxState.api->GetErrorMessage(status);
+      OrtErrorCode errorCode = api->GetErrorCode(status);
+      const char *errorMessage = api->GetErrorMessage(status);
       fprintf(stderr, "ERROR: ORT error: %d: %s\n", errorCode, errorMessage);
-	      
-      onnxState.api->ReleaseStatus(status);
+
+      api->ReleaseStatus(status);
     }
+
+  return(result);
 }
@@ -18,7 +18,8 @@ enum WindowType
     X(mix, 0.f, 1.f, 0.5f) \
     X(offset, 1.f, 40000.f, 1024.f)                            \
     X(pitch, 0.f, 0.f, 0.f)                            \
-    X(stretch, 0.f, 0.f, 0.f)
+    X(stretch, 0.f, 0.f, 0.f)                          \
+    X(reverb, 0.f, 1.f, 0.f)
 
 // Plugin Parameter enumeration to link with midi CC
 enum PluginParameterEnum
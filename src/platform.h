@@ -24,6 +24,8 @@ struct OSThread
 };
 
 static void threadCreate(OSThread *thread, BaseThreadProc *func, void *data);
+static void threadDetach(OSThread *thread);
+static u32 getProcessorCount(void);
 //static void threadStart(OSThread thread);
 
 static u32 atomicLoad(volatile u32 *src);
@@ -160,6 +162,23 @@ threadStart(OSThread thread)
 }
 #endif
 
+// NOTE: the thread keeps running, but can no longer be waited on
+static void
+threadDetach(OSThread *thread)
+{
+  CloseHandle(thread->handle);
+}
+
+static u32
+getProcessorCount(void)
+{
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+
+  u32 result = (u32)systemInfo.dwNumberOfProcessors;
+  return(result);
+}
+
 // TODO: test on windows
 static void
 threadDestroy(OSThread *thread)
@@ -241,8 +260,7 @@ atomicStore(volatile u32 *dest, u32 value)
 static u32
 atomicAdd(volatile u32 *addend, u32 value)
 {
-  u32 result = atomicLoad(addend);
-  InterlockedAdd((volatile LONG *)addend, value);
+  u32 result = (u32)InterlockedExchangeAdd((volatile LONG *)addend, (LONG)value);
 
   return(result);
 }
@@ -298,6 +316,8 @@ loadPluginCode(char *filename)
 	    (GS_AudioProcess *)GetProcAddress(result.pluginCode, "gsAudioProcess");
 	  result.pluginAPI.gsInitializePluginState =
 	    (GS_InitializePluginState *)GetProcAddress(result.pluginCode, "gsInitializePluginState");
+	  result.pluginAPI.gsShutdownPlugin =
+	    (GS_ShutdownPlugin *)GetProcAddress(result.pluginCode, "gsShutdownPlugin");
 	  result.isValid = (result.pluginAPI.gsRenderNewFrame &&
 			    result.pluginAPI.gsAudioProcess &&
 			    result.pluginAPI.gsInitializePluginState);
@@ -315,6 +335,7 @@ loadPluginCode(char *filename)
 	  result.pluginAPI.gsRenderNewFrame = 0;
 	  result.pluginAPI.gsAudioProcess = 0;
 	  result.pluginAPI.gsInitializePluginState = 0;
+	  result.pluginAPI.gsShutdownPlugin = 0;
 	}
     }
 
@@ -326,6 +347,7 @@ unloadPluginCode(PluginCode *code)
 {
   if(code->pluginCode)
     {
+      if(code->pluginAPI.gsShutdownPlugin) code->pluginAPI.gsShutdownPlugin();
       FreeLibrary(code->pluginCode);
       code->pluginCode = 0;
     }
@@ -334,6 +356,7 @@ unloadPluginCode(PluginCode *code)
   code->pluginAPI.gsRenderNewFrame = 0;
   code->pluginAPI.gsAudioProcess = 0;
   code->pluginAPI.gsInitializePluginState = 0;
+  code->pluginAPI.gsShutdownPlugin = 0;
 }
 
 //
@@ -437,6 +460,147 @@ platformWriteEntireFile(char *filename, Buffer file)
     }
 }
 
+// NOTE: maps a whole file read-only. Pages are read in lazily, on first touch, and every process
+//       (or plugin instance) that maps the same file shares its pages in the page cache
+static Buffer
+platformMapFile(char *filename)
+{
+  Buffer result = {};
+
+  HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0,
+				  OPEN_EXISTING, 0, 0);
+  if(fileHandle != INVALID_HANDLE_VALUE)
+    {
+      LARGE_INTEGER fileSize;
+      if(GetFileSizeEx(fileHandle, &fileSize) && fileSize.QuadPart > 0)
+	{
+	  HANDLE mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	  if(mappingHandle)
+	    {
+	      void *view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	      if(view)
+		{
+		  result.contents = (u8 *)view;
+		  result.size = s64FromLARGE_INTEGER(fileSize);
+		}
+	      else
+		{
+		  DWORD errorCode = GetLastError();
+		  char *errorMessage;
+		  FORMAT_ERROR_AS_STRING(errorCode, errorMessage);
+		  fprintf(stderr, "ERROR: MapViewOfFile failed: %s: %s\n", filename, errorMessage);
+		}
+
+	      // NOTE: the view keeps the mapping alive
+	      CloseHandle(mappingHandle);
+	    }
+	  else
+	    {
+	      DWORD errorCode = GetLastError();
+	      char *errorMessage;
+	      FORMAT_ERROR_AS_STRING(errorCode, errorMessage);
+	      fprintf(stderr, "ERROR: CreateFileMappingA failed: %s: %s\n", filename, errorMessage);
+	    }
+	}
+      else
+	{
+	  fprintf(stderr, "ERROR: can't map empty or unsized file: %s\n", filename);
+	}
+
+      CloseHandle(fileHandle);
+    }
+  else
+    {
+      DWORD errorCode = GetLastError();
+      char *errorMessage;
+      FORMAT_ERROR_AS_STRING(errorCode, errorMessage);
+      fprintf(stderr, "ERROR: CreateFileA failed: %s\n", errorMessage);
+    }
+
+  return(result);
+}
+
+static void
+platformUnmapFile(Buffer file)
+{
+  if(file.contents) UnmapViewOfFile(file.contents);
+}
+
+// NOTE: opens (or creates) a file for writing at arbitrary offsets. Without `truncate`, the
+//       existing contents are kept
+static GS_File
+platformOpenFileForWriting(char *filename, b32 truncate)
+{
+  GS_File result = 0;
+
+  HANDLE fileHandle = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0,
+				  truncate ? CREATE_ALWAYS : OPEN_ALWAYS, 0, 0);
+  if(fileHandle != INVALID_HANDLE_VALUE)
+    {
+      result = (GS_File)fileHandle;
+    }
+  else
+    {
+      DWORD errorCode = GetLastError();
+      char *errorMessage;
+      FORMAT_ERROR_AS_STRING(errorCode, errorMessage);
+      fprintf(stderr, "ERROR: CreateFileA failed: %s: %s\n", filename, errorMessage);
+    }
+
+  return(result);
+}
+
+static b32
+platformWriteFileAt(GS_File file, u64 offset, Buffer data)
+{
+  b32 result = true;
+
+  HANDLE fileHandle = (HANDLE)file;
+  u8 *src = data.contents;
+  usz bytesRemaining = data.size;
+  while(bytesRemaining)
+    {
+      OVERLAPPED overlapped = {};
+      overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+      overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+      DWORD bytesWritten = 0;
+      u32 bytesToWrite = safeTruncateU64(bytesRemaining);
+      if(WriteFile(fileHandle, src, bytesToWrite, &bytesWritten, &overlapped))
+	{
+	  src += bytesWritten;
+	  offset += bytesWritten;
+	  bytesRemaining -= bytesWritten;
+	}
+      else
+	{
+	  DWORD errorCode = GetLastError();
+	  char *errorMessage;
+	  FORMAT_ERROR_AS_STRING(errorCode, errorMessage);
+	  fprintf(stderr, "ERROR: WriteFile failed: %s\n", errorMessage);
+
+	  result = false;
+	  break;
+	}
+    }
+
+  return(result);
+}
+
+static void
+platformCloseFile(GS_File file)
+{
+  if(file) CloseHandle((HANDLE)file);
+}
+
+// NOTE: fails while the file is mapped, or open without FILE_SHARE_DELETE
+static b32
+platformRemoveFile(char *filename)
+{
+  b32 result = (DeleteFileA(filename) != 0);
+  return(result);
+}
+
 static String8
 platformGetPathToModule(void *handleToModule, void *functionInModule, Arena *allocator)
 {
@@ -473,6 +637,10 @@ platformGetPathToModule(void *handleToModule, void *functionInModule, Arena *all
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#if OS_LINUX
+#include <sys/inotify.h>
+#include <limits.h>
+#endif
 
 inline u64
 getOSTimerFreq(void)
@@ -565,6 +733,22 @@ threadCreate(OSThread *thread, BaseThreadProc *func, void *data)
     }
 }
 
+// NOTE: the thread keeps running, but its resources are released when it exits rather than on join
+static void
+threadDetach(OSThread *thread)
+{
+  pthread_detach((pthread_t)(uintptr_t)thread->handle);
+}
+
+static u32
+getProcessorCount(void)
+{
+  long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+  u32 result = (processorCount > 0) ? (u32)processorCount : 1;
+  return(result);
+}
+
 static void
 threadDestroy(OSThread *thread)
 {
@@ -646,7 +830,7 @@ atomicStore(volatile u32 *dest, u32 value)
 static u32
 atomicAdd(volatile u32 *addend, u32 value)
 {
-  return(__atomic_fetch_add(addend, value, __ATOMIC_ACQUIRE));
+  return(__atomic_fetch_add(addend, value, __ATOMIC_ACQ_REL));
 }
 
 static u32
@@ -702,6 +886,8 @@ loadPluginCode(char *filename)
 	    = (GS_AudioProcess*)dlsym(result.pluginCode, "gsAudioProcess");
 	  result.pluginAPI.gsInitializePluginState
 	    = (GS_InitializePluginState*)dlsym(result.pluginCode, "gsInitializePluginState");
+	  result.pluginAPI.gsShutdownPlugin
+	    = (GS_ShutdownPlugin*)dlsym(result.pluginCode, "gsShutdownPlugin");
 	  
 	  result.isValid = (result.pluginAPI.gsRenderNewFrame &&
 			    result.pluginAPI.gsAudioProcess &&
@@ -718,6 +904,7 @@ loadPluginCode(char *filename)
       result.pluginAPI.gsRenderNewFrame	       = 0;
       result.pluginAPI.gsAudioProcess	       = 0;
       result.pluginAPI.gsInitializePluginState = 0;
+      result.pluginAPI.gsShutdownPlugin	       = 0;
     }
 
   return(result);
@@ -728,6 +915,7 @@ unloadPluginCode(PluginCode *code)
 {
   if(code->pluginCode)
     {
+      if(code->pluginAPI.gsShutdownPlugin) code->pluginAPI.gsShutdownPlugin();
       if(dlclose(code->pluginCode) != 0)
 	{
 	  fprintf(stderr, "ERROR: dlclose failed: %s\n", dlerror());
@@ -739,6 +927,7 @@ unloadPluginCode(PluginCode *code)
   code->pluginAPI.gsRenderNewFrame	  = 0;
   code->pluginAPI.gsAudioProcess	  = 0;
   code->pluginAPI.gsInitializePluginState = 0;
+  code->pluginAPI.gsShutdownPlugin	  = 0;
 }
 
 //
@@ -839,6 +1028,116 @@ platformWriteEntireFile(char *filename, Buffer file)
     }
 }
 
+// NOTE: maps a whole file read-only. Pages are read in lazily, on first touch, and every process
+//       (or plugin instance) that maps the same file shares its pages in the page cache
+static Buffer
+platformMapFile(char *filename)
+{
+  Buffer result = {};
+
+  int fileHandle = open(filename, O_RDONLY);
+  if(fileHandle != -1)
+    {
+      struct stat fileStatus;
+      if(fstat(fileHandle, &fileStatus) != -1 && fileStatus.st_size > 0)
+	{
+	  void *mapping = mmap(0, fileStatus.st_size, PROT_READ, MAP_SHARED, fileHandle, 0);
+	  if(mapping != MAP_FAILED)
+	    {
+	      result.contents = (u8 *)mapping;
+	      result.size = fileStatus.st_size;
+	    }
+	  else
+	    {
+	      fprintf(stderr, "ERROR: mmap failed: %s: %s\n", filename, strerror(errno));
+	    }
+	}
+      else
+	{
+	  fprintf(stderr, "ERROR: can't map empty or unsized file: %s\n", filename);
+	}
+
+      // NOTE: the mapping stays valid after the descriptor is closed
+      close(fileHandle);
+    }
+  else
+    {
+      fprintf(stderr, "ERROR: open failed: %s: %s\n", filename, strerror(errno));
+    }
+
+  return(result);
+}
+
+static void
+platformUnmapFile(Buffer file)
+{
+  if(file.contents) munmap(file.contents, file.size);
+}
+
+// NOTE: opens (or creates) a file for writing at arbitrary offsets. Without `truncate`, the
+//       existing contents are kept. The handle is the descriptor plus one, so that 0 means failure
+static GS_File
+platformOpenFileForWriting(char *filename, b32 truncate)
+{
+  GS_File result = 0;
+
+  int flags = O_CREAT | O_RDWR | (truncate ? O_TRUNC : 0);
+  int fileHandle = open(filename, flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if(fileHandle != -1)
+    {
+      result = (GS_File)((usz)fileHandle + 1);
+    }
+  else
+    {
+      fprintf(stderr, "ERROR: open %s failed: %s\n", filename, strerror(errno));
+    }
+
+  return(result);
+}
+
+static b32
+platformWriteFileAt(GS_File file, u64 offset, Buffer data)
+{
+  b32 result = true;
+
+  int fileHandle = (int)((usz)file - 1);
+  u8 *src = data.contents;
+  usz bytesRemaining = data.size;
+  while(bytesRemaining)
+    {
+      u32 bytesToWrite = safeTruncateU64(bytesRemaining);
+      ssize_t bytesWritten = pwrite(fileHandle, src, bytesToWrite, (off_t)offset);
+      if(bytesWritten == -1)
+	{
+	  fprintf(stderr, "ERROR: pwrite failed: %s\n", strerror(errno));
+	  result = false;
+	  break;
+	}
+      else
+	{
+	  src += bytesWritten;
+	  offset += bytesWritten;
+	  bytesRemaining -= bytesWritten;
+	}
+    }
+
+  return(result);
+}
+
+static void
+platformCloseFile(GS_File file)
+{
+  if(file) close((int)((usz)file - 1));
+}
+
+// NOTE: existing mappings of the file stay valid
+static b32
+platformRemoveFile(char *filename)
+{
+  b32 result = (unlink(filename) == 0);
+  return(result);
+}
+
 static String8
 platformGetPathToModule(void *handleToModule, void *functionInModule, Arena *allocator)
 {
@@ -878,6 +1177,152 @@ platformGetCurrentTimestamp(void)
   return(readOSTimer());
 }
 
+// NOTE: the plugin never joins the threads it starts (it tells them to finish through its own
+//       state), so they're detached, and the thread record is left to outlive the thread
+static b32
+platformStartThread(BaseThreadProc *proc, void *data)
+{
+  OSThread *thread = (OSThread *)platformAllocateMemory(sizeof(OSThread));
+  b32 result = (thread != 0);
+  if(result)
+    {
+      threadCreate(thread, proc, data);
+      result = (thread->handle != 0);
+      if(result)
+	{
+	  threadDetach(thread);
+	}
+    }
+
+  return(result);
+}
+
+static void
+platformSleep(u32 msecsToWait)
+{
+  msecWait(msecsToWait);
+}
+
+//
+// file watching
+//
+
+// NOTE: the host watches the plugin's code, to reload it when it's rebuilt. On linux, inotify
+//       reports writes to the file's directory, and the ones naming the file count. Elsewhere, or
+//       without inotify, the file's write time is compared at most every FILE_WATCH_POLL_MSEC
+#define FILE_WATCH_POLL_MSEC 250
+
+struct FileWatcher
+{
+  char *filename;
+  u64 lastWriteTime;
+  u64 lastPollTime;
+
+#if OS_LINUX
+  int notifyHandle; // NOTE: -1 when polling
+  char *name;       // NOTE: the filename past its directory
+#endif
+};
+
+static FileWatcher
+beginWatchingFile(char *filename)
+{
+  FileWatcher result = {};
+  result.filename = filename;
+  result.lastWriteTime = getLastWriteTimeU64(filename);
+  result.lastPollTime = readOSTimer();
+
+#if OS_LINUX
+  result.name = filename;
+  for(char *at = filename; *at; ++at)
+    {
+      if(*at == '/') result.name = at + 1;
+    }
+
+  char directory[PATH_MAX] = ".";
+  usz directorySize = result.name - filename;
+  if(directorySize && directorySize < ARRAY_COUNT(directory))
+    {
+      COPY_SIZE(directory, filename, directorySize);
+      directory[directorySize] = 0;
+    }
+
+  result.notifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(result.notifyHandle != -1)
+    {
+      if(inotify_add_watch(result.notifyHandle, directory, IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+	{
+	  fprintf(stderr, "ERROR: inotify_add_watch failed for %s: %s\n", directory, strerror(errno));
+	  close(result.notifyHandle);
+	  result.notifyHandle = -1;
+	}
+    }
+#endif
+
+  return(result);
+}
+
+static b32
+fileWasWritten(FileWatcher *watcher)
+{
+  b32 result = false;
+
+#if OS_LINUX
+  if(watcher->notifyHandle != -1)
+    {
+      union
+      {
+	struct inotify_event event;
+	u8 bytes[4096];
+      } events;
+
+      for(;;)
+	{
+	  ssize_t readSize = read(watcher->notifyHandle, events.bytes, sizeof(events.bytes));
+	  if(readSize <= 0) break;
+
+	  for(u8 *at = events.bytes; at < events.bytes + readSize;)
+	    {
+	      struct inotify_event *event = (struct inotify_event *)at;
+	      // NOTE: events that were dropped could have been for the file
+	      if((event->mask & IN_Q_OVERFLOW) ||
+		 (event->len && strcmp(event->name, watcher->name) == 0))
+		{
+		  result = true;
+		}
+	      at += sizeof(struct inotify_event) + event->len;
+	    }
+	}
+    }
+  else
+#endif
+    {
+      u64 now = readOSTimer();
+      if(now - watcher->lastPollTime >= FILE_WATCH_POLL_MSEC*getOSTimerFreq()/1000)
+	{
+	  watcher->lastPollTime = now;
+	  u64 writeTime = getLastWriteTimeU64(watcher->filename);
+	  result = (writeTime != watcher->lastWriteTime);
+	  watcher->lastWriteTime = writeTime;
+	}
+    }
+
+  return(result);
+}
+
+static void
+endWatchingFile(FileWatcher *watcher)
+{
+#if OS_LINUX
+  if(watcher->notifyHandle != -1)
+    {
+      close(watcher->notifyHandle);
+      watcher->notifyHandle = -1;
+    }
+#endif
+  UNUSED(watcher);
+}
+
 #if 0
 inline u64
 estimateCPUCyclesPerSecond(void)
@@ -4,6 +4,7 @@
   X(RenderNewFrame, void, (PluginMemory *memory, PluginInput *input, RenderCommands *renderCommands))\
   X(AudioProcess, void, (PluginMemory *memory, PluginAudioBuffer *audioBuffer))\
   X(InitializePluginState, PluginState*, (PluginMemory *memoryBlock))\
+  X(ShutdownPlugin, void, (void))\
 
 struct PluginState;
 #define X(name, ret, args) typedef ret GS_##name args;
@@ -136,10 +136,17 @@
 
 #include "midi.cpp"
 #include "ui_layout.cpp"
-//#include "file_granulator.cpp"
+#include "file_granulator.cpp"
+#include "sample_cache.cpp"
 #include "internal_granulator.cpp"
+#include "disk_recorder.cpp"
+#include "render_software.cpp"
 
 #if BUILD_TESTING
+// NOTE: the tests build their own plugin states, and frames from them
+static PluginState *initializePluginState(PluginMemory *memoryBlock);
+static void releasePluginState(PluginState *pluginState);
+static void pluginRenderNewFrame(PluginState *pluginState, PluginInput *input, RenderCommands *renderCommands);
 #  include "tests.cpp"
 #endif
 
@@ -157,219 +164,347 @@ printButtonState(ButtonState button, char *name)
 
 static PluginState *globalPluginState = 0;
 
-EXPORT_FUNCTION PluginState*
-gsInitializePluginState(PluginMemory *memoryBlock)
+#if FINGERTIPS
+// NOTE: shared by every plugin state in the process, since the index is only guarded in-process
+#  define FINGERTIPS_CACHE_DIRECTORY DATA_PATH"cache/"
+static SampleCache globalSampleCache = {
+  {(u8 *)FINGERTIPS_CACHE_DIRECTORY, sizeof(FINGERTIPS_CACHE_DIRECTORY) - 1},
+  SAMPLE_CACHE_DEFAULT_MAX_SIZE, SAMPLE_CACHE_MAX_ENTRY_COUNT, 0, {}};
+#endif
+
+// NOTE: there is no impulse response asset yet, so the reverb convolves with exponentially
+//       decaying noise. Each channel gets its own seed, for a decorrelated (wide) tail
+#define REVERB_IMPULSE_SECONDS 2
+#define REVERB_DECAY_SECONDS 1.6f
+
+static void
+synthesizeReverbImpulse(r32 *dest, u32 count, u32 seed)
 {
-  PluginState *pluginState = 0;
-  if(!globalPluginState)
+  r32 decayPerSample = gsPow(0.001f, 1.f/(REVERB_DECAY_SECONDS*INTERNAL_SAMPLE_RATE));
+  r32 gain = 1.f;
+  r32 energy = 0.f;
+  u32 x = seed;
+  for(u32 i = 0; i < count; ++i)
     {
-      //globalPlatform = memoryBlock->platformAPI;
-#if !defined(HOST_LAYER)
-#define X(name, ret, args) gs##name = memoryBlock->platformAPI.gs##name;
-      PLATFORM_API_XLIST
-#undef X
-#endif
+      // NOTE: xorshift32
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      r32 noise = 2.f*((r32)(x >> 8)/(r32)(1 << 24)) - 1.f;
+
+      dest[i] = gain*noise;
+      energy += dest[i]*dest[i];
+      gain *= decayPerSample;
+    }
 
-#if BUILD_LOGGING
-      globalLogger = memoryBlock->logger;
-#endif
+  // NOTE: unit energy, so the wet signal is about as loud as the dry signal
+  r32 normalization = 1.f/gsSqrt(energy);
+  for(u32 i = 0; i < count; ++i)
+    {
+      dest[i] *= normalization;
+    }
+}
 
-      Arena *permanentArena = gsArenaAcquire(MEGABYTES(1));
-      pluginState = arenaPushStruct(permanentArena, PluginState);
-      pluginState->permanentArena = permanentArena;
+// NOTE: creates a fresh, fully isolated plugin state. Hosts that only ever need one
+//       instance go through `gsInitializePluginState`, which caches the result in
+//       `globalPluginState`; statically-linked hosts (e.g. the batch renderer) can call
+//       this directly to run several independent instances side by side
+static PluginState*
+initializePluginState(PluginMemory *memoryBlock)
+{
+  Arena *permanentArena = gsArenaAcquire(MEGABYTES(1));
+  PluginState *pluginState = arenaPushStruct(permanentArena, PluginState);
+  pluginState->permanentArena = permanentArena;
 
-      pluginState->osTimerFreq = memoryBlock->osTimerFreq;
-      pluginState->pluginHost = memoryBlock->host;
-      pluginState->pluginMode = PluginMode_editor;
+  pluginState->osTimerFreq = memoryBlock->osTimerFreq;
+  pluginState->pluginHost = memoryBlock->host;
+  pluginState->pluginMode = PluginMode_editor;
 
-      // TODO: maybe these initial sizes can be tuned for fewer allocation calls
-      pluginState->frameArena = gsArenaAcquire(MEGABYTES(1));
-      //pluginState->framePermanentArena = gsArenaAcquire(0);
-      pluginState->audioArena = gsArenaAcquire(MEGABYTES(1));
+  // TODO: maybe these initial sizes can be tuned for fewer allocation calls
+  pluginState->frameArena = gsArenaAcquire(MEGABYTES(1));
+  //pluginState->framePermanentArena = gsArenaAcquire(0);
+  pluginState->audioArena = gsArenaAcquire(MEGABYTES(1));
 
-      if(pluginState->pluginHost == PluginHost_executable ||
-         pluginState->pluginHost == PluginHost_daw)
-        {
-          pluginState->pathToPlugin =
-            gsGetPathToModule(memoryBlock->pluginHandle, (void *)gsInitializePluginState,
-                              pluginState->permanentArena);
-        }
-      // NOTE: parameter initialization
-      // pluginState->phasor = 0.f;
-      pluginState->freq = 440.f;
+  if(pluginState->pluginHost == PluginHost_executable ||
+     pluginState->pluginHost == PluginHost_daw)
+    {
+      pluginState->pathToPlugin =
+        gsGetPathToModule(memoryBlock->pluginHandle, (void *)initializePluginState,
+                          pluginState->permanentArena);
+    }
+  // NOTE: parameter initialization
+  // pluginState->phasor = 0.f;
+  pluginState->freq = 440.f;
 
-      initializeFloatParameter(&pluginState->parameters[PluginParameter_volume],
-                               pluginParameterInitData[PluginParameter_volume], decibelsToAmplitude);
+  initializeFloatParameter(&pluginState->parameters[PluginParameter_volume],
+                           pluginParameterInitData[PluginParameter_volume], decibelsToAmplitude);
 
-      initializeFloatParameter(&pluginState->parameters[PluginParameter_density],
-                               pluginParameterInitData[PluginParameter_density], densityTransform);
+  initializeFloatParameter(&pluginState->parameters[PluginParameter_density],
+                           pluginParameterInitData[PluginParameter_density], densityTransform);
 
-      //avail range: [0, 3], default value: 0
-      initializeFloatParameter(&pluginState->parameters[PluginParameter_window],
-                               pluginParameterInitData[PluginParameter_window]);
+  //avail range: [0, 3], default value: 0
+  initializeFloatParameter(&pluginState->parameters[PluginParameter_window],
+                           pluginParameterInitData[PluginParameter_window]);
 
-      //avail range: [0, 16000], default value: 2600
-      initializeFloatParameter(&pluginState->parameters[PluginParameter_size],
-                               pluginParameterInitData[PluginParameter_size]);
+  //avail range: [0, 16000], default value: 2600
+  initializeFloatParameter(&pluginState->parameters[PluginParameter_size],
+                           pluginParameterInitData[PluginParameter_size]);
 
-      initializeFloatParameter(&pluginState->parameters[PluginParameter_spread],
-                               pluginParameterInitData[PluginParameter_spread]);
+  initializeFloatParameter(&pluginState->parameters[PluginParameter_spread],
+                           pluginParameterInitData[PluginParameter_spread]);
 
-      initializeFloatParameter(&pluginState->parameters[PluginParameter_mix],
-                               pluginParameterInitData[PluginParameter_mix]);
+  initializeFloatParameter(&pluginState->parameters[PluginParameter_mix],
+                           pluginParameterInitData[PluginParameter_mix]);
 
-      initializeFloatParameter(&pluginState->parameters[PluginParameter_pan],
-                               pluginParameterInitData[PluginParameter_pan]);
+  initializeFloatParameter(&pluginState->parameters[PluginParameter_pan],
+                           pluginParameterInitData[PluginParameter_pan]);
 
-      initializeFloatParameter(&pluginState->parameters[PluginParameter_offset],
-                               pluginParameterInitData[PluginParameter_offset]);
+  initializeFloatParameter(&pluginState->parameters[PluginParameter_offset],
+                           pluginParameterInitData[PluginParameter_offset]);
 
+  initializeFloatParameter(&pluginState->parameters[PluginParameter_reverb],
+                           pluginParameterInitData[PluginParameter_reverb]);
 
-      // NOTE: devices
-      pluginState->outputDeviceCount = memoryBlock->outputDeviceCount;
-      pluginState->selectedOutputDeviceIndex = memoryBlock->selectedOutputDeviceIndex;
-      for(u32 i = 0; i < pluginState->outputDeviceCount; ++i)
-        {
-          pluginState->outputDeviceNames[i] =
-            arenaPushString(pluginState->permanentArena, memoryBlock->outputDeviceNames[i]);
-        }
 
-      pluginState->inputDeviceCount = memoryBlock->inputDeviceCount;
-      pluginState->selectedInputDeviceIndex = memoryBlock->selectedInputDeviceIndex;
-      for(u32 i = 0; i < pluginState->inputDeviceCount; ++i)
-        {
-          pluginState->inputDeviceNames[i] =
-            arenaPushString(pluginState->permanentArena, memoryBlock->inputDeviceNames[i]);
-        }
+  // NOTE: devices
+  pluginState->outputDeviceCount = memoryBlock->outputDeviceCount;
+  pluginState->selectedOutputDeviceIndex = memoryBlock->selectedOutputDeviceIndex;
+  for(u32 i = 0; i < pluginState->outputDeviceCount; ++i)
+    {
+      pluginState->outputDeviceNames[i] =
+        arenaPushString(pluginState->permanentArena, memoryBlock->outputDeviceNames[i]);
+    }
+
+  pluginState->inputDeviceCount = memoryBlock->inputDeviceCount;
+  pluginState->selectedInputDeviceIndex = memoryBlock->selectedInputDeviceIndex;
+  for(u32 i = 0; i < pluginState->inputDeviceCount; ++i)
+    {
+      pluginState->inputDeviceNames[i] =
+        arenaPushString(pluginState->permanentArena, memoryBlock->inputDeviceNames[i]);
+    }
+
+  // NOTE: input/output stream initialization
+  {
+    pluginState->inputStream.stream.refill = mixInputSamples;
+    pluginState->inputStream.pluginState = pluginState;
+    pluginState->inputStream.clone = &pluginState->inputStreamClone;
+
+    pluginState->outputStream.stream.refill = mixOutputSamples;
+    pluginState->outputStream.inputSource = &pluginState->inputStreamClone;
+    pluginState->outputStream.grainSource = &pluginState->convolutionStream.stream;
+    pluginState->outputStream.pluginState = pluginState;
+  }
+
+  // NOTE: grain buffer initialization
+  pluginState->grainManager = initializeGrainManager(pluginState);
 
-      // NOTE: input/output stream initialization
+  // NOTE: bouncing to disk. Only the standalone host has a way to start a recording (ctrl+r), and
+  //       the recorder's ring and chunks take a few MB, so the other hosts go without
+  if(pluginState->pluginHost == PluginHost_executable)
+    {
+      pluginState->diskRecorder = diskRecorderCreate(pluginState->permanentArena);
+    }
+
+  // NOTE: reverb initialization
+  {
+    ConvolutionStream *convolutionStream = &pluginState->convolutionStream;
+    convolutionStream->stream.refill = convolveGrainSamples;
+    convolutionStream->source = &pluginState->grainManager.stream;
+    convolutionStream->pluginState = pluginState;
+
+    // NOTE: 256-sample partitions near the head of the impulse keep the added latency low (it only
+    //       delays the wet signal), and the tail is taken in 4096-sample partitions
+    u32 impulseCount = REVERB_IMPULSE_SECONDS*INTERNAL_SAMPLE_RATE;
+    TemporaryMemory scratch = arenaGetScratch(0, 0);
+    r32 *impulse = arenaPushArray(scratch.arena, impulseCount, r32);
+    for(u32 channelIndex = 0; channelIndex < ARRAY_COUNT(convolutionStream->convolvers); ++channelIndex)
       {
-        pluginState->inputStream.stream.refill = mixInputSamples;
-        pluginState->inputStream.pluginState = pluginState;
-        pluginState->inputStream.clone = &pluginState->inputStreamClone;
-
-        pluginState->outputStream.stream.refill = mixOutputSamples;
-        pluginState->outputStream.inputSource = &pluginState->inputStreamClone;
-        pluginState->outputStream.grainSource = &pluginState->grainManager.stream;
-        pluginState->outputStream.pluginState = pluginState;
+        synthesizeReverbImpulse(impulse, impulseCount, 0x9E3779B9u*(channelIndex + 1));
+        convolutionStream->convolvers[channelIndex] =
+          convolverCreate(pluginState->permanentArena, impulse, impulseCount, 256, 4096);
       }
+    arenaReleaseScratch(scratch);
+  }
 
-      // NOTE: grain buffer initialization
-      pluginState->grainManager = initializeGrainManager(pluginState);
-
-      // NOTE: grain view initialization
-      GrainStateView *grainStateView = &pluginState->grainStateView;
-      grainStateView->viewWriteIndex = 1;
-      grainStateView->viewBufferCount = pluginState->grainManager.grainBufferCount;
-      grainStateView->viewBufferSamples =
-        arenaPushArray(pluginState->permanentArena, pluginState->grainManager.grainBufferCount,
-                       SamplePair, arenaFlagsNoZeroAlign(4*sizeof(SamplePair)));
-      grainStateView->viewBufferReadIndex = 0;
-      grainStateView->viewBufferWriteIndex = 1;
-
-      u32 grainViewSampleCapacity = 4096;
-      for(u32 i = 0; i < ARRAY_COUNT(grainStateView->views); ++i)
-        {
-          GrainBufferViewEntry *view = grainStateView->views + i;
-          view->sampleCapacity = grainViewSampleCapacity;
-          view->bufferSamples =
-            arenaPushArray(pluginState->permanentArena, grainViewSampleCapacity, SamplePair);
-        }
+  // NOTE: grain view initialization
+  GrainStateView *grainStateView = &pluginState->grainStateView;
+  grainStateView->viewWriteIndex = 1;
+  grainStateView->viewBufferCount = pluginState->grainManager.grainBufferCount;
+  grainStateView->viewBufferSamples =
+    arenaPushArray(pluginState->permanentArena, pluginState->grainManager.grainBufferCount,
+                   SamplePair, arenaFlagsNoZeroAlign(4*sizeof(SamplePair)));
+  grainStateView->viewBufferReadIndex = 0;
+  grainStateView->viewBufferWriteIndex = 1;
+
+  u32 grainViewSampleCapacity = 4096;
+  for(u32 i = 0; i < ARRAY_COUNT(grainStateView->views); ++i)
+    {
+      GrainBufferViewEntry *view = grainStateView->views + i;
+      view->sampleCapacity = grainViewSampleCapacity;
+      view->bufferSamples =
+        arenaPushArray(pluginState->permanentArena, grainViewSampleCapacity, SamplePair);
+    }
 
-      // NOTE: file loading, embedded grain caching
-      pluginState->soundIsPlaying.value = false;
+  // NOTE: file loading, embedded grain caching
+  pluginState->soundIsPlaying.value = false;
 #if FINGERTIPS
-      pluginState->loadedSound.sound =
-        loadWav(pluginState->permanentArena, STR8_LIT(DATA_PATH"fingertips.wav"));
-      pluginState->loadedSound.samplesPlayed = 0;// + pluginState->start_pos);
+  pluginState->loadedSoundCache =
+    sampleCacheLoadWav(&globalSampleCache, pluginState->permanentArena, STR8_LIT(DATA_PATH"fingertips.wav"));
+  pluginState->loadedSound.sound = pluginState->loadedSoundCache.sound;
+  pluginState->loadedSound.samplesPlayed = 0;// + pluginState->start_pos);
 #endif
 
 #if 0
-      char *fingertipsPackfilename = "../data/fingertips.grains";
-      TemporaryMemory packfileMemory = arenaBeginTemporaryMemory(&pluginState->loadArena, MEGABYTES(64));
-      GrainPackfile fingertipsGrains = beginGrainPackfile((Arena *)&packfileMemory);
-      addSoundToGrainPackfile(&fingertipsGrains, &pluginState->loadedSound.sound);
-      writePackfileToDisk(&fingertipsGrains, fingertipsPackfilename);
-      arenaEndTemporaryMemory(&packfileMemory);
-
-      pluginState->loadedGrainPackfile = loadGrainPackfile(fingertipsPackfilename,
-                                                           &pluginState->permanentArena);
-      pluginState->silo = initializeFileGrainState(&pluginState->permanentArena);
+  char *fingertipsPackfilename = "../data/fingertips.grains";
+  TemporaryMemory packfileMemory = arenaBeginTemporaryMemory(&pluginState->loadArena, MEGABYTES(64));
+  GrainPackfile fingertipsGrains = beginGrainPackfile((Arena *)&packfileMemory);
+  addSoundToGrainPackfile(&fingertipsGrains, &pluginState->loadedSound.sound);
+  writePackfileToDisk(&fingertipsGrains, fingertipsPackfilename);
+  arenaEndTemporaryMemory(&packfileMemory);
+
+  pluginState->loadedGrainPackfile = loadGrainPackfile(fingertipsPackfilename,
+                                                       &pluginState->permanentArena);
+  pluginState->silo = initializeFileGrainState(&pluginState->permanentArena);
 #endif
 
 #define X(name) pluginState->name = PLUGIN_ASSET(name);
-      PLUGIN_ASSET_XLIST;
+  PLUGIN_ASSET_XLIST;
 #undef X
 
-      pluginState->agencyBold = &fontAgencyBold;
-
-      // NOTE: ui initialization
-      pluginState->uiContext =
-        uiInitializeContext(pluginState->frameArena, pluginState->permanentArena,
-                            pluginState->agencyBold);
-
-      // TODO: our editor interface doesn't use resizable panels,
-      //       so it doesn't make sense to still be using them
-      pluginState->rootPanel =
-        arenaPushStruct(pluginState->permanentArena, UIPanel,
-                        arenaFlagsZeroNoAlign());
-      pluginState->rootPanel->sizePercentOfParent = 1.f;
-      pluginState->rootPanel->splitAxis = UIAxis_y;
-      pluginState->rootPanel->name = STR8_LIT("editor");
-      pluginState->rootPanel->color = V4(1, 1, 1, 1);
-      pluginState->rootPanel->texture = pluginState->editorSkin;
-      //pluginState->rootPanel->texture = &pluginState->editorReferenceLayout;
-
-      pluginState->menuPanel = arenaPushStruct(pluginState->permanentArena, UIPanel,
-                                               arenaFlagsZeroNoAlign());
-      pluginState->menuPanel->sizePercentOfParent = 1.f;
-      pluginState->menuPanel->splitAxis = UIAxis_x;
-
-      v4 menuBackgroundColor = colorV4FromU32(0x080C1CFF);
-      UIPanel *currentParentPanel = pluginState->menuPanel;
-      UIPanel *menuLeft = makeUIPanel(currentParentPanel, pluginState->permanentArena,
-                                      UIAxis_x, 0.5f, STR8_LIT("menu left"),
-                                      pluginState->null, menuBackgroundColor);
-      UIPanel *menuRight = makeUIPanel(currentParentPanel, pluginState->permanentArena,
-                                       UIAxis_x, 0.5f, STR8_LIT("menu right"),
-                                       pluginState->null, menuBackgroundColor);
-      UNUSED(menuLeft);
-      UNUSED(menuRight);
-
-      pluginState->mouseTooltipLayout = 0;
+  pluginState->agencyBold = &fontAgencyBold;
+
+  // NOTE: ui initialization
+  pluginState->uiContext =
+    uiInitializeContext(pluginState->frameArena, pluginState->permanentArena,
+                        pluginState->agencyBold);
+
+  // TODO: our editor interface doesn't use resizable panels,
+  //       so it doesn't make sense to still be using them
+  pluginState->rootPanel =
+    arenaPushStruct(pluginState->permanentArena, UIPanel,
+                    arenaFlagsZeroNoAlign());
+  pluginState->rootPanel->sizePercentOfParent = 1.f;
+  pluginState->rootPanel->splitAxis = UIAxis_y;
+  pluginState->rootPanel->name = STR8_LIT("editor");
+  pluginState->rootPanel->color = V4(1, 1, 1, 1);
+  pluginState->rootPanel->texture = pluginState->editorSkin;
+  //pluginState->rootPanel->texture = &pluginState->editorReferenceLayout;
+
+  pluginState->menuPanel = arenaPushStruct(pluginState->permanentArena, UIPanel,
+                                           arenaFlagsZeroNoAlign());
+  pluginState->menuPanel->sizePercentOfParent = 1.f;
+  pluginState->menuPanel->splitAxis = UIAxis_x;
+
+  v4 menuBackgroundColor = colorV4FromU32(0x080C1CFF);
+  UIPanel *currentParentPanel = pluginState->menuPanel;
+  UIPanel *menuLeft = makeUIPanel(currentParentPanel, pluginState->permanentArena,
+                                  UIAxis_x, 0.5f, STR8_LIT("menu left"),
+                                  pluginState->null, menuBackgroundColor);
+  UIPanel *menuRight = makeUIPanel(currentParentPanel, pluginState->permanentArena,
+                                   UIAxis_x, 0.5f, STR8_LIT("menu right"),
+                                   pluginState->null, menuBackgroundColor);
+  UNUSED(menuLeft);
+  UNUSED(menuRight);
+
+  pluginState->mouseTooltipLayout = 0;
 
 #if 0
 #if 1
-      r32 *testModelInput = pluginState->loadedSound.sound.samples[0];
-      //s64 testModelInputSampleCount = pluginState->loadedSound.sound.sampleCount;
-      s64 testModelInputSampleCount = 2400; // TODO: feed the whole file
+  r32 *testModelInput = pluginState->loadedSound.sound.samples[0];
+  //s64 testModelInputSampleCount = pluginState->loadedSound.sound.sampleCount;
+  s64 testModelInputSampleCount = 2400; // TODO: feed the whole file
 #else
-      ReadFileResult testInputFile = globalPlatform.readEntireFile(DATA_PATH"/test_input.data",
-                                                                   &pluginState->permanentArena);
-      ReadFileResult testOutputFile = globalPlatform.readEntireFile(DATA_PATH"/test_output.data",
-                                                                    &pluginState->permanentArena);
-      r32 *testModelInput = (r32 *)testInputFile.contents;
-      s64 testModelInputSampleCount = (testInputFile.contentsSize - 1)/(2*sizeof(r32));
+  ReadFileResult testInputFile = globalPlatform.readEntireFile(DATA_PATH"/test_input.data",
+                                                               &pluginState->permanentArena);
+  ReadFileResult testOutputFile = globalPlatform.readEntireFile(DATA_PATH"/test_output.data",
+                                                                &pluginState->permanentArena);
+  r32 *testModelInput = (r32 *)testInputFile.contents;
+  s64 testModelInputSampleCount = (testInputFile.contentsSize - 1)/(2*sizeof(r32));
+#endif
+  void *outputData = globalPlatform.runModel(testModelInput, testModelInputSampleCount);
+  r32 *outputFloat = (r32 *)outputData;
+#endif
+
+  pluginState->initialized = true;
+  return(pluginState);
+}
+
+static void
+releasePluginState(PluginState *pluginState)
+{
+  if(pluginState->diskRecorder) diskRecorderStopAndWait(pluginState->diskRecorder);
+#if FINGERTIPS
+  sampleCacheRelease(&pluginState->loadedSoundCache);
+#endif
+
+  arenaEnd(pluginState->frameArena);
+  gsArenaDiscard(pluginState->frameArena);
+
+  arenaEnd(pluginState->audioArena);
+  gsArenaDiscard(pluginState->audioArena);
+
+  // NOTE: the state itself lives in the permanent arena, so this has to go last
+  Arena *permanentArena = pluginState->permanentArena;
+  arenaEnd(permanentArena);
+  gsArenaDiscard(permanentArena);
+}
+
+EXPORT_FUNCTION PluginState*
+gsInitializePluginState(PluginMemory *memoryBlock)
+{
+  PluginState *pluginState = 0;
+  if(!globalPluginState)
+    {
+      //globalPlatform = memoryBlock->platformAPI;
+#if !defined(HOST_LAYER)
+#define X(name, ret, args) gs##name = memoryBlock->platformAPI.gs##name;
+      PLATFORM_API_XLIST
+#undef X
 #endif
-      void *outputData = globalPlatform.runModel(testModelInput, testModelInputSampleCount);
-      r32 *outputFloat = (r32 *)outputData;
+
+#if BUILD_LOGGING
+      globalLogger = memoryBlock->logger;
 #endif
 
+      pluginState = initializePluginState(memoryBlock);
+
 #if BUILD_TESTING
       testRun();
 #endif
 
-      pluginState->initialized = true;
       globalPluginState = pluginState;
     }
   return(pluginState);
 }
 
-EXPORT_FUNCTION void
-gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *renderCommands)
+static u64
+pluginHashFrameSignature(PluginState *pluginState, RenderCommands *renderCommands)
 {
-  gsInitializePluginState(memory);
-  if(globalPluginState)
+  FrameSignature signature = {};
+  signature.widthInPixels = renderCommands->widthInPixels;
+  signature.heightInPixels = renderCommands->heightInPixels;
+  signature.pluginMode = pluginState->pluginMode;
+
+  signature.outputDeviceCount = pluginState->outputDeviceCount;
+  signature.selectedOutputDeviceIndex = pluginState->selectedOutputDeviceIndex;
+  signature.inputDeviceCount = pluginState->inputDeviceCount;
+  signature.selectedInputDeviceIndex = pluginState->selectedInputDeviceIndex;
+
+  signature.soundIsPlaying = pluginReadBooleanParameter(&pluginState->soundIsPlaying);
+  for(u32 parameterIndex = 0; parameterIndex < PluginParameter_count; ++parameterIndex)
+    {
+      signature.parameterValues[parameterIndex] =
+        gsAtomicLoad(&pluginState->parameters[parameterIndex].currentValue.asInt);
+    }
+
+  u64 result = grainPackfileChecksum(GRAIN_PACKFILE_CHECKSUM_SEED, (u8 *)&signature, sizeof(signature));
+  return(result);
+}
+
+static void
+pluginRenderNewFrame(PluginState *pluginState, PluginInput *input, RenderCommands *renderCommands)
+{
+  if(pluginState)
     {
       // NOTE: DEBUG
 #if OS_WASM && BUILD_LOGGING
@@ -380,7 +515,26 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
       }
 #endif
 
-      PluginState *pluginState = globalPluginState;
+      // NOTE: if the ui input is idle, no new grain view data came in, and nothing else the last
+      //       frame was built from has changed, hand the last frame's quads back as they are
+      RetainedFrame *retainedFrame = &pluginState->retainedFrame;
+      u64 signatureHash = pluginHashFrameSignature(pluginState, renderCommands);
+      b32 grainViewIsUnchanged = (pluginState->pluginMode == PluginMode_menu ||
+                                  gsAtomicLoad(&pluginState->grainStateView.entriesQueued) == 0);
+      if(retainedFrame->isValid &&
+         retainedFrame->signatureHash == signatureHash &&
+         retainedFrame->quads == renderCommands->quads &&
+         !renderCommands->windowResized &&
+         grainViewIsUnchanged &&
+         uiInputIsIdle(&pluginState->uiContext, &input->mouseState, &input->keyboardState))
+        {
+          renderCommands->quadCount = retainedFrame->quadCount;
+          renderCommands->cursorState = retainedFrame->cursorState;
+          renderCommands->frameIsRetained = true;
+          ++renderCommands->unchangedFrameCount;
+          return;
+        }
+
       TemporaryMemory scratch = arenaGetScratch(0, 0);
 
 #if 0
@@ -411,6 +565,30 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
             {
               pluginState->pluginMode = (PluginMode)!pluginState->pluginMode;
             }
+
+          // NOTE: ctrl+r starts and stops bouncing the output and input to disk
+          DiskRecorder *diskRecorder = pluginState->diskRecorder;
+          if(diskRecorder &&
+             isDown(input->keyboardState.modifiers[KeyboardModifier_control]) &&
+             wasPressed(input->keyboardState.keys[KeyboardButton_r]))
+            {
+              if(gsAtomicLoad(&diskRecorder->state) == DiskRecorderState_idle)
+                {
+                  u64 timestamp = gsGetCurrentTimestamp();
+                  String8 outputPath = arenaPushStringFormat(scratch.arena, DATA_PATH"granade_output_%llu.wav",
+                                                             timestamp);
+                  String8 inputPath = arenaPushStringFormat(scratch.arena, DATA_PATH"granade_input_%llu.wav",
+                                                            timestamp);
+                  if(!diskRecorderStart(diskRecorder, (char *)outputPath.str, (char *)inputPath.str))
+                    {
+                      logFormatString("ERROR: could not start recording to %s\n", (char *)outputPath.str);
+                    }
+                }
+              else
+                {
+                  diskRecorderStop(diskRecorder);
+                }
+            }
         }
 
       // NOTE: standalone i/o device selection
@@ -524,7 +702,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                       boundaryRect.min.E[splitAxis] -= 3;
                       boundaryRect.max.E[splitAxis] += 3;
 
-                      UIComm hresize = uiMakeBox(&panel->layout, STR8_LIT("hresize"), boundaryRect,
+                      UIComm hresize = uiMakeBox(&panel->layout, UI_KEY("hresize"), boundaryRect,
                                                  UIElementFlag_clickable |
                                                  UIElementFlag_drawBackground |
                                                  UIElementFlag_drawBorder);
@@ -602,7 +780,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                     v2 playOffsetPOP = V2(0.05f, 0.6f);
                     v2 playSizePOP = knobDimPOP*V2(1, 1);
                     UIComm play =
-                      uiMakeButton(panelLayout, STR8_LIT("play"), playOffsetPOP, playSizePOP, 1.f,
+                      uiMakeButton(panelLayout, UI_KEY("play"), playOffsetPOP, playSizePOP, 1.f,
                                    &pluginState->soundIsPlaying, PLUGIN_ASSET(null), V4(0, 0, 1, 1));
 
                     if(play.flags & UICommFlag_pressed)
@@ -637,7 +815,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                       v2 volumeClickableDim = V2(0.4f, 1.f);
                       v2 volumeTextOffset = hadamard(V2(0.001f, -0.045f), panelDim);
                       parameterComms[PluginParameter_volume] =
-                        uiMakeSlider(panelLayout, STR8_LIT("LEVEL"),
+                        uiMakeSlider(panelLayout, UI_KEY("LEVEL"),
                                      volumeOffsetPOP, volumeDimPOP, 0.5f,
                                      &pluginState->parameters[PluginParameter_volume],
                                      volumeClickableOffset, volumeClickableDim,
@@ -655,7 +833,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                       v2 densityClickableDim = V2(1.f, 0.9f);
                       v2 densityTextOffset = hadamard(V2(0, -0.015f), panelDim);
                       parameterComms[PluginParameter_density] =
-                        uiMakeKnob(panelLayout, STR8_LIT("DENSITY"),
+                        uiMakeKnob(panelLayout, UI_KEY("DENSITY"),
                                    densityOffsetPOP, densitySizePOP, 1.f,
                                    &pluginState->parameters[PluginParameter_density],
                                    V2(-0.02f, 0.02f), V2(1.02f, 1),
@@ -671,7 +849,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                       v2 spreadSizePOP = knobDimPOP*V2(1, 1);
                       v2 spreadTextOffset = hadamard(V2(0, 0.038f), panelDim);
                       parameterComms[PluginParameter_spread] =
-                        uiMakeKnob(panelLayout, STR8_LIT("SPREAD"),
+                        uiMakeKnob(panelLayout, UI_KEY("SPREAD"),
                                    spreadOffsetPOP, spreadSizePOP, 1.f,
                                    &pluginState->parameters[PluginParameter_spread],
                                    knobLabelOffset, knobLabelDim,
@@ -687,7 +865,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                       v2 offsetSizePOP = knobDimPOP*V2(1, 1);
                       v2 offsetTextOffset = hadamard(V2(0.002f, 0.038f), panelDim);
                       parameterComms[PluginParameter_offset] =
-                        uiMakeKnob(panelLayout, STR8_LIT("OFFSET"),
+                        uiMakeKnob(panelLayout, UI_KEY("OFFSET"),
                                    offsetOffsetPOP, offsetSizePOP, 1.f,
                                    &pluginState->parameters[PluginParameter_offset],
                                    knobLabelOffset, knobLabelDim,
@@ -703,7 +881,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                       v2 sizeDimPOP = knobDimPOP*V2(1, 1);
                       v2 sizeTextOffset = hadamard(V2(0.002f, 0.038f), panelDim);
                       parameterComms[PluginParameter_size] =
-                        uiMakeKnob(panelLayout, STR8_LIT("SIZE"), sizeOffsetPOP, sizeDimPOP, 1.f,
+                        uiMakeKnob(panelLayout, UI_KEY("SIZE"), sizeOffsetPOP, sizeDimPOP, 1.f,
                                    &pluginState->parameters[PluginParameter_size],
                                    knobLabelOffset, knobLabelDim,
                                    knobClickableOffset, knobClickableDim,
@@ -720,7 +898,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                       v2 mixLabelOffset = V2(0.02f, 0.068f);
                       v2 mixTextOffset = hadamard(V2(0.003f, 0.042f), panelDim);
                       parameterComms[PluginParameter_mix] =
-                        uiMakeKnob(panelLayout, STR8_LIT("MIX"), mixOffsetPOP, mixSizePOP, 1.f,
+                        uiMakeKnob(panelLayout, UI_KEY("MIX"), mixOffsetPOP, mixSizePOP, 1.f,
                                    &pluginState->parameters[PluginParameter_mix],
                                    mixLabelOffset, knobLabelDim,
                                    knobClickableOffset, knobClickableDim,
@@ -737,7 +915,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                       v2 panLabelOffset = V2(0.03f, 0.065f);
                       v2 panTextOffset = hadamard(V2(0.003f, 0.043f), panelDim);
                       parameterComms[PluginParameter_pan] =
-                        uiMakeKnob(panelLayout, STR8_LIT("PAN"), panOffsetPOP, panSizePOP, 1.f,
+                        uiMakeKnob(panelLayout, UI_KEY("PAN"), panOffsetPOP, panSizePOP, 1.f,
                                    &pluginState->parameters[PluginParameter_pan],
                                    panLabelOffset, knobLabelDim,
                                    knobClickableOffset, knobClickableDim,
@@ -754,7 +932,7 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
                       v2 windowLabelOffset = V2(0.03f, 0.065f);
                       v2 windowTextOffset = hadamard(V2(0.003f, 0.02f), panelDim);
                       parameterComms[PluginParameter_window] =
-                        uiMakeKnob(panelLayout, STR8_LIT("WINDOW"), windowOffsetPOP, windowSizePOP, 1.f,
+                        uiMakeKnob(panelLayout, UI_KEY("WINDOW"), windowOffsetPOP, windowSizePOP, 1.f,
                                    &pluginState->parameters[PluginParameter_window],
                                    windowLabelOffset, knobLabelDim,
                                    knobClickableOffset, knobClickableDim,
@@ -1631,14 +1809,125 @@ gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *rende
       arenaReleaseScratch(scratch);
       uiContextEndFrame(uiContext);
 
+      // NOTE: a rebuilt frame can still draw exactly what the last one did, eg when the mouse moved
+      //       within an element without changing it
+      u64 quadHash = grainPackfileChecksum(GRAIN_PACKFILE_CHECKSUM_SEED, (u8 *)renderCommands->quads,
+                                           renderCommands->quadCount*sizeof(R_Quad));
+      if(retainedFrame->isValid &&
+         retainedFrame->quads == renderCommands->quads &&
+         retainedFrame->quadCount == renderCommands->quadCount &&
+         retainedFrame->quadHash == quadHash &&
+         !renderCommands->windowResized)
+        {
+          ++renderCommands->unchangedFrameCount;
+        }
+      else
+        {
+          renderCommands->unchangedFrameCount = 0;
+        }
+
+      retainedFrame->isValid = 1;
+      retainedFrame->signatureHash = signatureHash;
+      retainedFrame->quads = renderCommands->quads;
+      retainedFrame->quadCount = renderCommands->quadCount;
+      retainedFrame->quadHash = quadHash;
+      retainedFrame->cursorState = renderCommands->cursorState;
+
       arenaEnd(pluginState->frameArena);
     }
 }
 
+EXPORT_FUNCTION void
+gsRenderNewFrame(PluginMemory *memory, PluginInput *input, RenderCommands *renderCommands)
+{
+  gsInitializePluginState(memory);
+  pluginRenderNewFrame(globalPluginState, input, renderCommands);
+}
+
 //
 // audio
 //
 
+static void
+convolveGrainSamples(BufferStream *stream)
+{
+  ASSERT(stream->at == stream->end);
+
+  ConvolutionStream *convolution = (ConvolutionStream*)stream;
+  BufferStream *source = convolution->source;
+  Arena *refillArena = convolution->refillArena;
+
+  PluginState *pluginState = convolution->pluginState;
+  PluginFloatParameter *reverbParam = pluginState->parameters + PluginParameter_reverb;
+
+  if(source->at == source->end) source->refill(source);
+  ASSERT(source->at == source->start);
+
+  SamplePair *sourceSamples = (SamplePair*)source->at;
+  u32 frameCount = (u32)((SamplePair*)source->end - sourceSamples);
+
+  SamplePair *samplesStart = arenaPushArray(refillArena, frameCount, SamplePair,
+                                            arenaFlagsNoZeroAlign(4*sizeof(SamplePair)));
+  SamplePair *samplesEnd = samplesStart + frameCount;
+
+  // NOTE: the convolvers only run while the reverb is audible. When it's switched back on, the
+  //       old tail is cleared rather than resumed
+  ParameterValue reverbTarget = {};
+  reverbTarget.asInt = gsAtomicLoad(&reverbParam->targetValue.asInt);
+  bool active = (pluginReadFloatParameter(reverbParam) > 0.f || reverbTarget.asFloat > 0.f);
+  if(active)
+  {
+    if(!convolution->active)
+    {
+      for(u32 channelIndex = 0; channelIndex < ARRAY_COUNT(convolution->convolvers); ++channelIndex)
+      {
+        convolverReset(convolution->convolvers[channelIndex]);
+      }
+    }
+
+    r32 *channelSamples = arenaPushArray(refillArena, frameCount, r32,
+                                         arenaFlagsNoZeroAlign(4*sizeof(r32)));
+    for(u32 channelIndex = 0; channelIndex < ARRAY_COUNT(convolution->convolvers); ++channelIndex)
+    {
+      for(u32 frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+      {
+        channelSamples[frameIndex] = sourceSamples[frameIndex].c[channelIndex];
+      }
+
+      convolverProcess(convolution->convolvers[channelIndex], channelSamples, channelSamples, frameCount);
+
+      for(u32 frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+      {
+        samplesStart[frameIndex].c[channelIndex] = channelSamples[frameIndex];
+      }
+    }
+
+    for(u32 frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+    {
+      r32 reverb = pluginUpdateFloatParameter(reverbParam);
+      SamplePair drySample = sourceSamples[frameIndex];
+      SamplePair *outSample = samplesStart + frameIndex;
+      outSample->left = drySample.left + reverb*outSample->left;
+      outSample->right = drySample.right + reverb*outSample->right;
+    }
+  }
+  else
+  {
+    for(u32 frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+    {
+      pluginUpdateFloatParameter(reverbParam);
+    }
+    COPY_ARRAY(samplesStart, sourceSamples, frameCount, SamplePair);
+  }
+  convolution->active = active;
+
+  source->at = source->end;
+
+  stream->start = (u8*)samplesStart;
+  stream->at = stream->start;
+  stream->end = (u8*)samplesEnd;
+}
+
 static void
 mixOutputSamples(BufferStream *stream)
 {
@@ -1685,6 +1974,17 @@ mixOutputSamples(BufferStream *stream)
 
   u8 *atMidiBuffer = audioBuffer->midiBuffer;
 
+  // NOTE: the recorder gets the float frames, before the output format's scaling
+  DiskRecorder *diskRecorder = pluginState->diskRecorder;
+  b32 recording = diskRecorder && diskRecorderIsRecording(diskRecorder);
+  TemporaryMemory scratch = arenaGetScratch(0, 0);
+  SamplePair *recordedFrames = 0;
+  SamplePair *inputFrames = (SamplePair *)inputSource->at;
+  if(recording)
+  {
+    recordedFrames = arenaPushArray(scratch.arena, audioBuffer->framesToWrite, SamplePair, arenaFlagsZeroNoAlign());
+  }
+
   logFormatString("samples to write: %lu", audioBuffer->framesToWrite);
   for(u32 frameIndex = 0;
       frameIndex < audioBuffer->framesToWrite;
@@ -1697,7 +1997,8 @@ mixOutputSamples(BufferStream *stream)
     SamplePair grainSample = *(SamplePair*)grainSource->at;
     SamplePair inputSample = *(SamplePair*)inputSource->at;
 
-    r32 volume = formatVolumeFactor * pluginUpdateFloatParameter(volumeParam);
+    r32 gain = pluginUpdateFloatParameter(volumeParam);
+    r32 volume = formatVolumeFactor * gain;
     r32 mix = pluginUpdateFloatParameter(mixParam);
     r32 panner = pluginUpdateFloatParameter(panParam);
     r32 spread = pluginUpdateFloatParameter(spreadParam);
@@ -1740,6 +2041,11 @@ mixOutputSamples(BufferStream *stream)
 
       mixedVal += lerp(inputSample.c[channelIndex], grainVal, mix);
       //logFormatString("mixedVal: %.2f", mixedVal);
+      if(recordedFrames && channelIndex < 2)
+      {
+        recordedFrames[frameIndex].c[channelIndex] = gain*mixedVal;
+        if(audioBuffer->outputChannels == 1) recordedFrames[frameIndex].right = gain*mixedVal;
+      }
 
       switch(audioBuffer->outputFormat)
       {
@@ -1763,6 +2069,13 @@ mixOutputSamples(BufferStream *stream)
 
   ASSERT(grainSource->at == grainSource->end);
   ASSERT(inputSource->at == inputSource->end);
+
+  if(recordedFrames)
+  {
+    u32 sampleRate = audioBuffer->outputSampleRate ? audioBuffer->outputSampleRate : INTERNAL_SAMPLE_RATE;
+    diskRecorderPushSamples(diskRecorder, recordedFrames, inputFrames, audioBuffer->framesToWrite, sampleRate);
+  }
+  arenaReleaseScratch(scratch);
 }
 
 static void
@@ -1810,10 +2123,11 @@ mixInputSamples(BufferStream *stream)
       {
         if(currentTime < loadedSound->sound.sampleCount)
         {
+          u32 soundReadIndex1 = MIN(soundReadIndex + 1, loadedSound->sound.sampleCount - 1);
           for(u32 channelIndex = 0; channelIndex < audioBuffer->inputChannels; ++channelIndex)
           {
             r32 loadedSoundSample0 = loadedSound->sound.samples[channelIndex][soundReadIndex];
-            r32 loadedSoundSample1 = loadedSound->sound.samples[channelIndex][soundReadIndex + 1];
+            r32 loadedSoundSample1 = loadedSound->sound.samples[channelIndex][soundReadIndex1];
             r32 loadedSoundSample = lerp(loadedSoundSample0, loadedSoundSample1, soundReadFrac);
 
             samplesAt->c[channelIndex] += 0.5f*loadedSoundSample;
@@ -1881,14 +2195,11 @@ mixInputSamples(BufferStream *stream)
   COPY_ARRAY(mix->clone, stream, 1, BufferStream);
 }
 
-EXPORT_FUNCTION void
-gsAudioProcess(PluginMemory *memory, PluginAudioBuffer *audioBuffer)
+static void
+pluginProcessAudio(PluginState *pluginState, PluginAudioBuffer *audioBuffer)
 {
-  UNUSED(memory);
-
-  if(globalPluginState)
+  if(pluginState)
   {
-    PluginState *pluginState = globalPluginState;
     if(pluginState->initialized)
     {
       TemporaryMemory scratch = arenaGetScratch(0, 0);
@@ -1927,6 +2238,7 @@ gsAudioProcess(PluginMemory *memory, PluginAudioBuffer *audioBuffer)
       inputStream->audioBuffer = audioBuffer;
 
       pluginState->grainManager.refillArena = scratch.arena;
+      pluginState->convolutionStream.refillArena = scratch.arena;
 
       OutputMixStream *outputStream = &pluginState->outputStream;
       outputStream->audioBuffer = audioBuffer;
@@ -1937,3 +2249,22 @@ gsAudioProcess(PluginMemory *memory, PluginAudioBuffer *audioBuffer)
     }
   }
 }
+
+EXPORT_FUNCTION void
+gsAudioProcess(PluginMemory *memory, PluginAudioBuffer *audioBuffer)
+{
+  UNUSED(memory);
+
+  pluginProcessAudio(globalPluginState, audioBuffer);
+}
+
+// NOTE: stops the plugin's background threads, which run plugin code, so the host has to call this
+//       before unloading it. Audio processing keeps working, without recording
+EXPORT_FUNCTION void
+gsShutdownPlugin(void)
+{
+  if(globalPluginState && globalPluginState->diskRecorder)
+    {
+      diskRecorderStopAndWait(globalPluginState->diskRecorder);
+    }
+}
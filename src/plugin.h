@@ -89,8 +89,11 @@ logFormatString(char *format, ...)
 #include "simd_intrinsics.h"
 #include "profile.h"
 #include "fft.h"
+#include "convolver.h"
 #include "plugin_parameters.h"
 #include "file_granulator.h"
+#include "grain_index.h"
+#include "grain_features.h"
 #include "plugin_asset.h"
 #include "ui_layout.h"
 #include "plugin_ui.h"
@@ -98,201 +101,10 @@ logFormatString(char *format, ...)
 #include "buffer_stream.h"
 #include "ring_buffer.h"
 #include "internal_granulator.h"
-
-#define RIFF(str) FOURCC(str)
-
-union RiffID
-{
-  u32 id;
-  u8 str[4];
-};
-
-#pragma pack(push, 1)
-struct RiffHeader
-{
-  RiffID chunkID;
-  u32 chunkSize;
-};
-
-struct WaveHeader
-{
-  RiffID waveID;
-};
-
-struct WaveFormatChunk
-{
-  RiffHeader header;
-  u16 formatTag;
-  u16 channelCount;
-  u32 sampleRate;
-  u32 avgBytesPerSec;
-  u16 dataBlockSize;
-  u16 bitsPerSample;
-};
-
-struct WaveFormatExtension
-{
-  u16 cbSize;
-  u16 validBitsPerSample;
-  u32 channelMask;
-  u8 subFmt[16];
-};
-
-struct WaveFormatExtended
-{
-  WaveFormatChunk fmt;
-  WaveFormatExtension ex;
-};
-#pragma pack(pop)
-
-typedef RiffHeader WaveDataChunk;
-
-static inline LoadedSound
-loadWav(Arena *arena, String8 path)
-{
-  TemporaryMemory scratch = arenaGetScratch(&arena, 1);
-
-  Buffer file = gsReadEntireFile((char*)path.str, scratch.arena);
-
-  RiffHeader *riffHeader = bufferReadStruct(&file, RiffHeader);
-  ASSERT(riffHeader->chunkID.id == RIFF("RIFF"));
-  UNUSED(riffHeader);
-
-  WaveHeader *waveHeader = bufferReadStruct(&file, WaveHeader);
-  ASSERT(waveHeader->waveID.id == RIFF("WAVE"));
-  UNUSED(waveHeader);
-
-  WaveFormatChunk *waveFmt = bufferReadStruct(&file, WaveFormatChunk);
-  ASSERT(waveFmt->header.chunkID.id == RIFF("fmt "));
-  //u16 formatTag = waveFmt->formatTag;
-  u16 bytesPerSample = waveFmt->bitsPerSample / 8;
-  u32 channelCount = waveFmt->channelCount;
-  u32 sampleRate = waveFmt->sampleRate;
-  if(waveFmt->header.chunkSize == (sizeof(WaveFormatExtended) - sizeof(RiffHeader)))
-  {
-    bufferReadStruct(&file, WaveFormatExtension);
-  }
-
-  WaveDataChunk *waveData = bufferReadStruct(&file, WaveDataChunk);
-  ASSERT(waveData->chunkID.id == RIFF("data"));
-  u32 waveDataSize = waveData->chunkSize;
-
-  ASSERT(sampleRate == INTERNAL_SAMPLE_RATE);
-  UNUSED(sampleRate);
-
-  u32 sampleCount = waveDataSize / (channelCount * bytesPerSample);
-  u8 *sampleData = bufferReadArray(&file, waveDataSize, u8);
-
-  r32 *samplesL = arenaPushArray(arena, 2 * sampleCount, r32);
-  r32 *samplesR = samplesL + sampleCount;
-
-  // NOTE: copy samples
-  {
-#define CONVERT_SAMPLE(srcData, srcSample, type, channels) do {\
-      type sample = *(type*)srcData;\
-      srcSample = (r32)sample/(r32)type##_MAX;\
-      srcData = (type*)srcData + channels;\
-    } while(0)
-
-    void *srcDataL = sampleData;
-    r32 *destL = samplesL;
-    r32 *destR = samplesR;
-    if(channelCount == 1)
-    {
-      if(bytesPerSample == 1)
-      {
-        for(u32 sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex)
-        {
-          r32 srcSample = 0;
-          CONVERT_SAMPLE(srcDataL, srcSample, u8, channelCount);
-          *destL++ = srcSample;
-          *destR++ = srcSample;
-        }
-      }
-      else if(bytesPerSample == 2)
-      {
-        for(u32 sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex)
-        {
-          r32 srcSample = 0;
-          CONVERT_SAMPLE(srcDataL, srcSample, s16, channelCount);
-          *destL++ = srcSample;
-          *destR++ = srcSample;
-        }
-      }
-      else if(bytesPerSample == 4)
-      {
-        for(u32 sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex)
-        {
-          r32 srcSample = 0;
-          CONVERT_SAMPLE(srcDataL, srcSample, r32, channelCount);
-          *destL++ = srcSample;
-          *destR++ = srcSample;
-        }
-      }
-      else
-      {
-        ASSERT(!"unsupported sample size")
-      }
-    }
-    else if(channelCount == 2)
-    {
-      void *srcDataR = sampleData + bytesPerSample;
-      if(bytesPerSample == 1)
-      {
-        for(u32 sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex)
-        {
-          r32 srcSampleL = 0;
-          r32 srcSampleR = 0;
-          CONVERT_SAMPLE(srcDataL, srcSampleL, u8, channelCount);
-          CONVERT_SAMPLE(srcDataR, srcSampleR, u8, channelCount);
-          *destL++ = srcSampleL;
-          *destR++ = srcSampleR;
-        }
-      }
-      else if(bytesPerSample == 2)
-      {
-        for(u32 sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex)
-        {
-          r32 srcSampleL = 0;
-          r32 srcSampleR = 0;
-          CONVERT_SAMPLE(srcDataL, srcSampleL, s16, channelCount);
-          CONVERT_SAMPLE(srcDataR, srcSampleR, s16, channelCount);
-          *destL++ = srcSampleL;
-          *destR++ = srcSampleR;
-        }
-      }
-      else if(bytesPerSample == 4)
-      {
-        for(u32 sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex)
-        {
-          r32 srcSampleL = 0;
-          r32 srcSampleR = 0;
-          CONVERT_SAMPLE(srcDataL, srcSampleL, r32, channelCount);
-          CONVERT_SAMPLE(srcDataR, srcSampleR, r32, channelCount);
-          *destL++ = srcSampleL;
-          *destR++ = srcSampleR;
-        }
-      }
-      else
-      {
-        ASSERT(!"unsupported sample size")
-      }
-    }
-    else
-    {
-      ASSERT(!"unsupported channel count");
-    }
-  }
-
-  arenaReleaseScratch(scratch);
-
-  LoadedSound result = {};
-  result.sampleCount = sampleCount;
-  result.channelCount = channelCount;
-  result.samples[0] = samplesL;
-  result.samples[1] = samplesR;
-  return(result);
-}
+#include "wav_decoder.h"
+#include "sample_cache.h"
+#include "disk_recorder.h"
+#include "render_software.h"
 
 enum PluginMode
 {
@@ -309,6 +121,7 @@ struct PlayingSound
 // NOTE: stream refill procedures
 static BUFFER_STREAM_REFILL_PROC(mixInputSamples);
 static BUFFER_STREAM_REFILL_PROC(grainManagerRefill);
+static BUFFER_STREAM_REFILL_PROC(convolveGrainSamples);
 static BUFFER_STREAM_REFILL_PROC(mixOutputSamples);
 
 // NOTE: streams
@@ -332,6 +145,48 @@ struct InputMixStream
   PluginState *pluginState;
 };
 
+// NOTE: reverb on the grain bus. passes the source through, plus its convolution with an impulse
+//       response, scaled by the reverb parameter
+struct ConvolutionStream
+{
+  BufferStream stream; // NOTE: must be the first member for casting reasons
+  BufferStream *source;
+  Arena *refillArena;
+
+  Convolver *convolvers[2]; // NOTE: one per channel
+  bool active; // NOTE: convolver state is stale while the reverb parameter is at 0
+
+  PluginState *pluginState;
+};
+
+// NOTE: everything besides ui input that a frame is built from. If it hashes the same as the last
+//       built frame's, and the ui input is idle, the last frame's quads are handed back as they are
+struct FrameSignature
+{
+  u32 widthInPixels;
+  u32 heightInPixels;
+  u32 pluginMode;
+
+  u32 outputDeviceCount;
+  u32 selectedOutputDeviceIndex;
+  u32 inputDeviceCount;
+  u32 selectedInputDeviceIndex;
+
+  u32 soundIsPlaying;
+  u32 parameterValues[PluginParameter_count];
+};
+
+struct RetainedFrame
+{
+  b32 isValid;
+  u64 signatureHash;
+
+  R_Quad *quads;
+  usz quadCount;
+  u64 quadHash;
+  RenderCursorState cursorState;
+};
+
 // NOTE: plugin state
 
 INTROSPECT
@@ -369,6 +224,7 @@ struct PluginState
 
 #if FINGERTIPS
   PlayingSound loadedSound;
+  CachedSound loadedSoundCache;
 #endif
 
   PluginAsset *null;
@@ -396,15 +252,18 @@ struct PluginState
   UILayout *mouseTooltipLayout;
 
   GrainManager grainManager;
+  ConvolutionStream convolutionStream;
   //AudioRingBuffer grainBuffer;
   GrainStateView grainStateView;
+  RetainedFrame retainedFrame;
+  DiskRecorder *diskRecorder;
 
   volatile u32 initializationLock;
   bool initialized;
 };
 
 // MIdi Continuous Controller Table 0-127
-// NOTE: our parameters are on channels 20 - 29 by default
+// NOTE: our parameters are on channels 20 - 30 by default
 static PluginParameterEnum ccParamTable[128] = {
     PluginParameter_none,   // CC 0: Bank Select (followed by cc32 & Program Change)
     PluginParameter_none, // CC 1: Modulation Wheel (mapped to volume)
@@ -437,7 +296,7 @@ static PluginParameterEnum ccParamTable[128] = {
     PluginParameter_offset,   // CC 27: Undefined
     PluginParameter_pitch,   // CC 28: Undefined
     PluginParameter_stretch,   // CC 29: Undefined
-    PluginParameter_none,   // CC 30: Undefined
+    PluginParameter_reverb,   // CC 30: Undefined
     PluginParameter_none,   // CC 31: Undefined
     PluginParameter_none,   // CC 32: LSB for Control 0 (Bank Select)
     PluginParameter_none,   // CC 33: LSB for Control 1 (Modulation Wheel)
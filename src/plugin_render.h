@@ -1,8 +1,23 @@
+// NOTE: the old quads are left in the arena, which wastes at most as much as the new ones take
+static void
+renderGrowQuads(RenderCommands *commands)
+{
+  usz newCapacity = MAX(2*commands->quadCapacity, RENDER_INITIAL_QUAD_CAPACITY);
+  R_Quad *newQuads = arenaPushArray(commands->allocator, newCapacity, R_Quad);
+  COPY_ARRAY(newQuads, commands->quads, commands->quadCount, R_Quad);
+
+  commands->quads = newQuads;
+  commands->quadCapacity = newCapacity;
+}
+
 static inline void 
 renderPushQuad(RenderCommands *commands, Rect2 rect, PluginAsset *asset, r32 angle,
 	       r32 level, v4 color = V4(1, 1, 1, 1))
 {  
-  ASSERT(commands->quadCount < commands->quadCapacity);
+  if(commands->quadCount == commands->quadCapacity)
+    {
+      renderGrowQuads(commands);
+    }
   R_Quad *quad = commands->quads + commands->quadCount++;
   quad->min = rect.min;
   quad->max = rect.max;
@@ -33,21 +48,191 @@ renderPushRectOutline(RenderCommands *commands, Rect2 rect, r32 thickness, r32 l
   renderPushQuad(commands, rectCenterDim(topMiddle,    hDim), PLUGIN_ASSET(null), 0, level, color);
 }
 
+static u64
+renderGlyphRunHash(LoadedFont *font, String8 string, v2 textScale, r32 regionWidth)
+{
+  union { r32 f[3]; u32 u[3]; } bits = {{textScale.x, textScale.y, regionWidth}};
+
+  u64 hash = UI_HASH_SEED ^ (u64)(usz)font;
+  for(u32 i = 0; i < 3; ++i)
+    {
+      hash = (hash ^ bits.u[i])*UI_HASH_PRIME;
+    }
+  u8 *at = string.str;
+  for(u64 i = 0; i < string.size; ++i)
+    {
+      hash = (hash ^ *at++)*UI_HASH_PRIME;
+    }
+
+  return(uiHashFinalize_(hash));
+}
+
+static inline bool
+renderGlyphRunMatches(UIGlyphRun *run, u64 hash, LoadedFont *font, String8 string, v2 textScale,
+		      r32 regionWidth)
+{
+  bool result = (run->hash == hash && run->font == font &&
+		 run->textScale.x == textScale.x && run->textScale.y == textScale.y &&
+		 run->regionWidth == regionWidth &&
+		 stringsAreEqual(makeString8(run->text, run->textSize), string));
+
+  return(result);
+}
+
+static void
+renderGlyphRunUnlinkRecent(UIGlyphRunCache *cache, UIGlyphRun *run)
+{
+  if(run->lessRecent) run->lessRecent->moreRecent = run->moreRecent;
+  else cache->leastRecent = run->moreRecent;
+  if(run->moreRecent) run->moreRecent->lessRecent = run->lessRecent;
+  else cache->mostRecent = run->lessRecent;
+
+  run->lessRecent = 0;
+  run->moreRecent = 0;
+}
+
+static void
+renderGlyphRunLinkMostRecent(UIGlyphRunCache *cache, UIGlyphRun *run)
+{
+  run->lessRecent = cache->mostRecent;
+  run->moreRecent = 0;
+  if(cache->mostRecent) cache->mostRecent->moreRecent = run;
+  else cache->leastRecent = run;
+  cache->mostRecent = run;
+}
+
+// NOTE: returns the run for the text, and whether it already held the text's layout. A new run
+//       takes an unused slot, or the least recently drawn run's
+static UIGlyphRun *
+renderGetGlyphRun(UIGlyphRunCache *cache, LoadedFont *font, String8 string, v2 textScale,
+		  r32 regionWidth, bool *isLaidOut)
+{
+  u64 hash = renderGlyphRunHash(font, string, textScale, regionWidth);
+  UIGlyphRun **bucket = cache->buckets + (hash & (UI_GLYPH_RUN_BUCKET_COUNT - 1));
+
+  UIGlyphRun *result = *bucket;
+  while(result && !renderGlyphRunMatches(result, hash, font, string, textScale, regionWidth))
+    {
+      result = result->nextInBucket;
+    }
+
+  *isLaidOut = result != 0;
+  if(result)
+    {
+      ++cache->hitCount;
+      renderGlyphRunUnlinkRecent(cache, result);
+    }
+  else
+    {
+      ++cache->missCount;
+      if(cache->runCount < UI_GLYPH_RUN_CACHE_SIZE)
+	{
+	  result = cache->runs + cache->runCount++;
+	}
+      else
+	{
+	  result = cache->leastRecent;
+	  renderGlyphRunUnlinkRecent(cache, result);
+
+	  UIGlyphRun **link = cache->buckets + (result->hash & (UI_GLYPH_RUN_BUCKET_COUNT - 1));
+	  while(*link != result)
+	    {
+	      link = &(*link)->nextInBucket;
+	    }
+	  *link = result->nextInBucket;
+	}
+
+      result->hash = hash;
+      result->font = font;
+      result->textScale = textScale;
+      result->regionWidth = regionWidth;
+      result->textSize = (u32)string.size;
+      COPY_SIZE(result->text, string.str, string.size);
+      result->glyphCount = 0;
+
+      result->nextInBucket = *bucket;
+      *bucket = result;
+    }
+  renderGlyphRunLinkMostRecent(cache, result);
+
+  return(result);
+}
+
+static inline void
+renderPushGlyph(RenderCommands *commands, UIGlyphRun *run, v2 textMin, v2 offset, v2 dim,
+		PluginAsset *glyph, r32 level, v4 color)
+{
+  // NOTE: the text's first glyphs are delayed by a few characters, and text shorter than that has
+  //       no glyph to push for the rest
+  if(glyph)
+    {
+      renderPushQuad(commands, rectMinDim(textMin + offset, dim), glyph, 0, level, color);
+      if(run)
+	{
+	  UIGlyphRunGlyph *runGlyph = run->glyphs + run->glyphCount++;
+	  runGlyph->offset = offset;
+	  runGlyph->dim = dim;
+	}
+    }
+}
+
+// NOTE: glyphs are placed relative to textMin, so a cached run moved to a new textMin lands exactly
+//       where laying the text out again would have put it. Passing no cache lays the text out every
+//       time
 static inline v2
-renderPushText(RenderCommands *commands, LoadedFont *font, String8 string,
+renderPushText(RenderCommands *commands, UIGlyphRunCache *cache, LoadedFont *font, String8 string,
 	       v2 textMin, v2 textScale, r32 regionWidth,
 	       v4 color = V4(1, 1, 1, 1), b32 inTooltip = 0)
 {
-  v2 atPos = textMin;
+  r32 renderLevel = inTooltip ? RENDER_LEVEL(tooltipText) : RENDER_LEVEL(text);
+  u32 colorU32 = colorU32FromV4(color);
+
+  UIGlyphRun *run = 0;
+  if(cache && string.size <= UI_GLYPH_RUN_MAX_GLYPHS)
+    {
+      bool isLaidOut = false;
+      run = renderGetGlyphRun(cache, font, string, textScale, regionWidth, &isLaidOut);
+      if(isLaidOut)
+	{
+	  if(run->placedMin.x != textMin.x || run->placedMin.y != textMin.y ||
+	     run->placedColor != colorU32 || run->placedLevel != renderLevel)
+	    {
+	      for(u32 i = 0; i < run->glyphCount; ++i)
+		{
+		  UIGlyphRunGlyph *glyph = run->glyphs + i;
+		  R_Quad *quad = run->quads + i;
+		  Rect2 glyphRect = rectMinDim(textMin + glyph->offset, glyph->dim);
+		  quad->min = glyphRect.min;
+		  quad->max = glyphRect.max;
+		  quad->color = colorU32;
+		  quad->level = renderLevel;
+		}
+	      run->placedMin = textMin;
+	      run->placedColor = colorU32;
+	      run->placedLevel = renderLevel;
+	    }
+
+	  while(commands->quadCount + run->glyphCount > commands->quadCapacity)
+	    {
+	      renderGrowQuads(commands);
+	    }
+	  COPY_ARRAY(commands->quads + commands->quadCount, run->quads, run->glyphCount, R_Quad);
+	  commands->quadCount += run->glyphCount;
+
+	  return(textMin + run->endOffset);
+	}
+    }
+
+  usz firstQuadIndex = commands->quadCount;
+  v2 atOffset = V2(0, 0);
   u8 *at = string.str;
   u64 stringSize = string.size;
 
-  r32 renderLevel = inTooltip ? RENDER_LEVEL(tooltipText) : RENDER_LEVEL(text);
-
   struct GlyphPushData
   {
     u8 c;
-    Rect2 rect;
+    v2 offset;
+    v2 dim;
     PluginAsset *glyph;
   } pastGlyphs[3] = {};
 
@@ -59,22 +244,21 @@ renderPushText(RenderCommands *commands, LoadedFont *font, String8 string,
 
       v2 glyphDim = getGlyphDim(glyph);
       v2 scaledGlyphDim = hadamard(textScale, glyphDim);
-      Rect2 glyphRect = rectMinDim(atPos, scaledGlyphDim);      
 
       if(i > 2)
 	{
 	  GlyphPushData glyphPushData = pastGlyphs[2];
-	  renderPushQuad(commands, glyphPushData.rect, glyphPushData.glyph, 0,
-			 renderLevel, color);
+	  renderPushGlyph(commands, run, textMin, glyphPushData.offset, glyphPushData.dim,
+			  glyphPushData.glyph, renderLevel, color);
 	}
 
       pastGlyphs[2] = pastGlyphs[1];
       pastGlyphs[1] = pastGlyphs[0];
-      pastGlyphs[0] = {c, glyphRect, glyph};
+      pastGlyphs[0] = {c, atOffset, scaledGlyphDim, glyph};
       
       ++at;
-      atPos.x += textScale.x*getHorizontalAdvance(font, c, *at);
-      if((atPos.x - textMin.x) >= regionWidth)
+      atOffset.x += textScale.x*getHorizontalAdvance(font, c, *at);
+      if(atOffset.x >= regionWidth)
 	{
 	  if(i != (stringSize - 1))
 	    {
@@ -86,30 +270,39 @@ renderPushText(RenderCommands *commands, LoadedFont *font, String8 string,
 
   if(!overflow)
     {
-      GlyphPushData glyphPushData = pastGlyphs[2];
-      renderPushQuad(commands, glyphPushData.rect, glyphPushData.glyph, 0, renderLevel, color);
-      glyphPushData = pastGlyphs[1];
-      renderPushQuad(commands, glyphPushData.rect, glyphPushData.glyph, 0, renderLevel, color);
-      glyphPushData = pastGlyphs[0];
-      renderPushQuad(commands, glyphPushData.rect, glyphPushData.glyph, 0, renderLevel, color);
+      for(u32 i = 0; i < 3; ++i)
+	{
+	  GlyphPushData glyphPushData = pastGlyphs[2 - i];
+	  renderPushGlyph(commands, run, textMin, glyphPushData.offset, glyphPushData.dim,
+			  glyphPushData.glyph, renderLevel, color);
+	}
     }
   else
     {
-      atPos = pastGlyphs[2].rect.min;
+      atOffset = pastGlyphs[2].offset;
       r32 hAdvance = textScale.x*getHorizontalAdvance(font, '.', '.');	
       PluginAsset *glyph = getGlyphFromChar(font, '.');
       v2 glyphDim = getGlyphDim(glyph);
       v2 scaledGlyphDim = hadamard(textScale, glyphDim);      
       for(u32 i = 0; i < 3; ++i)
 	{
-	  Rect2 glyphRect = rectMinDim(atPos, scaledGlyphDim);
-	  renderPushQuad(commands, glyphRect, glyph, 0, renderLevel, color);
-	  atPos.x += hAdvance;
+	  renderPushGlyph(commands, run, textMin, atOffset, scaledGlyphDim, glyph, renderLevel,
+			  color);
+	  atOffset.x += hAdvance;
 	}
     }
   
-  atPos.y -= textScale.y*font->verticalAdvance;
-  return(atPos);
+  atOffset.y -= textScale.y*font->verticalAdvance;
+  if(run)
+    {
+      run->endOffset = atOffset;
+      run->placedMin = textMin;
+      run->placedColor = colorU32;
+      run->placedLevel = renderLevel;
+      COPY_ARRAY(run->quads, commands->quads + firstQuadIndex, run->glyphCount, R_Quad);
+    }
+
+  return(textMin + atOffset);
 }
 
 static inline void
@@ -131,7 +324,7 @@ renderPushUIElement(RenderCommands *commands, UIElement *element)
   // TODO: pull out common formatting computations
   if(element->flags & UIElementFlag_drawText)
     {      
-      renderPushText(commands, layout->context->font,
+      renderPushText(commands, layout->context->glyphRuns, layout->context->font,
 		     element->name, element->region.min, element->textScale, getDim(element->region).x,
 		     element->color, element->inTooltip);
     }
@@ -222,7 +415,7 @@ renderPushUIElement(RenderCommands *commands, UIElement *element)
 			 RENDER_LEVEL(label), V4(1, 1, 1, 1));
 	}
       //renderPushRectOutline(commands, textRegion, 2.f, RenderLevel_front, V4(0, 0, 0, 1));
-      renderPushText(commands, layout->context->font, element->name,
+      renderPushText(commands, layout->context->glyphRuns, layout->context->font, element->name,
 		     textRegion.min, textScale, textDim.x);
     }
 
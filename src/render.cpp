@@ -9,6 +9,8 @@ static GLenum glerr = GL_NO_ERROR;
 #  define GL_CATCH_ERROR()
 #endif
 
+#define RENDER_FENCE_TIMEOUT_NS 100000000ULL
+
 enum GLShaderKind
 {
   GLShaderKind_vertex,
@@ -146,20 +148,24 @@ makeGLState(Arena *arena, usz quadCapacity)
   glGenVertexArrays(1, &vao);
   glBindVertexArray(vao);
 
-  GLuint vbo;
-  glGenBuffers(1, &vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  GLuint patternVbo;
+  glGenBuffers(1, &patternVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, patternVbo);
 
-  GLsizei bufferDataSize = (GLsizei)quadCapacity * sizeof(R_Quad);
-  glBufferData(GL_ARRAY_BUFFER, bufferDataSize, 0, GL_STREAM_DRAW);
   r32 patternData[] = {
     -1.f, -1.f,  0.f, 0.f,
      1.f, -1.f,  1.f, 0.f,
     -1.f,  1.f,  0.f, 1.f,
      1.f,  1.f,  1.f, 1.f,
   };
-  u32 patternDataSize = sizeof(patternData);
-  glBufferSubData(GL_ARRAY_BUFFER, 0, patternDataSize, patternData);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(patternData), patternData, GL_STATIC_DRAW);
+
+  GLuint vbo;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+  GLsizeiptr bufferDataSize = RENDER_QUAD_REGION_COUNT*quadCapacity*sizeof(R_Quad);
+  glBufferData(GL_ARRAY_BUFFER, bufferDataSize, 0, GL_STREAM_DRAW);
 
   GL_CATCH_ERROR();
 	  
@@ -177,7 +183,7 @@ makeGLState(Arena *arena, usz quadCapacity)
 
   GL_CATCH_ERROR();
 
-  GLState *result = arenaPushStruct(arena, GLState);
+  GLState *result = arenaPushStruct(arena, GLState, arenaFlagsZeroNoAlign());
   result->patternPosition    = patternPosition;
   result->vMinMaxPosition    = vMinMaxPosition;
   result->vAlignmentPosition = vAlignmentPosition;
@@ -188,12 +194,12 @@ makeGLState(Arena *arena, usz quadCapacity)
   result->transformPosition  = transformPosition;
   result->samplerPosition    = samplerPosition;
   result->vao = vao;
+  result->patternVbo = patternVbo;
   result->vbo = vbo;
   result->vertexShader = vertexShader;
   result->fragmentShader = fragmentShader;
   result->program = program;
-  result->quadDataOffset = patternDataSize;
-  //result->quadCapacity = (bufferDataSize - patternDataSize) / sizeof(R_Quad);
+  result->quadRegionCapacity = quadCapacity;
   
   return(result);
 }
@@ -204,7 +210,7 @@ allocRenderCommands(void)
   Arena *renderArena = gsArenaAcquire(MEGABYTES(1));
   RenderCommands *result = arenaPushStruct(renderArena, RenderCommands);
   result->allocator = renderArena;  
-  result->quadCapacity = 2048;
+  result->quadCapacity = RENDER_INITIAL_QUAD_CAPACITY;
   result->quads = arenaPushArray(renderArena, result->quadCapacity, R_Quad);
   result->glState = makeGLState(renderArena, result->quadCapacity);
   return(result);
@@ -225,23 +231,40 @@ freeRenderCommands(RenderCommands *commands)
   glDeleteVertexArrays(1, &commands->glState->vao);
   commands->glState->vao = 0;
   
+  glDeleteBuffers(1, &commands->glState->patternVbo);
+  commands->glState->patternVbo = 0;
+  
   glDeleteBuffers(1, &commands->glState->vbo);
   commands->glState->vbo = 0;
-  
-  if(commands->atlas)
+
+  for(u32 regionIndex = 0; regionIndex < RENDER_QUAD_REGION_COUNT; ++regionIndex)
     {
-      if(commands->atlas->glHandle)
+      if(commands->glState->quadRegionFences[regionIndex])
 	{
-	  glDeleteTextures(1, &commands->atlas->glHandle);
-	  commands->atlas->glHandle = 0;
+	  glDeleteSync((GLsync)commands->glState->quadRegionFences[regionIndex]);
+	  commands->glState->quadRegionFences[regionIndex] = 0;
 	}
     }
   
+  if(commands->glState->residentTexture)
+    {
+      glDeleteTextures(1, &commands->glState->residentTexture);
+      commands->glState->residentTexture = 0;
+    }
+  if(commands->atlas)
+    {
+      commands->atlas->glHandle = 0;
+    }
+
+  // NOTE: the plugin can have grown the arena past its first block, growing the quads
+  arenaEnd(commands->allocator);
   gsArenaDiscard(commands->allocator);
 }
 
+// NOTE: a texture is uploaded once, and stays resident until it has to be regenerated, when its
+//       pixels are uploaded into the same texture object, if the context still has it
 static void
-renderBindTexture(LoadedBitmap *texture, bool generateNewTextures)
+renderBindTexture(GLState *glState, LoadedBitmap *texture, bool generateNewTextures)
 {
   if(texture->glHandle && !generateNewTextures)
     {
@@ -250,8 +273,13 @@ renderBindTexture(LoadedBitmap *texture, bool generateNewTextures)
     }
   else
     {
-      glGenTextures(1, &texture->glHandle);
-      GL_CATCH_ERROR();
+      if(!texture->glHandle || !glIsTexture(texture->glHandle))
+	{
+	  glGenTextures(1, &texture->glHandle);
+	  GL_CATCH_ERROR();
+	}
+      glState->residentTexture = texture->glHandle;
+      
       glBindTexture(GL_TEXTURE_2D, texture->glHandle);
       GL_CATCH_ERROR();
       glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
@@ -267,6 +295,78 @@ renderBindTexture(LoadedBitmap *texture, bool generateNewTextures)
     
 }
 
+// NOTE: reallocates the ring with regions big enough for quadCount quads. The old storage is
+//       orphaned, so draws still reading it keep it until they finish, and nothing has to wait
+static void
+renderGrowQuadRegions(GLState *glState, usz quadCount)
+{
+  for(u32 regionIndex = 0; regionIndex < RENDER_QUAD_REGION_COUNT; ++regionIndex)
+    {
+      if(glState->quadRegionFences[regionIndex])
+	{
+	  glDeleteSync((GLsync)glState->quadRegionFences[regionIndex]);
+	  glState->quadRegionFences[regionIndex] = 0;
+	}
+    }
+
+  usz newCapacity = MAX(glState->quadRegionCapacity, RENDER_INITIAL_QUAD_CAPACITY);
+  while(newCapacity < quadCount)
+    {
+      newCapacity *= 2;
+    }
+
+  GLsizeiptr bufferDataSize = RENDER_QUAD_REGION_COUNT*newCapacity*sizeof(R_Quad);
+  glBufferData(GL_ARRAY_BUFFER, bufferDataSize, 0, GL_STREAM_DRAW);
+  GL_CATCH_ERROR();
+
+  glState->quadRegionCapacity = newCapacity;
+  glState->quadRegionIndex = 0;
+}
+
+// NOTE: waits until the gpu is done drawing from the next region in the ring, and copies the
+//       frame's quads into it. Returns the region's offset in vbo
+static usz
+renderUploadQuads(GLState *glState, R_Quad *quads, usz quadCount)
+{
+  if(quadCount > glState->quadRegionCapacity)
+    {
+      renderGrowQuadRegions(glState, quadCount);
+    }
+
+  u32 regionIndex = glState->quadRegionIndex;
+  glState->quadRegionIndex = (regionIndex + 1) % RENDER_QUAD_REGION_COUNT;
+
+  GLsync fence = (GLsync)glState->quadRegionFences[regionIndex];
+  if(fence)
+    {
+      // NOTE: with a region per frame in flight, the fence has almost always signaled already
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, RENDER_FENCE_TIMEOUT_NS);
+      glDeleteSync(fence);
+      glState->quadRegionFences[regionIndex] = 0;
+    }
+
+  usz regionOffset = regionIndex*glState->quadRegionCapacity*sizeof(R_Quad);
+  usz quadDataSize = quadCount*sizeof(R_Quad);
+  if(quadDataSize)
+    {
+      GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+      void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)regionOffset, (GLsizeiptr)quadDataSize,
+				      access);
+      if(mapped)
+	{
+	  COPY_SIZE(mapped, quads, quadDataSize);
+	  glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+      else
+	{
+	  glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)regionOffset, (GLsizeiptr)quadDataSize, quads);
+	}
+      GL_CATCH_ERROR();
+    }
+
+  return(regionOffset);
+}
+
 static void
 renderCommands(RenderCommands *commands)
 {  
@@ -276,47 +376,50 @@ renderCommands(RenderCommands *commands)
   // if(!commands->atlasIsBound)
   //   {
       glActiveTexture(GL_TEXTURE0);
-      renderBindTexture(commands->atlas, commands->generateNewTextures);
+      renderBindTexture(commands->glState, commands->atlas, commands->generateNewTextures);
       commands->atlasIsBound = 1;
     // }
 
   glBindVertexArray(commands->glState->vao);
-  glBindBuffer(GL_ARRAY_BUFFER, commands->glState->vbo);
   glUseProgram(commands->glState->program);
 
+  glBindBuffer(GL_ARRAY_BUFFER, commands->glState->patternVbo);
   glEnableVertexAttribArray(commands->glState->patternPosition);
   glVertexAttribDivisor(commands->glState->patternPosition, 0);
   glVertexAttribPointer(commands->glState->patternPosition, 4, GL_FLOAT, 0, 0, 0);
 
+  glBindBuffer(GL_ARRAY_BUFFER, commands->glState->vbo);
+  usz quadDataOffset = renderUploadQuads(commands->glState, commands->quads, commands->quadCount);
+
   glEnableVertexAttribArray(commands->glState->vMinMaxPosition);
   glVertexAttribDivisor(commands->glState->vMinMaxPosition, 1);
   glVertexAttribPointer(commands->glState->vMinMaxPosition, 4, GL_FLOAT, 0, sizeof(R_Quad),
-			PTR_FROM_INT(commands->glState->quadDataOffset + OFFSET_OF(R_Quad, min)));
+			PTR_FROM_INT(quadDataOffset + OFFSET_OF(R_Quad, min)));
 
   glEnableVertexAttribArray(commands->glState->vAlignmentPosition);
   glVertexAttribDivisor(commands->glState->vAlignmentPosition, 1);
   glVertexAttribPointer(commands->glState->vAlignmentPosition, 2, GL_FLOAT, 0, sizeof(R_Quad),
-			PTR_FROM_INT(commands->glState->quadDataOffset + OFFSET_OF(R_Quad, alignment)));
+			PTR_FROM_INT(quadDataOffset + OFFSET_OF(R_Quad, alignment)));
 
   glEnableVertexAttribArray(commands->glState->vUVMinMaxPosition);
   glVertexAttribDivisor(commands->glState->vUVMinMaxPosition, 1);
   glVertexAttribPointer(commands->glState->vUVMinMaxPosition, 4, GL_FLOAT, 0, sizeof(R_Quad),
-			PTR_FROM_INT(commands->glState->quadDataOffset + OFFSET_OF(R_Quad, uvMin)));
+			PTR_FROM_INT(quadDataOffset + OFFSET_OF(R_Quad, uvMin)));
 
   glEnableVertexAttribArray(commands->glState->vColorPosition);
   glVertexAttribDivisor(commands->glState->vColorPosition, 1);
   glVertexAttribPointer(commands->glState->vColorPosition, 4, GL_UNSIGNED_BYTE, 1, sizeof(R_Quad),
-			PTR_FROM_INT(commands->glState->quadDataOffset + OFFSET_OF(R_Quad, color)));
+			PTR_FROM_INT(quadDataOffset + OFFSET_OF(R_Quad, color)));
 
   glEnableVertexAttribArray(commands->glState->vAnglePosition);
   glVertexAttribDivisor(commands->glState->vAnglePosition, 1);
   glVertexAttribPointer(commands->glState->vAnglePosition, 1, GL_FLOAT, 0, sizeof(R_Quad),
-			PTR_FROM_INT(commands->glState->quadDataOffset + OFFSET_OF(R_Quad, angle)));
+			PTR_FROM_INT(quadDataOffset + OFFSET_OF(R_Quad, angle)));
 
   glEnableVertexAttribArray(commands->glState->vLevelPosition);
   glVertexAttribDivisor(commands->glState->vLevelPosition, 1);
   glVertexAttribPointer(commands->glState->vLevelPosition, 1, GL_FLOAT, 0, sizeof(R_Quad),
-			PTR_FROM_INT(commands->glState->quadDataOffset + OFFSET_OF(R_Quad, level)));
+			PTR_FROM_INT(quadDataOffset + OFFSET_OF(R_Quad, level)));
 
   GL_CATCH_ERROR();
 
@@ -325,13 +428,12 @@ renderCommands(RenderCommands *commands)
 
   GL_CATCH_ERROR();
 
-  // NOTE: draw
-  glBufferSubData(GL_ARRAY_BUFFER,
-		  commands->glState->quadDataOffset,
-		  commands->quadCount*sizeof(R_Quad),
-		  commands->quads);
-  GL_CATCH_ERROR();
-  
+  // NOTE: draw. There's a single atlas page, so every quad goes in one draw
   glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)commands->quadCount);
   GL_CATCH_ERROR();
+
+  u32 drawnRegionIndex = ((commands->glState->quadRegionIndex + RENDER_QUAD_REGION_COUNT - 1) %
+			  RENDER_QUAD_REGION_COUNT);
+  commands->glState->quadRegionFences[drawnRegionIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  GL_CATCH_ERROR();
 }
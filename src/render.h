@@ -23,6 +23,9 @@ enum RenderLevel
   RenderLevel_COUNT,
 };
 
+#define RENDER_QUAD_REGION_COUNT 3
+#define RENDER_INITIAL_QUAD_CAPACITY 2048
+
 struct GLState
 {
   u32 patternPosition;
@@ -37,13 +40,22 @@ struct GLState
   u32 samplerPosition;
 
   u32 vao;
+  u32 patternVbo;
   u32 vbo;
 
   u32 vertexShader;
   u32 fragmentShader;
   u32 program;
 
-  u32 quadDataOffset;
+  // NOTE: quads are streamed through a ring of regions in vbo, so writing a frame's quads never
+  //       waits on the gpu still drawing the last one. A region is fenced when it's drawn from,
+  //       and only written again once the fence has signaled
+  usz quadRegionCapacity;
+  u32 quadRegionIndex;
+  void *quadRegionFences[RENDER_QUAD_REGION_COUNT];
+
+  // NOTE: the texture the atlas was last uploaded to, which is kept for as long as the context is
+  u32 residentTexture;
 };
 
 struct R_Quad
@@ -99,14 +111,24 @@ struct RenderCommands
   LoadedBitmap *atlas;
   b32 atlasIsBound;
 
+  // NOTE: quads live in allocator, and the plugin grows them when a frame needs more
   usz quadCapacity;
   usz quadCount;
   R_Quad *quads;
 
   bool generateNewTextures;
   bool windowResized;
+
+  // NOTE: set by the plugin when nothing the last frame was built from has changed, and it handed
+  //       back the last frame's quads instead of building new ones
+  bool frameIsRetained;
+  // NOTE: how many frames in a row have drawn exactly the same quads
+  u32 unchangedFrameCount;
 };
 
+// NOTE: once every buffer in the swap chain holds the unchanged frame, hosts can skip drawing it
+#define RENDER_SWAP_CHAIN_LENGTH 2
+
 static inline void
 renderBeginCommands(RenderCommands *commands, u32 widthInPixels, u32 heightInPixels)
 {
@@ -119,6 +141,25 @@ renderBeginCommands(RenderCommands *commands, u32 widthInPixels, u32 heightInPix
   
   commands->outputAudioDeviceChanged = false;
   commands->inputAudioDeviceChanged = false;  
+
+  commands->frameIsRetained = false;
+}
+
+static inline bool
+renderFrameNeedsSubmission(RenderCommands *commands)
+{
+  bool result = (commands->unchangedFrameCount < RENDER_SWAP_CHAIN_LENGTH ||
+		 commands->generateNewTextures);
+
+  return(result);
+}
+
+// NOTE: for hosts whose buffers lost what was drawn into them, like a window that was minimized or
+//       uncovered. The frame is drawn into every buffer again, changed or not
+static inline void
+renderDiscardSubmittedFrames(RenderCommands *commands)
+{
+  commands->unchangedFrameCount = 0;
 }
 
 static inline void
@@ -0,0 +1,412 @@
+static SoftwareFramebuffer
+softwareFramebufferAllocate(Arena *arena, u32 width, u32 height)
+{
+  SoftwareFramebuffer result = {};
+  result.width = width;
+  result.height = height;
+  result.stride = ALIGN_POW_2(width, WIDE_WIDTH);
+  result.pixels = arenaPushArray(arena, result.stride*height, u32, arenaFlagsZeroAlign(64));
+  result.depth = arenaPushArray(arena, result.stride*height, r32, arenaFlagsNoZeroAlign(64));
+
+  return(result);
+}
+
+static void
+softwareFramebufferClear(SoftwareFramebuffer *framebuffer, v4 color)
+{
+  u32 clearColor = colorU32FromV4(color);
+  usz pixelCount = (usz)framebuffer->stride*framebuffer->height;
+  for(usz pixelIndex = 0; pixelIndex < pixelCount; ++pixelIndex)
+    {
+      framebuffer->pixels[pixelIndex] = clearColor;
+      framebuffer->depth[pixelIndex] = 1.f;
+    }
+}
+
+// NOTE: returns false for quads that can't cover a pixel, which are left out of the frame
+static b32
+softwareSetupQuad(SoftwareQuad *dest, R_Quad *quad, SoftwareFramebuffer *framebuffer)
+{
+  b32 result = false;
+
+  v2 center = 0.5f*(quad->max + quad->min);
+  v2 halfDim = 0.5f*(quad->max - quad->min);
+  r32 cosa = gsCos(quad->angle);
+  r32 sina = gsSin(quad->angle);
+  r32 determinant = halfDim.x*halfDim.y;
+  if(determinant != 0 && quad->level >= -1.f && quad->level <= 1.f)
+    {
+      // NOTE: the vertex shader maps a pattern point p to center + halfDim*rotate(p - 2*alignment).
+      //       This is its inverse
+      r32 invDeterminant = 1.f/determinant;
+      dest->patternX = invDeterminant*V2(halfDim.y*cosa, -halfDim.y*sina);
+      dest->patternY = invDeterminant*V2(halfDim.x*sina, halfDim.x*cosa);
+      dest->patternOffset = (2.f*quad->alignment -
+			     center.x*dest->patternX - center.y*dest->patternY);
+
+      v2 cornerMin = V2(R32_MAX, R32_MAX);
+      v2 cornerMax = V2(-R32_MAX, -R32_MAX);
+      for(u32 cornerIndex = 0; cornerIndex < 4; ++cornerIndex)
+	{
+	  v2 pattern = V2((cornerIndex & 1) ? 1.f : -1.f, (cornerIndex & 2) ? 1.f : -1.f);
+	  pattern -= 2.f*quad->alignment;
+	  v2 rotated = V2(cosa*pattern.x - sina*pattern.y, sina*pattern.x + cosa*pattern.y);
+	  v2 corner = center + hadamard(halfDim, rotated);
+	  cornerMin = V2(MIN(cornerMin.x, corner.x), MIN(cornerMin.y, corner.y));
+	  cornerMax = V2(MAX(cornerMax.x, corner.x), MAX(cornerMax.y, corner.y));
+	}
+
+      r32 width = (r32)framebuffer->width;
+      r32 height = (r32)framebuffer->height;
+      dest->minX = (s32)clampToRange(cornerMin.x, 0.f, width);
+      dest->minY = (s32)clampToRange(cornerMin.y, 0.f, height);
+      dest->maxX = (s32)clampToRange(cornerMax.x + 1.f, 0.f, width);
+      dest->maxY = (s32)clampToRange(cornerMax.y + 1.f, 0.f, height);
+
+      dest->uvMin = quad->uvMin;
+      dest->uvDim = quad->uvMax - quad->uvMin;
+      dest->color = V4((r32)((quad->color >>  0) & 0xFF),
+		       (r32)((quad->color >>  8) & 0xFF),
+		       (r32)((quad->color >> 16) & 0xFF),
+		       (r32)((quad->color >> 24) & 0xFF))*(1.f/255.f);
+      dest->level = quad->level;
+
+      result = (dest->minX < dest->maxX && dest->minY < dest->maxY);
+    }
+
+  return(result);
+}
+
+static inline WideFloat
+softwareUnpackChannel(WideInt texels, u32 channelIndex)
+{
+  WideInt channel = wideAndInts(wideShiftRightInts(texels, 8*channelIndex), wideSetConstantInts(0xFF));
+  WideFloat result = wideConvertIntsToFloats(channel);
+
+  return(result);
+}
+
+static inline WideFloat
+softwareBilinear(WideFloat c00, WideFloat c10, WideFloat c01, WideFloat c11, WideFloat fx, WideFloat fy)
+{
+  WideFloat c0 = wideMulAddFloats(fx, c10 - c00, c00);
+  WideFloat c1 = wideMulAddFloats(fx, c11 - c01, c01);
+  WideFloat result = wideMulAddFloats(fy, c1 - c0, c0);
+
+  return(result);
+}
+
+static void
+softwareDrawTile(SoftwareRenderer *renderer, SoftwareRenderTile *tile)
+{
+  SoftwareFramebuffer *framebuffer = renderer->framebuffer;
+
+  // NOTE: without an atlas, quads sample white and keep their own colors
+  static u32 whiteTexel = 0xFFFFFFFF;
+  LoadedBitmap *atlas = renderer->atlas;
+  u32 *texels = (atlas && atlas->pixels) ? atlas->pixels : &whiteTexel;
+  r32 textureWidth = (atlas && atlas->pixels) ? (r32)atlas->width : 1.f;
+  r32 textureHeight = (atlas && atlas->pixels) ? (r32)atlas->height : 1.f;
+
+  WideFloat laneCenters = {};
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      wideSetLaneFloats(&laneCenters, (r32)lane + 0.5f, lane);
+    }
+
+  WideFloat zero = wideSetConstantFloats(0.f);
+  WideFloat half = wideSetConstantFloats(0.5f);
+  WideFloat one = wideSetConstantFloats(1.f);
+  WideFloat minusOne = wideSetConstantFloats(-1.f);
+  WideFloat max255 = wideSetConstantFloats(255.f);
+  WideFloat inv255 = wideSetConstantFloats(1.f/255.f);
+  WideFloat wideTextureWidth = wideSetConstantFloats(textureWidth);
+  WideFloat wideTextureHeight = wideSetConstantFloats(textureHeight);
+  WideFloat maxTexelX = wideSetConstantFloats(textureWidth - 1.f);
+  WideFloat maxTexelY = wideSetConstantFloats(textureHeight - 1.f);
+  WideInt textureStride = wideSetConstantInts((u32)textureWidth);
+
+  for(u32 binIndex = 0; binIndex < tile->quadCount; ++binIndex)
+    {
+      SoftwareQuad *quad = renderer->quads + tile->quadIndices[binIndex];
+
+      u32 minX = MAX((u32)quad->minX, tile->minX) & ~(WIDE_WIDTH - 1);
+      u32 maxX = MIN((u32)quad->maxX, tile->maxX);
+      u32 minY = MAX((u32)quad->minY, tile->minY);
+      u32 maxY = MIN((u32)quad->maxY, tile->maxY);
+
+      WideFloat patternXX = wideSetConstantFloats(quad->patternX.x);
+      WideFloat patternXY = wideSetConstantFloats(quad->patternX.y);
+      WideFloat uvMinX = wideSetConstantFloats(quad->uvMin.x);
+      WideFloat uvMinY = wideSetConstantFloats(quad->uvMin.y);
+      WideFloat uvHalfDimX = wideSetConstantFloats(0.5f*quad->uvDim.x);
+      WideFloat uvHalfDimY = wideSetConstantFloats(0.5f*quad->uvDim.y);
+      WideFloat colorR = wideSetConstantFloats(quad->color.r*(1.f/255.f));
+      WideFloat colorG = wideSetConstantFloats(quad->color.g*(1.f/255.f));
+      WideFloat colorB = wideSetConstantFloats(quad->color.b*(1.f/255.f));
+      WideFloat colorA = wideSetConstantFloats(quad->color.a*(1.f/255.f));
+      WideFloat level = wideSetConstantFloats(quad->level);
+
+      for(u32 y = minY; y < maxY; ++y)
+	{
+	  r32 centerY = (r32)y + 0.5f;
+	  WideFloat rowPatternX = wideSetConstantFloats(quad->patternY.x*centerY + quad->patternOffset.x);
+	  WideFloat rowPatternY = wideSetConstantFloats(quad->patternY.y*centerY + quad->patternOffset.y);
+	  u32 *pixelRow = framebuffer->pixels + (usz)y*framebuffer->stride;
+	  r32 *depthRow = framebuffer->depth + (usz)y*framebuffer->stride;
+
+	  for(u32 x = minX; x < maxX; x += WIDE_WIDTH)
+	    {
+	      WideFloat centerX = wideSetConstantFloats((r32)x) + laneCenters;
+	      WideFloat patternX = wideMulAddFloats(patternXX, centerX, rowPatternX);
+	      WideFloat patternY = wideMulAddFloats(patternXY, centerX, rowPatternY);
+	      WideFloat depth = wideLoadFloats(depthRow + x);
+
+	      WideInt mask = (wideCompareLessEqualFloats(minusOne, patternX) &
+			      wideCompareLessEqualFloats(patternX, one) &
+			      wideCompareLessEqualFloats(minusOne, patternY) &
+			      wideCompareLessEqualFloats(patternY, one) &
+			      wideCompareLessEqualFloats(level, depth));
+	      if(wideMaskIsZero(mask)) continue;
+
+	      // NOTE: texel coordinates, with texel centers on whole numbers
+	      WideFloat u = wideMulAddFloats(uvHalfDimX, patternX + one, uvMinX);
+	      WideFloat v = wideMulAddFloats(uvHalfDimY, patternY + one, uvMinY);
+	      WideFloat texelX = wideMulAddFloats(u, wideTextureWidth, zero) - half;
+	      WideFloat texelY = wideMulAddFloats(v, wideTextureHeight, zero) - half;
+	      texelX = wideMinFloats(wideMaxFloats(texelX, minusOne), wideTextureWidth);
+	      texelY = wideMinFloats(wideMaxFloats(texelY, minusOne), wideTextureHeight);
+
+	      // NOTE: texel coordinates are at least -1 here, so truncating them shifted by one floors
+	      WideFloat texelX0 = wideConvertIntsToFloats(wideTruncateFloatsToInts(texelX + one)) - one;
+	      WideFloat texelY0 = wideConvertIntsToFloats(wideTruncateFloatsToInts(texelY + one)) - one;
+	      WideFloat fracX = texelX - texelX0;
+	      WideFloat fracY = texelY - texelY0;
+	      WideInt x0 = wideTruncateFloatsToInts(wideMinFloats(wideMaxFloats(texelX0, zero), maxTexelX));
+	      WideInt x1 = wideTruncateFloatsToInts(wideMinFloats(wideMaxFloats(texelX0 + one, zero), maxTexelX));
+	      WideInt row0 = wideTruncateFloatsToInts(wideMinFloats(wideMaxFloats(texelY0, zero), maxTexelY));
+	      WideInt row1 = wideTruncateFloatsToInts(wideMinFloats(wideMaxFloats(texelY0 + one, zero), maxTexelY));
+	      row0 = row0*textureStride;
+	      row1 = row1*textureStride;
+
+	      WideInt t00 = wideGatherInts(texels, row0 + x0);
+	      WideInt t10 = wideGatherInts(texels, row0 + x1);
+	      WideInt t01 = wideGatherInts(texels, row1 + x0);
+	      WideInt t11 = wideGatherInts(texels, row1 + x1);
+
+	      WideFloat sampledA = softwareBilinear(softwareUnpackChannel(t00, 3), softwareUnpackChannel(t10, 3),
+						    softwareUnpackChannel(t01, 3), softwareUnpackChannel(t11, 3),
+						    fracX, fracY);
+	      mask = mask & wideCompareLessFloats(zero, sampledA);
+	      if(wideMaskIsZero(mask)) continue;
+
+	      WideFloat sampledR = softwareBilinear(softwareUnpackChannel(t00, 0), softwareUnpackChannel(t10, 0),
+						    softwareUnpackChannel(t01, 0), softwareUnpackChannel(t11, 0),
+						    fracX, fracY);
+	      WideFloat sampledG = softwareBilinear(softwareUnpackChannel(t00, 1), softwareUnpackChannel(t10, 1),
+						    softwareUnpackChannel(t01, 1), softwareUnpackChannel(t11, 1),
+						    fracX, fracY);
+	      WideFloat sampledB = softwareBilinear(softwareUnpackChannel(t00, 2), softwareUnpackChannel(t10, 2),
+						    softwareUnpackChannel(t01, 2), softwareUnpackChannel(t11, 2),
+						    fracX, fracY);
+
+	      WideFloat sourceR = colorR*sampledR;
+	      WideFloat sourceG = colorG*sampledG;
+	      WideFloat sourceB = colorB*sampledB;
+	      WideFloat sourceA = colorA*sampledA;
+	      WideFloat inverseA = one - sourceA;
+
+	      WideInt destPixels = wideLoadInts(pixelRow + x);
+	      WideFloat destR = softwareUnpackChannel(destPixels, 0)*inv255;
+	      WideFloat destG = softwareUnpackChannel(destPixels, 1)*inv255;
+	      WideFloat destB = softwareUnpackChannel(destPixels, 2)*inv255;
+	      WideFloat destA = softwareUnpackChannel(destPixels, 3)*inv255;
+
+	      // NOTE: SRC_ALPHA, ONE_MINUS_SRC_ALPHA, on alpha too, rounded to 8 bits
+	      WideFloat blendedR = wideMulAddFloats(sourceR, sourceA, destR*inverseA)*max255 + half;
+	      WideFloat blendedG = wideMulAddFloats(sourceG, sourceA, destG*inverseA)*max255 + half;
+	      WideFloat blendedB = wideMulAddFloats(sourceB, sourceA, destB*inverseA)*max255 + half;
+	      WideFloat blendedA = wideMulAddFloats(sourceA, sourceA, destA*inverseA)*max255 + half;
+	      WideInt blended = wideOrInts(wideOrInts(wideTruncateFloatsToInts(blendedR),
+						      wideShiftLeftInts(wideTruncateFloatsToInts(blendedG), 8)),
+					   wideOrInts(wideShiftLeftInts(wideTruncateFloatsToInts(blendedB), 16),
+						      wideShiftLeftInts(wideTruncateFloatsToInts(blendedA), 24)));
+
+	      wideStoreInts(pixelRow + x, wideMaskInts(blended, destPixels, mask));
+	      wideStoreFloats(depthRow + x, wideMaskFloats(level, depth, mask));
+	    }
+	}
+    }
+}
+
+static void
+softwareDrawTiles(SoftwareRenderer *renderer)
+{
+  for(;;)
+    {
+      u32 tileIndex = gsAtomicAdd(&renderer->nextTileIndex, 1);
+      if(tileIndex >= gsAtomicLoad(&renderer->tileCount)) break;
+
+      softwareDrawTile(renderer, renderer->tiles + tileIndex);
+      gsAtomicAdd(&renderer->doneTileCount, 1);
+    }
+}
+
+static void
+softwareRenderWorkerProc(void *data)
+{
+  SoftwareRenderer *renderer = (SoftwareRenderer *)data;
+
+  u32 seenFrameIndex = 0;
+  u32 idleCount = 0;
+  while(!gsAtomicLoad(&renderer->shouldQuit))
+    {
+      u32 frameIndex = gsAtomicLoad(&renderer->frameIndex);
+      if(frameIndex != seenFrameIndex)
+	{
+	  seenFrameIndex = frameIndex;
+	  softwareDrawTiles(renderer);
+	  idleCount = 0;
+	}
+      else
+	{
+	  // NOTE: frames tend to come back to back, so workers yield for a while before sleeping
+	  gsSleep((++idleCount < SOFTWARE_RENDER_SPIN_COUNT) ? 0 : SOFTWARE_RENDER_POLL_MSEC);
+	}
+    }
+
+  gsAtomicAdd(&renderer->runningWorkerCount, (u32)-1);
+}
+
+// NOTE: the thread drawing a frame draws tiles too, so a renderer without workers draws everything
+//       on the calling thread
+static SoftwareRenderer *
+softwareRendererCreate(Arena *arena, u32 workerCount)
+{
+  SoftwareRenderer *result = arenaPushStruct(arena, SoftwareRenderer, arenaFlagsZeroNoAlign());
+  result->frameArena = gsArenaAcquire(MEGABYTES(1));
+  result->nextTileIndex = SOFTWARE_RENDER_TILE_IDLE;
+
+  workerCount = MIN(workerCount, SOFTWARE_RENDER_MAX_WORKER_COUNT);
+  for(u32 workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+    {
+      gsAtomicAdd(&result->runningWorkerCount, 1);
+      if(gsStartThread(softwareRenderWorkerProc, result))
+	{
+	  ++result->workerCount;
+	}
+      else
+	{
+	  gsAtomicAdd(&result->runningWorkerCount, (u32)-1);
+	  logString("software renderer: failed to start a worker\n");
+	  break;
+	}
+    }
+
+  return(result);
+}
+
+static void
+softwareRendererDestroy(SoftwareRenderer *renderer)
+{
+  gsAtomicStore(&renderer->shouldQuit, 1);
+  while(gsAtomicLoad(&renderer->runningWorkerCount))
+    {
+      gsSleep(SOFTWARE_RENDER_POLL_MSEC);
+    }
+
+  arenaEnd(renderer->frameArena);
+  gsArenaDiscard(renderer->frameArena);
+  renderer->frameArena = 0;
+}
+
+// NOTE: draws the commands' quads over what the framebuffer holds, and returns once they're drawn
+static void
+softwareRenderCommands(SoftwareRenderer *renderer, RenderCommands *commands,
+		       SoftwareFramebuffer *framebuffer)
+{
+  Arena *frameArena = renderer->frameArena;
+  arenaEnd(frameArena);
+
+  u32 tileCountX = (framebuffer->width + SOFTWARE_RENDER_TILE_SIZE - 1)/SOFTWARE_RENDER_TILE_SIZE;
+  u32 tileCountY = (framebuffer->height + SOFTWARE_RENDER_TILE_SIZE - 1)/SOFTWARE_RENDER_TILE_SIZE;
+  u32 tileCount = tileCountX*tileCountY;
+  SoftwareRenderTile *tiles = arenaPushArray(frameArena, tileCount, SoftwareRenderTile,
+					     arenaFlagsZeroNoAlign());
+  for(u32 tileY = 0; tileY < tileCountY; ++tileY)
+    {
+      for(u32 tileX = 0; tileX < tileCountX; ++tileX)
+	{
+	  SoftwareRenderTile *tile = tiles + tileY*tileCountX + tileX;
+	  tile->minX = tileX*SOFTWARE_RENDER_TILE_SIZE;
+	  tile->minY = tileY*SOFTWARE_RENDER_TILE_SIZE;
+	  tile->maxX = MIN(tile->minX + SOFTWARE_RENDER_TILE_SIZE, framebuffer->width);
+	  tile->maxY = MIN(tile->minY + SOFTWARE_RENDER_TILE_SIZE, framebuffer->height);
+	}
+    }
+
+  // NOTE: bin the quads. Counted first, so every tile's list can be one run of a shared array
+  SoftwareQuad *quads = arenaPushArray(frameArena, commands->quadCount, SoftwareQuad);
+  u32 quadCount = 0;
+  usz binnedCount = 0;
+  for(u32 quadIndex = 0; quadIndex < commands->quadCount; ++quadIndex)
+    {
+      SoftwareQuad *quad = quads + quadCount;
+      if(softwareSetupQuad(quad, commands->quads + quadIndex, framebuffer))
+	{
+	  ++quadCount;
+	  for(u32 tileY = quad->minY/SOFTWARE_RENDER_TILE_SIZE;
+	      tileY <= (u32)(quad->maxY - 1)/SOFTWARE_RENDER_TILE_SIZE; ++tileY)
+	    {
+	      for(u32 tileX = quad->minX/SOFTWARE_RENDER_TILE_SIZE;
+		  tileX <= (u32)(quad->maxX - 1)/SOFTWARE_RENDER_TILE_SIZE; ++tileX)
+		{
+		  ++tiles[tileY*tileCountX + tileX].quadCount;
+		  ++binnedCount;
+		}
+	    }
+	}
+    }
+
+  u32 *bins = arenaPushArray(frameArena, binnedCount, u32);
+  for(u32 tileIndex = 0; tileIndex < tileCount; ++tileIndex)
+    {
+      tiles[tileIndex].quadIndices = bins;
+      bins += tiles[tileIndex].quadCount;
+      tiles[tileIndex].quadCount = 0;
+    }
+
+  for(u32 setupIndex = 0; setupIndex < quadCount; ++setupIndex)
+    {
+      SoftwareQuad *quad = quads + setupIndex;
+      for(u32 tileY = quad->minY/SOFTWARE_RENDER_TILE_SIZE;
+	  tileY <= (u32)(quad->maxY - 1)/SOFTWARE_RENDER_TILE_SIZE; ++tileY)
+	{
+	  for(u32 tileX = quad->minX/SOFTWARE_RENDER_TILE_SIZE;
+	      tileX <= (u32)(quad->maxX - 1)/SOFTWARE_RENDER_TILE_SIZE; ++tileX)
+	    {
+	      SoftwareRenderTile *tile = tiles + tileY*tileCountX + tileX;
+	      tile->quadIndices[tile->quadCount++] = setupIndex;
+	    }
+	}
+    }
+
+  // NOTE: hand the frame out. Workers that wake up late for an earlier frame find the tile index
+  //       parked at SOFTWARE_RENDER_TILE_IDLE until the frame is fully published
+  renderer->framebuffer = framebuffer;
+  renderer->atlas = commands->atlas;
+  renderer->quads = quads;
+  renderer->tiles = tiles;
+  gsAtomicStore(&renderer->tileCount, tileCount);
+  gsAtomicStore(&renderer->doneTileCount, 0);
+  gsAtomicStore(&renderer->nextTileIndex, 0);
+  gsAtomicAdd(&renderer->frameIndex, 1);
+
+  softwareDrawTiles(renderer);
+  while(gsAtomicLoad(&renderer->doneTileCount) < tileCount)
+    {
+      gsSleep(0);
+    }
+
+  gsAtomicStore(&renderer->nextTileIndex, SOFTWARE_RENDER_TILE_IDLE);
+}
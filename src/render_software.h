@@ -0,0 +1,73 @@
+// NOTE: a cpu backend for RenderCommands, for hosts without a gpu. It draws what the gl backend
+//       draws: quads go down in order, are depth tested against their level with LEQUAL, sample
+//       the atlas bilinearly with clamped edges, discard texels with zero alpha, and blend with
+//       SRC_ALPHA, ONE_MINUS_SRC_ALPHA.
+//       The framebuffer is cut into tiles, and each tile gets the list of quads that touch it, so
+//       tiles can be drawn by any thread in any order. Pixels are RGBA8 with the bottom row first,
+//       like glReadPixels gives them
+#define SOFTWARE_RENDER_TILE_SIZE 64 // NOTE: has to be a multiple of WIDE_WIDTH
+#define SOFTWARE_RENDER_MAX_WORKER_COUNT 32
+#define SOFTWARE_RENDER_POLL_MSEC 1
+#define SOFTWARE_RENDER_SPIN_COUNT 4096
+#define SOFTWARE_RENDER_TILE_IDLE 0x80000000 // NOTE: no frame is being drawn
+
+struct SoftwareFramebuffer
+{
+  u32 width;
+  u32 height;
+  u32 stride; // NOTE: in pixels, a multiple of WIDE_WIDTH
+
+  u32 *pixels;
+  r32 *depth; // NOTE: levels, cleared to the far plane at 1
+};
+
+// NOTE: a quad, set up for drawing. Pixel centers are mapped back into the quad's pattern space,
+//       where the quad covers [-1, 1] on both axes
+struct SoftwareQuad
+{
+  v2 patternX; // NOTE: the pattern space change per pixel in x
+  v2 patternY; // NOTE: ... and in y
+  v2 patternOffset;
+
+  v2 uvMin;
+  v2 uvDim;
+  v4 color;
+  r32 level;
+
+  s32 minX;
+  s32 minY;
+  s32 maxX; // NOTE: exclusive
+  s32 maxY;
+};
+
+struct SoftwareRenderTile
+{
+  u32 minX;
+  u32 minY;
+  u32 maxX;
+  u32 maxY;
+
+  u32 quadCount;
+  u32 *quadIndices;
+};
+
+struct SoftwareRenderer
+{
+  Arena *frameArena;
+
+  u32 workerCount;
+  volatile u32 runningWorkerCount;
+  volatile u32 shouldQuit;
+
+  // NOTE: a frame is started by bumping frameIndex. Workers and the thread that started it take
+  //       tiles until none are left, and the frame is done once every tile is
+  volatile u32 frameIndex;
+  volatile u32 nextTileIndex;
+  volatile u32 doneTileCount;
+
+  SoftwareFramebuffer *framebuffer;
+  LoadedBitmap *atlas;
+  SoftwareQuad *quads;
+  SoftwareRenderTile *tiles;
+  volatile u32 tileCount;
+};
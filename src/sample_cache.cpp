@@ -0,0 +1,358 @@
+//
+// sample cache
+//
+
+static void
+sampleCacheLock_(SampleCache *cache)
+{
+  while(gsAtomicCompareAndSwap(&cache->lock, 0, 1) != 0)
+    {
+      gsSleep(0);
+    }
+}
+
+static void
+sampleCacheUnlock_(SampleCache *cache)
+{
+  gsAtomicStore(&cache->lock, 0);
+}
+
+static String8
+sampleCacheEntryPath_(Arena *arena, SampleCache *cache, u64 sourceHash)
+{
+  String8 result = arenaPushStringFormat(arena, "%.*s%016llx.samples",
+					 (int)cache->directory.size, cache->directory.str, sourceHash);
+  return(result);
+}
+
+static String8
+sampleCacheIndexPath_(Arena *arena, SampleCache *cache)
+{
+  String8 result = arenaPushStringFormat(arena, "%.*ssamples.index",
+					 (int)cache->directory.size, cache->directory.str);
+  return(result);
+}
+
+// NOTE: a missing or damaged index reads as empty. Entries it loses track of stay on disk until
+//       the same source is cached again
+static void
+sampleCacheReadIndex_(SampleCache *cache, SampleCacheIndex *index)
+{
+  TemporaryMemory scratch = arenaGetScratch(0, 0);
+
+  ZERO_STRUCT(index);
+  String8 path = sampleCacheIndexPath_(scratch.arena, cache);
+  Buffer file = gsReadEntireFile((char *)path.str, scratch.arena);
+  if(file.contents && file.size == sizeof(SampleCacheIndex))
+    {
+      COPY_SIZE(index, file.contents, sizeof(SampleCacheIndex));
+    }
+  if(index->magic != SAMPLE_CACHE_MAGIC || index->version != SAMPLE_CACHE_VERSION ||
+     index->entryCount > SAMPLE_CACHE_MAX_ENTRY_COUNT)
+    {
+      ZERO_STRUCT(index);
+    }
+  index->magic = SAMPLE_CACHE_MAGIC;
+  index->version = SAMPLE_CACHE_VERSION;
+
+  arenaReleaseScratch(scratch);
+}
+
+static void
+sampleCacheWriteIndex_(SampleCache *cache, SampleCacheIndex *index)
+{
+  TemporaryMemory scratch = arenaGetScratch(0, 0);
+
+  String8 path = sampleCacheIndexPath_(scratch.arena, cache);
+  gsWriteEntireFile((char *)path.str, bufferMake(index, sizeof(SampleCacheIndex)));
+
+  arenaReleaseScratch(scratch);
+}
+
+static SampleCacheIndexEntry *
+sampleCacheFindEntry_(SampleCacheIndex *index, u64 sourceHash, u64 sourceSize)
+{
+  SampleCacheIndexEntry *result = 0;
+  for(u32 entryIndex = 0; entryIndex < index->entryCount; ++entryIndex)
+    {
+      SampleCacheIndexEntry *entry = index->entries + entryIndex;
+      if(entry->sourceHash == sourceHash && entry->sourceSize == sourceSize)
+	{
+	  result = entry;
+	  break;
+	}
+    }
+
+  return(result);
+}
+
+// NOTE: removes an entry's file, and then the entry. Returns false, keeping the entry, if the file
+//       can't be removed, eg while it's mapped on windows
+static b32
+sampleCacheRemoveEntry_(SampleCache *cache, SampleCacheIndex *index, SampleCacheIndexEntry *entry)
+{
+  TemporaryMemory scratch = arenaGetScratch(0, 0);
+
+  String8 path = sampleCacheEntryPath_(scratch.arena, cache, entry->sourceHash);
+  b32 result = gsRemoveFile((char *)path.str);
+  if(result)
+    {
+      *entry = index->entries[--index->entryCount];
+    }
+
+  arenaReleaseScratch(scratch);
+  return(result);
+}
+
+// NOTE: evicts the least recently used entries until one of `incomingSize` bytes fits. Returns
+//       false if it can't be made to fit
+static b32
+sampleCacheEvict_(SampleCache *cache, SampleCacheIndex *index, u64 incomingSize)
+{
+  b32 result = false;
+  for(;;)
+    {
+      u64 totalSize = 0;
+      SampleCacheIndexEntry *oldest = 0;
+      for(u32 entryIndex = 0; entryIndex < index->entryCount; ++entryIndex)
+	{
+	  SampleCacheIndexEntry *entry = index->entries + entryIndex;
+	  totalSize += entry->fileSize;
+	  if(!oldest || entry->lastUse < oldest->lastUse) oldest = entry;
+	}
+
+      result = (index->entryCount < MIN(cache->maxEntryCount, SAMPLE_CACHE_MAX_ENTRY_COUNT) &&
+		totalSize + incomingSize <= cache->maxSize);
+      if(result || !oldest) break;
+      if(!sampleCacheRemoveEntry_(cache, index, oldest)) break;
+    }
+
+  return(result);
+}
+
+// NOTE: a hash that another thread is decoding, and will cache, is left to that thread. Returns
+//       false if the hash is taken, or there's no room to claim it
+static b32
+sampleCacheClaim_(SampleCache *cache, u64 sourceHash)
+{
+  u64 *freeSlot = 0;
+  b32 result = true;
+  for(u32 slotIndex = 0; slotIndex < ARRAY_COUNT(cache->pendingHashes); ++slotIndex)
+    {
+      u64 *slot = cache->pendingHashes + slotIndex;
+      if(*slot == sourceHash) result = false;
+      if(!*slot && !freeSlot) freeSlot = slot;
+    }
+
+  result = result && (freeSlot != 0);
+  if(result) *freeSlot = sourceHash;
+
+  return(result);
+}
+
+static void
+sampleCacheUnclaim_(SampleCache *cache, u64 sourceHash)
+{
+  for(u32 slotIndex = 0; slotIndex < ARRAY_COUNT(cache->pendingHashes); ++slotIndex)
+    {
+      if(cache->pendingHashes[slotIndex] == sourceHash) cache->pendingHashes[slotIndex] = 0;
+    }
+}
+
+static SampleCacheHeader
+sampleCacheLayout_(u64 sourceHash, u64 sourceSize, LoadedSound *sound)
+{
+  SampleCacheHeader result = {};
+  result.magic = SAMPLE_CACHE_MAGIC;
+  result.version = SAMPLE_CACHE_VERSION;
+  result.sourceHash = sourceHash;
+  result.sourceSize = sourceSize;
+  result.frameCount = sound->sampleCount;
+  result.channelCount = sound->channelCount;
+  result.sampleRate = INTERNAL_SAMPLE_RATE;
+
+  u64 channelSize = (result.frameCount + SAMPLE_CACHE_CHANNEL_PADDING)*sizeof(r32);
+  result.channelOffsets[0] = SAMPLE_CACHE_ALIGNMENT;
+  result.channelOffsets[1] = ALIGN_POW_2(result.channelOffsets[0] + channelSize, SAMPLE_CACHE_CHANNEL_ALIGNMENT);
+  result.fileSize = result.channelOffsets[1] + channelSize;
+
+  return(result);
+}
+
+static b32
+sampleCacheEntryIsValid_(Buffer mapping, u64 sourceHash, u64 sourceSize)
+{
+  b32 result = false;
+  if(mapping.contents && mapping.size >= SAMPLE_CACHE_ALIGNMENT)
+    {
+      SampleCacheHeader *header = (SampleCacheHeader *)mapping.contents;
+      LoadedSound shape = {};
+      shape.sampleCount = (u32)header->frameCount;
+      shape.channelCount = header->channelCount;
+      SampleCacheHeader expected = sampleCacheLayout_(sourceHash, sourceSize, &shape);
+      result = (header->frameCount > 0 && header->frameCount <= u32_MAX &&
+		header->fileSize == mapping.size &&
+		header->magic == expected.magic && header->version == expected.version &&
+		header->sourceHash == expected.sourceHash && header->sourceSize == expected.sourceSize &&
+		header->fileSize == expected.fileSize && header->sampleRate == expected.sampleRate &&
+		header->channelOffsets[0] == expected.channelOffsets[0] &&
+		header->channelOffsets[1] == expected.channelOffsets[1]);
+    }
+
+  return(result);
+}
+
+// NOTE: writes the samples before the header, so the entry only becomes valid once it's complete.
+//       An old file of the same name is removed first, rather than truncated, in case another
+//       process still has it mapped
+static b32
+sampleCacheWriteEntry_(SampleCache *cache, SampleCacheHeader *header, LoadedSound *sound)
+{
+  TemporaryMemory scratch = arenaGetScratch(0, 0);
+
+  String8 path = sampleCacheEntryPath_(scratch.arena, cache, header->sourceHash);
+  gsRemoveFile((char *)path.str);
+  GS_File file = gsOpenFileForWriting((char *)path.str, true);
+  b32 result = (file != 0);
+  if(result)
+    {
+      usz channelSize = header->frameCount*sizeof(r32);
+      r32 *samplesR = sound->samples[1] ? sound->samples[1] : sound->samples[0];
+      r32 padding[SAMPLE_CACHE_CHANNEL_PADDING] = {};
+      Buffer paddingBuffer = bufferMake(padding, sizeof(padding));
+      result = (gsWriteFileAt(file, header->channelOffsets[0], bufferMake(sound->samples[0], channelSize)) &&
+		gsWriteFileAt(file, header->channelOffsets[0] + channelSize, paddingBuffer) &&
+		gsWriteFileAt(file, header->channelOffsets[1], bufferMake(samplesR, channelSize)) &&
+		gsWriteFileAt(file, header->channelOffsets[1] + channelSize, paddingBuffer) &&
+		gsWriteFileAt(file, 0, bufferMake(header, sizeof(SampleCacheHeader))));
+      gsCloseFile(file);
+
+      if(!result)
+	{
+	  logFormatString("ERROR: could not write sample cache entry %s\n", (char *)path.str);
+	  gsRemoveFile((char *)path.str);
+	}
+    }
+
+  arenaReleaseScratch(scratch);
+  return(result);
+}
+
+// NOTE: `directory` must end in a separator. The cache has to outlive every sound loaded through it
+static SampleCache *
+sampleCacheCreate(Arena *allocator, String8 directory, u64 maxSize)
+{
+  SampleCache *result = arenaPushStruct(allocator, SampleCache, arenaFlagsZeroNoAlign());
+  result->directory = arenaPushString(allocator, directory);
+  result->maxSize = maxSize;
+  result->maxEntryCount = SAMPLE_CACHE_MAX_ENTRY_COUNT;
+
+  return(result);
+}
+
+// NOTE: loadWav through the cache. A hit costs mapping the source to hash it, and mapping the
+//       entry; a miss decodes into `arena` as loadWav does, and caches the result
+static CachedSound
+sampleCacheLoadWav(SampleCache *cache, Arena *arena, String8 path)
+{
+  CachedSound result = {};
+  TemporaryMemory scratch = arenaGetScratch(&arena, 1);
+
+  Buffer file = gsMapFile((char *)path.str);
+  b32 isMapped = (file.contents != 0);
+  if(!isMapped)
+    {
+      file = gsReadEntireFile((char *)path.str, scratch.arena);
+    }
+
+  WavInfo info = {};
+  if(wavParse(file, &info))
+    {
+      u64 sourceHash = grainPackfileChecksum(GRAIN_PACKFILE_CHECKSUM_SEED, file.contents, file.size);
+      u64 sourceSize = file.size;
+      String8 entryPath = sampleCacheEntryPath_(scratch.arena, cache, sourceHash);
+      SampleCacheIndex *index = arenaPushStruct(scratch.arena, SampleCacheIndex);
+
+      sampleCacheLock_(cache);
+      sampleCacheReadIndex_(cache, index);
+      SampleCacheIndexEntry *entry = sampleCacheFindEntry_(index, sourceHash, sourceSize);
+      if(entry)
+	{
+	  Buffer mapping = gsMapFile((char *)entryPath.str);
+	  if(sampleCacheEntryIsValid_(mapping, sourceHash, sourceSize))
+	    {
+	      SampleCacheHeader *header = (SampleCacheHeader *)mapping.contents;
+	      result.sound.sampleCount = (u32)header->frameCount;
+	      result.sound.channelCount = header->channelCount;
+	      result.sound.samples[0] = (r32 *)(mapping.contents + header->channelOffsets[0]);
+	      result.sound.samples[1] = (r32 *)(mapping.contents + header->channelOffsets[1]);
+	      result.mapping = mapping;
+	      result.wasCached = true;
+
+	      entry->lastUse = ++index->useClock;
+	      sampleCacheWriteIndex_(cache, index);
+	    }
+	  else
+	    {
+	      // NOTE: damaged, or cut short while it was written; it's decoded and cached again
+	      logFormatString("WARNING: invalid sample cache entry %s\n", (char *)entryPath.str);
+	      if(mapping.contents) gsUnmapFile(mapping);
+	      if(sampleCacheRemoveEntry_(cache, index, entry))
+		{
+		  sampleCacheWriteIndex_(cache, index);
+		  entry = 0;
+		}
+	    }
+	}
+      b32 claimed = (!result.wasCached && !entry && sampleCacheClaim_(cache, sourceHash));
+      sampleCacheUnlock_(cache);
+
+      if(!result.wasCached)
+	{
+	  result.sound = wavDecode(arena, &info, simdGetLevel());
+	}
+
+      if(claimed)
+	{
+	  SampleCacheHeader header = sampleCacheLayout_(sourceHash, sourceSize, &result.sound);
+	  b32 written = (result.sound.sampleCount && header.fileSize <= cache->maxSize &&
+			 sampleCacheWriteEntry_(cache, &header, &result.sound));
+
+	  sampleCacheLock_(cache);
+	  if(written)
+	    {
+	      sampleCacheReadIndex_(cache, index);
+	      if(!sampleCacheFindEntry_(index, sourceHash, sourceSize))
+		{
+		  if(sampleCacheEvict_(cache, index, header.fileSize))
+		    {
+		      SampleCacheIndexEntry *newEntry = index->entries + index->entryCount++;
+		      newEntry->sourceHash = sourceHash;
+		      newEntry->sourceSize = sourceSize;
+		      newEntry->fileSize = header.fileSize;
+		      newEntry->lastUse = ++index->useClock;
+		    }
+		  else
+		    {
+		      gsRemoveFile((char *)entryPath.str);
+		    }
+		  sampleCacheWriteIndex_(cache, index);
+		}
+	    }
+	  sampleCacheUnclaim_(cache, sourceHash);
+	  sampleCacheUnlock_(cache);
+	}
+    }
+
+  if(isMapped) gsUnmapFile(file);
+  arenaReleaseScratch(scratch);
+
+  return(result);
+}
+
+static void
+sampleCacheRelease(CachedSound *sound)
+{
+  if(sound->mapping.contents) gsUnmapFile(sound->mapping);
+  ZERO_STRUCT(sound);
+}
@@ -0,0 +1,71 @@
+// NOTE: an on-disk cache of decoded sounds, so a large source file is only decoded and resampled
+//       once. Entries are keyed by a hash of the source file's contents, and hold the sound as
+//       planar 32-bit floats at INTERNAL_SAMPLE_RATE, page-aligned, so a hit maps the entry and
+//       points the sound straight into the mapping.
+//       The directory holds one file per entry, named after its hash, and an index of the entries
+//       with their sizes and last uses. Adding an entry evicts the least recently used ones until
+//       the cache fits its size and entry limits. An entry's header is written last, so a partly
+//       written entry reads as invalid, and is decoded again.
+//       The index is guarded within a process only; processes sharing a directory can lose each
+//       other's index updates, which costs cache hits, never wrong samples
+#define SAMPLE_CACHE_MAGIC FOURCC("GSSC")
+#define SAMPLE_CACHE_VERSION 2 // NOTE: bump when the decoder's output changes, eg the resampler
+#define SAMPLE_CACHE_ALIGNMENT 4096
+#define SAMPLE_CACHE_CHANNEL_ALIGNMENT 64
+// NOTE: zeroed frames after each channel, so interpolating reads just past the last sample stay
+//       inside the mapping
+#define SAMPLE_CACHE_CHANNEL_PADDING 4
+#define SAMPLE_CACHE_MAX_ENTRY_COUNT 64
+#define SAMPLE_CACHE_DEFAULT_MAX_SIZE GIGABYTES(2)
+
+struct SampleCacheHeader
+{
+  u32 magic;
+  u32 version;
+  u64 sourceHash;
+  u64 sourceSize;
+  u64 fileSize;
+
+  u64 frameCount;
+  u32 channelCount;  // NOTE: of the source; there are always two channels stored
+  u32 sampleRate;
+  u64 channelOffsets[2];
+};
+
+struct SampleCacheIndexEntry
+{
+  u64 sourceHash;
+  u64 sourceSize;
+  u64 fileSize;
+  u64 lastUse;
+};
+
+struct SampleCacheIndex
+{
+  u32 magic;
+  u32 version;
+  u32 entryCount;
+  u32 reserved;
+  u64 useClock;
+  SampleCacheIndexEntry entries[SAMPLE_CACHE_MAX_ENTRY_COUNT];
+};
+
+struct SampleCache
+{
+  String8 directory; // NOTE: including the trailing separator. The directory has to exist
+  u64 maxSize;
+  u32 maxEntryCount;
+
+  // NOTE: guards the index, and the hashes being decoded, which other threads don't cache again
+  volatile u32 lock;
+  u64 pendingHashes[8];
+};
+
+// NOTE: a sound from the cache, or freshly decoded if it missed. Hits point into `mapping`, which
+//       stays mapped until the sound is released
+struct CachedSound
+{
+  LoadedSound sound;
+  Buffer mapping;
+  b32 wasCached;
+};
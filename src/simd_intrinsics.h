@@ -12,6 +12,13 @@ static WideFloat wideAddFloats(WideFloat a, WideFloat b);
 static WideFloat wideSubFloats(WideFloat a, WideFloat b);
 static WideFloat wideMulFloats(WideFloat a, WideFloat b);
 static WideFloat wideMaskFloats(WideFloat a, WideFloat b, WideInt mask);
+static WideFloat wideMulAddFloats(WideFloat a, WideFloat b, WideFloat c);
+static WideFloat wideGatherFloats(r32 *base, WideInt indices);
+static WideFloat wideMaskLoadFloats(r32 *src, WideInt mask);
+static void      wideMaskStoreFloats(r32 *dest, WideFloat src, WideInt mask);
+static WideFloat wideLoadS8Floats(s8 *src);
+static WideFloat wideLoadS16Floats(s16 *src);
+static WideFloat wideLoadS32Floats(s32 *src);
 
 static WideInt	 wideLoadInts(u32 *src);
 static WideInt	 wideSetConstantInts(u32 src);
@@ -22,11 +29,26 @@ static WideInt	 wideAddInts(WideInt a, WideInt b);
 static WideInt	 wideSubInts(WideInt a, WideInt b);
 static WideInt	 wideMulInts(WideInt a, WideInt b);
 static WideInt   wideAndInts(WideInt a, WideInt b);
+static WideInt   wideOrInts(WideInt a, WideInt b);
+static WideInt   wideShiftLeftInts(WideInt a, u32 count);
+static WideInt   wideShiftRightInts(WideInt a, u32 count);
+static WideInt   wideMaskInts(WideInt a, WideInt b, WideInt mask);
+static WideInt   wideGatherInts(u32 *base, WideInt indices);
+static b32       wideMaskIsZero(WideInt mask);
+
+static WideFloat wideMinFloats(WideFloat a, WideFloat b);
+static WideFloat wideMaxFloats(WideFloat a, WideFloat b);
+static WideInt   wideCompareLessFloats(WideFloat a, WideFloat b);
+static WideInt   wideCompareLessEqualFloats(WideFloat a, WideFloat b);
+static WideFloat wideConvertIntsToFloats(WideInt a);
+static WideInt   wideTruncateFloatsToInts(WideFloat a);
 
 #if ARCH_X86 || ARCH_X64
 
 #include <immintrin.h>
 
+#define WIDE_WIDTH 4
+
 union WideFloat
 {
   __m128 val;
@@ -193,12 +215,20 @@ wideMaskFloats(WideFloat a, WideFloat b, WideInt mask)
   return(result);
 }
 
+// NOTE: the low 32 bits of each product, like the other backends give
 static WideInt
 wideMulInts(WideInt a, WideInt b)
 {
   WideInt result = {};
-  result.val = _mm_mul_epi32(a.val, b.val);
-  
+#if defined(__SSE4_1__)
+  result.val = _mm_mullo_epi32(a.val, b.val);
+#else
+  __m128i even = _mm_mul_epu32(a.val, b.val);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.val, 32), _mm_srli_epi64(b.val, 32));
+  result.val = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+				  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+
   return(result);
 }
 
@@ -211,10 +241,226 @@ wideAndInts(WideInt a, WideInt b)
   return(result);
 }
 
+// NOTE: a*b + c
+static WideFloat
+wideMulAddFloats(WideFloat a, WideFloat b, WideFloat c)
+{
+  WideFloat result = {};
+#if defined(__FMA__)
+  result.val = _mm_fmadd_ps(a.val, b.val, c.val);
+#else
+  result.val = _mm_add_ps(_mm_mul_ps(a.val, b.val), c.val);
+#endif
+
+  return(result);
+}
+
+static WideFloat
+wideGatherFloats(r32 *base, WideInt indices)
+{
+  WideFloat result = {};
+#if defined(__AVX2__)
+  result.val = _mm_i32gather_ps(base, indices.val, sizeof(r32));
+#else
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      result.floats[lane] = base[indices.ints[lane]];
+    }
+#endif
+
+  return(result);
+}
+
+// NOTE: lanes whose mask is clear are zeroed, and their memory is never touched
+static WideFloat
+wideMaskLoadFloats(r32 *src, WideInt mask)
+{
+  WideFloat result = {};
+#if defined(__AVX__)
+  result.val = _mm_maskload_ps(src, mask.val);
+#else
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      if(mask.ints[lane]) result.floats[lane] = src[lane];
+    }
+#endif
+
+  return(result);
+}
+
+static void
+wideMaskStoreFloats(r32 *dest, WideFloat src, WideInt mask)
+{
+#if defined(__AVX__)
+  _mm_maskstore_ps(dest, mask.val, src.val);
+#else
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      if(mask.ints[lane]) dest[lane] = src.floats[lane];
+    }
+#endif
+}
+
+static WideInt
+wideOrInts(WideInt a, WideInt b)
+{
+  WideInt result = {};
+  result.val = _mm_or_si128(a.val, b.val);
+
+  return(result);
+}
+
+static WideInt
+wideShiftLeftInts(WideInt a, u32 count)
+{
+  WideInt result = {};
+  result.val = _mm_sll_epi32(a.val, _mm_cvtsi32_si128((int)count));
+
+  return(result);
+}
+
+// NOTE: logical, zeros are shifted in
+static WideInt
+wideShiftRightInts(WideInt a, u32 count)
+{
+  WideInt result = {};
+  result.val = _mm_srl_epi32(a.val, _mm_cvtsi32_si128((int)count));
+
+  return(result);
+}
+
+static WideInt
+wideMaskInts(WideInt a, WideInt b, WideInt mask)
+{
+  WideInt result = {};
+  result.val = _mm_or_si128(_mm_and_si128(mask.val, a.val),
+			    _mm_andnot_si128(mask.val, b.val));
+
+  return(result);
+}
+
+static WideInt
+wideGatherInts(u32 *base, WideInt indices)
+{
+  WideInt result = {};
+#if defined(__AVX2__)
+  result.val = _mm_i32gather_epi32((int *)base, indices.val, sizeof(u32));
+#else
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      result.ints[lane] = base[indices.ints[lane]];
+    }
+#endif
+
+  return(result);
+}
+
+static b32
+wideMaskIsZero(WideInt mask)
+{
+  b32 result = (_mm_movemask_epi8(mask.val) == 0);
+
+  return(result);
+}
+
+static WideFloat
+wideMinFloats(WideFloat a, WideFloat b)
+{
+  WideFloat result = {};
+  result.val = _mm_min_ps(a.val, b.val);
+
+  return(result);
+}
+
+static WideFloat
+wideMaxFloats(WideFloat a, WideFloat b)
+{
+  WideFloat result = {};
+  result.val = _mm_max_ps(a.val, b.val);
+
+  return(result);
+}
+
+// NOTE: comparisons set every bit of a lane where they hold, so they can be used as masks
+static WideInt
+wideCompareLessFloats(WideFloat a, WideFloat b)
+{
+  WideInt result = {};
+  result.val = _mm_castps_si128(_mm_cmplt_ps(a.val, b.val));
+
+  return(result);
+}
+
+static WideInt
+wideCompareLessEqualFloats(WideFloat a, WideFloat b)
+{
+  WideInt result = {};
+  result.val = _mm_castps_si128(_mm_cmple_ps(a.val, b.val));
+
+  return(result);
+}
+
+// NOTE: the ints are taken as signed
+static WideFloat
+wideConvertIntsToFloats(WideInt a)
+{
+  WideFloat result = {};
+  result.val = _mm_cvtepi32_ps(a.val);
+
+  return(result);
+}
+
+static WideInt
+wideTruncateFloatsToInts(WideFloat a)
+{
+  WideInt result = {};
+  result.val = _mm_cvttps_epi32(a.val);
+
+  return(result);
+}
+
+// NOTE: sign-extending loads of packed integers, converted to floats without scaling
+static WideFloat
+wideLoadS8Floats(s8 *src)
+{
+  WideFloat result = {};
+  // NOTE: assembled from bytes, which compiles to a single unaligned load
+  u8 *bytes = (u8 *)src;
+  s32 packed = (s32)(bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((u32)bytes[3] << 24));
+  __m128i lanes = _mm_cvtsi32_si128(packed);
+  __m128i words = _mm_unpacklo_epi8(lanes, lanes);
+  __m128i ints = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 24);
+  result.val = _mm_cvtepi32_ps(ints);
+
+  return(result);
+}
+
+static WideFloat
+wideLoadS16Floats(s16 *src)
+{
+  WideFloat result = {};
+  __m128i words = _mm_loadl_epi64((__m128i *)src);
+  __m128i ints = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+  result.val = _mm_cvtepi32_ps(ints);
+
+  return(result);
+}
+
+static WideFloat
+wideLoadS32Floats(s32 *src)
+{
+  WideFloat result = {};
+  result.val = _mm_cvtepi32_ps(_mm_loadu_si128((__m128i *)src));
+
+  return(result);
+}
+
 #elif ARCH_ARM || ARCH_ARM64
 
 #include <arm_neon.h>
 
+#define WIDE_WIDTH 4
+
 union WideFloat
 {
   float32x4_t val;
@@ -388,324 +634,1487 @@ wideAndInts(WideInt a, WideInt b)
   return(result);
 }
 
-#elif ARCH_WASM32 || ARCH_WASM64
-
-#include <wasm_simd128.h>
-
-union WideFloat
-{
-  v128_t val;
-  r32 floats[4];
-};
-
-union WideInt
-{
-  v128_t val;
-  u32 ints[4];
-};
-
+// NOTE: a*b + c
 static WideFloat
-wideLoadFloats(r32 *src)
+wideMulAddFloats(WideFloat a, WideFloat b, WideFloat c)
 {
   WideFloat result = {};
-  result.val = wasm_v128_load(src);
+#if ARCH_ARM64
+  result.val = vfmaq_f32(c.val, a.val, b.val);
+#else
+  result.val = vmlaq_f32(c.val, a.val, b.val);
+#endif
+
   return(result);
 }
 
+// NOTE: neon has no gather, so lanes are loaded one at a time
 static WideFloat
-wideSetConstantFloats(r32 src)
+wideGatherFloats(r32 *base, WideInt indices)
 {
   WideFloat result = {};
-  result.val = wasm_f32x4_make(src, src, src, src);
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      result.floats[lane] = base[indices.ints[lane]];
+    }
+
   return(result);
 }
 
+// NOTE: lanes whose mask is clear are zeroed, and their memory is never touched
 static WideFloat
-wideSetFloats(r32 a, r32 b, r32 c, r32 d)
+wideMaskLoadFloats(r32 *src, WideInt mask)
 {
   WideFloat result = {};
-  result.val = wasm_f32x4_make(a, b, c, d);
-  return(result);
-}
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      if(mask.ints[lane]) result.floats[lane] = src[lane];
+    }
 
-static void
-wideSetLaneFloats(WideFloat *w, r32 val, u32 lane)
-{
-  // NOTE: this sucks
-  // switch(lane)
-  //   {
-  //   case 0: { w->val = wasm_f32x4_replace_lane(w->val, 0, val); } break;
-  //   case 1: { w->val = wasm_f32x4_replace_lane(w->val, 1, val); } break;
-  //   case 2: { w->val = wasm_f32x4_replace_lane(w->val, 2, val); } break;
-  //   case 3: { w->val = wasm_f32x4_replace_lane(w->val, 3, val); } break;
-  //   default: { ASSERT(!"lane index out of bounds"); } break;
-  //   }
-  w->floats[lane] = val;
+  return(result);
 }
 
 static void
-wideStoreFloats(r32 *dest, WideFloat src)
-{
-  wasm_v128_store(dest, src.val);
-}
-
-static WideFloat
-wideAddFloats(WideFloat a, WideFloat b)
+wideMaskStoreFloats(r32 *dest, WideFloat src, WideInt mask)
 {
-  WideFloat result = {};
-  result.val = wasm_f32x4_add(a.val, b.val);
-  return(result);
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      if(mask.ints[lane]) dest[lane] = src.floats[lane];
+    }
 }
 
-static WideFloat
-wideSubFloats(WideFloat a, WideFloat b)
+static WideInt
+wideOrInts(WideInt a, WideInt b)
 {
-  WideFloat result = {};
-  result.val = wasm_f32x4_sub(a.val, b.val);
+  WideInt result = {};
+  result.val = vorrq_u32(a.val, b.val);
   return(result);
 }
 
-static WideFloat
-wideMulFloats(WideFloat a, WideFloat b)
+static WideInt
+wideShiftLeftInts(WideInt a, u32 count)
 {
-  WideFloat result = {};
-  result.val = wasm_f32x4_mul(a.val, b.val);
+  WideInt result = {};
+  result.val = vshlq_u32(a.val, vdupq_n_s32((s32)count));
   return(result);
 }
 
-static WideFloat
-wideMaskFloats(WideFloat a, WideFloat b, WideInt mask)
+// NOTE: logical, zeros are shifted in
+static WideInt
+wideShiftRightInts(WideInt a, u32 count)
 {
-  WideFloat result = {};
-  result.val = wasm_v128_or(wasm_v128_and(a.val, mask.val),
-			    wasm_v128_andnot(b.val, mask.val));
+  WideInt result = {};
+  result.val = vshlq_u32(a.val, vdupq_n_s32(-(s32)count));
   return(result);
 }
 
 static WideInt
-wideLoadInts(u32 *src)
+wideMaskInts(WideInt a, WideInt b, WideInt mask)
 {
   WideInt result = {};
-  result.val = wasm_v128_load(src);
+  result.val = vbslq_u32(mask.val, a.val, b.val);
   return(result);
 }
 
 static WideInt
-wideSetConstantInts(u32 src)
+wideGatherInts(u32 *base, WideInt indices)
 {
   WideInt result = {};
-  result.val = wasm_u32x4_make(src, src, src, src);
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      result.ints[lane] = base[indices.ints[lane]];
+    }
   return(result);
 }
 
-static WideInt
-wideSetInts(u32 a, u32 b, u32 c, u32 d)
+static b32
+wideMaskIsZero(WideInt mask)
 {
-  WideInt result = {};
-  result.val = wasm_u32x4_make(a, b, c, d);
+#if ARCH_ARM64
+  b32 result = (vmaxvq_u32(mask.val) == 0);
+#else
+  uint32x2_t halves = vorr_u32(vget_low_u32(mask.val), vget_high_u32(mask.val));
+  b32 result = ((vget_lane_u32(halves, 0) | vget_lane_u32(halves, 1)) == 0);
+#endif
   return(result);
 }
 
-static void
-wideSetLaneInts(WideInt *w, u32 val, u32 lane)
+static WideFloat
+wideMinFloats(WideFloat a, WideFloat b)
 {
-  // NOTE: this still sucks
-  // switch(lane)
-  //   {
-  //   case 0: { w->val = wasm_u32x4_replace_lane(w->val, 0, val); } break;
-  //   case 1: { w->val = wasm_u32x4_replace_lane(w->val, 1, val); } break;
-  //   case 2: { w->val = wasm_u32x4_replace_lane(w->val, 2, val); } break;
-  //   case 3: { w->val = wasm_u32x4_replace_lane(w->val, 3, val); } break;
-  //   default: { ASSERT(!"lane index out of bounds"); } break;
-  //   }
-  w->ints[lane] = val;
+  WideFloat result = {};
+  result.val = vminq_f32(a.val, b.val);
+  return(result);
 }
 
-static void
-wideStoreInts(u32 *dest, WideInt src)
+static WideFloat
+wideMaxFloats(WideFloat a, WideFloat b)
 {
-  wasm_v128_store(dest, src.val);
+  WideFloat result = {};
+  result.val = vmaxq_f32(a.val, b.val);
+  return(result);
 }
 
+// NOTE: comparisons set every bit of a lane where they hold, so they can be used as masks
 static WideInt
-wideAddInts(WideInt a, WideInt b)
+wideCompareLessFloats(WideFloat a, WideFloat b)
 {
   WideInt result = {};
-  result.val = wasm_i32x4_add(a.val, b.val);
+  result.val = vcltq_f32(a.val, b.val);
   return(result);
 }
 
 static WideInt
-wideSubInts(WideInt a, WideInt b)
+wideCompareLessEqualFloats(WideFloat a, WideFloat b)
 {
   WideInt result = {};
-  result.val = wasm_i32x4_sub(a.val, b.val);
+  result.val = vcleq_f32(a.val, b.val);
   return(result);
 }
 
-static WideInt
-wideMulInts(WideInt a, WideInt b)
+// NOTE: the ints are taken as signed
+static WideFloat
+wideConvertIntsToFloats(WideInt a)
 {
-  WideInt result = {};
-  result.val = wasm_i32x4_mul(a.val, b.val);
+  WideFloat result = {};
+  result.val = vcvtq_f32_s32(vreinterpretq_s32_u32(a.val));
   return(result);
 }
 
 static WideInt
-wideAndInts(WideInt a, WideInt b)
+wideTruncateFloatsToInts(WideFloat a)
 {
   WideInt result = {};
-  result.val = wasm_v128_and(a.val, b.val);
+  result.val = vreinterpretq_u32_s32(vcvtq_s32_f32(a.val));
   return(result);
 }
 
-#else
-// NOTE: default to scalar
+// NOTE: sign-extending loads of packed integers, converted to floats without scaling
+static WideFloat
+wideLoadS8Floats(s8 *src)
+{
+  WideFloat result = {};
+  // NOTE: assembled from bytes, which compiles to a single unaligned load
+  u8 *bytes = (u8 *)src;
+  s32 packed = (s32)(bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((u32)bytes[3] << 24));
+  int8x8_t lanes = vreinterpret_s8_s32(vdup_n_s32(packed));
+  int16x4_t words = vget_low_s16(vmovl_s8(lanes));
+  result.val = vcvtq_f32_s32(vmovl_s16(words));
 
-struct WideFloat
+  return(result);
+}
+
+static WideFloat
+wideLoadS16Floats(s16 *src)
 {
-  r32 val;
+  WideFloat result = {};
+  result.val = vcvtq_f32_s32(vmovl_s16(vld1_s16(src)));
+
+  return(result);
+}
+
+static WideFloat
+wideLoadS32Floats(s32 *src)
+{
+  WideFloat result = {};
+  result.val = vcvtq_f32_s32(vld1q_s32(src));
+
+  return(result);
+}
+
+#elif ARCH_WASM32 || ARCH_WASM64
+
+#include <wasm_simd128.h>
+
+#define WIDE_WIDTH 4
+
+union WideFloat
+{
+  v128_t val;
+  r32 floats[4];
 };
 
-struct WideInt
+union WideInt
 {
-  u32 val;
+  v128_t val;
+  u32 ints[4];
 };
 
 static WideFloat
 wideLoadFloats(r32 *src)
 {
-  WideFloat result = { *src };
+  WideFloat result = {};
+  result.val = wasm_v128_load(src);
   return(result);
 }
 
 static WideFloat
 wideSetConstantFloats(r32 src)
 {
-  WideFloat result = { src };
+  WideFloat result = {};
+  result.val = wasm_f32x4_make(src, src, src, src);
   return(result);
 }
 
-// TODO: make sure this is ok
 static WideFloat
 wideSetFloats(r32 a, r32 b, r32 c, r32 d)
 {
-  WideFloat result = { a };
-  UNUSED(b);
-  UNUSED(c);
-  UNUSED(d);
+  WideFloat result = {};
+  result.val = wasm_f32x4_make(a, b, c, d);
   return(result);
 }
 
 static void
 wideSetLaneFloats(WideFloat *w, r32 val, u32 lane)
 {
-  w->val = val;
-  UNUSED(lane);
+  // NOTE: this sucks
+  // switch(lane)
+  //   {
+  //   case 0: { w->val = wasm_f32x4_replace_lane(w->val, 0, val); } break;
+  //   case 1: { w->val = wasm_f32x4_replace_lane(w->val, 1, val); } break;
+  //   case 2: { w->val = wasm_f32x4_replace_lane(w->val, 2, val); } break;
+  //   case 3: { w->val = wasm_f32x4_replace_lane(w->val, 3, val); } break;
+  //   default: { ASSERT(!"lane index out of bounds"); } break;
+  //   }
+  w->floats[lane] = val;
 }
 
 static void
 wideStoreFloats(r32 *dest, WideFloat src)
 {
-  *dest = src.val;
+  wasm_v128_store(dest, src.val);
 }
 
 static WideFloat
 wideAddFloats(WideFloat a, WideFloat b)
 {
-  WideFloat result = { a.val + b.val };
+  WideFloat result = {};
+  result.val = wasm_f32x4_add(a.val, b.val);
   return(result);
 }
 
 static WideFloat
 wideSubFloats(WideFloat a, WideFloat b)
 {
-  WideFloat result = { a.val - b.val };
+  WideFloat result = {};
+  result.val = wasm_f32x4_sub(a.val, b.val);
   return(result);
 }
 
 static WideFloat
 wideMulFloats(WideFloat a, WideFloat b)
 {
-  WideFloat result = { a.val * b.val };
+  WideFloat result = {};
+  result.val = wasm_f32x4_mul(a.val, b.val);
   return(result);
 }
 
 static WideFloat
 wideMaskFloats(WideFloat a, WideFloat b, WideInt mask)
 {
-  //  TODO: implement
   WideFloat result = {};
+  result.val = wasm_v128_or(wasm_v128_and(a.val, mask.val),
+			    wasm_v128_andnot(b.val, mask.val));
   return(result);
 }
 
 static WideInt
 wideLoadInts(u32 *src)
 {
-  WideInt result = { *src };
+  WideInt result = {};
+  result.val = wasm_v128_load(src);
   return(result);
 }
 
 static WideInt
 wideSetConstantInts(u32 src)
 {
-  WideInt result = { src };
+  WideInt result = {};
+  result.val = wasm_u32x4_make(src, src, src, src);
   return(result);
 }
 
 static WideInt
 wideSetInts(u32 a, u32 b, u32 c, u32 d)
 {
-  // TODO: make sure this is ok
-  WideInt result = { a };
-  UNUSED(b);
-  UNUSED(c);
-  UNUSED(d);
+  WideInt result = {};
+  result.val = wasm_u32x4_make(a, b, c, d);
   return(result);
 }
 
 static void
 wideSetLaneInts(WideInt *w, u32 val, u32 lane)
 {
-  w->val = val;
-  UNUSED(lane);
+  // NOTE: this still sucks
+  // switch(lane)
+  //   {
+  //   case 0: { w->val = wasm_u32x4_replace_lane(w->val, 0, val); } break;
+  //   case 1: { w->val = wasm_u32x4_replace_lane(w->val, 1, val); } break;
+  //   case 2: { w->val = wasm_u32x4_replace_lane(w->val, 2, val); } break;
+  //   case 3: { w->val = wasm_u32x4_replace_lane(w->val, 3, val); } break;
+  //   default: { ASSERT(!"lane index out of bounds"); } break;
+  //   }
+  w->ints[lane] = val;
 }
 
 static void
 wideStoreInts(u32 *dest, WideInt src)
 {
-  *dest = src.val;
+  wasm_v128_store(dest, src.val);
 }
 
 static WideInt
 wideAddInts(WideInt a, WideInt b)
 {
-  WideInt result = { a.val + b.val };
+  WideInt result = {};
+  result.val = wasm_i32x4_add(a.val, b.val);
   return(result);
 }
 
 static WideInt
 wideSubInts(WideInt a, WideInt b)
 {
-  WideInt result = { a.val - b.val };
+  WideInt result = {};
+  result.val = wasm_i32x4_sub(a.val, b.val);
   return(result);
 }
 
 static WideInt
 wideMulInts(WideInt a, WideInt b)
 {
-  WideInt result = { a.val * b.val };
+  WideInt result = {};
+  result.val = wasm_i32x4_mul(a.val, b.val);
   return(result);
 }
 
 static WideInt
 wideAndInts(WideInt a, WideInt b)
 {
-  WideInt result = { a.val & b.val };
+  WideInt result = {};
+  result.val = wasm_v128_and(a.val, b.val);
   return(result);
 }
 
-#endif
+// NOTE: a*b + c. relaxed-simd fma isn't assumed to be available
+static WideFloat
+wideMulAddFloats(WideFloat a, WideFloat b, WideFloat c)
+{
+  WideFloat result = {};
+  result.val = wasm_f32x4_add(wasm_f32x4_mul(a.val, b.val), c.val);
+  return(result);
+}
+
+static WideFloat
+wideGatherFloats(r32 *base, WideInt indices)
+{
+  WideFloat result = {};
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      result.floats[lane] = base[indices.ints[lane]];
+    }
+  return(result);
+}
+
+// NOTE: lanes whose mask is clear are zeroed, and their memory is never touched
+static WideFloat
+wideMaskLoadFloats(r32 *src, WideInt mask)
+{
+  WideFloat result = {};
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      if(mask.ints[lane]) result.floats[lane] = src[lane];
+    }
+  return(result);
+}
+
+static void
+wideMaskStoreFloats(r32 *dest, WideFloat src, WideInt mask)
+{
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      if(mask.ints[lane]) dest[lane] = src.floats[lane];
+    }
+}
+
+static WideInt
+wideOrInts(WideInt a, WideInt b)
+{
+  WideInt result = {};
+  result.val = wasm_v128_or(a.val, b.val);
+  return(result);
+}
+
+static WideInt
+wideShiftLeftInts(WideInt a, u32 count)
+{
+  WideInt result = {};
+  result.val = wasm_i32x4_shl(a.val, count);
+  return(result);
+}
+
+// NOTE: logical, zeros are shifted in
+static WideInt
+wideShiftRightInts(WideInt a, u32 count)
+{
+  WideInt result = {};
+  result.val = wasm_u32x4_shr(a.val, count);
+  return(result);
+}
+
+static WideInt
+wideMaskInts(WideInt a, WideInt b, WideInt mask)
+{
+  WideInt result = {};
+  result.val = wasm_v128_bitselect(a.val, b.val, mask.val);
+  return(result);
+}
+
+static WideInt
+wideGatherInts(u32 *base, WideInt indices)
+{
+  WideInt result = {};
+  for(u32 lane = 0; lane < WIDE_WIDTH; ++lane)
+    {
+      result.ints[lane] = base[indices.ints[lane]];
+    }
+  return(result);
+}
+
+static b32
+wideMaskIsZero(WideInt mask)
+{
+  b32 result = !wasm_v128_any_true(mask.val);
+  return(result);
+}
+
+static WideFloat
+wideMinFloats(WideFloat a, WideFloat b)
+{
+  WideFloat result = {};
+  result.val = wasm_f32x4_min(a.val, b.val);
+  return(result);
+}
+
+static WideFloat
+wideMaxFloats(WideFloat a, WideFloat b)
+{
+  WideFloat result = {};
+  result.val = wasm_f32x4_max(a.val, b.val);
+  return(result);
+}
+
+// NOTE: comparisons set every bit of a lane where they hold, so they can be used as masks
+static WideInt
+wideCompareLessFloats(WideFloat a, WideFloat b)
+{
+  WideInt result = {};
+  result.val = wasm_f32x4_lt(a.val, b.val);
+  return(result);
+}
+
+static WideInt
+wideCompareLessEqualFloats(WideFloat a, WideFloat b)
+{
+  WideInt result = {};
+  result.val = wasm_f32x4_le(a.val, b.val);
+  return(result);
+}
+
+// NOTE: the ints are taken as signed
+static WideFloat
+wideConvertIntsToFloats(WideInt a)
+{
+  WideFloat result = {};
+  result.val = wasm_f32x4_convert_i32x4(a.val);
+  return(result);
+}
+
+static WideInt
+wideTruncateFloatsToInts(WideFloat a)
+{
+  WideInt result = {};
+  result.val = wasm_i32x4_trunc_sat_f32x4(a.val);
+  return(result);
+}
+
+// NOTE: sign-extending loads of packed integers, converted to floats without scaling
+static WideFloat
+wideLoadS8Floats(s8 *src)
+{
+  WideFloat result = {};
+  v128_t bytes = wasm_v128_load32_zero(src);
+  v128_t words = wasm_i16x8_extend_low_i8x16(bytes);
+  result.val = wasm_f32x4_convert_i32x4(wasm_i32x4_extend_low_i16x8(words));
+  return(result);
+}
+
+static WideFloat
+wideLoadS16Floats(s16 *src)
+{
+  WideFloat result = {};
+  result.val = wasm_f32x4_convert_i32x4(wasm_i32x4_load16x4(src));
+  return(result);
+}
+
+static WideFloat
+wideLoadS32Floats(s32 *src)
+{
+  WideFloat result = {};
+  result.val = wasm_f32x4_convert_i32x4(wasm_v128_load(src));
+  return(result);
+}
+
+#else
+// NOTE: default to scalar
+
+#define WIDE_WIDTH 1
+
+struct WideFloat
+{
+  r32 val;
+};
+
+struct WideInt
+{
+  u32 val;
+};
+
+static WideFloat
+wideLoadFloats(r32 *src)
+{
+  WideFloat result = { *src };
+  return(result);
+}
+
+static WideFloat
+wideSetConstantFloats(r32 src)
+{
+  WideFloat result = { src };
+  return(result);
+}
+
+// TODO: make sure this is ok
+static WideFloat
+wideSetFloats(r32 a, r32 b, r32 c, r32 d)
+{
+  WideFloat result = { a };
+  UNUSED(b);
+  UNUSED(c);
+  UNUSED(d);
+  return(result);
+}
+
+static void
+wideSetLaneFloats(WideFloat *w, r32 val, u32 lane)
+{
+  w->val = val;
+  UNUSED(lane);
+}
+
+static void
+wideStoreFloats(r32 *dest, WideFloat src)
+{
+  *dest = src.val;
+}
+
+static WideFloat
+wideAddFloats(WideFloat a, WideFloat b)
+{
+  WideFloat result = { a.val + b.val };
+  return(result);
+}
+
+static WideFloat
+wideSubFloats(WideFloat a, WideFloat b)
+{
+  WideFloat result = { a.val - b.val };
+  return(result);
+}
+
+static WideFloat
+wideMulFloats(WideFloat a, WideFloat b)
+{
+  WideFloat result = { a.val * b.val };
+  return(result);
+}
+
+static WideFloat
+wideMaskFloats(WideFloat a, WideFloat b, WideInt mask)
+{
+  WideFloat result = { mask.val ? a.val : b.val };
+  return(result);
+}
+
+static WideFloat
+wideMulAddFloats(WideFloat a, WideFloat b, WideFloat c)
+{
+  WideFloat result = { a.val*b.val + c.val };
+  return(result);
+}
+
+static WideFloat
+wideGatherFloats(r32 *base, WideInt indices)
+{
+  WideFloat result = { base[indices.val] };
+  return(result);
+}
+
+static WideFloat
+wideMaskLoadFloats(r32 *src, WideInt mask)
+{
+  WideFloat result = { mask.val ? *src : 0.f };
+  return(result);
+}
+
+static void
+wideMaskStoreFloats(r32 *dest, WideFloat src, WideInt mask)
+{
+  if(mask.val) *dest = src.val;
+}
+
+static WideInt
+wideLoadInts(u32 *src)
+{
+  WideInt result = { *src };
+  return(result);
+}
+
+static WideInt
+wideSetConstantInts(u32 src)
+{
+  WideInt result = { src };
+  return(result);
+}
+
+static WideInt
+wideSetInts(u32 a, u32 b, u32 c, u32 d)
+{
+  // TODO: make sure this is ok
+  WideInt result = { a };
+  UNUSED(b);
+  UNUSED(c);
+  UNUSED(d);
+  return(result);
+}
+
+static void
+wideSetLaneInts(WideInt *w, u32 val, u32 lane)
+{
+  w->val = val;
+  UNUSED(lane);
+}
+
+static void
+wideStoreInts(u32 *dest, WideInt src)
+{
+  *dest = src.val;
+}
+
+static WideInt
+wideAddInts(WideInt a, WideInt b)
+{
+  WideInt result = { a.val + b.val };
+  return(result);
+}
+
+static WideInt
+wideSubInts(WideInt a, WideInt b)
+{
+  WideInt result = { a.val - b.val };
+  return(result);
+}
+
+static WideInt
+wideMulInts(WideInt a, WideInt b)
+{
+  WideInt result = { a.val * b.val };
+  return(result);
+}
+
+static WideInt
+wideAndInts(WideInt a, WideInt b)
+{
+  WideInt result = { a.val & b.val };
+  return(result);
+}
+
+static WideInt
+wideOrInts(WideInt a, WideInt b)
+{
+  WideInt result = { a.val | b.val };
+  return(result);
+}
+
+static WideInt
+wideShiftLeftInts(WideInt a, u32 count)
+{
+  WideInt result = { a.val << count };
+  return(result);
+}
+
+static WideInt
+wideShiftRightInts(WideInt a, u32 count)
+{
+  WideInt result = { a.val >> count };
+  return(result);
+}
+
+static WideInt
+wideMaskInts(WideInt a, WideInt b, WideInt mask)
+{
+  WideInt result = { mask.val ? a.val : b.val };
+  return(result);
+}
+
+static WideInt
+wideGatherInts(u32 *base, WideInt indices)
+{
+  WideInt result = { base[indices.val] };
+  return(result);
+}
+
+static b32
+wideMaskIsZero(WideInt mask)
+{
+  b32 result = (mask.val == 0);
+  return(result);
+}
+
+static WideFloat
+wideMinFloats(WideFloat a, WideFloat b)
+{
+  WideFloat result = { a.val < b.val ? a.val : b.val };
+  return(result);
+}
+
+static WideFloat
+wideMaxFloats(WideFloat a, WideFloat b)
+{
+  WideFloat result = { a.val > b.val ? a.val : b.val };
+  return(result);
+}
+
+static WideInt
+wideCompareLessFloats(WideFloat a, WideFloat b)
+{
+  WideInt result = { (a.val < b.val) ? 0xFFFFFFFF : 0 };
+  return(result);
+}
+
+static WideInt
+wideCompareLessEqualFloats(WideFloat a, WideFloat b)
+{
+  WideInt result = { (a.val <= b.val) ? 0xFFFFFFFF : 0 };
+  return(result);
+}
+
+static WideFloat
+wideConvertIntsToFloats(WideInt a)
+{
+  WideFloat result = { (r32)(s32)a.val };
+  return(result);
+}
+
+static WideInt
+wideTruncateFloatsToInts(WideFloat a)
+{
+  WideInt result = { (u32)(s32)a.val };
+  return(result);
+}
+
+static WideFloat
+wideLoadS8Floats(s8 *src)
+{
+  WideFloat result = { (r32)*src };
+  return(result);
+}
+
+static WideFloat
+wideLoadS16Floats(s16 *src)
+{
+  WideFloat result = { (r32)*src };
+  return(result);
+}
+
+static WideFloat
+wideLoadS32Floats(s32 *src)
+{
+  WideFloat result = { (r32)*src };
+  return(result);
+}
+
+#endif
+
+//
+// wider backends
+//
+
+// NOTE: the 8- and 16-lane types are compiled with per-function target attributes, so a build for
+//       a baseline cpu still contains them. They must only be called from code that is itself
+//       compiled for the same target, and only after `simdGetLevel()` has reported support
+
+enum SimdLevel
+{
+  SimdLevel_scalar,
+  SimdLevel_wide4,
+  SimdLevel_wide8,
+  SimdLevel_wide16,
+};
+
+static SimdLevel simdGetLevel(void);
+static u32       simdLevelWidth(SimdLevel level);
+
+#if ARCH_X86 || ARCH_X64
+
+#if COMPILER_MSVC
+#  include <intrin.h>
+#  define SIMD_TARGET_AVX2
+#  define SIMD_TARGET_AVX512
+#else
+#  include <cpuid.h>
+#  define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#  define SIMD_TARGET_AVX512 __attribute__((target("avx2,fma,f16c,avx512f")))
+#endif
+
+#define SIMD_HAS_WIDE8 1
+#define SIMD_HAS_WIDE16 1
+#define WIDE_MAX_WIDTH 16
+
+union WideFloat8
+{
+  __m256 val;
+  r32 floats[8];
+};
+
+union WideInt8
+{
+  __m256i val;
+  u32 ints[8];
+};
+
+union WideFloat16
+{
+  __m512 val;
+  r32 floats[16];
+};
+
+union WideInt16
+{
+  __m512i val;
+  u32 ints[16];
+};
+
+static SIMD_TARGET_AVX2 WideFloat8
+wideLoadFloats8(r32 *src)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_loadu_ps(src);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 WideInt8
+wideLoadInts8(u32 *src)
+{
+  WideInt8 result = {};
+  result.val = _mm256_loadu_si256((__m256i *)src);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 WideFloat8
+wideSetConstantFloats8(r32 src)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_set1_ps(src);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 WideInt8
+wideSetConstantInts8(u32 src)
+{
+  WideInt8 result = {};
+  result.val = _mm256_set1_epi32(src);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 void
+wideStoreFloats8(r32 *dest, WideFloat8 src)
+{
+  _mm256_storeu_ps(dest, src.val);
+}
+
+static SIMD_TARGET_AVX2 WideFloat8
+wideAddFloats8(WideFloat8 a, WideFloat8 b)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_add_ps(a.val, b.val);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 WideFloat8
+wideSubFloats8(WideFloat8 a, WideFloat8 b)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_sub_ps(a.val, b.val);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 WideFloat8
+wideMulFloats8(WideFloat8 a, WideFloat8 b)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_mul_ps(a.val, b.val);
+
+  return(result);
+}
+
+// NOTE: a*b + c
+static SIMD_TARGET_AVX2 WideFloat8
+wideMulAddFloats8(WideFloat8 a, WideFloat8 b, WideFloat8 c)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_fmadd_ps(a.val, b.val, c.val);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 WideFloat8
+wideGatherFloats8(r32 *base, WideInt8 indices)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_i32gather_ps(base, indices.val, sizeof(r32));
+
+  return(result);
+}
+
+// NOTE: lanes whose mask is clear are zeroed, and their memory is never touched
+static SIMD_TARGET_AVX2 WideFloat8
+wideMaskLoadFloats8(r32 *src, WideInt8 mask)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_maskload_ps(src, mask.val);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 void
+wideMaskStoreFloats8(r32 *dest, WideFloat8 src, WideInt8 mask)
+{
+  _mm256_maskstore_ps(dest, mask.val, src.val);
+}
+
+// NOTE: sign-extending loads of packed integers, converted to floats without scaling
+static SIMD_TARGET_AVX2 WideFloat8
+wideLoadS8Floats8(s8 *src)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((__m128i *)src)));
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 WideFloat8
+wideLoadS16Floats8(s16 *src)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *)src)));
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 WideFloat8
+wideLoadS32Floats8(s32 *src)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *)src));
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX2 WideFloat8
+wideLoadHalfFloats8(u16 *src)
+{
+  WideFloat8 result = {};
+  result.val = _mm256_cvtph_ps(_mm_loadu_si128((__m128i *)src));
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideLoadFloats16(r32 *src)
+{
+  WideFloat16 result = {};
+  result.val = _mm512_loadu_ps(src);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideInt16
+wideLoadInts16(u32 *src)
+{
+  WideInt16 result = {};
+  result.val = _mm512_loadu_si512(src);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideSetConstantFloats16(r32 src)
+{
+  WideFloat16 result = {};
+  result.val = _mm512_set1_ps(src);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideInt16
+wideSetConstantInts16(u32 src)
+{
+  WideInt16 result = {};
+  result.val = _mm512_set1_epi32(src);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 void
+wideStoreFloats16(r32 *dest, WideFloat16 src)
+{
+  _mm512_storeu_ps(dest, src.val);
+}
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideAddFloats16(WideFloat16 a, WideFloat16 b)
+{
+  WideFloat16 result = {};
+  result.val = _mm512_add_ps(a.val, b.val);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideSubFloats16(WideFloat16 a, WideFloat16 b)
+{
+  WideFloat16 result = {};
+  result.val = _mm512_sub_ps(a.val, b.val);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideMulFloats16(WideFloat16 a, WideFloat16 b)
+{
+  WideFloat16 result = {};
+  result.val = _mm512_mul_ps(a.val, b.val);
+
+  return(result);
+}
+
+// NOTE: a*b + c
+static SIMD_TARGET_AVX512 WideFloat16
+wideMulAddFloats16(WideFloat16 a, WideFloat16 b, WideFloat16 c)
+{
+  WideFloat16 result = {};
+  result.val = _mm512_fmadd_ps(a.val, b.val, c.val);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideGatherFloats16(r32 *base, WideInt16 indices)
+{
+  WideFloat16 result = {};
+  result.val = _mm512_i32gather_ps(indices.val, base, sizeof(r32));
+
+  return(result);
+}
+
+// NOTE: lanes whose mask is clear are zeroed, and their memory is never touched
+static SIMD_TARGET_AVX512 WideFloat16
+wideMaskLoadFloats16(r32 *src, WideInt16 mask)
+{
+  WideFloat16 result = {};
+  __mmask16 k = _mm512_test_epi32_mask(mask.val, mask.val);
+  result.val = _mm512_maskz_loadu_ps(k, src);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 void
+wideMaskStoreFloats16(r32 *dest, WideFloat16 src, WideInt16 mask)
+{
+  __mmask16 k = _mm512_test_epi32_mask(mask.val, mask.val);
+  _mm512_mask_storeu_ps(dest, k, src.val);
+}
+
+// NOTE: the unmasked avx512 conversions pass gcc an undefined vector as their merge source, which
+//       -Wmaybe-uninitialized trips on once they're inlined. The conversions below go through the
+//       merge-masked forms with every lane set, and zeroed sources, which compile to the same code
+#define SIMD_AVX512_ALL_LANES ((__mmask16)0xFFFF)
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideLoadS8Floats16(s8 *src)
+{
+  WideFloat16 result = {};
+  __m512i ints = _mm512_mask_cvtepi8_epi32(_mm512_setzero_si512(), SIMD_AVX512_ALL_LANES,
+					   _mm_loadu_si128((__m128i *)src));
+  result.val = _mm512_mask_cvtepi32_ps(_mm512_setzero_ps(), SIMD_AVX512_ALL_LANES, ints);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideLoadS16Floats16(s16 *src)
+{
+  WideFloat16 result = {};
+  __m512i ints = _mm512_mask_cvtepi16_epi32(_mm512_setzero_si512(), SIMD_AVX512_ALL_LANES,
+					    _mm256_loadu_si256((__m256i *)src));
+  result.val = _mm512_mask_cvtepi32_ps(_mm512_setzero_ps(), SIMD_AVX512_ALL_LANES, ints);
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideLoadS32Floats16(s32 *src)
+{
+  WideFloat16 result = {};
+  result.val = _mm512_mask_cvtepi32_ps(_mm512_setzero_ps(), SIMD_AVX512_ALL_LANES,
+				       _mm512_loadu_si512((void *)src));
+
+  return(result);
+}
+
+static SIMD_TARGET_AVX512 WideFloat16
+wideLoadHalfFloats16(u16 *src)
+{
+  WideFloat16 result = {};
+  result.val = _mm512_mask_cvtph_ps(_mm512_setzero_ps(), SIMD_AVX512_ALL_LANES,
+				    _mm256_loadu_si256((__m256i *)src));
+
+  return(result);
+}
+
+static void
+simdCpuid_(u32 leaf, u32 subleaf, u32 *regs)
+{
+#if COMPILER_MSVC
+  int info[4];
+  __cpuidex(info, (int)leaf, (int)subleaf);
+  for(u32 i = 0; i < 4; ++i) regs[i] = (u32)info[i];
+#else
+  if(!__get_cpuid_count(leaf, subleaf, regs + 0, regs + 1, regs + 2, regs + 3))
+    {
+      regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    }
+#endif
+}
+
+// NOTE: which register states the os saves on context switch
+static u64
+simdXgetbv_(void)
+{
+#if COMPILER_MSVC
+  u64 result = _xgetbv(0);
+#else
+  u32 lo, hi;
+  __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+  u64 result = ((u64)hi << 32) | lo;
+#endif
+
+  return(result);
+}
+
+static SimdLevel
+simdDetectLevel_(void)
+{
+  SimdLevel result = SimdLevel_wide4;
+
+  u32 regs[4] = {};
+  simdCpuid_(1, 0, regs);
+  b32 hasOSXSave = (regs[2] >> 27) & 1;
+  b32 hasAVX = (regs[2] >> 28) & 1;
+  b32 hasFMA = (regs[2] >> 12) & 1;
+  b32 hasF16C = (regs[2] >> 29) & 1;
+  if(hasOSXSave && hasAVX && hasFMA && hasF16C)
+    {
+      u64 xcr0 = simdXgetbv_();
+      b32 osSavesYmm = (xcr0 & 0x6) == 0x6;
+      b32 osSavesZmm = (xcr0 & 0xE6) == 0xE6;
+
+      simdCpuid_(7, 0, regs);
+      b32 hasAVX2 = (regs[1] >> 5) & 1;
+      b32 hasAVX512F = (regs[1] >> 16) & 1;
+      if(osSavesYmm && hasAVX2)
+	{
+	  result = SimdLevel_wide8;
+	  if(osSavesZmm && hasAVX512F)
+	    {
+	      result = SimdLevel_wide16;
+	    }
+	}
+    }
+
+  return(result);
+}
+
+#elif ARCH_ARM || ARCH_ARM64
+
+// NOTE: neon registers are 4 lanes wide, so the 8-lane type is a pair of them. It halves the loop
+//       overhead and gives the cpu two independent chains to schedule
+
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+
+#define SIMD_HAS_WIDE8 1
+#define SIMD_HAS_WIDE16 0
+#define WIDE_MAX_WIDTH 8
+
+union WideFloat8
+{
+  float32x4_t val[2];
+  r32 floats[8];
+};
+
+union WideInt8
+{
+  uint32x4_t val[2];
+  u32 ints[8];
+};
+
+static WideFloat8
+wideLoadFloats8(r32 *src)
+{
+  WideFloat8 result = {};
+  result.val[0] = vld1q_f32(src);
+  result.val[1] = vld1q_f32(src + 4);
+
+  return(result);
+}
+
+static WideInt8
+wideLoadInts8(u32 *src)
+{
+  WideInt8 result = {};
+  result.val[0] = vld1q_u32(src);
+  result.val[1] = vld1q_u32(src + 4);
+
+  return(result);
+}
+
+static WideFloat8
+wideSetConstantFloats8(r32 src)
+{
+  WideFloat8 result = {};
+  result.val[0] = vdupq_n_f32(src);
+  result.val[1] = result.val[0];
+
+  return(result);
+}
+
+static WideInt8
+wideSetConstantInts8(u32 src)
+{
+  WideInt8 result = {};
+  result.val[0] = vdupq_n_u32(src);
+  result.val[1] = result.val[0];
+
+  return(result);
+}
+
+static void
+wideStoreFloats8(r32 *dest, WideFloat8 src)
+{
+  vst1q_f32(dest, src.val[0]);
+  vst1q_f32(dest + 4, src.val[1]);
+}
+
+static WideFloat8
+wideAddFloats8(WideFloat8 a, WideFloat8 b)
+{
+  WideFloat8 result = {};
+  result.val[0] = vaddq_f32(a.val[0], b.val[0]);
+  result.val[1] = vaddq_f32(a.val[1], b.val[1]);
+
+  return(result);
+}
+
+static WideFloat8
+wideSubFloats8(WideFloat8 a, WideFloat8 b)
+{
+  WideFloat8 result = {};
+  result.val[0] = vsubq_f32(a.val[0], b.val[0]);
+  result.val[1] = vsubq_f32(a.val[1], b.val[1]);
+
+  return(result);
+}
+
+static WideFloat8
+wideMulFloats8(WideFloat8 a, WideFloat8 b)
+{
+  WideFloat8 result = {};
+  result.val[0] = vmulq_f32(a.val[0], b.val[0]);
+  result.val[1] = vmulq_f32(a.val[1], b.val[1]);
+
+  return(result);
+}
+
+// NOTE: a*b + c
+static WideFloat8
+wideMulAddFloats8(WideFloat8 a, WideFloat8 b, WideFloat8 c)
+{
+  WideFloat8 result = {};
+#if ARCH_ARM64
+  result.val[0] = vfmaq_f32(c.val[0], a.val[0], b.val[0]);
+  result.val[1] = vfmaq_f32(c.val[1], a.val[1], b.val[1]);
+#else
+  result.val[0] = vmlaq_f32(c.val[0], a.val[0], b.val[0]);
+  result.val[1] = vmlaq_f32(c.val[1], a.val[1], b.val[1]);
+#endif
+
+  return(result);
+}
+
+static WideFloat8
+wideGatherFloats8(r32 *base, WideInt8 indices)
+{
+  WideFloat8 result = {};
+  for(u32 lane = 0; lane < 8; ++lane)
+    {
+      result.floats[lane] = base[indices.ints[lane]];
+    }
+
+  return(result);
+}
+
+// NOTE: lanes whose mask is clear are zeroed, and their memory is never touched
+static WideFloat8
+wideMaskLoadFloats8(r32 *src, WideInt8 mask)
+{
+  WideFloat8 result = {};
+  for(u32 lane = 0; lane < 8; ++lane)
+    {
+      if(mask.ints[lane]) result.floats[lane] = src[lane];
+    }
+
+  return(result);
+}
+
+static void
+wideMaskStoreFloats8(r32 *dest, WideFloat8 src, WideInt8 mask)
+{
+  for(u32 lane = 0; lane < 8; ++lane)
+    {
+      if(mask.ints[lane]) dest[lane] = src.floats[lane];
+    }
+}
+
+static WideFloat8
+wideLoadS8Floats8(s8 *src)
+{
+  WideFloat8 result = {};
+  int16x8_t words = vmovl_s8(vld1_s8(src));
+  result.val[0] = vcvtq_f32_s32(vmovl_s16(vget_low_s16(words)));
+  result.val[1] = vcvtq_f32_s32(vmovl_s16(vget_high_s16(words)));
+
+  return(result);
+}
+
+static WideFloat8
+wideLoadS16Floats8(s16 *src)
+{
+  WideFloat8 result = {};
+  int16x8_t words = vld1q_s16(src);
+  result.val[0] = vcvtq_f32_s32(vmovl_s16(vget_low_s16(words)));
+  result.val[1] = vcvtq_f32_s32(vmovl_s16(vget_high_s16(words)));
+
+  return(result);
+}
+
+static WideFloat8
+wideLoadS32Floats8(s32 *src)
+{
+  WideFloat8 result = {};
+  result.val[0] = vcvtq_f32_s32(vld1q_s32(src));
+  result.val[1] = vcvtq_f32_s32(vld1q_s32(src + 4));
+
+  return(result);
+}
+
+// NOTE: 32-bit arm doesn't reliably have the half conversion instructions
+static WideFloat8
+wideLoadHalfFloats8(u16 *src)
+{
+  WideFloat8 result = {};
+#if ARCH_ARM64
+  result.val[0] = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src)));
+  result.val[1] = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + 4)));
+#else
+  for(u32 lane = 0; lane < 8; ++lane)
+    {
+      result.floats[lane] = r32FromHalf(src[lane]);
+    }
+#endif
+
+  return(result);
+}
+
+static SimdLevel
+simdDetectLevel_(void)
+{
+  SimdLevel result = SimdLevel_wide8;
+  return(result);
+}
+
+#else
+
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+
+#define SIMD_HAS_WIDE8 0
+#define SIMD_HAS_WIDE16 0
+#define WIDE_MAX_WIDTH WIDE_WIDTH
+
+static SimdLevel
+simdDetectLevel_(void)
+{
+  SimdLevel result = (WIDE_WIDTH == 1) ? SimdLevel_scalar : SimdLevel_wide4;
+  return(result);
+}
+
+#endif
+
+// NOTE: detection runs once. Racing first calls compute the same value, so no lock is needed
+static s32 globalSimdLevel_ = -1;
+
+static SimdLevel
+simdGetLevel(void)
+{
+  if(globalSimdLevel_ < 0)
+    {
+      globalSimdLevel_ = (s32)simdDetectLevel_();
+    }
+
+  return((SimdLevel)globalSimdLevel_);
+}
+
+static u32
+simdLevelWidth(SimdLevel level)
+{
+  u32 result = 1;
+  switch(level)
+    {
+    case SimdLevel_scalar: { result = 1; } break;
+    case SimdLevel_wide4: { result = WIDE_WIDTH; } break;
+    case SimdLevel_wide8: { result = 8; } break;
+    case SimdLevel_wide16: { result = 16; } break;
+    }
+
+  return(result);
+}
 
 #if LANG_CPP
 static inline WideFloat operator+(WideFloat a, WideFloat b) { return(wideAddFloats(a, b)); }
@@ -713,7 +2122,7 @@ static inline WideFloat operator-(WideFloat a, WideFloat b) { return(wideSubFloa
 static inline WideFloat operator*(WideFloat a, WideFloat b) { return(wideMulFloats(a, b)); }
 static inline WideFloat& operator+=(WideFloat& a, WideFloat b) { a = a + b; return(a); }
 static inline WideFloat& operator-=(WideFloat& a, WideFloat b) { a = a - b; return(a); }
-static inline WideFloat& operator*=(WideFloat& a, WideFloat b) { a = a + b; return(a); }
+static inline WideFloat& operator*=(WideFloat& a, WideFloat b) { a = a * b; return(a); }
 
 static inline WideInt operator+(WideInt a, WideInt b) { return(wideAddInts(a, b)); }
 static inline WideInt operator-(WideInt a, WideInt b) { return(wideSubInts(a, b)); }
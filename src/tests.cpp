@@ -63,7 +63,2039 @@ testRun(void)
 	    stringListPush(scratch.arena, &testLog, ifftTestLogString);
 	  }
       }
+
+    // NOTE: every kernel width this cpu supports is checked against the same targets
+    FFT_Plan *fftPlan = fftPlanCreate(scratch.arena, fftTestInput.count, FFT_Direction_forward);
+    FFT_Plan *ifftPlan = fftPlanCreate(scratch.arena, ifftTestInput.count, FFT_Direction_inverse);
+    SimdLevel maxSimdLevel = fftPlan->simdLevel;
+    for(s32 level = SimdLevel_scalar; level <= (s32)maxSimdLevel; ++level)
+      {
+	fftPlan->simdLevel = (SimdLevel)level;
+	ifftPlan->simdLevel = (SimdLevel)level;
+	u32 width = simdLevelWidth((SimdLevel)level);
+
+	FFT_TestResult fftResult = testFFTPlan(scratch.arena, fftPlan, fftTestInput, fftTestTarget);
+	if(fftResult.success)
+	  {
+	    stringListPushFormat(scratch.arena, &testLog, "fft plan success (width %u)", width);
+	  }
+	else
+	  {
+	    String8 fftTestLogString = stringListJoin(scratch.arena, &fftResult.log, STR8_LIT("\n"));
+	    stringListPush(scratch.arena, &testLog, fftTestLogString);
+	  }
+
+	FFT_TestResult ifftResult = testIFFTPlan(scratch.arena, ifftPlan, ifftTestInput, ifftTestTarget);
+	if(ifftResult.success)
+	  {
+	    stringListPushFormat(scratch.arena, &testLog, "ifft plan success (width %u)", width);
+	  }
+	else
+	  {
+	    String8 ifftTestLogString = stringListJoin(scratch.arena, &ifftResult.log, STR8_LIT("\n"));
+	    stringListPush(scratch.arena, &testLog, ifftTestLogString);
+	  }
+      }
+
+    // NOTE: plan execution vs. the allocating functions
+    {
+      u32 iterations = 64;
+      stringListPushFormat(scratch.arena, &testLog, "fft benchmark (%u samples, best of %u):",
+			   (u32)fftTestInput.count, iterations);
+      for(u32 fftTestIdx = 0; fftTestIdx < ARRAY_COUNT(fftFunctions); ++fftTestIdx)
+	{
+	  u64 cycles = benchmarkFFTFunction(scratch.arena, fftFunctions[fftTestIdx], fftTestInput, iterations);
+	  stringListPushFormat(scratch.arena, &testLog, "  fftFunctions[%u]: %llu", fftTestIdx, cycles);
+	}
+      for(s32 level = SimdLevel_scalar; level <= (s32)maxSimdLevel; ++level)
+	{
+	  fftPlan->simdLevel = (SimdLevel)level;
+	  u64 planCycles = benchmarkFFTPlan(scratch.arena, fftPlan, fftTestInput, iterations);
+	  stringListPushFormat(scratch.arena, &testLog, "  fftPlanExecuteReal (width %u): %llu",
+			       simdLevelWidth((SimdLevel)level), planCycles);
+	}
+    }
+
+    // NOTE: mixed-radix plans, at file grain length and across the grain size range, checked
+    //       against a direct dft. The benchmark compares them with zero-padding up to a power of 2
+    {
+      u32 planCounts[] = {FILE_GRAIN_LENGTH, 1000, 1536, 16000};
+      u32 iterations = 16;
+      for(u32 countIdx = 0; countIdx < ARRAY_COUNT(planCounts); ++countIdx)
+	{
+	  u32 count = planCounts[countIdx];
+	  u32 paddedCount = (u32)ROUND_UP_POW_2(count);
+
+	  FloatBuffer input = {};
+	  input.count = count;
+	  input.vals = arenaPushArray(scratch.arena, paddedCount, r32, arenaFlagsZeroAlign(4*sizeof(r32)));
+	  for(u32 i = 0; i < count; ++i)
+	    {
+	      input.vals[i] = (0.5f*gsSin(2.f*GS_PI*7.f*(r32)i/(r32)count) +
+			       0.25f*gsCos(2.f*GS_PI*113.f*(r32)i/(r32)count) +
+			       0.125f*(r32)((i*2654435761u) >> 24)/255.f);
+	    }
+	  ComplexBuffer target = testDirectDFT(scratch.arena, input);
+
+	  FFT_Plan *plan = fftPlanCreate(scratch.arena, count, FFT_Direction_forward);
+	  FFT_Plan *inversePlan = fftPlanCreate(scratch.arena, count, FFT_Direction_inverse);
+	  for(s32 level = SimdLevel_scalar; level <= (s32)maxSimdLevel; ++level)
+	    {
+	      plan->simdLevel = (SimdLevel)level;
+	      inversePlan->simdLevel = (SimdLevel)level;
+
+	      FFT_TestResult planResult = testFFTPlanDirect(scratch.arena, plan, inversePlan, input, target);
+	      if(planResult.success)
+		{
+		  stringListPushFormat(scratch.arena, &testLog, "fft plan %u success (width %u)",
+				       count, simdLevelWidth((SimdLevel)level));
+		}
+	      else
+		{
+		  String8 planTestLogString = stringListJoin(scratch.arena, &planResult.log, STR8_LIT("\n"));
+		  stringListPush(scratch.arena, &testLog, planTestLogString);
+		}
+	    }
+
+	  FloatBuffer paddedInput = input;
+	  paddedInput.count = paddedCount;
+	  FFT_Plan *paddedPlan = fftPlanCreate(scratch.arena, paddedCount, FFT_Direction_forward);
+	  u64 planCycles = benchmarkFFTPlan(scratch.arena, plan, input, iterations);
+	  u64 paddedPlanCycles = benchmarkFFTPlan(scratch.arena, paddedPlan, paddedInput, iterations);
+	  u64 paddedFunctionCycles = benchmarkFFTFunction(scratch.arena, fftFunctions[1], paddedInput, iterations);
+	  stringListPushFormat(scratch.arena, &testLog,
+			       "fft benchmark (%u samples, best of %u):\n"
+			       "  fftPlanExecuteReal: %llu\n"
+			       "  fftPlanExecuteReal, padded to %u: %llu\n"
+			       "  fftFunctions[1], padded to %u: %llu\n"
+			       "  fftPlanGoodCount: %u",
+			       count, iterations, planCycles,
+			       paddedCount, paddedPlanCycles,
+			       paddedCount, paddedFunctionCycles,
+			       (u32)fftPlanGoodCount(count));
+	}
+    }
+
+    // NOTE: batched plans against their single-transform plans, at grain-feature sizes. The
+    //       benchmark compares a batch with looping the single-transform plan over it, at the
+    //       same simd level
+    {
+      u32 batchCounts[] = {64, 256, 1024, FILE_GRAIN_LENGTH};
+      u32 transformCount = 67;
+      u32 iterations = 16;
+      for(u32 countIdx = 0; countIdx < ARRAY_COUNT(batchCounts); ++countIdx)
+	{
+	  u32 count = batchCounts[countIdx];
+	  FloatBuffer inputs = {};
+	  inputs.count = (usz)count*transformCount;
+	  inputs.vals = arenaPushArray(scratch.arena, inputs.count, r32);
+	  for(u32 i = 0; i < inputs.count; ++i)
+	    {
+	      inputs.vals[i] = (0.5f*gsSin(2.f*GS_PI*5.f*(r32)i/(r32)count) +
+				0.25f*(r32)((i*2654435761u) >> 24)/255.f);
+	    }
+
+	  FFT_Plan *plan = fftPlanCreate(scratch.arena, count, FFT_Direction_forward);
+	  FFT_Plan *inversePlan = fftPlanCreate(scratch.arena, count, FFT_Direction_inverse);
+	  for(s32 level = SimdLevel_scalar; level <= (s32)maxSimdLevel; ++level)
+	    {
+	      plan->simdLevel = (SimdLevel)level;
+	      inversePlan->simdLevel = (SimdLevel)level;
+	      u64 loopCycles = benchmarkFFTPlanLoop(scratch.arena, plan, inputs, transformCount, iterations);
+	      FFT_BatchPlan *batch = fftBatchPlanCreate(scratch.arena, plan);
+	      FFT_BatchPlan *inverseBatch = fftBatchPlanCreate(scratch.arena, inversePlan);
+
+	      FFT_TestResult batchResult = testFFTBatch(scratch.arena, batch, inverseBatch, inputs, transformCount);
+	      if(batchResult.success)
+		{
+		  u64 batchCycles = benchmarkFFTBatch(scratch.arena, batch, inputs, transformCount, iterations);
+		  stringListPushFormat(scratch.arena, &testLog,
+				       "fft batch %u x %u success (%u lanes%s): %llu ticks, vs %llu looping the plan",
+				       transformCount, count, batch->laneCount, batch->loopsPlan ? ", looped" : "",
+				       batchCycles, loopCycles);
+		}
+	      else
+		{
+		  String8 batchTestLogString = stringListJoin(scratch.arena, &batchResult.log, STR8_LIT("\n"));
+		  stringListPush(scratch.arena, &testLog, batchTestLogString);
+		}
+	    }
+	}
+    }
+
+    // NOTE: partitioned convolution, uniform and non-uniform, against direct convolution
+    {
+      u32 impulseCount = 5000;
+      u32 inputCount = 12000;
+      FloatBuffer impulse = {};
+      impulse.count = impulseCount;
+      impulse.vals = arenaPushArray(scratch.arena, impulseCount, r32);
+      for(u32 i = 0; i < impulseCount; ++i)
+	{
+	  r32 noise = (r32)((i*2654435761u) >> 24)/255.f - 0.5f;
+	  impulse.vals[i] = noise*gsPow(0.001f, (r32)i/(r32)impulseCount);
+	}
+
+      FloatBuffer input = {};
+      input.count = inputCount;
+      input.vals = arenaPushArray(scratch.arena, inputCount, r32);
+      for(u32 i = 0; i < inputCount; ++i)
+	{
+	  input.vals[i] = (0.5f*gsSin(2.f*GS_PI*440.f*(r32)i/48000.f) +
+			   0.25f*(r32)(((i + 17)*2246822519u) >> 24)/255.f);
+	}
+
+      u32 maxBlockSizes[] = {64, 1024};
+      for(u32 blockIdx = 0; blockIdx < ARRAY_COUNT(maxBlockSizes); ++blockIdx)
+	{
+	  Convolver *convolver = convolverCreate(scratch.arena, impulse.vals, impulseCount,
+						 64, maxBlockSizes[blockIdx]);
+	  for(s32 level = SimdLevel_scalar; level <= (s32)maxSimdLevel; ++level)
+	    {
+	      convolver->simdLevel = (SimdLevel)level;
+	      FFT_TestResult convolverResult = testConvolverDirect(scratch.arena, convolver, impulse, input);
+	      if(convolverResult.success)
+		{
+		  stringListPushFormat(scratch.arena, &testLog,
+				       "convolver %u/%u success (width %u, %llu ticks)",
+				       convolver->blockSize, maxBlockSizes[blockIdx],
+				       simdLevelWidth((SimdLevel)level), convolverResult.cycleCount);
+		}
+	      else
+		{
+		  String8 convolverTestLogString = stringListJoin(scratch.arena, &convolverResult.log, STR8_LIT("\n"));
+		  stringListPush(scratch.arena, &testLog, convolverTestLogString);
+		}
+	    }
+	}
+    }
+  }
+
+  // NOTE: grain packfile round trip, and rejection of damaged files
+  {
+    char *packfilePath = DATA_PATH"test/test.grains";
+    char *damagedPath = DATA_PATH"test/test_damaged.grains";
+
+    LoadedSound sound = {};
+    sound.channelCount = 2;
+    sound.sampleCount = 3*FILE_GRAIN_LENGTH + 100;
+    sound.samples[0] = arenaPushArray(scratch.arena, sound.sampleCount, r32);
+    sound.samples[1] = arenaPushArray(scratch.arena, sound.sampleCount, r32);
+    for(u32 i = 0; i < sound.sampleCount; ++i)
+      {
+	sound.samples[0][i] = gsSin(2.f*GS_PI*220.f*(r32)i/(r32)INTERNAL_SAMPLE_RATE);
+	sound.samples[1][i] = (r32)((i*2654435761u) >> 24)/255.f;
+      }
+
+    GrainPackfile packfile = beginGrainPackfile(scratch.arena);
+    addSoundToGrainPackfile(&packfile, &sound);
+    writePackfileToDisk(&packfile, packfilePath);
+
+    LoadedGrainPackfile loaded = loadGrainPackfile(packfilePath, scratch.arena);
+    b32 success = ((loaded.grainCount == 4) &&
+		   (loaded.grainLength == FILE_GRAIN_LENGTH) &&
+		   (INT_FROM_PTR(loaded.tags) % GRAIN_PACKFILE_ALIGNMENT) == 0 &&
+		   (INT_FROM_PTR(loaded.samples) % GRAIN_PACKFILE_ALIGNMENT) == 0 &&
+		   verifyGrainPackfile(&loaded));
+    for(u32 grainIndex = 0; success && grainIndex < loaded.grainCount; ++grainIndex)
+      {
+	success = (loaded.tags[grainIndex].startSampleIndex == grainIndex);
+	for(u32 channelIndex = 0; channelIndex < FILE_GRAIN_CHANNELS; ++channelIndex)
+	  {
+	    r32 *grainSamples = loaded.samples + (grainIndex*FILE_GRAIN_CHANNELS + channelIndex)*FILE_GRAIN_LENGTH;
+	    for(u32 i = 0; i < FILE_GRAIN_LENGTH; ++i)
+	      {
+		u32 sampleIndex = grainIndex*FILE_GRAIN_LENGTH + i;
+		r32 expected = (sampleIndex < sound.sampleCount) ? sound.samples[channelIndex][sampleIndex] : 0.f;
+		success = success && (grainSamples[i] == expected);
+	      }
+	  }
+      }
+
+    // NOTE: a flipped sample bit only shows up in the checksum. Truncation and a bad magic number
+    //       are rejected on load
+    Buffer damaged = {};
+    damaged.size = loaded.file.size;
+    damaged.contents = arenaPushArray(scratch.arena, damaged.size, u8);
+    COPY_SIZE(damaged.contents, loaded.file.contents, damaged.size);
+    unloadGrainPackfile(&loaded);
+
+    damaged.contents[damaged.size - 1] ^= 0x10;
+    gsWriteEntireFile(damagedPath, damaged);
+    LoadedGrainPackfile flipped = loadGrainPackfile(damagedPath, scratch.arena);
+    success = success && (flipped.grainCount == 4) && !verifyGrainPackfile(&flipped);
+    unloadGrainPackfile(&flipped);
+
+    damaged.size -= 1;
+    gsWriteEntireFile(damagedPath, damaged);
+    LoadedGrainPackfile truncated = loadGrainPackfile(damagedPath, scratch.arena);
+    success = success && (truncated.grainCount == 0);
+
+    damaged.size += 1;
+    damaged.contents[0] ^= 0xFF;
+    gsWriteEntireFile(damagedPath, damaged);
+    LoadedGrainPackfile badMagic = loadGrainPackfile(damagedPath, scratch.arena);
+    success = success && (badMagic.grainCount == 0);
+    if(success)
+      {
+	gsRemoveFile(packfilePath);
+	gsRemoveFile(damagedPath);
+      }
+
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("grain packfile success") : STR8_LIT("grain packfile FAILED"));
+  }
+
+  // NOTE: packfile tag and sample encodings. Each must load back within its quantization error,
+  //       and s16 grains must play back through the decode path. Logs the file sizes, and s16
+  //       decode throughput at each simd level
+  {
+    char *packfilePath = DATA_PATH"test/test_encoded.grains";
+    u32 grainCount = 64;
+
+    LoadedSound sound = {};
+    sound.channelCount = 2;
+    sound.sampleCount = grainCount*FILE_GRAIN_LENGTH;
+    sound.samples[0] = arenaPushArray(scratch.arena, sound.sampleCount, r32);
+    sound.samples[1] = arenaPushArray(scratch.arena, sound.sampleCount, r32);
+    for(u32 i = 0; i < sound.sampleCount; ++i)
+      {
+	sound.samples[0][i] = 0.9f*gsSin(2.f*GS_PI*220.f*(r32)i/(r32)INTERNAL_SAMPLE_RATE);
+	sound.samples[1][i] = (r32)((i*2654435761u) >> 24)/255.f - 0.5f;
+      }
+
+    GrainPackfile packfile = beginGrainPackfile(scratch.arena);
+    addSoundToGrainPackfile(&packfile, &sound);
+    u32 tagState = 12345;
+    for(GrainPackfileChunk *chunk = packfile.firstChunk; chunk; chunk = chunk->next)
+      {
+	for(usz entryIndex = 0; entryIndex < chunk->entryCount; ++entryIndex)
+	  {
+	    r32 *vector = chunk->entries[entryIndex].grainTagVector;
+	    for(u32 d = 0; d < FILE_TAG_LENGTH; ++d)
+	      {
+		tagState = tagState*1664525u + 1013904223u;
+		vector[d] = 4.f*((r32)(tagState >> 8)/(r32)(1 << 24) - 0.5f);
+	      }
+	  }
+      }
+
+    struct
+    {
+      GrainTagFormat tagFormat;
+      GrainSampleFormat sampleFormat;
+      char *name;
+    } encodings[] = {
+      {GrainTagFormat_r32, GrainSampleFormat_r32, "r32 tags, r32 samples"},
+      {GrainTagFormat_f16, GrainSampleFormat_r32, "f16 tags, r32 samples"},
+      {GrainTagFormat_s8, GrainSampleFormat_s16, "s8 tags, s16 samples"},
+      {GrainTagFormat_f16, GrainSampleFormat_s16, "f16 tags, s16 samples"},
+    };
+
+    b32 success = true;
+    r32 *tag = arenaPushArray(scratch.arena, FILE_TAG_LENGTH, r32);
+    for(u32 encodingIndex = 0; encodingIndex < ARRAY_COUNT(encodings); ++encodingIndex)
+      {
+	packfile.tagFormat = encodings[encodingIndex].tagFormat;
+	packfile.sampleFormat = encodings[encodingIndex].sampleFormat;
+	writePackfileToDisk(&packfile, packfilePath);
+
+	LoadedGrainPackfile loaded = loadGrainPackfile(packfilePath, scratch.arena);
+	b32 encodingSuccess = ((loaded.grainCount == grainCount) &&
+			       (loaded.tagFormat == packfile.tagFormat) &&
+			       (loaded.sampleFormat == packfile.sampleFormat) &&
+			       verifyGrainPackfile(&loaded));
+
+	// NOTE: tags within half a step of the original
+	r32 maxTagError = 0.f;
+	u32 grainIndex = 0;
+	for(GrainPackfileChunk *chunk = packfile.firstChunk; encodingSuccess && chunk; chunk = chunk->next)
+	  {
+	    for(usz entryIndex = 0; entryIndex < chunk->entryCount; ++entryIndex, ++grainIndex)
+	      {
+		r32 *expected = chunk->entries[entryIndex].grainTagVector;
+		grainPackfileGetTagVector(&loaded, grainIndex, tag);
+		for(u32 d = 0; d < FILE_TAG_LENGTH; ++d)
+		  {
+		    maxTagError = MAX(maxTagError, gsAbs(tag[d] - expected[d]));
+		  }
+	      }
+	  }
+	r32 tagTolerance = 0.f;
+	if(packfile.tagFormat == GrainTagFormat_s8) tagTolerance = 0.5f*2.f/127.f + 1e-6f;
+	if(packfile.tagFormat == GrainTagFormat_f16) tagTolerance = 2.f/2048.f;
+	encodingSuccess = encodingSuccess && (maxTagError <= tagTolerance);
+
+	// NOTE: play the whole packfile, and compare against the source
+	u32 outputCount = sound.sampleCount + 256;
+	r32 *outL = arenaPushArray(scratch.arena, outputCount, r32);
+	r32 *outR = arenaPushArray(scratch.arena, outputCount, r32);
+	FileGrainState grainState = initializeFileGrainState(scratch.arena);
+	queueAllGrainsFromFile(&grainState, &loaded);
+	for(u32 blockStart = 0; blockStart < outputCount; blockStart += 256)
+	  {
+	    mixPlayingGrains(outL + blockStart, outR + blockStart, 1.f, 256, &grainState);
+	  }
+	r32 maxSampleError = 0.f;
+	for(u32 i = 0; i < sound.sampleCount; ++i)
+	  {
+	    maxSampleError = MAX(maxSampleError, gsAbs(outL[i] - sound.samples[0][i]));
+	    maxSampleError = MAX(maxSampleError, gsAbs(outR[i] - sound.samples[1][i]));
+	  }
+	r32 sampleTolerance = (packfile.sampleFormat == GrainSampleFormat_s16) ? 1.f/GRAIN_SAMPLE_S16_SCALE : 0.f;
+	encodingSuccess = encodingSuccess && (maxSampleError <= sampleTolerance);
+
+	stringListPushFormat(scratch.arena, &testLog,
+			     "grain encoding %s: %llu bytes (%llu per grain), max tag error %g, max sample error %g%s",
+			     encodings[encodingIndex].name, (u64)loaded.file.size,
+			     (u64)(loaded.file.size/grainCount), maxTagError, maxSampleError,
+			     encodingSuccess ? "" : " FAILED");
+	success = success && encodingSuccess;
+
+	if(packfile.sampleFormat == GrainSampleFormat_s16 && encodingSuccess)
+	  {
+	    usz decodeCount = (usz)grainCount*FILE_GRAIN_CHANNEL_LENGTH;
+	    r32 *decoded = arenaPushArray(scratch.arena, decodeCount, r32,
+					  arenaFlagsNoZeroAlign(GRAIN_PACKFILE_ALIGNMENT));
+	    for(s32 level = SimdLevel_scalar; level <= (s32)simdGetLevel(); ++level)
+	      {
+		u64 bestTicks = U64_MAX;
+		for(u32 run = 0; run < 8; ++run)
+		  {
+		    u64 startTicks = getCpuCounter();
+		    decodeGrainSamplesS16((SimdLevel)level, decoded, loaded.samplesS16, decodeCount);
+		    bestTicks = MIN(bestTicks, getCpuCounter() - startTicks);
+		  }
+		success = success && (decoded[decodeCount - 1] == outR[sound.sampleCount - 1]);
+		stringListPushFormat(scratch.arena, &testLog, "  s16 decode, width %2u: %llu ticks per grain, %.2f samples per tick",
+				     simdLevelWidth((SimdLevel)level), bestTicks/grainCount,
+				     (r64)decodeCount/(r64)MAX(bestTicks, 1));
+	      }
+	  }
+
+	unloadGrainPackfile(&loaded);
+      }
+    packfile.tagFormat = GrainTagFormat_r32;
+    packfile.sampleFormat = GrainSampleFormat_r32;
+    if(success) gsRemoveFile(packfilePath);
+
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("grain encodings success") : STR8_LIT("grain encodings FAILED"));
+  }
+
+  // NOTE: appending sounds to a packfile on the writer thread must give the same file, byte for
+  //       byte, as writing them all at once. Older versions can't be appended to
+  {
+    char *appendPath = DATA_PATH"test/test_append.grains";
+    char *wholePath = DATA_PATH"test/test_whole.grains";
+
+    u32 soundLengths[] = {3*FILE_GRAIN_LENGTH, 70*FILE_GRAIN_LENGTH + 100, 5*FILE_GRAIN_LENGTH + 1};
+    LoadedSound sounds[ARRAY_COUNT(soundLengths)] = {};
+    u32 totalGrainCount = 0;
+    for(u32 soundIndex = 0; soundIndex < ARRAY_COUNT(sounds); ++soundIndex)
+      {
+	LoadedSound *sound = sounds + soundIndex;
+	sound->channelCount = 2;
+	sound->sampleCount = soundLengths[soundIndex];
+	sound->samples[0] = arenaPushArray(scratch.arena, sound->sampleCount, r32);
+	sound->samples[1] = arenaPushArray(scratch.arena, sound->sampleCount, r32);
+	for(u32 i = 0; i < sound->sampleCount; ++i)
+	  {
+	    sound->samples[0][i] = gsSin(0.001f*(r32)(i + 7*soundIndex));
+	    sound->samples[1][i] = (r32)(((i + soundIndex)*2654435761u) >> 24)/255.f - 0.5f;
+	  }
+	totalGrainCount += (sound->sampleCount + FILE_GRAIN_LENGTH - 1)/FILE_GRAIN_LENGTH;
+      }
+
+    b32 success = true;
+    GrainTagFormat tagFormats[] = {GrainTagFormat_r32, GrainTagFormat_s8};
+    GrainSampleFormat sampleFormats[] = {GrainSampleFormat_r32, GrainSampleFormat_s16};
+    for(u32 formatIndex = 0; success && formatIndex < ARRAY_COUNT(tagFormats); ++formatIndex)
+      {
+	GrainPackfile whole = beginGrainPackfile(scratch.arena);
+	whole.tagFormat = tagFormats[formatIndex];
+	whole.sampleFormat = sampleFormats[formatIndex];
+	for(u32 soundIndex = 0; soundIndex < ARRAY_COUNT(sounds); ++soundIndex)
+	  {
+	    addSoundToGrainPackfile(&whole, sounds + soundIndex);
+	  }
+	writePackfileToDisk(&whole, wholePath);
+
+	// NOTE: the r32 packfile starts from one written whole, the s16 one from nothing
+	GrainPackfile first = beginGrainPackfile(scratch.arena);
+	first.tagFormat = tagFormats[formatIndex];
+	first.sampleFormat = sampleFormats[formatIndex];
+	u32 firstSoundIndex = 0;
+	if(formatIndex == 0)
+	  {
+	    addSoundToGrainPackfile(&first, sounds);
+	    writePackfileToDisk(&first, appendPath);
+	    firstSoundIndex = 1;
+	  }
+	else
+	  {
+	    gsWriteEntireFile(appendPath, bufferMake(0, 0));
+	  }
+
+	GrainPackfileAppender *appender = openGrainPackfileAppender(appendPath, scratch.arena, tagFormats[formatIndex],
+								    sampleFormats[formatIndex], GrainTagger_auto);
+	success = (appender != 0);
+	u64 startTicks = getCpuCounter();
+	for(u32 soundIndex = firstSoundIndex; success && soundIndex < ARRAY_COUNT(sounds); ++soundIndex)
+	  {
+	    success = appendSoundToGrainPackfile(appender, sounds + soundIndex);
+	  }
+	if(appender)
+	  {
+	    while(!grainPackfileAppenderIsIdle(appender)) gsSleep(1);
+	    success = success && (gsAtomicLoad(&appender->committedGrainCount) == totalGrainCount);
+	    success = closeGrainPackfileAppender(appender) && success;
+	  }
+	u64 appendTicks = getCpuCounter() - startTicks;
+
+	LoadedGrainPackfile appended = loadGrainPackfile(appendPath, scratch.arena);
+	LoadedGrainPackfile expected = loadGrainPackfile(wholePath, scratch.arena);
+	success = (success && appended.grainCount == totalGrainCount && verifyGrainPackfile(&appended) &&
+		   appended.file.size == expected.file.size);
+	for(usz i = 0; success && i < appended.file.size; ++i)
+	  {
+	    success = (appended.file.contents[i] == expected.file.contents[i]);
+	  }
+	stringListPushFormat(scratch.arena, &testLog, "grain packfile append, format %u: %u grains, %llu ticks per grain",
+			     formatIndex, totalGrainCount, appendTicks/totalGrainCount);
+
+	// NOTE: a version 3 header is still loadable, but not appendable
+	if(success)
+	  {
+	    Buffer old = {};
+	    old.size = appended.file.size;
+	    old.contents = arenaPushArray(scratch.arena, old.size, u8);
+	    COPY_SIZE(old.contents, appended.file.contents, old.size);
+	    ((GrainPackfileHeader *)old.contents)->version = 3;
+	    unloadGrainPackfile(&appended);
+	    gsWriteEntireFile(appendPath, old);
+
+	    success = (openGrainPackfileAppender(appendPath, scratch.arena, tagFormats[formatIndex],
+						 sampleFormats[formatIndex], GrainTagger_auto) == 0);
+	  }
+	unloadGrainPackfile(&appended);
+	unloadGrainPackfile(&expected);
+      }
+    if(success)
+      {
+	gsRemoveFile(appendPath);
+	gsRemoveFile(wholePath);
+      }
+
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("grain packfile append success") : STR8_LIT("grain packfile append FAILED"));
+  }
+
+  // NOTE: overlapping file grains. Hann windows at overlap 2 must add back up to the source in the
+  //       steady state, and the output mustn't depend on the block size or the simd level. Logs the
+  //       mixing cost at each overlap
+  {
+    char *packfilePath = DATA_PATH"test/test_overlap.grains";
+    u32 grainCount = 24;
+
+    LoadedSound sound = {};
+    sound.channelCount = 2;
+    sound.sampleCount = grainCount*FILE_GRAIN_LENGTH;
+    sound.samples[0] = arenaPushArray(scratch.arena, sound.sampleCount, r32);
+    sound.samples[1] = arenaPushArray(scratch.arena, sound.sampleCount, r32);
+    for(u32 i = 0; i < sound.sampleCount; ++i)
+      {
+	sound.samples[0][i] = 0.5f;
+	sound.samples[1][i] = -0.25f;
+      }
+
+    GrainPackfile packfile = beginGrainPackfile(scratch.arena);
+    addSoundToGrainPackfile(&packfile, &sound);
+    writePackfileToDisk(&packfile, packfilePath);
+    LoadedGrainPackfile loaded = loadGrainPackfile(packfilePath, scratch.arena);
+
+    u32 outputCount = sound.sampleCount + FILE_GRAIN_LENGTH;
+    u32 blockSizes[] = {256, 37};
+    r32 *outs[ARRAY_COUNT(blockSizes) + 1][2];
+    for(u32 outIndex = 0; outIndex < ARRAY_COUNT(outs); ++outIndex)
+      {
+	outs[outIndex][0] = arenaPushArray(scratch.arena, outputCount, r32);
+	outs[outIndex][1] = arenaPushArray(scratch.arena, outputCount, r32);
+      }
+
+    // NOTE: two block sizes at the detected simd level, then the first block size in scalar
+    b32 success = (loaded.grainCount == grainCount);
+    u32 maxPlayingCount = 0;
+    for(u32 outIndex = 0; success && outIndex < ARRAY_COUNT(outs); ++outIndex)
+      {
+	u32 blockSize = blockSizes[outIndex % ARRAY_COUNT(blockSizes)];
+	FileGrainState grainState = initializeFileGrainState(scratch.arena);
+	if(outIndex == ARRAY_COUNT(blockSizes)) grainState.simdLevel = SimdLevel_scalar;
+	setFileGrainWindow(&grainState, WindowShape_hann, 2.f);
+	queueAllGrainsFromFile(&grainState, &loaded);
+	for(u32 blockStart = 0; blockStart < outputCount; blockStart += blockSize)
+	  {
+	    u32 samplesToWrite = MIN(blockSize, outputCount - blockStart);
+	    mixPlayingGrains(outs[outIndex][0] + blockStart, outs[outIndex][1] + blockStart, 1.f,
+			     samplesToWrite, &grainState);
+	    maxPlayingCount = MAX(maxPlayingCount, grainState.playingGrainCount);
+	  }
+	success = success && (grainState.playingGrainCount == 0) && (grainState.droppedGrainCount == 0);
+      }
+
+    // NOTE: grains start every half grain, so the sum is steady from the first hop to the last
+    u32 hopLength = FILE_GRAIN_LENGTH/2;
+    u32 steadyEnd = (grainCount - 1)*hopLength + hopLength;
+    r32 maxSteadyError = 0.f;
+    r32 maxBlockError = 0.f;
+    for(u32 i = 0; success && i < outputCount; ++i)
+      {
+	if(i >= hopLength && i < steadyEnd)
+	  {
+	    maxSteadyError = MAX(maxSteadyError, gsAbs(outs[0][0][i] - 0.5f));
+	    maxSteadyError = MAX(maxSteadyError, gsAbs(outs[0][1][i] + 0.25f));
+	  }
+	for(u32 outIndex = 1; outIndex < ARRAY_COUNT(outs); ++outIndex)
+	  {
+	    maxBlockError = MAX(maxBlockError, gsAbs(outs[outIndex][0][i] - outs[0][0][i]));
+	    maxBlockError = MAX(maxBlockError, gsAbs(outs[outIndex][1][i] - outs[0][1][i]));
+	  }
+      }
+    success = success && (maxSteadyError < 1e-4f) && (maxBlockError < 1e-6f) && (maxPlayingCount == 2);
+    stringListPushFormat(scratch.arena, &testLog, "file grain overlap: steady state error %g, block/simd error %g",
+			 maxSteadyError, maxBlockError);
+
+    r32 overlaps[] = {1.f, 2.f, 4.f, 8.f};
+    for(u32 overlapIndex = 0; success && overlapIndex < ARRAY_COUNT(overlaps); ++overlapIndex)
+      {
+	u64 ticks[2] = {};
+	for(u32 pass = 0; pass < 2; ++pass)
+	  {
+	    FileGrainState grainState = initializeFileGrainState(scratch.arena);
+	    if(pass == 0) grainState.simdLevel = SimdLevel_scalar;
+	    setFileGrainWindow(&grainState, WindowShape_hann, overlaps[overlapIndex]);
+	    queueAllGrainsFromFile(&grainState, &loaded);
+
+	    // NOTE: only time the span where grains are playing
+	    u32 activeCount = (grainCount - 1)*grainState.hopLength + FILE_GRAIN_LENGTH;
+	    u32 blockCount = activeCount/256;
+	    ZERO_ARRAY(outs[0][0], outputCount, r32);
+	    ZERO_ARRAY(outs[0][1], outputCount, r32);
+	    u64 startTicks = getCpuCounter();
+	    for(u32 blockIndex = 0; blockIndex < blockCount; ++blockIndex)
+	      {
+		mixPlayingGrains(outs[0][0] + blockIndex*256, outs[0][1] + blockIndex*256, 1.f, 256, &grainState);
+	      }
+	    ticks[pass] = (getCpuCounter() - startTicks)/blockCount;
+	  }
+	stringListPushFormat(scratch.arena, &testLog, "  overlap %.0f: %llu ticks per 256-sample block scalar, %llu at width %u",
+			     overlaps[overlapIndex], ticks[0], ticks[1], simdLevelWidth(simdGetLevel()));
+      }
+
+    unloadGrainPackfile(&loaded);
+    if(success) gsRemoveFile(packfilePath);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("file grain overlap success") : STR8_LIT("file grain overlap FAILED"));
+  }
+
+  // NOTE: streaming packfile playback through a cache that's much smaller than the packfile.
+  //       Waiting for the I/O thread before each block makes every grain a hit, even when the
+  //       prefetch window holds more grains than the cache (the last pass); without waiting,
+  //       each grain must either play exactly or be silent and counted as a miss
+  {
+    char *packfilePath = DATA_PATH"test/test_stream.grains";
+    u32 grainCount = 40;
+    u32 blockSize = 256;
+
+    LoadedSound sound = {};
+    sound.channelCount = 2;
+    sound.sampleCount = grainCount*FILE_GRAIN_LENGTH;
+    sound.samples[0] = arenaPushArray(scratch.arena, sound.sampleCount, r32);
+    sound.samples[1] = arenaPushArray(scratch.arena, sound.sampleCount, r32);
+    for(u32 i = 0; i < sound.sampleCount; ++i)
+      {
+	sound.samples[0][i] = (r32)(i + 1);
+	sound.samples[1][i] = -(r32)(i + 1);
+      }
+
+    GrainPackfile packfile = beginGrainPackfile(scratch.arena);
+    addSoundToGrainPackfile(&packfile, &sound);
+    writePackfileToDisk(&packfile, packfilePath);
+
+    StreamingGrainPackfile *stream = openStreamingGrainPackfile(packfilePath, scratch.arena, 4, 20);
+    b32 success = (stream != 0);
+    if(stream)
+      {
+	// NOTE: one block of tail, so the last grain gets retired and unpins its slot
+	u32 outputCount = sound.sampleCount + blockSize;
+	r32 *outL = arenaPushArray(scratch.arena, outputCount, r32);
+	r32 *outR = arenaPushArray(scratch.arena, outputCount, r32);
+	u64 prefetchSampleCount = stream->prefetchSampleCount;
+	for(u32 pass = 0; pass < 3; ++pass)
+	  {
+	    b32 waitForIO = (pass != 1);
+	    stream->prefetchSampleCount = (pass == 2) ? 3*stream->slotCount*FILE_GRAIN_LENGTH : prefetchSampleCount;
+	    ZERO_ARRAY(outL, outputCount, r32);
+	    ZERO_ARRAY(outR, outputCount, r32);
+	    u32 missCountStart = stream->missCount;
+
+	    FileGrainState grainState = initializeFileGrainState(scratch.arena);
+	    queueAllGrainsFromStream(&grainState, stream);
+	    for(u32 blockStart = 0; blockStart < outputCount; blockStart += blockSize)
+	      {
+		u32 samplesToWrite = MIN(blockSize, outputCount - blockStart);
+		if(waitForIO)
+		  {
+		    prefetchQueuedGrains(&grainState, samplesToWrite);
+		    while(!streamingGrainPackfileIsIdle(stream)) gsSleep(1);
+		  }
+		mixPlayingGrains(outL + blockStart, outR + blockStart, 1.f, samplesToWrite, &grainState);
+	      }
+
+	    u32 silentGrainCount = 0;
+	    for(u32 grainIndex = 0; grainIndex < grainCount; ++grainIndex)
+	      {
+		u32 grainStart = grainIndex*FILE_GRAIN_LENGTH;
+		b32 silent = (outL[grainStart] == 0.f);
+		silentGrainCount += silent;
+		for(u32 i = grainStart; i < grainStart + FILE_GRAIN_LENGTH; ++i)
+		  {
+		    r32 expectedL = silent ? 0.f : sound.samples[0][i];
+		    r32 expectedR = silent ? 0.f : sound.samples[1][i];
+		    success = success && (outL[i] == expectedL) && (outR[i] == expectedR);
+		  }
+	      }
+
+	    u32 missCount = stream->missCount - missCountStart;
+	    success = success && (missCount == silentGrainCount) && (!waitForIO || missCount == 0);
+	    for(u32 slotIndex = 0; slotIndex < stream->slotCount; ++slotIndex)
+	      {
+		success = success && (stream->slots[slotIndex].pinCount == 0);
+	      }
+	    stringListPushFormat(scratch.arena, &testLog, "grain stream pass %u: %u/%u grains missed",
+				 pass, missCount, grainCount);
+	  }
+
+	closeStreamingGrainPackfile(stream);
+      }
+    if(success) gsRemoveFile(packfilePath);
+
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("grain stream success") : STR8_LIT("grain stream FAILED"));
+  }
+
+  // NOTE: grain tag index recall against a brute-force search, and query latency, on clustered
+  //       synthetic tags. Probing every list must find the exact neighbors
+  {
+    u32 tagCount = 8192;
+    u32 clusterCount = 64;
+    u32 queryCount = 200;
+    u32 neighborCount = 10;
+
+    u32 randomState = 0x9E3779B9;
+#define TEST_RANDOM_UNIT() (randomState ^= randomState << 13, randomState ^= randomState >> 17, \
+			    randomState ^= randomState << 5, (r32)(randomState >> 8)/(r32)(1 << 24) - 0.5f)
+
+    r32 *clusterCenters = arenaPushArray(scratch.arena, clusterCount*FILE_TAG_LENGTH, r32);
+    for(u32 i = 0; i < clusterCount*FILE_TAG_LENGTH; ++i) clusterCenters[i] = 2.f*TEST_RANDOM_UNIT();
+
+    GrainPackfileTag *tags = arenaPushArray(scratch.arena, tagCount, GrainPackfileTag);
+    for(u32 tagIndex = 0; tagIndex < tagCount; ++tagIndex)
+      {
+	r32 *center = clusterCenters + (tagIndex % clusterCount)*FILE_TAG_LENGTH;
+	tags[tagIndex].startSampleIndex = tagIndex;
+	for(u32 d = 0; d < FILE_TAG_LENGTH; ++d) tags[tagIndex].vector[d] = center[d] + 0.3f*TEST_RANDOM_UNIT();
+      }
+
+    r32 *queries = arenaPushArray(scratch.arena, queryCount*FILE_TAG_LENGTH, r32);
+    u32 *exactNeighbors = arenaPushArray(scratch.arena, queryCount*neighborCount, u32);
+    for(u32 queryIndex = 0; queryIndex < queryCount; ++queryIndex)
+      {
+	r32 *query = queries + queryIndex*FILE_TAG_LENGTH;
+	r32 *source = tags[(queryIndex*7919) % tagCount].vector;
+	for(u32 d = 0; d < FILE_TAG_LENGTH; ++d) query[d] = source[d] + 0.2f*TEST_RANDOM_UNIT();
+
+	GrainTagMatch exact[GRAIN_INDEX_MAX_MATCHES];
+	u32 exactCount = 0;
+	for(u32 tagIndex = 0; tagIndex < tagCount; ++tagIndex)
+	  {
+	    r32 distance = 0.f;
+	    for(u32 d = 0; d < FILE_TAG_LENGTH; ++d)
+	      {
+		r32 delta = query[d] - tags[tagIndex].vector[d];
+		distance += delta*delta;
+	      }
+	    grainTagMatchInsert_(exact, &exactCount, neighborCount, tagIndex, distance);
+	  }
+	for(u32 i = 0; i < neighborCount; ++i) exactNeighbors[queryIndex*neighborCount + i] = exact[i].index;
+      }
+#undef TEST_RANDOM_UNIT
+
+    LoadedGrainPackfile source = {};
+    source.grainCount = tagCount;
+    source.tagFormat = GrainTagFormat_r32;
+    source.tags = tags;
+
+    // NOTE: quantized indices are held to a lower recall, since quantization can reorder near ties
+    b32 success = true;
+    GrainTagFormat formats[] = {GrainTagFormat_r32, GrainTagFormat_s8, GrainTagFormat_f16};
+    char *formatNames[] = {"r32", "s8", "f16"};
+    usz formatSizes[] = {sizeof(r32), sizeof(s8), sizeof(u16)};
+    for(u32 formatIndex = 0; formatIndex < ARRAY_COUNT(formats); ++formatIndex)
+      {
+	GrainTagIndex *index = grainTagIndexCreate(scratch.arena, &source, 0, formats[formatIndex]);
+	usz bytesPerTag = index->stride*formatSizes[formatIndex];
+	stringListPushFormat(scratch.arena, &testLog,
+			     "grain tag index, %s (%u tags, %u lists, %llu bytes per tag, recall@%u, ticks per query):",
+			     formatNames[formatIndex], tagCount, index->listCount, (u64)bytesPerTag, neighborCount);
+
+	r32 exhaustiveRecall = (formats[formatIndex] == GrainTagFormat_r32) ? 0.999f : 0.95f;
+	r32 defaultRecall = (formats[formatIndex] == GrainTagFormat_r32) ? 0.9f : 0.85f;
+	u32 probeCounts[] = {1, 2, 4, GRAIN_INDEX_DEFAULT_PROBE_COUNT, 16, index->listCount};
+	for(u32 probeIdx = 0; probeIdx < ARRAY_COUNT(probeCounts); ++probeIdx)
+	  {
+	    index->probeCount = probeCounts[probeIdx];
+	    u32 hitCount = 0;
+	    u64 totalTicks = 0;
+	    for(u32 queryIndex = 0; queryIndex < queryCount; ++queryIndex)
+	      {
+		GrainTagMatch matches[GRAIN_INDEX_MAX_MATCHES];
+		u64 startTicks = getCpuCounter();
+		u32 matchCount = grainTagIndexQuery(index, queries + queryIndex*FILE_TAG_LENGTH, matches, neighborCount);
+		totalTicks += getCpuCounter() - startTicks;
+
+		u32 *exact = exactNeighbors + queryIndex*neighborCount;
+		for(u32 i = 0; i < matchCount; ++i)
+		  {
+		    for(u32 j = 0; j < neighborCount; ++j) hitCount += (matches[i].index == exact[j]);
+		  }
+	      }
+
+	    r32 recall = (r32)hitCount/(r32)(queryCount*neighborCount);
+	    stringListPushFormat(scratch.arena, &testLog, "  probes %3u: recall %.3f, %llu ticks",
+				 index->probeCount, recall, totalTicks/queryCount);
+	    if(index->probeCount == index->listCount) success = success && (recall >= exhaustiveRecall);
+	    if(index->probeCount == GRAIN_INDEX_DEFAULT_PROBE_COUNT) success = success && (recall >= defaultRecall);
+	  }
+	index->probeCount = GRAIN_INDEX_DEFAULT_PROBE_COUNT;
+      }
+
+    // NOTE: an index built over half the tags and extended to all of them keeps the first half's
+    //       centroids, and must still find the exact neighbors when probing every list. Extending
+    //       from a quarter retrains
+    LoadedGrainPackfile half = source;
+    half.grainCount = tagCount/2;
+    LoadedGrainPackfile quarter = source;
+    quarter.grainCount = tagCount/4;
+    u64 startTicks = getCpuCounter();
+    GrainTagIndex *fresh = grainTagIndexCreate(scratch.arena, &source, 0, GrainTagFormat_r32);
+    u64 createTicks = getCpuCounter() - startTicks;
+    GrainTagIndex *halfIndex = grainTagIndexCreate(scratch.arena, &half, 0, GrainTagFormat_r32);
+    startTicks = getCpuCounter();
+    GrainTagIndex *extended = grainTagIndexExtend(scratch.arena, halfIndex, &source);
+    u64 extendTicks = getCpuCounter() - startTicks;
+    GrainTagIndex *retrained = grainTagIndexExtend(scratch.arena,
+						   grainTagIndexCreate(scratch.arena, &quarter, 0, GrainTagFormat_r32),
+						   &source);
+    success = (success && extended->vectorCount == tagCount && extended->trainedVectorCount == half.grainCount &&
+	       retrained->trainedVectorCount == tagCount && extended->listStarts[extended->listCount] == tagCount);
+
+    r32 extendedRecall[2] = {};
+    u32 probeCounts[] = {GRAIN_INDEX_DEFAULT_PROBE_COUNT, extended->listCount};
+    for(u32 probeIdx = 0; probeIdx < ARRAY_COUNT(probeCounts); ++probeIdx)
+      {
+	extended->probeCount = probeCounts[probeIdx];
+	u32 hitCount = 0;
+	for(u32 queryIndex = 0; queryIndex < queryCount; ++queryIndex)
+	  {
+	    GrainTagMatch matches[GRAIN_INDEX_MAX_MATCHES];
+	    u32 matchCount = grainTagIndexQuery(extended, queries + queryIndex*FILE_TAG_LENGTH, matches, neighborCount);
+	    u32 *exact = exactNeighbors + queryIndex*neighborCount;
+	    for(u32 i = 0; i < matchCount; ++i)
+	      {
+		for(u32 j = 0; j < neighborCount; ++j) hitCount += (matches[i].index == exact[j]);
+	      }
+	  }
+	extendedRecall[probeIdx] = (r32)hitCount/(r32)(queryCount*neighborCount);
+      }
+    success = success && (extendedRecall[0] >= 0.9f) && (extendedRecall[1] >= 0.999f);
+    stringListPushFormat(scratch.arena, &testLog,
+			 "grain tag index extended from %u to %u tags: recall %.3f (%u probes), %.3f (all), "
+			 "%llu ticks to extend, %llu to build %u lists",
+			 half.grainCount, tagCount, extendedRecall[0], GRAIN_INDEX_DEFAULT_PROBE_COUNT, extendedRecall[1],
+			 extendTicks, createTicks, fresh->listCount);
+
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("grain tag index success") : STR8_LIT("grain tag index FAILED"));
+  }
+
+  // NOTE: native grain features on signals with known answers, and the simd kernels against the
+  //       scalar ones
+  {
+    GrainFeatureExtractor *extractor = grainFeatureExtractorCreate(scratch.arena);
+    SimdLevel simdLevel = extractor->simdLevel;
+
+    u32 signalCount = 4;
+    r32 *signals = arenaPushArray(scratch.arena, signalCount*FILE_GRAIN_CHANNEL_LENGTH, r32,
+				  arenaFlagsZeroAlign(WIDE_MAX_WIDTH*sizeof(r32)));
+    r32 *tags = arenaPushArray(scratch.arena, signalCount*FILE_TAG_LENGTH, r32, arenaFlagsZeroNoAlign());
+    r32 *scalarTag = arenaPushArray(scratch.arena, FILE_TAG_LENGTH, r32, arenaFlagsZeroNoAlign());
+
+    // NOTE: 1kHz and 1.1kHz sines, white noise, and silence
+    r32 amplitude = 0.5f;
+    u32 randomState = 0x2545F491;
+    for(u32 i = 0; i < FILE_GRAIN_LENGTH; ++i)
+      {
+	r32 phase = (r32)GS_TAU*(r32)i/(r32)INTERNAL_SAMPLE_RATE;
+	randomState ^= randomState << 13; randomState ^= randomState >> 17; randomState ^= randomState << 5;
+	r32 noise = (r32)(randomState >> 8)/(r32)(1 << 23) - 1.f;
+	for(u32 channel = 0; channel < FILE_GRAIN_CHANNELS; ++channel)
+	  {
+	    signals[0*FILE_GRAIN_CHANNEL_LENGTH + channel*FILE_GRAIN_LENGTH + i] = amplitude*gsSin(1000.f*phase);
+	    signals[1*FILE_GRAIN_CHANNEL_LENGTH + channel*FILE_GRAIN_LENGTH + i] = amplitude*gsSin(1100.f*phase);
+	    signals[2*FILE_GRAIN_CHANNEL_LENGTH + channel*FILE_GRAIN_LENGTH + i] = amplitude*noise;
+	  }
+      }
+
+    b32 success = grainFeaturesRunBatch(extractor, signals, tags, signalCount, FILE_GRAIN_LENGTH);
+    for(u32 i = 0; i < signalCount*FILE_TAG_LENGTH; ++i)
+      {
+	success = success && (tags[i] == tags[i]) && (gsAbs(tags[i]) < 1e6f);
+      }
+
+    r32 *sineMeans = tags + GRAIN_FEATURE_MEANS_OFFSET;
+    r32 *noiseMeans = tags + 2*FILE_TAG_LENGTH + GRAIN_FEATURE_MEANS_OFFSET;
+    r32 *silenceMeans = tags + 3*FILE_TAG_LENGTH + GRAIN_FEATURE_MEANS_OFFSET;
+    r32 sineCentroid = sineMeans[GrainFeature_centroid];
+    r32 sineRms = sineMeans[GrainFeature_rms];
+    r32 sineCrossings = sineMeans[GrainFeature_zeroCrossings];
+    success = (success &&
+	       gsAbs(sineCentroid - 1000.f/24000.f) < 0.01f &&
+	       gsAbs(sineRms - 0.70710678f*amplitude) < 0.01f &&
+	       gsAbs(sineCrossings - 2000.f/(r32)INTERNAL_SAMPLE_RATE) < 0.005f &&
+	       sineMeans[GrainFeature_flatness] < 0.1f &&
+	       noiseMeans[GrainFeature_flatness] > 0.3f &&
+	       gsAbs(noiseMeans[GrainFeature_centroid] - 0.5f) < 0.1f &&
+	       silenceMeans[GrainFeature_rms] == 0.f);
+
+    r32 nearDistance = 0.f, farDistance = 0.f;
+    for(u32 d = 0; d < FILE_TAG_LENGTH; ++d)
+      {
+	r32 nearDelta = tags[d] - tags[FILE_TAG_LENGTH + d];
+	r32 farDelta = tags[d] - tags[2*FILE_TAG_LENGTH + d];
+	nearDistance += nearDelta*nearDelta;
+	farDistance += farDelta*farDelta;
+      }
+    success = success && (nearDistance < farDistance);
+
+    extractor->simdLevel = SimdLevel_scalar;
+    r32 maxSimdError = 0.f;
+    for(u32 signalIndex = 0; signalIndex < signalCount; ++signalIndex)
+      {
+	grainFeaturesExtract(extractor, signals + signalIndex*FILE_GRAIN_CHANNEL_LENGTH, scalarTag);
+	for(u32 d = 0; d < FILE_TAG_LENGTH; ++d)
+	  {
+	    maxSimdError = MAX(maxSimdError, gsAbs(scalarTag[d] - tags[signalIndex*FILE_TAG_LENGTH + d]));
+	  }
+      }
+    success = success && (maxSimdError < 1e-3f);
+
+    u32 repeatCount = 64;
+    u64 ticks[2] = {};
+    SimdLevel levels[2] = {SimdLevel_scalar, simdLevel};
+    for(u32 levelIndex = 0; levelIndex < ARRAY_COUNT(levels); ++levelIndex)
+      {
+	extractor->simdLevel = levels[levelIndex];
+	u64 startTicks = getCpuCounter();
+	for(u32 repeat = 0; repeat < repeatCount; ++repeat)
+	  {
+	    grainFeaturesExtract(extractor, signals + (repeat % signalCount)*FILE_GRAIN_CHANNEL_LENGTH, scalarTag);
+	  }
+	ticks[levelIndex] = (getCpuCounter() - startTicks)/repeatCount;
+      }
+    extractor->simdLevel = simdLevel;
+
+    stringListPushFormat(scratch.arena, &testLog,
+			 "grain features: sine centroid %.4f, rms %.4f, crossings %.4f, flatness %.4f; "
+			 "noise flatness %.3f, centroid %.3f; simd error %g; ticks per grain %llu (scalar), %llu (simd)",
+			 sineCentroid, sineRms, sineCrossings, sineMeans[GrainFeature_flatness],
+			 noiseMeans[GrainFeature_flatness], noiseMeans[GrainFeature_centroid], maxSimdError,
+			 ticks[0], ticks[1]);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("grain features success") : STR8_LIT("grain features FAILED"));
+  }
+
+  // NOTE: live tagging, paced so the worker keeps up, then in a burst that overruns the ring. Each
+  //       segment is a sine at its own frequency, so a published tag can be checked against the
+  //       segment it claims to be from. Every segment must be either tagged, skipped, or dropped
+  {
+    LiveTagger *tagger = openLiveTagger(scratch.arena, GrainTagger_features);
+    GrainFeatureExtractor *extractor = grainFeatureExtractorCreate(scratch.arena);
+    r32 *expectedSamples = arenaPushArray(scratch.arena, FILE_GRAIN_CHANNEL_LENGTH, r32,
+					  arenaFlagsNoZeroAlign(WIDE_MAX_WIDTH*sizeof(r32)));
+    r32 *expectedTag = arenaPushArray(scratch.arena, FILE_TAG_LENGTH, r32, arenaFlagsNoZeroAlign(sizeof(r32)));
+
+    u32 blockCount = 480;
+    SamplePair *block = arenaPushArray(scratch.arena, blockCount, SamplePair, arenaFlagsNoZeroAlign(sizeof(r32)));
+    u32 pacedSegmentCount = 8;
+    u32 segmentCount = pacedSegmentCount + 64;
+
+    b32 success = (tagger != 0);
+    r32 maxTagError = 0.f;
+    u32 waitCount = 0;
+    LiveTagResult *result = 0;
+    for(u32 segmentIndex = 0; success && segmentIndex < segmentCount; ++segmentIndex)
+      {
+	r32 frequency = 200.f + 50.f*(r32)segmentIndex;
+	for(u32 blockStart = 0; blockStart < FILE_GRAIN_LENGTH; blockStart += blockCount)
+	  {
+	    for(u32 i = 0; i < blockCount; ++i)
+	      {
+		r32 phase = (r32)GS_TAU*frequency*(r32)(blockStart + i)/(r32)INTERNAL_SAMPLE_RATE;
+		block[i].left = 0.5f*gsSin(phase);
+		block[i].right = 0.25f*gsSin(phase);
+	      }
+	    liveTaggerPushSamples(tagger, block, blockCount);
+	  }
+
+	u64 pushedSampleIndex = (u64)segmentIndex*FILE_GRAIN_LENGTH;
+	b32 paced = (segmentIndex < pacedSegmentCount);
+	b32 last = (segmentIndex == segmentCount - 1);
+	while(paced || last)
+	  {
+	    result = liveTaggerLatest(tagger);
+	    if(result &&
+	       ((paced && result->streamSampleIndex == pushedSampleIndex) ||
+		(last && result->taggedCount + result->skippedCount + tagger->droppedCount == segmentCount))) break;
+	    if(++waitCount > 10000) break;
+	    gsSleep(1);
+	  }
+	success = (waitCount <= 10000);
+
+	// NOTE: the published tag has to match its own segment
+	if(success && (paced || last))
+	  {
+	    u32 taggedSegmentIndex = (u32)(result->streamSampleIndex/FILE_GRAIN_LENGTH);
+	    r32 taggedFrequency = 200.f + 50.f*(r32)taggedSegmentIndex;
+	    for(u32 i = 0; i < FILE_GRAIN_LENGTH; ++i)
+	      {
+		r32 phase = (r32)GS_TAU*taggedFrequency*(r32)i/(r32)INTERNAL_SAMPLE_RATE;
+		expectedSamples[i] = 0.5f*gsSin(phase);
+		expectedSamples[FILE_GRAIN_LENGTH + i] = 0.25f*gsSin(phase);
+	      }
+	    grainFeaturesExtract(extractor, expectedSamples, expectedTag);
+	    for(u32 d = 0; d < FILE_TAG_LENGTH; ++d)
+	      {
+		maxTagError = MAX(maxTagError, gsAbs(expectedTag[d] - result->vector[d]));
+	      }
+	  }
+      }
+
+    if(tagger) closeLiveTagger(tagger);
+    success = (success && result && maxTagError < 1e-5f &&
+	       result->taggedCount + result->skippedCount + tagger->droppedCount == segmentCount &&
+	       result->skippedCount + tagger->droppedCount > 0);
+
+    if(result)
+      {
+	stringListPushFormat(scratch.arena, &testLog,
+			     "live tagging: %u segments, %llu tagged, %llu skipped, %u dropped; tag error %g; "
+			     "latency %llu ticks mean, %llu max",
+			     segmentCount, result->taggedCount, result->skippedCount, tagger->droppedCount, maxTagError,
+			     result->totalLatencyTicks/MAX(result->taggedCount, 1), result->maxLatencyTicks);
+      }
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("live tagging success") : STR8_LIT("live tagging FAILED"));
+  }
+
+  // NOTE: wav decoding. A file in each supported format and layout is written and loaded back, and
+  //       compared against the signal it was written from; resampled files are compared against the
+  //       same signal at the internal rate. Then a longer file is timed against reading it whole and
+  //       converting it a sample at a time
+  {
+    struct WavTestCase
+    {
+      u16 formatTag;
+      u16 subFormatTag;
+      u32 bitsPerSample;
+      u32 channelCount;
+      u32 sampleRate;
+      u32 frameCount;
+      b32 extraChunks; // NOTE: a LIST chunk, and an odd-sized bext chunk with its pad byte
+      b32 truncated;   // NOTE: the data chunk claims more than the file holds
+    };
+    WavTestCase cases[] =
+    {
+      {WAV_FORMAT_PCM, 0, 8, 2, 48000, 5000, false, false},
+      {WAV_FORMAT_PCM, 0, 16, 2, 48000, 5000, true, false},
+      {WAV_FORMAT_PCM, 0, 24, 2, 48000, 5000, false, false},
+      {WAV_FORMAT_PCM, 0, 32, 2, 48000, 5000, false, false},
+      {WAV_FORMAT_IEEE_FLOAT, 0, 32, 2, 48000, 5000, false, false},
+      {WAV_FORMAT_IEEE_FLOAT, 0, 64, 2, 48000, 5000, false, false},
+      {WAV_FORMAT_PCM, 0, 16, 1, 48000, 4097, false, false},
+      {WAV_FORMAT_EXTENSIBLE, WAV_FORMAT_PCM, 24, 5, 48000, 3001, true, true},
+      {WAV_FORMAT_EXTENSIBLE, WAV_FORMAT_IEEE_FLOAT, 32, 2, 48000, 100, false, false},
+      {WAV_FORMAT_PCM, 0, 16, 2, 44100, 44100, false, false},
+      {WAV_FORMAT_PCM, 0, 24, 1, 96000, 9601, true, false},
+    };
+
+    char *wavPath = DATA_PATH"test/test.wav";
+    u64 frequency = 441;
+    r32 amplitude = 0.9f;
+    b32 success = true;
+    r32 maxError = 0.f;
+    r32 maxResampledError = 0.f;
+    r32 maxSimdError = 0.f;
+    for(u32 caseIndex = 0; caseIndex < ARRAY_COUNT(cases); ++caseIndex)
+      {
+	WavTestCase *testCase = cases + caseIndex;
+	u32 bytesPerSample = testCase->bitsPerSample/8;
+	u32 dataSize = testCase->frameCount*testCase->channelCount*bytesPerSample;
+	b32 isExtensible = (testCase->formatTag == WAV_FORMAT_EXTENSIBLE);
+	u16 sampleTag = isExtensible ? testCase->subFormatTag : testCase->formatTag;
+	u32 fmtSize = (u32)(isExtensible ? sizeof(WaveFormatExtended) : sizeof(WaveFormatChunk));
+	u32 extraSize = testCase->extraChunks ? (sizeof(RiffHeader) + 10 + sizeof(RiffHeader) + 8) : 0;
+	u32 fileSize = (u32)(sizeof(RiffHeader) + sizeof(WaveHeader) + fmtSize + extraSize +
+			     sizeof(WaveDataChunk) + dataSize);
+
+	Buffer file = {};
+	file.size = fileSize;
+	file.contents = arenaPushArray(scratch.arena, fileSize, u8, arenaFlagsZeroNoAlign());
+	u8 *at = file.contents;
+
+	RiffHeader *riffHeader = (RiffHeader *)at; at += sizeof(RiffHeader);
+	riffHeader->chunkID.id = RIFF("RIFF");
+	riffHeader->chunkSize = fileSize - sizeof(RiffHeader);
+	WaveHeader *waveHeader = (WaveHeader *)at; at += sizeof(WaveHeader);
+	waveHeader->waveID.id = RIFF("WAVE");
+
+	if(testCase->extraChunks)
+	  {
+	    RiffHeader *list = (RiffHeader *)at; at += sizeof(RiffHeader) + 10;
+	    list->chunkID.id = RIFF("LIST");
+	    list->chunkSize = 10;
+	  }
+
+	WaveFormatChunk *fmt = (WaveFormatChunk *)at; at += fmtSize;
+	fmt->header.chunkID.id = RIFF("fmt ");
+	fmt->header.chunkSize = fmtSize - sizeof(RiffHeader);
+	fmt->formatTag = testCase->formatTag;
+	fmt->channelCount = (u16)testCase->channelCount;
+	fmt->sampleRate = testCase->sampleRate;
+	fmt->dataBlockSize = (u16)(testCase->channelCount*bytesPerSample);
+	fmt->avgBytesPerSec = testCase->sampleRate*fmt->dataBlockSize;
+	fmt->bitsPerSample = (u16)testCase->bitsPerSample;
+	if(isExtensible)
+	  {
+	    WaveFormatExtension *ex = (WaveFormatExtension *)(fmt + 1);
+	    ex->cbSize = sizeof(WaveFormatExtension) - sizeof(u16);
+	    ex->validBitsPerSample = (u16)testCase->bitsPerSample;
+	    ex->subFmt[0] = (u8)(testCase->subFormatTag & 0xFF);
+	    ex->subFmt[1] = (u8)(testCase->subFormatTag >> 8);
+	  }
+
+	if(testCase->extraChunks)
+	  {
+	    RiffHeader *bext = (RiffHeader *)at; at += sizeof(RiffHeader) + 8;
+	    bext->chunkID.id = RIFF("bext");
+	    bext->chunkSize = 7;
+	  }
+
+	WaveDataChunk *data = (WaveDataChunk *)at; at += sizeof(WaveDataChunk);
+	data->chunkID.id = RIFF("data");
+	data->chunkSize = dataSize + (testCase->truncated ? 1000 : 0);
+
+	// NOTE: channel c is a sine at (c + 1)*frequency. Phases are reduced exactly, so they're as
+	//       accurate at the end of a file as at the start
+	for(u32 frameIndex = 0; frameIndex < testCase->frameCount; ++frameIndex)
+	  {
+	    for(u32 channelIndex = 0; channelIndex < testCase->channelCount; ++channelIndex)
+	      {
+		u64 cycleSamples = (frequency*(channelIndex + 1)*frameIndex) % testCase->sampleRate;
+		r32 phase = (r32)GS_TAU*(r32)cycleSamples/(r32)testCase->sampleRate;
+		r64 value = amplitude*gsSin(phase);
+		s64 quantized = 0;
+		if(sampleTag == WAV_FORMAT_PCM)
+		  {
+		    r64 scaled = value*(r64)(1ll << (testCase->bitsPerSample - 1));
+		    quantized = (s64)(scaled + (scaled >= 0 ? 0.5 : -0.5));
+		    if(testCase->bitsPerSample == 8) quantized += 128;
+		  }
+		else if(testCase->bitsPerSample == 32)
+		  {
+		    r32 value32 = (r32)value;
+		    u32 bits; COPY_SIZE(&bits, &value32, sizeof(u32));
+		    quantized = bits;
+		  }
+		else
+		  {
+		    COPY_SIZE(&quantized, &value, sizeof(r64));
+		  }
+		for(u32 byteIndex = 0; byteIndex < bytesPerSample; ++byteIndex)
+		  {
+		    *at++ = (u8)(((u64)quantized >> (8*byteIndex)) & 0xFF);
+		  }
+	      }
+	  }
+	ASSERT(at == file.contents + fileSize);
+	gsWriteEntireFile(wavPath, file);
+
+	// NOTE: the internal rate over the file's
+	LoadedSound sound = loadWav(scratch.arena, STR8_CSTR(wavPath));
+	b32 resampled = (testCase->sampleRate != INTERNAL_SAMPLE_RATE);
+	u32 expectedCount = (u32)wavResampledFrameCount(testCase->frameCount, testCase->sampleRate,
+							INTERNAL_SAMPLE_RATE);
+	success = (success &&
+		   sound.sampleCount == expectedCount &&
+		   sound.channelCount == MIN(testCase->channelCount, 2));
+
+	r32 tolerance = 1.f/32768.f;
+	if(sampleTag == WAV_FORMAT_PCM && testCase->bitsPerSample == 8) tolerance = 1.f/128.f;
+	else if(sampleTag == WAV_FORMAT_PCM && testCase->bitsPerSample == 16) tolerance = 1.f/16384.f;
+	if(resampled) tolerance = 1e-3f;
+
+	// NOTE: resampled edges read the silence before and after the file
+	u32 edgeCount = resampled ? 4 : 0;
+	for(u32 frameIndex = edgeCount; success && frameIndex + edgeCount < sound.sampleCount; ++frameIndex)
+	  {
+	    for(u32 channelIndex = 0; channelIndex < 2; ++channelIndex)
+	      {
+		u32 sourceChannel = (testCase->channelCount == 1) ? 0 : channelIndex;
+		u64 cycleSamples = (frequency*(sourceChannel + 1)*frameIndex) % INTERNAL_SAMPLE_RATE;
+		r32 phase = (r32)GS_TAU*(r32)cycleSamples/(r32)INTERNAL_SAMPLE_RATE;
+		r32 error = gsAbs(sound.samples[channelIndex][frameIndex] - amplitude*gsSin(phase));
+		if(resampled) maxResampledError = MAX(maxResampledError, error);
+		else	      maxError = MAX(maxError, error);
+		success = success && (error <= tolerance);
+	      }
+	  }
+
+	// NOTE: the simd kernels against the scalar ones
+	WavInfo info = {};
+	Buffer written = gsReadEntireFile(wavPath, scratch.arena);
+	success = success && wavParse(written, &info);
+	LoadedSound scalarSound = wavDecode(scratch.arena, &info, SimdLevel_scalar);
+	success = success && (scalarSound.sampleCount == sound.sampleCount);
+	for(u32 i = 0; success && i < sound.sampleCount; ++i)
+	  {
+	    maxSimdError = MAX(maxSimdError, gsAbs(scalarSound.samples[0][i] - sound.samples[0][i]));
+	    maxSimdError = MAX(maxSimdError, gsAbs(scalarSound.samples[1][i] - sound.samples[1][i]));
+	  }
+      }
+    success = success && (maxSimdError == 0.f);
+
+    // NOTE: files that aren't wave files this decodes give an empty sound
+    {
+      u8 notWave[64] = {'R', 'I', 'F', 'X'};
+      gsWriteEntireFile(wavPath, bufferMake(notWave, sizeof(notWave)));
+      LoadedSound sound = loadWav(scratch.arena, STR8_CSTR(wavPath));
+      success = success && (sound.sampleCount == 0);
+
+      sound = loadWav(scratch.arena, STR8_LIT(DATA_PATH"test/missing.wav"));
+      success = success && (sound.sampleCount == 0);
+    }
+
+    // NOTE: a 16-bit stereo file, loaded as it is now, and by reading it whole and converting it a
+    //       sample at a time
+    u32 timedFrameCount = 1 << 22;
+    u32 timedDataSize = timedFrameCount*2*sizeof(s16);
+    Buffer timedFile = {};
+    timedFile.size = sizeof(RiffHeader) + sizeof(WaveHeader) + sizeof(WaveFormatChunk) + sizeof(WaveDataChunk) + timedDataSize;
+    timedFile.contents = arenaPushArray(scratch.arena, timedFile.size, u8, arenaFlagsZeroNoAlign());
+    {
+      RiffHeader *riffHeader = (RiffHeader *)timedFile.contents;
+      riffHeader->chunkID.id = RIFF("RIFF");
+      riffHeader->chunkSize = (u32)(timedFile.size - sizeof(RiffHeader));
+      WaveHeader *waveHeader = (WaveHeader *)(riffHeader + 1);
+      waveHeader->waveID.id = RIFF("WAVE");
+      WaveFormatChunk *fmt = (WaveFormatChunk *)(waveHeader + 1);
+      fmt->header.chunkID.id = RIFF("fmt ");
+      fmt->header.chunkSize = sizeof(WaveFormatChunk) - sizeof(RiffHeader);
+      fmt->formatTag = WAV_FORMAT_PCM;
+      fmt->channelCount = 2;
+      fmt->sampleRate = INTERNAL_SAMPLE_RATE;
+      fmt->dataBlockSize = 2*sizeof(s16);
+      fmt->avgBytesPerSec = INTERNAL_SAMPLE_RATE*fmt->dataBlockSize;
+      fmt->bitsPerSample = 16;
+      WaveDataChunk *data = (WaveDataChunk *)(fmt + 1);
+      data->chunkID.id = RIFF("data");
+      data->chunkSize = timedDataSize;
+      s16 *samples = (s16 *)(data + 1);
+      for(u32 i = 0; i < 2*timedFrameCount; ++i) samples[i] = (s16)(i*2654435761u >> 16);
+    }
+    gsWriteEntireFile(wavPath, timedFile);
+
+    u64 startTicks = getCpuCounter();
+    LoadedSound timedSound = loadWav(scratch.arena, STR8_CSTR(wavPath));
+    u64 decodeTicks = getCpuCounter() - startTicks;
+
+    startTicks = getCpuCounter();
+    Buffer whole = gsReadEntireFile(wavPath, scratch.arena);
+    s16 *wholeSamples = (s16 *)(whole.contents + sizeof(RiffHeader) + sizeof(WaveHeader) +
+				sizeof(WaveFormatChunk) + sizeof(WaveDataChunk));
+    r32 *wholeL = arenaPushArray(scratch.arena, 2*timedFrameCount, r32);
+    r32 *wholeR = wholeL + timedFrameCount;
+    for(u32 i = 0; i < timedFrameCount; ++i)
+      {
+	wholeL[i] = (r32)wholeSamples[2*i + 0]/(r32)s16_MAX;
+	wholeR[i] = (r32)wholeSamples[2*i + 1]/(r32)s16_MAX;
+      }
+    u64 wholeTicks = getCpuCounter() - startTicks;
+
+    success = (success &&
+	       timedSound.sampleCount == timedFrameCount &&
+	       gsAbs(timedSound.samples[1][timedFrameCount - 1] - wholeR[timedFrameCount - 1]) < 1e-4f);
+    if(success) gsRemoveFile(wavPath);
+
+    stringListPushFormat(scratch.arena, &testLog,
+			 "wav decoding: %u files, max error %g, resampled %g, simd error %g; "
+			 "%u MB in %llu ticks (streamed), %llu ticks (whole file, per sample)",
+			 (u32)ARRAY_COUNT(cases), maxError, maxResampledError, maxSimdError,
+			 timedDataSize >> 20, decodeTicks, wholeTicks);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("wav decoding success") : STR8_LIT("wav decoding FAILED"));
+  }
+
+  // NOTE: disk recording of both tracks, paced so the writer keeps up, then in a burst that overruns
+  //       the ring. The file has to be valid while it's being written, and afterwards every frame must
+  //       be either the one that was pushed, or silence the writer filled a dropout with. Then an rf64
+  //       header, which no test file is big enough to need
+  {
+    DiskRecorder *recorder = diskRecorderCreate(scratch.arena);
+    char *outputPath = DATA_PATH"test/record_output.wav";
+    char *inputPath = DATA_PATH"test/record_input.wav";
+
+    // NOTE: no frame is ever silent, so silence marks a dropout
+#define DISK_RECORDER_TEST_FRAME(n, scale) (scale*(0.1f + 0.8f*(r32)((n) % 1000)/1000.f))
+    u32 blockFrameCount = 480;
+    u32 pacedBlockCount = 400;
+    u32 burstFrameCount = 16*DISK_RECORDER_BLOCK_COUNT*DISK_RECORDER_BLOCK_FRAMES;
+    u64 totalFrameCount = (u64)pacedBlockCount*blockFrameCount + burstFrameCount;
+    SamplePair *output = arenaPushArray(scratch.arena, burstFrameCount, SamplePair, arenaFlagsNoZeroAlign(sizeof(r32)));
+    SamplePair *input = arenaPushArray(scratch.arena, burstFrameCount, SamplePair, arenaFlagsNoZeroAlign(sizeof(r32)));
+
+    b32 success = diskRecorderStart(recorder, outputPath, inputPath);
+    u64 frameIndex = 0;
+    u32 waitCount = 0;
+    for(u32 blockIndex = 0; success && blockIndex < pacedBlockCount; ++blockIndex)
+      {
+	for(u32 i = 0; i < blockFrameCount; ++i, ++frameIndex)
+	  {
+	    output[i].left = DISK_RECORDER_TEST_FRAME(frameIndex, 1.f);
+	    output[i].right = DISK_RECORDER_TEST_FRAME(frameIndex, -1.f);
+	    input[i].left = DISK_RECORDER_TEST_FRAME(frameIndex + 17, 0.5f);
+	    input[i].right = DISK_RECORDER_TEST_FRAME(frameIndex + 17, -0.5f);
+	  }
+	diskRecorderPushSamples(recorder, output, input, blockFrameCount, INTERNAL_SAMPLE_RATE);
+
+	while(gsAtomicLoad(&recorder->blockReadIndex) != gsAtomicLoad(&recorder->blockWriteIndex) &&
+	      ++waitCount < 10000)
+	  {
+	    gsSleep(1);
+	  }
+      }
+    success = success && (waitCount < 10000) && (recorder->audioDroppedFrameCount == 0);
+
+    // NOTE: the paced frames fill several chunks, each followed by a header update
+    u64 midFrameCount = 0;
+    if(success)
+      {
+	LoadedSound midSound = loadWav(scratch.arena, STR8_CSTR(outputPath));
+	midFrameCount = midSound.sampleCount;
+	success = (midSound.channelCount == 2 && midFrameCount >= DISK_RECORDER_CHUNK_FRAMES &&
+		   midFrameCount % DISK_RECORDER_CHUNK_FRAMES == 0);
+	for(u32 i = 0; success && i < midFrameCount; ++i)
+	  {
+	    success = (midSound.samples[0][i] == DISK_RECORDER_TEST_FRAME(i, 1.f) &&
+		       midSound.samples[1][i] == DISK_RECORDER_TEST_FRAME(i, -1.f));
+	  }
+      }
+
+    for(u32 i = 0; i < burstFrameCount; ++i)
+      {
+	output[i].left = DISK_RECORDER_TEST_FRAME(frameIndex + i, 1.f);
+	output[i].right = DISK_RECORDER_TEST_FRAME(frameIndex + i, -1.f);
+	input[i].left = DISK_RECORDER_TEST_FRAME(frameIndex + i + 17, 0.5f);
+	input[i].right = DISK_RECORDER_TEST_FRAME(frameIndex + i + 17, -0.5f);
+      }
+    if(success) diskRecorderPushSamples(recorder, output, input, burstFrameCount, INTERNAL_SAMPLE_RATE);
+    diskRecorderStopAndWait(recorder);
+
+    DiskRecorderStats stats = recorder->stats;
+    success = (success && !stats.writeFailed && stats.writtenFrameCount == totalFrameCount &&
+	       stats.droppedFrameCount == recorder->audioDroppedFrameCount && stats.droppedFrameCount > 0);
+
+    u64 silentFrameCount[DiskRecorderTrack_count] = {};
+    char *paths[DiskRecorderTrack_count] = {outputPath, inputPath};
+    r32 scales[DiskRecorderTrack_count] = {1.f, 0.5f};
+    u32 offsets[DiskRecorderTrack_count] = {0, 17};
+    for(u32 trackIndex = 0; success && trackIndex < DiskRecorderTrack_count; ++trackIndex)
+      {
+	LoadedSound sound = loadWav(scratch.arena, STR8_CSTR(paths[trackIndex]));
+	success = (sound.channelCount == 2 && sound.sampleCount == totalFrameCount);
+	for(u32 i = 0; success && i < sound.sampleCount; ++i)
+	  {
+	    r32 left = sound.samples[0][i];
+	    r32 right = sound.samples[1][i];
+	    if(left == 0.f && right == 0.f)
+	      {
+		++silentFrameCount[trackIndex];
+	      }
+	    else
+	      {
+		u64 n = i + offsets[trackIndex];
+		success = (left == DISK_RECORDER_TEST_FRAME(n, scales[trackIndex]) &&
+			   right == DISK_RECORDER_TEST_FRAME(n, -scales[trackIndex]));
+	      }
+	  }
+	success = success && (silentFrameCount[trackIndex] == stats.droppedFrameCount);
+      }
+#undef DISK_RECORDER_TEST_FRAME
+    gsRemoveFile(outputPath);
+    gsRemoveFile(inputPath);
+
+    // NOTE: past 4GB the header switches to rf64, and the data size moves to the ds64 chunk
+    {
+      u32 frameCount = 8;
+      u64 claimedFrameCount = (u64)u32_MAX;
+      Buffer file = {};
+      file.size = DISK_RECORDER_HEADER_SIZE + frameCount*DISK_RECORDER_CHANNELS*sizeof(r32);
+      file.contents = arenaPushArray(scratch.arena, file.size, u8, arenaFlagsZeroNoAlign());
+      diskRecorderBuildHeader_(file.contents, 44100, claimedFrameCount);
+
+      WavInfo info = {};
+      WaveDs64Chunk *ds64 = (WaveDs64Chunk *)(file.contents + sizeof(RiffHeader) + sizeof(WaveHeader));
+      success = (success && wavParse(file, &info) &&
+		 ((RiffHeader *)file.contents)->chunkID.id == RIFF("RF64") &&
+		 ds64->header.chunkID.id == RIFF("ds64") && ds64->sampleCount == claimedFrameCount &&
+		 info.format == WavSampleFormat_r32 && info.sampleRate == 44100 && info.frameCount == frameCount &&
+		 info.samples == file.contents + DISK_RECORDER_HEADER_SIZE);
+
+      // NOTE: and below it, the same header is plain riff
+      diskRecorderBuildHeader_(file.contents, 44100, frameCount);
+      success = (success && wavParse(file, &info) &&
+		 ((RiffHeader *)file.contents)->chunkID.id == RIFF("RIFF") && info.frameCount == frameCount &&
+		 info.samples == file.contents + DISK_RECORDER_HEADER_SIZE);
+    }
+
+    stringListPushFormat(scratch.arena, &testLog,
+			 "disk recorder: %llu frames, %llu readable mid-recording, %u dropouts (%llu frames), "
+			 "%llu header updates",
+			 totalFrameCount, midFrameCount, stats.dropoutCount, stats.droppedFrameCount,
+			 recorder->headerUpdateCount);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("disk recorder success") : STR8_LIT("disk recorder FAILED"));
+  }
+
+  // NOTE: decoded sample cache. A miss has to give what loadWav gives, and a hit the same samples
+  //       straight from the mapped entry, followed by zeroed padding. Then least-recently-used
+  //       eviction under a size limit, a damaged entry, and an entry too big for the cache
+  {
+    SampleCache *cache = sampleCacheCreate(scratch.arena, STR8_LIT(DATA_PATH"test/"), SAMPLE_CACHE_DEFAULT_MAX_SIZE);
+    String8 indexPath = sampleCacheIndexPath_(scratch.arena, cache);
+    gsRemoveFile((char *)indexPath.str);
+
+    // NOTE: 44.1kHz sources, so a miss has to resample
+    u32 sourceCount = 4;
+    u32 sourceFrameCount = 441000;
+    char *sourcePaths[] = {
+      DATA_PATH"test/cache_a.wav", DATA_PATH"test/cache_b.wav", DATA_PATH"test/cache_c.wav", DATA_PATH"test/cache_d.wav",
+    };
+    for(u32 sourceIndex = 0; sourceIndex < sourceCount; ++sourceIndex)
+      {
+	u32 frameCount = sourceFrameCount*((sourceIndex == 3) ? 4 : 1);
+	u32 dataSize = frameCount*2*sizeof(s16);
+	Buffer file = {};
+	file.size = sizeof(RiffHeader) + sizeof(WaveHeader) + sizeof(WaveFormatChunk) + sizeof(WaveDataChunk) + dataSize;
+	file.contents = arenaPushArray(scratch.arena, file.size, u8, arenaFlagsZeroNoAlign());
+	u8 *at = file.contents;
+
+	RiffHeader *riffHeader = (RiffHeader *)at; at += sizeof(RiffHeader);
+	riffHeader->chunkID.id = RIFF("RIFF");
+	riffHeader->chunkSize = (u32)(file.size - sizeof(RiffHeader));
+	WaveHeader *waveHeader = (WaveHeader *)at; at += sizeof(WaveHeader);
+	waveHeader->waveID.id = RIFF("WAVE");
+	WaveFormatChunk *fmt = (WaveFormatChunk *)at; at += sizeof(WaveFormatChunk);
+	fmt->header.chunkID.id = RIFF("fmt ");
+	fmt->header.chunkSize = sizeof(WaveFormatChunk) - sizeof(RiffHeader);
+	fmt->formatTag = WAV_FORMAT_PCM;
+	fmt->channelCount = 2;
+	fmt->sampleRate = 44100;
+	fmt->dataBlockSize = 2*sizeof(s16);
+	fmt->avgBytesPerSec = 44100*fmt->dataBlockSize;
+	fmt->bitsPerSample = 16;
+	WaveDataChunk *data = (WaveDataChunk *)at; at += sizeof(WaveDataChunk);
+	data->chunkID.id = RIFF("data");
+	data->chunkSize = dataSize;
+
+	s16 *samples = (s16 *)at;
+	for(u32 frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+	  {
+	    u64 cycleSamples = ((200 + 100*sourceIndex)*(u64)frameIndex) % 44100;
+	    r32 value = 0.8f*gsSin((r32)GS_TAU*(r32)cycleSamples/44100.f);
+	    samples[2*frameIndex + 0] = (s16)(value*32767.f);
+	    samples[2*frameIndex + 1] = (s16)(-value*16383.f);
+	  }
+	gsWriteEntireFile(sourcePaths[sourceIndex], file);
+      }
+
+    LoadedSound expected = loadWav(scratch.arena, STR8_CSTR(sourcePaths[0]));
+    LoadedSound shape = expected;
+    u64 entrySize = sampleCacheLayout_(0, 0, &shape).fileSize;
+
+    u64 missStart = getCpuCounter();
+    CachedSound miss = sampleCacheLoadWav(cache, scratch.arena, STR8_CSTR(sourcePaths[0]));
+    u64 missTicks = getCpuCounter() - missStart;
+    u64 hitStart = getCpuCounter();
+    CachedSound hit = sampleCacheLoadWav(cache, scratch.arena, STR8_CSTR(sourcePaths[0]));
+    u64 hitTicks = getCpuCounter() - hitStart;
+
+    b32 success = (expected.sampleCount > 0 && !miss.wasCached && hit.wasCached &&
+		   miss.sound.sampleCount == expected.sampleCount && hit.sound.sampleCount == expected.sampleCount &&
+		   hit.sound.channelCount == 2 && (INT_FROM_PTR(hit.sound.samples[0]) % SAMPLE_CACHE_ALIGNMENT) == 0);
+    for(u32 i = 0; success && i < SAMPLE_CACHE_CHANNEL_PADDING; ++i)
+      {
+	success = (hit.sound.samples[0][expected.sampleCount + i] == 0.f &&
+		   hit.sound.samples[1][expected.sampleCount + i] == 0.f);
+      }
+    for(u32 i = 0; success && i < expected.sampleCount; ++i)
+      {
+	success = (miss.sound.samples[0][i] == expected.samples[0][i] &&
+		   miss.sound.samples[1][i] == expected.samples[1][i] &&
+		   hit.sound.samples[0][i] == expected.samples[0][i] &&
+		   hit.sound.samples[1][i] == expected.samples[1][i]);
+      }
+    sampleCacheRelease(&miss);
+    sampleCacheRelease(&hit);
+
+    // NOTE: room for two entries, so each miss evicts whichever of the other two was used longest ago
+    cache->maxSize = 2*entrySize + entrySize/2;
+    b32 pattern[][2] = {
+      {1, false}, {0, true}, {2, false}, {0, true}, {1, false}, {2, false}, {0, false}, {2, true},
+    };
+    for(u32 stepIndex = 0; success && stepIndex < ARRAY_COUNT(pattern); ++stepIndex)
+      {
+	CachedSound sound = sampleCacheLoadWav(cache, scratch.arena, STR8_CSTR(sourcePaths[pattern[stepIndex][0]]));
+	success = (sound.sound.sampleCount == expected.sampleCount && sound.wasCached == pattern[stepIndex][1]);
+	sampleCacheRelease(&sound);
+      }
+
+    SampleCacheIndex *index = arenaPushStruct(scratch.arena, SampleCacheIndex);
+    sampleCacheReadIndex_(cache, index);
+    success = success && (index->entryCount == 2);
+
+    // NOTE: a damaged entry is decoded and cached again
+    if(success)
+      {
+	u8 zeros[sizeof(SampleCacheHeader)] = {};
+	String8 entryPath = sampleCacheEntryPath_(scratch.arena, cache, index->entries[0].sourceHash);
+	GS_File entryFile = gsOpenFileForWriting((char *)entryPath.str, false);
+	success = (entryFile && gsWriteFileAt(entryFile, 0, bufferMake(zeros, sizeof(zeros))));
+	gsCloseFile(entryFile);
+
+	u32 damagedSource = 0;
+	for(u32 sourceIndex = 0; sourceIndex < sourceCount; ++sourceIndex)
+	  {
+	    Buffer source = gsReadEntireFile(sourcePaths[sourceIndex], scratch.arena);
+	    u64 sourceHash = grainPackfileChecksum(GRAIN_PACKFILE_CHECKSUM_SEED, source.contents, source.size);
+	    if(sourceHash == index->entries[0].sourceHash) damagedSource = sourceIndex;
+	  }
+	CachedSound damaged = sampleCacheLoadWav(cache, scratch.arena, STR8_CSTR(sourcePaths[damagedSource]));
+	CachedSound repaired = sampleCacheLoadWav(cache, scratch.arena, STR8_CSTR(sourcePaths[damagedSource]));
+	success = (success && !damaged.wasCached && damaged.sound.sampleCount == expected.sampleCount &&
+		   repaired.wasCached);
+	sampleCacheRelease(&damaged);
+	sampleCacheRelease(&repaired);
+      }
+
+    // NOTE: d is bigger than the whole cache, so it's never cached, and evicts nothing
+    for(u32 attempt = 0; success && attempt < 2; ++attempt)
+      {
+	CachedSound big = sampleCacheLoadWav(cache, scratch.arena, STR8_CSTR(sourcePaths[3]));
+	success = (big.sound.sampleCount > 2*expected.sampleCount && !big.wasCached);
+	sampleCacheRelease(&big);
+      }
+    sampleCacheReadIndex_(cache, index);
+    success = success && (index->entryCount == 2);
+
+    for(u32 entryIndex = 0; entryIndex < index->entryCount; ++entryIndex)
+      {
+	String8 entryPath = sampleCacheEntryPath_(scratch.arena, cache, index->entries[entryIndex].sourceHash);
+	gsRemoveFile((char *)entryPath.str);
+      }
+    gsRemoveFile((char *)indexPath.str);
+    for(u32 sourceIndex = 0; sourceIndex < sourceCount; ++sourceIndex)
+      {
+	gsRemoveFile(sourcePaths[sourceIndex]);
+      }
+
+    stringListPushFormat(scratch.arena, &testLog,
+			 "sample cache: %u frames, %llu ticks to decode and cache, %llu ticks to load cached",
+			 expected.sampleCount, missTicks, hitTicks);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("sample cache success") : STR8_LIT("sample cache FAILED"));
+  }
+
+  // NOTE: retained ui frames. Idle input, and the mouse moving over nothing, hand back the last
+  //       frame's quads without building it again; hovering an element, a parameter changing, or new
+  //       grain view data rebuild it. The benchmark compares a frame's cost idle and active
+  {
+    PluginMemory pluginMemory = {};
+    pluginMemory.host = PluginHost_batch;
+    PluginState *pluginState = initializePluginState(&pluginMemory);
+
+    RenderCommands *commands = arenaPushStruct(scratch.arena, RenderCommands, arenaFlagsZeroNoAlign());
+    commands->allocator = scratch.arena;
+    commands->quadCapacity = RENDER_INITIAL_QUAD_CAPACITY;
+    commands->quads = arenaPushArray(scratch.arena, commands->quadCapacity, R_Quad);
+    PluginInput *input = arenaPushStruct(scratch.arena, PluginInput, arenaFlagsZeroNoAlign());
+    input->mouseState.position = V2(1, 1);
+
+#define RETAINED_FRAME_TEST_FRAME()				\
+    renderBeginCommands(commands, 1280, 720);			\
+    pluginRenderNewFrame(pluginState, input, commands);		\
+    frameQuadCount = commands->quadCount;			\
+    frameQuadHash = grainPackfileChecksum(GRAIN_PACKFILE_CHECKSUM_SEED, (u8 *)commands->quads, \
+					  frameQuadCount*sizeof(R_Quad)); \
+    renderEndCommands(commands)
+
+    usz frameQuadCount = 0;
+    u64 frameQuadHash = 0;
+    RETAINED_FRAME_TEST_FRAME();
+    usz builtQuadCount = frameQuadCount;
+    u64 builtQuadHash = frameQuadHash;
+    b32 success = (builtQuadCount > 0 && !commands->frameIsRetained && commands->unchangedFrameCount == 0);
+
+    // NOTE: idle
+    for(u32 frameIndex = 0; success && frameIndex < 3; ++frameIndex)
+      {
+	RETAINED_FRAME_TEST_FRAME();
+	success = (commands->frameIsRetained && commands->unchangedFrameCount == frameIndex + 1 &&
+		   frameQuadCount == builtQuadCount && frameQuadHash == builtQuadHash);
+      }
+    success = success && !renderFrameNeedsSubmission(commands);
+
+    // NOTE: a host whose buffers lost the frame has it drawn again, until every buffer holds it
+    renderDiscardSubmittedFrames(commands);
+    for(u32 frameIndex = 0; frameIndex < RENDER_SWAP_CHAIN_LENGTH; ++frameIndex)
+      {
+	success = success && renderFrameNeedsSubmission(commands);
+	RETAINED_FRAME_TEST_FRAME();
+	success = success && commands->frameIsRetained && frameQuadHash == builtQuadHash;
+      }
+    success = success && !renderFrameNeedsSubmission(commands);
+
+    // NOTE: the mouse moving over nothing
+    UIContext *uiContext = &pluginState->uiContext;
+    Rect2 hotRegion = {};
+    for(u32 regionIndex = 0; regionIndex < uiContext->hotRegionCount; ++regionIndex)
+      {
+	Rect2 region = uiContext->hotRegions[regionIndex];
+	success = success && !isInRectangle(region, V2(1, 1)) && !isInRectangle(region, V2(2, 3));
+	v2 regionDim = getDim(region);
+	if(regionDim.x > 4 && regionDim.y > 4) hotRegion = region;
+      }
+    input->mouseState.position = V2(2, 3);
+    RETAINED_FRAME_TEST_FRAME();
+    success = (success && commands->frameIsRetained && frameQuadHash == builtQuadHash &&
+	       getDim(hotRegion).x > 0);
+
+    // NOTE: hovering an element shows its tooltip
+    input->mouseState.position = getCenter(hotRegion);
+    RETAINED_FRAME_TEST_FRAME();
+    success = (success && !commands->frameIsRetained && commands->unchangedFrameCount == 0 &&
+	       frameQuadHash != builtQuadHash && renderFrameNeedsSubmission(commands));
+    input->mouseState.position = V2(1, 1);
+    RETAINED_FRAME_TEST_FRAME();
+    success = (success && !commands->frameIsRetained && frameQuadHash == builtQuadHash);
+    RETAINED_FRAME_TEST_FRAME();
+    success = success && commands->frameIsRetained;
+
+    // NOTE: a parameter changing, eg from host automation
+    PluginFloatParameter *volume = pluginState->parameters + PluginParameter_volume;
+    ParameterValue oldVolume = {};
+    oldVolume.asInt = volume->currentValue.asInt;
+    ParameterValue newVolume = {};
+    newVolume.asFloat = 0.5f*(oldVolume.asFloat + volume->range.min);
+    volume->currentValue.asInt = newVolume.asInt;
+    RETAINED_FRAME_TEST_FRAME();
+    success = success && !commands->frameIsRetained && frameQuadHash != builtQuadHash;
+    volume->currentValue.asInt = oldVolume.asInt;
+    RETAINED_FRAME_TEST_FRAME();
+    success = success && !commands->frameIsRetained && frameQuadHash == builtQuadHash;
+
+    // NOTE: new grain view data
+    GrainStateView *grainStateView = &pluginState->grainStateView;
+    grainStateView->views[grainStateView->viewReadIndex].sampleCount = 0;
+    grainStateView->views[grainStateView->viewReadIndex].grainCount = 0;
+    gsAtomicStore(&grainStateView->entriesQueued, 1);
+    RETAINED_FRAME_TEST_FRAME();
+    success = success && !commands->frameIsRetained && gsAtomicLoad(&grainStateView->entriesQueued) == 0;
+    RETAINED_FRAME_TEST_FRAME();
+    success = success && commands->frameIsRetained;
+
+    // NOTE: benchmark. Active frames have the mouse moving over an element
+    u32 benchmarkFrameCount = 256;
+    u64 idleStart = getCpuCounter();
+    for(u32 frameIndex = 0; frameIndex < benchmarkFrameCount; ++frameIndex)
+      {
+	RETAINED_FRAME_TEST_FRAME();
+      }
+    u64 idleTicks = getCpuCounter() - idleStart;
+    success = success && commands->frameIsRetained;
+
+    u64 activeStart = getCpuCounter();
+    for(u32 frameIndex = 0; frameIndex < benchmarkFrameCount; ++frameIndex)
+      {
+	input->mouseState.position = getCenter(hotRegion) + V2(0, (r32)(frameIndex & 1));
+	RETAINED_FRAME_TEST_FRAME();
+      }
+    u64 activeTicks = getCpuCounter() - activeStart;
+    success = success && !commands->frameIsRetained;
+#undef RETAINED_FRAME_TEST_FRAME
+
+    releasePluginState(pluginState);
+
+    stringListPushFormat(scratch.arena, &testLog,
+			 "retained frames: %llu quads, %llu ticks per idle frame, %llu ticks per active frame",
+			 (u64)builtQuadCount, idleTicks/benchmarkFrameCount, activeTicks/benchmarkFrameCount);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("retained frames success") : STR8_LIT("retained frames FAILED"));
+  }
+
+  // NOTE: quad storage growth. A dense grain view pushes many times the initial capacity
+  {
+    RenderCommands *commands = arenaPushStruct(scratch.arena, RenderCommands, arenaFlagsZeroNoAlign());
+    commands->allocator = scratch.arena;
+    commands->quadCapacity = RENDER_INITIAL_QUAD_CAPACITY;
+    commands->quads = arenaPushArray(scratch.arena, commands->quadCapacity, R_Quad);
+
+    u32 quadCount = 20*RENDER_INITIAL_QUAD_CAPACITY;
+    u64 start = getCpuCounter();
+    for(u32 quadIndex = 0; quadIndex < quadCount; ++quadIndex)
+      {
+	Rect2 rect = rectMinDim(V2((r32)quadIndex, 0), V2(1, 1));
+	renderPushQuad(commands, rect, PLUGIN_ASSET(null), 0, RENDER_LEVEL(grainViewSignal));
+      }
+    u64 ticks = getCpuCounter() - start;
+
+    b32 success = (commands->quadCount == quadCount && commands->quadCapacity >= quadCount);
+    for(u32 quadIndex = 0; success && quadIndex < quadCount; ++quadIndex)
+      {
+	success = (commands->quads[quadIndex].min.x == (r32)quadIndex);
+      }
+
+    stringListPushFormat(scratch.arena, &testLog, "quad growth: %u quads, capacity %llu, %llu ticks per quad",
+			 quadCount, (u64)commands->quadCapacity, ticks/quadCount);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("quad growth success") : STR8_LIT("quad growth FAILED"));
   }
+
+  // NOTE: software renderer. Coverage, rotation, blending, depth and discard are checked on single
+  //       pixels, against what the gl backend draws. Then a plugin ui frame has to come out the same
+  //       however many workers draw it, and is timed
+  {
+    u32 atlasTexels[4] = {0xFFFFFFFF, 0x00FFFFFF, 0xFFFFFFFF, 0xFFFFFFFF};
+    LoadedBitmap atlas = {};
+    atlas.width = 2;
+    atlas.height = 2;
+    atlas.stride = atlas.width*sizeof(u32);
+    atlas.pixels = atlasTexels;
+
+    // NOTE: uvs on texel centers, so sampling doesn't filter in the neighbors
+    PluginAsset opaqueAsset = {};
+    opaqueAsset.uv = rectMinMax(V2(0.75f, 0.75f), V2(0.75f, 0.75f));
+    PluginAsset transparentAsset = {};
+    transparentAsset.uv = rectMinMax(V2(0.75f, 0.25f), V2(0.75f, 0.25f));
+
+    RenderCommands *commands = arenaPushStruct(scratch.arena, RenderCommands, arenaFlagsZeroNoAlign());
+    commands->allocator = scratch.arena;
+    commands->quadCapacity = RENDER_INITIAL_QUAD_CAPACITY;
+    commands->quads = arenaPushArray(scratch.arena, commands->quadCapacity, R_Quad);
+    commands->atlas = &atlas;
+
+    SoftwareRenderer *renderer = softwareRendererCreate(scratch.arena, 3);
+    SoftwareFramebuffer framebuffer = softwareFramebufferAllocate(scratch.arena, 100, 70);
+    b32 success = (renderer->workerCount == 3 && framebuffer.stride >= framebuffer.width);
+#define SOFTWARE_RENDER_TEST_PIXEL(x, y) (framebuffer.pixels[(y)*framebuffer.stride + (x)])
+
+    // NOTE: an opaque quad covers the pixel centers inside it
+    softwareFramebufferClear(&framebuffer, V4(0, 0, 0, 1));
+    renderPushQuad(commands, rectMinMax(V2(10, 10), V2(30, 20)), &opaqueAsset, 0, 0, V4(1, 0, 0, 1));
+    softwareRenderCommands(renderer, commands, &framebuffer);
+    commands->quadCount = 0;
+    success = (success &&
+	       SOFTWARE_RENDER_TEST_PIXEL(10, 10) == 0xFF0000FF && SOFTWARE_RENDER_TEST_PIXEL(29, 19) == 0xFF0000FF &&
+	       SOFTWARE_RENDER_TEST_PIXEL(9, 10) == 0xFF000000 && SOFTWARE_RENDER_TEST_PIXEL(30, 19) == 0xFF000000 &&
+	       SOFTWARE_RENDER_TEST_PIXEL(10, 20) == 0xFF000000 && SOFTWARE_RENDER_TEST_PIXEL(10, 9) == 0xFF000000);
+
+    // NOTE: a square turned by an eighth of a turn reaches past its sides, and leaves its corners
+    softwareFramebufferClear(&framebuffer, V4(0, 0, 0, 1));
+    renderPushQuad(commands, rectCenterDim(V2(50, 35), V2(40, 40)), &opaqueAsset, 0.25f*GS_PI, 0,
+		   V4(0, 1, 0, 1));
+    softwareRenderCommands(renderer, commands, &framebuffer);
+    commands->quadCount = 0;
+    success = (success &&
+	       SOFTWARE_RENDER_TEST_PIXEL(76, 35) == 0xFF00FF00 && SOFTWARE_RENDER_TEST_PIXEL(50, 61) == 0xFF00FF00 &&
+	       SOFTWARE_RENDER_TEST_PIXEL(68, 53) == 0xFF000000 && SOFTWARE_RENDER_TEST_PIXEL(31, 16) == 0xFF000000);
+
+    // NOTE: half transparent white over black, and a nearer quad over a farther one, in either order
+    softwareFramebufferClear(&framebuffer, V4(0, 0, 0, 1));
+    renderPushQuad(commands, rectMinMax(V2(0, 0), V2(10, 10)), &opaqueAsset, 0, 0, V4(1, 1, 1, 0.5f));
+    renderPushQuad(commands, rectMinMax(V2(20, 0), V2(30, 10)), &opaqueAsset, 0, 0, V4(1, 0, 0, 1));
+    renderPushQuad(commands, rectMinMax(V2(20, 0), V2(30, 10)), &opaqueAsset, 0, 0.5f, V4(0, 1, 0, 1));
+    renderPushQuad(commands, rectMinMax(V2(40, 0), V2(50, 10)), &opaqueAsset, 0, 0.5f, V4(1, 0, 0, 1));
+    renderPushQuad(commands, rectMinMax(V2(40, 0), V2(50, 10)), &opaqueAsset, 0, 0, V4(0, 1, 0, 1));
+    softwareRenderCommands(renderer, commands, &framebuffer);
+    commands->quadCount = 0;
+    u32 blended = SOFTWARE_RENDER_TEST_PIXEL(5, 5);
+    success = (success &&
+	       (blended & 0xFF) >= 127 && (blended & 0xFF) <= 129 &&
+	       ((blended >> 8) & 0xFF) == (blended & 0xFF) && ((blended >> 16) & 0xFF) == (blended & 0xFF) &&
+	       SOFTWARE_RENDER_TEST_PIXEL(25, 5) == 0xFF0000FF && SOFTWARE_RENDER_TEST_PIXEL(45, 5) == 0xFF00FF00 &&
+	       framebuffer.depth[5*framebuffer.stride + 25] == 0 && framebuffer.depth[5*framebuffer.stride + 45] == 0);
+
+    // NOTE: discarded texels leave the depth alone, and levels outside the depth range are clipped
+    softwareFramebufferClear(&framebuffer, V4(0, 0, 0, 1));
+    renderPushQuad(commands, rectMinMax(V2(0, 0), V2(10, 10)), &transparentAsset, 0, -0.5f, V4(1, 1, 1, 1));
+    renderPushQuad(commands, rectMinMax(V2(0, 0), V2(10, 10)), &opaqueAsset, 0, 0.5f, V4(0, 0, 1, 1));
+    renderPushQuad(commands, rectMinMax(V2(20, 0), V2(30, 10)), &opaqueAsset, 0, 1.5f, V4(0, 0, 1, 1));
+    softwareRenderCommands(renderer, commands, &framebuffer);
+    commands->quadCount = 0;
+    success = (success &&
+	       SOFTWARE_RENDER_TEST_PIXEL(5, 5) == 0xFFFF0000 && SOFTWARE_RENDER_TEST_PIXEL(25, 5) == 0xFF000000);
+#undef SOFTWARE_RENDER_TEST_PIXEL
+
+    softwareRendererDestroy(renderer);
+
+    // NOTE: a ui frame, over an atlas of noise
+    u32 noiseAtlasDim = 512;
+    u32 *noiseTexels = arenaPushArray(scratch.arena, noiseAtlasDim*noiseAtlasDim, u32);
+    u32 noiseState = 0x9E3779B9;
+    for(u32 texelIndex = 0; texelIndex < noiseAtlasDim*noiseAtlasDim; ++texelIndex)
+      {
+	noiseState ^= noiseState << 13;
+	noiseState ^= noiseState >> 17;
+	noiseState ^= noiseState << 5;
+	noiseTexels[texelIndex] = noiseState;
+      }
+    atlas.width = noiseAtlasDim;
+    atlas.height = noiseAtlasDim;
+    atlas.stride = atlas.width*sizeof(u32);
+    atlas.pixels = noiseTexels;
+
+    PluginMemory pluginMemory = {};
+    pluginMemory.host = PluginHost_batch;
+    PluginState *pluginState = initializePluginState(&pluginMemory);
+    PluginInput *input = arenaPushStruct(scratch.arena, PluginInput, arenaFlagsZeroNoAlign());
+    renderBeginCommands(commands, 1280, 720);
+    pluginRenderNewFrame(pluginState, input, commands);
+    usz frameQuadCount = commands->quadCount;
+
+    u32 workerCounts[] = {0, 1, 7};
+    u64 frameTicks[ARRAY_COUNT(workerCounts)] = {};
+    u64 referenceHash = 0;
+    u32 benchmarkFrameCount = 4;
+    for(u32 runIndex = 0; runIndex < ARRAY_COUNT(workerCounts); ++runIndex)
+      {
+	renderer = softwareRendererCreate(scratch.arena, workerCounts[runIndex]);
+	framebuffer = softwareFramebufferAllocate(scratch.arena, 1280, 720);
+
+	u64 start = getCpuCounter();
+	for(u32 frameIndex = 0; frameIndex < benchmarkFrameCount; ++frameIndex)
+	  {
+	    softwareFramebufferClear(&framebuffer, V4(0.2f, 0.2f, 0.2f, 0));
+	    softwareRenderCommands(renderer, commands, &framebuffer);
+	  }
+	frameTicks[runIndex] = (getCpuCounter() - start)/benchmarkFrameCount;
+	softwareRendererDestroy(renderer);
+
+	u64 hash = grainPackfileChecksum(GRAIN_PACKFILE_CHECKSUM_SEED, (u8 *)framebuffer.pixels,
+					 framebuffer.stride*framebuffer.height*sizeof(u32));
+	if(runIndex == 0) referenceHash = hash;
+	success = success && hash == referenceHash;
+      }
+    renderEndCommands(commands);
+    releasePluginState(pluginState);
+
+    stringListPushFormat(scratch.arena, &testLog,
+			 "software renderer: %llu quads at 1280x720, %llu ticks per frame on 1 thread, "
+			 "%llu on 2, %llu on 8",
+			 (u64)frameQuadCount, frameTicks[0], frameTicks[1], frameTicks[2]);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("software renderer success") : STR8_LIT("software renderer FAILED"));
+  }
+
+  // NOTE: ui element keys and cache
+  {
+    TemporaryMemory frameMemory = arenaGetScratch(&scratch.arena, 1);
+    UIContext context = uiInitializeContext(frameMemory.arena, scratch.arena, &fontAgencyBold);
+    UILayout *layout = arenaPushStruct(scratch.arena, UILayout, arenaFlagsZeroNoAlign());
+    MouseState mouse = {};
+    KeyboardState keyboard = {};
+    mouse.position = V2(500, 300);
+
+    b32 success = (UI_KEY("DENSITY").key == uiHashKeyFromString(STR8_LIT("DENSITY")).key &&
+		   UI_KEY("DENSITY").key != UI_KEY("DENSITZ").key &&
+		   stringsAreEqual(UI_KEY("DENSITY").name, STR8_LIT("DENSITY")));
+
+    // NOTE: more elements than the cache has slots, then few enough that they all have to be found
+    //       again the next frame
+    u32 elementCounts[] = {4*UI_ELEMENT_CACHE_SIZE, UI_ELEMENT_CACHE_SIZE/4, UI_ELEMENT_CACHE_SIZE/4};
+    for(u32 frameIndex = 0; frameIndex < ARRAY_COUNT(elementCounts); ++frameIndex)
+      {
+	uiContextNewFrame(&context, &mouse, &keyboard, false);
+	uiBeginLayout(layout, &context, rectMinDim(V2(0, 0), V2(1280, 720)));
+	u32 foundCount = 0;
+	for(u32 elementIndex = 0; elementIndex < elementCounts[frameIndex]; ++elementIndex)
+	  {
+	    String8 name = arenaPushStringFormat(frameMemory.arena, "element %u", elementIndex);
+	    UIElement *element = uiMakeElement(layout, name, UIElementFlag_clickable, V4(1, 1, 1, 1), 0);
+	    foundCount += (uiGetCachedElement(element) != 0);
+	    element->lastFrameTouched = context.frameIndex;
+	  }
+	uiEndLayout(layout);
+	uiContextEndFrame(&context);
+	arenaEndTemporaryMemory(frameMemory);
+
+	if(frameIndex == ARRAY_COUNT(elementCounts) - 1)
+	  {
+	    success = success && (foundCount == elementCounts[frameIndex]);
+	  }
+      }
+
+    // NOTE: benchmark a frame like the menu's: eight controls with literal names, and a list of
+    //       device names
+    u32 benchmarkFrameCount = 1000;
+    u64 start = getCpuCounter();
+    for(u32 frameIndex = 0; frameIndex < benchmarkFrameCount; ++frameIndex)
+      {
+	uiContextNewFrame(&context, &mouse, &keyboard, false);
+	uiBeginLayout(layout, &context, rectMinDim(V2(0, 0), V2(1280, 720)));
+	u32 flags = UIElementFlag_clickable;
+	uiMakeBox(layout, UI_KEY("LEVEL"), rectMinDim(V2(10, 10), V2(40, 40)), flags);
+	uiMakeBox(layout, UI_KEY("DENSITY"), rectMinDim(V2(60, 10), V2(40, 40)), flags);
+	uiMakeBox(layout, UI_KEY("SPREAD"), rectMinDim(V2(110, 10), V2(40, 40)), flags);
+	uiMakeBox(layout, UI_KEY("OFFSET"), rectMinDim(V2(160, 10), V2(40, 40)), flags);
+	uiMakeBox(layout, UI_KEY("SIZE"), rectMinDim(V2(210, 10), V2(40, 40)), flags);
+	uiMakeBox(layout, UI_KEY("MIX"), rectMinDim(V2(260, 10), V2(40, 40)), flags);
+	uiMakeBox(layout, UI_KEY("PAN"), rectMinDim(V2(310, 10), V2(40, 40)), flags);
+	uiMakeBox(layout, UI_KEY("WINDOW"), rectMinDim(V2(360, 10), V2(40, 40)), flags);
+	for(u32 deviceIndex = 0; deviceIndex < 24; ++deviceIndex)
+	  {
+	    String8 name = arenaPushStringFormat(frameMemory.arena, "output device %u: speakers", deviceIndex);
+	    uiMakeSelectableTextElement(layout, name, 0.7f);
+	  }
+	uiEndLayout(layout);
+	uiContextEndFrame(&context);
+	arenaEndTemporaryMemory(frameMemory);
+      }
+    u64 ticks = getCpuCounter() - start;
+
+    stringListPushFormat(scratch.arena, &testLog, "ui build: %llu ticks per frame (33 elements)",
+			 ticks/benchmarkFrameCount);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("ui element cache success") : STR8_LIT("ui element cache FAILED"));
+  }
+
+  // NOTE: glyph run cache. Text drawn from the cache has to come out the same as text laid out
+  //       again, byte for byte, when it's found, moved, recolored, evicted, and too long to cache
+  {
+    UIGlyphRunCache *cache = arenaPushStruct(scratch.arena, UIGlyphRunCache, arenaFlagsZeroNoAlign());
+    cache->runs = arenaPushArray(scratch.arena, UI_GLYPH_RUN_CACHE_SIZE, UIGlyphRun, arenaFlagsZeroNoAlign());
+
+    RenderCommands *cachedCommands = arenaPushStruct(scratch.arena, RenderCommands, arenaFlagsZeroNoAlign());
+    RenderCommands *uncachedCommands = arenaPushStruct(scratch.arena, RenderCommands, arenaFlagsZeroNoAlign());
+    cachedCommands->allocator = scratch.arena;
+    uncachedCommands->allocator = scratch.arena;
+
+    String8 labels[] = {
+      STR8_LIT("DENSITY"), STR8_LIT("SPREAD"), STR8_LIT("OFFSET"), STR8_LIT("WINDOW"),
+      STR8_LIT("MIX"), STR8_LIT("A"), STR8_LIT(""),
+      STR8_LIT("output device 3: speakers (high definition audio device)"),
+      STR8_LIT("a label long enough that it can't fit in the run cache, so it gets laid out every time"),
+    };
+    b32 success = true;
+#define GLYPH_RUN_TEST_TEXT(string, textMin, regionWidth, color, inTooltip)	\
+    do {								\
+      v2 cachedEnd = renderPushText(cachedCommands, cache, &fontAgencyBold, string, textMin, \
+				    V2(0.5f, 0.5f), regionWidth, color, inTooltip); \
+      v2 uncachedEnd = renderPushText(uncachedCommands, 0, &fontAgencyBold, string, textMin, \
+				      V2(0.5f, 0.5f), regionWidth, color, inTooltip); \
+      success = success && cachedEnd.x == uncachedEnd.x && cachedEnd.y == uncachedEnd.y; \
+    } while(0)
+
+    // NOTE: laid out, found where they were, then moved and recolored, then moved to the tooltip
+    //       level, in narrow regions that cut the long labels off
+    u32 passCount = 4;
+    for(u32 passIndex = 0; passIndex < passCount; ++passIndex)
+      {
+	v2 passOffset = (passIndex >= 2) ? V2(13.25f*passIndex, -7.5f) : V2(0, 0);
+	v4 color = (passIndex >= 2) ? V4(1, 0.5f, 0, 1) : V4(1, 1, 1, 1);
+	for(u32 labelIndex = 0; labelIndex < ARRAY_COUNT(labels); ++labelIndex)
+	  {
+	    v2 textMin = V2(10, 700 - 20.f*labelIndex) + passOffset;
+	    r32 regionWidth = (labelIndex & 1) ? 1000.f : 120.f;
+	    GLYPH_RUN_TEST_TEXT(labels[labelIndex], textMin, regionWidth, color, passIndex == 3);
+	  }
+      }
+    u32 cacheableCount = ARRAY_COUNT(labels) - 1;
+    success = (success && cache->missCount == cacheableCount &&
+	       cache->hitCount == (passCount - 1)*cacheableCount);
+
+    // NOTE: more labels than the cache holds push the first ones out, and they're laid out again
+    for(u32 labelIndex = 0; labelIndex < UI_GLYPH_RUN_CACHE_SIZE + 16; ++labelIndex)
+      {
+	String8 label = arenaPushStringFormat(scratch.arena, "label %u", labelIndex);
+	GLYPH_RUN_TEST_TEXT(label, V2(400, 10 + (r32)labelIndex), 200.f, V4(1, 1, 1, 1), false);
+      }
+    u64 missCountBeforeReuse = cache->missCount;
+    for(u32 labelIndex = 0; labelIndex < ARRAY_COUNT(labels); ++labelIndex)
+      {
+	GLYPH_RUN_TEST_TEXT(labels[labelIndex], V2(10, 10), 1000.f, V4(1, 1, 1, 1), false);
+      }
+    success = success && cache->missCount == missCountBeforeReuse + cacheableCount;
+#undef GLYPH_RUN_TEST_TEXT
+
+    success = success && cachedCommands->quadCount == uncachedCommands->quadCount;
+    if(success)
+      {
+	usz quadBytes = cachedCommands->quadCount*sizeof(R_Quad);
+	success = (grainPackfileChecksum(GRAIN_PACKFILE_CHECKSUM_SEED, (u8 *)cachedCommands->quads, quadBytes) ==
+		   grainPackfileChecksum(GRAIN_PACKFILE_CHECKSUM_SEED, (u8 *)uncachedCommands->quads, quadBytes));
+      }
+
+    // NOTE: benchmark a frame of static labels, laid out every time and then drawn from the cache
+    u32 benchmarkFrameCount = 1000;
+    u64 uncachedTicks = 0;
+    u64 cachedTicks = 0;
+    for(u32 runIndex = 0; runIndex < 2; ++runIndex)
+      {
+	RenderCommands *commands = runIndex ? cachedCommands : uncachedCommands;
+	UIGlyphRunCache *runCache = runIndex ? cache : 0;
+	u64 start = getCpuCounter();
+	for(u32 frameIndex = 0; frameIndex < benchmarkFrameCount; ++frameIndex)
+	  {
+	    commands->quadCount = 0;
+	    for(u32 labelIndex = 0; labelIndex < ARRAY_COUNT(labels) - 1; ++labelIndex)
+	      {
+		renderPushText(commands, runCache, &fontAgencyBold, labels[labelIndex],
+			       V2(10, 700 - 20.f*labelIndex), V2(0.5f, 0.5f), 1000.f);
+	      }
+	  }
+	u64 ticks = (getCpuCounter() - start)/benchmarkFrameCount;
+	if(runIndex) cachedTicks = ticks;
+	else uncachedTicks = ticks;
+      }
+    r32 hitRate = (r32)cache->hitCount/(r32)(cache->hitCount + cache->missCount);
+
+    stringListPushFormat(scratch.arena, &testLog,
+			 "glyph run cache: %llu ticks per frame laid out, %llu cached, %.1f%% hit rate",
+			 uncachedTicks, cachedTicks, 100.f*hitRate);
+    stringListPush(scratch.arena, &testLog,
+		   success ? STR8_LIT("glyph run cache success") : STR8_LIT("glyph run cache FAILED"));
+  }
+
   String8List profilerLog = profileEnd(scratch.arena);
   String8 profilerLogString = stringListJoin(scratch.arena, &profilerLog, STR8_LIT("\n"));
 
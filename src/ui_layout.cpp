@@ -15,13 +15,13 @@ uiPopParentElement(UILayout *layout)
 }
 
 inline UIElement *
-uiAllocateElement(UILayout *layout, String8 name, u32 flags, v4 color, PluginAsset *texture)
+uiAllocateElement(UILayout *layout, UIHashKey key, u32 flags, v4 color, PluginAsset *texture)
 {
   UIContext *context = layout->context;
   UIElement *result = arenaPushStruct(context->frameArena, UIElement, arenaFlagsZeroNoAlign());
   result->layout = layout;
-  result->name = arenaPushString(context->frameArena, name);
-  //result->name = arenaPushString(context->permanentArena, name);
+  result->hashKey = key;
+  result->name = key.name;
   result->textScale = V2(1, 1);
   result->flags = flags;
   result->color = color;
@@ -33,40 +33,33 @@ uiAllocateElement(UILayout *layout, String8 name, u32 flags, v4 color, PluginAss
 inline UIHashKey
 uiHashKeyFromString(String8 name)
 {
-  // TODO: better hash function
-  u64 hashKey = 5381;
+  u64 hash = UI_HASH_SEED;
   u8 *at = name.str;
   u64 count = name.size;
-  //while(*at)
   for(u64 i = 0; i < count; ++i)
     {
-      hashKey = ((hashKey << 5) + hashKey + *at++);
+      hash = (hash ^ *at++)*UI_HASH_PRIME;
     }
 
-  UIHashKey result = {};
-  result.key = hashKey;
-  result.name = name;
+  UIHashKey result = uiHashKeyMake_(name, uiHashFinalize_(hash));
   
   return(result);
 }
 
+// NOTE: names aren't compared. A cached element's name can point into an earlier frame's memory,
+//       and two names colliding in all 64 bits of the key is not a case worth the string compare
 inline bool
 uiHashKeysAreEqual(UIHashKey key1, UIHashKey key2)
 {
   bool result = (key1.key == key2.key);
-  if(result)
-    {
-      result = stringsAreEqual(key1.name, key2.name);   
-    }
 
   return(result);
 }
 
 inline UIElement *
-uiMakeElement(UILayout *layout, String8 name, u32 flags, v4 color, PluginAsset *texture)	      
+uiMakeElement(UILayout *layout, UIHashKey key, u32 flags, v4 color, PluginAsset *texture)	      
 {  
-  UIElement *result = uiAllocateElement(layout, name, flags, color, texture);
-  result->hashKey = uiHashKeyFromString(result->name);
+  UIElement *result = uiAllocateElement(layout, key, flags, color, texture);
 
   // NOTE: if the new element existed previously, get the previously computed information
   UIElement *cachedElement = uiGetCachedElement(result);
@@ -101,6 +94,18 @@ uiMakeElement(UILayout *layout, String8 name, u32 flags, v4 color, PluginAsset *
   return(result);
 }
 
+// NOTE: for names only known at runtime, which are copied, since the caller's string might not
+//       outlive the frame
+inline UIElement *
+uiMakeElement(UILayout *layout, String8 name, u32 flags, v4 color, PluginAsset *texture)
+{
+  UIContext *context = layout->context;
+  UIHashKey key = uiHashKeyFromString(arenaPushString(context->frameArena, name));
+  UIElement *result = uiMakeElement(layout, key, flags, color, texture);
+
+  return(result);
+}
+
 inline void
 uiSetElementDataBoolean(UIElement *element, PluginBooleanParameter *param)
 {
@@ -214,6 +219,9 @@ uiInitializeContext(Arena *frameArena, Arena *permanentArena, LoadedFont *font)
   result.frameArena = frameArena;
   result.permanentArena = permanentArena;
   result.font = font;
+  result.glyphRuns = arenaPushStruct(permanentArena, UIGlyphRunCache, arenaFlagsZeroNoAlign());
+  result.glyphRuns->runs = arenaPushArray(permanentArena, UI_GLYPH_RUN_CACHE_SIZE, UIGlyphRun,
+					  arenaFlagsZeroNoAlign());
 
   return(result);
 }
@@ -252,6 +260,40 @@ uiContextNewFrame(UIContext *context, MouseState *mouse, KeyboardState *keyboard
   ++context->frameIndex;
   context->layoutCount = 0;
   context->processedElementCount = 0;
+  context->hotRegionCount = 0;
+  context->hotRegionsOverflowed = 0;
+}
+
+// NOTE: whether the input since the last built frame could change anything the ui draws. Any
+//       button or key changing, a mouse button held down, scrolling, or the mouse moving into, out
+//       of or within an element's clickable region does
+static b32
+uiInputIsIdle(UIContext *context, MouseState *mouse, KeyboardState *keyboard)
+{
+  b32 result = (mouse->scrollDelta == 0);
+  for(u32 buttonIndex = 0; result && buttonIndex < MouseButton_COUNT; ++buttonIndex)
+    {
+      ButtonState button = mouse->buttons[buttonIndex];
+      if(button.halfTransitionCount || button.endedDown) result = 0;
+    }
+  for(u32 keyIndex = 0; result && keyIndex < KeyboardButton_COUNT; ++keyIndex)
+    {
+      if(keyboard->keys[keyIndex].halfTransitionCount) result = 0;
+    }
+
+  v2 oldMouseP = context->mouseP.xy;
+  v2 newMouseP = mouse->position;
+  if(result && (oldMouseP.x != newMouseP.x || oldMouseP.y != newMouseP.y))
+    {
+      if(context->hotRegionsOverflowed) result = 0;
+      for(u32 regionIndex = 0; result && regionIndex < context->hotRegionCount; ++regionIndex)
+	{
+	  Rect2 region = context->hotRegions[regionIndex];
+	  if(isInRectangle(region, oldMouseP) || isInRectangle(region, newMouseP)) result = 0;
+	}
+    }
+
+  return(result);
 }
 
 static void
@@ -279,7 +321,7 @@ uiBeginLayout(UILayout *layout, UIContext *context, Rect2 parentRect,
       layout->selectedElement = {};
     }
   
-  layout->root = uiMakeElement(layout, STR8_LIT("root"), 0, color, texture);
+  layout->root = uiMakeElement(layout, UI_KEY("root"), 0, color, texture);
   layout->root->flags = // UIElementFlag_drawBorder | 
     UIElementFlag_drawBackground;
   layout->root->lastFrameTouched = context->frameIndex;
@@ -307,47 +349,37 @@ uiCacheElement(UIElement *element)
   UILayout *layout = element->layout;
   UIContext *context = layout->context;
   
-  UIHashKey hashKey = element->hashKey;
-  u64 cacheIndex = hashKey.key % ARRAY_COUNT(layout->elementCache);
-  UIElement *cachedElement = layout->elementCache[cacheIndex];
-  if(cachedElement)
+  u64 key = element->hashKey.key;
+  u64 slotMask = ARRAY_COUNT(layout->elementCache) - 1;
+
+  // NOTE: take the element's own slot, or the first empty one, or failing both, the slot of the
+  //       element touched longest ago
+  UIElement **slot = 0;
+  for(u32 probeIndex = 0; probeIndex < UI_ELEMENT_CACHE_MAX_PROBES; ++probeIndex)
     {
-      if(uiHashKeysAreEqual(hashKey, cachedElement->hashKey))
+      UIElement **probe = layout->elementCache + ((key + probeIndex) & slotMask);
+      if(!*probe || (*probe)->hashKey.key == key)
 	{
-	  if(element->lastFrameTouched > cachedElement->lastFrameTouched || context->windowResized)
-	    {
-	      element->nextInHash = cachedElement->nextInHash;
-	      *cachedElement = *element;
-	    }
+	  slot = probe;
+	  break;
 	}
-      else
+
+      if(!slot || (*probe)->lastFrameTouched < (*slot)->lastFrameTouched)
 	{
-	  while(cachedElement->nextInHash)
-	    {
-	      cachedElement = cachedElement->nextInHash;
-	      if(uiHashKeysAreEqual(hashKey, cachedElement->hashKey))
-		{
-		  if(element->lastFrameTouched > cachedElement->lastFrameTouched || context->windowResized)
-		    {
-		      element->nextInHash = cachedElement->nextInHash;
-		      *cachedElement = *element;
-		    }
-		  break;
-		}
-	    }
-      
-	  if(!cachedElement->nextInHash)
-	    {
-	      cachedElement->nextInHash = arenaPushStruct(layout->context->permanentArena, UIElement);
-	      *cachedElement->nextInHash = *element;
-	      cachedElement = cachedElement->nextInHash;
-	    }
+	  slot = probe;
 	}
     }
-  else
+
+  UIElement *cachedElement = *slot;
+  if(!cachedElement)
+    {
+      cachedElement = arenaPushStruct(context->permanentArena, UIElement);
+      *slot = cachedElement;
+      *cachedElement = *element;
+    }
+  else if(cachedElement->hashKey.key != key ||
+	  element->lastFrameTouched > cachedElement->lastFrameTouched || context->windowResized)
     {
-      cachedElement = arenaPushStruct(layout->context->permanentArena, UIElement);
-      layout->elementCache[cacheIndex] = cachedElement;
       *cachedElement = *element;
     }
 
@@ -359,30 +391,26 @@ uiGetCachedElement(UIElement *element)
 {
   UILayout *layout = element->layout;
   
-  UIHashKey hashKey = element->hashKey;
-  u64 cacheIndex = hashKey.key % ARRAY_COUNT(layout->elementCache);
-  UIElement *cachedElement = layout->elementCache[cacheIndex];
-  if(cachedElement)
+  u64 key = element->hashKey.key;
+  u64 slotMask = ARRAY_COUNT(layout->elementCache) - 1;
+
+  // NOTE: slots are never emptied, so an element is never cached past an empty slot
+  UIElement *result = 0;
+  for(u32 probeIndex = 0; probeIndex < UI_ELEMENT_CACHE_MAX_PROBES; ++probeIndex)
     {
-      if(!uiHashKeysAreEqual(hashKey, cachedElement->hashKey))
+      UIElement *cachedElement = layout->elementCache[(key + probeIndex) & slotMask];
+      if(!cachedElement)
 	{
-	  while(cachedElement->nextInHash)
-	    {
-	      cachedElement = cachedElement->nextInHash;
-	      if(uiHashKeysAreEqual(hashKey, cachedElement->hashKey))
-		{
-		  break;
-		}
-	    }
-
-	  if(!uiHashKeysAreEqual(hashKey, cachedElement->hashKey))
-	    {
-	      cachedElement = 0;
-	    }
+	  break;
+	}
+      if(cachedElement->hashKey.key == key)
+	{
+	  result = cachedElement;
+	  break;
 	}
     }
 
-  return(cachedElement);
+  return(result);
 }
 
 inline void
@@ -470,6 +498,15 @@ uiCommFromElement(UIElement *element)
   Rect2 clickableRect = element->clickableRegion;  
   v2 mouseP = context->mouseP.xy;
 
+  if(context->hotRegionCount < ARRAY_COUNT(context->hotRegions))
+    {
+      context->hotRegions[context->hotRegionCount++] = clickableRect;
+    }
+  else
+    {
+      context->hotRegionsOverflowed = 1;
+    }
+
   UIComm result = {};
   result.element = element;
   if(isInRectangle(clickableRect, mouseP))
@@ -600,10 +637,10 @@ uiMakeSelectableTextElement(UILayout *layout, String8 message, r32 scale, v4 col
 }
 
 inline UIComm
-uiMakeBox(UILayout *layout, String8 name, Rect2 rect,
+uiMakeBox(UILayout *layout, UIHashKey key, Rect2 rect,
 	  u32 flags = 0, v4 color = V4(1, 1, 1, 1), PluginAsset *texture = 0)
 {
-  UIElement *box = uiMakeElement(layout, name, flags, color, texture);
+  UIElement *box = uiMakeElement(layout, key, flags, color, texture);
   box->region = rect;
 
   UIComm boxComm = uiCommFromElement(box);
@@ -612,12 +649,12 @@ uiMakeBox(UILayout *layout, String8 name, Rect2 rect,
 }
 
 inline UIComm
-uiMakeButton(UILayout *layout, String8 name, v2 offset, v2 dim, r32 aspectRatio,
+uiMakeButton(UILayout *layout, UIHashKey key, v2 offset, v2 dim, r32 aspectRatio,
 	     PluginBooleanParameter *param,
 	     PluginAsset *texture = PLUGIN_ASSET(null), v4 color = V4(1, 1, 1, 1))
 {
   u32 flags = UIElementFlag_clickable | UIElementFlag_drawBackground | UIElementFlag_drawBorder;
-  UIElement *button = uiMakeElement(layout, name, flags, color, texture);
+  UIElement *button = uiMakeElement(layout, key, flags, color, texture);
   uiSetElementDataBoolean(button, param);
 
   button->region = uiComputeElementRegion(button, offset, dim, aspectRatio);
@@ -630,7 +667,7 @@ uiMakeButton(UILayout *layout, String8 name, v2 offset, v2 dim, r32 aspectRatio,
 }
 
 inline UIComm
-uiMakeSlider(UILayout *layout, String8 name,
+uiMakeSlider(UILayout *layout, UIHashKey key,
 	     v2 offset, v2 dim, r32 aspectRatio, PluginFloatParameter *param,
 	     v2 clickableOffset, v2 clickableDim,
 	     v2 textOffset, v2 textScale,
@@ -638,7 +675,7 @@ uiMakeSlider(UILayout *layout, String8 name,
 	     PluginAsset *labelTexture = 0, v4 color = V4(1, 1, 1, 1))
 {
   u32 flags = (UIElementFlag_clickable | UIElementFlag_draggable | UIElementFlag_drawLabelBelow);
-  UIElement *slider = uiMakeElement(layout, name, flags, color, backgroundTexture);
+  UIElement *slider = uiMakeElement(layout, key, flags, color, backgroundTexture);
   uiSetElementDataFloat(slider, param);
   slider->secondaryTexture = clickableTexture;
   slider->labelTexture = labelTexture;   
@@ -656,7 +693,7 @@ uiMakeSlider(UILayout *layout, String8 name,
 }
 
 inline UIComm
-uiMakeKnob(UILayout *layout, String8 name, v2 offset, v2 dim, r32 aspectRatio,
+uiMakeKnob(UILayout *layout, UIHashKey key, v2 offset, v2 dim, r32 aspectRatio,
 	   PluginFloatParameter *param,	   
 	   v2 labelOffset, v2 labelDim,
 	   v2 clickableOffset, v2 clickableDim,
@@ -664,7 +701,7 @@ uiMakeKnob(UILayout *layout, String8 name, v2 offset, v2 dim, r32 aspectRatio,
 	   PluginAsset *texture = 0, PluginAsset *labelTexture = 0, v4 color = V4(1, 1, 1, 1))
 {
   u32 flags = (UIElementFlag_clickable | UIElementFlag_turnable | UIElementFlag_drawLabelBelow);
-  UIElement *knob = uiMakeElement(layout, name, flags, color, texture);
+  UIElement *knob = uiMakeElement(layout, key, flags, color, texture);
   uiSetElementDataFloat(knob, param);
   knob->labelOffset = labelOffset;
   knob->labelDim = labelDim;
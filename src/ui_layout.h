@@ -64,6 +64,53 @@ struct UIHashKey
   String8 name;
 };
 
+// NOTE: element keys are an FNV-1a hash of the element's name, put through murmur3's finalizer so
+//       that the low bits the element cache indexes with depend on every byte of the name.
+//       UI_KEY hashes a string literal at compile time; names only known at runtime go through
+//       uiHashKeyFromString, which gives the same key for the same name
+#define UI_HASH_SEED 0xCBF29CE484222325ULL
+#define UI_HASH_PRIME 0x100000001B3ULL
+
+static constexpr u64
+uiHashXorShift_(u64 hash)
+{
+  return(hash ^ (hash >> 33));
+}
+
+static constexpr u64
+uiHashFinalize_(u64 hash)
+{
+  return(uiHashXorShift_(uiHashXorShift_(uiHashXorShift_(hash)*0xFF51AFD7ED558CCDULL)*
+			 0xC4CEB9FE1A85EC53ULL));
+}
+
+static constexpr u64
+uiHashLiteral_(const char *name, usz count, u64 hash = UI_HASH_SEED)
+{
+  return(count ?
+	 uiHashLiteral_(name + 1, count - 1, (hash ^ (u8)*name)*UI_HASH_PRIME) :
+	 uiHashFinalize_(hash));
+}
+
+template<u64 hash>
+struct UIHashConstant_
+{
+  static const u64 key = hash;
+};
+
+static inline UIHashKey
+uiHashKeyMake_(String8 name, u64 key)
+{
+  UIHashKey result = {};
+  result.key = key;
+  result.name = name;
+
+  return(result);
+}
+
+#define UI_KEY(name)							\
+  uiHashKeyMake_(STR8_LIT(name), UIHashConstant_<uiHashLiteral_(name, sizeof(name) - 1)>::key)
+
 struct UIPressHistory
 {
   UIHashKey key;
@@ -71,12 +118,65 @@ struct UIPressHistory
   v2 pos;
 };
 
+#define UI_HOT_REGION_CAPACITY 64
+
+// NOTE: laid out text, kept from frame to frame. Runs are found by their font, string, scale and
+//       width, and once every run is taken the least recently drawn one is reused
+#define UI_GLYPH_RUN_CACHE_SIZE 128
+#define UI_GLYPH_RUN_BUCKET_COUNT 256 // NOTE: has to be a power of 2
+#define UI_GLYPH_RUN_MAX_GLYPHS 64
+
+struct UIGlyphRunGlyph
+{
+  v2 offset; // NOTE: from the text's min corner
+  v2 dim;
+};
+
+struct UIGlyphRun
+{
+  UIGlyphRun *nextInBucket;
+  UIGlyphRun *lessRecent;
+  UIGlyphRun *moreRecent;
+
+  u64 hash;
+  LoadedFont *font;
+  v2 textScale;
+  r32 regionWidth;
+  u32 textSize;
+  u8 text[UI_GLYPH_RUN_MAX_GLYPHS];
+
+  v2 endOffset;
+  u32 glyphCount;
+  UIGlyphRunGlyph glyphs[UI_GLYPH_RUN_MAX_GLYPHS];
+
+  // NOTE: the glyphs' quads where they were last drawn. Text that stays put in the same color and
+  //       level is copied into the frame as is
+  v2 placedMin;
+  u32 placedColor;
+  r32 placedLevel;
+  R_Quad quads[UI_GLYPH_RUN_MAX_GLYPHS];
+};
+
+struct UIGlyphRunCache
+{
+  UIGlyphRun *buckets[UI_GLYPH_RUN_BUCKET_COUNT];
+  UIGlyphRun *mostRecent;
+  UIGlyphRun *leastRecent;
+
+  UIGlyphRun *runs;
+  u32 runCount;
+
+  u64 hitCount;
+  u64 missCount;
+};
+
 struct UIContext
 {
   Arena *frameArena;
   Arena *permanentArena;
 
   LoadedFont *font;
+  UIGlyphRunCache *glyphRuns;
 
   // NOTE: interaction state
   v3 mouseP;
@@ -110,6 +210,12 @@ struct UIContext
   u32 selectedElementLayoutIndex;
   UIHashKey selectedElement;
   UIHashKey interactingElement;
+
+  // NOTE: the clickable regions of the elements built this frame. The mouse moving without
+  //       entering, leaving or moving within any of them can't change what the ui draws
+  Rect2 hotRegions[UI_HOT_REGION_CAPACITY];
+  u32 hotRegionCount;
+  b32 hotRegionsOverflowed;
 };
 
 struct UILayout;
@@ -126,7 +232,6 @@ struct UIElement
   // NOTE: hashing utility
   UIHashKey hashKey;
   u32 lastFrameTouched;
-  UIElement *nextInHash;
 
   // NOTE: specified at construction
   UILayout *layout;
@@ -186,6 +291,12 @@ uiLoadDragData(UIElement *element)
   return(element->dragData);
 }
 
+// NOTE: the element cache is open-addressed. An element lives within UI_ELEMENT_CACHE_MAX_PROBES
+//       slots of the slot its key picks, and when those are all taken by other elements, the one
+//       touched longest ago loses its slot
+#define UI_ELEMENT_CACHE_SIZE 256 // NOTE: has to be a power of two
+#define UI_ELEMENT_CACHE_MAX_PROBES 8
+
 struct UILayout
 {  
   UIContext *context;
@@ -195,7 +306,7 @@ struct UILayout
   
   UIElement *currentParent;
   
-  UIElement *elementCache[512];
+  UIElement *elementCache[UI_ELEMENT_CACHE_SIZE];
   UIElement *elementFreeList;
   
   Rect2 regionRemaining;
@@ -386,7 +497,7 @@ struct UIComm
   u32 flags;
 };
 
-UIHashKey uiHashKeyFromString(u8 *name);
+UIHashKey uiHashKeyFromString(String8 name);
 bool uiHashKeysAreEqual(UIHashKey key1, UIHashKey key2);
 
 static inline b32
@@ -120,6 +120,78 @@ gsWriteEntireFile(char *filename, Buffer file)
   return;
 }
 
+Buffer
+gsMapFile(char *filename)
+{
+  Buffer result = {};
+  UNUSED(filename);
+  return(result);
+}
+
+void
+gsUnmapFile(Buffer file)
+{
+  UNUSED(file);
+  return;
+}
+
+GS_File
+gsOpenFileForWriting(char *filename, b32 truncate)
+{
+  UNUSED(filename);
+  UNUSED(truncate);
+  return(0);
+}
+
+b32
+gsWriteFileAt(GS_File file, u64 offset, Buffer data)
+{
+  UNUSED(file);
+  UNUSED(offset);
+  UNUSED(data);
+  return(false);
+}
+
+void
+gsCloseFile(GS_File file)
+{
+  UNUSED(file);
+  return;
+}
+
+b32
+gsRemoveFile(char *filename)
+{
+  UNUSED(filename);
+  return(false);
+}
+
+b32
+gsRunModel(r32 *inputData, r32 *outputData, u32 batchCount, s64 inputLength)
+{
+  UNUSED(inputData);
+  UNUSED(outputData);
+  UNUSED(batchCount);
+  UNUSED(inputLength);
+  return(false);
+}
+
+// NOTE: the web build is single-threaded, so features that need a background thread are disabled
+b32
+gsStartThread(GS_ThreadProc *proc, void *data)
+{
+  UNUSED(proc);
+  UNUSED(data);
+  return(false);
+}
+
+void
+gsSleep(u32 msecsToWait)
+{
+  UNUSED(msecsToWait);
+  return;
+}
+
 r32
 gsRand(RangeR32 range)
 {
@@ -194,7 +266,6 @@ struct ThreadState
 thread_var ThreadState threadState;
 
 #define DEBUG_POINTER_XLIST\
-  X(render__quads)\
   X(audio__grainMixBuffersL)	   \
   X(audio__grainMixBuffersR)	   \
   X(audio__genericOutputFramesL)   \
@@ -402,6 +473,7 @@ struct WasmState
   Arena *arena;
 
   RenderCommands renderCommands;
+  b32 frameNeedsSubmission;
 
   PluginAudioBuffer audioBuffer;
   
@@ -447,10 +519,11 @@ wasmInit(void)
       }
 #endif
 
-      result->renderCommands.quadCapacity = 2048;      
+      // NOTE: the plugin grows the quads in this arena, so their offset is fetched every frame
+      result->renderCommands.allocator = arena;
+      result->renderCommands.quadCapacity = RENDER_INITIAL_QUAD_CAPACITY;
       result->renderCommands.quads = arenaPushArray(arena, result->renderCommands.quadCapacity, R_Quad);
       platformLogf("arena used post quads push: %u\n", arenaGetPos(arena));
-      DEBUG_POINTER_INITIALIZE(render__quads, result->renderCommands.quads);
 
       result->audioBuffer.inputBufferCapacity = 512;
       result->audioBuffer.inputBuffer[0] =
@@ -504,6 +577,12 @@ getQuadSize(void)
   return(sizeof(R_Quad));
 }
 
+proc_export usz
+getQuadCapacity(void)
+{
+  return(wasmState->renderCommands.quadCapacity);
+}
+
 proc_export R_Quad*
 getQuadsOffset(void)
 {
@@ -511,6 +590,14 @@ getQuadsOffset(void)
   return(result);
 }
 
+// NOTE: whether the last frame from drawQuads has to be drawn, or the canvas still shows it
+proc_export b32
+frameNeedsSubmission(void)
+{
+  b32 result = wasmState->frameNeedsSubmission;
+  return(result);
+}
+
 proc_export void*
 getInputSamplesOffset(int channelIdx)
 {
@@ -635,6 +722,7 @@ drawQuads(s32 width, s32 height, r32 timestamp)
   }
   
   u32 result = renderCommands->quadCount;
+  wasmState->frameNeedsSubmission = renderFrameNeedsSubmission(renderCommands);
 
   renderEndCommands(renderCommands);
   
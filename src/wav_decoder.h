@@ -0,0 +1,817 @@
+// NOTE: wave file decoding. The file is mapped (or, on hosts that can't map files, read whole),
+//       its chunks are walked with a RiffIterator, and the sample data is decoded
+//       WAV_DECODE_BLOCK_FRAMES at a time: each block is converted to floats by a simd kernel,
+//       split into left and right, and, if the file isn't at INTERNAL_SAMPLE_RATE, pushed through a
+//       streaming resampler. Only the decoded sound is ever held in memory, and a mapped file's
+//       pages are touched once, in order.
+//       Supports pcm at 8, 16, 24 and 32 bits, float at 32 and 64 bits, and WAVE_FORMAT_EXTENSIBLE
+//       with either as its subformat, in riff or rf64 files. Mono is copied to both channels, and files with more than two
+//       channels keep their first two
+#define RIFF(str) FOURCC(str)
+
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_IEEE_FLOAT 0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+#define WAV_DECODE_BLOCK_FRAMES 4096
+#define WAV_RESAMPLER_HISTORY 3 // NOTE: source frames kept from the previous block for the cubic
+
+union RiffID
+{
+  u32 id;
+  u8 str[4];
+};
+
+#pragma pack(push, 1)
+struct RiffHeader
+{
+  RiffID chunkID;
+  u32 chunkSize;
+};
+
+struct WaveHeader
+{
+  RiffID waveID;
+};
+
+struct WaveFormatChunk
+{
+  RiffHeader header;
+  u16 formatTag;
+  u16 channelCount;
+  u32 sampleRate;
+  u32 avgBytesPerSec;
+  u16 dataBlockSize;
+  u16 bitsPerSample;
+};
+
+struct WaveFormatExtension
+{
+  u16 cbSize;
+  u16 validBitsPerSample;
+  u32 channelMask;
+  u8 subFmt[16];
+};
+
+struct WaveFormatExtended
+{
+  WaveFormatChunk fmt;
+  WaveFormatExtension ex;
+};
+
+// NOTE: rf64 files are riff files whose 32-bit sizes are all 0xFFFFFFFF, with the real sizes in a
+//       ds64 chunk that comes first
+struct WaveDs64Chunk
+{
+  RiffHeader header;
+  u64 riffSize;
+  u64 dataSize;
+  u64 sampleCount;
+  u32 tableLength;
+};
+#pragma pack(pop)
+
+typedef RiffHeader WaveDataChunk;
+
+enum WavSampleFormat
+{
+  WavSampleFormat_none,
+  WavSampleFormat_u8,
+  WavSampleFormat_s16,
+  WavSampleFormat_s24,
+  WavSampleFormat_s32,
+  WavSampleFormat_r32,
+  WavSampleFormat_r64,
+  WavSampleFormat_count,
+};
+
+struct WavInfo
+{
+  WavSampleFormat format;
+  u32 channelCount;
+  u32 sampleRate;
+  u32 bytesPerFrame;
+  u64 frameCount;
+  u8 *samples;   // NOTE: interleaved, little-endian, not necessarily aligned
+};
+
+// NOTE: walks the chunks of a riff body. Chunk sizes are clamped to the end of the buffer, so
+//       truncated files still give what they have, and odd-sized chunks skip their pad byte
+struct RiffIterator
+{
+  u8 *at;
+  u8 *end;
+};
+
+static inline RiffIterator
+riffIteratorBegin(u8 *at, u8 *end)
+{
+  RiffIterator result = {};
+  result.at = at;
+  result.end = end;
+
+  return(result);
+}
+
+static inline b32
+riffIteratorIsValid(RiffIterator it)
+{
+  b32 result = (it.at < it.end) && ((usz)(it.end - it.at) >= sizeof(RiffHeader));
+  return(result);
+}
+
+static inline u32
+riffIteratorChunkID(RiffIterator it)
+{
+  RiffHeader *header = (RiffHeader *)it.at;
+  return(header->chunkID.id);
+}
+
+static inline usz
+riffIteratorChunkSize(RiffIterator it)
+{
+  RiffHeader *header = (RiffHeader *)it.at;
+  usz available = (usz)(it.end - it.at) - sizeof(RiffHeader);
+  usz result = MIN((usz)header->chunkSize, available);
+
+  return(result);
+}
+
+static inline u8 *
+riffIteratorChunkData(RiffIterator it)
+{
+  u8 *result = it.at + sizeof(RiffHeader);
+  return(result);
+}
+
+static inline RiffIterator
+riffIteratorNext(RiffIterator it)
+{
+  RiffHeader *header = (RiffHeader *)it.at;
+  u64 advance = sizeof(RiffHeader) + (u64)header->chunkSize + (header->chunkSize & 1);
+  if(advance >= (u64)(it.end - it.at))
+    {
+      it.at = it.end;
+    }
+  else
+    {
+      it.at += advance;
+    }
+
+  return(it);
+}
+
+static inline u32
+wavBytesPerSample(WavSampleFormat format)
+{
+  static u32 bytes[WavSampleFormat_count] = {0, 1, 2, 3, 4, 4, 8};
+  u32 result = bytes[format];
+
+  return(result);
+}
+
+static WavSampleFormat
+wavSampleFormatFromTag_(u32 formatTag, u32 bitsPerSample)
+{
+  WavSampleFormat result = WavSampleFormat_none;
+  if(formatTag == WAV_FORMAT_PCM)
+    {
+      switch(bitsPerSample)
+	{
+	case 8:  { result = WavSampleFormat_u8; } break;
+	case 16: { result = WavSampleFormat_s16; } break;
+	case 24: { result = WavSampleFormat_s24; } break;
+	case 32: { result = WavSampleFormat_s32; } break;
+	default: break;
+	}
+    }
+  else if(formatTag == WAV_FORMAT_IEEE_FLOAT)
+    {
+      switch(bitsPerSample)
+	{
+	case 32: { result = WavSampleFormat_r32; } break;
+	case 64: { result = WavSampleFormat_r64; } break;
+	default: break;
+	}
+    }
+
+  return(result);
+}
+
+// NOTE: fills `info` from a whole wave file in memory. Chunks other than fmt and data (LIST, bext,
+//       fact, ...) are skipped. Returns false for anything that isn't a wave file this decodes
+static b32
+wavParse(Buffer file, WavInfo *info)
+{
+  ZERO_STRUCT(info);
+
+  b32 result = false;
+  if(file.contents && file.size >= sizeof(RiffHeader) + sizeof(WaveHeader))
+    {
+      RiffHeader *riffHeader = (RiffHeader *)file.contents;
+      WaveHeader *waveHeader = (WaveHeader *)(riffHeader + 1);
+      b32 isRF64 = (riffHeader->chunkID.id == RIFF("RF64"));
+      if((riffHeader->chunkID.id == RIFF("RIFF") || isRF64) && waveHeader->waveID.id == RIFF("WAVE"))
+	{
+	  u64 ds64DataSize = 0;
+	  b32 foundFormat = false;
+	  u32 bitsPerSample = 0;
+	  u32 blockAlign = 0;
+	  u32 formatTag = 0;
+
+	  RiffIterator it = riffIteratorBegin((u8 *)(waveHeader + 1), file.contents + file.size);
+	  for(; riffIteratorIsValid(it); it = riffIteratorNext(it))
+	    {
+	      u32 chunkID = riffIteratorChunkID(it);
+	      usz chunkSize = riffIteratorChunkSize(it);
+	      u8 *chunkData = riffIteratorChunkData(it);
+	      if(chunkID == RIFF("ds64") && isRF64 &&
+		 chunkSize >= sizeof(WaveDs64Chunk) - sizeof(RiffHeader))
+		{
+		  ds64DataSize = ((WaveDs64Chunk *)it.at)->dataSize;
+		}
+	      else if(chunkID == RIFF("fmt ") &&
+		 chunkSize >= sizeof(WaveFormatChunk) - sizeof(RiffHeader))
+		{
+		  WaveFormatChunk *fmt = (WaveFormatChunk *)it.at;
+		  formatTag = fmt->formatTag;
+		  bitsPerSample = fmt->bitsPerSample;
+		  blockAlign = fmt->dataBlockSize;
+		  info->channelCount = fmt->channelCount;
+		  info->sampleRate = fmt->sampleRate;
+
+		  // NOTE: the first two bytes of an extensible subformat guid are the format tag
+		  if(formatTag == WAV_FORMAT_EXTENSIBLE &&
+		     chunkSize >= sizeof(WaveFormatExtended) - sizeof(RiffHeader))
+		    {
+		      WaveFormatExtension *ex = (WaveFormatExtension *)(fmt + 1);
+		      formatTag = ex->subFmt[0] | (ex->subFmt[1] << 8);
+		    }
+		  foundFormat = true;
+		}
+	      else if(chunkID == RIFF("data") && foundFormat)
+		{
+		  // NOTE: an rf64 data chunk's own size is a placeholder, which was clamped to the end of
+		  //       the file
+		  if(isRF64 && ds64DataSize && ((RiffHeader *)it.at)->chunkSize == u32_MAX)
+		    {
+		      chunkSize = (usz)MIN((u64)chunkSize, ds64DataSize);
+		    }
+		  info->samples = chunkData;
+		  info->format = wavSampleFormatFromTag_(formatTag, bitsPerSample);
+		  info->bytesPerFrame = info->channelCount*wavBytesPerSample(info->format);
+		  if(info->bytesPerFrame)
+		    {
+		      info->frameCount = chunkSize/info->bytesPerFrame;
+		    }
+
+		  // NOTE: padded sample containers aren't decoded
+		  result = (info->format != WavSampleFormat_none &&
+			    info->sampleRate != 0 &&
+			    info->bytesPerFrame == blockAlign);
+		  break;
+		}
+	    }
+	}
+    }
+
+  if(!result)
+    {
+      ZERO_STRUCT(info);
+    }
+
+  return(result);
+}
+
+//
+// NOTE: sample conversion
+//
+
+// NOTE: dest[i] = src[i] as a float in [-1, 1), for `count` interleaved samples. Integers are
+//       scaled by their full range, without an offset, so zero stays zero. The wide kernels handle
+//       whole multiples of their width, and leave the rest to the scalar one
+#define WAV_CONVERT_SAMPLES(name) usz (name)(r32 *dest, u8 *src, usz count)
+typedef WAV_CONVERT_SAMPLES(WavConvertSamples);
+
+#define WAV_SCALE_U8 (1.f/128.f)
+#define WAV_SCALE_S16 (1.f/32768.f)
+#define WAV_SCALE_S32 (1.f/2147483648.f) // NOTE: 24-bit samples are shifted up to 32 bits
+
+// NOTE: assembled from bytes, which compiles to a single unaligned load
+static inline s32
+wavReadS24_(u8 *src)
+{
+  s32 result = (s32)(((u32)src[0] << 8) | ((u32)src[1] << 16) | ((u32)src[2] << 24));
+  return(result);
+}
+
+static WAV_CONVERT_SAMPLES(wavConvertU8Scalar_)
+{
+  for(usz i = 0; i < count; ++i)
+    {
+      dest[i] = WAV_SCALE_U8*(r32)((s32)src[i] - 128);
+    }
+
+  return(count);
+}
+
+static WAV_CONVERT_SAMPLES(wavConvertS16Scalar_)
+{
+  for(usz i = 0; i < count; ++i)
+    {
+      u8 *bytes = src + 2*i;
+      s16 sample = (s16)(bytes[0] | (bytes[1] << 8));
+      dest[i] = WAV_SCALE_S16*(r32)sample;
+    }
+
+  return(count);
+}
+
+static WAV_CONVERT_SAMPLES(wavConvertS24Scalar_)
+{
+  for(usz i = 0; i < count; ++i)
+    {
+      dest[i] = WAV_SCALE_S32*(r32)wavReadS24_(src + 3*i);
+    }
+
+  return(count);
+}
+
+static WAV_CONVERT_SAMPLES(wavConvertS32Scalar_)
+{
+  for(usz i = 0; i < count; ++i)
+    {
+      u8 *bytes = src + 4*i;
+      s32 sample = (s32)((u32)bytes[0] | ((u32)bytes[1] << 8) | ((u32)bytes[2] << 16) | ((u32)bytes[3] << 24));
+      dest[i] = WAV_SCALE_S32*(r32)sample;
+    }
+
+  return(count);
+}
+
+static WAV_CONVERT_SAMPLES(wavConvertR32Scalar_)
+{
+  COPY_ARRAY(dest, src, count, r32);
+  return(count);
+}
+
+static WAV_CONVERT_SAMPLES(wavConvertR64Scalar_)
+{
+  for(usz i = 0; i < count; ++i)
+    {
+      r64 sample;
+      COPY_SIZE(&sample, src + 8*i, sizeof(r64));
+      dest[i] = (r32)sample;
+    }
+
+  return(count);
+}
+
+// NOTE: there's no unsigned byte load, so u8 samples are recentered to s8 first. 24-bit samples
+//       have no load at all; they're assembled into 32-bit lanes, and converted from there
+static WAV_CONVERT_SAMPLES(wavConvertU8Wide_)
+{
+  WideFloat scale = wideSetConstantFloats(WAV_SCALE_U8);
+  usz wideCount = count - (count % WIDE_WIDTH);
+  for(usz i = 0; i < wideCount; i += WIDE_WIDTH)
+    {
+      s8 centered[WIDE_WIDTH];
+      for(u32 j = 0; j < WIDE_WIDTH; ++j) centered[j] = (s8)(src[i + j] ^ 0x80);
+      wideStoreFloats(dest + i, wideMulFloats(scale, wideLoadS8Floats(centered)));
+    }
+
+  return(wideCount);
+}
+
+static WAV_CONVERT_SAMPLES(wavConvertS16Wide_)
+{
+  WideFloat scale = wideSetConstantFloats(WAV_SCALE_S16);
+  usz wideCount = count - (count % WIDE_WIDTH);
+  for(usz i = 0; i < wideCount; i += WIDE_WIDTH)
+    {
+      wideStoreFloats(dest + i, wideMulFloats(scale, wideLoadS16Floats((s16 *)src + i)));
+    }
+
+  return(wideCount);
+}
+
+static WAV_CONVERT_SAMPLES(wavConvertS24Wide_)
+{
+  WideFloat scale = wideSetConstantFloats(WAV_SCALE_S32);
+  usz wideCount = count - (count % WIDE_WIDTH);
+  for(usz i = 0; i < wideCount; i += WIDE_WIDTH)
+    {
+      s32 lanes[WIDE_WIDTH];
+      for(u32 j = 0; j < WIDE_WIDTH; ++j) lanes[j] = wavReadS24_(src + 3*(i + j));
+      wideStoreFloats(dest + i, wideMulFloats(scale, wideLoadS32Floats(lanes)));
+    }
+
+  return(wideCount);
+}
+
+static WAV_CONVERT_SAMPLES(wavConvertS32Wide_)
+{
+  WideFloat scale = wideSetConstantFloats(WAV_SCALE_S32);
+  usz wideCount = count - (count % WIDE_WIDTH);
+  for(usz i = 0; i < wideCount; i += WIDE_WIDTH)
+    {
+      wideStoreFloats(dest + i, wideMulFloats(scale, wideLoadS32Floats((s32 *)src + i)));
+    }
+
+  return(wideCount);
+}
+
+#if SIMD_HAS_WIDE8
+static SIMD_TARGET_AVX2 WAV_CONVERT_SAMPLES(wavConvertU8Wide8_)
+{
+  WideFloat8 scale = wideSetConstantFloats8(WAV_SCALE_U8);
+  usz wideCount = count - (count % 8);
+  for(usz i = 0; i < wideCount; i += 8)
+    {
+      s8 centered[8];
+      for(u32 j = 0; j < 8; ++j) centered[j] = (s8)(src[i + j] ^ 0x80);
+      wideStoreFloats8(dest + i, wideMulFloats8(scale, wideLoadS8Floats8(centered)));
+    }
+
+  return(wideCount);
+}
+
+static SIMD_TARGET_AVX2 WAV_CONVERT_SAMPLES(wavConvertS16Wide8_)
+{
+  WideFloat8 scale = wideSetConstantFloats8(WAV_SCALE_S16);
+  usz wideCount = count - (count % 8);
+  for(usz i = 0; i < wideCount; i += 8)
+    {
+      wideStoreFloats8(dest + i, wideMulFloats8(scale, wideLoadS16Floats8((s16 *)src + i)));
+    }
+
+  return(wideCount);
+}
+
+static SIMD_TARGET_AVX2 WAV_CONVERT_SAMPLES(wavConvertS24Wide8_)
+{
+  WideFloat8 scale = wideSetConstantFloats8(WAV_SCALE_S32);
+  usz wideCount = count - (count % 8);
+  for(usz i = 0; i < wideCount; i += 8)
+    {
+      s32 lanes[8];
+      for(u32 j = 0; j < 8; ++j) lanes[j] = wavReadS24_(src + 3*(i + j));
+      wideStoreFloats8(dest + i, wideMulFloats8(scale, wideLoadS32Floats8(lanes)));
+    }
+
+  return(wideCount);
+}
+
+static SIMD_TARGET_AVX2 WAV_CONVERT_SAMPLES(wavConvertS32Wide8_)
+{
+  WideFloat8 scale = wideSetConstantFloats8(WAV_SCALE_S32);
+  usz wideCount = count - (count % 8);
+  for(usz i = 0; i < wideCount; i += 8)
+    {
+      wideStoreFloats8(dest + i, wideMulFloats8(scale, wideLoadS32Floats8((s32 *)src + i)));
+    }
+
+  return(wideCount);
+}
+#endif
+
+#if SIMD_HAS_WIDE16
+static SIMD_TARGET_AVX512 WAV_CONVERT_SAMPLES(wavConvertU8Wide16_)
+{
+  WideFloat16 scale = wideSetConstantFloats16(WAV_SCALE_U8);
+  usz wideCount = count - (count % 16);
+  for(usz i = 0; i < wideCount; i += 16)
+    {
+      s8 centered[16];
+      for(u32 j = 0; j < 16; ++j) centered[j] = (s8)(src[i + j] ^ 0x80);
+      wideStoreFloats16(dest + i, wideMulFloats16(scale, wideLoadS8Floats16(centered)));
+    }
+
+  return(wideCount);
+}
+
+static SIMD_TARGET_AVX512 WAV_CONVERT_SAMPLES(wavConvertS16Wide16_)
+{
+  WideFloat16 scale = wideSetConstantFloats16(WAV_SCALE_S16);
+  usz wideCount = count - (count % 16);
+  for(usz i = 0; i < wideCount; i += 16)
+    {
+      wideStoreFloats16(dest + i, wideMulFloats16(scale, wideLoadS16Floats16((s16 *)src + i)));
+    }
+
+  return(wideCount);
+}
+
+static SIMD_TARGET_AVX512 WAV_CONVERT_SAMPLES(wavConvertS24Wide16_)
+{
+  WideFloat16 scale = wideSetConstantFloats16(WAV_SCALE_S32);
+  usz wideCount = count - (count % 16);
+  for(usz i = 0; i < wideCount; i += 16)
+    {
+      s32 lanes[16];
+      for(u32 j = 0; j < 16; ++j) lanes[j] = wavReadS24_(src + 3*(i + j));
+      wideStoreFloats16(dest + i, wideMulFloats16(scale, wideLoadS32Floats16(lanes)));
+    }
+
+  return(wideCount);
+}
+
+static SIMD_TARGET_AVX512 WAV_CONVERT_SAMPLES(wavConvertS32Wide16_)
+{
+  WideFloat16 scale = wideSetConstantFloats16(WAV_SCALE_S32);
+  usz wideCount = count - (count % 16);
+  for(usz i = 0; i < wideCount; i += 16)
+    {
+      wideStoreFloats16(dest + i, wideMulFloats16(scale, wideLoadS32Floats16((s32 *)src + i)));
+    }
+
+  return(wideCount);
+}
+#endif
+
+// NOTE: float samples have no wide kernels: r32 is a copy, and r64 has no wide type to load into
+static void
+wavConvertSamples(SimdLevel level, WavSampleFormat format, r32 *dest, u8 *src, usz count)
+{
+  WavConvertSamples *wide = 0;
+  WavConvertSamples *scalar = 0;
+  switch(format)
+    {
+    case WavSampleFormat_u8:  { scalar = wavConvertU8Scalar_; wide = wavConvertU8Wide_; } break;
+    case WavSampleFormat_s16: { scalar = wavConvertS16Scalar_; wide = wavConvertS16Wide_; } break;
+    case WavSampleFormat_s24: { scalar = wavConvertS24Scalar_; wide = wavConvertS24Wide_; } break;
+    case WavSampleFormat_s32: { scalar = wavConvertS32Scalar_; wide = wavConvertS32Wide_; } break;
+    case WavSampleFormat_r32: { scalar = wavConvertR32Scalar_; } break;
+    case WavSampleFormat_r64: { scalar = wavConvertR64Scalar_; } break;
+    default: { ASSERT(!"invalid wav sample format"); return; } break;
+    }
+
+  if(wide)
+    {
+      switch(level)
+	{
+#if SIMD_HAS_WIDE16
+	case SimdLevel_wide16:
+	  {
+	    switch(format)
+	      {
+	      case WavSampleFormat_u8:  { wide = wavConvertU8Wide16_; } break;
+	      case WavSampleFormat_s16: { wide = wavConvertS16Wide16_; } break;
+	      case WavSampleFormat_s24: { wide = wavConvertS24Wide16_; } break;
+	      case WavSampleFormat_s32: { wide = wavConvertS32Wide16_; } break;
+	      default: break;
+	      }
+	  } break;
+#endif
+#if SIMD_HAS_WIDE8
+	case SimdLevel_wide8:
+	  {
+	    switch(format)
+	      {
+	      case WavSampleFormat_u8:  { wide = wavConvertU8Wide8_; } break;
+	      case WavSampleFormat_s16: { wide = wavConvertS16Wide8_; } break;
+	      case WavSampleFormat_s24: { wide = wavConvertS24Wide8_; } break;
+	      case WavSampleFormat_s32: { wide = wavConvertS32Wide8_; } break;
+	      default: break;
+	      }
+	  } break;
+#endif
+	case SimdLevel_wide4: break;
+	default: { wide = 0; } break;
+	}
+    }
+
+  usz converted = wide ? wide(dest, src, count) : 0;
+  usz bytesPerSample = wavBytesPerSample(format);
+  scalar(dest + converted, src + converted*bytesPerSample, count - converted);
+}
+
+// NOTE: splits interleaved frames into left and right. Mono goes to both, and channels past the
+//       second are dropped
+static void
+wavDeinterleave(r32 *destL, r32 *destR, r32 *src, u32 frameCount, u32 channelCount)
+{
+  if(channelCount == 1)
+    {
+      COPY_ARRAY(destL, src, frameCount, r32);
+      COPY_ARRAY(destR, src, frameCount, r32);
+    }
+  else if(channelCount == 2)
+    {
+      for(u32 frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+	{
+	  destL[frameIndex] = src[2*frameIndex + 0];
+	  destR[frameIndex] = src[2*frameIndex + 1];
+	}
+    }
+  else
+    {
+      for(u32 frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+	{
+	  destL[frameIndex] = src[channelCount*frameIndex + 0];
+	  destR[frameIndex] = src[channelCount*frameIndex + 1];
+	}
+    }
+}
+
+//
+// NOTE: resampling
+//
+
+// NOTE: converts a stream of source blocks to `destRate` with cubic (4-point lagrange)
+//       interpolation. Positions are tracked exactly, as a whole source frame plus a remainder in
+//       units of 1/destRate, so there's no drift over long files. Each block is deinterleaved into
+//       `window[channel] + WAV_RESAMPLER_HISTORY`, behind the last frames of the block before, and
+//       every output frame whose taps are all in the window is written. The final push writes the
+//       rest, reading zeros past the end of the source.
+//       There's no anti-aliasing filter, so downsampling aliases whatever is above the new nyquist
+struct WavResampler
+{
+  u32 srcRate;
+  u32 destRate;
+  u64 stepFrames;     // NOTE: srcRate/destRate
+  u32 stepRemainder;  // NOTE: srcRate%destRate
+
+  u64 srcFrame;       // NOTE: source position of the next output frame
+  u32 srcRemainder;
+  u64 windowStart;    // NOTE: source frame at window[channel][WAV_RESAMPLER_HISTORY]
+
+  u64 destFrame;
+  u64 destFrameCount;
+
+  r32 *window[2];     // NOTE: [WAV_RESAMPLER_HISTORY + WAV_DECODE_BLOCK_FRAMES]
+};
+
+static inline u64
+wavResampledFrameCount(u64 srcFrameCount, u32 srcRate, u32 destRate)
+{
+  u64 result = (srcFrameCount*destRate + srcRate - 1)/srcRate;
+  return(result);
+}
+
+static WavResampler
+wavResamplerBegin(Arena *arena, u32 srcRate, u32 destRate, u64 srcFrameCount)
+{
+  WavResampler result = {};
+  result.srcRate = srcRate;
+  result.destRate = destRate;
+  result.stepFrames = srcRate/destRate;
+  result.stepRemainder = srcRate % destRate;
+  result.destFrameCount = wavResampledFrameCount(srcFrameCount, srcRate, destRate);
+  for(u32 channelIndex = 0; channelIndex < ARRAY_COUNT(result.window); ++channelIndex)
+    {
+      // NOTE: zeroed, so the history before the first block is silence
+      result.window[channelIndex] = arenaPushArray(arena, WAV_RESAMPLER_HISTORY + WAV_DECODE_BLOCK_FRAMES, r32,
+						   arenaFlagsZeroNoAlign());
+    }
+
+  return(result);
+}
+
+// NOTE: `frameCount` new frames are already in the window. Writes output frames to `dest` at their
+//       absolute position, so dest holds `destFrameCount` frames
+static void
+wavResamplerPush(WavResampler *resampler, r32 **dest, u32 frameCount, b32 isFinal)
+{
+  u64 windowCount = WAV_RESAMPLER_HISTORY + frameCount;
+  r32 invDestRate = 1.f/(r32)resampler->destRate;
+
+  u64 srcFrame = resampler->srcFrame;
+  u32 srcRemainder = resampler->srcRemainder;
+  u64 destFrame = resampler->destFrame;
+  while(destFrame < resampler->destFrameCount)
+    {
+      // NOTE: window index of the tap before the interpolated interval
+      ASSERT(srcFrame + WAV_RESAMPLER_HISTORY >= resampler->windowStart + 1);
+      u64 tapIndex = srcFrame + WAV_RESAMPLER_HISTORY - 1 - resampler->windowStart;
+      if(tapIndex + 4 > windowCount && !isFinal) break;
+
+      r32 t = 1.f + invDestRate*(r32)srcRemainder;
+      for(u32 channelIndex = 0; channelIndex < ARRAY_COUNT(resampler->window); ++channelIndex)
+	{
+	  r32 *window = resampler->window[channelIndex];
+	  r32 taps[4];
+	  for(u32 tap = 0; tap < 4; ++tap)
+	    {
+	      taps[tap] = (tapIndex + tap < windowCount) ? window[tapIndex + tap] : 0.f;
+	    }
+	  dest[channelIndex][destFrame] = cubicInterp(taps[0], taps[1], taps[2], taps[3], t);
+	}
+
+      ++destFrame;
+      srcFrame += resampler->stepFrames;
+      srcRemainder += resampler->stepRemainder;
+      if(srcRemainder >= resampler->destRate)
+	{
+	  srcRemainder -= resampler->destRate;
+	  ++srcFrame;
+	}
+    }
+
+  resampler->srcFrame = srcFrame;
+  resampler->srcRemainder = srcRemainder;
+  resampler->destFrame = destFrame;
+
+  // NOTE: the last frames become the next block's history. Copying forwards is safe even when the
+  //       block is shorter than the history
+  for(u32 channelIndex = 0; channelIndex < ARRAY_COUNT(resampler->window); ++channelIndex)
+    {
+      r32 *window = resampler->window[channelIndex];
+      for(u32 i = 0; i < WAV_RESAMPLER_HISTORY; ++i)
+	{
+	  window[i] = window[frameCount + i];
+	}
+    }
+  resampler->windowStart += frameCount;
+}
+
+//
+// NOTE: decoding
+//
+
+// NOTE: decodes a parsed file into a stereo sound at INTERNAL_SAMPLE_RATE, allocated from `arena`
+static LoadedSound
+wavDecode(Arena *arena, WavInfo *info, SimdLevel simdLevel)
+{
+  LoadedSound result = {};
+  if(info->frameCount == 0 || info->sampleRate == 0) return(result);
+
+  b32 resampling = (info->sampleRate != INTERNAL_SAMPLE_RATE);
+  u64 destFrameCount = (resampling ?
+			wavResampledFrameCount(info->frameCount, info->sampleRate, INTERNAL_SAMPLE_RATE) :
+			info->frameCount);
+  if(destFrameCount > u32_MAX) return(result);
+
+  TemporaryMemory scratch = arenaGetScratch(&arena, 1);
+
+  r32 *samplesL = arenaPushArray(arena, 2*destFrameCount, r32, arenaFlagsNoZeroAlign(4*sizeof(r32)));
+  r32 *samplesR = samplesL + destFrameCount;
+  r32 *dest[2] = {samplesL, samplesR};
+
+  r32 *converted = arenaPushArray(scratch.arena, (usz)WAV_DECODE_BLOCK_FRAMES*info->channelCount, r32,
+				  arenaFlagsNoZeroAlign(4*sizeof(r32)));
+  WavResampler resampler = {};
+  if(resampling)
+    {
+      resampler = wavResamplerBegin(scratch.arena, info->sampleRate, INTERNAL_SAMPLE_RATE, info->frameCount);
+    }
+
+  for(u64 frameIndex = 0; frameIndex < info->frameCount; frameIndex += WAV_DECODE_BLOCK_FRAMES)
+    {
+      u32 blockFrameCount = (u32)MIN(WAV_DECODE_BLOCK_FRAMES, info->frameCount - frameIndex);
+      u8 *src = info->samples + frameIndex*info->bytesPerFrame;
+      wavConvertSamples(simdLevel, info->format, converted, src, (usz)blockFrameCount*info->channelCount);
+
+      if(resampling)
+	{
+	  wavDeinterleave(resampler.window[0] + WAV_RESAMPLER_HISTORY,
+			  resampler.window[1] + WAV_RESAMPLER_HISTORY,
+			  converted, blockFrameCount, info->channelCount);
+	  wavResamplerPush(&resampler, dest, blockFrameCount, false);
+	}
+      else
+	{
+	  wavDeinterleave(samplesL + frameIndex, samplesR + frameIndex, converted, blockFrameCount,
+			  info->channelCount);
+	}
+    }
+  if(resampling)
+    {
+      wavResamplerPush(&resampler, dest, 0, true);
+      ASSERT(resampler.destFrame == destFrameCount);
+    }
+
+  arenaReleaseScratch(scratch);
+
+  result.sampleCount = (u32)destFrameCount;
+  result.channelCount = MIN(info->channelCount, 2);
+  result.samples[0] = samplesL;
+  result.samples[1] = samplesR;
+  return(result);
+}
+
+// NOTE: returns an empty sound if the file is missing, or isn't a wave file this decodes
+static inline LoadedSound
+loadWav(Arena *arena, String8 path)
+{
+  LoadedSound result = {};
+  TemporaryMemory scratch = arenaGetScratch(&arena, 1);
+
+  Buffer file = gsMapFile((char *)path.str);
+  b32 isMapped = (file.contents != 0);
+  if(!isMapped)
+    {
+      file = gsReadEntireFile((char *)path.str, scratch.arena);
+    }
+
+  WavInfo info = {};
+  if(wavParse(file, &info))
+    {
+      result = wavDecode(arena, &info, simdGetLevel());
+    }
+
+  if(isMapped) gsUnmapFile(file);
+  arenaReleaseScratch(scratch);
+
+  return(result);
+}